@@ -0,0 +1,1085 @@
+#include "better-string.hh"
+#include "better-regex.hh"
+#include "better-glob.hh"
+#include "better-ngram.hh"
+#include "better-suffix.hh"
+#include "better-corpus.hh"
+
+#include <benchmark/benchmark.h>
+
+#include <stdlib.h>
+
+#include <map>
+#include <regex>
+#include <utility>
+
+#if BETTER_BENCH_FMT
+#include <fmt/format.h>
+#endif
+
+#if __has_include(<format>)
+#include <format>
+#endif
+
+using namespace ext;
+
+//	------------------------------------------------------------
+//		Corpus
+//	------------------------------------------------------------
+
+using corpus::Kind;
+
+// Corpus seed, can be changed with --corpus_seed=N
+static uint64_t seed = corpus::default_seed;
+
+// Character type names
+template<typename Char> auto char_name() -> const char *;
+template<> auto char_name<char>() -> const char * {return "char";}
+template<> auto char_name<char16_t>() -> const char * {return "char16_t";}
+template<> auto char_name<char32_t>() -> const char * {return "char32_t";}
+
+// Cached corpora. Only a single large corpus is kept alive at a time.
+template<typename Char>
+auto cached(Kind kind, size_t bytes) -> const better_string<Char> &
+{
+	static std::map<std::pair<Kind, size_t>, better_string<Char>> cache;
+	static constexpr size_t large = 1 << 20;
+
+	auto key = std::make_pair(kind, bytes);
+	auto iter = cache.find(key);
+	if (iter != cache.end())
+		return iter->second;
+
+	if (bytes >= large)
+	{
+		for (auto i = cache.begin(); i != cache.end();)
+			i = (i->first.second >= large) ? cache.erase(i) : std::next(i);
+	}
+	return cache.emplace(key, corpus::generate<Char>(kind, seed, bytes)).first->second;
+}
+
+// Take a substring, aligned to codepoint boundaries
+template<typename Char>
+auto sample(const better_string<Char> & text, size_t percent, size_t codepoints) -> better_string<Char>
+{
+	auto iter = encoding_traits<default_encoding<Char>::value>::iter(text.data());
+	auto done = encoding_traits<default_encoding<Char>::value>::iter(text.data() + text.size());
+
+	size_t skip = text.template length<>() * percent / 100;
+	for (; skip > 0 && iter != done; -- skip)
+		++ iter;
+	auto start = static_cast<const Char *>(iter);
+	for (; codepoints > 0 && iter != done; -- codepoints)
+		++ iter;
+	return better_string<Char>(start, static_cast<const Char *>(iter));
+}
+
+// Check if a position is on a codepoint boundary
+template<typename Char>
+auto boundary(const better_string<Char> & text, size_t pos) -> bool
+{
+	if (pos >= text.size())
+		return true;
+	if (sizeof(Char) == 1)
+		return (text[pos] & 0xC0) != 0x80;
+	if (sizeof(Char) == 2)
+		return (text[pos] & 0xFC00) != 0xDC00;
+	return true;
+}
+
+// String literal in any character type
+template<typename Char>
+auto literal(const char * str) -> better_string<Char>
+{
+	better_string<Char> result;
+	for (; *str; ++ str)
+		result.push_back(Char(*str));
+	return result;
+}
+
+// Report throughput
+template<typename Char>
+void processed(benchmark::State & state, const better_string<Char> & text)
+{
+	state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(text.size() * sizeof(Char)));
+}
+
+//	------------------------------------------------------------
+//		Benchmarks - better string
+//	------------------------------------------------------------
+
+// -------------------- Core --------------------
+
+template<typename Char>
+void bm_length(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	for (auto _ : state)
+		benchmark::DoNotOptimize(text.template length<>());
+	processed(state, text);
+}
+
+template<typename Char>
+void bm_codepoints(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	for (auto _ : state)
+	{
+		uint32_t sum = 0;
+		for (int32_t cp : text.template codepoints<>())
+			sum += cp;
+		benchmark::DoNotOptimize(sum);
+	}
+	processed(state, text);
+}
+
+// -------------------- Alignment --------------------
+
+template<typename Char>
+void bm_center(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	auto fill = literal<Char>("-");
+	size_t width = text.template length<>() + 8;
+	for (auto _ : state)
+		benchmark::DoNotOptimize(text.center(width, fill));
+	processed(state, text);
+}
+
+template<typename Char>
+void bm_ljust(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	auto fill = literal<Char>("-");
+	size_t width = text.template length<>() + 8;
+	for (auto _ : state)
+		benchmark::DoNotOptimize(text.ljust(width, fill));
+	processed(state, text);
+}
+
+template<typename Char>
+void bm_rjust(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	auto fill = literal<Char>("-");
+	size_t width = text.template length<>() + 8;
+	for (auto _ : state)
+		benchmark::DoNotOptimize(text.rjust(width, fill));
+	processed(state, text);
+}
+
+template<typename Char>
+void bm_zfill(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	size_t width = text.template length<>() + 8;
+	for (auto _ : state)
+		benchmark::DoNotOptimize(text.zfill(width));
+	processed(state, text);
+}
+
+// -------------------- Search --------------------
+
+template<typename Char>
+void bm_find(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	auto sub = sample(text, 90, 4);
+	for (auto _ : state)
+		benchmark::DoNotOptimize(text.find(sub));
+	processed(state, text);
+}
+
+template<typename Char>
+void bm_rfind(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	auto sub = sample(text, 10, 4);
+	for (auto _ : state)
+		benchmark::DoNotOptimize(text.rfind(sub));
+	processed(state, text);
+}
+
+template<typename Char>
+void bm_index(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	auto sub = sample(text, 90, 4);
+	for (auto _ : state)
+		benchmark::DoNotOptimize(text.index(sub));
+	processed(state, text);
+}
+
+template<typename Char>
+void bm_rindex(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	auto sub = sample(text, 10, 4);
+	for (auto _ : state)
+		benchmark::DoNotOptimize(text.rindex(sub));
+	processed(state, text);
+}
+
+template<typename Char>
+void bm_count(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	auto sub = literal<Char>(" ");
+	for (auto _ : state)
+		benchmark::DoNotOptimize(text.count(sub));
+	processed(state, text);
+}
+
+template<typename Char>
+void bm_finditer(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	auto sub = literal<Char>(" ");
+	for (auto _ : state)
+	{
+		size_t count = 0;
+		for (auto match : text.finditer(sub))
+			count += match.size();
+		benchmark::DoNotOptimize(count);
+	}
+	processed(state, text);
+}
+
+template<typename Char>
+void bm_find_all(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	auto sub = sample(text, 90, 2);
+	for (auto _ : state)
+		benchmark::DoNotOptimize(text.find_all(sub, false, 0));
+	processed(state, text);
+}
+
+// Separator characters of the tokenizer benchmarks
+template<typename Char>
+auto separators() -> const charset<default_encoding<Char>::value> &
+{
+	static const auto seps = literal<Char>(" ,.;:\n");
+	static const charset<default_encoding<Char>::value> set(seps.data(), seps.size());
+	return set;
+}
+
+template<typename Char>
+void bm_span(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	const auto & set = separators<Char>();
+	for (auto _ : state)
+	{
+		// Count the words, skipping the runs of separators
+		size_t count = 0;
+		for (size_t pos = text.span(set); pos < text.size(); pos += text.span(set, pos))
+		{
+			pos += text.cspan(set, pos);
+			++ count;
+		}
+		benchmark::DoNotOptimize(count);
+	}
+	processed(state, text);
+}
+
+template<typename Char>
+void bm_levenshtein(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	auto other = text.replace(literal<Char>(" "), literal<Char>("_"), 8);
+	for (auto _ : state)
+		benchmark::DoNotOptimize(text.levenshtein(other, 16));
+	processed(state, text);
+}
+
+template<typename Char>
+void bm_damerau(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	auto other = text.replace(literal<Char>(" "), literal<Char>("_"), 8);
+	for (auto _ : state)
+		benchmark::DoNotOptimize(text.damerau(other, 16));
+	processed(state, text);
+}
+
+template<typename Char>
+void bm_fuzzy_find(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	auto sub = sample(text, 90, 16).replace(literal<Char>(" "), literal<Char>("_"), 1);
+	for (auto _ : state)
+		benchmark::DoNotOptimize(text.fuzzy_find(sub, 2));
+	processed(state, text);
+}
+
+// -------------------- Replace --------------------
+
+template<typename Char>
+void bm_replace(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	auto old = literal<Char>(" ");
+	auto str = literal<Char>("__");
+	for (auto _ : state)
+		benchmark::DoNotOptimize(text.replace(old, str));
+	processed(state, text);
+}
+
+template<typename Char>
+void bm_translate(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	auto table = [] (int32_t ch) -> int32_t {return ch == ' ' ? '_' : ch;};
+	for (auto _ : state)
+		benchmark::DoNotOptimize(text.translate(table));
+	processed(state, text);
+}
+
+template<typename Char>
+void bm_expandtabs(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	for (auto _ : state)
+		benchmark::DoNotOptimize(text.expandtabs());
+	processed(state, text);
+}
+
+// -------------------- Split and join --------------------
+
+template<typename Char>
+void bm_join(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	auto items = text.split();
+	auto sep = literal<Char>(" ");
+	for (auto _ : state)
+		benchmark::DoNotOptimize(sep.join(items));
+	processed(state, text);
+}
+
+template<typename Char>
+void bm_split_whitespace(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	for (auto _ : state)
+		benchmark::DoNotOptimize(text.split());
+	processed(state, text);
+}
+
+template<typename Char>
+void bm_split(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	auto sep = literal<Char>(" ");
+	for (auto _ : state)
+		benchmark::DoNotOptimize(text.split(sep));
+	processed(state, text);
+}
+
+template<typename Char>
+void bm_split_any(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	const auto & set = separators<Char>();
+	for (auto _ : state)
+		benchmark::DoNotOptimize(better_string_view<Char>(text).split_any(set));
+	processed(state, text);
+}
+
+template<typename Char>
+void bm_rsplit_whitespace(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	for (auto _ : state)
+		benchmark::DoNotOptimize(text.rsplit());
+	processed(state, text);
+}
+
+template<typename Char>
+void bm_rsplit(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	auto sep = literal<Char>(" ");
+	for (auto _ : state)
+		benchmark::DoNotOptimize(text.rsplit(sep));
+	processed(state, text);
+}
+
+// -------------------- Prefix and suffix --------------------
+
+template<typename Char>
+void bm_startswith(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	auto prefix = sample(text, 0, text.template length<>() / 2);
+	for (auto _ : state)
+		benchmark::DoNotOptimize(text.startswith(prefix));
+	processed(state, text);
+}
+
+template<typename Char>
+void bm_endswith(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	auto suffix = sample(text, 50, text.template length<>());
+	for (auto _ : state)
+		benchmark::DoNotOptimize(text.endswith(suffix));
+	processed(state, text);
+}
+
+template<typename Char>
+void bm_removeprefix(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	auto prefix = sample(text, 0, 4);
+	for (auto _ : state)
+		benchmark::DoNotOptimize(text.removeprefix(prefix));
+	processed(state, text);
+}
+
+template<typename Char>
+void bm_removesuffix(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	auto suffix = sample(text, 100, 4);
+	for (auto _ : state)
+		benchmark::DoNotOptimize(text.removesuffix(suffix));
+	processed(state, text);
+}
+
+// -------------------- Character --------------------
+
+template<typename Char>
+void bm_isascii(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	for (auto _ : state)
+		benchmark::DoNotOptimize(text.template isascii<>());
+	processed(state, text);
+}
+
+template<typename Char>
+void bm_upper(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	for (auto _ : state)
+		benchmark::DoNotOptimize(text.template upper<>());
+	processed(state, text);
+}
+
+template<typename Char>
+void bm_lower(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	for (auto _ : state)
+		benchmark::DoNotOptimize(text.template lower<>());
+	processed(state, text);
+}
+
+// -------------------- Transcoding --------------------
+
+template<typename Char>
+void bm_transcode(benchmark::State & state, Kind kind)
+{
+	// Transcode to UTF-32, or to UTF-8 when the string is already UTF-32
+	static constexpr Encoding From = default_encoding<Char>::value;
+	static constexpr Encoding To = (From == Encoding::UTF32) ? Encoding::UTF8 : Encoding::UTF32;
+
+	const auto & text = cached<Char>(kind, state.range(0));
+	for (auto _ : state)
+		benchmark::DoNotOptimize(text.template transcode<From, To>(better_string<Char>::errors::Replace));
+	processed(state, text);
+}
+
+template<typename Char, impl::Errors Mode>
+void bm_transcode_errors(benchmark::State & state, Kind kind)
+{
+	static constexpr Encoding From = default_encoding<Char>::value;
+	static constexpr Encoding To = (From == Encoding::UTF32) ? Encoding::UTF8 : Encoding::UTF32;
+
+	const auto & text = cached<Char>(kind, state.range(0));
+	for (auto _ : state)
+		benchmark::DoNotOptimize(text.template transcode<From, To>(Mode));
+	processed(state, text);
+}
+
+// -------------------- Formatting --------------------
+
+// Create a format template from the corpus, with a few fields every 64 characters
+template<typename Char>
+auto format_template(const better_string<Char> & text) -> better_string<Char>
+{
+	better_string<Char> result;
+	auto fields = literal<Char>(" {0} {1:>8} {2:#x} ");
+	for (size_t i = 0; i < text.size(); ++ i)
+	{
+		if (text[i] == '{' || text[i] == '}')
+			result.push_back(text[i]);
+		result.push_back(text[i]);
+		if (i % 64 >= 63 && boundary(text, i + 1))
+			result.extend(fields);
+	}
+	return result.extend(fields);
+}
+
+template<typename Char>
+void bm_format(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	auto pattern = format_template(text);
+	for (auto _ : state)
+		benchmark::DoNotOptimize(pattern.format(-42, 42U, 0xBE77E7));
+	processed(state, text);
+}
+
+template<typename Char>
+void bm_truncate(benchmark::State & state, Kind kind)
+{
+	using View = better_string_view<Char>;
+	static constexpr Encoding E = default_encoding<Char>::value;
+
+	const auto & text = cached<Char>(kind, state.range(0));
+	size_t width = text.template length<>() / 2;
+	for (auto _ : state)
+		benchmark::DoNotOptimize(algorithm::string::truncate<View, std::char_traits<Char>, E, better_string<Char>>(text, width));
+	processed(state, text);
+}
+
+template<typename Char>
+void bm_repr(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	for (auto _ : state)
+		benchmark::DoNotOptimize(repr<Char>(better_string_view<Char>(text)));
+	processed(state, text);
+}
+
+template<typename Char>
+void bm_ascii(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	for (auto _ : state)
+		benchmark::DoNotOptimize(ascii<Char>(better_string_view<Char>(text)));
+	processed(state, text);
+}
+
+template<typename Char>
+void bm_html_escape(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	for (auto _ : state)
+		benchmark::DoNotOptimize(better_string_view<Char>(text).html_escape());
+	processed(state, text);
+}
+
+template<typename Char>
+void bm_html_unescape(benchmark::State & state, Kind kind)
+{
+	auto escaped = better_string_view<Char>(cached<Char>(kind, state.range(0))).html_escape();
+	for (auto _ : state)
+		benchmark::DoNotOptimize(escaped.html_unescape());
+	processed(state, escaped);
+}
+
+// Base64 and hex (byte strings only)
+void bm_b64encode(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<char>(kind, state.range(0));
+	for (auto _ : state)
+		benchmark::DoNotOptimize(better_string_view<char>(text).b64encode());
+	processed(state, text);
+}
+
+void bm_b64decode(benchmark::State & state, Kind kind)
+{
+	auto encoded = better_string_view<char>(cached<char>(kind, state.range(0))).b64encode();
+	for (auto _ : state)
+		benchmark::DoNotOptimize(encoded.b64decode());
+	processed(state, encoded);
+}
+
+void bm_hexlify(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<char>(kind, state.range(0));
+	for (auto _ : state)
+		benchmark::DoNotOptimize(better_string_view<char>(text).hexlify());
+	processed(state, text);
+}
+
+void bm_unhexlify(benchmark::State & state, Kind kind)
+{
+	auto encoded = better_string_view<char>(cached<char>(kind, state.range(0))).hexlify();
+	for (auto _ : state)
+		benchmark::DoNotOptimize(encoded.unhexlify());
+	processed(state, encoded);
+}
+
+// URL encoding (byte strings only)
+void bm_percent_encode(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<char>(kind, state.range(0));
+	for (auto _ : state)
+		benchmark::DoNotOptimize(better_string_view<char>(text).percent_encode(url::path, true));
+	processed(state, text);
+}
+
+void bm_percent_decode(benchmark::State & state, Kind kind)
+{
+	auto encoded = better_string_view<char>(cached<char>(kind, state.range(0))).percent_encode(url::path, true);
+	for (auto _ : state)
+		benchmark::DoNotOptimize(encoded.percent_decode(true));
+	processed(state, encoded);
+}
+
+void bm_query_pairs(benchmark::State & state, Kind kind)
+{
+	// A query string, with a key or a value for every 16 bytes of the text
+	const auto & text = cached<char>(kind, state.range(0));
+	better_string<char> query;
+	for (size_t i = 0; i < text.size(); i += 16)
+	{
+		better_string_view<char>(text.data() + i, std::min<size_t>(16, text.size() - i)).percent_encode_into(query, url::unreserved, true);
+		query.push_back((i / 16) % 2 ? '&' : '=');
+	}
+
+	for (auto _ : state)
+	{
+		size_t size = 0;
+		for (auto & pair : better_string_view<char>(query).query_pairs())
+			size += pair.key.size() + pair.value.size();
+		benchmark::DoNotOptimize(size);
+	}
+	processed(state, query);
+}
+
+void bm_shlex_split(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<char>(kind, state.range(0));
+	for (auto _ : state)
+	{
+		size_t size = 0;
+		try
+		{
+			for (auto & token : better_string_view<char>(text).shlex_split())
+				size += token.size();
+		}
+		catch (const std::invalid_argument &) {}
+		benchmark::DoNotOptimize(size);
+	}
+	processed(state, text);
+}
+
+void bm_csv_reader(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<char>(kind, state.range(0));
+	for (auto _ : state)
+	{
+		size_t fields = 0;
+		csv_reader<char> reader(text);
+		for (auto & record : reader)
+			fields += record.size();
+		benchmark::DoNotOptimize(fields);
+	}
+	processed(state, text);
+}
+
+// Regular expressions (the requests of access logs, and their status)
+static const char * log_pattern = "\"(GET|POST|PUT|DELETE) (\\S+) HTTP/1\\.[01]\" (\\d{3})";
+
+void bm_regex_search(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<char>(kind, state.range(0));
+	regex re(log_pattern);
+	for (auto _ : state)
+	{
+		size_t size = 0;
+		for (auto & found : re.finditer(text))
+			size += found.group(2).size();
+		benchmark::DoNotOptimize(size);
+	}
+	processed(state, text);
+}
+
+void bm_regex_sub(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<char>(kind, state.range(0));
+	regex re(log_pattern);
+	for (auto _ : state)
+		benchmark::DoNotOptimize(re.sub("\\1 \\3", text));
+	processed(state, text);
+}
+
+// Glob patterns (every line is matched, like a path or a metric name)
+template<typename Function>
+void each_line(const better_string<char> & text, Function function)
+{
+	better_string_view<char> rest(text.data(), text.size());
+	while (!rest.empty())
+	{
+		size_t end = kernels::active().find_byte(rest.data(), rest.size(), '\n');
+		end = (end == size_t(-1)) ? rest.size() : end;
+		function(better_string_view<char>(rest.data(), end));
+		rest = better_string_view<char>(rest.data() + std::min(end + 1, rest.size()), rest.size() - std::min(end + 1, rest.size()));
+	}
+}
+
+void bm_glob_match(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<char>(kind, state.range(0));
+	glob_pattern glob("*\"GET /*.html HTTP/1.?\" 200 *");
+	for (auto _ : state)
+	{
+		size_t count = 0;
+		each_line(text, [&] (better_string_view<char> line) {count += glob.match(line);});
+		benchmark::DoNotOptimize(count);
+	}
+	processed(state, text);
+}
+
+void bm_glob_set(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<char>(kind, state.range(0));
+	static const char * const methods[] = {"GET", "POST", "PUT", "DELETE"};
+	static const char * const types[] = {".css", ".json", ".html", ".png"};
+	static const char letters[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+
+	// Routes, like "*\"GET /Ab*.json HTTP/1.?\" *"
+	std::vector<std::string> patterns;
+	for (int i = 0; i < 1000; ++ i)
+		patterns.push_back("*\"" + std::string(methods[i % 4]) + " /" + letters[i % 52] + letters[i / 52 % 52] + "*" + types[i / 4 % 4] + " HTTP/1.?\" *");
+	glob_set set(patterns.begin(), patterns.end());
+	for (auto _ : state)
+	{
+		size_t count = 0;
+		std::vector<size_t> found;
+		each_line(text, [&] (better_string_view<char> line) {found.clear(); count += set.matches_into(line, found).size();});
+		benchmark::DoNotOptimize(count);
+	}
+	processed(state, text);
+}
+
+void bm_ngram_search(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<char>(kind, state.range(0));
+	ngram_index<char> index;
+	each_line(text, [&] (better_string_view<char> line) {index.insert(line);});
+	auto sub = sample(text, 50, 8);
+	for (auto _ : state)
+	{
+		std::vector<size_t> found;
+		benchmark::DoNotOptimize(index.search_into(sub, found).size());
+	}
+	processed(state, text);
+}
+
+void bm_suffix_count(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<char>(kind, state.range(0));
+	suffix_index index(text);
+	auto sub = sample(text, 50, 4);
+	for (auto _ : state)
+		benchmark::DoNotOptimize(index.count(sub));
+	processed(state, text);
+}
+
+//	------------------------------------------------------------
+//		Benchmarks - baselines
+//	------------------------------------------------------------
+
+// The lines that contain a substring, found with a scan of every line
+void bm_linear_search(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<char>(kind, state.range(0));
+	std::vector<better_string_view<char>> lines;
+	each_line(text, [&] (better_string_view<char> line) {lines.push_back(line);});
+	auto sub = sample(text, 50, 8);
+	for (auto _ : state)
+	{
+		std::vector<size_t> found;
+		for (size_t i = 0; i < lines.size(); ++ i)
+			if (lines[i].find(sub) != size_t(-1))
+				found.push_back(i);
+		benchmark::DoNotOptimize(found.size());
+	}
+	processed(state, text);
+}
+
+template<typename Char>
+void bm_std_string_find(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	std::basic_string<Char> str(text), sub(sample(text, 90, 4));
+	for (auto _ : state)
+		benchmark::DoNotOptimize(str.find(sub));
+	processed(state, text);
+}
+
+template<typename Char>
+void bm_std_string_view_find(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	auto needle = sample(text, 90, 4);
+	std::basic_string_view<Char> str(text.data(), text.size()), sub(needle.data(), needle.size());
+	for (auto _ : state)
+		benchmark::DoNotOptimize(str.find(sub));
+	processed(state, text);
+}
+
+template<typename Char>
+void bm_std_string_rfind(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	std::basic_string<Char> str(text), sub(sample(text, 10, 4));
+	for (auto _ : state)
+		benchmark::DoNotOptimize(str.rfind(sub));
+	processed(state, text);
+}
+
+template<typename Char>
+void bm_std_string_count(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	std::basic_string_view<Char> str(text.data(), text.size());
+	for (auto _ : state)
+	{
+		size_t count = 0;
+		for (size_t pos = str.find(Char(' ')); pos != str.npos; pos = str.find(Char(' '), pos + 1))
+			++ count;
+		benchmark::DoNotOptimize(count);
+	}
+	processed(state, text);
+}
+
+template<typename Char>
+void bm_std_string_replace(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	std::basic_string_view<Char> str(text.data(), text.size());
+	std::basic_string<Char> with = literal<Char>("__");
+	for (auto _ : state)
+	{
+		std::basic_string<Char> result;
+		size_t prev = 0;
+		for (size_t pos = str.find(Char(' ')); pos != str.npos; pos = str.find(Char(' '), prev))
+		{
+			result.append(str.data() + prev, pos - prev).append(with);
+			prev = pos + 1;
+		}
+		result.append(str.data() + prev, str.size() - prev);
+		benchmark::DoNotOptimize(result);
+	}
+	processed(state, text);
+}
+
+template<typename Char>
+void bm_std_string_split(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	std::basic_string_view<Char> str(text.data(), text.size());
+	for (auto _ : state)
+	{
+		std::vector<std::basic_string<Char>> result;
+		size_t prev = 0;
+		for (size_t pos = str.find(Char(' ')); pos != str.npos; pos = str.find(Char(' '), prev))
+		{
+			result.emplace_back(str.substr(prev, pos - prev));
+			prev = pos + 1;
+		}
+		result.emplace_back(str.substr(prev));
+		benchmark::DoNotOptimize(result);
+	}
+	processed(state, text);
+}
+
+void bm_std_regex_search(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<char>(kind, state.range(0));
+	std::regex re(log_pattern);
+	for (auto _ : state)
+	{
+		size_t size = 0;
+		for (auto it = std::cregex_iterator(text.data(), text.data() + text.size(), re); it != std::cregex_iterator(); ++ it)
+			size += it->length(2);
+		benchmark::DoNotOptimize(size);
+	}
+	processed(state, text);
+}
+
+#if BETTER_BENCH_FMT
+void bm_fmt_format(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<char>(kind, state.range(0));
+	auto pattern = format_template(text);
+	for (auto _ : state)
+		benchmark::DoNotOptimize(fmt::format(fmt::runtime(pattern), -42, 42U, 0xBE77E7));
+	processed(state, text);
+}
+#endif
+
+#if __cpp_lib_format
+void bm_std_format(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<char>(kind, state.range(0));
+	auto pattern = format_template(text);
+	for (auto _ : state)
+		benchmark::DoNotOptimize(std::vformat(pattern, std::make_format_args(-42, 42U, 0xBE77E7)));
+	processed(state, text);
+}
+#endif
+
+//	------------------------------------------------------------
+//		Registration
+//	------------------------------------------------------------
+
+// Input sizes in bytes: short, medium and large
+static const int64_t sizes[] = {16, 1 << 10, 64 << 20};
+
+template<typename Char>
+void bm_std_string_view_span(benchmark::State & state, Kind kind)
+{
+	const auto & text = cached<Char>(kind, state.range(0));
+	const auto seps = literal<Char>(" ,.;:\n");
+	std::basic_string_view<Char> str(text.data(), text.size()), set(seps.data(), seps.size());
+	for (auto _ : state)
+	{
+		// Count the words, skipping the runs of separators (the characters are code units)
+		size_t count = 0;
+		for (size_t pos = str.find_first_not_of(set); pos < str.size(); pos = str.find_first_not_of(set, pos))
+		{
+			pos = std::min(str.find_first_of(set, pos), str.size());
+			++ count;
+		}
+		benchmark::DoNotOptimize(count);
+	}
+	processed(state, text);
+}
+
+// Corpus sets
+static const std::vector<Kind> prose = {Kind::Ascii, Kind::Mixed, Kind::Wide};
+static const std::vector<Kind> realistic = {Kind::Ascii, Kind::Mixed, Kind::Wide, Kind::Log, Kind::Csv, Kind::Json};
+static const std::vector<Kind> malformed = {Kind::Malformed};
+
+// Register a benchmark for every corpus and size
+template<typename Function>
+void add(const char * name, const char * type, Function function, const std::vector<Kind> & kinds = prose)
+{
+	for (Kind kind : kinds)
+	{
+		std::string full = std::string(name) + "<" + type + ">/" + corpus::kind_name(kind);
+		auto * bench = benchmark::RegisterBenchmark(full.c_str(), function, kind);
+		for (int64_t size : sizes)
+			bench->Arg(size);
+	}
+}
+
+// Register the benchmarks for a character type
+template<typename Char>
+void add_all()
+{
+	const char * type = char_name<Char>();
+
+	// Better string
+	add("length", type, bm_length<Char>);
+	add("codepoints", type, bm_codepoints<Char>);
+	add("center", type, bm_center<Char>);
+	add("ljust", type, bm_ljust<Char>);
+	add("rjust", type, bm_rjust<Char>);
+	add("zfill", type, bm_zfill<Char>);
+	add("find", type, bm_find<Char>);
+	add("rfind", type, bm_rfind<Char>);
+	add("index", type, bm_index<Char>);
+	add("rindex", type, bm_rindex<Char>);
+	add("count", type, bm_count<Char>);
+	add("finditer", type, bm_finditer<Char>);
+	add("find_all", type, bm_find_all<Char>);
+	add("levenshtein", type, bm_levenshtein<Char>);
+	add("damerau", type, bm_damerau<Char>);
+	add("fuzzy_find", type, bm_fuzzy_find<Char>);
+	add("span", type, bm_span<Char>, realistic);
+	add("replace", type, bm_replace<Char>, realistic);
+	add("translate", type, bm_translate<Char>);
+	add("expandtabs", type, bm_expandtabs<Char>);
+	add("join", type, bm_join<Char>);
+	add("split_whitespace", type, bm_split_whitespace<Char>, realistic);
+	add("split", type, bm_split<Char>, realistic);
+	add("split_any", type, bm_split_any<Char>, realistic);
+	add("rsplit_whitespace", type, bm_rsplit_whitespace<Char>);
+	add("rsplit", type, bm_rsplit<Char>);
+	add("startswith", type, bm_startswith<Char>);
+	add("endswith", type, bm_endswith<Char>);
+	add("removeprefix", type, bm_removeprefix<Char>);
+	add("removesuffix", type, bm_removesuffix<Char>);
+	add("isascii", type, bm_isascii<Char>);
+	add("upper", type, bm_upper<Char>);
+	add("lower", type, bm_lower<Char>);
+	add("transcode", type, bm_transcode<Char>, realistic);
+	add("transcode_replace", type, bm_transcode_errors<Char, better_string<Char>::errors::Replace>, malformed);
+	add("transcode_ignore", type, bm_transcode_errors<Char, better_string<Char>::errors::Ignore>, malformed);
+	add("format", type, bm_format<Char>, realistic);
+	add("truncate", type, bm_truncate<Char>);
+	add("repr", type, bm_repr<Char>);
+	add("ascii", type, bm_ascii<Char>);
+	add("html_escape", type, bm_html_escape<Char>, realistic);
+	add("html_unescape", type, bm_html_unescape<Char>, realistic);
+
+	// Baselines
+	add("baseline/std::string::find", type, bm_std_string_find<Char>);
+	add("baseline/std::string_view::find", type, bm_std_string_view_find<Char>);
+	add("baseline/std::string::rfind", type, bm_std_string_rfind<Char>);
+	add("baseline/std::string::count", type, bm_std_string_count<Char>);
+	add("baseline/std::string::replace", type, bm_std_string_replace<Char>, realistic);
+	add("baseline/std::string::split", type, bm_std_string_split<Char>, realistic);
+	add("baseline/std::string_view::find_first_of", type, bm_std_string_view_span<Char>, realistic);
+}
+
+int main(int argc, char ** argv)
+{
+	// Parse and remove our own arguments
+	int count = 1;
+	for (int i = 1; i < argc; ++ i)
+	{
+		if (std::char_traits<char>::compare(argv[i], "--corpus_seed=", 14) == 0)
+			seed = strtoull(argv[i] + 14, nullptr, 0);
+		else
+			argv[count ++] = argv[i];
+	}
+	argc = count;
+
+	add_all<char>();
+	add_all<char16_t>();
+	add_all<char32_t>();
+	add("b64encode", "char", bm_b64encode);
+	add("b64decode", "char", bm_b64decode);
+	add("hexlify", "char", bm_hexlify);
+	add("unhexlify", "char", bm_unhexlify);
+	add("percent_encode", "char", bm_percent_encode);
+	add("percent_decode", "char", bm_percent_decode);
+	add("query_pairs", "char", bm_query_pairs);
+	add("shlex_split", "char", bm_shlex_split, {Kind::Ascii, Kind::Log});
+	add("csv_reader", "char", bm_csv_reader, {Kind::Csv, Kind::Log});
+	add("regex_search", "char", bm_regex_search, {Kind::Ascii, Kind::Log});
+	add("regex_sub", "char", bm_regex_sub, {Kind::Log});
+	add("glob_match", "char", bm_glob_match, {Kind::Log});
+	add("glob_set", "char", bm_glob_set, {Kind::Log});
+	add("ngram_search", "char", bm_ngram_search, {Kind::Log});
+	add("suffix_count", "char", bm_suffix_count, {Kind::Ascii, Kind::Log});
+	add("baseline/std::regex_search", "char", bm_std_regex_search, {Kind::Ascii, Kind::Log});
+	add("baseline/linear_search", "char", bm_linear_search, {Kind::Log});
+
+#if BETTER_BENCH_FMT
+	add("baseline/fmt::format", "char", bm_fmt_format, realistic);
+#endif
+#if __cpp_lib_format
+	add("baseline/std::format", "char", bm_std_format, realistic);
+#endif
+
+	benchmark::AddCustomContext("corpus_seed", std::to_string(seed));
+	benchmark::AddCustomContext("kernels", ext::kernels::active().name);
+	benchmark::Initialize(&argc, argv);
+	if (benchmark::ReportUnrecognizedArguments(argc, argv))
+		return 1;
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+	return 0;
+}
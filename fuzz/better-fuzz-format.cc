@@ -0,0 +1,55 @@
+// Fuzz target - format strings, and the format specification mini-language
+
+#include "better-fuzz.hh"
+
+// Formats the input with one argument of each type (errors in the format string are reported as exceptions)
+template<typename Char>
+void format(const std::vector<Char> & text)
+{
+	ext::better_string_view<Char> view(text.data(), text.size());
+	ext::better_string<Char> string(view);
+	try
+	{
+		view.format(int64_t(-42), uint64_t(255), true, "text", string, int32_t(7));
+	}
+	catch (const std::logic_error &)
+	{
+	}
+}
+
+// Reference - a format string without replacement fields formats to itself (with the braces unescaped)
+auto literal(const std::vector<char> & text, std::string & expected) -> bool
+{
+	for (size_t i = 0; i < text.size(); ++ i)
+	{
+		if (text[i] == '{' || text[i] == '}')
+		{
+			if (i + 1 == text.size() || text[i + 1] != text[i])
+				return false;
+			++ i;
+		}
+		expected += text[i];
+	}
+	return true;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t * data, size_t size)
+{
+	// The input as a format string
+	auto text = fuzz::units<char>(data, size);
+	format(text);
+	format(fuzz::units<char16_t>(data, size));
+	format(fuzz::units<char32_t>(data, size));
+
+	std::string expected;
+	if (literal(text, expected))
+		FUZZ_CHECK(ext::better_string_view<char>(text.data(), text.size()).format() == expected);
+
+	// The input as a format specification of each argument
+	for (size_t index = 0; index < 6; ++ index)
+	{
+		std::string field = "{" + std::to_string(index) + ":" + std::string(text.begin(), text.end()) + "}";
+		format(std::vector<char>(field.begin(), field.end()));
+	}
+	return 0;
+}
@@ -0,0 +1,138 @@
+// Standalone driver for the fuzz targets, for compilers without libFuzzer
+//
+// Runs the target on every file given on the command line (directories are read recursively), then on random mutations
+// of them. The mutations are not coverage guided, but they are reproducible: a failing input is written to the
+// current directory before the target is called.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t * data, size_t size);
+
+// Random number generator (SplitMix64)
+static uint64_t state = 0xF022;
+static auto random(uint64_t n) -> size_t
+{
+	uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return size_t((z ^ (z >> 31)) % n);
+}
+
+// Calls the target with a copy of the input, allocated with the exact size (so the sanitizers catch reads past the end)
+static void run(const std::vector<uint8_t> & input)
+{
+	std::vector<uint8_t> copy(input);
+	LLVMFuzzerTestOneInput(copy.empty() ? nullptr : copy.data(), copy.size());
+}
+
+// Mutates an input: flips, inserts, erases, duplicates or splices bytes (UTF-8 boundaries are interesting, so the
+// inserted bytes are biased towards them)
+static auto mutate(std::vector<uint8_t> input, const std::vector<std::vector<uint8_t>> & corpus) -> std::vector<uint8_t>
+{
+	static const uint8_t special[] = {0x00, 0x7F, 0x80, 0xBF, 0xC0, 0xC2, 0xDF, 0xE0, 0xED, 0xEF, 0xF0, 0xF4, 0xF5, 0xFF,
+		'{', '}', ':', '!', '<', '>', '^', '=', '#', '0', ',', '.', 'x', 'c', 'r', 'a', 's', 'd'};
+
+	for (size_t n = 1 + random(4); n > 0; -- n)
+	{
+		size_t pos = input.empty() ? 0 : random(input.size());
+		switch (random(6))
+		{
+			case 0:
+				if (!input.empty())
+					input[pos] ^= uint8_t(1 << random(8));
+				break;
+			case 1:
+				input.insert(input.begin() + pos, special[random(sizeof(special))]);
+				break;
+			case 2:
+				input.insert(input.begin() + pos, uint8_t(random(256)));
+				break;
+			case 3:
+				if (!input.empty())
+					input.erase(input.begin() + pos, input.begin() + std::min(input.size(), pos + 1 + random(8)));
+				break;
+			case 4:
+				if (!input.empty())
+				{
+					std::vector<uint8_t> part(input.begin() + pos, input.begin() + std::min(input.size(), pos + 1 + random(16)));
+					input.insert(input.begin() + random(input.size()), part.begin(), part.end());
+				}
+				break;
+			default:
+			{
+				auto & other = corpus[random(corpus.size())];
+				if (!other.empty())
+				{
+					size_t from = random(other.size());
+					input.insert(input.begin() + pos, other.begin() + from, other.begin() + std::min(other.size(), from + 1 + random(32)));
+				}
+				break;
+			}
+		}
+	}
+	return input;
+}
+
+int main(int argc, char ** argv)
+{
+	// Parse arguments
+	size_t mutations = 0;
+	std::vector<std::vector<uint8_t>> corpus;
+	for (int i = 1; i < argc; ++ i)
+	{
+		if (strncmp(argv[i], "--mutations=", 12) == 0)
+			{mutations = strtoull(argv[i] + 12, nullptr, 0); continue;}
+		if (strncmp(argv[i], "--seed=", 7) == 0)
+			{state = strtoull(argv[i] + 7, nullptr, 0); continue;}
+
+		// Read the corpus
+		std::vector<std::filesystem::path> files;
+		if (std::filesystem::is_directory(argv[i]))
+		{
+			for (auto & entry : std::filesystem::recursive_directory_iterator(argv[i]))
+				if (entry.is_regular_file())
+					files.push_back(entry.path());
+		}
+		else
+			files.push_back(argv[i]);
+		for (auto & path : files)
+		{
+			std::ifstream file(path, std::ios::binary);
+			corpus.emplace_back(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		}
+	}
+
+	// Replay the corpus
+	corpus.emplace_back();
+	for (auto & input : corpus)
+		run(input);
+	printf("Replayed %zu inputs\n", corpus.size());
+
+	// Run random mutations (the current input is saved, so a crash can be reproduced)
+	for (size_t i = 0; i < mutations; ++ i)
+	{
+		auto input = mutate(corpus[random(corpus.size())], corpus);
+		{
+			std::ofstream file("better-fuzz-crash", std::ios::binary | std::ios::trunc);
+			file.write(reinterpret_cast<const char *>(input.data()), input.size());
+		}
+		run(input);
+		if (input.size() < 4096)
+			corpus.push_back(std::move(input));
+	}
+	if (mutations)
+	{
+		std::filesystem::remove("better-fuzz-crash");
+		printf("Ran %zu mutations\n", mutations);
+	}
+	return 0;
+}
@@ -0,0 +1,82 @@
+// Fuzz target - regex patterns, and the DFA searches (compared with the simulation of the NFA)
+
+#include "better-fuzz.hh"
+#include "better-regex.hh"
+
+#include <memory>
+
+// Checks the searches of a pattern in a text (the first line of the input is the pattern, the rest is the text)
+void searches(const std::vector<char> & pattern, const std::vector<char> & text, uint32_t flags)
+{
+	using namespace ext;
+	using view = better_string_view<char>;
+
+	// Invalid patterns are reported as exceptions
+	view source(pattern.data(), pattern.size());
+	std::unique_ptr<regex> re;
+	try
+	{
+		re.reset(new regex(source, flags));
+	}
+	catch (const std::invalid_argument &)
+	{
+		return;
+	}
+
+	// Reference: the NFA of the same pattern, with the captures of every thread
+	bool utf8 = !(flags & regex::Bytes);
+	impl::RegexParser parser(pattern.data(), pattern.size(), utf8);
+	auto node = parser.parse(flags & regex::IgnoreCase, flags & regex::Multiline, flags & regex::DotAll);
+	impl::RegexProgram program;
+	impl::RegexCompiler(program, utf8, false).compile(node, parser.groups);
+	if (program.code.size() > 4000)
+		return;
+	impl::RegexVm vm;
+
+	// The first match from every position (with its groups)
+	auto data = reinterpret_cast<const uint8_t *>(text.data());
+	view input(text.data(), text.size());
+	for (size_t pos = 0; pos <= text.size(); pos += 1 + pos / 16)
+	{
+		std::vector<size_t> slots;
+		bool expected = vm.run(program, data, text.size(), pos, text.size(), program.loop, slots);
+		auto found = re->search(input, pos);
+		FUZZ_CHECK(bool(found) == expected);
+		for (size_t k = 0; found && k < slots.size() / 2; ++ k)
+			FUZZ_CHECK(found.start(k) == slots[2 * k] && found.end(k) == slots[2 * k + 1]);
+
+		// Anchored matches
+		expected = vm.run(program, data, text.size(), pos, text.size(), program.start, slots);
+		found = re->match(input, pos);
+		FUZZ_CHECK(bool(found) == expected);
+		FUZZ_CHECK(!found || found.end() == slots[1]);
+	}
+
+	// The matches do not overlap, and the text between them is kept by the substitution and the split
+	size_t last = 0, count = 0;
+	for (auto & found : re->finditer(input))
+	{
+		FUZZ_CHECK(found.start() >= last && found.end() >= found.start());
+		last = found.end();
+		++ count;
+	}
+	FUZZ_CHECK(re->sub("\\g<0>", input) == input);
+	auto parts = re->split(input);
+	FUZZ_CHECK(parts.size() == count * (1 + re->groups()) + 1);
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t * data, size_t size)
+{
+	auto input = fuzz::units<char>(data, size);
+	auto line = std::find(input.begin(), input.end(), '\n');
+	std::vector<char> pattern(input.begin(), line);
+	std::vector<char> text(line + (line != input.end()), input.end());
+	if (pattern.size() > 64 || text.size() > 1024)
+		return 0;
+
+	// The flags are selected by the length of the text
+	static const uint32_t flags[] = {0, ext::regex::IgnoreCase | ext::regex::Multiline, ext::regex::DotAll, ext::regex::Bytes};
+	searches(pattern, text, flags[text.size() % 4]);
+	searches(pattern, text, ext::regex::Bytes);
+	return 0;
+}
@@ -0,0 +1,19 @@
+// Fuzz target - UTF-32 decoder, and transcoding from UTF-32 (the input is read in native byte order)
+
+#include "better-fuzz.hh"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t * data, size_t size)
+{
+	auto text = fuzz::units<char32_t>(data, size);
+
+	// Reference
+	std::vector<int32_t> codepoints;
+	bool valid = fuzz::reference::decode(text.data(), text.size(), codepoints);
+
+	// Library
+	fuzz::check_iterators(text.data(), text.size(), valid, codepoints);
+	fuzz::check_transcode<char32_t, char>(text.data(), text.size(), valid, codepoints);
+	fuzz::check_transcode<char32_t, char16_t>(text.data(), text.size(), valid, codepoints);
+	fuzz::check_functions(text.data(), text.size());
+	return 0;
+}
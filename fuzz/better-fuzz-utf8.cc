@@ -0,0 +1,20 @@
+// Fuzz target - UTF-8 decoder, transcoding from UTF-8, and the string kernels
+
+#include "better-fuzz.hh"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t * data, size_t size)
+{
+	auto text = fuzz::units<char>(data, size);
+
+	// Reference
+	std::vector<int32_t> codepoints;
+	bool valid = fuzz::reference::decode(text.data(), text.size(), codepoints);
+
+	// Library
+	fuzz::check_kernels(text.data(), text.size(), valid, codepoints);
+	fuzz::check_iterators(text.data(), text.size(), valid, codepoints);
+	fuzz::check_transcode<char, char16_t>(text.data(), text.size(), valid, codepoints);
+	fuzz::check_transcode<char, char32_t>(text.data(), text.size(), valid, codepoints);
+	fuzz::check_functions(text.data(), text.size());
+	return 0;
+}
@@ -0,0 +1,464 @@
+#pragma once
+
+#include "better-string.hh"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+/************************************************************
+ * @brief Fuzzing helpers
+ *
+ * Every fuzz target compares the library (the iterators, the string kernels of each instruction set, and the string
+ * functions using them) against the slow reference implementations in this header. The references are written for
+ * clarity, directly from the Unicode definitions, and share no code with the library.
+ */
+namespace fuzz {
+
+// Aborts with a message, when the condition is false (libFuzzer reports the input)
+#define FUZZ_CHECK(c) ::fuzz::check(c, #c, __FILE__, __LINE__)
+
+inline void check(bool condition, const char * message, const char * file, long line)
+{
+	if (!condition)
+	{
+		fprintf(stderr, "Check Failed: %s\nFile: %s, Line: %ld\n", message, file, line);
+		abort();
+	}
+}
+
+// Copies the input into a buffer of exactly the right size (so the sanitizers catch reads past the end)
+template<typename Char>
+auto units(const uint8_t * data, size_t size) -> std::vector<Char>
+{
+	std::vector<Char> result(size / sizeof(Char));
+	if (!result.empty())
+		memcpy(result.data(), data, result.size() * sizeof(Char));
+	return result;
+}
+
+// -------------------- Reference decoders --------------------
+
+namespace reference {
+
+/// Decodes UTF-8. Returns false for invalid input (the codepoints are only complete for valid input).
+inline auto decode(const char * data, size_t size, std::vector<int32_t> & codepoints) -> bool
+{
+	for (size_t i = 0; i < size;)
+	{
+		uint32_t lead = uint8_t(data[i]);
+		size_t length = lead < 0x80 ? 1 : lead < 0xC0 ? 0 : lead < 0xE0 ? 2 : lead < 0xF0 ? 3 : lead < 0xF8 ? 4 : 0;
+		if (length == 0 || size - i < length)
+			return false;
+
+		// Collect the bits
+		uint32_t cp = length == 1 ? lead : lead & (0x7F >> length);
+		for (size_t k = 1; k < length; ++ k)
+		{
+			uint32_t ch = uint8_t(data[i + k]);
+			if ((ch & 0xC0) != 0x80)
+				return false;
+			cp = (cp << 6) | (ch & 0x3F);
+		}
+
+		// Reject overlong forms, surrogates, and values above U+10FFFF
+		static const uint32_t minimum[] = {0, 0, 0x80, 0x800, 0x10000};
+		if (cp < minimum[length] || (cp >= 0xD800 && cp <= 0xDFFF) || cp > 0x10FFFF)
+			return false;
+
+		codepoints.push_back(int32_t(cp));
+		i += length;
+	}
+	return true;
+}
+
+/// Decodes UTF-16. Returns false for invalid input (unpaired surrogates).
+inline auto decode(const char16_t * data, size_t size, std::vector<int32_t> & codepoints) -> bool
+{
+	for (size_t i = 0; i < size; ++ i)
+	{
+		uint32_t ch = data[i];
+		if (ch >= 0xD800 && ch <= 0xDBFF)
+		{
+			if (i + 1 == size || data[i + 1] < 0xDC00 || data[i + 1] > 0xDFFF)
+				return false;
+			ch = 0x10000 + ((ch - 0xD800) << 10) + (data[++ i] - 0xDC00);
+		}
+		else if (ch >= 0xDC00 && ch <= 0xDFFF)
+			return false;
+		codepoints.push_back(int32_t(ch));
+	}
+	return true;
+}
+
+/// Decodes UTF-32. Returns false for invalid input (surrogates, and values above U+10FFFF).
+inline auto decode(const char32_t * data, size_t size, std::vector<int32_t> & codepoints) -> bool
+{
+	for (size_t i = 0; i < size; ++ i)
+	{
+		uint32_t ch = data[i];
+		if ((ch >= 0xD800 && ch <= 0xDFFF) || ch > 0x10FFFF)
+			return false;
+		codepoints.push_back(int32_t(ch));
+	}
+	return true;
+}
+
+// -------------------- Reference encoders --------------------
+
+/// Encodes codepoints as UTF-8.
+inline void encode(const std::vector<int32_t> & codepoints, std::basic_string<char> & out)
+{
+	for (uint32_t cp : codepoints)
+	{
+		if (cp < 0x80)
+			out += char(cp);
+		else if (cp < 0x800)
+			out += {char(0xC0 | (cp >> 6)), char(0x80 | (cp & 0x3F))};
+		else if (cp < 0x10000)
+			out += {char(0xE0 | (cp >> 12)), char(0x80 | ((cp >> 6) & 0x3F)), char(0x80 | (cp & 0x3F))};
+		else
+			out += {char(0xF0 | (cp >> 18)), char(0x80 | ((cp >> 12) & 0x3F)), char(0x80 | ((cp >> 6) & 0x3F)), char(0x80 | (cp & 0x3F))};
+	}
+}
+
+/// Encodes codepoints as UTF-16.
+inline void encode(const std::vector<int32_t> & codepoints, std::basic_string<char16_t> & out)
+{
+	for (uint32_t cp : codepoints)
+	{
+		if (cp < 0x10000)
+			out += char16_t(cp);
+		else
+			out += {char16_t(0xD800 + ((cp - 0x10000) >> 10)), char16_t(0xDC00 + ((cp - 0x10000) & 0x3FF))};
+	}
+}
+
+/// Encodes codepoints as UTF-32.
+inline void encode(const std::vector<int32_t> & codepoints, std::basic_string<char32_t> & out)
+{
+	for (uint32_t cp : codepoints)
+		out += char32_t(cp);
+}
+
+// Close namespace "reference"
+}
+
+// -------------------- Checks --------------------
+
+// Encoding of a character type
+template<typename Char>
+struct unicode;
+template<> struct unicode<char> {static constexpr auto value = ext::Encoding::UTF8;};
+template<> struct unicode<char16_t> {static constexpr auto value = ext::Encoding::UTF16;};
+template<> struct unicode<char32_t> {static constexpr auto value = ext::Encoding::UTF32;};
+
+/**
+ * @brief Checks the iterators against the reference decoder.
+ *
+ * The iterators must stay in the bounds of the string, move forward on every step, and agree with the reference on
+ * valid text (in both directions).
+ */
+template<typename Char>
+void check_iterators(const Char * data, size_t size, bool valid, const std::vector<int32_t> & codepoints)
+{
+	using Traits = ext::encoding_traits<unicode<Char>::value>;
+
+	// Forward
+	std::vector<int32_t> forward;
+	auto iter = Traits::iter(data, data, data + size);
+	auto done = Traits::iter(data + size, data, data + size);
+	for (; iter != done; ++ iter)
+	{
+		auto prev = static_cast<const Char *>(iter);
+		forward.push_back(*iter);
+		FUZZ_CHECK(static_cast<const Char *>(++ decltype(iter)(iter)) > prev);
+	}
+	FUZZ_CHECK(static_cast<const Char *>(iter) == data + size);
+	FUZZ_CHECK(ext::better_string_view<Char>(data, size).template length<unicode<Char>::value>() == forward.size());
+	if (!valid)
+		return;
+	FUZZ_CHECK(forward == codepoints);
+
+	// Backward
+	std::vector<int32_t> backward;
+	auto first = Traits::iter(data, data, data + size);
+	for (auto back = Traits::iter(data + size, data, data + size); first != back;)
+		backward.push_back(* -- back);
+	std::reverse(backward.begin(), backward.end());
+	FUZZ_CHECK(backward == codepoints);
+}
+
+/**
+ * @brief Checks transcoding into an other encoding, against the reference encoder (valid text), or against the
+ * iterators (invalid text, with the error handlers).
+ */
+template<typename From, typename To>
+void check_transcode(const From * data, size_t size, bool valid, const std::vector<int32_t> & codepoints)
+{
+	using Errors = ext::impl::Errors;
+	constexpr auto E = unicode<From>::value;
+	constexpr auto F = unicode<To>::value;
+	ext::better_string_view<From> view(data, size);
+
+	// Strict
+	if (valid)
+	{
+		std::basic_string<To> expected;
+		reference::encode(codepoints, expected);
+		auto result = view.template transcode<E, F, To>(Errors::Strict);
+		FUZZ_CHECK(result == expected);
+
+		// Round trip
+		auto back = ext::better_string_view<To>(result).template transcode<F, E, From>(Errors::Strict);
+		FUZZ_CHECK(back == view);
+	}
+	else
+	{
+		bool thrown = false;
+		try {view.template transcode<E, F, To>(Errors::Strict);}
+		catch (const std::invalid_argument &) {thrown = true;}
+		FUZZ_CHECK(thrown);
+	}
+
+	// Replace and ignore (one codepoint at a time, without the fast paths)
+	using Traits = ext::encoding_traits<E>;
+	std::basic_string<To> replaced, ignored;
+	auto done = Traits::iter(data + size, data, data + size);
+	for (auto iter = Traits::iter(data, data, data + size); iter != done; ++ iter)
+	{
+		int32_t cp = *iter;
+		std::basic_string<To> encoded;
+		if (cp >= 0 && ext::encoding_traits<F>::append(encoded, cp))
+			{replaced += encoded; ignored += encoded;}
+		else
+			ext::encoding_traits<F>::append(replaced, ext::encoding_traits<F>::replacement);
+	}
+	FUZZ_CHECK((view.template transcode<E, F, To>(Errors::Replace) == replaced));
+	FUZZ_CHECK((view.template transcode<E, F, To>(Errors::Ignore) == ignored));
+}
+
+/**
+ * @brief Checks the string functions using the kernels, against the standard library.
+ */
+template<typename Char>
+void check_functions(const Char * data, size_t size)
+{
+	constexpr auto E = unicode<Char>::value;
+	ext::better_string_view<Char> view(data, size);
+	std::basic_string<Char> copy(data, size);
+
+	// ASCII and case mapping
+	bool ascii = std::all_of(copy.begin(), copy.end(), [] (Char ch) {return uint32_t(ch) < 0x80;});
+	FUZZ_CHECK(view.template isascii<E>() == ascii);
+
+	std::basic_string<Char> upper(copy), lower(copy);
+	for (auto & ch : upper)
+		ch = (ch >= 'a' && ch <= 'z') ? Char(ch - 0x20) : ch;
+	for (auto & ch : lower)
+		ch = (ch >= 'A' && ch <= 'Z') ? Char(ch + 0x20) : ch;
+	FUZZ_CHECK(view.template upper<E>() == upper);
+	FUZZ_CHECK(view.template lower<E>() == lower);
+
+	// Search for a character and a substring from the text, only on valid text (matches must start on a codepoint)
+	std::vector<int32_t> codepoints;
+	if (size == 0 || !reference::decode(data, size, codepoints))
+		return;
+
+	// Quoting round trip
+	auto repr = ext::repr<Char, E>(view);
+	auto ascii_repr = ext::ascii<Char, E>(view);
+	FUZZ_CHECK(repr.template unquote<E>() == copy);
+	FUZZ_CHECK(ascii_repr.template unquote<E>() == copy);
+	FUZZ_CHECK(view.template json_escape<E>().template json_unescape<E>() == copy);
+	FUZZ_CHECK(view.template json_escape<E>(true).template json_unescape<E>() == copy);
+	FUZZ_CHECK(view.html_escape().template html_unescape<E>() == copy);
+
+	std::basic_string<Char> single;
+	reference::encode({codepoints[codepoints.size() / 2]}, single);
+	std::vector<int32_t> part(codepoints.begin() + codepoints.size() / 3,
+		codepoints.begin() + std::min(codepoints.size(), codepoints.size() / 3 + 4));
+	std::basic_string<Char> sub;
+	reference::encode(part, sub);
+
+	for (auto & needle : {single, sub})
+	{
+		FUZZ_CHECK(view.template find<E>(needle) == copy.find(needle));
+
+		// Non-overlapping occurrences
+		std::vector<size_t> found;
+		for (size_t pos = copy.find(needle); pos != copy.npos; pos = copy.find(needle, pos + needle.size()))
+			found.push_back(pos);
+		FUZZ_CHECK(view.template count<E>(needle) == found.size());
+		FUZZ_CHECK(view.template finditer<E>(needle).offsets() == found);
+		FUZZ_CHECK(view.template find_all<E>(needle, false, 4) == found);
+	}
+
+	// Character sets, against the codepoints
+	ext::charset<E> set(sub.data(), sub.size());
+	size_t first_of = size_t(-1), first_not = size_t(-1), offset = 0;
+	for (int32_t cp : codepoints)
+	{
+		bool member = std::find(part.begin(), part.end(), cp) != part.end();
+		if (member && first_of == size_t(-1))
+			first_of = offset;
+		if (!member && first_not == size_t(-1))
+			first_not = offset;
+		std::basic_string<Char> unit;
+		reference::encode({cp}, unit);
+		offset += unit.size();
+	}
+	FUZZ_CHECK(view.find_first_of(set) == first_of);
+	FUZZ_CHECK(view.find_first_not_of(set) == first_not);
+	FUZZ_CHECK(view.template lstrip<E>(sub) == copy.substr(std::min(first_not, size)));
+}
+
+/**
+ * @brief Checks the kernels of every instruction set supported by the processor, against the portable kernels.
+ */
+inline void check_kernels(const char * data, size_t size, bool valid, const std::vector<int32_t> & codepoints)
+{
+	using namespace ext::kernels;
+	auto & scalar = scalar::table();
+
+	// The portable kernels against the reference
+	FUZZ_CHECK(scalar.utf8_length(data, size) == (valid ? codepoints.size() : size_t(-1)));
+
+	// Every instruction set against the portable kernels
+	for (size_t i = 0; i < isa_count; ++ i)
+	{
+		const Table * table = ext::kernels::table(Isa(i));
+		if (!table)
+			continue;
+
+		FUZZ_CHECK(table->utf8_length(data, size) == scalar.utf8_length(data, size));
+		FUZZ_CHECK(table->ascii_prefix(data, size) == scalar.ascii_prefix(data, size));
+		FUZZ_CHECK(table->escape_prefix(data, size, false) == scalar.escape_prefix(data, size, false));
+		FUZZ_CHECK(table->escape_prefix(data, size, true) == scalar.escape_prefix(data, size, true));
+
+		// Search (a byte from the text, and a missing one)
+		char ch = size ? data[size / 2] : 'a';
+		FUZZ_CHECK(table->find_byte(data, size, ch) == scalar.find_byte(data, size, ch));
+		FUZZ_CHECK(table->count_byte(data, size, ch) == scalar.count_byte(data, size, ch));
+		auto set = ByteSet::of([ch] (uint8_t x) {return x < 0x20 || x == uint8_t(ch) || x == '\\';});
+		FUZZ_CHECK(table->find_any(data, size, set) == scalar.find_any(data, size, set));
+		for (size_t length : {1, 2, 3, 8, 33})
+		{
+			const char * sub = data + size / 3;
+			if (size / 3 + length > size)
+				break;
+			FUZZ_CHECK(table->find(data, size, sub, length) == scalar.find(data, size, sub, length));
+		}
+
+		// Transcoding and case mapping
+		std::vector<char16_t> wide16(size), expected16(size);
+		std::vector<char32_t> wide32(size), expected32(size);
+		table->widen16(data, size, wide16.data());
+		scalar.widen16(data, size, expected16.data());
+		table->widen32(data, size, wide32.data());
+		scalar.widen32(data, size, expected32.data());
+		FUZZ_CHECK(wide16 == expected16 && wide32 == expected32);
+
+		std::vector<char> out(size), expected(size);
+		table->upper(data, size, out.data());
+		scalar.upper(data, size, expected.data());
+		FUZZ_CHECK(out == expected);
+		table->lower(data, size, out.data());
+		scalar.lower(data, size, expected.data());
+		FUZZ_CHECK(out == expected);
+
+		// Base64 and hex (the input is decoded as text too, the results must match, even when it is invalid)
+		for (bool url : {false, true})
+		{
+			std::vector<char> text(size / 3 * 4), expected_text(size / 3 * 4);
+			table->b64encode(data, size, text.data(), url);
+			scalar.b64encode(data, size, expected_text.data(), url);
+			FUZZ_CHECK(text == expected_text);
+
+			std::vector<char> bytes(size / 4 * 3), expected_bytes(size / 4 * 3);
+			size_t length = table->b64decode(data, size, bytes.data(), url);
+			FUZZ_CHECK(length == scalar.b64decode(data, size, expected_bytes.data(), url));
+			FUZZ_CHECK(length == size_t(-1) || bytes == expected_bytes);
+		}
+		std::vector<char> hex(2 * size), expected_hex(2 * size), bytes(size / 2), expected_bytes(size / 2);
+		table->hexlify(data, size, hex.data());
+		scalar.hexlify(data, size, expected_hex.data());
+		FUZZ_CHECK(hex == expected_hex);
+		size_t length = table->unhexlify(data, size, bytes.data());
+		FUZZ_CHECK(length == scalar.unhexlify(data, size, expected_bytes.data()));
+		FUZZ_CHECK(length == size_t(-1) || bytes == expected_bytes);
+
+		// CSV structure (the state at the start is taken from the first byte)
+		ext::kernels::CsvState state {size && (data[0] & 1), size && (data[0] & 2)}, expected_state = state;
+		std::vector<uint32_t> positions(size), expected_positions(size);
+		size_t count = table->csv_index(data, size, ',', '"', state, positions.data());
+		FUZZ_CHECK(count == scalar.csv_index(data, size, ',', '"', expected_state, expected_positions.data()));
+		FUZZ_CHECK(state.quoted == expected_state.quoted && state.open == expected_state.open);
+		FUZZ_CHECK(std::equal(positions.begin(), positions.begin() + count, expected_positions.begin()));
+	}
+
+	// Base64 and hex round trips
+	ext::better_string_view<char> view(data, size);
+	FUZZ_CHECK(view.b64encode().b64decode() == view);
+	FUZZ_CHECK(view.b64encode(true).b64decode(true) == view);
+	FUZZ_CHECK(view.hexlify().unhexlify() == view);
+
+	// Percent encoding round trips, and query strings (every pair is in a part between the separators)
+	FUZZ_CHECK(view.percent_encode().percent_decode() == view);
+	FUZZ_CHECK(view.percent_encode(ext::url::path, true).percent_decode(true) == view);
+	size_t pairs = 0;
+	for (auto & pair : view.query_pairs(ext::better_string_view<char>::errors::Ignore))
+		pairs += (pair.key.size() + pair.value.size() <= size);
+	FUZZ_CHECK(pairs <= view.count("&") + 1);
+
+	// HTML references (arbitrary input is never longer after decoding, the references are longer than their text)
+	FUZZ_CHECK(view.html_unescape().size() <= size);
+
+	// Shell-like tokens (quoting the tokens again, with single quotes, gives the same tokens)
+	try
+	{
+		std::vector<std::string> tokens, again;
+		std::string quoted;
+		for (auto & token : view.shlex_split())
+		{
+			tokens.push_back(std::string(token));
+			quoted += "'";
+			for (char ch : tokens.back())
+				quoted += (ch == '\'') ? std::string("'\"'\"'") : std::string(1, ch);
+			quoted += "' ";
+		}
+		for (auto & token : ext::better_string_view<char>(quoted).shlex_split())
+			again.push_back(std::string(token));
+		FUZZ_CHECK(tokens == again);
+	}
+	catch (const std::invalid_argument &) {}
+
+	// CSV records, read at once and in two chunks (cut at the first byte's value)
+	using errors = ext::better_string_view<char>::errors;
+	std::vector<std::string> whole, chunked;
+	ext::csv_reader<char> reader(view, ',', '"', errors::Ignore);
+	for (auto & record : reader)
+		for (auto & field : record)
+			whole.push_back(std::string(field));
+	size_t cut = size ? uint8_t(data[0]) % (size + 1) : 0;
+	ext::csv_reader<char> chunks(',', '"', errors::Ignore);
+	chunks.feed(ext::better_string_view<char>(data, cut));
+	for (auto & record : chunks)
+		for (auto & field : record)
+			chunked.push_back(std::string(field));
+	chunks.feed(ext::better_string_view<char>(data + cut, size - cut));
+	chunks.finish();
+	for (auto & record : chunks)
+		for (auto & field : record)
+			chunked.push_back(std::string(field));
+	FUZZ_CHECK(whole == chunked);
+}
+
+// Close namespace "fuzz"
+}
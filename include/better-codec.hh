@@ -0,0 +1,1012 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "better-string.hh"
+#include "better-codepages.hh"
+
+// Namespace for std extensions
+namespace ext {
+
+// Namespace for codecs
+namespace codec {
+
+/**
+ * @name Codec registry
+ *
+ * The encodings of @ref better_string are template parameters, so they have to be known at compile time. The codec
+ * registry maps charset names (as found in HTTP headers and MIME parts) and @ref Encoding values to codecs at runtime.
+ *
+ * A codec converts a whole buffer between its encoding and UTF-8, so the codec is selected once for each buffer, and
+ * not for each character. The built-in codecs are UTF-8, UTF-16, UTF-32 (with and without byte order), US-ASCII, the
+ * Windows and ISO-8859 codepages of @ref Encoding, and `unicode-escape` (the escape sequences of @ref repr()).
+ * Applications can add their own codecs (or replace the built-in ones) with @ref add().
+ *
+ * Lookups do not lock: the registry is an immutable list, which is replaced (under a mutex) when a codec is added. The
+ * replaced lists are kept until the end of the program, because other threads might still be reading them.
+ *
+ * Names are matched without case and punctuation, so `UTF-8`, `utf8` and `"Utf_8"` are the same codec.
+ */
+
+/// @{
+
+// Error handling modes (the same as for transcoding)
+using Errors = impl::Errors;
+
+/************************************************************
+ * @brief Type erased codec, converting whole buffers between an encoding and UTF-8.
+ *
+ * The conversion functions append to the output, and handle invalid input according to the error mode (in strict
+ * mode they throw `std::invalid_argument`).
+ */
+struct Codec
+{
+	/// Preferred name of the codec (usually the IANA name).
+	const char * name;
+	/// Encoding of the codec, or `Encoding::Unknown` when it does not have an @ref Encoding value.
+	Encoding encoding;
+
+	/// Decodes bytes in the encoding of the codec, and appends the text as UTF-8.
+	void (* decode)(const char * data, size_t size, better_string<char> & output, Errors mode);
+	/// Encodes UTF-8 text, and appends the bytes in the encoding of the codec.
+	void (* encode)(const char * data, size_t size, better_string<char> & output, Errors mode);
+};
+
+// -------------------- Built-in codecs --------------------
+
+// Namespace for implementation details
+namespace impl {
+
+// Handles a decoding error (the replacement character is U+FFFD)
+inline void decode_error(better_string<char> & output, Errors mode)
+{
+	if (mode == Errors::Strict)
+		throw std::invalid_argument("decode(): input: Decoding error!");
+	if (mode == Errors::Replace)
+		encoding_traits<Encoding::UTF8>::append(output, 0xFFFD);
+}
+
+// Handles an encoding error (the replacement is encoded by the codec)
+template<typename Append>
+void encode_error(Errors mode, Append append)
+{
+	if (mode == Errors::Strict)
+		throw std::invalid_argument("encode(): input: Encoding error!");
+	if (mode == Errors::Replace)
+		append();
+}
+
+// Calls a function for every codepoint of UTF-8 text (negative for invalid sequences), ASCII runs are passed as a whole
+template<typename Ascii, typename Function>
+void each_codepoint(const char * data, size_t size, Ascii ascii, Function function)
+{
+	auto end = data + size;
+	auto ptr = data;
+	while (ptr < end)
+	{
+		// Runs of ASCII characters (found with the string kernels)
+		size_t n = kernels::active().ascii_prefix(ptr, end - ptr);
+		if (n)
+		{
+			ascii(ptr, n);
+			ptr += n;
+			continue;
+		}
+
+		// Other characters
+		auto iter = encoding_traits<Encoding::UTF8>::iter(ptr, data, end);
+		function(int32_t(*iter));
+		ptr = static_cast<const char *>(++ iter);
+	}
+}
+
+// Codec - UTF-8
+inline void decode_utf8(const char * data, size_t size, better_string<char> & output, Errors mode)
+{
+	// Valid text is copied (validated with the string kernels)
+	if (kernels::active().utf8_length(data, size) != size_t(-1))
+		return output.extend(data, data + size), void();
+
+	// Invalid text is decoded one sequence at a time
+	output.reserve(output.size() + size);
+	each_codepoint(data, size,
+		[&] (const char * ptr, size_t n) {output.extend(ptr, ptr + n);},
+		[&] (int32_t cp) {if (cp < 0) decode_error(output, mode); else encoding_traits<Encoding::UTF8>::append(output, cp);});
+}
+
+inline void encode_utf8(const char * data, size_t size, better_string<char> & output, Errors mode)
+{
+	// Valid text is copied, invalid text is handled like when decoding
+	if (kernels::active().utf8_length(data, size) != size_t(-1))
+		return output.extend(data, data + size), void();
+
+	output.reserve(output.size() + size);
+	each_codepoint(data, size,
+		[&] (const char * ptr, size_t n) {output.extend(ptr, ptr + n);},
+		[&] (int32_t cp)
+		{
+			if (cp >= 0)
+				encoding_traits<Encoding::UTF8>::append(output, cp);
+			else
+				encode_error(mode, [&] {encoding_traits<Encoding::UTF8>::append(output, 0xFFFD);});
+		});
+}
+
+// Reads and writes code units with a byte order
+template<size_t Size, bool Big>
+auto load_unit(const char * data) -> uint32_t
+{
+	auto bytes = reinterpret_cast<const uint8_t *>(data);
+	uint32_t unit = 0;
+	for (size_t i = 0; i < Size; ++ i)
+		unit |= uint32_t(bytes[i]) << (8 * (Big ? Size - 1 - i : i));
+	return unit;
+}
+
+template<size_t Size, bool Big>
+void store_unit(better_string<char> & output, uint32_t unit)
+{
+	for (size_t i = 0; i < Size; ++ i)
+		output.push_back(char(unit >> (8 * (Big ? Size - 1 - i : i))));
+}
+
+// Codec - UTF-16 (with a byte order)
+template<bool Big>
+void decode_utf16(const char * data, size_t size, better_string<char> & output, Errors mode)
+{
+	output.reserve(output.size() + size / 2);
+	size_t i = 0;
+	for (; i + 2 <= size; i += 2)
+	{
+		uint32_t cp = load_unit<2, Big>(data + i);
+
+		// Surrogate pairs
+		if (cp >= 0xD800 && cp < 0xE000)
+		{
+			uint32_t low = (i + 4 <= size) ? load_unit<2, Big>(data + i + 2) : 0;
+			if (cp >= 0xDC00 || low < 0xDC00 || low >= 0xE000)
+			{
+				decode_error(output, mode);
+				continue;
+			}
+			cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+			i += 2;
+		}
+		encoding_traits<Encoding::UTF8>::append(output, cp);
+	}
+
+	// A truncated code unit
+	if (i < size)
+		decode_error(output, mode);
+}
+
+template<bool Big>
+void encode_utf16(const char * data, size_t size, better_string<char> & output, Errors mode)
+{
+	// Appends a codepoint
+	auto append = [&output] (uint32_t cp)
+	{
+		if (cp >= 0x10000)
+		{
+			store_unit<2, Big>(output, 0xD800 + ((cp - 0x10000) >> 10));
+			store_unit<2, Big>(output, 0xDC00 + ((cp - 0x10000) & 0x3FF));
+		}
+		else
+			store_unit<2, Big>(output, cp);
+	};
+
+	output.reserve(output.size() + size * 2);
+	each_codepoint(data, size,
+		[&] (const char * ptr, size_t n) {for (size_t k = 0; k < n; ++ k) store_unit<2, Big>(output, uint8_t(ptr[k]));},
+		[&] (int32_t cp) {if (cp >= 0) append(cp); else encode_error(mode, [&] {append(0xFFFD);});});
+}
+
+// Codec - UTF-32 (with a byte order)
+template<bool Big>
+void decode_utf32(const char * data, size_t size, better_string<char> & output, Errors mode)
+{
+	output.reserve(output.size() + size / 4);
+	size_t i = 0;
+	for (; i + 4 <= size; i += 4)
+	{
+		uint32_t cp = load_unit<4, Big>(data + i);
+		if (cp >= 0x110000 || (cp >= 0xD800 && cp < 0xE000))
+			decode_error(output, mode);
+		else
+			encoding_traits<Encoding::UTF8>::append(output, cp);
+	}
+
+	// A truncated code unit
+	if (i < size)
+		decode_error(output, mode);
+}
+
+template<bool Big>
+void encode_utf32(const char * data, size_t size, better_string<char> & output, Errors mode)
+{
+	output.reserve(output.size() + size * 4);
+	each_codepoint(data, size,
+		[&] (const char * ptr, size_t n) {for (size_t k = 0; k < n; ++ k) store_unit<4, Big>(output, uint8_t(ptr[k]));},
+		[&] (int32_t cp) {if (cp >= 0) store_unit<4, Big>(output, cp); else encode_error(mode, [&] {store_unit<4, Big>(output, 0xFFFD);});});
+}
+
+// Codec - UTF-16 and UTF-32 (the byte order is given by the byte order mark, little endian by default)
+template<size_t Size>
+void decode_unicode(const char * data, size_t size, better_string<char> & output, Errors mode)
+{
+	bool big = false;
+	if (size >= Size && load_unit<Size, true>(data) == 0xFEFF)
+		{big = true; data += Size; size -= Size;}
+	else if (size >= Size && load_unit<Size, false>(data) == 0xFEFF)
+		{data += Size; size -= Size;}
+
+	if (Size == 2)
+		(big ? decode_utf16<true> : decode_utf16<false>)(data, size, output, mode);
+	else
+		(big ? decode_utf32<true> : decode_utf32<false>)(data, size, output, mode);
+}
+
+template<size_t Size>
+void encode_unicode(const char * data, size_t size, better_string<char> & output, Errors mode)
+{
+	store_unit<Size, false>(output, 0xFEFF);
+	(Size == 2 ? encode_utf16<false> : encode_utf32<false>)(data, size, output, mode);
+}
+
+// Codec - US-ASCII
+inline void decode_ascii(const char * data, size_t size, better_string<char> & output, Errors mode)
+{
+	output.reserve(output.size() + size);
+	for (size_t i = 0; i < size; ++ i)
+	{
+		size_t n = kernels::active().ascii_prefix(data + i, size - i);
+		output.extend(data + i, data + i + n);
+		i += n;
+		if (i < size)
+			decode_error(output, mode);
+	}
+}
+
+inline void encode_ascii(const char * data, size_t size, better_string<char> & output, Errors mode)
+{
+	output.reserve(output.size() + size);
+	each_codepoint(data, size,
+		[&] (const char * ptr, size_t n) {output.extend(ptr, ptr + n);},
+		[&] (int32_t) {encode_error(mode, [&] {output.push_back('?');});});
+}
+
+// Codec - single byte codepages
+template<const char16_t * Table>
+void decode_codepage(const char * data, size_t size, better_string<char> & output, Errors mode)
+{
+	output.reserve(output.size() + size);
+	for (size_t i = 0; i < size; ++ i)
+	{
+		// Copy runs of ASCII characters with the string kernels
+		size_t n = kernels::active().ascii_prefix(data + i, size - i);
+		output.extend(data + i, data + i + n);
+		i += n;
+		if (i == size)
+			break;
+
+		// Map the other bytes
+		uint32_t cp = Table[uint8_t(data[i]) - 0x80];
+		if (cp)
+			encoding_traits<Encoding::UTF8>::append(output, cp);
+		else
+			decode_error(output, mode);
+	}
+}
+
+template<const char16_t * Table>
+void encode_codepage(const char * data, size_t size, better_string<char> & output, Errors mode)
+{
+	// Reverse table, sorted by characters (created once)
+	static const auto reverse = [] ()
+	{
+		std::vector<std::pair<char16_t, uint8_t>> result;
+		for (size_t i = 0; i < 128; ++ i)
+			if (Table[i])
+				result.emplace_back(Table[i], uint8_t(0x80 + i));
+		std::sort(result.begin(), result.end());
+		return result;
+	}();
+
+	output.reserve(output.size() + size);
+	each_codepoint(data, size,
+		[&] (const char * ptr, size_t n) {output.extend(ptr, ptr + n);},
+		[&] (int32_t cp)
+		{
+			auto iter = std::lower_bound(reverse.begin(), reverse.end(), std::make_pair(char16_t(cp), uint8_t(0)));
+			if (cp >= 0 && cp < 0x10000 && iter != reverse.end() && iter->first == cp)
+				output.push_back(char(iter->second));
+			else
+				encode_error(mode, [&] {output.push_back('?');});
+		});
+}
+
+// Codec - unicode-escape (the escape sequences of repr(), with UTF-8 text between them)
+inline void decode_escape(const char * data, size_t size, better_string<char> & output, Errors mode)
+{
+	better_string<char> text;
+	algorithm::string::unescape<better_string_view<char>, std::char_traits<char>, Encoding::UTF8>(better_string_view<char>(data, size), text, mode);
+	decode_utf8(text.data(), text.size(), output, mode);
+}
+
+inline void encode_escape(const char * data, size_t size, better_string<char> & output, Errors mode)
+{
+	better_string<char> text;
+	decode_utf8(data, size, text, mode);
+	auto quoted = ascii(text);
+	output.extend(quoted.data() + 1, quoted.data() + quoted.size() - 1);
+}
+
+// Built-in codec, and its aliases
+struct Builtin
+{
+	Codec codec;
+	std::vector<const char *> aliases;
+};
+
+// Creates a codepage codec
+template<const char16_t * Table>
+auto codepage(const char * name, Encoding encoding, std::vector<const char *> aliases) -> Builtin
+	{return {{name, encoding, decode_codepage<Table>, encode_codepage<Table>}, std::move(aliases)};}
+
+// List of built-in codecs (the names and aliases are from the IANA character set registry)
+inline auto builtins() -> std::vector<Builtin>
+{
+	return {
+		// Unicode
+		{{"UTF-8", Encoding::UTF8, decode_utf8, encode_utf8}, {"csUTF8", "unicode-1-1-utf-8"}},
+		{{"UTF-16", Encoding::UTF16, decode_unicode<2>, encode_unicode<2>}, {"csUTF16"}},
+		{{"UTF-16BE", Encoding::Unknown, decode_utf16<true>, encode_utf16<true>}, {"csUTF16BE"}},
+		{{"UTF-16LE", Encoding::Unknown, decode_utf16<false>, encode_utf16<false>}, {"csUTF16LE"}},
+		{{"UTF-32", Encoding::UTF32, decode_unicode<4>, encode_unicode<4>}, {"csUTF32"}},
+		{{"UTF-32BE", Encoding::Unknown, decode_utf32<true>, encode_utf32<true>}, {"csUTF32BE"}},
+		{{"UTF-32LE", Encoding::Unknown, decode_utf32<false>, encode_utf32<false>}, {"csUTF32LE"}},
+
+		// ASCII
+		{{"US-ASCII", Encoding::Unknown, decode_ascii, encode_ascii},
+			{"ascii", "iso-ir-6", "ANSI_X3.4-1968", "ANSI_X3.4-1986", "ISO_646.irv:1991", "ISO646-US", "us", "IBM367", "cp367", "csASCII"}},
+
+		// Escape sequences (the name of the Python codec)
+		{{"unicode-escape", Encoding::Unknown, decode_escape, encode_escape}, {}},
+
+		// Windows codepages
+		codepage<tables::win1250>("windows-1250", Encoding::Win1250, {"cp1250", "cswindows1250"}),
+		codepage<tables::win1251>("windows-1251", Encoding::Win1251, {"cp1251", "cswindows1251"}),
+		codepage<tables::win1252>("windows-1252", Encoding::Win1252, {"cp1252", "cswindows1252"}),
+		codepage<tables::win1253>("windows-1253", Encoding::Win1253, {"cp1253", "cswindows1253"}),
+		codepage<tables::win1254>("windows-1254", Encoding::Win1254, {"cp1254", "cswindows1254"}),
+		codepage<tables::win1255>("windows-1255", Encoding::Win1255, {"cp1255", "cswindows1255"}),
+		codepage<tables::win1256>("windows-1256", Encoding::Win1256, {"cp1256", "cswindows1256"}),
+		codepage<tables::win1257>("windows-1257", Encoding::Win1257, {"cp1257", "cswindows1257"}),
+		codepage<tables::win1258>("windows-1258", Encoding::Win1258, {"cp1258", "cswindows1258"}),
+
+		// ISO codepages
+		codepage<tables::iso_8859_1>("ISO-8859-1", Encoding::ISO_8859_1,
+			{"ISO_8859-1:1987", "iso-ir-100", "latin1", "l1", "IBM819", "CP819", "csISOLatin1"}),
+		codepage<tables::iso_8859_2>("ISO-8859-2", Encoding::ISO_8859_2, {"ISO_8859-2:1987", "iso-ir-101", "latin2", "l2", "csISOLatin2"}),
+		codepage<tables::iso_8859_3>("ISO-8859-3", Encoding::ISO_8859_3, {"ISO_8859-3:1988", "iso-ir-109", "latin3", "l3", "csISOLatin3"}),
+		codepage<tables::iso_8859_4>("ISO-8859-4", Encoding::ISO_8859_4, {"ISO_8859-4:1988", "iso-ir-110", "latin4", "l4", "csISOLatin4"}),
+		codepage<tables::iso_8859_5>("ISO-8859-5", Encoding::ISO_8859_5, {"ISO_8859-5:1988", "iso-ir-144", "cyrillic", "csISOLatinCyrillic"}),
+		codepage<tables::iso_8859_6>("ISO-8859-6", Encoding::ISO_8859_6,
+			{"ISO_8859-6:1987", "iso-ir-127", "ECMA-114", "ASMO-708", "arabic", "csISOLatinArabic"}),
+		codepage<tables::iso_8859_7>("ISO-8859-7", Encoding::ISO_8859_7,
+			{"ISO_8859-7:1987", "iso-ir-126", "ELOT_928", "ECMA-118", "greek", "greek8", "csISOLatinGreek"}),
+		codepage<tables::iso_8859_8>("ISO-8859-8", Encoding::ISO_8859_8, {"ISO_8859-8:1988", "iso-ir-138", "hebrew", "csISOLatinHebrew"}),
+		codepage<tables::iso_8859_9>("ISO-8859-9", Encoding::ISO_8859_9, {"ISO_8859-9:1989", "iso-ir-148", "latin5", "l5", "csISOLatin5"}),
+		codepage<tables::iso_8859_10>("ISO-8859-10", Encoding::ISO_8859_10, {"ISO_8859-10:1992", "iso-ir-157", "latin6", "l6", "csISOLatin6"}),
+		codepage<tables::iso_8859_11>("ISO-8859-11", Encoding::ISO_8859_11, {}),
+		codepage<tables::iso_8859_13>("ISO-8859-13", Encoding::ISO_8859_13, {"csISO885913"}),
+		codepage<tables::iso_8859_14>("ISO-8859-14", Encoding::ISO_8859_14,
+			{"ISO_8859-14:1998", "iso-ir-199", "latin8", "iso-celtic", "l8", "csISO885914"}),
+		codepage<tables::iso_8859_15>("ISO-8859-15", Encoding::ISO_8859_15, {"Latin-9", "csISO885915"}),
+	};
+}
+
+// -------------------- Registry --------------------
+
+// Longest name that can be looked up (after normalization)
+static constexpr size_t max_name = 64;
+
+// Normalizes a name (lower case letters and digits only), returns the length, or zero if the name is too long
+inline auto normalize(better_string_view<char> name, char (& buffer)[max_name]) -> size_t
+{
+	size_t length = 0;
+	for (char ch : name)
+	{
+		if (ch >= 'A' && ch <= 'Z')
+			ch = char(ch + 0x20);
+		else if (!((ch >= 'a' && ch <= 'z') || (ch >= '0' && ch <= '9')))
+			continue;
+		if (length == max_name)
+			return 0;
+		buffer[length ++] = ch;
+	}
+	return length;
+}
+
+// Immutable list of codecs, sorted by name and by encoding
+struct Snapshot
+{
+	std::vector<std::pair<std::string, const Codec *>> names;
+	std::vector<std::pair<Encoding, const Codec *>> encodings;
+};
+
+// Registry of codecs (the snapshots and codecs are never freed, readers might still use them)
+class Registry
+{
+public:
+	// Fields
+	std::atomic<const Snapshot *> current {nullptr};
+	std::mutex mutex;
+	std::vector<std::unique_ptr<const Snapshot>> snapshots;
+	std::vector<std::unique_ptr<const Codec>> codecs;
+	std::vector<std::unique_ptr<const std::string>> strings;
+
+	// Add the built-in codecs
+	Registry()
+	{
+		Snapshot snapshot;
+		for (auto & builtin : builtins())
+			insert(snapshot, builtin.codec, builtin.aliases);
+		publish(std::move(snapshot));
+	}
+
+	// Adds a codec (and returns the stored copy)
+	template<typename Aliases>
+	auto add(const Codec & codec, const Aliases & aliases) -> const Codec *
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		Snapshot snapshot = *current.load(std::memory_order_relaxed);
+		auto result = insert(snapshot, codec, aliases);
+		publish(std::move(snapshot));
+		return result;
+	}
+
+private:
+	// Adds a codec to a snapshot, replacing the codecs with the same names and encoding
+	template<typename Aliases>
+	auto insert(Snapshot & snapshot, const Codec & codec, const Aliases & aliases) -> const Codec *
+	{
+		// Keep a copy of the codec and its name
+		strings.emplace_back(new std::string(codec.name));
+		auto copy = new Codec(codec);
+		copy->name = strings.back()->c_str();
+		codecs.emplace_back(copy);
+
+		// Names
+		auto add_name = [&] (better_string_view<char> name)
+		{
+			char buffer[max_name];
+			size_t length = normalize(name, buffer);
+			if (length == 0)
+				throw std::invalid_argument("codec::add(): name");
+
+			std::string key(buffer, length);
+			auto iter = std::lower_bound(snapshot.names.begin(), snapshot.names.end(), key,
+				[] (const std::pair<std::string, const Codec *> & item, const std::string & key) {return item.first < key;});
+			if (iter != snapshot.names.end() && iter->first == key)
+				iter->second = copy;
+			else
+				snapshot.names.emplace(iter, std::move(key), copy);
+		};
+		add_name(copy->name);
+		for (const auto & alias : aliases)
+			add_name(alias);
+
+		// Encoding
+		if (codec.encoding != Encoding::Unknown)
+		{
+			auto iter = std::lower_bound(snapshot.encodings.begin(), snapshot.encodings.end(), std::make_pair(codec.encoding, (const Codec *) nullptr));
+			if (iter != snapshot.encodings.end() && iter->first == codec.encoding)
+				iter->second = copy;
+			else
+				snapshot.encodings.emplace(iter, codec.encoding, copy);
+		}
+		return copy;
+	}
+
+	// Replaces the current snapshot
+	void publish(Snapshot && snapshot)
+	{
+		snapshots.emplace_back(new Snapshot(std::move(snapshot)));
+		current.store(snapshots.back().get(), std::memory_order_release);
+	}
+};
+
+inline auto registry() -> Registry &
+{
+	static Registry registry;
+	return registry;
+}
+
+// Close namespace "impl"
+}
+
+// -------------------- Lookup --------------------
+
+/// Returns the codec for a charset name or alias, or `nullptr` if the name is not known.
+inline auto lookup(better_string_view<char> name) -> const Codec *
+{
+	char buffer[impl::max_name];
+	size_t length = impl::normalize(name, buffer);
+	if (length == 0)
+		return nullptr;
+
+	// Binary search in the current snapshot (without locking)
+	auto & names = impl::registry().current.load(std::memory_order_acquire)->names;
+	auto key = better_string_view<char>(buffer, length);
+	auto iter = std::lower_bound(names.begin(), names.end(), key,
+		[] (const std::pair<std::string, const Codec *> & item, better_string_view<char> key) {return better_string_view<char>(item.first) < key;});
+	return (iter != names.end() && better_string_view<char>(iter->first) == key) ? iter->second : nullptr;
+}
+
+/// Returns the codec for an encoding, or `nullptr` if the encoding does not have a codec.
+inline auto lookup(Encoding encoding) -> const Codec *
+{
+	auto & encodings = impl::registry().current.load(std::memory_order_acquire)->encodings;
+	auto iter = std::lower_bound(encodings.begin(), encodings.end(), std::make_pair(encoding, (const Codec *) nullptr));
+	return (iter != encodings.end() && iter->first == encoding) ? iter->second : nullptr;
+}
+
+/**
+ * @brief Adds a codec to the registry, replacing the codecs with the same names (and the same encoding).
+ *
+ * The codec and the names are copied. Adding codecs is slow (the registry is copied), but it does not block lookups.
+ *
+ * @param codec The codec to add.
+ * @param aliases Other names of the codec.
+ * @result Returns the copy of the codec stored in the registry.
+ */
+inline auto add(const Codec & codec, std::initializer_list<const char *> aliases = {}) -> const Codec *
+	{return impl::registry().add(codec, aliases);}
+
+// -------------------- Conversion --------------------
+
+/**
+ * @brief Decodes a buffer to UTF-8, with the codec of a charset name.
+ *
+ * @param charset The name of the encoding of the buffer. Throws `std::invalid_argument` for unknown names.
+ * @param data The bytes to decode.
+ * @param mode The error handling mode.
+ */
+inline auto decode(better_string_view<char> charset, better_string_view<char> data, Errors mode = Errors::Strict) -> better_string<char>
+{
+	auto codec = lookup(charset);
+	if (!codec)
+		throw std::invalid_argument("decode(): charset");
+
+	better_string<char> result;
+	codec->decode(data.data(), data.size(), result, mode);
+	return result;
+}
+
+/// @see decode() - With the codec of an encoding.
+inline auto decode(Encoding encoding, better_string_view<char> data, Errors mode = Errors::Strict) -> better_string<char>
+{
+	auto codec = lookup(encoding);
+	if (!codec)
+		throw std::invalid_argument("decode(): encoding");
+
+	better_string<char> result;
+	codec->decode(data.data(), data.size(), result, mode);
+	return result;
+}
+
+/**
+ * @brief Encodes UTF-8 text, with the codec of a charset name.
+ *
+ * @param charset The name of the encoding of the result. Throws `std::invalid_argument` for unknown names.
+ * @param text The text to encode.
+ * @param mode The error handling mode.
+ */
+inline auto encode(better_string_view<char> charset, better_string_view<char> text, Errors mode = Errors::Strict) -> better_string<char>
+{
+	auto codec = lookup(charset);
+	if (!codec)
+		throw std::invalid_argument("encode(): charset");
+
+	better_string<char> result;
+	codec->encode(text.data(), text.size(), result, mode);
+	return result;
+}
+
+/// @see encode() - With the codec of an encoding.
+inline auto encode(Encoding encoding, better_string_view<char> text, Errors mode = Errors::Strict) -> better_string<char>
+{
+	auto codec = lookup(encoding);
+	if (!codec)
+		throw std::invalid_argument("encode(): encoding");
+
+	better_string<char> result;
+	codec->encode(text.data(), text.size(), result, mode);
+	return result;
+}
+
+/// @}
+
+/**
+ * @name Charset detection
+ *
+ * Guesses the encoding of bytes without a declared charset (uploaded files for example). Only a bounded prefix of the
+ * input is examined, so detection is cheap even for large inputs.
+ *
+ * The checks are made in order of reliability:
+ *  - A byte order mark decides the encoding.
+ *  - Null bytes in a regular pattern select UTF-16 or UTF-32 (little or big endian).
+ *  - Valid UTF-8 (checked with the string kernels) selects US-ASCII or UTF-8.
+ *  - Otherwise every codepage of @ref Encoding is scored by the characters it decodes the bytes to: letters are good,
+ *    control characters and undefined bytes are bad, and letters of different scripts or in unusual case next to each
+ *    other are penalized.
+ */
+
+/// @{
+
+/************************************************************
+ * @brief Result of @ref detect_encoding().
+ */
+struct Detection
+{
+	/// Detected encoding, or `Encoding::Unknown` if the input looks like binary data. US-ASCII is reported as UTF-8,
+	/// and UTF-16 and UTF-32 are reported without the byte order (see the charset).
+	Encoding encoding;
+	/// Name of the codec of the detected encoding (with the byte order), or `nullptr` if the input looks like binary data.
+	const char * charset;
+	/// Length of the byte order mark at the start of the input (zero if it has none).
+	size_t bom;
+	/// Confidence of the detection, from 0 (a guess) to 1 (certain).
+	double confidence;
+};
+
+// Namespace for implementation details
+namespace impl {
+
+// Character classes used for scoring codepages
+struct Letter
+{
+	int8_t weight;	// Score of the character
+	char script;	// Script of letters (Latin, Cyrillic, Greek, Hebrew, Arabic, Thai), zero for other characters
+	char lettercase;	// Case of letters ('u' or 'l'), zero for caseless letters and other characters
+	char placement = 0;	// Combining marks follow a letter ('f'), and leading vowels precede one ('p'), zero for others
+};
+
+// Classifies a character decoded by a codepage
+inline auto classify(uint32_t cp) -> Letter
+{
+	// Control characters (C1 controls, only in the ISO codepages)
+	if (cp < 0xA0)
+		return {-4, 0, 0};
+
+	// Latin (the letters of the major languages are common, the others are rare)
+	if ((cp >= 0xC0 && cp < 0x180 && cp != 0xD7 && cp != 0xF7) || (cp >= 0x1E00 && cp < 0x1F00))
+	{
+		static constexpr char16_t frequent[] =
+			u"\u00DF\u00E0\u00E1\u00E2\u00E3\u00E4\u00E5\u00E6\u00E7\u00E8\u00E9\u00EA\u00EB\u00EC\u00ED\u00EE"
+			u"\u00EF\u00F1\u00F2\u00F3\u00F4\u00F5\u00F6\u00F8\u00F9\u00FA\u00FB\u00FC\u00FF\u0101\u0103\u0105"
+			u"\u0107\u010D\u010F\u0113\u0117\u0119\u011B\u011F\u0123\u012B\u012F\u0131\u0137\u013A\u013C\u013E"
+			u"\u0142\u0144\u0146\u0148\u0151\u0153\u0159\u015B\u015F\u0161\u0165\u016B\u016F\u0171\u0173\u017A"
+			u"\u017C\u017E";
+
+		// Upper and lower case letters alternate after Latin-1, but the order is swapped in two ranges
+		bool swapped = (cp >= 0x139 && cp < 0x149) || (cp >= 0x179 && cp < 0x17F);
+		bool lower = (cp < 0x100) ? cp >= 0xDF : (cp & 1) != swapped;
+		char16_t key = char16_t(lower ? cp : (cp < 0x100) ? cp + 0x20 : (cp == 0x130) ? 0x131 : (cp == 0x178) ? 0xFF : cp + 1);
+		bool common = std::find(std::begin(frequent), std::end(frequent) - 1, key) != std::end(frequent) - 1;
+		return {int8_t(common ? 2 : 1), 'L', lower ? 'l' : 'u'};
+	}
+	if (cp >= 0x180 && cp < 0x250)
+		return {1, 'L', 0};
+
+	// Greek (with the most common letters, and the letters with tonos)
+	if (cp >= 0x391 && cp < 0x3CF)
+	{
+		static constexpr char16_t frequent[] = u"\u03AC\u03AD\u03AE\u03AF\u03B1\u03B5\u03B7\u03B9\u03BA\u03BD\u03BF\u03C1\u03C2\u03C3\u03C4\u03C5\u03CC";
+		bool common = std::find(std::begin(frequent), std::end(frequent) - 1, char16_t(cp)) != std::end(frequent) - 1;
+		return {int8_t(common ? 3 : 2), 'G', (cp < 0x3AC) ? 'u' : 'l'};
+	}
+	if (cp >= 0x370 && cp < 0x400)
+		return {1, 'G', 0};
+
+	// Cyrillic (the letters of Russian are the most common, and some of them even more)
+	if (cp >= 0x410 && cp < 0x450)
+	{
+		static constexpr char16_t frequent[] = u"\u0430\u0432\u0435\u0438\u043A\u043B\u043C\u043D\u043E\u0440\u0441\u0442";
+		uint32_t lower = (cp < 0x430) ? cp + 0x20 : cp;
+		bool common = std::find(std::begin(frequent), std::end(frequent) - 1, char16_t(lower)) != std::end(frequent) - 1;
+		return {int8_t(common ? 3 : 2), 'C', (cp < 0x430) ? 'u' : 'l'};
+	}
+	if (cp >= 0x400 && cp < 0x410)
+		return {1, 'C', 'u'};
+	if (cp >= 0x450 && cp < 0x460)
+		return {1, 'C', 'l'};
+	if (cp >= 0x460 && cp < 0x530)
+		return {1, 'C', 0};
+
+	// Hebrew, Arabic and Thai (the alphabets are small, so every letter is common)
+	if (cp >= 0x5D0 && cp < 0x5EB)
+		return {3, 'H', 0};
+	if (cp >= 0x5B0 && cp < 0x5C8)
+		return {1, 'H', 0, 'f'};
+	if (cp >= 0x590 && cp < 0x600)
+		return {1, 'H', 0};
+	if (cp >= 0x621 && cp < 0x64B)
+		return {3, 'A', 0};
+	if (cp >= 0x64B && cp < 0x653)
+		return {1, 'A', 0, 'f'};
+	if (cp >= 0x600 && cp < 0x700)
+		return {1, 'A', 0};
+	if (cp == 0xE31 || (cp >= 0xE34 && cp < 0xE3B) || (cp >= 0xE47 && cp < 0xE4F))
+		return {3, 'T', 0, 'f'};
+	if (cp >= 0xE40 && cp < 0xE45)
+		return {3, 'T', 0, 'p'};
+	if (cp >= 0xE01 && cp < 0xE5C)
+		return {3, 'T', 0};
+
+	// Inverted marks and guillemets (as likely as a letter in Spanish and French text)
+	if (cp == 0xA1 || cp == 0xAB || cp == 0xBB || cp == 0xBF)
+		return {2, 0, 0};
+
+	// Common punctuation (quotes, dashes, ellipsis) and the euro sign
+	if ((cp >= 0x2013 && cp <= 0x2014) || (cp >= 0x2018 && cp <= 0x201E) || cp == 0x2026 || cp == 0x20AC)
+		return {1, 0, 0};
+
+	// Other symbols
+	return {0, 0, 0};
+}
+
+// Classifies an ASCII character
+inline auto classify_ascii(uint8_t ch) -> Letter
+{
+	if (ch >= 'A' && ch <= 'Z')
+		return {0, 'L', 'u'};
+	if (ch >= 'a' && ch <= 'z')
+		return {0, 'L', 'l'};
+	return {0, 0, 0};
+}
+
+// Scores a pair of letters: a penalty for mixed scripts, for upper case letters after lower case ones, for marks
+// without their letter, and for accented Latin letters next to each other (they are usually between ASCII letters)
+inline auto score_pair(Letter prev, Letter next, bool accented) -> int
+{
+	if ((next.placement == 'f' || prev.placement == 'p') && prev.script != next.script)
+		return -4;
+	if (!prev.script || !next.script)
+		return 0;
+	if (prev.script != next.script)
+		return -2;
+	if (prev.lettercase == 'l' && next.lettercase == 'u')
+		return -2;
+	if (accented && prev.script == 'L')
+		return -1;
+	return 1;
+}
+
+// Scores the bytes with a codepage (ASCII runs are skipped, only the characters next to them are scored)
+inline auto score_codepage(const char16_t * table, const char * data, size_t size) -> long
+{
+	auto at = [&] (size_t i) -> Letter
+	{
+		uint8_t byte = uint8_t(data[i]);
+		return (byte < 0x80) ? classify_ascii(byte) : table[byte - 0x80] ? classify(table[byte - 0x80]) : Letter {-8, 0, 0};
+	};
+
+	long score = 0;
+	for (size_t i = kernels::active().ascii_prefix(data, size); i < size; )
+	{
+		// Non-ASCII characters, and the characters around them
+		Letter prev = i ? at(i - 1) : Letter {0, 0, 0};
+		for (size_t start = i; i < size && uint8_t(data[i]) >= 0x80; ++ i)
+		{
+			Letter next = at(i);
+			score += next.weight + score_pair(prev, next, i > start);
+			if (prev.script && !next.script)
+				score -= 1;
+			prev = next;
+		}
+		if (i < size)
+			score += score_pair(prev, at(i), false);
+
+		// Skip the next ASCII run
+		if (i < size)
+			i += kernels::active().ascii_prefix(data + i, size - i);
+	}
+	return score;
+}
+
+// Codepages, in order of preference (for equal scores)
+struct Candidate
+{
+	Encoding encoding;
+	const char * charset;
+	const char16_t * table;
+};
+
+static constexpr Candidate candidates[] = {
+	{Encoding::Win1252, "windows-1252", tables::win1252},
+	{Encoding::ISO_8859_1, "ISO-8859-1", tables::iso_8859_1},
+	{Encoding::ISO_8859_15, "ISO-8859-15", tables::iso_8859_15},
+	{Encoding::Win1250, "windows-1250", tables::win1250},
+	{Encoding::ISO_8859_2, "ISO-8859-2", tables::iso_8859_2},
+	{Encoding::Win1251, "windows-1251", tables::win1251},
+	{Encoding::ISO_8859_5, "ISO-8859-5", tables::iso_8859_5},
+	{Encoding::Win1253, "windows-1253", tables::win1253},
+	{Encoding::ISO_8859_7, "ISO-8859-7", tables::iso_8859_7},
+	{Encoding::Win1254, "windows-1254", tables::win1254},
+	{Encoding::ISO_8859_9, "ISO-8859-9", tables::iso_8859_9},
+	{Encoding::Win1255, "windows-1255", tables::win1255},
+	{Encoding::ISO_8859_8, "ISO-8859-8", tables::iso_8859_8},
+	{Encoding::Win1256, "windows-1256", tables::win1256},
+	{Encoding::ISO_8859_6, "ISO-8859-6", tables::iso_8859_6},
+	{Encoding::Win1257, "windows-1257", tables::win1257},
+	{Encoding::ISO_8859_13, "ISO-8859-13", tables::iso_8859_13},
+	{Encoding::ISO_8859_4, "ISO-8859-4", tables::iso_8859_4},
+	{Encoding::Win1258, "windows-1258", tables::win1258},
+	{Encoding::ISO_8859_3, "ISO-8859-3", tables::iso_8859_3},
+	{Encoding::ISO_8859_10, "ISO-8859-10", tables::iso_8859_10},
+	{Encoding::ISO_8859_11, "ISO-8859-11", tables::iso_8859_11},
+	{Encoding::ISO_8859_14, "ISO-8859-14", tables::iso_8859_14},
+};
+
+// Detects a byte order mark
+inline auto detect_bom(const uint8_t * data, size_t size) -> Detection
+{
+	if (size >= 3 && data[0] == 0xEF && data[1] == 0xBB && data[2] == 0xBF)
+		return {Encoding::UTF8, "UTF-8", 3, 1.0};
+	if (size >= 4 && data[0] == 0xFF && data[1] == 0xFE && data[2] == 0 && data[3] == 0)
+		return {Encoding::UTF32, "UTF-32LE", 4, 1.0};
+	if (size >= 4 && data[0] == 0 && data[1] == 0 && data[2] == 0xFE && data[3] == 0xFF)
+		return {Encoding::UTF32, "UTF-32BE", 4, 1.0};
+	if (size >= 2 && data[0] == 0xFF && data[1] == 0xFE)
+		return {Encoding::UTF16, "UTF-16LE", 2, 1.0};
+	if (size >= 2 && data[0] == 0xFE && data[1] == 0xFF)
+		return {Encoding::UTF16, "UTF-16BE", 2, 1.0};
+	return {Encoding::Unknown, nullptr, 0, 0.0};
+}
+
+// Detects UTF-16 and UTF-32 by the null bytes (only for text with mostly ASCII or Latin characters)
+inline auto detect_nulls(const uint8_t * data, size_t size) -> Detection
+{
+	// Null bytes at each position, modulo 4
+	size_t nulls[4] = {0, 0, 0, 0};
+	for (size_t i = 0; i < size; ++ i)
+		nulls[i & 3] += !data[i];
+	size_t quads = size / 4, pairs = size / 2;
+	if (nulls[0] + nulls[1] + nulls[2] + nulls[3] == 0)
+		return {Encoding::Unknown, nullptr, 0, 0.0};
+
+	// UTF-32 (the highest byte is always zero, and the next one almost always)
+	if (quads && nulls[3] >= quads && nulls[2] * 10 >= quads * 9 && nulls[0] * 2 < quads)
+		return {Encoding::UTF32, "UTF-32LE", 0, 0.95};
+	if (quads && nulls[0] >= quads && nulls[1] * 10 >= quads * 9 && nulls[3] * 2 < quads)
+		return {Encoding::UTF32, "UTF-32BE", 0, 0.95};
+
+	// UTF-16 (the high bytes are zero for ASCII and Latin-1 characters, but the low bytes almost never)
+	size_t even = nulls[0] + nulls[2], odd = nulls[1] + nulls[3];
+	if (pairs && odd * 10 >= pairs * 3 && even * 20 < pairs)
+		return {Encoding::UTF16, "UTF-16LE", 0, std::min(0.95, 0.5 + 0.5 * double(odd) / double(pairs))};
+	if (pairs && even * 10 >= pairs * 3 && odd * 20 < pairs)
+		return {Encoding::UTF16, "UTF-16BE", 0, std::min(0.95, 0.5 + 0.5 * double(even) / double(pairs))};
+
+	// Null bytes without a pattern (binary data)
+	return {Encoding::Unknown, nullptr, 0, 0.0};
+}
+
+// Length of the prefix without a truncated UTF-8 sequence at the end
+inline auto utf8_boundary(const uint8_t * data, size_t size) -> size_t
+{
+	for (size_t back = 1; back <= 4 && back <= size; ++ back)
+	{
+		uint8_t byte = data[size - back];
+		if ((byte & 0xC0) == 0x80)
+			continue;
+
+		// Length of the sequence started by the lead byte
+		size_t length = (byte < 0x80) ? 1 : (byte >= 0xF0) ? 4 : (byte >= 0xE0) ? 3 : 2;
+		return (length > back) ? size - back : size;
+	}
+	return size;
+}
+
+// Close namespace "impl"
+}
+
+/**
+ * @brief Detects the encoding of bytes.
+ *
+ * The result names a codec (see @ref lookup()) which can decode the input, after skipping the byte order mark.
+ *
+ * @param data The bytes to examine.
+ * @param limit The length of the prefix to examine (the rest of the input is ignored).
+ * @result Returns the detected encoding and the confidence of the detection.
+ */
+inline auto detect_encoding(better_string_view<char> data, size_t limit = 64 * 1024) -> Detection
+{
+	auto bytes = reinterpret_cast<const uint8_t *>(data.data());
+	size_t size = std::min(data.size(), limit);
+
+	// Byte order marks
+	Detection result = impl::detect_bom(bytes, size);
+	if (result.charset)
+		return result;
+
+	// Null bytes (UTF-16, UTF-32, or binary data)
+	if (std::find(bytes, bytes + size, 0) != bytes + size)
+		return impl::detect_nulls(bytes, size);
+
+	// UTF-8 (when the input is longer than the limit, a sequence can be cut at the end)
+	if (size < data.size())
+		size = impl::utf8_boundary(bytes, size);
+	if (kernels::active().ascii_prefix(data.data(), size) == size)
+		return {Encoding::UTF8, "US-ASCII", 0, 1.0};
+
+	size_t length = kernels::active().utf8_length(data.data(), size);
+	if (length != size_t(-1))
+	{
+		// Every multi byte sequence makes an accidental match less likely
+		double chance = 1.0;
+		for (size_t extra = size - length; extra && chance > 0.01; -- extra)
+			chance *= 0.25;
+		return {Encoding::UTF8, "UTF-8", 0, std::min(0.99, 1.0 - chance)};
+	}
+
+	// Codepages (codepages decoding the bytes to the same characters are not rivals)
+	long scores[std::size(impl::candidates)];
+	size_t best = 0;
+	for (size_t i = 0; i < std::size(impl::candidates); ++ i)
+	{
+		scores[i] = impl::score_codepage(impl::candidates[i].table, data.data(), size);
+		if (scores[i] > scores[best])
+			best = i;
+	}
+
+	bool used[128] = {};
+	size_t count = 0;
+	for (size_t i = 0; i < size; ++ i)
+		if (bytes[i] >= 0x80)
+			used[bytes[i] - 0x80] = true, ++ count;
+
+	// Windows-1252 is the most common codepage, another one has to beat it by a margin (short Western text often
+	// scores a little better with a Central European or Baltic codepage)
+	if (scores[best] - scores[0] <= long(count / 4 + 2))
+		best = 0;
+
+	long rival = std::numeric_limits<long>::min();
+	for (size_t i = 0; i < std::size(impl::candidates); ++ i)
+	{
+		bool same = true;
+		for (size_t k = 0; k < 128 && same; ++ k)
+			same = !used[k] || impl::candidates[i].table[k] == impl::candidates[best].table[k];
+		if (!same)
+			rival = std::max(rival, scores[i]);
+	}
+
+	// The confidence depends on the average score of the characters, and the lead over the best rival
+	const auto & candidate = impl::candidates[best];
+	double quality = std::max(0.0, std::min(1.0, double(scores[best]) / double(3 * count)));
+	double lead = (rival == std::numeric_limits<long>::min()) ? 1.0 :
+		std::max(0.0, std::min(1.0, double(scores[best] - rival) / double(count)));
+	return {candidate.encoding, candidate.charset, 0, 0.8 * quality * (0.5 + 0.5 * lead)};
+}
+
+/// @}
+
+// Close namespace "codec"
+}
+
+// Close namespace "ext"
+}
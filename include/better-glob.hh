@@ -0,0 +1,836 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <initializer_list>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "better-string.hh"
+
+// Namespace for std extensions
+namespace ext {
+
+/**
+ * @name Glob patterns
+ *
+ * @ref glob_pattern matches strings (paths, metric names) against shell-like patterns: `*` matches any characters, `?`
+ * matches one character, `[a-z]` matches one character of a set (`[!a-z]` or `[^a-z]` one character not in the set),
+ * and a backslash escapes the next character. With the `Pathname` flag, the wildcards do not match the separator, and a
+ * component that is only `**` matches any number of components, including none.
+ *
+ * A pattern is compiled once into components, and each component into literal segments and wildcard ops, separated by
+ * the stars. The first segment is matched at the start of the component (like `startswith`), the last one at its end
+ * (like `endswith`), and the segments between them at their leftmost occurrence, found with the string kernels. This
+ * never backtracks, so matching takes linear time in the length of the string (for a given pattern).
+ *
+ * @ref glob_set matches a string against many patterns at once: the literals of every pattern are searched in a single
+ * pass over the string (with an Aho-Corasick automaton). Every pattern is keyed by its most selective literal (the one
+ * shared by the fewest patterns), and only the patterns whose key was found (or that have no literals) are matched.
+ *
+ * Patterns and strings are UTF-8 (invalid bytes are single characters), unless the `Bytes` flag is set. Case folding
+ * only knows ASCII letters.
+ */
+
+/// @{
+
+// Namespace for implementation details
+namespace impl {
+
+// Operation of a glob segment
+struct GlobOp
+{
+	enum Kind : uint8_t {Literal, Any, Class};
+
+	Kind kind;
+	bool negate;	// Class
+	uint32_t offset;	// Literal (bytes in the literals), Class (ranges)
+	uint32_t length;	// Literal (bytes), Class (ranges)
+};
+
+// Segment of a glob component (the operations between two stars)
+struct GlobSegment
+{
+	uint32_t first;
+	uint32_t last;
+};
+
+// Component of a glob pattern (the whole pattern, without the `Pathname` flag)
+struct GlobPart
+{
+	uint32_t first;	// Segments
+	uint32_t last;
+	bool leading;	// Starts with a star
+	bool trailing;	// Ends with a star
+	bool globstar;	// The component is `**`
+};
+
+// Folds an ASCII letter to lower case
+inline auto glob_fold(uint8_t ch) -> uint8_t
+	{return (ch >= 'A' && ch <= 'Z') ? uint8_t(ch + 0x20) : ch;}
+
+// Close namespace "impl"
+}
+
+class glob_set;
+
+/************************************************************
+ * @brief A compiled glob pattern (see the description of the module above).
+ */
+class glob_pattern
+{
+public:
+	using view = better_string_view<char>;
+
+	// Flags
+	enum Flags : uint32_t
+	{
+		/// Every byte is a character (the pattern and the strings are not UTF-8).
+		Bytes = 1 << 0,
+		/// ASCII letters match both cases.
+		IgnoreCase = 1 << 1,
+		/// The wildcards do not match the separator, and `**` components match any number of components.
+		Pathname = 1 << 2,
+	};
+
+	/**
+	 * @brief Compiles a pattern. Every pattern is valid (an unclosed `[` is a literal, like in `fnmatch`).
+	 *
+	 * @param separator The separator of the components (with the `Pathname` flag), like `.` for metric names.
+	 */
+	explicit glob_pattern(view pattern, uint32_t flags = 0, char separator = '/')
+		: flags(flags), separator(separator)
+	{
+		compile(pattern);
+	}
+
+	/// Returns true, if the whole string matches the pattern.
+	auto match(view text) const -> bool
+	{
+		const char * data = text.data();
+		size_t size = text.size();
+		if (!(flags & Pathname))
+			return match_part(parts[0], data, 0, size);
+
+		// Without `**`, the components are matched in order
+		if (!globstars)
+		{
+			size_t pos = 0;
+			for (size_t i = 0; i < parts.size(); ++ i)
+			{
+				if (pos > size)
+					return false;
+				size_t end = component_end(data, pos, size);
+				if (!match_part(parts[i], data, pos, end))
+					return false;
+				pos = end + 1;
+			}
+			return pos > size;
+		}
+		return match_components(data, size);
+	}
+
+	/// Returns the longest literal, that every matching string contains (in lower case, with `IgnoreCase`).
+	auto required() const -> view
+		{return view(literal.data(), literal.size());}
+
+	/// Returns the flags of the pattern.
+	auto options() const -> uint32_t
+		{return flags;}
+
+private:
+	friend class glob_set;
+
+	using Op = impl::GlobOp;
+	using Segment = impl::GlobSegment;
+	using Part = impl::GlobPart;
+
+	static constexpr size_t npos = size_t(-1);
+
+	// -------------------- Compiler --------------------
+
+	// Compiles the pattern
+	void compile(view pattern)
+	{
+		const char * data = pattern.data();
+		size_t size = pattern.size();
+		bool pathname = (flags & Pathname);
+
+		Part part {0, 0, false, false, false};
+		size_t start = 0;	// Start of the current segment (in the ops)
+		bool star = false;	// A star after the last segment
+		auto close_segment = [&] {
+			if (ops.size() > start)
+			{
+				segments.push_back({uint32_t(start), uint32_t(ops.size())});
+				start = ops.size();
+			}
+		};
+		auto close_part = [&] {
+			close_segment();
+			part.last = uint32_t(segments.size());
+			part.trailing = star;
+			parts.push_back(part);
+			part = {part.last, part.last, false, false, false};
+			star = false;
+		};
+
+		for (size_t i = 0; i < size; )
+		{
+			char ch = data[i];
+			size_t component = i;	// Start of the component, for `**`
+			if (pathname && ch == separator)
+			{
+				close_part();
+				++ i;
+				continue;
+			}
+			if (ch == '*')
+			{
+				size_t count = 0;
+				while (i < size && data[i] == '*')
+					++ i, ++ count;
+
+				// A `**` component
+				bool alone = (component == 0 || data[component - 1] == separator) && (i == size || data[i] == separator);
+				if (pathname && count == 2 && alone && part.first == segments.size() && ops.size() == start)
+				{
+					part.globstar = true;
+					++ globstars;
+				}
+				close_segment();
+				if (part.first == segments.size())
+					part.leading = true;
+				star = true;
+				continue;
+			}
+
+			star = false;
+			if (ch == '?')
+			{
+				ops.push_back({Op::Any, false, 0, 0});
+				++ i;
+			}
+			else if (ch == '[' && parse_class(data, size, i))
+				continue;
+			else
+			{
+				// A literal character (escaped by a backslash, unless it is the last one)
+				if (ch == '\\' && i + 1 < size)
+					++ i;
+				add_literal(uint8_t(data[i ++]));
+			}
+		}
+		close_part();
+
+		// A `**` component is also the leading and trailing star of the component
+		for (auto & item : parts)
+			item.leading = item.leading || item.globstar;
+		find_literal();
+	}
+
+	// Appends a literal byte (to the last literal op, when possible)
+	void add_literal(uint8_t ch)
+	{
+		if (flags & IgnoreCase)
+			ch = impl::glob_fold(ch);
+		if (ops.empty() || ops.back().kind != Op::Literal || ops.back().offset + ops.back().length != literals.size()
+			|| (segments.size() && segments.back().last == ops.size()))
+			ops.push_back({Op::Literal, false, uint32_t(literals.size()), 0});
+		literals.push_back(char(ch));
+		++ ops.back().length;
+	}
+
+	// Parses a class (returns false, when it is not closed)
+	auto parse_class(const char * data, size_t size, size_t & pos) -> bool
+	{
+		size_t i = pos + 1;
+		bool negate = (i < size && (data[i] == '!' || data[i] == '^'));
+		i += negate;
+
+		std::vector<std::pair<uint32_t, uint32_t>> list;
+		for (bool first = true; first || (i < size && data[i] != ']'); first = false)
+		{
+			if (i == size || ((flags & Pathname) && data[i] == separator))
+				return false;
+			uint32_t lo = next_char(data, size, i);
+			uint32_t hi = lo;
+			if (i + 1 < size && data[i] == '-' && data[i + 1] != ']')
+			{
+				++ i;
+				hi = next_char(data, size, i);
+			}
+			if (lo <= hi)
+				list.push_back({lo, hi});
+		}
+		if (i == size)
+			return false;
+
+		// Case folding
+		if (flags & IgnoreCase)
+		{
+			size_t count = list.size();
+			for (size_t k = 0; k < count; ++ k)
+			{
+				uint32_t lo = list[k].first, hi = list[k].second;
+				if (lo <= 'Z' && hi >= 'A')
+					list.push_back({std::max<uint32_t>(lo, 'A') + 0x20, std::min<uint32_t>(hi, 'Z') + 0x20});
+				if (lo <= 'z' && hi >= 'a')
+					list.push_back({std::max<uint32_t>(lo, 'a') - 0x20, std::min<uint32_t>(hi, 'z') - 0x20});
+			}
+		}
+		ops.push_back({Op::Class, negate, uint32_t(ranges.size()), uint32_t(list.size())});
+		ranges.insert(ranges.end(), list.begin(), list.end());
+		pos = i + 1;
+		return true;
+	}
+
+	// Reads a character of a class (escaped by a backslash)
+	auto next_char(const char * data, size_t size, size_t & pos) const -> uint32_t
+	{
+		if (data[pos] == '\\' && pos + 1 < size)
+			++ pos;
+		size_t length = char_length(data + pos, size - pos);
+		uint32_t ch = decode(data + pos, length);
+		pos += length;
+		return ch;
+	}
+
+	// Finds the longest literal
+	void find_literal()
+	{
+		for (auto & op : ops)
+			if (op.kind == Op::Literal && op.length > literal.size())
+				literal.assign(literals.data() + op.offset, op.length);
+	}
+
+	// -------------------- Characters --------------------
+
+	// Returns the length of the character at the start of the data (invalid bytes are single characters)
+	auto char_length(const char * data, size_t size) const -> size_t
+	{
+		uint8_t ch = uint8_t(data[0]);
+		if ((flags & Bytes) || ch < 0xC2)
+			return 1;
+		size_t length = (ch >= 0xF0) ? 4 : (ch >= 0xE0) ? 3 : 2;
+		return (length <= size && kernels::scalar::utf8_length(data, length) == 1) ? length : 1;
+	}
+
+	// Returns the start of the character ending at a position (not before the lower bound)
+	auto char_start(const char * data, size_t lower, size_t pos) const -> size_t
+	{
+		size_t start = pos - 1;
+		if (flags & Bytes)
+			return start;
+		while (start > lower && pos - start < 4 && (uint8_t(data[start]) & 0xC0) == 0x80)
+			-- start;
+		return (char_length(data + start, pos - start) == pos - start) ? start : pos - 1;
+	}
+
+	// Decodes a character
+	auto decode(const char * data, size_t length) const -> uint32_t
+	{
+		uint8_t ch = uint8_t(data[0]);
+		if (length == 1)
+			return ch;
+		uint32_t cp = ch & (0x7F >> length);
+		for (size_t i = 1; i < length; ++ i)
+			cp = (cp << 6) | (uint8_t(data[i]) & 0x3F);
+		return cp;
+	}
+
+	// Returns true, if a character is in a class
+	auto in_class(const Op & op, uint32_t ch) const -> bool
+	{
+		bool found = false;
+		for (uint32_t i = op.offset; i < op.offset + op.length && !found; ++ i)
+			found = (ch >= ranges[i].first && ch <= ranges[i].second);
+		return found != op.negate;
+	}
+
+	// Compares a literal (ASCII letters are folded with `IgnoreCase`)
+	auto equal(const Op & op, const char * data) const -> bool
+	{
+		const char * expected = literals.data() + op.offset;
+		if (!(flags & IgnoreCase))
+			return std::char_traits<char>::compare(data, expected, op.length) == 0;
+		for (size_t i = 0; i < op.length; ++ i)
+			if (impl::glob_fold(uint8_t(data[i])) != uint8_t(expected[i]))
+				return false;
+		return true;
+	}
+
+	// -------------------- Matching --------------------
+
+	// Matches a segment at a position, and returns its end
+	auto match_at(const Segment & segment, const char * data, size_t pos, size_t end) const -> size_t
+	{
+		for (uint32_t i = segment.first; i < segment.last; ++ i)
+		{
+			auto & op = ops[i];
+			if (op.kind == Op::Literal)
+			{
+				if (end - pos < op.length || !equal(op, data + pos))
+					return npos;
+				pos += op.length;
+				continue;
+			}
+			if (pos == end)
+				return npos;
+			size_t length = char_length(data + pos, end - pos);
+			if (op.kind == Op::Class && !in_class(op, decode(data + pos, length)))
+				return npos;
+			pos += length;
+		}
+		return pos;
+	}
+
+	// Matches a segment ending at a position (not before the lower bound), and returns its start
+	auto match_back(const Segment & segment, const char * data, size_t lower, size_t pos) const -> size_t
+	{
+		for (uint32_t i = segment.last; i -- > segment.first; )
+		{
+			auto & op = ops[i];
+			if (op.kind == Op::Literal)
+			{
+				if (pos - lower < op.length || !equal(op, data + pos - op.length))
+					return npos;
+				pos -= op.length;
+				continue;
+			}
+			if (pos == lower)
+				return npos;
+			size_t start = char_start(data, lower, pos);
+			if (op.kind == Op::Class && !in_class(op, decode(data + start, pos - start)))
+				return npos;
+			pos = start;
+		}
+		return pos;
+	}
+
+	// Finds the leftmost match of a segment (the candidates of segments starting with a literal are found with the
+	// string kernels), and returns its end
+	auto find_segment(const Segment & segment, const char * data, size_t pos, size_t end) const -> size_t
+	{
+		auto & op = ops[segment.first];
+		if (op.kind == Op::Literal && !(flags & IgnoreCase))
+		{
+			auto & table = kernels::active();
+			const char * sub = literals.data() + op.offset;
+			while (pos < end)
+			{
+				size_t found = (op.length == 1) ? table.find_byte(data + pos, end - pos, sub[0])
+					: table.find(data + pos, end - pos, sub, op.length);
+				if (found == npos)
+					return npos;
+				size_t result = match_at(segment, data, pos + found, end);
+				if (result != npos)
+					return result;
+				pos += found + 1;
+			}
+			return npos;
+		}
+
+		for (; pos < end; pos += char_length(data + pos, end - pos))
+		{
+			size_t result = match_at(segment, data, pos, end);
+			if (result != npos)
+				return result;
+		}
+		return npos;
+	}
+
+	// Matches a component (or the whole string, without `Pathname`)
+	auto match_part(const Part & part, const char * data, size_t pos, size_t end) const -> bool
+	{
+		uint32_t first = part.first, last = part.last;
+		if (first == last)
+			return part.leading || pos == end;
+
+		// Anchored segments
+		if (!part.leading)
+		{
+			size_t result = match_at(segments[first ++], data, pos, end);
+			if (result == npos)
+				return false;
+			if (first == last && !part.trailing)
+				return result == end;
+			pos = result;
+		}
+		if (!part.trailing && first < last)
+		{
+			size_t result = match_back(segments[-- last], data, pos, end);
+			if (result == npos)
+				return false;
+			end = result;
+		}
+
+		// The segments between stars, at their leftmost match
+		for (; first < last; ++ first)
+		{
+			pos = find_segment(segments[first], data, pos, end);
+			if (pos == npos)
+				return false;
+		}
+		return true;
+	}
+
+	// Returns the end of the component starting at a position
+	auto component_end(const char * data, size_t pos, size_t size) const -> size_t
+	{
+		size_t found = kernels::active().find_byte(data + pos, size - pos, separator);
+		return (found == npos) ? size : pos + found;
+	}
+
+	// Matches the components with `**` components (that are the stars of the same algorithm, over components)
+	auto match_components(const char * data, size_t size) const -> bool
+	{
+		// The starts of the components (the last entry is after the end)
+		size_t small[64];
+		std::vector<size_t> large;
+		size_t * starts = small;
+		size_t count = 1 + kernels::active().count_byte(data, size, separator);
+		if (count + 1 > 64)
+		{
+			large.resize(count + 1);
+			starts = large.data();
+		}
+		starts[0] = 0;
+		for (size_t i = 1; i <= count; ++ i)
+			starts[i] = component_end(data, starts[i - 1], size) + 1;
+
+		// Matches a group of components at a position
+		auto group = [&] (size_t first, size_t last, size_t at) {
+			for (size_t i = first; i < last; ++ i, ++ at)
+				if (!match_part(parts[i], data, starts[at], starts[at + 1] - 1))
+					return false;
+			return true;
+		};
+
+		// The components before the first `**`, and after the last one
+		size_t first = 0, last = parts.size();
+		size_t lo = 0, hi = count;
+		while (!parts[first].globstar)
+			++ first;
+		while (!parts[last - 1].globstar)
+			-- last;
+		if (first + (parts.size() - last) > count)
+			return false;
+		if (!group(0, first, 0) || !group(last, parts.size(), count - (parts.size() - last)))
+			return false;
+		lo = first;
+		hi = count - (parts.size() - last);
+
+		// The groups between them, at their leftmost match
+		for (size_t i = first + 1; i < last; )
+		{
+			size_t end = i;
+			while (!parts[end].globstar)
+				++ end;
+			size_t length = end - i;
+			while (lo + length <= hi && !group(i, end, lo))
+				++ lo;
+			if (lo + length > hi)
+				return false;
+			lo += length;
+			i = end + 1;
+		}
+		return true;
+	}
+
+	// Fields
+	uint32_t flags;
+	char separator;
+	size_t globstars = 0;
+	std::vector<Part> parts;
+	std::vector<Segment> segments;
+	std::vector<Op> ops;
+	std::string literals;
+	std::vector<std::pair<uint32_t, uint32_t>> ranges;
+	std::string literal;
+};
+
+/************************************************************
+ * @brief A set of glob patterns, matched against a string at once (see the description of the module above).
+ *
+ * Adding patterns rebuilds the automaton of their literals, so patterns should be added together (with the
+ * constructor, or a range of patterns).
+ */
+class glob_set
+{
+public:
+	using view = better_string_view<char>;
+
+	/// Creates an empty set (the flags and the separator are used for every pattern).
+	explicit glob_set(uint32_t flags = 0, char separator = '/')
+		: flags(flags), separator(separator) {}
+
+	/// Creates a set of patterns.
+	glob_set(std::initializer_list<view> list, uint32_t flags = 0, char separator = '/')
+		: flags(flags), separator(separator)
+	{
+		add(list.begin(), list.end());
+	}
+
+	/// Creates a set of patterns, from a range of strings.
+	template<typename Iterator>
+	glob_set(Iterator first, Iterator last, uint32_t flags = 0, char separator = '/')
+		: flags(flags), separator(separator)
+	{
+		add(first, last);
+	}
+
+	/// Adds a pattern, and returns its index.
+	auto add(view pattern) -> size_t
+	{
+		insert(pattern);
+		build();
+		return patterns.size() - 1;
+	}
+
+	/// Adds a range of patterns (the indices follow the order of the range).
+	template<typename Iterator>
+	void add(Iterator first, Iterator last)
+	{
+		for (; first != last; ++ first)
+			insert(view(*first));
+		build();
+	}
+
+	/// Returns the number of patterns.
+	auto size() const -> size_t
+		{return patterns.size();}
+
+	/// Returns a pattern.
+	auto operator [] (size_t index) const -> const glob_pattern &
+		{return patterns[index];}
+
+	/// Returns the indices of the matching patterns (in increasing order).
+	auto matches(view text) const -> std::vector<size_t>
+	{
+		std::vector<size_t> result;
+		matches_into(text, result);
+		return result;
+	}
+
+	/// A version of @ref matches(), that appends to an existing list (reusing its capacity).
+	auto matches_into(view text, std::vector<size_t> & output) const -> std::vector<size_t> &
+	{
+		size_t start = output.size();
+		candidates(text, output);
+		size_t count = start;
+		for (size_t i = start; i < output.size(); ++ i)
+			if (patterns[output[i]].match(text))
+				output[count ++] = output[i];
+		output.resize(count);
+		return output;
+	}
+
+	/// Returns true, if any pattern matches.
+	auto is_match(view text) const -> bool
+	{
+		std::vector<size_t> list;
+		candidates(text, list);
+		for (size_t index : list)
+			if (patterns[index].match(text))
+				return true;
+		return false;
+	}
+
+private:
+	// Node of the automaton (its edges are a range of the shared arrays)
+	struct Node
+	{
+		uint32_t fail = 0;
+		uint32_t output = none;	// The nearest node (this one, or one on the failure path) that ends a literal
+		uint32_t literal = none;	// The literal ending at this node
+		uint32_t edges = 0;
+		uint32_t edge_count = 0;
+	};
+
+	static constexpr uint32_t none = 0xFFFFFFFF;
+
+	// Adds a pattern (without rebuilding the automaton)
+	void insert(view pattern)
+	{
+		patterns.emplace_back(pattern, flags, separator);
+	}
+
+	// Returns the target of an edge of a node
+	auto edge(uint32_t node, uint8_t ch) const -> uint32_t
+	{
+		if (node == 0)
+			return root[ch];
+		auto & item = nodes[node];
+		for (uint32_t i = item.edges; i < item.edges + item.edge_count; ++ i)
+			if (edge_bytes[i] == ch)
+				return edge_targets[i];
+		return none;
+	}
+
+	// Builds the automaton of the literals (every distinct literal of every pattern)
+	void build()
+	{
+		// The trie (the literals are numbered by their first occurrence)
+		std::vector<std::vector<std::pair<uint8_t, uint32_t>>> children(1);
+		std::vector<uint32_t> ends(1, none);
+		std::vector<std::vector<uint32_t>> users, owned(patterns.size());
+		always.clear();
+		for (size_t index = 0; index < patterns.size(); ++ index)
+		{
+			auto & glob = patterns[index];
+			for (auto & op : glob.ops)
+			{
+				if (op.kind != impl::GlobOp::Literal)
+					continue;
+				uint32_t node = 0;
+				for (uint32_t k = op.offset; k < op.offset + op.length; ++ k)
+				{
+					uint8_t ch = uint8_t(glob.literals[k]);
+					auto & list = children[node];
+					auto found = std::find_if(list.begin(), list.end(), [&] (const std::pair<uint8_t, uint32_t> & item) {return item.first == ch;});
+					if (found == list.end())
+					{
+						list.push_back({ch, uint32_t(children.size())});
+						node = uint32_t(children.size());
+						children.emplace_back();
+						ends.push_back(none);
+					}
+					else
+						node = found->second;
+				}
+				if (ends[node] == none)
+				{
+					ends[node] = uint32_t(users.size());
+					users.emplace_back();
+				}
+
+				owned[index].push_back(ends[node]);
+				users[ends[node]].push_back(uint32_t(index));
+			}
+		}
+
+		// Every pattern is a candidate of its most selective literal (used by the fewest patterns)
+		std::vector<std::vector<uint32_t>> keys(users.size());
+		for (size_t index = 0; index < patterns.size(); ++ index)
+		{
+			if (owned[index].empty())
+			{
+				always.push_back(index);
+				continue;
+			}
+			uint32_t key = owned[index][0];
+			for (uint32_t literal : owned[index])
+				if (users[literal].size() < users[key].size())
+					key = literal;
+			keys[key].push_back(uint32_t(index));
+		}
+
+		// Flatten the trie, and the patterns of the keys
+		nodes.assign(children.size(), Node());
+		edge_bytes.clear();
+		edge_targets.clear();
+		for (size_t i = 0; i < children.size(); ++ i)
+		{
+			nodes[i].edges = uint32_t(edge_bytes.size());
+			nodes[i].edge_count = uint32_t(children[i].size());
+			for (auto & item : children[i])
+			{
+				edge_bytes.push_back(item.first);
+				edge_targets.push_back(item.second);
+			}
+			// Only the keys are reported
+			if (ends[i] != none && !keys[ends[i]].empty())
+			{
+				nodes[i].literal = ends[i];
+				nodes[i].output = uint32_t(i);
+			}
+		}
+		std::fill(std::begin(root), std::end(root), 0);
+		for (auto & item : children[0])
+			root[item.first] = item.second;
+		users_first.assign(1, 0);
+		users_list.clear();
+		for (auto & list : keys)
+		{
+			users_list.insert(users_list.end(), list.begin(), list.end());
+			users_first.push_back(uint32_t(users_list.size()));
+		}
+
+		// The failure links (breadth first)
+		std::vector<uint32_t> queue;
+		for (auto & item : children[0])
+			queue.push_back(item.second);
+		for (size_t i = 0; i < queue.size(); ++ i)
+		{
+			uint32_t node = queue[i];
+			if (nodes[node].output == none)
+				nodes[node].output = nodes[nodes[node].fail].output;
+			for (auto & item : children[node])
+			{
+				uint32_t fail = nodes[node].fail, target;
+				while ((target = edge(fail, item.first)) == none)
+					fail = nodes[fail].fail;
+				nodes[item.second].fail = (target == item.second) ? 0 : target;
+				queue.push_back(item.second);
+			}
+		}
+	}
+
+	// Appends the candidates (in increasing order): the patterns without literals, and the ones whose most selective
+	// literal is found by a single pass of the automaton over the string
+	void candidates(view text, std::vector<size_t> & output) const
+	{
+		// The literals found
+		std::vector<uint32_t> found;
+		if (nodes.size() > 1)
+		{
+			bool fold = (flags & glob_pattern::IgnoreCase);
+			uint32_t state = 0;
+			for (char item : text)
+			{
+				uint8_t ch = fold ? impl::glob_fold(uint8_t(item)) : uint8_t(item);
+				uint32_t target;
+				while ((target = edge(state, ch)) == none)
+					state = nodes[state].fail;
+				state = target;
+				for (uint32_t node = nodes[state].output; node != none; node = nodes[nodes[node].fail].output)
+				{
+					if (found.empty() || found.back() != nodes[node].literal)
+						found.push_back(nodes[node].literal);
+				}
+			}
+			std::sort(found.begin(), found.end());
+			found.erase(std::unique(found.begin(), found.end()), found.end());
+		}
+
+		// The patterns of the literals
+		size_t start = output.size();
+		for (uint32_t literal : found)
+			output.insert(output.end(), users_list.begin() + users_first[literal], users_list.begin() + users_first[literal + 1]);
+		std::sort(output.begin() + start, output.end());
+		size_t count = output.size();
+		output.insert(output.end(), always.begin(), always.end());
+		std::inplace_merge(output.begin() + start, output.begin() + count, output.end());
+	}
+
+	// Fields
+	uint32_t flags;
+	char separator;
+	std::vector<glob_pattern> patterns;
+	std::vector<size_t> always;
+	std::vector<Node> nodes;
+	uint32_t root[256] = {};
+	std::vector<uint8_t> edge_bytes;
+	std::vector<uint32_t> edge_targets;
+	std::vector<uint32_t> users_first;
+	std::vector<uint32_t> users_list;
+};
+
+/// @}
+
+// Close namespace "ext"
+}
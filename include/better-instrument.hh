@@ -0,0 +1,374 @@
+#pragma once
+
+/**
+ * @name Instrumentation
+ *
+ * Opt-in counters for the string algorithms. When `BETTER_STRING_INSTRUMENT` is defined (to a non-zero value), every
+ * entry point of `algorithm::string` counts its calls, input bytes, output bytes and allocations in thread local
+ * counters. Otherwise the probes expand to nothing, and this header does not include anything.
+ *
+ * Allocations are counted by the replacement `operator new` in `src/better-instrument.cc` (linked through the
+ * `better-string-instrument` target), and stay zero without it. The counters are inclusive: when an algorithm calls
+ * another one (`format` calls `transcode` for example), both of them count the bytes and the allocations.
+ *
+ * The counters of all threads are collected with @ref ext::instrument::snapshot(), and can be written in the
+ * Prometheus text format, or as JSON.
+ */
+
+#if BETTER_STRING_INSTRUMENT
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Namespace for std extensions
+namespace ext {
+
+// Namespace for instrumentation
+namespace instrument {
+
+// Instrumented algorithms
+enum class Algorithm : int32_t
+{
+	Center,
+	Ljust,
+	Rjust,
+	Zfill,
+	Find,
+	Rfind,
+	Index,
+	Rindex,
+	Count,
+	Replace,
+	Translate,
+	Expandtabs,
+	Join,
+	Split,
+	Rsplit,
+	Splitlines,
+	Partition,
+	Rpartition,
+	Startswith,
+	Endswith,
+	Removeprefix,
+	Removesuffix,
+	Isascii,
+	Upper,
+	Lower,
+	Transcode,
+	Format,
+	Truncate,
+	Quote,
+	Unquote,
+	JsonEscape,
+	JsonUnescape,
+	B64encode,
+	B64decode,
+	Hexlify,
+	Unhexlify,
+	PercentEncode,
+	PercentDecode,
+	HtmlEscape,
+	HtmlUnescape,
+	Levenshtein,
+	Damerau,
+	FuzzyFind,
+	Finditer,
+	FindAll,
+	FindFirstOf,
+	FindFirstNotOf,
+	FindLastOf,
+	FindLastNotOf,
+	Span,
+	Cspan,
+	Strip,
+	Lstrip,
+	Rstrip,
+	SplitAny,
+};
+
+// Number of instrumented algorithms
+static constexpr size_t algorithm_count = size_t(Algorithm::SplitAny) + 1;
+
+// Names of the instrumented algorithms
+static constexpr const char * algorithm_names[algorithm_count] = {
+	"center", "ljust", "rjust", "zfill",
+	"find", "rfind", "index", "rindex", "count",
+	"replace", "translate", "expandtabs",
+	"join", "split", "rsplit", "splitlines", "partition", "rpartition",
+	"startswith", "endswith", "removeprefix", "removesuffix",
+	"isascii", "upper", "lower",
+	"transcode", "format", "truncate", "quote", "unquote",
+	"json_escape", "json_unescape",
+	"b64encode", "b64decode", "hexlify", "unhexlify",
+	"percent_encode", "percent_decode", "html_escape", "html_unescape",
+	"levenshtein", "damerau", "fuzzy_find", "finditer", "find_all",
+	"find_first_of", "find_first_not_of", "find_last_of", "find_last_not_of", "span", "cspan",
+	"strip", "lstrip", "rstrip", "split_any",
+};
+
+// Number of allocations made by the current thread (incremented by the replacement operator new)
+inline thread_local uint64_t allocations = 0;
+
+// Counters of one algorithm
+struct Counters
+{
+	uint64_t calls = 0;
+	uint64_t input = 0;
+	uint64_t output = 0;
+	uint64_t allocations = 0;
+};
+
+/************************************************************
+ * @brief Counters of every algorithm, collected from one or more threads.
+ */
+class Snapshot
+{
+public:
+	// Fields
+	Counters counters[algorithm_count];
+
+	// Access
+	auto operator [] (Algorithm algorithm) -> Counters &
+		{return counters[size_t(algorithm)];}
+	auto operator [] (Algorithm algorithm) const -> const Counters &
+		{return counters[size_t(algorithm)];}
+
+	/// Adds the counters of an other snapshot to this one.
+	auto merge(const Snapshot & other) -> Snapshot &
+	{
+		for (size_t i = 0; i < algorithm_count; ++ i)
+		{
+			counters[i].calls += other.counters[i].calls;
+			counters[i].input += other.counters[i].input;
+			counters[i].output += other.counters[i].output;
+			counters[i].allocations += other.counters[i].allocations;
+		}
+		return *this;
+	}
+
+	/// Returns the counters collected since an earlier snapshot.
+	auto since(const Snapshot & earlier) const -> Snapshot
+	{
+		Snapshot result;
+		for (size_t i = 0; i < algorithm_count; ++ i)
+		{
+			result.counters[i].calls = counters[i].calls - earlier.counters[i].calls;
+			result.counters[i].input = counters[i].input - earlier.counters[i].input;
+			result.counters[i].output = counters[i].output - earlier.counters[i].output;
+			result.counters[i].allocations = counters[i].allocations - earlier.counters[i].allocations;
+		}
+		return result;
+	}
+
+	/// Writes the counters in the Prometheus text exposition format.
+	auto prometheus() const -> std::string
+	{
+		static const struct {const char * name; const char * help; uint64_t Counters::* field;} metrics[] = {
+			{"better_string_calls_total", "Number of calls of each string algorithm.", &Counters::calls},
+			{"better_string_input_bytes_total", "Number of bytes read by each string algorithm.", &Counters::input},
+			{"better_string_output_bytes_total", "Number of bytes returned by each string algorithm.", &Counters::output},
+			{"better_string_allocations_total", "Number of allocations made by each string algorithm.", &Counters::allocations},
+		};
+
+		std::string result;
+		char line[256];
+		for (auto & metric : metrics)
+		{
+			snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s counter\n", metric.name, metric.help, metric.name);
+			result += line;
+			for (size_t i = 0; i < algorithm_count; ++ i)
+			{
+				snprintf(line, sizeof(line), "%s{algorithm=\"%s\"} %llu\n",
+					metric.name, algorithm_names[i], (unsigned long long) (counters[i].*metric.field));
+				result += line;
+			}
+		}
+		return result;
+	}
+
+	/// Writes the counters as a JSON object (only the algorithms that were called).
+	auto json() const -> std::string
+	{
+		std::string result = "{";
+		char line[256];
+		for (size_t i = 0; i < algorithm_count; ++ i)
+		{
+			if (!counters[i].calls)
+				continue;
+			snprintf(line, sizeof(line), "%s\"%s\":{\"calls\":%llu,\"input_bytes\":%llu,\"output_bytes\":%llu,\"allocations\":%llu}",
+				(result.size() > 1) ? "," : "", algorithm_names[i],
+				(unsigned long long) counters[i].calls, (unsigned long long) counters[i].input,
+				(unsigned long long) counters[i].output, (unsigned long long) counters[i].allocations);
+			result += line;
+		}
+		return result + "}";
+	}
+};
+
+// Namespace for implementation details
+namespace impl {
+
+// Counters of one algorithm, in one thread (only the owner thread writes them)
+struct AtomicCounters
+{
+	std::atomic<uint64_t> calls {0};
+	std::atomic<uint64_t> input {0};
+	std::atomic<uint64_t> output {0};
+	std::atomic<uint64_t> allocations {0};
+};
+
+// Increments a counter of the current thread (a relaxed load and store is enough, only the owner writes it)
+inline void add(std::atomic<uint64_t> & counter, uint64_t value)
+	{counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);}
+
+// Counters of one thread
+class ThreadCounters;
+
+// List of threads, and the counters of finished threads
+class Registry
+{
+public:
+	std::mutex mutex;
+	std::vector<const ThreadCounters *> threads;
+	Snapshot finished;
+};
+
+inline auto registry() -> Registry &
+{
+	static Registry registry;
+	return registry;
+}
+
+class ThreadCounters
+{
+public:
+	// Fields
+	AtomicCounters counters[algorithm_count];
+
+	// Register the thread
+	ThreadCounters()
+	{
+		auto & list = registry();
+		std::lock_guard<std::mutex> lock(list.mutex);
+		list.threads.push_back(this);
+	}
+
+	// Unregister the thread, and keep its counters
+	~ThreadCounters()
+	{
+		auto & list = registry();
+		std::lock_guard<std::mutex> lock(list.mutex);
+		list.finished.merge(collect());
+		for (size_t i = 0; i < list.threads.size(); ++ i)
+			if (list.threads[i] == this)
+				{list.threads.erase(list.threads.begin() + i); break;}
+	}
+
+	// Read the counters
+	auto collect() const -> Snapshot
+	{
+		Snapshot result;
+		for (size_t i = 0; i < algorithm_count; ++ i)
+		{
+			result.counters[i].calls = counters[i].calls.load(std::memory_order_relaxed);
+			result.counters[i].input = counters[i].input.load(std::memory_order_relaxed);
+			result.counters[i].output = counters[i].output.load(std::memory_order_relaxed);
+			result.counters[i].allocations = counters[i].allocations.load(std::memory_order_relaxed);
+		}
+		return result;
+	}
+};
+
+// Counters of the current thread
+inline thread_local ThreadCounters thread_counters;
+
+// Size of strings in bytes
+template<typename String>
+auto bytes(const String & str) -> uint64_t
+	{return str.size() * sizeof(typename String::value_type);}
+
+// Size of lists of strings in bytes
+template<typename String, typename Allocator>
+auto bytes(const std::vector<String, Allocator> & list) -> uint64_t
+{
+	uint64_t result = 0;
+	for (auto & str : list)
+		result += bytes(str);
+	return result;
+}
+
+// Close namespace "impl"
+}
+
+/************************************************************
+ * @brief Counts one call of an algorithm (created by the `BETTER_STRING_PROBE` macro).
+ */
+class Probe
+{
+public:
+	// Count the call, and the input
+	Probe(Algorithm algorithm, uint64_t input)
+		: counters(impl::thread_counters.counters[size_t(algorithm)]), start(allocations)
+	{
+		impl::add(counters.calls, 1);
+		impl::add(counters.input, input);
+	}
+
+	// Count the allocations
+	~Probe()
+		{impl::add(counters.allocations, allocations - start);}
+
+	// Count the output
+	void output(uint64_t bytes)
+		{impl::add(counters.output, bytes);}
+
+	// Not copyable
+	Probe(const Probe &) = delete;
+	auto operator = (const Probe &) -> Probe & = delete;
+
+private:
+	// Fields
+	impl::AtomicCounters & counters;
+	uint64_t start;
+};
+
+/// Returns the counters of every thread (including the finished ones).
+inline auto snapshot() -> Snapshot
+{
+	auto & list = impl::registry();
+	std::lock_guard<std::mutex> lock(list.mutex);
+	Snapshot result = list.finished;
+	for (auto thread : list.threads)
+		result.merge(thread->collect());
+	return result;
+}
+
+/// Returns the counters of the current thread.
+inline auto local() -> Snapshot
+	{return impl::thread_counters.collect();}
+
+// Close namespace "instrument"
+}
+
+// Close namespace "ext"
+}
+
+// Probes (used in the algorithms)
+#define BETTER_STRING_PROBE(name, value) \
+	::ext::instrument::Probe probe__(::ext::instrument::Algorithm::name, ::ext::instrument::impl::bytes(value))
+#define BETTER_STRING_OUTPUT(value) \
+	probe__.output(::ext::instrument::impl::bytes(value))
+
+#else
+
+// Probes (disabled)
+#define BETTER_STRING_PROBE(name, value) ((void) 0)
+#define BETTER_STRING_OUTPUT(value) ((void) 0)
+
+#endif
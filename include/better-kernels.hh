@@ -0,0 +1,522 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Namespace for std extensions
+namespace ext {
+
+// Namespace for string kernels
+namespace kernels {
+
+/**
+ * @name String kernels
+ *
+ * The kernels are the hot loops of the string algorithms (search, validation, transcoding, case mapping, base64, hex
+ * and CSV), working on raw byte arrays. The portable versions are defined in this header, and used by default.
+ *
+ * The `better-string-kernels` library compiles the kernels once for each supported instruction set (SSE4.2, AVX2,
+ * AVX-512), and selects the fastest version supported by the processor at startup. Programs linking the library (which
+ * defines `BETTER_STRING_KERNELS`) use the selected kernels through @ref active(). The selection can be overridden with
+ * the `BETTER_STRING_ISA` environment variable (`scalar`, `sse4.2`, `avx2` or `avx512`). Translation units compiled
+ * without the define use the portable kernels.
+ */
+
+/// @{
+
+// Instruction sets
+enum class Isa : int32_t
+{
+	Scalar = 0,
+	SSE42  = 1,
+	AVX2   = 2,
+	AVX512 = 3,
+};
+
+// Number of instruction sets
+static constexpr size_t isa_count = 4;
+
+/************************************************************
+ * @brief Set of bytes, searched by @ref Table::find_any().
+ *
+ * The bits are arranged for the table lookups of the vector kernels: bit `h` of `low[l]` is the byte `h * 16 + l`, and
+ * bit `h` of `high[l]` is the byte `0x80 + h * 16 + l`.
+ */
+struct ByteSet
+{
+	uint8_t low[16];
+	uint8_t high[16];
+
+	/// Creates the set of the bytes matching a predicate (usually at compile time).
+	template<typename Predicate>
+	static constexpr auto of(Predicate predicate) -> ByteSet
+	{
+		ByteSet result {};
+		for (int ch = 0; ch < 256; ++ ch)
+			if (predicate(uint8_t(ch)))
+				(ch < 0x80 ? result.low : result.high)[ch & 0x0F] |= uint8_t(1 << ((ch >> 4) & 7));
+		return result;
+	}
+
+	/// Returns true, if the byte is in the set.
+	constexpr auto contains(uint8_t ch) const -> bool
+		{return ((ch < 0x80 ? low : high)[ch & 0x0F] >> ((ch >> 4) & 7)) & 1;}
+};
+
+/************************************************************
+ * @brief State of @ref Table::csv_index() between two calls.
+ */
+struct CsvState
+{
+	/// Inside of a quoted field.
+	bool quoted = false;
+	/// A quote would open a quoted field (at the start of a field, or after a closing quote, for doubled quotes).
+	bool open = true;
+};
+
+/************************************************************
+ * @brief Table of kernels, compiled for one instruction set.
+ *
+ * Positions are returned as offsets, or `size_t(-1)` when not found.
+ */
+struct Table
+{
+	// Instruction set
+	Isa isa;
+	const char * name;
+
+	// Search
+
+	/// Finds the first occurrence of a byte.
+	auto (* find_byte)(const char * data, size_t size, char ch) -> size_t;
+	/// Counts the occurrences of a byte.
+	auto (* count_byte)(const char * data, size_t size, char ch) -> size_t;
+	/// Finds the first byte, that is in the set.
+	auto (* find_any)(const char * data, size_t size, const ByteSet & set) -> size_t;
+	/// Finds the first occurrence of a substring.
+	auto (* find)(const char * data, size_t size, const char * sub, size_t length) -> size_t;
+
+	// Validation
+
+	/// Returns the number of ASCII characters at the start of the data.
+	auto (* ascii_prefix)(const char * data, size_t size) -> size_t;
+	/// Returns the number of codepoints in valid UTF-8 text, or `size_t(-1)` for invalid text.
+	auto (* utf8_length)(const char * data, size_t size) -> size_t;
+	/// Returns the number of UTF-16 units at the start of the data, before the first surrogate.
+	auto (* utf16_prefix)(const char16_t * data, size_t size) -> size_t;
+
+	// Escaping
+
+	/// Returns the number of bytes at the start of the data, that are not escaped by `repr()` (the escaped bytes are
+	/// quotes, backslashes and control characters, and with `ascii` the bytes above 0x7F too).
+	auto (* escape_prefix)(const char * data, size_t size, bool ascii) -> size_t;
+
+	// Transcoding
+
+	/// Widens ASCII characters to UTF-16.
+	void (* widen16)(const char * data, size_t size, char16_t * output);
+	/// Widens ASCII characters to UTF-32.
+	void (* widen32)(const char * data, size_t size, char32_t * output);
+
+	// Case mapping
+
+	/// Maps ASCII letters to upper case (other bytes are copied unchanged).
+	void (* upper)(const char * data, size_t size, char * output);
+	/// Maps ASCII letters to lower case (other bytes are copied unchanged).
+	void (* lower)(const char * data, size_t size, char * output);
+
+	// Binary to text
+
+	/// Encodes every whole group of 3 bytes to 4 base64 characters (with `url`, the URL and filename safe alphabet).
+	void (* b64encode)(const char * data, size_t size, char * output, bool url);
+	/// Decodes every whole group of 4 base64 characters to 3 bytes, and returns the number of bytes written, or
+	/// `size_t(-1)` when a character is not in the alphabet (padding included).
+	auto (* b64decode)(const char * data, size_t size, char * output, bool url) -> size_t;
+	/// Encodes every byte to 2 lower case hexadecimal digits.
+	void (* hexlify)(const char * data, size_t size, char * output);
+	/// Decodes every whole pair of hexadecimal digits (of either case) to a byte, and returns the number of bytes
+	/// written, or `size_t(-1)` when a character is not a digit.
+	auto (* unhexlify)(const char * data, size_t size, char * output) -> size_t;
+
+	// Parsing
+
+	/// Writes the positions of the separators and the line feeds, that are outside of quotes (at most `size`), and
+	/// returns their number. Quotes only open a quoted field at the start of a field, other quotes outside of quotes
+	/// are literal characters. `state` is the state at the start of the data, and is updated to the state at the end.
+	auto (* csv_index)(const char * data, size_t size, char sep, char quote, CsvState & state, uint32_t * output) -> size_t;
+};
+
+// -------------------- Portable kernels --------------------
+
+// Namespace for the portable kernels
+namespace scalar {
+
+// Mask of the high bits in a word
+static constexpr uint64_t high_bits = 0x8080808080808080ull;
+
+// Kernel - find_byte
+inline auto find_byte(const char * data, size_t size, char ch) -> size_t
+{
+	auto ptr = static_cast<const char *>(size ? memchr(data, ch, size) : nullptr);
+	return ptr ? size_t(ptr - data) : size_t(-1);
+}
+
+// Kernel - find_any
+inline auto find_any(const char * data, size_t size, const ByteSet & set) -> size_t
+{
+	for (size_t i = 0; i < size; ++ i)
+		if (set.contains(uint8_t(data[i])))
+			return i;
+	return size_t(-1);
+}
+
+// Kernel - count_byte
+inline auto count_byte(const char * data, size_t size, char ch) -> size_t
+{
+	size_t count = 0;
+	for (size_t i = 0; i < size; ++ i)
+		count += (data[i] == ch);
+	return count;
+}
+
+// Kernel - find
+inline auto find(const char * data, size_t size, const char * sub, size_t length) -> size_t
+{
+	// Check length
+	if (length == 0)
+		return 0;
+	if (size < length)
+		return size_t(-1);
+
+	// Find the first character, then compare the rest
+	size_t last = size - length;
+	for (size_t i = 0; i <= last; ++ i)
+	{
+		size_t pos = find_byte(data + i, last - i + 1, sub[0]);
+		if (pos == size_t(-1))
+			break;
+		i += pos;
+		if (memcmp(data + i + 1, sub + 1, length - 1) == 0)
+			return i;
+	}
+
+	// Not found
+	return size_t(-1);
+}
+
+// Kernel - ascii_prefix
+inline auto ascii_prefix(const char * data, size_t size) -> size_t
+{
+	// Check eight characters at a time
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8)
+	{
+		uint64_t word;
+		memcpy(&word, data + i, 8);
+		if (word & high_bits)
+			break;
+	}
+
+	// Check the rest
+	for (; i < size; ++ i)
+		if (uint8_t(data[i]) >= 0x80)
+			break;
+	return i;
+}
+
+// Kernel - utf8_length
+inline auto utf8_length(const char * data, size_t size) -> size_t
+{
+	auto ptr = reinterpret_cast<const uint8_t *>(data);
+	size_t length = 0;
+
+	for (size_t i = 0; i < size; ++ length)
+	{
+		// Skip ASCII characters
+		uint8_t ch = ptr[i];
+		if (ch < 0x80)
+		{
+			size_t n = ascii_prefix(data + i, size - i);
+			i += n;
+			length += n - 1;
+			continue;
+		}
+
+		// Check the lead byte (and the range of the second byte, to reject overlong forms and surrogates)
+		size_t tail;
+		uint8_t low = 0x80, high = 0xBF;
+		if (ch >= 0xC2 && ch <= 0xDF)
+			tail = 1;
+		else if (ch >= 0xE0 && ch <= 0xEF)
+		{
+			tail = 2;
+			low = (ch == 0xE0) ? 0xA0 : 0x80;
+			high = (ch == 0xED) ? 0x9F : 0xBF;
+		}
+		else if (ch >= 0xF0 && ch <= 0xF4)
+		{
+			tail = 3;
+			low = (ch == 0xF0) ? 0x90 : 0x80;
+			high = (ch == 0xF4) ? 0x8F : 0xBF;
+		}
+		else
+			return size_t(-1);
+
+		// Check the continuation bytes
+		if (size - i <= tail || ptr[i + 1] < low || ptr[i + 1] > high)
+			return size_t(-1);
+		for (size_t k = 2; k <= tail; ++ k)
+			if ((ptr[i + k] & 0xC0) != 0x80)
+				return size_t(-1);
+		i += tail + 1;
+	}
+
+	return length;
+}
+
+// Kernel - utf16_prefix
+inline auto utf16_prefix(const char16_t * data, size_t size) -> size_t
+{
+	// Check four units at a time (a unit is a surrogate, if its top five bits are 11011)
+	static constexpr uint64_t ones = 0x0001000100010001ull;
+	size_t i = 0;
+	for (; i + 4 <= size; i += 4)
+	{
+		uint64_t word;
+		memcpy(&word, data + i, 8);
+		word = (word & (ones * 0xF800)) ^ (ones * 0xD800);
+		if ((word - ones) & ~word & (ones * 0x8000))
+			break;
+	}
+
+	// Check the rest
+	for (; i < size; ++ i)
+		if ((data[i] & 0xF800) == 0xD800)
+			break;
+	return i;
+}
+
+// Kernel - escape_prefix
+inline auto escape_prefix(const char * data, size_t size, bool ascii) -> size_t
+{
+	// Check eight characters at a time (with the usual tricks for finding zero bytes, and bytes below a limit)
+	static constexpr uint64_t ones = 0x0101010101010101ull;
+	auto zero = [] (uint64_t word) {return (word - ones) & ~word & high_bits;};
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8)
+	{
+		uint64_t word;
+		memcpy(&word, data + i, 8);
+		uint64_t special = zero(word ^ (ones * '"')) | zero(word ^ (ones * '\'')) | zero(word ^ (ones * '\\')) |
+			((word - ones * 0x20) & ~word & high_bits) | (ascii ? word & high_bits : 0);
+		if (special)
+			break;
+	}
+
+	// Check the rest
+	for (; i < size; ++ i)
+	{
+		uint8_t ch = uint8_t(data[i]);
+		if (ch < 0x20 || ch == '"' || ch == '\'' || ch == '\\' || (ascii && ch >= 0x80))
+			break;
+	}
+	return i;
+}
+
+// Kernel - widen16
+inline void widen16(const char * data, size_t size, char16_t * output)
+{
+	for (size_t i = 0; i < size; ++ i)
+		output[i] = char16_t(uint8_t(data[i]));
+}
+
+// Kernel - widen32
+inline void widen32(const char * data, size_t size, char32_t * output)
+{
+	for (size_t i = 0; i < size; ++ i)
+		output[i] = char32_t(uint8_t(data[i]));
+}
+
+// Kernel - upper
+inline void upper(const char * data, size_t size, char * output)
+{
+	for (size_t i = 0; i < size; ++ i)
+		output[i] = (data[i] >= 'a' && data[i] <= 'z') ? char(data[i] - 0x20) : data[i];
+}
+
+// Kernel - lower
+inline void lower(const char * data, size_t size, char * output)
+{
+	for (size_t i = 0; i < size; ++ i)
+		output[i] = (data[i] >= 'A' && data[i] <= 'Z') ? char(data[i] + 0x20) : data[i];
+}
+
+// Base64 alphabets
+static constexpr char b64_standard[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static constexpr char b64_url[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+// Values of the characters of an alphabet (0xFF for the other characters)
+struct DigitValues
+{
+	uint8_t value[256];
+
+	// The alphabet is given by the digit of every value (`upper` adds the upper case letters as alternatives)
+	static constexpr auto of(const char * alphabet, size_t size, bool upper = false) -> DigitValues
+	{
+		DigitValues result {};
+		for (int ch = 0; ch < 256; ++ ch)
+			result.value[ch] = 0xFF;
+		for (size_t i = 0; i < size; ++ i)
+		{
+			result.value[uint8_t(alphabet[i])] = uint8_t(i);
+			if (upper && alphabet[i] >= 'a' && alphabet[i] <= 'z')
+				result.value[uint8_t(alphabet[i] - 0x20)] = uint8_t(i);
+		}
+		return result;
+	}
+};
+
+static constexpr DigitValues b64_standard_values = DigitValues::of(b64_standard, 64);
+static constexpr DigitValues b64_url_values = DigitValues::of(b64_url, 64);
+static constexpr DigitValues hex_values = DigitValues::of("0123456789abcdef", 16, true);
+
+// Kernel - b64encode
+inline void b64encode(const char * data, size_t size, char * output, bool url)
+{
+	const char * alphabet = url ? b64_url : b64_standard;
+	for (size_t i = 0; i + 3 <= size; i += 3, output += 4)
+	{
+		uint32_t group = uint32_t(uint8_t(data[i])) << 16 | uint32_t(uint8_t(data[i + 1])) << 8 | uint8_t(data[i + 2]);
+		output[0] = alphabet[group >> 18];
+		output[1] = alphabet[(group >> 12) & 0x3F];
+		output[2] = alphabet[(group >> 6) & 0x3F];
+		output[3] = alphabet[group & 0x3F];
+	}
+}
+
+// Kernel - b64decode
+inline auto b64decode(const char * data, size_t size, char * output, bool url) -> size_t
+{
+	auto & values = (url ? b64_url_values : b64_standard_values).value;
+	size_t count = 0;
+	for (size_t i = 0; i + 4 <= size; i += 4, count += 3)
+	{
+		uint8_t a = values[uint8_t(data[i])], b = values[uint8_t(data[i + 1])];
+		uint8_t c = values[uint8_t(data[i + 2])], d = values[uint8_t(data[i + 3])];
+		if ((a | b | c | d) & 0x80)
+			return size_t(-1);
+		uint32_t group = uint32_t(a) << 18 | uint32_t(b) << 12 | uint32_t(c) << 6 | d;
+		output[count] = char(group >> 16);
+		output[count + 1] = char(group >> 8);
+		output[count + 2] = char(group);
+	}
+	return count;
+}
+
+// Kernel - hexlify
+inline void hexlify(const char * data, size_t size, char * output)
+{
+	static constexpr char digits[] = "0123456789abcdef";
+	for (size_t i = 0; i < size; ++ i)
+	{
+		output[2 * i] = digits[uint8_t(data[i]) >> 4];
+		output[2 * i + 1] = digits[uint8_t(data[i]) & 0x0F];
+	}
+}
+
+// Kernel - unhexlify
+inline auto unhexlify(const char * data, size_t size, char * output) -> size_t
+{
+	for (size_t i = 0; i + 2 <= size; i += 2)
+	{
+		uint8_t high = hex_values.value[uint8_t(data[i])];
+		uint8_t low = hex_values.value[uint8_t(data[i + 1])];
+		if ((high | low) & 0x80)
+			return size_t(-1);
+		output[i / 2] = char(high << 4 | low);
+	}
+	return size / 2;
+}
+
+// Kernel - csv_index
+inline auto csv_index(const char * data, size_t size, char sep, char quote, CsvState & state, uint32_t * output) -> size_t
+{
+	size_t count = 0;
+	bool inside = state.quoted, open = state.open;
+	for (size_t i = 0; i < size; ++ i)
+	{
+		if (data[i] == quote)
+		{
+			// Inside of quotes every quote toggles the state, outside only the ones that may open a field do
+			bool active = inside || open;
+			inside = inside != active;
+			open = active;
+		}
+		else
+		{
+			open = !inside && (data[i] == sep || data[i] == '\n');
+			if (open)
+				output[count ++] = uint32_t(i);
+		}
+	}
+	state.quoted = inside;
+	state.open = open;
+	return count;
+}
+
+// Table of portable kernels
+inline auto table() -> const Table &
+{
+	static constexpr Table table = {
+		Isa::Scalar, "scalar",
+		find_byte, count_byte, find_any, find,
+		ascii_prefix, utf8_length, utf16_prefix,
+		escape_prefix,
+		widen16, widen32,
+		upper, lower,
+		b64encode, b64decode, hexlify, unhexlify,
+		csv_index,
+	};
+	return table;
+}
+
+// Close namespace "scalar"
+}
+
+// -------------------- Dispatch --------------------
+
+#if defined(BETTER_STRING_KERNELS)
+
+/// Returns the kernels selected at startup.
+auto active() -> const Table &;
+
+/// Returns the kernels for an instruction set, or `nullptr` when they are not compiled or not supported by the processor.
+auto table(Isa isa) -> const Table *;
+
+#else
+
+// The header only versions have other names than the ones of the library (in an inline namespace), so translation units
+// compiled with and without the library can be linked into one program
+inline namespace portable {
+
+/// Returns the kernels selected at startup (always the portable kernels, when the library is not linked).
+inline auto active() -> const Table &
+	{return scalar::table();}
+
+/// Returns the kernels for an instruction set, or `nullptr` when they are not compiled or not supported by the processor.
+inline auto table(Isa isa) -> const Table *
+	{return isa == Isa::Scalar ? &scalar::table() : nullptr;}
+
+// Close namespace "portable"
+}
+
+#endif
+
+/// @}
+
+// Close namespace "kernels"
+}
+
+// Close namespace "ext"
+}
@@ -0,0 +1,315 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <initializer_list>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "better-string.hh"
+
+// Namespace for std extensions
+namespace ext {
+
+/**
+ * @name N-gram index
+ *
+ * @ref ngram_index stores a collection of strings, and finds the ones that contain a substring without scanning all of
+ * them. For every trigram (three consecutive code units) it keeps a posting list: the sorted identifiers of the strings
+ * that contain it, as variable length deltas. A query intersects the posting lists of the trigrams of the substring,
+ * starting with the shortest one, and only the strings left are verified with @ref better_string_view::find.
+ *
+ * The trigrams are code units, so a substring is found in any encoding (a UTF-8 substring is a byte substring). The
+ * units of wide characters are folded into 21 bits, the colliding trigrams only add candidates, which are verified.
+ * Substrings shorter than three units have no trigrams, they are verified against every string.
+ *
+ * The strings are copied into a single buffer. Erased strings are only marked, and skipped by the queries, until
+ * @ref ngram_index::compact() removes them from the buffer and the posting lists (it is called automatically, when
+ * more than half of the strings are erased).
+ */
+
+/// @{
+
+// Namespace for implementation details
+namespace impl {
+
+// Posting list of a trigram (the identifiers of the strings, as LEB128 deltas)
+struct NgramPostings
+{
+	std::vector<uint8_t> data;
+	size_t last = 0;
+	size_t count = 0;
+
+	// Appends an identifier (greater than the last one)
+	void append(size_t id)
+	{
+		size_t delta = count ? id - last : id;
+		while (delta >= 0x80)
+		{
+			data.push_back(uint8_t(delta | 0x80));
+			delta >>= 7;
+		}
+		data.push_back(uint8_t(delta));
+		last = id;
+		++ count;
+	}
+
+	// Calls a function with every identifier (in increasing order), until it returns false
+	template<typename Function>
+	void each(Function function) const
+	{
+		size_t id = 0, pos = 0;
+		for (size_t i = 0; i < count; ++ i)
+		{
+			size_t delta = 0;
+			for (int shift = 0;; shift += 7)
+			{
+				uint8_t byte = data[pos ++];
+				delta |= size_t(byte & 0x7F) << shift;
+				if (!(byte & 0x80))
+					break;
+			}
+			id = i ? id + delta : delta;
+			if (!function(id))
+				return;
+		}
+	}
+};
+
+// Returns the key of the trigram at a position
+template<typename Char>
+auto ngram_key(const Char * data) -> uint64_t
+{
+	using Unit = typename std::make_unsigned<Char>::type;
+	if (sizeof(Char) == 1)
+		return (uint64_t(Unit(data[0])) << 16) | (uint64_t(Unit(data[1])) << 8) | uint64_t(Unit(data[2]));
+	return ((uint64_t(Unit(data[0])) & 0x1FFFFF) << 42) | ((uint64_t(Unit(data[1])) & 0x1FFFFF) << 21)
+		| (uint64_t(Unit(data[2])) & 0x1FFFFF);
+}
+
+// Collects the distinct trigram keys of a string
+template<typename Char>
+void ngram_keys(const Char * data, size_t size, std::vector<uint64_t> & keys)
+{
+	keys.clear();
+	for (size_t i = 0; i + 3 <= size; ++ i)
+		keys.push_back(ngram_key(data + i));
+	std::sort(keys.begin(), keys.end());
+	keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+}
+
+// Close namespace "impl"
+}
+
+/************************************************************
+ * @brief An index of strings by their trigrams, for substring queries (see the description of the module above).
+ *
+ * The identifiers of the strings are assigned in increasing order, and are never reused (not even by @ref compact()).
+ */
+template<typename Char>
+class ngram_index
+{
+public:
+	using view = better_string_view<Char>;
+
+	/// Creates an empty index.
+	ngram_index() = default;
+
+	/// Creates an index of strings (the identifiers follow the order of the list).
+	ngram_index(std::initializer_list<view> list)
+		{insert(list.begin(), list.end());}
+
+	/// Creates an index of strings, from a range of strings.
+	template<typename Iterator>
+	ngram_index(Iterator first, Iterator last)
+		{insert(first, last);}
+
+	/// Adds a string, and returns its identifier.
+	auto insert(view str) -> size_t
+	{
+		size_t id = starts.size() - 1;
+		buffer.extend(str.data(), str.size());
+		starts.push_back(buffer.size());
+		erased.push_back(false);
+		++ live;
+
+		impl::ngram_keys(str.data(), str.size(), keys);
+		for (uint64_t key : keys)
+			postings[key].append(id);
+		return id;
+	}
+
+	/// Adds a range of strings (the identifiers follow the order of the range).
+	template<typename Iterator>
+	void insert(Iterator first, Iterator last)
+	{
+		for (; first != last; ++ first)
+			insert(view(*first));
+	}
+
+	/// Removes a string. Returns false, if there is no string with the identifier.
+	auto erase(size_t id) -> bool
+	{
+		if (!contains(id))
+			return false;
+		erased[id] = true;
+		-- live;
+		if (erased_count() > live && erased_count() >= 64)
+			compact();
+		return true;
+	}
+
+	/// Returns true, if there is a string with the identifier.
+	auto contains(size_t id) const -> bool
+		{return id < erased.size() && !erased[id];}
+
+	/// Returns a string (the view is valid until the next change of the index).
+	auto operator [] (size_t id) const -> view
+		{return view(buffer.data() + starts[id], starts[id + 1] - starts[id]);}
+
+	/// Returns the number of strings.
+	auto size() const -> size_t
+		{return live;}
+
+	/// Returns true, if there are no strings.
+	auto empty() const -> bool
+		{return live == 0;}
+
+	/// Returns the identifiers of the strings that contain a substring (in increasing order).
+	auto search(view sub) const -> std::vector<size_t>
+	{
+		std::vector<size_t> result;
+		search_into(sub, result);
+		return result;
+	}
+
+	/// A version of @ref search(), that appends to an existing list (reusing its capacity).
+	auto search_into(view sub, std::vector<size_t> & output) const -> std::vector<size_t> &
+		{return search_if(sub, [sub] (view str) {return str.find(sub) != view::npos;}, output);}
+
+	/**
+	 * @brief Returns the identifiers of the strings that contain a literal, and match a predicate (in increasing
+	 * order). The predicate is only called with the strings that contain the literal.
+	 *
+	 * This answers queries that require a literal, like a regex and its @ref regex::required() literal:
+	 * `index.search_if(re.required(), [&] (auto str) {return bool(re.search(str));}, ids)`.
+	 */
+	template<typename Predicate>
+	auto search_if(view literal, Predicate predicate, std::vector<size_t> & output) const -> std::vector<size_t> &
+	{
+		size_t start = output.size();
+		candidates(literal, output);
+		size_t count = start;
+		for (size_t i = start; i < output.size(); ++ i)
+			if (predicate((*this)[output[i]]))
+				output[count ++] = output[i];
+		output.resize(count);
+		return output;
+	}
+
+	/// Removes the erased strings from the buffer and the posting lists (the identifiers do not change).
+	void compact()
+	{
+		// The buffer (the erased strings become empty)
+		better_string<Char> packed;
+		packed.reserve(buffer.size());
+		size_t begin = starts[0];
+		for (size_t id = 0; id < erased.size(); ++ id)
+		{
+			size_t end = starts[id + 1];
+			if (!erased[id])
+				packed.extend(buffer.data() + begin, end - begin);
+			begin = end;
+			starts[id + 1] = packed.size();
+		}
+		buffer = std::move(packed);
+
+		// The posting lists (the empty ones are removed)
+		for (auto iter = postings.begin(); iter != postings.end();)
+		{
+			impl::NgramPostings kept;
+			iter->second.each([&] (size_t id) {if (!erased[id]) kept.append(id); return true;});
+			kept.data.shrink_to_fit();
+			if (kept.count)
+				(iter ++)->second = std::move(kept);
+			else
+				iter = postings.erase(iter);
+		}
+		dead_before = std::count(erased.begin(), erased.end(), true);
+	}
+
+	/// Returns the number of bytes used by the strings and the posting lists (an estimate of the heap usage).
+	auto memory() const -> size_t
+	{
+		size_t total = buffer.capacity() * sizeof(Char) + starts.capacity() * sizeof(size_t) + erased.capacity() / 8;
+		for (auto & item : postings)
+			total += item.second.data.capacity() + sizeof(item) + 2 * sizeof(void *);
+		return total + postings.bucket_count() * sizeof(void *);
+	}
+
+private:
+	// Returns the number of erased strings, that are still in the buffer
+	auto erased_count() const -> size_t
+		{return erased.size() - live - dead_before;}
+
+	// Collects the live strings that contain every trigram of a literal
+	void candidates(view literal, std::vector<size_t> & output) const
+	{
+		size_t start = output.size();
+		if (literal.size() < 3)
+		{
+			for (size_t id = 0; id < erased.size(); ++ id)
+				if (!erased[id])
+					output.push_back(id);
+			return;
+		}
+
+		// The posting lists, from the shortest one (any missing trigram means no candidates)
+		std::vector<uint64_t> keys;
+		impl::ngram_keys(literal.data(), literal.size(), keys);
+		std::vector<const impl::NgramPostings *> lists;
+		for (uint64_t key : keys)
+		{
+			auto found = postings.find(key);
+			if (found == postings.end())
+				return;
+			lists.push_back(&found->second);
+		}
+		std::sort(lists.begin(), lists.end(), [] (auto a, auto b) {return a->count < b->count;});
+
+		lists[0]->each([&] (size_t id) {if (!erased[id]) output.push_back(id); return true;});
+		for (size_t i = 1; i < lists.size() && output.size() > start; ++ i)
+		{
+			// Merge the candidates with the next list (stops at the end of the candidates)
+			size_t pos = start, count = start;
+			lists[i]->each([&] (size_t id) {
+				while (pos < output.size() && output[pos] < id)
+					++ pos;
+				if (pos == output.size())
+					return false;
+				if (output[pos] == id)
+					output[count ++] = output[pos ++];
+				return true;
+			});
+			output.resize(count);
+		}
+	}
+
+	// Fields
+	better_string<Char> buffer;
+	std::vector<size_t> starts = {0};
+	std::vector<bool> erased;
+	size_t live = 0;
+	size_t dead_before = 0;
+	std::unordered_map<uint64_t, impl::NgramPostings> postings;
+	std::vector<uint64_t> keys;
+};
+
+/// @}
+
+// Close namespace "ext"
+}
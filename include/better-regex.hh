@@ -0,0 +1,1977 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "better-string.hh"
+
+// Namespace for std extensions
+namespace ext {
+
+/**
+ * @name Regular expressions
+ *
+ * @ref regex compiles a pattern (in the syntax of Python's `re` module, without backreferences and lookaround) to a
+ * program for an automaton over bytes. In UTF-8 mode (the default) the pattern and the text are UTF-8, and the
+ * character classes are compiled to the byte sequences of their codepoints, otherwise every byte is a character.
+ *
+ * Searches never backtrack, so their time is linear in the length of the text, whatever the pattern is. The end of the
+ * leftmost match is found by a lazy DFA (its states are built while searching, and cached), and its start by a DFA of
+ * the reversed pattern, running backwards from the end. The capture groups are only computed when they are used, by
+ * simulating the NFA over the match. Before searching, the literal that every match contains is looked for with the
+ * string kernels, and the DFA skips to the occurrences of the literal prefix of the pattern.
+ *
+ * Matches are leftmost-first (like Perl and Python): alternatives are tried in order, and greedy repetitions are as
+ * long as possible. As in Python, an optional iteration that matches the empty string ends its repetition (and sets
+ * its groups), so the body of a repetition that can be empty is compiled twice. `^` and `$` match only at the start
+ * and the end of the text, unless the `Multiline` flag is set, and `\w`, `\d`, `\s`, `\b` and case folding only
+ * know ASCII characters.
+ */
+
+/// @{
+
+class regex;
+class regex_match;
+
+// -------------------- Syntax --------------------
+
+// Namespace for implementation details
+namespace impl {
+
+// Zero width assertions (evaluated with the bytes before and after the position)
+enum class RegexAssert : uint8_t
+{
+	BeginText,
+	EndText,
+	BeginLine,
+	EndLine,
+	WordBoundary,
+	NotWordBoundary,
+};
+
+// Sorted list of codepoint (or byte) ranges
+using RegexRanges = std::vector<std::pair<uint32_t, uint32_t>>;
+
+// Node of a parsed pattern
+struct RegexNode
+{
+	enum Kind : uint8_t {Empty, Class, Concat, Alternate, Repeat, Group, Assert};
+
+	Kind kind = Empty;
+	RegexRanges ranges;	// Class
+	std::vector<RegexNode> children;	// Concat, Alternate, Repeat and Group
+	int32_t min = 0;	// Repeat
+	int32_t max = 0;	// Repeat (-1 for no limit)
+	bool greedy = true;	// Repeat
+	bool literal = false;	// Class: a single character, without case folding
+	size_t group = 0;	// Group: index of the capture group
+	RegexAssert assertion = RegexAssert::BeginText;	// Assert
+};
+
+// Returns true, if the byte is a word character
+inline auto regex_word(uint8_t ch) -> bool
+	{return (ch >= '0' && ch <= '9') || (ch >= 'A' && ch <= 'Z') || (ch >= 'a' && ch <= 'z') || ch == '_';}
+
+// Sorts and merges ranges
+inline void regex_normalize(RegexRanges & ranges)
+{
+	std::sort(ranges.begin(), ranges.end());
+	size_t count = 0;
+	for (auto & range : ranges)
+	{
+		if (count && range.first <= ranges[count - 1].second + 1)
+			ranges[count - 1].second = std::max(ranges[count - 1].second, range.second);
+		else
+			ranges[count ++] = range;
+	}
+	ranges.resize(count);
+}
+
+// Returns the ranges not in a (normalized) list, up to a maximum
+inline auto regex_complement(const RegexRanges & ranges, uint32_t max) -> RegexRanges
+{
+	RegexRanges result;
+	uint32_t next = 0;
+	for (auto & range : ranges)
+	{
+		if (range.first > next)
+			result.push_back({next, range.first - 1});
+		next = range.second + 1;
+	}
+	if (next <= max)
+		result.push_back({next, max});
+	return result;
+}
+
+// Adds the other case of the ASCII letters
+inline void regex_fold(RegexRanges & ranges)
+{
+	size_t count = ranges.size();
+	for (size_t i = 0; i < count; ++ i)
+	{
+		uint32_t lo = ranges[i].first, hi = ranges[i].second;
+		if (lo <= 'z' && hi >= 'a')
+			ranges.push_back({std::max<uint32_t>(lo, 'a') - 0x20, std::min<uint32_t>(hi, 'z') - 0x20});
+		if (lo <= 'Z' && hi >= 'A')
+			ranges.push_back({std::max<uint32_t>(lo, 'A') + 0x20, std::min<uint32_t>(hi, 'Z') + 0x20});
+	}
+	regex_normalize(ranges);
+}
+
+/************************************************************
+ * @brief Parser of regex patterns (recursive descent).
+ */
+class RegexParser
+{
+public:
+	// Results
+	size_t groups = 1;
+	std::vector<std::pair<std::string, size_t>> names;
+
+	// Constructors
+	RegexParser(const char * data, size_t size, bool utf8)
+		: data(data), size(size), utf8(utf8) {}
+
+	/// Parses the whole pattern.
+	auto parse(bool icase, bool multiline, bool dotall) -> RegexNode
+	{
+		Flags flags {icase, multiline, dotall};
+		RegexNode node = alternation(flags);
+		if (pos < size)
+			error("Unbalanced parenthesis!");
+		return node;
+	}
+
+private:
+	// Flags of a group
+	struct Flags
+	{
+		bool icase;
+		bool multiline;
+		bool dotall;
+	};
+
+	// Reports a syntax error
+	[[noreturn]] static void error(const char * message)
+		{throw std::invalid_argument(std::string("regex(): pattern: ") + message);}
+
+	// Look ahead
+	auto peek(size_t offset = 0) const -> int
+		{return (pos + offset < size) ? uint8_t(data[pos + offset]) : -1;}
+
+	// Reads a character (a codepoint in UTF-8 mode)
+	auto next_char() -> uint32_t
+	{
+		uint8_t ch = uint8_t(data[pos ++]);
+		if (!utf8 || ch < 0x80)
+			return ch;
+
+		size_t tail = (ch >= 0xF0) ? 3 : (ch >= 0xE0) ? 2 : 1;
+		if (pos + tail > size || kernels::scalar::utf8_length(data + pos - 1, tail + 1) != 1)
+			error("Invalid UTF-8!");
+		uint32_t cp = ch & (0x3F >> tail);
+		for (size_t i = 0; i < tail; ++ i)
+			cp = (cp << 6) | (uint8_t(data[pos ++]) & 0x3F);
+		return cp;
+	}
+
+	// Largest character
+	auto max_char() const -> uint32_t
+		{return utf8 ? 0x10FFFF : 0xFF;}
+
+	// Creates a class node (a literal is a class of one character)
+	auto make_class(RegexRanges ranges, const Flags & flags, bool literal = false) const -> RegexNode
+	{
+		RegexNode node;
+		node.kind = RegexNode::Class;
+		regex_normalize(ranges);
+		if (flags.icase)
+		{
+			size_t count = ranges.size();
+			regex_fold(ranges);
+			literal = literal && ranges.size() == count && ranges[0].first == ranges[0].second;
+		}
+		node.ranges = std::move(ranges);
+		node.literal = literal;
+		return node;
+	}
+
+	// Creates an assertion node
+	static auto make_assert(RegexAssert assertion) -> RegexNode
+	{
+		RegexNode node;
+		node.kind = RegexNode::Assert;
+		node.assertion = assertion;
+		return node;
+	}
+
+	// Parses hexadecimal digits (with `braces`, up to the closing brace)
+	auto hex(size_t digits, bool braces) -> uint32_t
+	{
+		uint32_t value = 0;
+		size_t count = 0;
+		for (; braces ? peek() != '}' : count < digits; ++ count)
+		{
+			int ch = peek();
+			uint8_t digit = (ch < 0) ? 0xFF : kernels::scalar::hex_values.value[ch];
+			if (digit == 0xFF || count == 8)
+				error("Invalid escape sequence!");
+			value = (value << 4) | digit;
+			++ pos;
+		}
+		if (braces && (count == 0 || peek() != '}'))
+			error("Invalid escape sequence!");
+		pos += braces;
+		if (value > max_char())
+			error("Character out of range!");
+		return value;
+	}
+
+	// Parses an escape sequence of a class (\d, \w, \s), returns false for other escapes
+	auto class_escape(int ch, RegexRanges & ranges) const -> bool
+	{
+		RegexRanges result;
+		switch (ch | 0x20)
+		{
+		case 'd':
+			result = {{'0', '9'}};
+			break;
+		case 'w':
+			result = {{'0', '9'}, {'A', 'Z'}, {'_', '_'}, {'a', 'z'}};
+			break;
+		case 's':
+			result = {{'\t', '\r'}, {' ', ' '}};
+			break;
+		default:
+			return false;
+		}
+		if (ch & 0x20)
+			ranges.insert(ranges.end(), result.begin(), result.end());
+		else
+		{
+			result = regex_complement(result, max_char());
+			ranges.insert(ranges.end(), result.begin(), result.end());
+		}
+		return true;
+	}
+
+	// Parses the character of an escape sequence (after the backslash)
+	auto escape_char(bool in_class) -> uint32_t
+	{
+		if (pos == size)
+			error("Trailing backslash!");
+		int ch = peek();
+		if (ch >= '1' && ch <= '9')
+			error("Backreferences are not supported!");
+		if (ch < 0x80 && ((ch | 0x20) >= 'a' && (ch | 0x20) <= 'z'))
+		{
+			++ pos;
+			switch (ch)
+			{
+			case 'n': return '\n';
+			case 't': return '\t';
+			case 'r': return '\r';
+			case 'f': return '\f';
+			case 'v': return '\v';
+			case 'a': return '\a';
+			case 'b': if (in_class) return '\b'; break;
+			case 'x': return (peek() == '{') ? (++ pos, hex(0, true)) : hex(2, false);
+			case 'u': return hex(4, false);
+			case 'U': return hex(8, false);
+			}
+			error("Invalid escape sequence!");
+		}
+		if (ch == '0')
+			return ++ pos, 0;
+		return next_char();
+	}
+
+	// Parses alternatives
+	auto alternation(Flags flags) -> RegexNode
+	{
+		RegexNode node = concatenation(flags);
+		if (peek() != '|')
+			return node;
+
+		RegexNode result;
+		result.kind = RegexNode::Alternate;
+		result.children.push_back(std::move(node));
+		while (peek() == '|')
+		{
+			++ pos;
+			result.children.push_back(concatenation(flags));
+		}
+		return result;
+	}
+
+	// Parses a sequence of repeated atoms
+	auto concatenation(Flags & flags) -> RegexNode
+	{
+		RegexNode result;
+		result.kind = RegexNode::Concat;
+		while (pos < size && peek() != '|' && peek() != ')')
+		{
+			if (inline_flags(flags))
+				continue;
+			RegexNode node = atom(flags);
+			repetition(node);
+			result.children.push_back(std::move(node));
+		}
+		if (result.children.size() == 1)
+			return std::move(result.children[0]);
+		if (result.children.empty())
+			result.kind = RegexNode::Empty;
+		return result;
+	}
+
+	// Parses flags for the rest of the group, like (?i), returns false for other syntax
+	auto inline_flags(Flags & flags) -> bool
+	{
+		if (peek() != '(' || peek(1) != '?')
+			return false;
+		size_t end = pos + 2;
+		while (end < size && (data[end] == 'i' || data[end] == 'm' || data[end] == 's'))
+			++ end;
+		if (end == pos + 2 || end == size || data[end] != ')')
+			return false;
+		for (size_t i = pos + 2; i < end; ++ i)
+			(data[i] == 'i' ? flags.icase : data[i] == 'm' ? flags.multiline : flags.dotall) = true;
+		pos = end + 1;
+		return true;
+	}
+
+	// Parses the quantifiers of an atom
+	void repetition(RegexNode & node)
+	{
+		int32_t min, max;
+		int ch = peek();
+		if (ch == '*')
+			min = 0, max = -1, ++ pos;
+		else if (ch == '+')
+			min = 1, max = -1, ++ pos;
+		else if (ch == '?')
+			min = 0, max = 1, ++ pos;
+		else if (ch != '{' || !counts(min, max))
+			return;
+
+		if (node.kind == RegexNode::Assert || node.kind == RegexNode::Empty)
+			error("Nothing to repeat!");
+		RegexNode result;
+		result.kind = RegexNode::Repeat;
+		result.min = min;
+		result.max = max;
+		result.greedy = (peek() != '?');
+		pos += !result.greedy;
+		result.children.push_back(std::move(node));
+		node = std::move(result);
+
+		ch = peek();
+		if (ch == '*' || ch == '+' || ch == '?' || (ch == '{' && counts(min, max)))
+			error("Multiple repeat!");
+	}
+
+	// Parses a counted repetition like {2,5} (anything else is not a repetition, and is left unparsed)
+	auto counts(int32_t & min, int32_t & max) -> bool
+	{
+		size_t start = pos;
+		auto number = [&] (int32_t & value) {
+			size_t first = ++ pos;
+			for (value = 0; peek() >= '0' && peek() <= '9'; ++ pos)
+				value = std::min(value * 10 + (peek() - '0'), 100000);
+			return pos > first;
+		};
+
+		bool has_min = number(min);
+		max = min;
+		if (peek() == ',')
+		{
+			if (!number(max))
+				max = -1;
+		}
+		if (peek() != '}' || (!has_min && max < 0))
+		{
+			pos = start;
+			return false;
+		}
+		++ pos;
+		if (!has_min)
+			min = 0;
+		if (min > 1000 || max > 1000)
+			error("Repetition count too large!");
+		if (max >= 0 && max < min)
+			error("Invalid repetition range!");
+		return true;
+	}
+
+	// Parses an atom (a character, a class, a group or an assertion)
+	auto atom(const Flags & flags) -> RegexNode
+	{
+		int ch = peek();
+		switch (ch)
+		{
+		case '(':
+			return group(flags);
+		case '[':
+			++ pos;
+			return character_class(flags);
+		case '.':
+			++ pos;
+			return make_class(flags.dotall ? RegexRanges {{0, max_char()}} : RegexRanges {{0, '\n' - 1}, {'\n' + 1, max_char()}}, flags);
+		case '^':
+			++ pos;
+			return make_assert(flags.multiline ? RegexAssert::BeginLine : RegexAssert::BeginText);
+		case '$':
+			++ pos;
+			return make_assert(flags.multiline ? RegexAssert::EndLine : RegexAssert::EndText);
+		case '*':
+		case '+':
+		case '?':
+			error("Nothing to repeat!");
+		case '\\':
+		{
+			++ pos;
+			int next = peek();
+			if (next == 'b' || next == 'B' || next == 'A' || next == 'z' || next == 'Z')
+			{
+				++ pos;
+				return make_assert(next == 'b' ? RegexAssert::WordBoundary : next == 'B' ? RegexAssert::NotWordBoundary :
+					next == 'A' ? RegexAssert::BeginText : RegexAssert::EndText);
+			}
+			RegexRanges ranges;
+			if (next >= 0 && class_escape(next, ranges))
+			{
+				++ pos;
+				return make_class(std::move(ranges), flags);
+			}
+			uint32_t cp = escape_char(false);
+			return make_class({{cp, cp}}, flags, true);
+		}
+		default:
+		{
+			uint32_t cp = next_char();
+			return make_class({{cp, cp}}, flags, true);
+		}
+		}
+	}
+
+	// Parses a group (after the opening parenthesis)
+	auto group(Flags flags) -> RegexNode
+	{
+		++ pos;
+		RegexNode node;
+		node.kind = RegexNode::Group;
+		node.group = 0;
+
+		if (peek() == '?')
+		{
+			++ pos;
+			int ch = peek();
+			if ((ch == 'P' && peek(1) == '<') || (ch == '<' && peek(1) != '=' && peek(1) != '!'))
+			{
+				// Named group
+				pos += (ch == 'P') ? 2 : 1;
+				size_t start = pos;
+				while (pos < size && (regex_word(uint8_t(data[pos])) || uint8_t(data[pos]) >= 0x80))
+					++ pos;
+				if (pos == start || peek() != '>' || (data[start] >= '0' && data[start] <= '9'))
+					error("Invalid group name!");
+				std::string name(data + start, pos - start);
+				for (auto & item : names)
+					if (item.first == name)
+						error("Duplicate group name!");
+				names.push_back({name, groups});
+				++ pos;
+				node.group = groups ++;
+			}
+			else
+			{
+				// Flags of the group (like (?i:x)), or a non-capturing group
+				while (ch == 'i' || ch == 'm' || ch == 's')
+				{
+					(ch == 'i' ? flags.icase : ch == 'm' ? flags.multiline : flags.dotall) = true;
+					ch = (++ pos, peek());
+				}
+				if (ch != ':')
+					error((ch == '=' || ch == '!' || ch == '<') ? "Lookaround is not supported!" : "Unknown extension!");
+				++ pos;
+			}
+		}
+		else
+			node.group = groups ++;
+
+		node.children.push_back(alternation(flags));
+		if (peek() != ')')
+			error("Missing closing parenthesis!");
+		++ pos;
+		return node;
+	}
+
+	// Parses a character class (after the opening bracket)
+	auto character_class(const Flags & flags) -> RegexNode
+	{
+		bool negate = (peek() == '^');
+		pos += negate;
+
+		RegexRanges ranges;
+		for (bool first = true; first || peek() != ']'; first = false)
+		{
+			if (pos == size)
+				error("Missing closing bracket!");
+
+			// A class escape, or the first character of a range
+			uint32_t lo;
+			if (peek() == '\\')
+			{
+				++ pos;
+				if (peek() >= 0 && class_escape(peek(), ranges))
+				{
+					++ pos;
+					continue;
+				}
+				lo = escape_char(true);
+			}
+			else
+				lo = next_char();
+
+			// The last character of a range
+			uint32_t hi = lo;
+			if (peek() == '-' && peek(1) != ']' && peek(1) >= 0)
+			{
+				++ pos;
+				if (peek() == '\\')
+				{
+					++ pos;
+					hi = escape_char(true);
+				}
+				else
+					hi = next_char();
+				if (hi < lo)
+					error("Invalid character range!");
+			}
+			ranges.push_back({lo, hi});
+		}
+		++ pos;
+
+		// Case folding is applied before the negation
+		regex_normalize(ranges);
+		if (flags.icase)
+			regex_fold(ranges);
+		if (negate)
+			ranges = regex_complement(ranges, max_char());
+		RegexNode node;
+		node.kind = RegexNode::Class;
+		node.ranges = std::move(ranges);
+		return node;
+	}
+
+	// Fields
+	const char * data;
+	size_t size;
+	size_t pos = 0;
+	bool utf8;
+};
+
+// -------------------- Compiler --------------------
+
+// Encodes a codepoint to UTF-8
+inline auto regex_encode(uint32_t cp, uint8_t * bytes) -> size_t
+{
+	if (cp < 0x80)
+		return bytes[0] = uint8_t(cp), 1;
+	if (cp < 0x800)
+		return bytes[0] = uint8_t(0xC0 | (cp >> 6)), bytes[1] = uint8_t(0x80 | (cp & 0x3F)), 2;
+	if (cp < 0x10000)
+		return bytes[0] = uint8_t(0xE0 | (cp >> 12)), bytes[1] = uint8_t(0x80 | ((cp >> 6) & 0x3F)), bytes[2] = uint8_t(0x80 | (cp & 0x3F)), 3;
+	bytes[0] = uint8_t(0xF0 | (cp >> 18));
+	bytes[1] = uint8_t(0x80 | ((cp >> 12) & 0x3F));
+	bytes[2] = uint8_t(0x80 | ((cp >> 6) & 0x3F));
+	bytes[3] = uint8_t(0x80 | (cp & 0x3F));
+	return 4;
+}
+
+// Instruction of a regex program
+struct RegexInst
+{
+	enum Op : uint8_t {Range, Split, Jump, Save, Assert, Match};
+
+	Op op;
+	uint8_t lo;	// Range
+	uint8_t hi;	// Range
+	RegexAssert assertion;	// Assert
+	uint32_t x;	// Range (next instruction), Split (preferred), Jump (target), Save (slot)
+	uint32_t y;	// Split (other)
+};
+
+/************************************************************
+ * @brief Program of a pattern, for the DFA and the NFA simulation.
+ *
+ * Forward programs start with a loop, that skips any byte (lazily) before the pattern, for unanchored searches. The
+ * bytes are divided into classes, that every instruction handles the same way (the DFA has a transition per class).
+ */
+struct RegexProgram
+{
+	std::vector<RegexInst> code;
+	uint32_t start = 0;	// Anchored start
+	uint32_t loop = 0;	// Unanchored start
+	size_t slots = 2;
+	bool asserts = false;
+	uint8_t classes[256] = {};
+	uint8_t representatives[256] = {};
+	size_t class_count = 1;
+
+	// Limit of the program size
+	static constexpr size_t max_size = 200000;
+};
+
+/************************************************************
+ * @brief Compiles a parsed pattern to a program (the reversed pattern for the backward DFA).
+ */
+class RegexCompiler
+{
+public:
+	RegexCompiler(RegexProgram & program, bool utf8, bool reverse)
+		: program(program), utf8(utf8), reverse(reverse) {}
+
+	/// Compiles the pattern (forward programs with the capture of the whole match, and the unanchored loop).
+	void compile(const RegexNode & node, size_t groups)
+	{
+		if (!reverse)
+		{
+			add({RegexInst::Split, 0, 0, {}, 2, 1});
+			add({RegexInst::Range, 0x00, 0xFF, {}, 0, 0});
+			program.loop = 0;
+			program.start = 2;
+			add({RegexInst::Save, 0, 0, {}, 0, 0});
+		}
+		emit(node);
+		if (!reverse)
+			add({RegexInst::Save, 0, 0, {}, 1, 0});
+		add({RegexInst::Match, 0, 0, {}, 0, 0});
+		program.slots = 2 * groups;
+		classify();
+	}
+
+private:
+	// A UTF-8 sequence of byte ranges
+	struct Sequence
+	{
+		size_t length;
+		uint8_t lo[4];
+		uint8_t hi[4];
+	};
+
+	// Adds an instruction
+	auto add(RegexInst inst) -> uint32_t
+	{
+		if (program.code.size() >= RegexProgram::max_size)
+			throw std::invalid_argument("regex(): pattern: Pattern too large!");
+		uint32_t pc = uint32_t(program.code.size());
+		program.code.push_back(inst);
+		return pc;
+	}
+
+	// Current position
+	auto here() const -> uint32_t
+		{return uint32_t(program.code.size());}
+
+	// Splits a codepoint range into UTF-8 sequences of byte ranges (as in Rust's utf8-ranges)
+	static void sequences(uint32_t lo, uint32_t hi, std::vector<Sequence> & result)
+	{
+		// Split at the limits of the encoded lengths
+		for (uint32_t limit : {0x7Fu, 0x7FFu, 0xFFFFu})
+			if (lo <= limit && hi > limit)
+			{
+				sequences(lo, limit, result);
+				sequences(limit + 1, hi, result);
+				return;
+			}
+
+		// Split until every continuation byte covers a whole range
+		for (int i = 1; i < 4 && hi >= 0x80; ++ i)
+		{
+			uint32_t mask = (1u << (6 * i)) - 1;
+			if ((lo & ~mask) == (hi & ~mask))
+				continue;
+			if (lo & mask)
+			{
+				sequences(lo, lo | mask, result);
+				sequences((lo | mask) + 1, hi, result);
+				return;
+			}
+			if ((hi & mask) != mask)
+			{
+				sequences(lo, (hi & ~mask) - 1, result);
+				sequences(hi & ~mask, hi, result);
+				return;
+			}
+		}
+
+		Sequence sequence;
+		sequence.length = regex_encode(lo, sequence.lo);
+		regex_encode(hi, sequence.hi);
+		result.push_back(sequence);
+	}
+
+	// Emits the instructions of a node
+	void emit(const RegexNode & node)
+	{
+		switch (node.kind)
+		{
+		case RegexNode::Empty:
+			break;
+		case RegexNode::Class:
+			emit_class(node.ranges);
+			break;
+		case RegexNode::Concat:
+			if (reverse)
+				for (size_t i = node.children.size(); i -- > 0; )
+					emit(node.children[i]);
+			else
+				for (auto & child : node.children)
+					emit(child);
+			break;
+		case RegexNode::Alternate:
+		{
+			std::vector<uint32_t> jumps;
+			for (size_t i = 0; i + 1 < node.children.size(); ++ i)
+			{
+				uint32_t split = add({RegexInst::Split, 0, 0, {}, 0, 0});
+				program.code[split].x = here();
+				emit(node.children[i]);
+				jumps.push_back(add({RegexInst::Jump, 0, 0, {}, 0, 0}));
+				program.code[split].y = here();
+			}
+			emit(node.children.back());
+			for (uint32_t jump : jumps)
+				program.code[jump].x = here();
+			break;
+		}
+		case RegexNode::Repeat:
+			emit_repeat(node);
+			break;
+		case RegexNode::Group:
+			if (!reverse && node.group)
+				add({RegexInst::Save, 0, 0, {}, uint32_t(2 * node.group), 0});
+			emit(node.children[0]);
+			if (!reverse && node.group)
+				add({RegexInst::Save, 0, 0, {}, uint32_t(2 * node.group + 1), 0});
+			break;
+		case RegexNode::Assert:
+			add({RegexInst::Assert, 0, 0, node.assertion, 0, 0});
+			program.asserts = true;
+			break;
+		}
+	}
+
+	// Emits a repetition (the node is emitted once for every required and every optional repeat)
+	void emit_repeat(const RegexNode & node)
+	{
+		auto & child = node.children[0];
+		uint32_t last = here();
+		for (int32_t i = 0; i < node.min; ++ i)
+		{
+			last = here();
+			emit(child);
+		}
+
+		// Like in Python, an optional repeat that matched the empty string ends the repetition (so its groups are
+		// set, and the repeats after it are not tried). The forward program has two copies of the optional repeats of
+		// bodies that can match the empty string: one until a byte is matched (its end leaves the repetition), and one
+		// after it (its end repeats). The backward program only needs the same language.
+		bool empty = !reverse && nullable(child);
+		std::vector<uint32_t> exits;
+
+		// Unlimited: a loop back to the last copy (or a loop around a new copy)
+		auto split = [&] (uint32_t split, uint32_t body, uint32_t out) {
+			program.code[split].x = node.greedy ? body : out;
+			program.code[split].y = node.greedy ? out : body;
+		};
+		if (node.max < 0)
+		{
+			if (node.min > 0 && !empty)
+			{
+				uint32_t pc = add({RegexInst::Split, 0, 0, {}, 0, 0});
+				split(pc, last, pc + 1);
+			}
+			else
+			{
+				uint32_t pc = add({RegexInst::Split, 0, 0, {}, 0, 0});
+				if (empty)
+					emit_optional(child, exits);
+				else
+					emit(child);
+				add({RegexInst::Jump, 0, 0, {}, pc, 0});
+				split(pc, pc + 1, here());
+			}
+			for (uint32_t pc : exits)
+				program.code[pc].x = here();
+			return;
+		}
+
+		// Limited: nested optional copies, that all skip to the end
+		std::vector<uint32_t> splits;
+		for (int32_t i = node.min; i < node.max; ++ i)
+		{
+			splits.push_back(add({RegexInst::Split, 0, 0, {}, 0, 0}));
+			if (empty)
+				emit_optional(child, exits);
+			else
+				emit(child);
+		}
+		for (uint32_t pc : splits)
+			split(pc, pc + 1, here());
+		for (uint32_t pc : exits)
+			program.code[pc].x = here();
+	}
+
+	// Emits the two copies of an optional repeat of a body that can match the empty string: the ranges of the first
+	// copy continue in the second one, and the end of the first copy jumps out of the repetition (added to the exits)
+	void emit_optional(const RegexNode & child, std::vector<uint32_t> & exits)
+	{
+		uint32_t first = here();
+		emit(child);
+		exits.push_back(add({RegexInst::Jump, 0, 0, {}, 0, 0}));
+		uint32_t offset = here() - first;
+		emit(child);
+		for (uint32_t pc = first; pc < first + offset; ++ pc)
+			if (program.code[pc].op == RegexInst::Range && program.code[pc].lo <= program.code[pc].hi)
+				program.code[pc].x += offset;
+	}
+
+	// Returns true, if a node can match the empty string
+	static auto nullable(const RegexNode & node) -> bool
+	{
+		switch (node.kind)
+		{
+		case RegexNode::Class:
+			return false;
+		case RegexNode::Concat:
+			return std::all_of(node.children.begin(), node.children.end(), nullable);
+		case RegexNode::Alternate:
+			return std::any_of(node.children.begin(), node.children.end(), nullable);
+		case RegexNode::Repeat:
+			return node.min == 0 || nullable(node.children[0]);
+		case RegexNode::Group:
+			return nullable(node.children[0]);
+		default:
+			return true;
+		}
+	}
+
+	// Emits a class, as alternatives of byte range sequences
+	void emit_class(const RegexRanges & ranges)
+	{
+		std::vector<Sequence> list;
+		for (auto & range : ranges)
+		{
+			if (!utf8)
+				list.push_back({1, {uint8_t(range.first)}, {uint8_t(range.second)}});
+			else
+			{
+				// Surrogates are not characters
+				if (range.first < 0xD800 && range.second >= 0xD800)
+					sequences(range.first, 0xD7FF, list);
+				if (range.second > 0xDFFF && range.first <= 0xDFFF)
+					sequences(0xE000, range.second, list);
+				if (range.second < 0xD800 || range.first > 0xDFFF)
+					sequences(range.first, range.second, list);
+			}
+		}
+
+		// An empty class never matches
+		if (list.empty())
+		{
+			add({RegexInst::Range, 1, 0, {}, 0, 0});
+			return;
+		}
+
+		std::vector<uint32_t> ends;
+		for (size_t i = 0; i < list.size(); ++ i)
+		{
+			uint32_t split = (i + 1 < list.size()) ? add({RegexInst::Split, 0, 0, {}, 0, 0}) : 0;
+			auto & sequence = list[i];
+			for (size_t k = 0; k < sequence.length; ++ k)
+			{
+				size_t j = reverse ? sequence.length - 1 - k : k;
+				add({RegexInst::Range, sequence.lo[j], sequence.hi[j], {}, here() + 1, 0});
+			}
+			ends.push_back(here() - 1);
+			if (i + 1 < list.size())
+			{
+				program.code[split].x = split + 1;
+				program.code[split].y = here();
+			}
+		}
+		for (uint32_t end : ends)
+			program.code[end].x = here();
+	}
+
+	// Divides the bytes into classes, that are not distinguished by any instruction
+	void classify()
+	{
+		bool boundary[257] = {};
+		for (auto & inst : program.code)
+			if (inst.op == RegexInst::Range && inst.lo <= inst.hi)
+				boundary[inst.lo] = boundary[inst.hi + 1] = true;
+		static const int words[] = {'\n', '\n' + 1, '0', '9' + 1, 'A', 'Z' + 1, '_', '_' + 1, 'a', 'z' + 1};
+		if (program.asserts)
+			for (int ch : words)
+				boundary[ch] = true;
+
+		size_t count = 0;
+		for (int ch = 0; ch < 256; ++ ch)
+		{
+			if (ch && boundary[ch])
+				++ count;
+			program.classes[ch] = uint8_t(count);
+			if (ch == 0 || boundary[ch])
+				program.representatives[count] = uint8_t(ch);
+		}
+		program.class_count = count + 1;
+	}
+
+	// Fields
+	RegexProgram & program;
+	bool utf8;
+	bool reverse;
+};
+
+// -------------------- Automata --------------------
+
+// Context of a position (the neighbour byte on one side)
+static constexpr uint8_t regex_word_context = 1;
+static constexpr uint8_t regex_line_context = 2;
+static constexpr uint8_t regex_text_context = 4;
+
+// Context of a byte
+inline auto regex_context(uint8_t ch) -> uint8_t
+	{return (regex_word(ch) ? regex_word_context : 0) | (ch == '\n' ? regex_line_context : 0);}
+
+// Evaluates an assertion
+inline auto regex_holds(RegexAssert assertion, uint8_t before, uint8_t after) -> bool
+{
+	switch (assertion)
+	{
+	case RegexAssert::BeginText:
+		return before & regex_text_context;
+	case RegexAssert::EndText:
+		return after & regex_text_context;
+	case RegexAssert::BeginLine:
+		return before & (regex_text_context | regex_line_context);
+	case RegexAssert::EndLine:
+		return after & (regex_text_context | regex_line_context);
+	case RegexAssert::WordBoundary:
+		return bool(before & regex_word_context) != bool(after & regex_word_context);
+	case RegexAssert::NotWordBoundary:
+		return bool(before & regex_word_context) == bool(after & regex_word_context);
+	}
+	return false;
+}
+
+/************************************************************
+ * @brief Lazy DFA of a program.
+ *
+ * A state is the ordered list of the NFA threads (their instructions, in priority order), and the context of the last
+ * byte. Transitions are computed on first use, and cached in a table with one column for every byte class, and one for
+ * the end of the text. A transition also tells whether the pattern matched before the byte. When the cache is full,
+ * it is cleared, so searches stay linear with any pattern, only slower.
+ *
+ * For leftmost-first matches, the threads after a match (with lower priority) are dropped. With `longest` (for the
+ * backward search of the start), all threads are kept.
+ */
+class RegexDfa
+{
+public:
+	// The dead state (no threads)
+	static constexpr uint32_t dead = 0;
+
+	RegexDfa(uint32_t start, bool reverse, bool longest)
+		: start(start), reverse(reverse), longest(longest) {}
+
+	/// Returns the start state for a context.
+	auto start_state(const RegexProgram & program, uint8_t context) -> uint32_t
+	{
+		context = program.asserts ? context : 0;
+		if (states.empty())
+			reset(program);
+		if (starts[context] == unknown)
+			starts[context] = intern(program, {start}, context);
+		return starts[context];
+	}
+
+	/// Returns true, if the state is a start state (no thread has made progress).
+	auto is_start(uint32_t state) const -> bool
+		{return states[state].start;}
+
+	/// Returns the next state (shifted left by one), and whether the pattern matched before the byte class (in the
+	/// lowest bit). The class after the last one is the end of the text.
+	auto next(const RegexProgram & program, uint32_t state, size_t cls) -> uint32_t
+	{
+		uint32_t result = table[state * (program.class_count + 1) + cls];
+		return (result != unknown) ? result : compute(program, state, cls);
+	}
+
+private:
+	// A state
+	struct State
+	{
+		std::vector<uint32_t> pcs;
+		uint8_t context;
+		bool start;
+	};
+
+	// Unknown transition
+	static constexpr uint32_t unknown = 0xFFFFFFFF;
+
+	// Size of the cache (in bytes, approximately)
+	static constexpr size_t cache_limit = 1 << 22;
+
+	// Clears the cache (and adds the dead state)
+	void reset(const RegexProgram & program)
+	{
+		states.clear();
+		lookup.clear();
+		table.clear();
+		memory = 0;
+		std::fill(std::begin(starts), std::end(starts), unknown);
+		marks.assign(program.code.size(), 0);
+		intern(program, {}, 0);
+	}
+
+	// Returns the index of a state (adding it, when it is new)
+	auto intern(const RegexProgram & program, const std::vector<uint32_t> & pcs, uint8_t context) -> uint32_t
+	{
+		std::string key(reinterpret_cast<const char *>(pcs.data()), pcs.size() * sizeof(uint32_t));
+		key.push_back(char(context));
+		auto found = lookup.find(key);
+		if (found != lookup.end())
+			return found->second;
+
+		uint32_t index = uint32_t(states.size());
+		states.push_back({pcs, context, pcs.size() == 1 && pcs[0] == start});
+		table.resize(table.size() + program.class_count + 1, unknown);
+		memory += 2 * key.size() + 4 * (program.class_count + 1) + 64;
+		lookup.emplace(std::move(key), index);
+		return index;
+	}
+
+	// Follows the empty transitions from the threads of a state, and returns true when the pattern matches
+	auto closure(const RegexProgram & program, const std::vector<uint32_t> & pcs, uint8_t before, uint8_t after,
+		std::vector<uint32_t> & list) -> bool
+	{
+		if (++ generation == 0)
+		{
+			std::fill(marks.begin(), marks.end(), 0);
+			generation = 1;
+		}
+
+		bool matched = false;
+		for (uint32_t first : pcs)
+		{
+			stack.push_back(first);
+			while (!stack.empty())
+			{
+				uint32_t pc = stack.back();
+				stack.pop_back();
+				if (marks[pc] == generation)
+					continue;
+				marks[pc] = generation;
+
+				auto & inst = program.code[pc];
+				switch (inst.op)
+				{
+				case RegexInst::Range:
+					list.push_back(pc);
+					break;
+				case RegexInst::Split:
+					stack.push_back(inst.y);
+					stack.push_back(inst.x);
+					break;
+				case RegexInst::Jump:
+					stack.push_back(inst.x);
+					break;
+				case RegexInst::Save:
+					stack.push_back(pc + 1);
+					break;
+				case RegexInst::Assert:
+					if (regex_holds(inst.assertion, before, after))
+						stack.push_back(pc + 1);
+					break;
+				case RegexInst::Match:
+					matched = true;
+					if (!longest)
+					{
+						stack.clear();
+						return true;
+					}
+					break;
+				}
+			}
+		}
+		return matched;
+	}
+
+	// Computes a transition
+	auto compute(const RegexProgram & program, uint32_t state, size_t cls) -> uint32_t
+	{
+		// The context of the byte (the one before the position for backward searches)
+		bool end = (cls == program.class_count);
+		uint8_t byte = end ? 0 : program.representatives[cls];
+		uint8_t context = end ? regex_text_context : regex_context(byte);
+		uint8_t before = reverse ? context : states[state].context;
+		uint8_t after = reverse ? states[state].context : context;
+
+		std::vector<uint32_t> list, pcs;
+		bool matched = closure(program, states[state].pcs, before, after, list);
+
+		// Step over the byte
+		if (!end)
+		{
+			++ generation;
+			for (uint32_t pc : list)
+			{
+				auto & inst = program.code[pc];
+				if (byte >= inst.lo && byte <= inst.hi && marks[inst.x] != generation)
+				{
+					marks[inst.x] = generation;
+					pcs.push_back(inst.x);
+				}
+			}
+		}
+
+		// Clear the cache when it is full (the transition is not stored, the state is gone)
+		bool cached = true;
+		if (memory > cache_limit)
+		{
+			reset(program);
+			cached = false;
+		}
+		uint32_t target = pcs.empty() ? dead : intern(program, pcs, program.asserts ? context : 0);
+		uint32_t result = (target << 1) | uint32_t(matched);
+		if (cached)
+			table[state * (program.class_count + 1) + cls] = result;
+		return result;
+	}
+
+	// Fields
+	uint32_t start;
+	bool reverse;
+	bool longest;
+	std::vector<State> states;
+	std::unordered_map<std::string, uint32_t> lookup;
+	std::vector<uint32_t> table;
+	uint32_t starts[8];
+	size_t memory = 0;
+	std::vector<uint32_t> marks;
+	std::vector<uint32_t> stack;
+	uint32_t generation = 0;
+};
+
+/************************************************************
+ * @brief Simulation of the NFA of a program, with the positions of the capture groups.
+ *
+ * Short texts are searched by backtracking, with a bitmap of the visited (instruction, position) pairs, so no pair is
+ * tried twice. Longer texts are searched by a Pike VM: every thread has its own capture positions, and the threads are
+ * kept in priority order. Both give the same result as a backtracking search, in linear time.
+ */
+class RegexVm
+{
+public:
+	/// Runs the program from a position, up to a limit, and writes the capture positions of the match (returns false
+	/// when it does not match). With `nonempty`, empty matches are skipped.
+	auto run(const RegexProgram & program, const uint8_t * text, size_t size, size_t from, size_t stop, uint32_t start,
+		std::vector<size_t> & slots, bool nonempty = false) -> bool
+	{
+		size_t limit = std::min(size, stop);
+		if ((limit - from + 1) * program.code.size() <= max_visited)
+			return backtrack(program, text, size, from, limit, start, slots, nonempty);
+
+		size_t count = program.slots;
+		current.reset(program.code.size());
+		next.reset(program.code.size());
+		captures.assign(count, size_t(-1));
+
+		bool matched = false;
+		add(program, current, start, from, text, limit, size);
+		for (size_t pos = from; ; ++ pos)
+		{
+			next.clear();
+			for (size_t i = 0; i < current.pcs.size(); ++ i)
+			{
+				auto & inst = program.code[current.pcs[i]];
+				const size_t * thread = current.captures.data() + i * count;
+				if (inst.op == RegexInst::Match && !(nonempty && pos == from))
+				{
+					// The threads with lower priority are dropped
+					matched = true;
+					slots.assign(thread, thread + count);
+					break;
+				}
+				if (inst.op == RegexInst::Range)
+				{
+					captures.assign(thread, thread + count);
+					add(program, next, inst.x, pos + 1, text, limit, size);
+				}
+			}
+			if (pos == limit || next.pcs.empty())
+				break;
+			std::swap(current, next);
+		}
+		return matched;
+	}
+
+private:
+	// Size of the bitmap of the backtracking search (in bits)
+	static constexpr size_t max_visited = 1 << 18;
+
+	// Searches by backtracking (the first match found has the highest priority)
+	auto backtrack(const RegexProgram & program, const uint8_t * text, size_t size, size_t from, size_t limit,
+		uint32_t start, std::vector<size_t> & slots, bool nonempty) -> bool
+	{
+		static constexpr uint32_t restore = 0xFFFFFFFF;
+		size_t width = limit - from + 1;
+		visited.assign((width * program.code.size() + 63) / 64, 0);
+		captures.assign(program.slots, size_t(-1));
+
+		stack.push_back({start, 0, from});
+		while (!stack.empty())
+		{
+			Entry entry = stack.back();
+			stack.pop_back();
+			if (entry.pc == restore)
+			{
+				captures[entry.slot] = entry.value;
+				continue;
+			}
+
+			// Follow the preferred branches, and push the others
+			for (uint32_t pc = entry.pc; ; )
+			{
+				size_t pos = entry.value;
+				size_t bit = pc * width + (pos - from);
+				if (visited[bit / 64] & (uint64_t(1) << (bit % 64)))
+					break;
+				visited[bit / 64] |= uint64_t(1) << (bit % 64);
+
+				auto & inst = program.code[pc];
+				if (inst.op == RegexInst::Range)
+				{
+					if (pos == limit || text[pos] < inst.lo || text[pos] > inst.hi)
+						break;
+					pc = inst.x;
+					++ entry.value;
+				}
+				else if (inst.op == RegexInst::Split)
+				{
+					stack.push_back({inst.y, 0, pos});
+					pc = inst.x;
+				}
+				else if (inst.op == RegexInst::Jump)
+					pc = inst.x;
+				else if (inst.op == RegexInst::Save)
+				{
+					stack.push_back({restore, inst.x, captures[inst.x]});
+					captures[inst.x] = pos;
+					++ pc;
+				}
+				else if (inst.op == RegexInst::Assert)
+				{
+					uint8_t before = pos ? regex_context(text[pos - 1]) : regex_text_context;
+					uint8_t after = (pos < size) ? regex_context(text[pos]) : regex_text_context;
+					if (!regex_holds(inst.assertion, before, after))
+						break;
+					++ pc;
+				}
+				else
+				{
+					if (nonempty && pos == from)
+						break;
+					slots = captures;
+					stack.clear();
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	// List of threads (the ranges and the matches, in priority order), with the instructions visited while adding them
+	struct Threads
+	{
+		std::vector<uint32_t> pcs;
+		std::vector<size_t> captures;
+		std::vector<uint32_t> marks;
+		uint32_t generation = 0;
+
+		void reset(size_t size)
+		{
+			if (marks.size() != size)
+				marks.assign(size, 0);
+			clear();
+		}
+		void clear()
+		{
+			pcs.clear();
+			captures.clear();
+			if (++ generation == 0)
+			{
+				std::fill(marks.begin(), marks.end(), 0);
+				generation = 1;
+			}
+		}
+	};
+
+	// Entry of the stack (an instruction, or a capture position to restore)
+	struct Entry
+	{
+		uint32_t pc;
+		uint32_t slot;
+		size_t value;
+	};
+
+	// Adds a thread, following the empty transitions (with the captures of the current thread). The threads that can
+	// not step over the next byte (before the limit) are dropped at once.
+	void add(const RegexProgram & program, Threads & list, uint32_t pc, size_t pos, const uint8_t * text, size_t stop,
+		size_t size)
+	{
+		static constexpr uint32_t restore = 0xFFFFFFFF;
+		uint8_t before = pos ? regex_context(text[pos - 1]) : regex_text_context;
+		uint8_t after = (pos < size) ? regex_context(text[pos]) : regex_text_context;
+
+		stack.push_back({pc, 0, 0});
+		while (!stack.empty())
+		{
+			Entry entry = stack.back();
+			stack.pop_back();
+			if (entry.pc == restore)
+			{
+				captures[entry.slot] = entry.value;
+				continue;
+			}
+			if (list.marks[entry.pc] == list.generation)
+				continue;
+			list.marks[entry.pc] = list.generation;
+
+			auto & inst = program.code[entry.pc];
+			switch (inst.op)
+			{
+			case RegexInst::Range:
+				if (pos == stop || text[pos] < inst.lo || text[pos] > inst.hi)
+					break;
+				// Fall through
+			case RegexInst::Match:
+				list.pcs.push_back(entry.pc);
+				list.captures.insert(list.captures.end(), captures.begin(), captures.end());
+				break;
+			case RegexInst::Split:
+				stack.push_back({inst.y, 0, 0});
+				stack.push_back({inst.x, 0, 0});
+				break;
+			case RegexInst::Jump:
+				stack.push_back({inst.x, 0, 0});
+				break;
+			case RegexInst::Save:
+				stack.push_back({restore, inst.x, captures[inst.x]});
+				captures[inst.x] = pos;
+				stack.push_back({entry.pc + 1, 0, 0});
+				break;
+			case RegexInst::Assert:
+				if (regex_holds(inst.assertion, before, after))
+					stack.push_back({entry.pc + 1, 0, 0});
+				break;
+			}
+		}
+	}
+
+	// Fields
+	Threads current;
+	Threads next;
+	std::vector<size_t> captures;
+	std::vector<Entry> stack;
+	std::vector<uint64_t> visited;
+};
+
+// Close namespace "impl"
+}
+
+// -------------------- Matches --------------------
+
+/************************************************************
+ * @brief A match of a @ref regex (or no match, when it converts to false).
+ *
+ * The positions are byte offsets in the text. The capture groups are computed on first use, so the regex and the text
+ * must outlive the match. Groups that did not participate in the match are empty, and their positions are
+ * `size_t(-1)`.
+ */
+class regex_match
+{
+public:
+	using view = better_string_view<char>;
+
+	// Constructors
+	regex_match() = default;
+
+	/// Returns true, if the pattern matched.
+	explicit operator bool () const
+		{return re != nullptr;}
+
+	/// Returns the number of groups (including the whole match, group 0).
+	auto size() const -> size_t
+		{return re ? slots.size() / 2 : 0;}
+
+	/// Returns the start of a group.
+	auto start(size_t index = 0) const -> size_t
+		{return slot(2 * index);}
+
+	/// Returns the end of a group.
+	auto end(size_t index = 0) const -> size_t
+		{return slot(2 * index + 1);}
+
+	/// Returns the text of a group (the whole match by default).
+	auto group(size_t index = 0) const -> view
+	{
+		size_t first = start(index), last = end(index);
+		return (first == size_t(-1)) ? view() : view(text.data() + first, last - first);
+	}
+
+	/// Returns the text of a named group.
+	auto group(view name) const -> view;
+
+private:
+	friend class regex;
+
+	// Returns a capture position (computing the groups, when needed)
+	auto slot(size_t index) const -> size_t;
+
+	// Fields
+	const regex * re = nullptr;
+	view text;
+	mutable std::vector<size_t> slots;
+	mutable bool resolved = false;
+};
+
+/************************************************************
+ * @brief The matches of a @ref regex in a text, found while iterating (see @ref regex::finditer()).
+ *
+ * After an empty match, the next match is a non-empty match at the same position, or any match after it (like in
+ * Python 3.7 and later).
+ */
+class regex_matches
+{
+public:
+	using view = better_string_view<char>;
+	using value_type = regex_match;
+
+	// Input iterator of the matches
+	class iterator
+	{
+	public:
+		// Aliases
+		using iterator_category = std::input_iterator_tag;
+		using value_type = regex_match;
+		using difference_type = ptrdiff_t;
+		using pointer = const regex_match *;
+		using reference = const regex_match &;
+
+		// Constructors (the first match is found at once)
+		iterator() = default;
+		explicit iterator(const regex_matches * range)
+			: range(range) {++ *this;}
+
+		// Access
+		auto operator * () const -> const regex_match &
+			{return match;}
+		auto operator -> () const -> const regex_match *
+			{return &match;}
+
+		// Increment
+		auto operator ++ () -> iterator &;
+		auto operator ++ (int) -> iterator
+			{iterator copy = *this; ++ *this; return copy;}
+
+		// Compare
+		friend auto operator == (const iterator & a, const iterator & b) -> bool
+			{return a.range == b.range && (!a.range || (a.match.start() == b.match.start() && a.match.end() == b.match.end()));}
+		friend auto operator != (const iterator & a, const iterator & b) -> bool
+			{return !(a == b);}
+
+	private:
+		// Fields
+		const regex_matches * range = nullptr;
+		regex_match match;
+	};
+
+	/// Creates the view of the matches.
+	regex_matches(const regex & re, view text)
+		: re(&re), text(text) {}
+
+	// Iterators
+	auto begin() const -> iterator
+		{return iterator(this);}
+	auto end() const -> iterator
+		{return iterator();}
+
+private:
+	// Fields
+	const regex * re;
+	view text;
+};
+
+// -------------------- Regex --------------------
+
+/************************************************************
+ * @brief A compiled regular expression (see the description of the module above).
+ *
+ * The DFA states are cached in the object while searching, so an object must not be used by several threads at the
+ * same time (copies are independent).
+ */
+class regex
+{
+public:
+	using view = better_string_view<char>;
+
+	// Flags
+	enum Flags : uint32_t
+	{
+		/// Every byte is a character (the pattern and the text are not UTF-8).
+		Bytes = 1 << 0,
+		/// ASCII letters match both cases, like `(?i)`.
+		IgnoreCase = 1 << 1,
+		/// `^` and `$` match at the line breaks too, like `(?m)`.
+		Multiline = 1 << 2,
+		/// `.` matches line breaks too, like `(?s)`.
+		DotAll = 1 << 3,
+	};
+
+	/**
+	 * @brief Compiles a pattern.
+	 *
+	 * @param pattern The pattern, in the syntax of Python's `re` module (without backreferences and lookaround).
+	 * @param flags A combination of @ref Flags.
+	 * @throws std::invalid_argument When the pattern is invalid, or too large.
+	 */
+	explicit regex(view pattern, uint32_t flags = 0)
+	{
+		utf8 = !(flags & Bytes);
+		impl::RegexParser parser(pattern.data(), pattern.size(), utf8);
+		impl::RegexNode node = parser.parse(flags & IgnoreCase, flags & Multiline, flags & DotAll);
+		impl::RegexCompiler(program, utf8, false).compile(node, parser.groups);
+		impl::RegexCompiler(reversed, utf8, true).compile(node, parser.groups);
+		names = std::move(parser.names);
+		literals(node);
+	}
+
+	/// Returns the number of capture groups (without the whole match).
+	auto groups() const -> size_t
+		{return program.slots / 2 - 1;}
+
+	/// Returns the index of a named group, or `size_t(-1)` when there is no such group.
+	auto group_index(view name) const -> size_t
+	{
+		for (auto & item : names)
+			if (name == view(item.first.data(), item.first.size()))
+				return item.second;
+		return size_t(-1);
+	}
+
+	/// Returns the literal that every match contains (the longest one, empty when there is none).
+	auto required() const -> view
+		{return view(literal.data(), literal.size());}
+
+	/// Finds the first match in the text, starting the search at a position (the text before it is still used by
+	/// `^`, `\b` and the other assertions).
+	auto search(view text, size_t pos = 0) const -> regex_match
+		{return find(text, pos, false);}
+
+	/// Matches the pattern at a position of the text (the match does not have to reach the end of the text).
+	auto match(view text, size_t pos = 0) const -> regex_match
+		{return find(text, pos, true);}
+
+	/// Returns a lazy view of the matches in the text (the matches do not overlap).
+	auto finditer(view text) const -> regex_matches
+		{return regex_matches(*this, text);}
+
+	/**
+	 * @brief Splits the text at the matches (the groups of the matches are in the list too, between the parts).
+	 *
+	 * @param maxsplit The maximum number of splits (0 for no limit).
+	 */
+	auto split(view text, size_t maxsplit = 0) const -> std::vector<view>
+	{
+		std::vector<view> result;
+		size_t last = 0, count = 0;
+		for (auto & found : finditer(text))
+		{
+			if (maxsplit && count ++ == maxsplit)
+				break;
+			result.push_back(view(text.data() + last, found.start() - last));
+			for (size_t i = 1; i < found.size(); ++ i)
+				result.push_back(found.group(i));
+			last = found.end();
+		}
+		result.push_back(view(text.data() + last, text.size() - last));
+		return result;
+	}
+
+	/**
+	 * @brief Replaces the matches with a template.
+	 *
+	 * In the template, `\1` to `\99`, `\g<1>` and `\g<name>` are replaced with the text of the groups (`\g<0>` is the
+	 * whole match), and `\n`, `\t`, `\r` and `\\` with the characters.
+	 *
+	 * @param repl The template.
+	 * @param count The maximum number of replacements (0 for no limit).
+	 * @throws std::invalid_argument When the template has an invalid escape, or refers to a group that does not exist.
+	 */
+	auto sub(view repl, view text, size_t count = 0) const -> better_string<char>
+	{
+		better_string<char> result;
+		sub_into(repl, text, result, count);
+		return result;
+	}
+
+	/// A version of @ref sub(), that appends to the output (reusing its capacity).
+	auto sub_into(view repl, view text, better_string<char> & output, size_t count = 0) const -> better_string<char> &
+	{
+		// Parse the template (literal parts, and group references)
+		std::vector<std::pair<size_t, size_t>> parts;
+		better_string<char> literals;
+		parse_template(repl, parts, literals);
+
+		size_t last = 0, replaced = 0;
+		auto append = [&] (const char * data, size_t size) {
+			size_t end = output.size();
+			output.resize(end + size);
+			std::copy(data, data + size, output.begin() + end);
+		};
+		for (auto & found : finditer(text))
+		{
+			if (count && replaced ++ == count)
+				break;
+			append(text.data() + last, found.start() - last);
+			for (auto & part : parts)
+			{
+				if (part.first == size_t(-1))
+					append(literals.data() + (part.second >> 32), part.second & 0xFFFFFFFF);
+				else
+				{
+					view value = found.group(part.first);
+					append(value.data(), value.size());
+				}
+			}
+			last = found.end();
+		}
+		append(text.data() + last, text.size() - last);
+		return output;
+	}
+
+private:
+	friend class regex_match;
+	friend class regex_matches;
+
+	// Finds the leftmost-first match (anchored at the position, or after it)
+	auto find(view text, size_t pos, bool anchored) const -> regex_match
+	{
+		regex_match result;
+		auto data = reinterpret_cast<const uint8_t *>(text.data());
+		size_t size = text.size();
+		if (pos > size)
+			return result;
+
+		// Every match contains the required literal
+		if (!literal.empty() && find_literal(text, pos, literal) == size_t(-1))
+			return result;
+
+		// The end of the match, then its start
+		size_t end = find_end(data, size, pos, anchored);
+		if (end == size_t(-1))
+			return result;
+		size_t start = anchored ? pos : find_start(data, size, pos, end);
+
+		result.re = this;
+		result.text = text;
+		result.slots.assign(program.slots, size_t(-1));
+		result.slots[0] = start;
+		result.slots[1] = end;
+		result.resolved = (program.slots == 2);
+		return result;
+	}
+
+	// Finds a literal with the kernels
+	static auto find_literal(view text, size_t pos, const std::string & sub) -> size_t
+	{
+		auto & table = kernels::active();
+		size_t found = (sub.size() == 1) ? table.find_byte(text.data() + pos, text.size() - pos, sub[0])
+			: table.find(text.data() + pos, text.size() - pos, sub.data(), sub.size());
+		return (found == size_t(-1)) ? found : pos + found;
+	}
+
+	// Runs the forward DFA, and returns the end of the leftmost-first match (or of the longest one)
+	auto find_end(const uint8_t * data, size_t size, size_t pos, bool anchored, bool longest = false) const -> size_t
+	{
+		auto & dfa = longest ? longest_dfa : anchored ? anchored_dfa : forward_dfa;
+		auto context = [&] (size_t at) {return at ? impl::regex_context(data[at - 1]) : impl::regex_text_context;};
+		uint32_t state = dfa.start_state(program, context(pos));
+		size_t last = size_t(-1);
+
+		for (; pos < size; ++ pos)
+		{
+			// Skip to the next occurrence of the prefix, when no thread has made progress
+			if (!anchored && !prefix.empty() && dfa.is_start(state))
+			{
+				size_t found = find_literal(view(reinterpret_cast<const char *>(data), size), pos, prefix);
+				if (found == size_t(-1))
+					return last;
+				if (found != pos)
+				{
+					pos = found;
+					state = dfa.start_state(program, context(pos));
+				}
+			}
+
+			uint32_t result = dfa.next(program, state, program.classes[data[pos]]);
+			if (result & 1)
+				last = pos;
+			state = result >> 1;
+			if (state == impl::RegexDfa::dead)
+				return last;
+		}
+		if (dfa.next(program, state, program.class_count) & 1)
+			last = size;
+		return last;
+	}
+
+	// Runs the backward DFA from the end of a match, and returns its start (the furthest one)
+	auto find_start(const uint8_t * data, size_t size, size_t from, size_t end) const -> size_t
+	{
+		uint8_t context = (end < size) ? impl::regex_context(data[end]) : impl::regex_text_context;
+		uint32_t state = backward_dfa.start_state(reversed, context);
+		size_t last = end;
+
+		for (size_t pos = end; ; -- pos)
+		{
+			// At the limit of the search, the byte before it is only used as context
+			size_t cls = pos ? reversed.classes[data[pos - 1]] : reversed.class_count;
+			uint32_t result = backward_dfa.next(reversed, state, cls);
+			if (result & 1)
+				last = pos;
+			state = result >> 1;
+			if (pos == from || state == impl::RegexDfa::dead)
+				return last;
+		}
+	}
+
+	// Finds a non-empty match at a position (with its groups)
+	auto find_nonempty(view text, size_t pos) const -> regex_match
+	{
+		regex_match result;
+		auto data = reinterpret_cast<const uint8_t *>(text.data());
+
+		// No match at the position goes past its longest one, so the VM stops there
+		size_t end = find_end(data, text.size(), pos, true, true);
+		if (end == size_t(-1) || end == pos)
+			return result;
+		if (!vm.run(program, data, text.size(), pos, end, program.start, result.slots, true))
+			return result;
+		result.re = this;
+		result.text = text;
+		result.resolved = true;
+		return result;
+	}
+
+	// Computes the capture groups of a match
+	void resolve(const regex_match & found) const
+	{
+		auto data = reinterpret_cast<const uint8_t *>(found.text.data());
+		std::vector<size_t> slots;
+		vm.run(program, data, found.text.size(), found.slots[0], found.slots[1], program.start, slots);
+		found.slots = std::move(slots);
+		found.resolved = true;
+	}
+
+	// Finds the literal prefix, and the longest required literal of a pattern
+	void literals(const impl::RegexNode & node)
+	{
+		// The sequence of nodes of the top level concatenation (the groups are flattened)
+		std::vector<const impl::RegexNode *> items;
+		auto flatten = [&] (const impl::RegexNode & item, auto & self) -> void {
+			if (item.kind == impl::RegexNode::Concat)
+				for (auto & child : item.children)
+					self(child, self);
+			else if (item.kind == impl::RegexNode::Group)
+				self(item.children[0], self);
+			else
+				items.push_back(&item);
+		};
+		flatten(node, flatten);
+
+		// Runs of literal characters (assertions do not break a run)
+		std::string run;
+		bool first = true;
+		for (size_t i = 0; i <= items.size(); ++ i)
+		{
+			auto item = (i < items.size()) ? items[i] : nullptr;
+			if (item && item->kind == impl::RegexNode::Class && item->literal)
+			{
+				uint32_t cp = item->ranges[0].first;
+				uint8_t bytes[4] = {uint8_t(cp)};
+				run.append(reinterpret_cast<const char *>(bytes), utf8 ? impl::regex_encode(cp, bytes) : 1);
+				continue;
+			}
+			if (item && (item->kind == impl::RegexNode::Assert || item->kind == impl::RegexNode::Empty))
+				continue;
+
+			if (first)
+				prefix = run;
+			if (run.size() > literal.size())
+				literal = run;
+			run.clear();
+			first = false;
+		}
+	}
+
+	// Parses a replacement template (literal parts have the group `size_t(-1)`, and their offset and length)
+	void parse_template(view repl, std::vector<std::pair<size_t, size_t>> & parts, better_string<char> & literals) const
+	{
+		auto error = [] (const char * message) {throw std::invalid_argument(std::string("sub(): repl: ") + message);};
+		auto group = [&] (size_t index) {
+			if (index > groups())
+				error("Invalid group reference!");
+			parts.push_back({index, 0});
+		};
+
+		size_t start = 0;
+		auto flush = [&] {
+			if (literals.size() > start)
+				parts.push_back({size_t(-1), (start << 32) | (literals.size() - start)});
+			start = literals.size();
+		};
+		for (size_t i = 0; i < repl.size(); ++ i)
+		{
+			char ch = repl[i];
+			if (ch != '\\')
+			{
+				literals.push_back(ch);
+				continue;
+			}
+			if (++ i == repl.size())
+				error("Trailing backslash!");
+
+			ch = repl[i];
+			if (ch >= '0' && ch <= '9')
+			{
+				// \1 to \99
+				size_t index = size_t(ch - '0');
+				if (i + 1 < repl.size() && repl[i + 1] >= '0' && repl[i + 1] <= '9')
+					index = index * 10 + size_t(repl[++ i] - '0');
+				if (index == 0)
+					error("Invalid group reference!");
+				flush();
+				group(index);
+				start = literals.size();
+			}
+			else if (ch == 'g')
+			{
+				// \g<number> or \g<name>
+				size_t close = (i + 1 < repl.size() && repl[i + 1] == '<') ? i + 2 : repl.size();
+				while (close < repl.size() && repl[close] != '>')
+					++ close;
+				if (close >= repl.size() || close == i + 2)
+					error("Invalid group reference!");
+				view name(repl.data() + i + 2, close - i - 2);
+				size_t index = 0;
+				bool number = true;
+				for (char digit : name)
+				{
+					number = number && digit >= '0' && digit <= '9';
+					index = std::min<size_t>(index * 10 + size_t(digit - '0'), 1000);
+				}
+				index = number ? index : group_index(name);
+				if (index == size_t(-1))
+					error("Unknown group name!");
+				flush();
+				group(index);
+				start = literals.size();
+				i = close;
+			}
+			else if (ch == 'n' || ch == 't' || ch == 'r' || ch == '\\')
+				literals.push_back(ch == 'n' ? '\n' : ch == 't' ? '\t' : ch == 'r' ? '\r' : '\\');
+			else if ((ch | 0x20) >= 'a' && (ch | 0x20) <= 'z')
+				error("Invalid escape sequence!");
+			else
+			{
+				// Other escapes are kept
+				literals.push_back('\\');
+				literals.push_back(ch);
+			}
+		}
+		flush();
+	}
+
+	// Fields
+	impl::RegexProgram program;
+	impl::RegexProgram reversed;
+	std::vector<std::pair<std::string, size_t>> names;
+	std::string prefix;
+	std::string literal;
+	bool utf8;
+	mutable impl::RegexDfa forward_dfa {0, false, false};
+	mutable impl::RegexDfa anchored_dfa {2, false, false};
+	mutable impl::RegexDfa longest_dfa {2, false, true};
+	mutable impl::RegexDfa backward_dfa {0, true, true};
+	mutable impl::RegexVm vm;
+};
+
+// -------------------- Implementation --------------------
+
+inline auto regex_match::slot(size_t index) const -> size_t
+{
+	if (!re || index >= slots.size())
+		return size_t(-1);
+	if (index > 1 && !resolved)
+		re->resolve(*this);
+	return slots[index];
+}
+
+inline auto regex_match::group(view name) const -> view
+{
+	size_t index = re ? re->group_index(name) : size_t(-1);
+	return (index == size_t(-1)) ? view() : group(index);
+}
+
+inline auto regex_matches::iterator::operator ++ () -> iterator &
+{
+	if (!range)
+		return *this;
+	auto re = range->re;
+	auto & text = range->text;
+
+	// After an empty match, a non-empty match at the same position, or any match after it
+	size_t pos = match ? match.end() : 0;
+	if (match && match.start() == pos)
+	{
+		match = re->find_nonempty(text, pos);
+		if (match)
+			return *this;
+		++ pos;
+		while (re->utf8 && pos < text.size() && (uint8_t(text[pos]) & 0xC0) == 0x80)
+			++ pos;
+	}
+	match = re->search(text, pos);
+	if (!match)
+		range = nullptr;
+	return *this;
+}
+
+/// @}
+
+// Close namespace "ext"
+}
@@ -1,11 +1,22 @@
+#pragma once
+
 #include <stddef.h>
 #include <stdint.h>
 
+#include <algorithm>
 #include <string>
+#if __cplusplus >= 201703
+#include <string_view>
+#endif
 #include <vector>
 #include <stdexcept>
+#include <system_error>
+#include <thread>
 #include <type_traits>
 
+#include "better-instrument.hh"
+#include "better-kernels.hh"
+
 // Remove non standard macros
 #undef isascii
 
@@ -20,6 +31,10 @@ template<typename Char, typename Traits = std::char_traits<Char>, typename Alloc
 class better_string;
 template<typename Char, typename Traits = std::char_traits<Char>>
 class better_string_view;
+template<typename Char, typename Traits = std::char_traits<Char>>
+class query_pairs;
+template<typename Char, typename Traits = std::char_traits<Char>>
+class shlex_split;
 
 // Encoding list
 enum class Encoding : int32_t
@@ -78,6 +93,12 @@ template<Encoding E> struct encoding_traits;
 // Iterable view
 template<typename Iter> class iterable_view;
 
+// Occurrences of a substring
+template<typename Char, typename Traits, Encoding E> class finditer;
+
+// Set of characters
+template<Encoding E = Encoding::UTF8, size_t N = 16> class charset;
+
 // Default encoding for various character types
 template<typename T>
 struct default_encoding
@@ -103,7 +124,7 @@ struct unsafe_encoding
 // Create a templated string literal
 template<typename Char, Char... values>
 inline auto string_literal() -> const Char *
-	{static const Char array[] = { values... }; return array;}
+	{static const Char array[] = { values..., Char(0) }; return array;}
 
 
 // Namespace for implementation details
@@ -157,6 +178,7 @@ public:
 	char sign = 0;
 	char align = 0;
 	bool alter = false;
+	bool zero = false;
 	bool comma = false;
 	size_t width = size_t(-1);
 	size_t precision = size_t(-1);
@@ -179,15 +201,15 @@ public:
 			{return (ch >= 'A' && ch <= 'Z') || (ch >= 'a' && ch <= 'z');};
 		static constexpr auto is_digit = [] (int32_t ch) -> bool
 			{return ch >= '0' && ch <= '9';};
-		static constexpr auto next = [] (const Char *iter) -> const Char *
-			{return static_cast<const Char *>(++ encoding_traits<E>::iter(iter));};
+		static constexpr auto next = [] (const Char * iter, const Char * end) -> const Char *
+			{return static_cast<const Char *>(++ encoding_traits<E>::iter(iter, iter, end));};
 
 		// Iterators
 		const Char * iter = spec.data();
 		const Char * end = iter + spec.size();
 
 		// Check for fill and align
-		const Char * second = next(iter);
+		const Char * second = next(iter, end);
 		if (second < end && is_align(* second))
 		{
 			fill = better_string_view<Char>(iter, second);
@@ -215,11 +237,10 @@ public:
 			++ iter;
 		}
 
-		// Check for zero padding
+		// Check for zero padding (the default alignment depends on the type, numbers use '=')
 		if (iter < end && *iter == '0')
 		{
-			if (!align)
-				align = '=';
+			zero = true;
 			if (fill.empty())
 				fill = string_literal<Char, '0'>();
 			++ iter;
@@ -243,8 +264,10 @@ public:
 		// Check for precision
 		if (iter < end && *iter == '.')
 		{
+			if (++ iter == end || !is_digit(*iter))
+				throw std::invalid_argument("format(): spec: Missing precision!");
 			precision = 0;
-			for (++ iter; iter < end && is_digit(*iter); ++ iter)
+			for (; iter < end && is_digit(*iter); ++ iter)
 				{precision = precision * 10 + (*iter) - '0';}
 		}
 
@@ -260,32 +283,98 @@ public:
 	}
 };
 
-// Translation table returned by `maketrans` functions
+// Decodes a character with the iterators of an encoding (used by @ref charset_next for the codepages)
+template<Encoding E, typename Char>
+auto charset_decode(const Char *& ptr, const Char * end) -> int32_t
+{
+	auto iter = encoding_traits<E>::iter(ptr, ptr, end);
+	int32_t cp = *iter;
+	ptr = static_cast<const Char *>(++ iter);
+	return cp;
+}
+
+// Decodes the next character of a set of characters, and returns its codepoint (or -1, for invalid sequences). The
+// Unicode encodings and the uninterpreted characters are decoded at compile time too.
+template<Encoding E, typename Char>
+constexpr auto charset_next(const Char *& ptr, const Char * end) -> int32_t
+{
+	using Unit = typename std::make_unsigned<Char>::type;
+	if (E != Encoding::Char8 && E != Encoding::Char16 && E != Encoding::Char32 &&
+		E != Encoding::UTF8 && E != Encoding::UTF16 && E != Encoding::UTF32)
+		return charset_decode<E>(ptr, end);
+
+	uint32_t ch = Unit(*ptr ++);
+	if (E == Encoding::UTF8 && ch >= 0x80)
+	{
+		size_t length = (ch < 0xC2) ? 0 : (ch < 0xE0) ? 2 : (ch < 0xF0) ? 3 : (ch < 0xF5) ? 4 : 0;
+		if (length == 0 || size_t(end - ptr) < length - 1)
+			return -1;
+		uint32_t cp = ch & (0x7F >> length);
+		for (size_t i = 1; i < length; ++ i)
+		{
+			uint32_t next = Unit(*ptr);
+			if ((next & 0xC0) != 0x80)
+				return -1;
+			cp = (cp << 6) | (next & 0x3F);
+			++ ptr;
+		}
+		if ((length == 3 && (cp < 0x800 || (cp & 0xF800) == 0xD800)) || (length == 4 && (cp < 0x10000 || cp > 0x10FFFF)))
+			return -1;
+		return int32_t(cp);
+	}
+	if (E == Encoding::UTF16 && (ch & 0xF800) == 0xD800)
+	{
+		if (ch >= 0xDC00 || ptr == end || (Unit(*ptr) & 0xFC00) != 0xDC00)
+			return -1;
+		return int32_t(0x10000 + ((ch & 0x3FF) << 10 | (Unit(*ptr ++) & 0x3FF)));
+	}
+	if (E == Encoding::UTF32 && (ch > 0x10FFFF || (ch & 0xFFFFF800) == 0xD800))
+		return -1;
+	return int32_t(ch);
+}
+
+// Translation table returned by `maketrans` functions (the codepoints below 256 are looked up in a direct table, the
+// others are searched in the sorted nodes)
 class Translation
 {
 public:
 	// Constructor
-	template<typename Char>
-	Translation(better_string_view<Char> x, better_string_view<Char> y, better_string_view<Char> z)
+	template<Encoding E, typename View>
+	static auto create(View x, View y, View z) -> Translation
 	{
-		// Build translation table [TODO: Sort translation table]
-		size_t n = x.size();
-		size_t m = z.size();
-		data.reserve(n + m);
-		for (size_t i = 0; i < n; ++ i)
-			data[i] = Node(x[i], y[i]);
-		for (size_t i = 0; i < m; ++ i)
-			data[n + i] = Node(z[i], -1);
+		// Decode the characters
+		std::vector<int32_t> from = decode<E>(x), to = decode<E>(y), skip = decode<E>(z);
+		if (from.size() != to.size())
+			throw std::invalid_argument("maketrans(): to: Not the same length as from!");
+
+		// Build translation table (like in Python, the last mapping of a character wins, and skipping wins over all)
+		Translation result;
+		for (size_t i = 0; i < from.size(); ++ i)
+			result.insert(from[i], to[i]);
+		for (int32_t cp : skip)
+			result.insert(cp, -1);
+
+		// Sort the nodes (the later nodes of a key first), and keep the first node of every key
+		std::vector<Node> nodes = std::move(result.data);
+		std::vector<size_t> order(nodes.size());
+		for (size_t i = 0; i < order.size(); ++ i)
+			order[i] = i;
+		std::sort(order.begin(), order.end(), [&] (size_t a, size_t b)
+			{return nodes[a].key < nodes[b].key || (nodes[a].key == nodes[b].key && a > b);});
+		result.data.clear();
+		for (size_t i : order)
+			if (result.data.empty() || result.data.back().key != nodes[i].key)
+				result.data.push_back(nodes[i]);
+		return result;
 	}
 
 	// Call operator
 	auto operator () (int32_t in) const -> int32_t
 	{
-		// Lookup translation table [TODO: Use logarithmic search]
-		for (auto node : data)
-			if (node.key == in)
-				return node.value;
-		return in;
+		if (uint32_t(in) < 256)
+			return direct[in];
+		auto found = std::lower_bound(data.begin(), data.end(), in, [] (Node node, int32_t key) {return node.key < key;});
+		return (found != data.end() && found->key == in) ? found->value : in;
 	}
 
 private:
@@ -299,2136 +388,6122 @@ private:
 			: key(key), value(value) {}
 	};
 
+	// Creates an identity table
+	Translation()
+	{
+		for (int32_t i = 0; i < 256; ++ i)
+			direct[i] = i;
+	}
+
+	// Decodes a string
+	template<Encoding E, typename View>
+	static auto decode(View str) -> std::vector<int32_t>
+	{
+		std::vector<int32_t> result;
+		for (auto ptr = str.data(), end = str.data() + str.size(); ptr < end;)
+		{
+			int32_t cp = charset_next<E>(ptr, end);
+			if (cp < 0)
+				throw std::invalid_argument("maketrans(): Decoding error!");
+			result.push_back(cp);
+		}
+		return result;
+	}
+
+	// Adds a mapping
+	void insert(int32_t key, int32_t value)
+	{
+		if (key < 256)
+			direct[key] = value;
+		else
+			data.emplace_back(key, value);
+	}
+
 	// Translation table
+	int32_t direct[256];
 	std::vector<Node> data;
 };
 
-// Formatter template for selecting functions
-template<Encoding E, typename Char, typename T>
-void formatter(const void * value, int32_t func, better_string_view<Char> spec, better_string<Char> & out)
+// Returns true, if the string kernels can search the string as bytes (byte and UTF-16 strings with standard traits,
+// and a substring that cannot match inside of a UTF-8 sequence or a surrogate pair)
+template<typename Traits, Encoding E>
+auto byte_search(const typename Traits::char_type * sub, size_t size) -> bool
 {
-	// Use a proxy object, to handle non-class types
-	using Type = typename std::remove_cv<typename std::remove_reference<T>::type>::type;
-
-	// No conversion
-	if (func == 0)
-		out.extend(format_proxy<Type>::type::template format__<Char, E>(* static_cast<const Type *>(value), spec));
+	using Char = typename Traits::char_type;
+	return std::is_same<Traits, std::char_traits<Char>>::value && size > 0 &&
+		((sizeof(Char) == 1 && (E == Encoding::Char8 || (E == Encoding::UTF8 && (uint8_t(sub[0]) & 0xC0) != 0x80))) ||
+		(sizeof(Char) == 2 && (E == Encoding::Char16 || (E == Encoding::UTF16 && (uint16_t(sub[0]) & 0xFC00) != 0xDC00))));
+}
 
-	// Ascii conversion
-	else if (func == 'a')
-		out.extend(better_string<Char>::template format__<Char, E>(
-			format_proxy<Type>::type::template ascii__<Char, E>(* static_cast<const Type *>(value)), spec));
+// Returns true, if the left iterator is before the right one (the iterators of the fixed width encodings compare with
+// "!=", which does not stop loops that skip over the end)
+template<typename Char, typename Iter>
+auto before(Iter left, Iter right) -> bool
+	{return static_cast<const Char *>(left) < static_cast<const Char *>(right);}
 
-	// Repr conversion
-	else if (func == 'r')
-		out.extend(better_string<Char>::template format__<Char, E>(
-			format_proxy<Type>::type::template repr__<Char, E>(* static_cast<const Type *>(value)), spec));
+// Finds a substring in the range [start, end) with the string kernels
+template<typename Char>
+auto byte_find(const kernels::Table & table, const Char * data, size_t start, size_t end, const Char * sub, size_t size)
+	-> size_t
+{
+	if (start > end || end - start < size)
+		return size_t(-1);
 
-	// String conversion
-	else if (func == 's')
-		out.extend(better_string<Char>::template format__<Char, E>(
-			format_proxy<Type>::type::template str__<Char, E>(* static_cast<const Type *>(value)), spec));
+	// Matches that do not start on a character boundary are skipped (only for wider characters)
+	auto bytes = reinterpret_cast<const char *>(data + start);
+	size_t length = (end - start) * sizeof(Char);
+	for (size_t offset = 0; length - offset >= size * sizeof(Char); ++ offset)
+	{
+		size_t pos = table.find(bytes + offset, length - offset, reinterpret_cast<const char *>(sub), size * sizeof(Char));
+		if (pos == size_t(-1))
+			break;
+		offset += pos;
+		if (offset % sizeof(Char) == 0)
+			return start + offset / sizeof(Char);
+	}
+	return size_t(-1);
 }
 
-// Close namespace "impl"
-}
+// Finds a substring in the range [start, end) with the active string kernels
+template<typename Char>
+auto byte_find(const Char * data, size_t start, size_t end, const Char * sub, size_t size) -> size_t
+	{return byte_find(kernels::active(), data, start, end, sub, size);}
 
-// Namespace for string algorithms
-namespace algorithm { namespace string {
+// Returns the first character boundary at or after a position (where an iterator from the start of the string stops)
+template<Encoding E, typename Char>
+auto char_boundary(const Char * data, size_t size, size_t pos) -> size_t
+{
+	// Start from a unit that is always a boundary (not a UTF-8 continuation byte, or a low surrogate after a high one)
+	size_t start = pos;
+	if (E == Encoding::UTF8)
+		while (start > 0 && pos - start < 3 && (uint8_t(data[start]) & 0xC0) == 0x80)
+			-- start;
+	if (E == Encoding::UTF16 && start > 0 && (uint16_t(data[start - 1]) & 0xFC00) == 0xD800)
+		-- start;
+
+	auto iter = encoding_traits<E>::iter(data + start, data, data + size);
+	while (static_cast<const Char *>(iter) < data + pos)
+		++ iter;
+	return static_cast<const Char *>(iter) - data;
+}
 
-/**
- * @name String algorithms
+/************************************************************
+ * @brief The state of a search for every occurrence of a substring: the search method (the string kernels, or the
+ * characters) is chosen once, and every occurrence is found from the position after the previous one.
  *
- * These are the <i>raw</i> algorithm implementations, for string types. You are expected to use them by directly
- * setting all the template parameters, with the correct constness and reference types. For example `Self` is usually
- * set for `decltype(*this)`.
+ * The positions are offsets in the string, on character boundaries.
  */
+template<typename Traits, Encoding E>
+class SubstringScanner
+{
+public:
+	using Char = typename Traits::char_type;
 
-/// @{
-
-// -------------------- Alignment --------------------
+	// Constructors
+	SubstringScanner(const Char * data, size_t size, const Char * sub, size_t length)
+		: data(data), size(size), sub(sub), length(length), table(kernels::active()),
+		bytes(byte_search<Traits, E>(sub, length)) {}
 
-// Algorithm - center
-template<typename Self, typename Traits, Encoding E, typename T, typename R>
-auto center(Self self, size_t width, T fillchar) -> R
-{
-	// Check that fillchar is a character
-	if (fillchar.template length<E>() != 1)
-		throw std::invalid_argument("center(): fillchar");
+	/// Returns the first occurrence at or after a position, or `size_t(-1)` (the empty substring is at every position).
+	auto next(size_t pos) const -> size_t
+	{
+		if (pos > size || size - pos < length)
+			return size_t(-1);
+		if (length == 0)
+			return pos;
+		if (bytes)
+			return byte_find(table, data, pos, size, sub, length);
+
+		// Compare at every character
+		auto iter = encoding_traits<E>::iter(data + pos, data, data + size);
+		auto done = encoding_traits<E>::iter(data + size - length + 1, data, data + size);
+		for (; before<Char>(iter, done); ++ iter)
+		{
+			auto ptr = static_cast<const Char *>(iter);
+			if (Traits::compare(ptr, sub, length) == 0)
+				return ptr - data;
+		}
+		return size_t(-1);
+	}
 
-	// See if any padding is needed
-	if (width < self.template length<E>())
-		return self;
-	size_t diff = width - self.template length<E>();
+	/// Returns the position after the character at a position (or `size_t(-1)` at the end).
+	auto skip(size_t pos) const -> size_t
+	{
+		if (pos >= size)
+			return size_t(-1);
+		auto iter = encoding_traits<E>::iter(data + pos, data, data + size);
+		return static_cast<const Char *>(++ iter) - data;
+	}
 
-	// Create result
-	R result(self.size() + fillchar.size() * diff, 0);
-	char * data = &result[0];
+	/// Returns the position, where the search continues after an occurrence.
+	auto after(size_t pos, bool overlapping) const -> size_t
+		{return (overlapping || length == 0) ? skip(pos) : pos + length;}
 
-	// Add padding
-	size_t l = diff / 2;
-	size_t r = diff - l;
-	for (size_t i = 0; i < l; (++ i, data += fillchar.size()))
-		Traits::copy(data, fillchar.data(), fillchar.size());
-	Traits::copy(data, self.data(), self.size());
-	data += self.size();
-	for (size_t i = 0; i < r; (++ i, data += fillchar.size()))
-		Traits::copy(data, fillchar.data(), fillchar.size());
+private:
+	// Fields
+	const Char * data;
+	size_t size;
+	const Char * sub;
+	size_t length;
+	const kernels::Table & table;
+	bool bytes;
+};
 
-	// Return result
-	return result;
+// Returns the number of characters at the start of the text, that are one codepoint each (and can be counted without
+// decoding, the prefix is found with the string kernels)
+template<Encoding E, typename Char>
+auto fixed_prefix(const Char * data, size_t size) -> size_t
+{
+	if (E == Encoding::Char8 || E == Encoding::Char16 || E == Encoding::Char32 || E == Encoding::UTF32)
+		return size;
+	if (E == Encoding::UTF8 && sizeof(Char) == 1)
+		return kernels::active().ascii_prefix(reinterpret_cast<const char *>(data), size);
+	if (E == Encoding::UTF16 && sizeof(Char) == 2)
+		return kernels::active().utf16_prefix(reinterpret_cast<const char16_t *>(data), size);
+	return 0;
 }
 
-// Algorithm - ljust
-template<typename Self, typename Traits, Encoding E, typename T, typename R>
-auto ljust(Self self, size_t width, T fillchar) -> R
+// Copies the ASCII characters at the start of the input to the output (nothing to do for most encodings)
+template<Encoding From, Encoding To, typename Char, typename Output,
+	enable_when<!(From == Encoding::UTF8 && sizeof(Char) == 1 &&
+		((To == Encoding::UTF16 && std::is_same<typename Output::value_type, char16_t>::value) ||
+		(To == Encoding::UTF32 && std::is_same<typename Output::value_type, char32_t>::value)))> * = nullptr>
+auto copy_ascii(const Char * ptr, const Char *, Output &) -> const Char *
+	{return ptr;}
+
+// Copies the ASCII characters at the start of the input to the output (UTF-8 to UTF-16 and UTF-32, with the kernels)
+template<Encoding From, Encoding To, typename Char, typename Output,
+	enable_when<From == Encoding::UTF8 && sizeof(Char) == 1 &&
+		((To == Encoding::UTF16 && std::is_same<typename Output::value_type, char16_t>::value) ||
+		(To == Encoding::UTF32 && std::is_same<typename Output::value_type, char32_t>::value))> * = nullptr>
+auto copy_ascii(const Char * ptr, const Char * end, Output & output) -> const Char *
 {
-	// Check that fillchar is a character
-	if (fillchar.template length<E>() != 1)
-		throw std::invalid_argument("ljust(): fillchar");
+	// Copy short runs directly
+	size_t size = 0;
+	size_t limit = std::min<size_t>(end - ptr, 16);
+	while (size < limit && uint8_t(ptr[size]) < 0x80)
+		++ size;
+	if (size < limit)
+	{
+		for (size_t i = 0; i < size; ++ i)
+			output.push_back(uint8_t(ptr[i]));
+		return ptr + size;
+	}
 
-	// See if any padding is needed
-	if (width < self.template length<E>())
-		return self;
-	size_t diff = width - self.template length<E>();
+	// Widen long runs with the kernels
+	auto & table = kernels::active();
+	auto data = reinterpret_cast<const char *>(ptr);
+	size += table.ascii_prefix(data + size, (end - ptr) - size);
+	size_t offset = output.size();
+	output.resize(offset + size);
+	if (To == Encoding::UTF16)
+		table.widen16(data, size, reinterpret_cast<char16_t *>(&output[offset]));
+	else
+		table.widen32(data, size, reinterpret_cast<char32_t *>(&output[offset]));
+	return ptr + size;
+}
 
-	// Create result
-	R result(self.size() + fillchar.size() * diff, 0);
-	auto * data = &result[0];
+// Finds the next ASCII character in the range [start, end) with the string kernels
+template<typename Char>
+auto find_ascii(const Char * data, size_t start, size_t end, char ch) -> size_t
+{
+	const Char unit = Char(ch);
+	if (sizeof(Char) != 1)
+		return byte_find(data, start, end, &unit, 1);
+	size_t pos = kernels::active().find_byte(reinterpret_cast<const char *>(data + start), end - start, ch);
+	return (pos == size_t(-1)) ? pos : start + pos;
+}
 
-	// Add padding
-	Traits::copy(data, self.data(), self.size());
-	data += self.size();
-	for (size_t i = 0; i < diff; (++ i, data += fillchar.size()))
-		Traits::copy(data, fillchar.data(), fillchar.size());
+// Returns the size of the quoted text, from the number and the kind of the escaped characters (exact for valid text, only
+// counted for the byte encodings, where the kernels find the escaped characters)
+template<Encoding From, Encoding To, bool Ascii, typename Char>
+auto quote_size(const Char * data, size_t size) -> size_t
+{
+	size_t result = size + 2;
+	if (sizeof(Char) != 1 || (From != Encoding::UTF8 && From != Encoding::Char8))
+		return result;
 
-	// Return result
+	auto & table = kernels::active();
+	auto bytes = reinterpret_cast<const char *>(data);
+	for (size_t i = table.escape_prefix(bytes, size, Ascii); i < size; i += table.escape_prefix(bytes + i, size - i, Ascii))
+	{
+		uint8_t ch = uint8_t(bytes[i ++]);
+		if (ch >= 0x80 && From == Encoding::Char8)
+			result += 5;
+		else if (ch >= 0x80)
+			result += (ch >= 0xF0) ? 6 : (ch >= 0xE0) ? 3 : (ch >= 0xC0) ? 4 : 0;
+		else if (ch >= 0x20 || ch == 0 || (ch >= '\a' && ch <= '\r'))
+			result += 1;
+		else
+			result += 5;
+	}
 	return result;
 }
 
-// Algorithm - rjust
-template<typename Self, typename Traits, Encoding E, typename T, typename R>
-auto rjust(Self self, size_t width, T fillchar) -> R
+// Returns true, if a unit of a wide encoding is a whole character by itself (the surrogates and the invalid codepoints
+// are not)
+template<Encoding E>
+auto plain_unit(uint32_t ch) -> bool
 {
-	// Check that fillchar is a character
-	if (fillchar.template length<E>() != 1)
-		throw std::invalid_argument("rjust(): fillchar");
-
-	// See if any padding is needed
-	if (width < self.template length<E>())
-		return self;
-	size_t diff = width - self.template length<E>();
-
-	// Create result
-	R result(self.size() + fillchar.size() * diff, 0);
-	auto * data = &result[0];
-
-	// Add padding
-	for (size_t i = 0; i < diff; (++ i, data += fillchar.size()))
-		Traits::copy(data, fillchar.data(), fillchar.size());
-	Traits::copy(data, self.data(), self.size());
-
-	// Return result
-	return result;
+	return E == Encoding::Char16 || E == Encoding::Char32 ||
+		(E == Encoding::UTF16 && (ch & 0xF800) != 0xD800) ||
+		(E == Encoding::UTF32 && (ch & 0xFFFFF800) != 0xD800 && ch < 0x110000);
 }
 
-// Algorithm - zfill
-template<typename Self, typename Traits, Encoding E, typename R>
-auto zfill(Self self, size_t width) -> R
+// Returns the size of the text without an incomplete sequence at the end (a sequence cut by the end of a chunk, that
+// might be completed by the next one)
+template<Encoding E, typename Char>
+auto complete_size(const Char * data, size_t size) -> size_t
 {
-	// See if any padding is needed
-	if (width < self.template length<E>())
-		return self;
-	size_t diff = width - self.template length<E>();
+	// A lead byte with fewer continuation bytes than it needs (UTF-8)
+	if (E == Encoding::UTF8 && sizeof(Char) == 1)
+	{
+		for (size_t n = 1; n <= 3 && n <= size; ++ n)
+		{
+			uint8_t ch = uint8_t(data[size - n]);
+			if ((ch & 0xC0) == 0x80)
+				continue;
+			size_t length = (ch >= 0xF0) ? 4 : (ch >= 0xE0) ? 3 : (ch >= 0xC0) ? 2 : 1;
+			return (length > n) ? size - n : size;
+		}
+		return size;
+	}
 
-	// Create result
-	R result(self.size() + diff, 0);
-	auto * data = &result[0];
+	// A high surrogate (UTF-16)
+	if (E == Encoding::UTF16 && sizeof(Char) == 2 && size && (uint16_t(data[size - 1]) & 0xFC00) == 0xD800)
+		return size - 1;
+	return size;
+}
 
-	// Check first character
-	auto first = self.data()[0];
-	if (first == '+' || first == '-')
+// Feeds a chunk of a stream to a function, that returns the number of characters it used (the unused characters at the
+// end are kept, and passed again with the start of the next chunk)
+template<typename Char, typename Traits, typename Allocator, typename Function>
+void feed(better_string<Char, Traits, Allocator> & pending, better_string_view<Char, Traits> chunk, Function function)
+{
+	// Complete the kept characters with the start of the chunk (16 characters complete any sequence)
+	while (!pending.empty() && !chunk.empty())
 	{
-		data[0] = first;
-		++ data;
-		for (size_t i = 0; i < diff; ++ i)
-			data[i] = '0';
-		Traits::copy(data + diff, self.data() + 1, self.size() - 1);
+		size_t size = pending.size();
+		size_t take = std::min<size_t>(chunk.size(), 16);
+		pending.extend(chunk.data(), take);
+		size_t used = function(better_string_view<Char, Traits>(pending.data(), pending.size()));
+		if (used >= size)
+		{
+			chunk.remove_prefix(used - size);
+			pending.clear();
+		}
+		else
+		{
+			chunk.remove_prefix(take);
+			pending.erase(0, used);
+		}
 	}
-	else
+
+	// Use the rest of the chunk directly
+	if (!chunk.empty())
 	{
-		for (size_t i = 0; i < diff; ++ i)
-			data[i] = '0';
-		Traits::copy(data + diff, self.data(), self.size());
+		size_t used = function(chunk);
+		pending.assign(chunk.data() + used, chunk.size() - used);
 	}
-
-	// Return result
-	return result;
 }
 
-// -------------------- Search --------------------
+// Bytes escaped in JSON strings (and the bytes of the non-ASCII characters, for ASCII only output)
+static constexpr auto json_special = kernels::ByteSet::of([] (uint8_t ch) {return ch < 0x20 || ch == '"' || ch == '\\';});
+static constexpr auto json_special_ascii = kernels::ByteSet::of([] (uint8_t ch) {return ch < 0x20 || ch == '"' || ch == '\\' || ch >= 0x80;});
 
-// Algorithm - find
-template<typename Self, typename Traits, Encoding E, typename T>
-auto find(Self self, T sub, size_t start, size_t end) -> size_t
-{
-	// Check length
-	if (self.size() < sub.size())
-		return 0;
+// Bytes decoded in percent encoded text (and in HTML form data)
+static constexpr auto percent_special = kernels::ByteSet::of([] (uint8_t ch) {return ch == '%' || ch == '+';});
 
-	// Create iterators
-	end = std::min(end, self.size());
-	auto iter = encoding_traits<E>::iter(self.data() + start);
-	auto done = encoding_traits<E>::iter(self.data() + end - sub.size() + 1);
+// Bytes separating shell-like tokens, and the bytes starting a quote or an escape (and ending a double quote)
+static constexpr auto shlex_space = kernels::ByteSet::of([] (uint8_t ch) {return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n';});
+static constexpr auto shlex_special = kernels::ByteSet::of([] (uint8_t ch)
+	{return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n' || ch == '\'' || ch == '"' || ch == '\\';});
+static constexpr auto shlex_double = kernels::ByteSet::of([] (uint8_t ch) {return ch == '"' || ch == '\\';});
 
-	// Find match
-	for (; iter != done; ++ iter)
+// Bytes escaped in HTML (the quotes only in attribute values)
+static constexpr auto html_special = kernels::ByteSet::of([] (uint8_t ch) {return ch == '&' || ch == '<' || ch == '>';});
+static constexpr auto html_special_quote = kernels::ByteSet::of([] (uint8_t ch)
+	{return ch == '&' || ch == '<' || ch == '>' || ch == '"' || ch == '\'';});
+
+// Returns the end of the run at the start of the text, that is not escaped in HTML
+template<typename Char>
+auto html_run(const Char * ptr, const Char * end, bool quote) -> const Char *
+{
+	if (sizeof(Char) == 1)
 	{
-		auto ptr = static_cast<const typename Traits::char_type *>(iter);
-		if (Traits::compare(ptr, sub.data(), sub.size()) == 0)
-			return ptr - self.data();
+		auto data = reinterpret_cast<const char *>(ptr);
+		return ptr + std::min<size_t>(kernels::active().find_any(data, end - ptr, quote ? html_special_quote : html_special), end - ptr);
 	}
-
-	// Not found
-	return size_t(-1);
+	for (; ptr != end; ++ ptr)
+		if (*ptr == Char('&') || *ptr == Char('<') || *ptr == Char('>') || (quote && (*ptr == Char('"') || *ptr == Char('\''))))
+			break;
+	return ptr;
 }
 
-// Algorithm - rfind (reversible)
-template<typename Self, typename Traits, Encoding E, typename T,
-	impl::enable_when_reversible<E> * = nullptr>
-auto rfind(Self self, T sub, size_t start, size_t end) -> size_t
+// Named character reference
+struct HtmlEntity
 {
-	// Check length
-	if (self.size() < sub.size())
-		return 0;
+	char name[9];
+	uint32_t codepoint;
+};
 
-	// Create iterators
-	end = std::min(end, self.size());
-	auto done = encoding_traits<E>::iter(self.data() + start + sub.size() - 1);
-	auto iter = encoding_traits<E>::iter(self.data() + end);
+// Displacements of the buckets of named character references (generated by tools/html-entities.py)
+static constexpr uint8_t html_displacements[128] = {
+	1, 0, 19, 0, 1, 4, 38, 3, 2, 8, 1, 6, 3, 6, 16, 3,
+	38, 0, 2, 1, 3, 2, 1, 2, 1, 3, 7, 5, 3, 24, 4, 7,
+	12, 10, 2, 36, 10, 0, 1, 5, 1, 28, 7, 10, 34, 7, 1, 1,
+	16, 11, 4, 3, 4, 4, 0, 7, 0, 0, 40, 5, 1, 29, 14, 4,
+	1, 21, 24, 16, 1, 19, 13, 1, 7, 1, 5, 10, 1, 35, 18, 7,
+	13, 11, 2, 61, 0, 10, 8, 11, 8, 3, 7, 2, 0, 7, 8, 9,
+	0, 0, 0, 2, 6, 58, 10, 2, 33, 26, 5, 0, 0, 11, 1, 0,
+	11, 0, 23, 5, 14, 22, 38, 45, 2, 0, 2, 0, 31, 68, 89, 0,
+};
 
-	// Find match
-	for (; done != iter; -- iter)
-	{
-		auto ptr = static_cast<const typename Traits::char_type *>(iter) - sub.size();
-		if (Traits::compare(ptr, sub.data(), sub.size()) == 0)
-			return ptr - self.data();
-	}
+// Named character references, in the slots of the perfect hash table (generated by tools/html-entities.py)
+static constexpr HtmlEntity html_entities[256] = {
+	{"uuml", 0xFC}, {"Uacute", 0xDA}, {"kappa", 0x3BA}, {"Uuml", 0xDC}, {"Euml", 0xCB}, {"omicron", 0x3BF},
+	{"ndash", 0x2013}, {"rceil", 0x2309}, {"oline", 0x203E}, {"dArr", 0x21D3}, {"prop", 0x221D}, {"", 0},
+	{"Eta", 0x397}, {"ETH", 0xD0}, {"ugrave", 0xF9}, {"lang", 0x2329}, {"AElig", 0xC6}, {"Mu", 0x39C},
+	{"oslash", 0xF8}, {"brvbar", 0xA6}, {"Theta", 0x398}, {"tilde", 0x2DC}, {"beta", 0x3B2}, {"omega", 0x3C9},
+	{"uml", 0xA8}, {"Chi", 0x3A7}, {"fnof", 0x192}, {"reg", 0xAE}, {"lArr", 0x21D0}, {"le", 0x2264},
+	{"mu", 0x3BC}, {"part", 0x2202}, {"Icirc", 0xCE}, {"ne", 0x2260}, {"prod", 0x220F}, {"atilde", 0xE3},
+	{"plusmn", 0xB1}, {"and", 0x2227}, {"dagger", 0x2020}, {"shy", 0xAD}, {"OElig", 0x152}, {"Ograve", 0xD2},
+	{"szlig", 0xDF}, {"sup", 0x2283}, {"Upsilon", 0x3A5}, {"ouml", 0xF6}, {"Ugrave", 0xD9}, {"quot", 0x22},
+	{"sdot", 0x22C5}, {"thetasym", 0x3D1}, {"Ntilde", 0xD1}, {"uArr", 0x21D1}, {"Yuml", 0x178}, {"not", 0xAC},
+	{"thinsp", 0x2009}, {"sum", 0x2211}, {"lsquo", 0x2018}, {"there4", 0x2234}, {"rdquo", 0x201D}, {"pound", 0xA3},
+	{"rlm", 0x200F}, {"larr", 0x2190}, {"sect", 0xA7}, {"alefsym", 0x2135}, {"circ", 0x2C6}, {"equiv", 0x2261},
+	{"mdash", 0x2014}, {"yacute", 0xFD}, {"ordm", 0xBA}, {"empty", 0x2205}, {"ni", 0x220B}, {"Atilde", 0xC3},
+	{"ucirc", 0xFB}, {"cedil", 0xB8}, {"euro", 0x20AC}, {"Ecirc", 0xCA}, {"Egrave", 0xC8}, {"sim", 0x223C},
+	{"apos", 0x27}, {"radic", 0x221A}, {"aelig", 0xE6}, {"Alpha", 0x391}, {"real", 0x211C}, {"Igrave", 0xCC},
+	{"Pi", 0x3A0}, {"", 0}, {"Oslash", 0xD8}, {"delta", 0x3B4}, {"iquest", 0xBF}, {"Dagger", 0x2021},
+	{"Nu", 0x39D}, {"piv", 0x3D6}, {"image", 0x2111}, {"aring", 0xE5}, {"rho", 0x3C1}, {"tau", 0x3C4},
+	{"Aring", 0xC5}, {"Tau", 0x3A4}, {"Phi", 0x3A6}, {"upsilon", 0x3C5}, {"crarr", 0x21B5}, {"epsilon", 0x3B5},
+	{"Zeta", 0x396}, {"scaron", 0x161}, {"oelig", 0x153}, {"exist", 0x2203}, {"sup3", 0xB3}, {"Gamma", 0x393},
+	{"ang", 0x2220}, {"Acirc", 0xC2}, {"otilde", 0xF5}, {"curren", 0xA4}, {"rsaquo", 0x203A}, {"Eacute", 0xC9},
+	{"Epsilon", 0x395}, {"auml", 0xE4}, {"theta", 0x3B8}, {"oacute", 0xF3}, {"lt", 0x3C}, {"nu", 0x3BD},
+	{"ccedil", 0xE7}, {"or", 0x2228}, {"Ccedil", 0xC7}, {"frac34", 0xBE}, {"lrm", 0x200E}, {"raquo", 0xBB},
+	{"sigmaf", 0x3C2}, {"permil", 0x2030}, {"loz", 0x25CA}, {"perp", 0x22A5}, {"sup2", 0xB2}, {"ldquo", 0x201C},
+	{"trade", 0x2122}, {"Sigma", 0x3A3}, {"ordf", 0xAA}, {"uarr", 0x2191}, {"nbsp", 0xA0}, {"eth", 0xF0},
+	{"cup", 0x222A}, {"lsaquo", 0x2039}, {"micro", 0xB5}, {"sube", 0x2286}, {"Ucirc", 0xDB}, {"supe", 0x2287},
+	{"Iota", 0x399}, {"nabla", 0x2207}, {"rfloor", 0x230B}, {"Omicron", 0x39F}, {"darr", 0x2193}, {"Iacute", 0xCD},
+	{"Delta", 0x394}, {"eacute", 0xE9}, {"Ocirc", 0xD4}, {"rArr", 0x21D2}, {"yen", 0xA5}, {"prime", 0x2032},
+	{"iacute", 0xED}, {"Iuml", 0xCF}, {"ensp", 0x2002}, {"oplus", 0x2295}, {"acute", 0xB4}, {"hellip", 0x2026},
+	{"ge", 0x2265}, {"asymp", 0x2248}, {"lceil", 0x2308}, {"iexcl", 0xA1}, {"sbquo", 0x201A}, {"notin", 0x2209},
+	{"gt", 0x3E}, {"zwj", 0x200D}, {"Yacute", 0xDD}, {"lambda", 0x3BB}, {"rsquo", 0x2019}, {"Aacute", 0xC1},
+	{"weierp", 0x2118}, {"macr", 0xAF}, {"bdquo", 0x201E}, {"alpha", 0x3B1}, {"Oacute", 0xD3}, {"rang", 0x232A},
+	{"thorn", 0xFE}, {"cong", 0x2245}, {"emsp", 0x2003}, {"Lambda", 0x39B}, {"amp", 0x26}, {"para", 0xB6},
+	{"THORN", 0xDE}, {"divide", 0xF7}, {"Prime", 0x2033}, {"pi", 0x3C0}, {"frac12", 0xBD}, {"hArr", 0x21D4},
+	{"frac14", 0xBC}, {"Psi", 0x3A8}, {"nsub", 0x2284}, {"Rho", 0x3A1}, {"spades", 0x2660}, {"bull", 0x2022},
+	{"Ouml", 0xD6}, {"egrave", 0xE8}, {"cap", 0x2229}, {"copy", 0xA9}, {"zwnj", 0x200C}, {"sub", 0x2282},
+	{"minus", 0x2212}, {"acirc", 0xE2}, {"aacute", 0xE1}, {"Kappa", 0x39A}, {"eta", 0x3B7}, {"times", 0xD7},
+	{"upsih", 0x3D2}, {"sup1", 0xB9}, {"ntilde", 0xF1}, {"lowast", 0x2217}, {"int", 0x222B}, {"igrave", 0xEC},
+	{"diams", 0x2666}, {"Omega", 0x3A9}, {"frasl", 0x2044}, {"", 0}, {"harr", 0x2194}, {"Otilde", 0xD5},
+	{"ecirc", 0xEA}, {"laquo", 0xAB}, {"hearts", 0x2665}, {"otimes", 0x2297}, {"uacute", 0xFA}, {"isin", 0x2208},
+	{"iuml", 0xEF}, {"xi", 0x3BE}, {"sigma", 0x3C3}, {"chi", 0x3C7}, {"icirc", 0xEE}, {"forall", 0x2200},
+	{"euml", 0xEB}, {"zeta", 0x3B6}, {"infin", 0x221E}, {"middot", 0xB7}, {"rarr", 0x2192}, {"phi", 0x3C6},
+	{"cent", 0xA2}, {"iota", 0x3B9}, {"agrave", 0xE0}, {"Xi", 0x39E}, {"lfloor", 0x230A}, {"gamma", 0x3B3},
+	{"deg", 0xB0}, {"clubs", 0x2663}, {"ocirc", 0xF4}, {"yuml", 0xFF}, {"Agrave", 0xC0}, {"Scaron", 0x160},
+	{"psi", 0x3C8}, {"Beta", 0x392}, {"ograve", 0xF2}, {"Auml", 0xC4},
+};
 
-	// Not found
-	return size_t(-1);
+// FNV-1a hash of a name (the seed selects one of the hash functions)
+template<typename Char>
+constexpr auto html_hash(const Char * name, size_t length, uint32_t seed) -> uint32_t
+{
+	uint32_t hash = 2166136261u ^ seed;
+	for (size_t i = 0; i < length; ++ i)
+		hash = (hash ^ uint8_t(name[i])) * 16777619u;
+	return hash;
 }
 
-// Algorithm - index
-template<typename Self, typename Traits, Encoding E, typename T>
-auto index(Self self, T sub, size_t start, size_t end) -> size_t
+// Returns the codepoint of a named character reference (or -1, when the name is not known)
+template<typename Char>
+auto html_entity(const Char * name, size_t length) -> int32_t
 {
-	// Check length
-	if (self.size() < sub.size())
-		return 0;
+	using Unit = typename std::make_unsigned<Char>::type;
+	if (length == 0 || length > 8)
+		return -1;
+
+	uint32_t seed = html_displacements[html_hash(name, length, 0) % 128];
+	auto & entity = html_entities[html_hash(name, length, seed) % 256];
+	for (size_t i = 0; i < length; ++ i)
+		if (Unit(name[i]) != uint8_t(entity.name[i]))
+			return -1;
+	return entity.name[length] ? -1 : int32_t(entity.codepoint);
+}
 
-	// Create iterators
-	end = std::min(end, self.size());
-	auto iter = encoding_traits<E>::iter(self.data() + start);
-	auto done = encoding_traits<E>::iter(self.data() + end - sub.size() + 1);
+// The characters of the numeric references in the C1 control range (HTML5 decodes them as windows-1252, except the
+// five bytes not defined there)
+static constexpr uint16_t html_c1[32] = {
+	0x20AC, 0x81, 0x201A, 0x192, 0x201E, 0x2026, 0x2020, 0x2021, 0x2C6, 0x2030, 0x160, 0x2039, 0x152, 0x8D, 0x17D, 0x8F,
+	0x90, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014, 0x2DC, 0x2122, 0x161, 0x203A, 0x153, 0x9D, 0x17E, 0x178,
+};
 
-	// Find match
-	for (; iter != done; ++ iter)
+// Returns the end of the run at the start of the text, that is the same in JSON strings (the run is found with the
+// kernels for the byte encodings; `verbatim` is cleared when the run is not valid, and has to be decoded)
+template<Encoding E, typename Char>
+auto json_run(const Char * ptr, const Char * end, bool ascii, bool & verbatim) -> const Char *
+{
+	verbatim = true;
+
+	// Byte encodings
+	if (sizeof(Char) == 1 && (E == Encoding::UTF8 || E == Encoding::Char8))
 	{
-		auto ptr = static_cast<const typename Traits::char_type *>(iter);
-		if (Traits::compare(ptr, sub.data(), sub.size()) == 0)
-			return ptr - self.data();
+		auto & table = kernels::active();
+		auto data = reinterpret_cast<const char *>(ptr);
+		size_t size = std::min<size_t>(table.find_any(data, end - ptr, ascii ? json_special_ascii : json_special), end - ptr);
+		if (E == Encoding::UTF8 && !ascii)
+			verbatim = (table.utf8_length(data, size) != size_t(-1));
+		return ptr + size;
 	}
 
-	// Not found
-	throw std::invalid_argument("index(): sub");
+	// Other encodings
+	for (; ptr != end; ++ ptr)
+	{
+		uint32_t ch = typename std::make_unsigned<Char>::type(*ptr);
+		if (ch < 0x20 || ch == '"' || ch == '\\')
+			break;
+		if (ch >= 0x80 && (ascii || !plain_unit<E>(ch)))
+			break;
+	}
+	return ptr;
 }
 
-// Algorithm - rindex (reversible)
-template<typename Self, typename Traits, Encoding E, typename T,
-	impl::enable_when_reversible<E> * = nullptr>
-auto rindex(Self self, T sub, size_t start, size_t end) -> size_t
+// Returns the end of the run at the start of the text, that is copied by quote() unchanged (the run is found with the
+// kernels for the byte encodings; `verbatim` is cleared when the run is not valid, and has to be decoded)
+template<Encoding From, Encoding To, bool Ascii, typename Char, typename Output>
+auto quote_run(const Char * ptr, const Char * end, bool & verbatim) -> const Char *
 {
-	// Check length
-	if (self.size() < sub.size())
-		return 0;
-
-	// Create iterators
-	end = std::min(end, self.size());
-	auto done = encoding_traits<E>::iter(self.data() + start + sub.size() - 1);
-	auto iter = encoding_traits<E>::iter(self.data() + end);
+	// Non-ASCII characters are only copied when the encoding does not change
+	constexpr bool same = (From == To && sizeof(Char) == sizeof(typename Output::value_type));
+	verbatim = true;
 
-	// Find match
-	for (; done != iter; -- iter)
+	// Byte encodings
+	if (sizeof(Char) == 1 && (From == Encoding::UTF8 || From == Encoding::Char8))
 	{
-		auto ptr = static_cast<const typename Traits::char_type *>(iter) - sub.size();
-		if (Traits::compare(ptr, sub.data(), sub.size()) == 0)
-			return ptr - self.data();
+		auto & table = kernels::active();
+		auto data = reinterpret_cast<const char *>(ptr);
+		size_t size = table.escape_prefix(data, end - ptr, Ascii || !same);
+		if (From == Encoding::UTF8 && !Ascii && same)
+			verbatim = (table.utf8_length(data, size) != size_t(-1));
+		return ptr + size;
 	}
 
-	// Not found
-	throw std::invalid_argument("rindex(): sub");
+	// Other encodings (the surrogates and the invalid codepoints are decoded)
+	for (; ptr != end; ++ ptr)
+	{
+		uint32_t ch = typename std::make_unsigned<Char>::type(*ptr);
+		if (ch < 0x20 || ch == '"' || ch == '\'' || ch == '\\')
+			break;
+		if (ch >= 0x80 && (Ascii || !same || !plain_unit<From>(ch)))
+			break;
+	}
+	return ptr;
 }
 
-// Algorithm - count
-template<typename Self, typename Traits, Encoding E, typename T>
-auto count(Self self, T sub, size_t start, size_t end) -> size_t
+// Appends one character to the quoted text (with an escape sequence, when needed)
+template<Encoding To, bool Ascii, typename Output>
+void quote_char(uint32_t ch, Output & result)
 {
-	// Check length
-	if (self.size() < sub.size())
-		return 0;
-
-	// Create iterators
-	end = std::min(end, self.size());
-	auto iter = encoding_traits<E>::iter(self.data() + start);
-	auto done = encoding_traits<E>::iter(self.data() + end - sub.size() + 1);
-
-	// Count non-overlapping occurances
-	size_t result = 0;
-	while (iter != done)
+	switch (ch)
 	{
-		auto ptr = static_cast<const typename Traits::char_type *>(iter);
-		if (Traits::compare(ptr, sub.data(), sub.size()) == 0)
+		case '\'':
+		case '\"':
+		case '\\':
+			result.push_back('\\');
+			result.push_back(char(ch));
+			return;
+		case '\0':
+			result.push_back('\\');
+			result.push_back('0');
+			return;
+		case '\a':
+			result.push_back('\\');
+			result.push_back('a');
+			return;
+		case '\b':
+			result.push_back('\\');
+			result.push_back('b');
+			return;
+		case '\f':
+			result.push_back('\\');
+			result.push_back('f');
+			return;
+		case '\n':
+			result.push_back('\\');
+			result.push_back('n');
+			return;
+		case '\r':
+			result.push_back('\\');
+			result.push_back('r');
+			return;
+		case '\t':
+			result.push_back('\\');
+			result.push_back('t');
+			return;
+		case '\v':
+			result.push_back('\\');
+			result.push_back('v');
+			return;
+	}
+	if (ch < 0x20 || (Ascii && ch >= 0x80))
+	{
+		const char * digits = "0123456789abcdef";
+		if (ch < 0x10000)
+		{
+			size_t n = result.size();
+			result.resize(n + 6);
+			result[n] = '\\';
+			result[n + 1] = 'u';
+			result[n + 2] = digits[(ch >> 12) & 0xF];
+			result[n + 3] = digits[(ch >> 8) & 0xF];
+			result[n + 4] = digits[(ch >> 4) & 0xF];
+			result[n + 5] = digits[ch & 0xF];
+		}
+		else if (ch < 0x110000)
 		{
-			iter = ptr + sub.size();
-			++ result;
+			size_t n = result.size();
+			result.resize(n + 10);
+			result[n] = '\\';
+			result[n + 1] = 'U';
+			result[n + 2] = digits[(ch >> 28) & 0xF];
+			result[n + 3] = digits[(ch >> 24) & 0xF];
+			result[n + 4] = digits[(ch >> 20) & 0xF];
+			result[n + 5] = digits[(ch >> 16) & 0xF];
+			result[n + 6] = digits[(ch >> 12) & 0xF];
+			result[n + 7] = digits[(ch >> 8) & 0xF];
+			result[n + 8] = digits[(ch >> 4) & 0xF];
+			result[n + 9] = digits[ch & 0xF];
 		}
+		else if (Ascii)
+			result.push_back('?');
 		else
-			++ iter;
+			encoding_traits<To>::append(result, encoding_traits<To>::replacement);
+	}
+	else if (Ascii)
+		result.push_back(ch);
+	else if (!encoding_traits<To>::append(result, ch))
+	{
+		encoding_traits<To>::append(result, encoding_traits<To>::replacement);
 	}
-
-	// Return result
-	return result;
 }
 
-// -------------------- Replace --------------------
+// Centers a formatted value like Python's format() (the odd padding character goes to the right, unlike in center())
+template<Encoding E, typename String, typename Fill>
+auto format_center(const String & str, size_t width, Fill fill) -> String
+	{return str.template rjust<E>((width + str.template length<E>()) / 2, fill).template ljust<E>(width, fill);}
 
-// Algorithm - replace
-template<typename Self, typename Traits, Encoding E, typename T, typename U, typename R>
-auto replace(Self self, T old, U str, size_t count) -> R
+// Formatter template for selecting functions
+template<Encoding E, typename Char, typename T>
+void formatter(const void * value, int32_t func, better_string_view<Char> spec, better_string<Char> & out)
 {
-	// Check length
-	if (self.size() < old.size())
-		return 0;
-
-	// Allocate result
-	R result;
-
-	// Create iterators
-	auto prev = self.data();
-	auto iter = encoding_traits<E>::iter(self.data());
-	auto done = encoding_traits<E>::iter(self.data() + self.size() - old.size() + 1);
-
-	// Build result
-	while (count != 0 && iter != done)
-	{
-		auto ptr = static_cast<const typename Traits::char_type *>(iter);
-		if (Traits::compare(ptr, old.data(), old.size()) == 0)
-		{
-			// Resize string
-			size_t end = result.size();
-			size_t size = ptr - prev;
-			result.resize(end + size + str.size());
-			auto data = &result[end];
-
-			// Copy before
-			Traits::copy(data, prev, size);
-			data += size;
-
-			// Copy replacement
-			Traits::copy(data, str.data(), str.size());
-			data += str.size();
+	// Use a proxy object, to handle non-class types
+	using Type = typename std::remove_cv<typename std::remove_reference<T>::type>::type;
 
-			// Next
-			iter = prev = ptr + old.size();
-			-- count;
-		}
-		else
-			++ iter;
-	}
+	// No conversion
+	if (func == 0)
+		out.extend(format_proxy<Type>::type::template format__<Char, E>(* static_cast<const Type *>(value), spec));
 
-	// Resize string
-	size_t end = result.size();
-	size_t size = self.data() + self.size() - prev;
-	result.resize(end + size);
-	auto data = &result[end];
+	// Ascii conversion
+	else if (func == 'a')
+		out.extend(better_string<Char>::template format__<Char, E>(
+			format_proxy<Type>::type::template ascii__<Char, E>(* static_cast<const Type *>(value)), spec));
 
-	// Copy last part
-	Traits::copy(data, prev, size);
+	// Repr conversion
+	else if (func == 'r')
+		out.extend(better_string<Char>::template format__<Char, E>(
+			format_proxy<Type>::type::template repr__<Char, E>(* static_cast<const Type *>(value)), spec));
 
-	// Return result
-	return result;
+	// String conversion
+	else if (func == 's')
+		out.extend(better_string<Char>::template format__<Char, E>(
+			format_proxy<Type>::type::template str__<Char, E>(* static_cast<const Type *>(value)), spec));
 }
 
-// Algorithm - translate
-template<typename Self, typename Traits, Encoding E, typename Function, typename R>
-auto translate(Self self, Function table, impl::Errors mode) -> R
-{
-	// Create result
-	R result;
+// -------------------- Edit distance --------------------
 
-	// Iterators
-	auto iter = encoding_traits<E>::iter(self.data());
-	auto done = encoding_traits<E>::iter(self.data() + self.size());
+/************************************************************
+ * @brief Columns of the edit distance matrix of a pattern and a text, computed 64 rows at a time (Myers' bit-vector
+ * algorithm, and Hyyrö's transpositions for the optimal string alignment distance).
+ *
+ * Only the blocks that can hold values up to the limit are computed (Ukkonen's band): a block is added below the last
+ * one when its bottom row is within the limit, and removed when all of its rows are above it. For whole strings, the
+ * blocks above the diagonal band are removed too. The rows outside of the band are overestimated, so only the values up
+ * to the limit are exact.
+ */
+class EditMatrix
+{
+public:
+	static constexpr size_t npos = size_t(-1);
 
-	// Translate characters
-	if (mode == impl::Errors::Strict)
+	// Constructors
+	template<typename Unit>
+	EditMatrix(const Unit * pattern, size_t size, bool transpositions)
+		: size(size), count((size + 63) / 64), last_bit((size - 1) % 64), transpositions(transpositions)
 	{
-		// Throw errors as exceptions
-		for (;iter != done; ++ iter)
+		// The positions of every character (the characters above 0xFF are looked up in a sorted list)
+		if (count > 1)
 		{
-			int32_t cp = *iter;
-			if (cp < 0)
-				throw std::invalid_argument("translate(): input: Decoding error!");
-			cp = table(cp);
-			if (cp != -1 && !encoding_traits<E>::append(result, cp))
-				throw std::invalid_argument("translate(): input: Encoding error!");
+			heap_table.assign(256 * count, 0);
+			heap_blocks.resize(count);
+			table = heap_table.data();
+			blocks = heap_blocks.data();
 		}
-	}
-	else if (mode == impl::Errors::Replace)
-	{
-		// Replace errors
-		for (;iter != done; ++ iter)
+		else
+			std::fill(std::begin(local_table), std::end(local_table), 0);
+
+		std::vector<std::pair<uint32_t, size_t>> others;
+		for (size_t i = 0; i < size; ++ i)
 		{
-			int32_t cp = *iter;
-			if (cp < 0)
-				cp = encoding_traits<E>::replacement;
-			cp = table(cp);
-			if (cp != -1 && !encoding_traits<E>::append(result, cp))
-				encoding_traits<E>::append(result, encoding_traits<E>::replacement);
+			uint32_t ch = uint32_t(pattern[i]);
+			if (ch < 256)
+				table[ch * count + i / 64] |= uint64_t(1) << (i % 64);
+			else
+				others.push_back({ch, i});
 		}
-	}
-	else if (mode == impl::Errors::Ignore)
-	{
-		// Ignore errors
-		for (;iter != done; ++ iter)
+		std::sort(others.begin(), others.end());
+		for (auto & item : others)
 		{
-			int32_t cp = *iter;
-			if (cp < 0)
-				continue;
-			cp = table(cp);
-			if (cp != -1)
-				encoding_traits<E>::append(result, cp);
+			if (keys.empty() || keys.back() != item.first)
+			{
+				keys.push_back(item.first);
+				masks.resize(masks.size() + count, 0);
+			}
+			masks[(keys.size() - 1) * count + item.second / 64] |= uint64_t(1) << (item.second % 64);
 		}
 	}
-	else
-		throw std::invalid_argument("translate(): mode");
 
-	// Return result
-	return result;
-};
-
-// Algorithm - expandtabs
-template<typename Self, typename Traits, Encoding E, typename R>
-auto expandtabs(Self self, size_t tabsize) -> R
-{
-	// Result
-	R result;
+	EditMatrix(const EditMatrix &) = delete;
+	auto operator = (const EditMatrix &) -> EditMatrix & = delete;
 
-	// Iterators
-	auto iter = encoding_traits<E>::iter(self.data());
-	auto done = encoding_traits<E>::iter(self.data() + self.size());
+	/**
+	 * @brief Starts the first column (the first row is zero for searches, or the column number for whole strings).
+	 */
+	void reset(bool whole, size_t max)
+	{
+		global = whole;
+		limit = max;
+		column = 0;
+		previous = 0xFFFFFFFF;
+		first = 0;
+		last = (std::min(size, limit + 1) - 1) / 64;
+		for (size_t b = 0; b <= last; ++ b)
+			blocks[b] = {~uint64_t(0), 0, ~uint64_t(0), 64 * b + rows(b)};
+	}
 
-	// Build result
-	size_t count = 0;
-	for (; iter != done; ++ iter)
+	/// Computes the next column.
+	void step(uint32_t ch)
 	{
-		int32_t cp = *iter;
-		if (cp == '\t')
+		int hin = global ? 1 : 0;
+		uint64_t carry = 0;
+		for (size_t b = first; b <= last; ++ b)
 		{
-			for (; count < tabsize; ++ count)
-				result.push_back(' ');
-			count = 0;
+			auto & block = blocks[b];
+			uint64_t eq = mask(ch, b);
+
+			// Transpositions: the characters matched in the opposite order in the previous column
+			uint64_t tr = 0;
+			if (transpositions)
+			{
+				uint64_t x = ~block.d0 & eq;
+				tr = ((x << 1) | carry) & mask(previous, b);
+				carry = x >> 63;
+			}
+
+			uint64_t negative = (hin < 0);
+			uint64_t xv = eq | block.vn | tr;
+			uint64_t xe = eq | negative;
+			uint64_t xh = (((xe & block.vp) + block.vp) ^ block.vp) | xe | tr;
+			uint64_t ph = block.vn | ~(xh | block.vp);
+			uint64_t mh = block.vp & xh;
+
+			size_t bit = (b + 1 == count) ? last_bit : 63;
+			int hout = int((ph >> bit) & 1) - int((mh >> bit) & 1);
+			ph = (ph << 1) | uint64_t(hin > 0);
+			mh = (mh << 1) | negative;
+			block.vp = mh | ~(xv | ph);
+			block.vn = ph & xv;
+			block.d0 = xh | xv;
+			block.score += hout;
+			hin = hout;
 		}
-		else
+		previous = ch;
+		++ column;
+
+		// The blocks above the diagonal band, and the last blocks above the limit
+		if (global)
+			while (first < last && 64 * (first + 1) + limit < column)
+				++ first;
+		while (last > first && blocks[last].score >= limit + rows(last))
+			-- last;
+
+		// A new block (its rows are overestimated from the bottom row of the block above)
+		if (last + 1 < count && blocks[last].score <= limit)
 		{
-			encoding_traits<E>::append(result, cp);
-			++ count;
-			if (count == tabsize || cp == '\r' || cp == '\n')
-				count = 0;
+			++ last;
+			blocks[last] = {~uint64_t(0), 0, ~uint64_t(0), blocks[last - 1].score + rows(last)};
 		}
 	}
 
-	// Return result
-	return result;
-}
+	/// Returns the value of the last row (or npos, when it is outside of the band).
+	auto score() const -> size_t
+		{return (last + 1 == count) ? blocks[last].score : npos;}
 
-// -------------------- Split and join --------------------
+	/// Returns true, when every value of the column is above the limit (for whole strings, no later value can be lower).
+	auto exhausted() const -> bool
+		{return last == first && blocks[last].score >= limit + rows(last);}
 
-// Algorithm - join (container)
-template<typename Self, typename Traits, typename Iterable, typename R,
-	impl::enable_when_container<Iterable> * = nullptr>
-auto join(Self self, Iterable iterable) -> R
+private:
+	// Block of 64 rows of a column
+	struct Block
+	{
+		uint64_t vp;	// The rows that are one more than the row above
+		uint64_t vn;	// The rows that are one less than the row above
+		uint64_t d0;	// The rows that are the same as the previous row of the previous column
+		size_t score;	// The value of the last row
+	};
+
+	// Returns the number of rows in a block
+	auto rows(size_t b) const -> size_t
+		{return (b + 1 == count) ? last_bit + 1 : 64;}
+
+	// Returns the positions of a character in a block of the pattern
+	auto mask(uint32_t ch, size_t b) const -> uint64_t
+	{
+		if (ch < 256)
+			return table[ch * count + b];
+		auto found = std::lower_bound(keys.begin(), keys.end(), ch);
+		return (found != keys.end() && *found == ch) ? masks[(found - keys.begin()) * count + b] : 0;
+	}
+
+	// Fields
+	size_t size;
+	size_t count;
+	size_t last_bit;
+	bool transpositions;
+	bool global = true;
+	size_t limit = 0;
+	size_t column = 0;
+	size_t first = 0;
+	size_t last = 0;
+	uint32_t previous = 0xFFFFFFFF;
+
+	// Tables (a single block is stored inline)
+	uint64_t local_table[256];
+	Block local_block;
+	uint64_t * table = local_table;
+	Block * blocks = &local_block;
+	std::vector<uint64_t> heap_table;
+	std::vector<Block> heap_blocks;
+	std::vector<uint32_t> keys;
+	std::vector<uint64_t> masks;
+};
+
+// Returns the edit distance of two strings of characters (or max + 1, when it is greater than max)
+template<typename Unit>
+auto edit_distance(const Unit * a, size_t m, const Unit * b, size_t n, size_t max, bool transpositions) -> size_t
 {
-	// Calculate size
-	size_t size = 0;
-	bool first = true;
-	for (const auto & item : iterable)
+	// The shorter string is the pattern (the distance is symmetric)
+	if (m > n)
 	{
-		if (!first)
-			size += self.size();
-		first = false;
-		size += item.size();
+		std::swap(a, b);
+		std::swap(m, n);
+	}
+	max = std::min(max, n);
+	if (n - m > max)
+		return max + 1;
+	if (m == 0)
+		return n;
+
+	// The columns, until the last row can not be within the limit anymore
+	EditMatrix matrix(a, m, transpositions);
+	matrix.reset(true, max);
+	for (size_t j = 0; j < n; ++ j)
+	{
+		matrix.step(uint32_t(b[j]));
+		size_t score = matrix.score();
+		if (matrix.exhausted() || (score != EditMatrix::npos && score > max + (n - j - 1)))
+			return max + 1;
 	}
+	return std::min(matrix.score(), max + 1);
+}
 
-	// Allocate result
-	R result(size, 0);
-	auto * data = &result[0];
+// Returns the start of the approximate match of a pattern that ends first in a text (the match with the fewest edits
+// ending there, and the shortest one of those), and sets its length
+template<typename Unit>
+auto fuzzy_find(const Unit * text, size_t n, const Unit * pattern, size_t m, size_t k, size_t & length) -> size_t
+{
+	length = 0;
+	if (m <= k)
+		return 0;
 
-	// Copy items and separators
-	first = true;
-	for (const auto & item : iterable)
+	// The end: the first column with the last row within the limit
+	EditMatrix forward(pattern, m, false);
+	forward.reset(false, k);
+	size_t end = 0, best = EditMatrix::npos;
+	while (end < n && best > k)
 	{
-		// Copy separator
-		if (!first)
+		forward.step(uint32_t(text[end ++]));
+		best = forward.score();
+	}
+	if (best > k)
+		return size_t(-1);
+
+	// The start: the reversed pattern against the text before the end
+	std::vector<Unit> reversed(pattern, pattern + m);
+	std::reverse(reversed.begin(), reversed.end());
+	EditMatrix backward(reversed.data(), m, false);
+	backward.reset(true, best);
+	size_t found = best + 1;
+	for (size_t t = 1; t <= end && found > best; ++ t)
+	{
+		backward.step(uint32_t(text[end - t]));
+		if (backward.score() < found)
 		{
-			Traits::copy(data, self.data(), self.size());
-			data += self.size();
+			found = backward.score();
+			length = t;
 		}
-
-		// Copy item
-		first = false;
-		Traits::copy(data, item.data(), item.size());
-		data += item.size();
 	}
-
-	// Return the result
-	return result;
+	return end - length;
 }
 
-// Algorithm - join (iterable)
-template<typename Self, typename Traits, typename Iterable, typename R,
-	impl::enable_when_not_container<Iterable> * = nullptr>
-auto join(Self self, Iterable iterable) -> R
+// Returns true, if every unit of a string is a whole character (ASCII text in the variable length encodings)
+template<Encoding E, typename Char>
+auto plain_units(const Char * data, size_t size) -> bool
 {
-	// Allocate result
-	R result;
-
-	// Copy items and separators
-	bool first = true;
-	for (const auto & item : iterable)
+	if (sizeof(Char) == 1 && E == Encoding::UTF8)
+		return kernels::active().ascii_prefix(reinterpret_cast<const char *>(data), size) == size;
+	if (E == Encoding::UTF16 || E == Encoding::UTF32)
 	{
-		// Resize string
-		size_t end = result.size();
-		result.resize(end + (first ? item.size() : self.size() + item.size()));
-		auto * data = & result[end];
-
-		// Copy separator
-		if (!first)
-		{
-			Traits::copy(data, self.data(), self.size());
-			data += self.size();
-		}
-
-		// Copy item
-		first = false;
-		Traits::copy(data, item.data(), item.size());
+		for (size_t i = 0; i < size; ++ i)
+			if (!plain_unit<E>(typename std::make_unsigned<Char>::type(data[i])))
+				return false;
 	}
-
-	// Return the result
-	return result;
+	return true;
 }
 
-// Algorithm - split (whitespace)
-template<typename Self, typename Traits, Encoding E, typename R>
-auto split(Self self, size_t maxsplit) -> R
+// Decodes the characters of a string (the invalid units are characters too), and their offsets (with the size at the
+// end)
+template<Encoding E, typename Char>
+void decode_chars(const Char * data, size_t size, std::vector<uint32_t> & chars, std::vector<size_t> * offsets)
 {
-	// Create iterators
-	auto prev = self.data();
-	auto iter = encoding_traits<E>::iter(self.data());
-	auto done = encoding_traits<E>::iter(self.data() + self.size());
-
-	// Split string
-	R result;
-	while (maxsplit != 0 && iter != done)
+	auto iter = encoding_traits<E>::iter(data, data, data + size);
+	while (static_cast<const Char *>(iter) < data + size)
 	{
-		auto ptr = static_cast<const typename Traits::char_type *>(iter);
-		if (* ptr == ' ' || (* ptr >= 0x9 && * ptr <= 0xD))
-		{
-			result.emplace_back(prev, ptr);
-			while (* ptr == ' ' || (* ptr >= 0x9 && * ptr <= 0xD))
-				++ ptr;
-			iter = prev = ptr;
-			-- maxsplit;
-		}
-		else
-			++ iter;
+		if (offsets)
+			offsets->push_back(static_cast<const Char *>(iter) - data);
+		chars.push_back(uint32_t(*iter));
+		++ iter;
 	}
-	result.emplace_back(prev, self.data() + self.size());
-
-	// Return result
-	return result;
+	if (offsets)
+		offsets->push_back(size);
 }
 
-// Algorithm - split (separator)
-template<typename Self, typename Traits, Encoding E, typename T, typename R>
-auto split(Self self, T sep, size_t maxsplit) -> R
+// Returns the edit distance of two strings (the strings of whole units are compared without decoding)
+template<Encoding E, typename Char>
+auto edit_distance(const Char * a, size_t m, const Char * b, size_t n, size_t max, bool transpositions) -> size_t
 {
-	// Check separator
-	if (sep.size() == 0)
-		throw std::invalid_argument("split(): sep");
+	using Unit = typename std::make_unsigned<Char>::type;
+	if (plain_units<E>(a, m) && plain_units<E>(b, n))
+		return edit_distance(reinterpret_cast<const Unit *>(a), m, reinterpret_cast<const Unit *>(b), n, max, transpositions);
+
+	std::vector<uint32_t> x, y;
+	decode_chars<E>(a, m, x, nullptr);
+	decode_chars<E>(b, n, y, nullptr);
+	return edit_distance(x.data(), x.size(), y.data(), y.size(), max, transpositions);
+}
 
-	// Check length
-	if (self.size() < sep.size())
-		maxsplit = 0;
+// A set of characters, that does not fit into a charset (the codepoints are sorted)
+struct CodepointSet
+{
+	std::vector<int32_t> codepoints;
 
-	// Create iterators
-	auto prev = self.data();
-	auto iter = encoding_traits<E>::iter(self.data());
-	auto done = encoding_traits<E>::iter(self.data() + self.size() - sep.size() + 1);
+	// Returns true, if the codepoint is in the set
+	auto contains(int32_t cp) const -> bool
+		{return std::binary_search(codepoints.begin(), codepoints.end(), cp);}
+};
 
-	// Split string
-	R result;
-	while (maxsplit != 0 && iter != done)
-	{
-		auto ptr = static_cast<const typename Traits::char_type *>(iter);
-		if (Traits::compare(ptr, sep.data(), sep.size()) == 0)
-		{
-			result.emplace_back(prev, ptr);
-			iter = prev = ptr + sep.size();
-			-- maxsplit;
-		}
-		else
-			++ iter;
-	}
-	result.emplace_back(prev, self.data() + self.size());
+// The whitespace characters of an encoding
+template<Encoding E>
+constexpr charset<E> whitespace = charset<E>::space();
+
+// Returns the bytes, that may start a member (or a non-member) of a set, for the string kernels
+template<Encoding E, size_t N>
+auto set_bytes(const charset<E, N> & set, bool member) -> const kernels::ByteSet *
+	{return member ? &set.member_bytes() : &set.other_bytes();}
+inline auto set_bytes(const CodepointSet &, bool) -> const kernels::ByteSet *
+	{return nullptr;}
+
+// Returns the codepoint of a character for a set of characters (uninterpreted characters are unsigned)
+template<Encoding E, typename Char, typename Iter>
+auto set_codepoint(Iter iter) -> int32_t
+{
+	if (E == Encoding::Char8 || E == Encoding::Char16 || E == Encoding::Char32)
+		return int32_t(typename std::make_unsigned<Char>::type(*static_cast<const Char *>(iter)));
+	return *iter;
+}
 
-	// Return result
-	return result;
+// Returns the end of the character at a position
+template<Encoding E, typename Char>
+auto char_end(const Char * data, size_t size, size_t pos) -> size_t
+{
+	auto iter = encoding_traits<E>::iter(data + pos, data, data + size);
+	return static_cast<const Char *>(++ iter) - data;
 }
 
-// Algorithm - rsplit (whitespace)
-template<typename Self, typename Traits, Encoding E, typename R>
-auto rsplit(Self self, size_t maxsplit) -> R
+// Finds the first character at or after a position, that is (or is not) in a set. Byte strings are searched with the
+// string kernels, and only the UTF-8 sequences found by them are decoded.
+template<typename Traits, Encoding E, typename Set>
+auto set_find(const typename Traits::char_type * data, size_t size, size_t pos, const Set & set, bool member) -> size_t
 {
-	// Create iterators
-	auto prev = self.data() + self.size();
-	auto done = encoding_traits<E>::iter(self.data());
-	auto iter = encoding_traits<E>::iter(self.data() + self.size());
+	using Char = typename Traits::char_type;
+	if (pos >= size)
+		return size_t(-1);
 
-	// Split string
-	R result;
-	while (maxsplit != 0 && done != iter)
+	auto bytes = set_bytes(set, member);
+	if (bytes && sizeof(Char) == 1 && std::is_same<Traits, std::char_traits<Char>>::value &&
+		(E == Encoding::Char8 || E == Encoding::UTF8))
 	{
-		auto ptr = static_cast<const typename Traits::char_type *>(iter) - 1;
-		if (* ptr == ' ' || (* ptr >= 0x9 && * ptr <= 0xD))
+		auto & table = kernels::active();
+		while (pos < size)
 		{
-			result.emplace_back(ptr + 1, prev);
-			while (* ptr == ' ' || (* ptr >= 0x9 && * ptr <= 0xD))
-				-- ptr;
-			iter = ptr;
-			prev = ptr + 1;
-			-- maxsplit;
+			// The first byte is tested without the kernel (the runs of a tokenizer are short)
+			size_t found = bytes->contains(uint8_t(data[pos])) ? 0 : table.find_any(reinterpret_cast<const char *>(data + pos), size - pos, *bytes);
+			if (found == size_t(-1))
+				return size_t(-1);
+			pos += found;
+			if (E == Encoding::Char8 || uint8_t(data[pos]) < 0x80)
+				return pos;
+
+			// Decode the sequence
+			auto iter = encoding_traits<E>::iter(data + pos, data, data + size);
+			if (set.contains(*iter) == member)
+				return pos;
+			pos = static_cast<const Char *>(++ iter) - data;
 		}
-		else
-			-- iter;
+		return size_t(-1);
 	}
-	result.emplace_back(self.data(), prev);
 
-	// Reverse vector
-	using std::swap;
-	for (size_t i = 0, n = result.size(); i < (n / 2); ++ i)
-		swap(result[i], result[n - i - 1]);
+	// Other strings are decoded one character at a time
+	auto iter = encoding_traits<E>::iter(data + pos, data, data + size);
+	auto done = encoding_traits<E>::iter(data + size, data, data + size);
+	for (; iter != done; ++ iter)
+		if (set.contains(set_codepoint<E, Char>(iter)) == member)
+			return static_cast<const Char *>(iter) - data;
+	return size_t(-1);
+}
 
-	// Return result
-	return result;
+// Finds the last character before a position, that is (or is not) in a set
+template<typename Traits, Encoding E, typename Set>
+auto set_rfind(const typename Traits::char_type * data, size_t size, size_t end, const Set & set, bool member) -> size_t
+{
+	using Char = typename Traits::char_type;
+	auto iter = encoding_traits<E>::iter(data + std::min(end, size), data, data + size);
+	auto done = encoding_traits<E>::iter(data, data, data + size);
+	while (done != iter)
+		if (set.contains(set_codepoint<E, Char>(-- iter)) == member)
+			return static_cast<const Char *>(iter) - data;
+	return size_t(-1);
 }
 
-// Algorithm - rsplit (separator)
-template<typename Self, typename Traits, Encoding E, typename T, typename R,
-	impl::enable_when_reversible<E> * = nullptr>
-auto rsplit(Self self, T sep, size_t maxsplit) -> R
+// Calls a function with a set of characters: a charset, or the characters of a string (in a charset, when they fit)
+template<Encoding E, size_t N, typename Function>
+auto with_set(const charset<E, N> & set, Function function) -> decltype(function(set))
+	{return function(set);}
+template<Encoding E, typename Char, typename Traits, typename Function>
+auto with_set(better_string_view<Char, Traits> chars, Function function) -> decltype(function(charset<E>()))
 {
-	// Check separator
-	if (sep.size() == 0)
-		throw std::invalid_argument("rsplit(): sep");
+	charset<E> set;
+	if (set.insert(chars.data(), chars.size()))
+		return function(set);
+
+	CodepointSet list;
+	for (auto ptr = chars.data(), end = chars.data() + chars.size(); ptr < end;)
+		list.codepoints.push_back(charset_next<E>(ptr, end));
+	std::sort(list.codepoints.begin(), list.codepoints.end());
+	return function(list);
+}
 
-	// Check length
-	if (self.size() < sep.size())
-		maxsplit = 0;
+// Close namespace "impl"
+}
 
-	// Create iterators
-	auto prev = self.data() + self.size();
-	auto done = encoding_traits<E>::iter(self.data() + sep.size() - 1);
-	auto iter = encoding_traits<E>::iter(self.data() + self.size());
+// Namespace for URL character sets
+namespace url {
 
-	// Split string
-	R result;
-	while (maxsplit != 0 && done != iter)
-	{
-		auto ptr = static_cast<const typename Traits::char_type *>(iter) - sep.size();
-		if (Traits::compare(ptr, sep.data(), sep.size()) == 0)
-		{
-			result.emplace_back(ptr + sep.size(), prev);
-			iter = prev = ptr;
-			-- maxsplit;
-		}
-		else
-			-- iter;
-	}
-	result.emplace_back(self.data(), prev);
+/// The unreserved characters of RFC 3986 (letters, digits and `-._~`), which are never percent encoded.
+static constexpr auto unreserved = kernels::ByteSet::of([] (uint8_t ch)
+	{return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9') || ch == '-' || ch == '.' || ch == '_' || ch == '~';});
 
-	// Reverse vector
-	using std::swap;
-	for (size_t i = 0, n = result.size(); i < (n / 2); ++ i)
-		swap(result[i], result[n - i - 1]);
+/// The characters that are not encoded in URL paths (the unreserved characters and `/`, like Python's `quote()`).
+static constexpr auto path = kernels::ByteSet::of([] (uint8_t ch) {return unreserved.contains(ch) || ch == '/';});
 
-	// Return result
-	return result;
+// Close namespace "url"
 }
 
-// -------------------- Prefix and suffix --------------------
+// Namespace for string algorithms
+namespace algorithm { namespace string {
 
-// Algorithm - startswith
-template<typename Self, typename Traits, typename T>
-auto startswith(Self self, T prefix, size_t start, size_t end) -> bool
-{
-	// Update end
-	end = std::min(end, self.size());
+/**
+ * @name String algorithms
+ *
+ * These are the <i>raw</i> algorithm implementations, for string types. You are expected to use them by directly
+ * setting all the template parameters, with the correct constness and reference types. For example `Self` is usually
+ * set for `decltype(*this)`.
+ */
 
-	// Check length
-	if (end - start < prefix.size())
-		return false;
+/// @{
 
-	// Compare with substring
-	return Traits::compare(self.data() + start, prefix.data(), prefix.size()) == 0;
-}
+// -------------------- Alignment --------------------
 
-// Algorithm - endswith
-template<typename Self, typename Traits, typename T>
-auto endswith(Self self, T suffix, size_t start, size_t end) -> bool
+// Algorithm - center
+template<typename Self, typename Traits, Encoding E, typename T, typename R>
+auto center(Self self, size_t width, T fillchar) -> R
 {
-	// Update end
-	end = std::min(end, self.size());
+	BETTER_STRING_PROBE(Center, self);
 
-	// Check length
-	if (end - start < suffix.size())
-		return false;
+	// Check that fillchar is a character
+	if (fillchar.template length<E>() != 1)
+		throw std::invalid_argument("center(): fillchar");
 
-	// Compare with substring
-	return Traits::compare(self.data() + end - suffix.size(), suffix.data(), suffix.size()) == 0;
-}
+	// See if any padding is needed
+	if (width < self.template length<E>())
+	{
+		BETTER_STRING_OUTPUT(self);
+		return R(self.data(), self.size());
+	}
+	size_t diff = width - self.template length<E>();
 
-// Algorithm - removeprefix
-template<typename Self, typename Traits, typename T, typename R>
-auto removeprefix(Self self, T prefix) -> R
-{
-	if (startswith<Self, Traits, T>(self, prefix, 0, self.size()))
-		return R(self.data() + prefix.size(), self.size() - prefix.size());
-	else
-		return self;
-}
+	// Create result
+	R result(self.size() + fillchar.size() * diff, 0);
+	auto * data = &result[0];
 
-// Algorithm - removesuffix
-template<typename Self, typename Traits, typename T, typename R>
-auto removesuffix(Self self, T suffix) -> R
-{
-	if (endswith<Self, Traits, T>(self, suffix, 0, self.size()))
-		return R(self.data(), self.size() - suffix.size());
-	else
-		return self;
+	// Add padding (like Python, the odd padding character goes to the left when the width is odd)
+	size_t l = diff / 2 + (diff & width & 1);
+	size_t r = diff - l;
+	for (size_t i = 0; i < l; (++ i, data += fillchar.size()))
+		Traits::copy(data, fillchar.data(), fillchar.size());
+	Traits::copy(data, self.data(), self.size());
+	data += self.size();
+	for (size_t i = 0; i < r; (++ i, data += fillchar.size()))
+		Traits::copy(data, fillchar.data(), fillchar.size());
+
+	// Return result
+	BETTER_STRING_OUTPUT(result);
+	return result;
 }
 
-// Algorithm - strip
+// Algorithm - ljust
 template<typename Self, typename Traits, Encoding E, typename T, typename R>
-auto strip(Self self, T chars) -> R;
+auto ljust(Self self, size_t width, T fillchar) -> R
+{
+	BETTER_STRING_PROBE(Ljust, self);
 
-// Algorithm - lstrip
-template<typename Self, typename Traits, Encoding E, typename T, typename R>
-auto lstrip(Self self, T chars) -> R;
+	// Check that fillchar is a character
+	if (fillchar.template length<E>() != 1)
+		throw std::invalid_argument("ljust(): fillchar");
 
-// Algorithm - rstrip
-template<typename Self, typename Traits, Encoding E, typename T, typename R>
-auto rstrip(Self self, T chars) -> R;
+	// See if any padding is needed
+	if (width < self.template length<E>())
+	{
+		BETTER_STRING_OUTPUT(self);
+		return R(self.data(), self.size());
+	}
+	size_t diff = width - self.template length<E>();
 
-// -------------------- Transcoding --------------------
+	// Create result
+	R result(self.size() + fillchar.size() * diff, 0);
+	auto * data = &result[0];
 
-// Algorithm - transcode
-template<typename Input, typename, Encoding From, typename Output, typename, Encoding To,
-	impl::enable_when<From == To> * = nullptr>
-void transcode(Input input, Output output, impl::Errors)
-{
-	// Encodings match, copy the characters
-	output.resize(input.size());
-	for (size_t i = 0; i < input.size(); ++ i)
-		output[i] = input[i];
+	// Add padding
+	Traits::copy(data, self.data(), self.size());
+	data += self.size();
+	for (size_t i = 0; i < diff; (++ i, data += fillchar.size()))
+		Traits::copy(data, fillchar.data(), fillchar.size());
+
+	// Return result
+	BETTER_STRING_OUTPUT(result);
+	return result;
 }
 
-template<typename Input, typename, Encoding From, typename Output, typename, Encoding To,
-	impl::enable_when<From != To> * = nullptr>
-void transcode(Input input, Output output, impl::Errors mode)
+// Algorithm - rjust
+template<typename Self, typename Traits, Encoding E, typename T, typename R>
+auto rjust(Self self, size_t width, T fillchar) -> R
 {
-	// Iterators
-	auto iter = encoding_traits<From>::iter(input.data());
-	auto done = encoding_traits<From>::iter(input.data() + input.size());
+	BETTER_STRING_PROBE(Rjust, self);
 
-	if (mode == impl::Errors::Strict)
+	// Check that fillchar is a character
+	if (fillchar.template length<E>() != 1)
+		throw std::invalid_argument("rjust(): fillchar");
+
+	// See if any padding is needed
+	if (width < self.template length<E>())
 	{
-		// Throw errors as exceptions
-		for (; iter != done; ++ iter)
-		{
-			int32_t cp = *iter;
-			if (cp < 0)
-				throw std::invalid_argument("transcode(): input: Decoding error!");
-			else if (!encoding_traits<To>::append(input, cp))
-				throw std::invalid_argument("transcode(): input: Encoding error!");
-		}
+		BETTER_STRING_OUTPUT(self);
+		return R(self.data(), self.size());
 	}
-	else if (mode == impl::Errors::Replace)
+	size_t diff = width - self.template length<E>();
+
+	// Create result
+	R result(self.size() + fillchar.size() * diff, 0);
+	auto * data = &result[0];
+
+	// Add padding
+	for (size_t i = 0; i < diff; (++ i, data += fillchar.size()))
+		Traits::copy(data, fillchar.data(), fillchar.size());
+	Traits::copy(data, self.data(), self.size());
+
+	// Return result
+	BETTER_STRING_OUTPUT(result);
+	return result;
+}
+
+// Algorithm - zfill
+template<typename Self, typename Traits, Encoding E, typename R>
+auto zfill(Self self, size_t width) -> R
+{
+	BETTER_STRING_PROBE(Zfill, self);
+
+	// See if any padding is needed
+	if (width < self.template length<E>())
 	{
-		// Replace errors
-		for (; iter != done; ++ iter)
-		{
-			int32_t cp = *iter;
-			if (cp < 0 || !encoding_traits<To>::append(input, cp))
-				encoding_traits<To>::append(input, encoding_traits<To>::replacement);
-		}
+		BETTER_STRING_OUTPUT(self);
+		return R(self.data(), self.size());
 	}
-	else if (mode == impl::Errors::Ignore)
+	size_t diff = width - self.template length<E>();
+
+	// Create result
+	R result(self.size() + diff, 0);
+	auto * data = &result[0];
+
+	// Check first character
+	auto first = self.size() ? self.data()[0] : 0;
+	if (first == '+' || first == '-')
 	{
-		// Ignore errors
-		for (; iter != done; ++ iter)
-		{
-			int32_t cp = *iter;
-			if (cp > 0)
-				encoding_traits<To>::append(input, cp);
-		}
+		data[0] = first;
+		++ data;
+		for (size_t i = 0; i < diff; ++ i)
+			data[i] = '0';
+		Traits::copy(data + diff, self.data() + 1, self.size() - 1);
 	}
 	else
-		throw std::invalid_argument("transcode(): mode");
+	{
+		for (size_t i = 0; i < diff; ++ i)
+			data[i] = '0';
+		Traits::copy(data + diff, self.data(), self.size());
+	}
+
+	// Return result
+	BETTER_STRING_OUTPUT(result);
+	return result;
 }
 
-// -------------------- Formatting --------------------
+// -------------------- Search --------------------
 
-// Algorithm - format (implementation)
-template<typename Self, typename Traits, Encoding E, typename Input, typename Formatter, typename R>
-auto format1(Self self, Input * inputs, Formatter * fomatters, size_t count, size_t & position) -> R
+// Algorithm - find
+template<typename Self, typename Traits, Encoding E, typename T>
+auto find(Self self, T sub, size_t start, size_t end) -> size_t
 {
-	// Aliases
-	using Char = typename Traits::char_type;
+	BETTER_STRING_PROBE(Find, self);
 
-	// Functions
-	static constexpr auto is_digit = [] (char ch) -> bool
-		{return ch >= '0' && ch <= '9';};
-	static constexpr auto is_conv = [] (char ch) -> bool
-		{return ch == 'a' || ch == 'r' || ch == 's';};
-	static constexpr auto next = [] (const Char *iter) -> const Char *
-		{return static_cast<const Char *>(++ encoding_traits<E>::iter(iter));};
+	// Check the range
+	end = std::min(end, self.size());
+	if (start > end || end - start < sub.size())
+		return size_t(-1);
 
-	// Result string
-	R result;
+	// Search bytes with the string kernels
+	if (impl::byte_search<Traits, E>(sub.data(), sub.size()))
+		return impl::byte_find(self.data(), start, end, sub.data(), sub.size());
 
-	// Process format string
-	auto iter = self.data();
-	auto from = iter;
-	auto end  = iter + self.size();
-	while (iter < end)
-	{
-		if (*iter == '{')
-		{
-			// Copy string until this point
-			result.extend(from, iter);
+	// Create iterators
+	auto iter = encoding_traits<E>::iter(self.data() + start, self.data(), self.data() + self.size());
+	auto done = encoding_traits<E>::iter(self.data() + end - sub.size() + 1, self.data(), self.data() + self.size());
 
-			// Handle formatting
-			++ iter;
-			if (*iter == '{')
-			{
-				// Skip one '{'
-				from = iter;
-				++ iter;
-			}
-			else
-			{
-				// Process index
-				size_t index;
-				if (is_digit(*iter))
-				{
-					// Manual index
-					if (position == 0)
-						position = size_t(-1);
-					else if (position != size_t(-1))
-						throw std::invalid_argument("format(): format - Switching from automatic to manual indexing");
-					index = *iter - '0';
-					for (++ iter; iter < end && is_digit(*iter); ++ iter)
-						{index = index * 10 + (*iter) - '0';}
-				}
-				else
-				{
-					// Automatic index
-					if (position == size_t(-1))
-						throw std::invalid_argument("format(): format - Switching from manual to automatic indexing");
-					index = position ++;
-				}
+	// Find match
+	for (; iter != done; ++ iter)
+	{
+		auto ptr = static_cast<const typename Traits::char_type *>(iter);
+		if (Traits::compare(ptr, sub.data(), sub.size()) == 0)
+			return ptr - self.data();
+	}
 
-				// Check index
-				if (index >= count)
-					throw std::out_of_range("format(): Argument index out of range");
+	// Not found
+	return size_t(-1);
+}
 
-				// Process index operators
-				while (*iter == '[')
-				{
-					throw std::logic_error("Not implemented!");
-				}
+// Algorithm - rfind (reversible)
+template<typename Self, typename Traits, Encoding E, typename T,
+	impl::enable_when_reversible<E> * = nullptr>
+auto rfind(Self self, T sub, size_t start, size_t end) -> size_t
+{
+	BETTER_STRING_PROBE(Rfind, self);
 
-				// Process conversion
-				int32_t conv = 0;
-				if (*iter == '!')
-				{
-					++ iter;
-					if (is_conv(*iter))
-						conv = *iter;
-					else
-						throw std::invalid_argument("format(): format - Invalid conversion");
-				}
+	// Check the range
+	end = std::min(end, self.size());
+	if (start > end || end - start < sub.size())
+		return size_t(-1);
 
-				// Process format specification
-				better_string_view<Char> spec;
-				if (*iter == ':')
-				{
-					// Find the end
-					size_t level = 1;
-					auto start = ++ iter;
-					for (; iter < end; iter = next(iter))
-					{
-						if (*iter == '{')
-							++ level;
-						else if (*iter == '}' && (-- level == 0))
-							break;
-					}
+	// Create iterators
+	auto done = encoding_traits<E>::iter(self.data() + start + sub.size() - 1, self.data(), self.data() + self.size());
+	auto iter = encoding_traits<E>::iter(self.data() + end, self.data(), self.data() + self.size());
 
-					// Check for end
-					if (level > 0)
-						throw std::invalid_argument("format(): format - Unterminated format sequence");
+	// Find match
+	for (; done != iter; -- iter)
+	{
+		auto ptr = static_cast<const typename Traits::char_type *>(iter) - sub.size();
+		if (Traits::compare(ptr, sub.data(), sub.size()) == 0)
+			return ptr - self.data();
+	}
 
-					// TODO: Recursively apply formatting
-					spec = better_string_view<Char>(start, iter);
-				}
+	// Not found
+	return size_t(-1);
+}
 
-				// End of sequence
-				if (*iter != '}')
-					throw std::invalid_argument("format(): format - Unterminated format sequence");
+// Algorithm - index
+template<typename Self, typename Traits, Encoding E, typename T>
+auto index(Self self, T sub, size_t start, size_t end) -> size_t
+{
+	BETTER_STRING_PROBE(Index, self);
 
-				// Call formatter
-				fomatters[index](inputs[index], conv, spec, result);
+	// Check the range
+	end = std::min(end, self.size());
+	if (start > end || end - start < sub.size())
+		throw std::invalid_argument("index(): sub");
 
-				// Skip full sequence
-				++ iter;
-				from = iter;
-			}
-		}
-		else if (*iter == '}')
-		{
-			// Copy string until this point
-			result.extend(from, iter);
+	// Search bytes with the string kernels
+	if (impl::byte_search<Traits, E>(sub.data(), sub.size()))
+	{
+		size_t pos = impl::byte_find(self.data(), start, end, sub.data(), sub.size());
+		if (pos != size_t(-1))
+			return pos;
+		throw std::invalid_argument("index(): sub");
+	}
 
-			// Expect another '}'
-			++ iter;
-			if (*iter != '}')
-				throw std::invalid_argument("format(): format - Single '}' in format string");
+	// Create iterators
+	auto iter = encoding_traits<E>::iter(self.data() + start, self.data(), self.data() + self.size());
+	auto done = encoding_traits<E>::iter(self.data() + end - sub.size() + 1, self.data(), self.data() + self.size());
 
-			// Skip one '}'
-			from = iter;
-			++ iter;
-		}
-		else
-			iter = next(iter);
+	// Find match
+	for (; iter != done; ++ iter)
+	{
+		auto ptr = static_cast<const typename Traits::char_type *>(iter);
+		if (Traits::compare(ptr, sub.data(), sub.size()) == 0)
+			return ptr - self.data();
 	}
 
-	// Copy the rest of the string, and return
-	return result.extend(from, end);
+	// Not found
+	throw std::invalid_argument("index(): sub");
 }
 
-// Algorithm - format
-template<typename Self, typename Traits, Encoding E, typename R, typename... Types>
-auto format(Self self, Types... values) -> R
+// Algorithm - rindex (reversible)
+template<typename Self, typename Traits, Encoding E, typename T,
+	impl::enable_when_reversible<E> * = nullptr>
+auto rindex(Self self, T sub, size_t start, size_t end) -> size_t
 {
-	// Formatter type
-	using Char = typename Traits::char_type;
-	using Input = const void *;
-	using Formatter = void (*) (const void *, int32_t, better_string_view<Char>, better_string<Char> &);
-
-	// Value and formatter pointers for arguments
-	Input inputs[] = { static_cast<const void *>(& values) ... };
-	Formatter formatters[] = { & impl::formatter<E, Char, Types> ... };
+	BETTER_STRING_PROBE(Rindex, self);
 
-	// Call implementation
-	size_t index = 0;
-	return format1<Self, Traits, E, Input, Formatter, R>(self, inputs, formatters, sizeof...(Types), index);
-}
+	// Check the range
+	end = std::min(end, self.size());
+	if (start > end || end - start < sub.size())
+		throw std::invalid_argument("rindex(): sub");
 
-// Algorithm - truncate
-template<typename Self, typename Traits, Encoding E, typename R>
-auto truncate(Self self, size_t width) -> R
-{
-	// Iterators
-	auto size = 0;
-	auto iter = encoding_traits<E>::iter(self.data());
-	auto done = encoding_traits<E>::iter(self.data() + self.size());
+	// Create iterators
+	auto done = encoding_traits<E>::iter(self.data() + start + sub.size() - 1, self.data(), self.data() + self.size());
+	auto iter = encoding_traits<E>::iter(self.data() + end, self.data(), self.data() + self.size());
 
-	// Count codepoints
-	for (; iter != done; (++ iter, ++ size))
+	// Find match
+	for (; done != iter; -- iter)
 	{
-		if (size == width)
-			return R(self.data(), static_cast<const typename Traits::char_type *>(iter));
+		auto ptr = static_cast<const typename Traits::char_type *>(iter) - sub.size();
+		if (Traits::compare(ptr, sub.data(), sub.size()) == 0)
+			return ptr - self.data();
 	}
-	return self;
+
+	// Not found
+	throw std::invalid_argument("rindex(): sub");
 }
 
-// Algorithm - quote (repr/ascii - also does transcoding)
-template<typename Self, typename Traits, Encoding From, Encoding To, typename R, bool Ascii = false>
-auto quote(Self self) -> R
+// Algorithm - count
+template<typename Self, typename Traits, Encoding E, typename T>
+auto count(Self self, T sub, size_t start, size_t end) -> size_t
 {
-	// Create result
-	R result;
+	BETTER_STRING_PROBE(Count, self);
 
-	// Iterators
-	auto iter = encoding_traits<From>::iter(self.data());
-	auto done = encoding_traits<From>::iter(self.data() + self.size());
+	// Check the range
+	end = std::min(end, self.size());
+	if (start > end || end - start < sub.size())
+		return 0;
 
-	// Quote and escape string
-	result.push_back('"');
-	for (; iter != done; ++ iter)
+	// Count the empty string between every character (like Python)
+	if (sub.size() == 0)
+		return encoding_traits<E>::iter(self.data() + end) - encoding_traits<E>::iter(self.data() + start, self.data(), self.data() + end) + 1;
+
+	// Count single bytes directly with the string kernels
+	if (sub.size() == 1 && sizeof(typename Traits::char_type) == 1 && impl::byte_search<Traits, E>(sub.data(), sub.size()))
+		return (start < end) ? kernels::active().count_byte(reinterpret_cast<const char *>(self.data() + start), end - start, sub[0]) : 0;
+
+	// Count non-overlapping occurances
+	impl::SubstringScanner<Traits, E> scanner(self.data(), end, sub.data(), sub.size());
+	size_t result = 0;
+	for (size_t pos = scanner.next(start); pos != size_t(-1); pos = scanner.next(pos + sub.size()))
+		++ result;
+
+	// Return result
+	return result;
+}
+
+// Algorithm - find_all (the chunks of the text are searched by threads, for overlapping occurrences, which are filtered
+// afterwards for the non-overlapping ones)
+template<typename Self, typename Traits, Encoding E, typename T>
+auto find_all(Self self, T sub, bool overlapping, size_t threads) -> std::vector<size_t>
+{
+	BETTER_STRING_PROBE(FindAll, self);
+	using Char = typename Traits::char_type;
+	static constexpr size_t min_chunk = 1 << 18;
+
+	// The number of chunks (a single one for short texts)
+	const Char * data = self.data();
+	size_t size = self.size();
+	if (threads == 0 && size >= 2 * min_chunk)
+		threads = std::thread::hardware_concurrency();
+	size_t chunks = std::max<size_t>(std::min(threads, size / min_chunk), 1);
+
+	// Every chunk starts on a character boundary, and its occurrences may end in the next one
+	std::vector<std::vector<size_t>> found(chunks);
+	std::vector<size_t> bounds(chunks + 1, size);
+	for (size_t i = 0; i < chunks; ++ i)
+		bounds[i] = (i == 0) ? 0 : impl::char_boundary<E>(data, size, std::max(size / chunks * i, bounds[i - 1]));
+	auto search = [&] (size_t i) {
+		size_t limit = std::min(size, bounds[i + 1] + std::max<size_t>(sub.size(), 1) - 1);
+		impl::SubstringScanner<Traits, E> scanner(data, limit, sub.data(), sub.size());
+		for (size_t pos = scanner.next(bounds[i]); pos != size_t(-1) && pos < bounds[i + 1] + (i + 1 == chunks); pos = scanner.next(scanner.after(pos, chunks > 1 || overlapping)))
+			found[i].push_back(pos);
+	};
+	// When a thread can not be started, the calling thread searches the remaining chunks (and the started threads are
+	// joined before an exception leaves)
+	std::vector<std::thread> workers;
+	workers.reserve(chunks - 1);
+	size_t started = 1;
+	try
 	{
-		uint32_t ch = *iter;
-		switch (ch)
-		{
-			case '\'':
-			case '\"':
-			case '\\':
-				result.push_back('\\');
-				result.push_back(char(ch));
-				continue;
-			case '\0':
-				result.push_back('\\');
-				result.push_back('0');
-			case '\a':
-				result.push_back('\\');
-				result.push_back('a');
-				continue;
-			case '\b':
-				result.push_back('\\');
-				result.push_back('b');
-				continue;
-			case '\f':
-				result.push_back('\\');
-				result.push_back('f');
-				continue;
-			case '\n':
-				result.push_back('\\');
-				result.push_back('n');
-				continue;
-			case '\r':
-				result.push_back('\\');
-				result.push_back('r');
-				continue;
-			case '\t':
-				result.push_back('\\');
-				result.push_back('t');
-				continue;
-			case '\v':
-				result.push_back('\\');
-				result.push_back('v');
-				continue;
-		}
-		if (ch < 0x20 || (Ascii && ch >= 0x80))
-		{
-			const char * digits = "0123456789abcdef";
-			if (ch < 0x10000)
-			{
-				size_t n = result.size();
-				result.resize(n + 6);
-				result[n] = '\\';
-				result[n + 1] = 'u';
-				result[n + 2] = digits[(ch >> 12) & 0xF];
-				result[n + 3] = digits[(ch >> 8) & 0xF];
-				result[n + 4] = digits[(ch >> 4) & 0xF];
-				result[n + 5] = digits[ch & 0xF];
-			}
-			else if (ch < 0x110000)
+		for (; started < chunks; ++ started)
+			workers.emplace_back(search, started);
+	}
+	catch (const std::system_error &)
+	{
+	}
+	try
+	{
+		search(0);
+		for (size_t i = started; i < chunks; ++ i)
+			search(i);
+	}
+	catch (...)
+	{
+		for (auto & worker : workers)
+			worker.join();
+		throw;
+	}
+	for (auto & worker : workers)
+		worker.join();
+
+	// Join the chunks (and skip the occurrences, that overlap the previous one)
+	std::vector<size_t> result = std::move(found[0]);
+	for (size_t i = 1; i < chunks; ++ i)
+		result.insert(result.end(), found[i].begin(), found[i].end());
+	if (chunks > 1 && !overlapping && sub.size() > 0)
+	{
+		size_t count = 0, end = 0;
+		for (size_t pos : result)
+			if (count == 0 || pos >= end)
 			{
-				size_t n = result.size();
-				result.resize(n + 10);
-				result[n] = '\\';
-				result[n + 1] = 'U';
-				result[n + 2] = digits[(ch >> 28) & 0xF];
-				result[n + 3] = digits[(ch >> 24) & 0xF];
-				result[n + 4] = digits[(ch >> 20) & 0xF];
-				result[n + 5] = digits[(ch >> 16) & 0xF];
-				result[n + 6] = digits[(ch >> 12) & 0xF];
-				result[n + 7] = digits[(ch >> 8) & 0xF];
-				result[n + 8] = digits[(ch >> 4) & 0xF];
-				result[n + 9] = digits[ch & 0xF];
+				result[count ++] = pos;
+				end = pos + sub.size();
 			}
-			else if (Ascii)
-				result.push_back('?');
-			else
-				encoding_traits<To>::append(result, encoding_traits<To>::replacement);
-		}
-		else if (Ascii)
-			result.push_back(ch);
-		else if (!encoding_traits<To>::append(result, ch))
-		{
-			encoding_traits<To>::append(result, encoding_traits<To>::replacement);
-		}
+		result.resize(count);
 	}
-	result.push_back('"');
-
-	// Return result
 	return result;
 }
 
-/// @}
+// Algorithm - find_first_of (character set)
+template<typename Self, typename Traits, Encoding E, typename T>
+auto find_first_of(Self self, const T & set, size_t pos) -> size_t
+{
+	BETTER_STRING_PROBE(FindFirstOf, self);
+	return impl::set_find<Traits, E>(self.data(), self.size(), pos, set, true);
+}
 
-// Close namespace "ext::algorithm::string"
-}}
+// Algorithm - find_first_not_of (character set)
+template<typename Self, typename Traits, Encoding E, typename T>
+auto find_first_not_of(Self self, const T & set, size_t pos) -> size_t
+{
+	BETTER_STRING_PROBE(FindFirstNotOf, self);
+	return impl::set_find<Traits, E>(self.data(), self.size(), pos, set, false);
+}
 
-// Using basic_string from std
-template<typename C, typename T, typename A>
-using basic_string = std::basic_string<C, T, A>;
+// Algorithm - find_last_of (character set)
+template<typename Self, typename Traits, Encoding E, typename T>
+auto find_last_of(Self self, const T & set, size_t pos) -> size_t
+{
+	BETTER_STRING_PROBE(FindLastOf, self);
+	return impl::set_rfind<Traits, E>(self.data(), self.size(), pos < self.size() ? pos + 1 : self.size(), set, true);
+}
 
-// Using basic_string_view from std, when available
-#if __cplusplus >= 201703
-template<typename C, typename T>
-using basic_string_view = std::basic_string_view<C, T>
-#endif
+// Algorithm - find_last_not_of (character set)
+template<typename Self, typename Traits, Encoding E, typename T>
+auto find_last_not_of(Self self, const T & set, size_t pos) -> size_t
+{
+	BETTER_STRING_PROBE(FindLastNotOf, self);
+	return impl::set_rfind<Traits, E>(self.data(), self.size(), pos < self.size() ? pos + 1 : self.size(), set, false);
+}
 
-#if __cplusplus < 201703
+// Algorithm - span
+template<typename Self, typename Traits, Encoding E, typename T>
+auto span(Self self, const T & set, size_t pos) -> size_t
+{
+	BETTER_STRING_PROBE(Span, self);
+	if (pos >= self.size())
+		return 0;
+	return std::min(impl::set_find<Traits, E>(self.data(), self.size(), pos, set, false), self.size()) - pos;
+}
 
-/************************************************************
- * @brief String view - for C++14 and below
- *
- * String views are part of the standard library, starting from C++17. This
- * class is used for C++11 and C++14, as the base class of better_string_view.
- */
-template<typename Char, typename Traits = std::char_traits<Char>>
-class basic_string_view
+// Algorithm - cspan
+template<typename Self, typename Traits, Encoding E, typename T>
+auto cspan(Self self, const T & set, size_t pos) -> size_t
 {
-public:
-	// Aliases
-	using traits_type = Traits;
-	using value_type = Char;
-	using pointer = Char *;
-	using const_pointer = const Char *;
-	using reference = Char &;
-	using const_reference = const Char &;
-	using iterator = const Char *;
-	using const_iterator = const Char *;
-	using reverse_iterator = std::reverse_iterator<iterator>;
-	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
-	using size_type = size_t;
-	using difference_type = ptrdiff_t;
+	BETTER_STRING_PROBE(Cspan, self);
+	if (pos >= self.size())
+		return 0;
+	return std::min(impl::set_find<Traits, E>(self.data(), self.size(), pos, set, true), self.size()) - pos;
+}
 
-	// Constants
-	static constexpr size_type npos = size_type(-1);
+// Algorithm - levenshtein
+template<typename Self, typename Traits, Encoding E, typename T>
+auto levenshtein(Self self, T other, size_t max) -> size_t
+{
+	BETTER_STRING_PROBE(Levenshtein, self);
+	return impl::edit_distance<E>(self.data(), self.size(), other.data(), other.size(), max, false);
+}
 
-	// Constructors
-	constexpr basic_string_view() noexcept = default;
-	constexpr basic_string_view(const basic_string_view &) noexcept = default;
-	constexpr basic_string_view(const Char * str) noexcept
-		: _str(str), _len(Traits::length(str)) {}
-	constexpr basic_string_view(const Char * str, size_type len) noexcept
-		: _str(str), _len(len) {}
+// Algorithm - damerau
+template<typename Self, typename Traits, Encoding E, typename T>
+auto damerau(Self self, T other, size_t max) -> size_t
+{
+	BETTER_STRING_PROBE(Damerau, self);
+	return impl::edit_distance<E>(self.data(), self.size(), other.data(), other.size(), max, true);
+}
 
-	// Size
-	constexpr auto size() const noexcept -> size_type
-		{return _len;}
-	constexpr auto length() const noexcept -> size_type
-		{return _len;}
-	constexpr auto max_size() const noexcept -> size_type
-		{return (size_type) -1;}
-	constexpr bool empty() const noexcept
-		{return !_len;}
+// Algorithm - fuzzy_find
+template<typename Self, typename Traits, Encoding E, typename T>
+auto fuzzy_find(Self self, T pattern, size_t k, size_t & length) -> size_t
+{
+	BETTER_STRING_PROBE(FuzzyFind, self);
+	using Unit = typename std::make_unsigned<typename Traits::char_type>::type;
+
+	// Strings of whole units are searched without decoding
+	if (impl::plain_units<E>(self.data(), self.size()) && impl::plain_units<E>(pattern.data(), pattern.size()))
+		return impl::fuzzy_find(reinterpret_cast<const Unit *>(self.data()), self.size(),
+			reinterpret_cast<const Unit *>(pattern.data()), pattern.size(), k, length);
+
+	// Decode characters (and map the match back to the units)
+	std::vector<uint32_t> text, chars;
+	std::vector<size_t> offsets;
+	impl::decode_chars<E>(self.data(), self.size(), text, &offsets);
+	impl::decode_chars<E>(pattern.data(), pattern.size(), chars, nullptr);
+	size_t start = impl::fuzzy_find(text.data(), text.size(), chars.data(), chars.size(), k, length);
+	if (start == size_t(-1))
+		return start;
+	length = offsets[start + length] - offsets[start];
+	return offsets[start];
+}
 
-	// Data
-	constexpr auto data() const noexcept -> const Char *
-		{return _str;}
+// -------------------- Replace --------------------
 
-	// Copy
-	auto operator = (const basic_string_view &) noexcept -> basic_string_view & = default;
+// Algorithm - replace
+template<typename Self, typename Traits, Encoding E, typename T, typename U, typename R>
+auto replace(Self self, T old, U str, size_t count) -> R
+{
+	BETTER_STRING_PROBE(Replace, self);
 
-	// Getters
-	constexpr auto operator [] (size_type pos) const noexcept -> const Char &
-		{return _str[pos];}
-	constexpr auto at(size_type pos) const -> const Char &
-	{
-		if (pos < _len)
-			return _str[pos];
-		else
-			throw std::out_of_range("basic_string_view::at(): pos");
-	}
-	constexpr auto front() const -> const Char &
-		{return _str[0];}
-	constexpr auto back() const -> const Char &
-		{return _str[_len - 1];}
+	// Allocate result (once, when the result can not be longer than the input)
+	R result;
+	if (str.size() <= old.size())
+		result.reserve(self.size());
 
-	// Operations
-	void remove_prefix(size_type n)
-		{_str += n; _len -= n;}
-	void remove_suffix(size_type n)
-		{_len -= n;}
+	// Appends a part of the result
+	auto append = [&result] (const typename Traits::char_type * data, size_t size)
+	{
+		size_t end = result.size();
+		result.resize(end + size);
+		Traits::copy(&result[end], data, size);
+	};
 
-	// Iteration
-	constexpr auto begin() const noexcept -> iterator
-		{return _str;}
-	constexpr auto cbegin() const noexcept -> const_iterator
-		{return _str;}
-	constexpr auto end() const noexcept -> iterator
-		{return _str + _len;}
-	constexpr auto cend() const noexcept -> const_iterator
-		{return _str + _len;}
-	constexpr auto rbegin() const noexcept -> reverse_iterator
-		{ return reverse_iterator(_str + _len); }
-	constexpr auto crbegin() const noexcept -> const_reverse_iterator
-		{ return const_reverse_iterator(_str + _len); }
-	constexpr auto rend() const noexcept -> reverse_iterator
-		{ return reverse_iterator(_str); }
-	constexpr auto crend() const noexcept -> const_reverse_iterator
-		{ return const_reverse_iterator(_str); }
+	// Create iterators
+	auto prev = self.data();
+	auto iter = encoding_traits<E>::iter(self.data(), self.data(), self.data() + self.size());
 
-	// Comparison
-	constexpr int compare(basic_string_view str) const noexcept
+	// Build result
+	if (old.size() == 0)
 	{
-		auto r = Traits::compare(_str, str._str, std::min(_len, str._len));
-		return r != 0 ? r : (str._len < _len) - (_len < str._len);
+		// Insert the replacement before every character, and at the end (like Python)
+		while (count != 0)
+		{
+			append(str.data(), str.size());
+			-- count;
+			if (prev == self.data() + self.size())
+				break;
+			auto ptr = static_cast<const typename Traits::char_type *>(++ iter);
+			append(prev, ptr - prev);
+			prev = ptr;
+		}
+	}
+	else
+	{
+		// Copy before every occurrence, and the replacement
+		impl::SubstringScanner<Traits, E> scanner(self.data(), self.size(), old.data(), old.size());
+		for (size_t pos; count != 0 && (pos = scanner.next(prev - self.data())) != size_t(-1); -- count)
+		{
+			append(prev, self.data() + pos - prev);
+			append(str.data(), str.size());
+			prev = self.data() + pos + old.size();
+		}
 	}
-	constexpr int compare(const Char * str) const
-		{return compare(basic_string_view(str));}
-
-	// Substring
-	constexpr auto substr(size_type pos = 0, size_type len = npos) const -> basic_string_view
-		{return basic_string_view(_str + pos, _str + pos + std::min(_len - pos, len));}
-
-private:
-	const Char * _str = nullptr;
-	size_type    _len = 0;
-};
-
-// String view operators
-template<typename Char, typename Traits>
-bool operator == (basic_string_view<Char, Traits> left, basic_string_view<Char, Traits> right)
-	{return left.compare(right) == 0;}
-template<typename Char, typename Traits>
-bool operator != (basic_string_view<Char, Traits> left, basic_string_view<Char, Traits> right)
-	{return left.compare(right) != 0;}
-
-template<typename Char, typename Traits>
-bool operator < (basic_string_view<Char, Traits> left, basic_string_view<Char, Traits> right)
-	{return left.compare(right) < 0;}
-template<typename Char, typename Traits>
-bool operator > (basic_string_view<Char, Traits> left, basic_string_view<Char, Traits> right)
-	{return left.compare(right) > 0;}
-template<typename Char, typename Traits>
-bool operator <= (basic_string_view<Char, Traits> left, basic_string_view<Char, Traits> right)
-	{return left.compare(right) <= 0;}
-template<typename Char, typename Traits>
-bool operator >= (basic_string_view<Char, Traits> left, basic_string_view<Char, Traits> right)
-	{return left.compare(right) >= 0;}
 
-#endif
+	// Copy last part
+	append(prev, self.data() + self.size() - prev);
 
-//	------------------------------------------------------------
-//		Better string
-//	------------------------------------------------------------
+	// Return result
+	BETTER_STRING_OUTPUT(result);
+	return result;
+}
 
-/************************************************************
- * @brief Better string - a better std::string
- *
- * This class augments the standard string class, to make it more usable, by
- * adding much needed utility methods, and replacing existing ones.
- *
- * Where applicable, the methods now take character encoding into account. By
- * default, each string type uses a Unicode character encoding (UTF-8, UTF-16,
- * UTF-32), but you can specify the encoding used for the methods directly.
- */
-template<typename Char, typename Traits, typename Allocator>
-class better_string : public basic_string<Char, Traits, Allocator>
+// Algorithm - translate
+template<typename Self, typename Traits, Encoding E, typename Function, typename R>
+auto translate(Self self, Function table, impl::Errors mode) -> R
 {
-	// Private aliases
-	using base__ = basic_string<Char, Traits, Allocator>;
+	BETTER_STRING_PROBE(Translate, self);
 
-	// Default encoding
-	static constexpr Encoding default_encoding__ = default_encoding<Char>::value;
-
-public:
-	// Aliases
-	using errors = impl::Errors;
+	// Create result (most tables map characters to characters of the same size)
+	R result;
+	result.reserve(self.size());
 
-	// Constructors
-	using base__::basic_string;
-	constexpr better_string(const Char * ptr, const Char * end)
-		: base__(ptr, end - ptr) {}
+	// Iterators
+	auto iter = encoding_traits<E>::iter(self.data(), self.data(), self.data() + self.size());
+	auto done = encoding_traits<E>::iter(self.data() + self.size(), self.data(), self.data() + self.size());
+
+	// Translate characters
+	if (mode == impl::Errors::Strict)
+	{
+		// Throw errors as exceptions
+		for (;iter != done; ++ iter)
+		{
+			int32_t cp = *iter;
+			if (cp < 0)
+				throw std::invalid_argument("translate(): input: Decoding error!");
+			cp = table(cp);
+			if (cp != -1 && !encoding_traits<E>::append(result, cp))
+				throw std::invalid_argument("translate(): input: Encoding error!");
+		}
+	}
+	else if (mode == impl::Errors::Replace)
+	{
+		// Replace errors
+		for (;iter != done; ++ iter)
+		{
+			int32_t cp = *iter;
+			if (cp < 0)
+				cp = encoding_traits<E>::replacement;
+			cp = table(cp);
+			if (cp != -1 && !encoding_traits<E>::append(result, cp))
+				encoding_traits<E>::append(result, encoding_traits<E>::replacement);
+		}
+	}
+	else if (mode == impl::Errors::Ignore)
+	{
+		// Ignore errors
+		for (;iter != done; ++ iter)
+		{
+			int32_t cp = *iter;
+			if (cp < 0)
+				continue;
+			cp = table(cp);
+			if (cp != -1)
+				encoding_traits<E>::append(result, cp);
+		}
+	}
+	else
+		throw std::invalid_argument("translate(): mode");
+
+	// Return result
+	BETTER_STRING_OUTPUT(result);
+	return result;
+};
+
+// Algorithm - expandtabs
+template<typename Self, typename Traits, Encoding E, typename R>
+auto expandtabs(Self self, size_t tabsize) -> R
+{
+	BETTER_STRING_PROBE(Expandtabs, self);
+
+	// Result (with room for the longest expansion of every tab)
+	R result;
+	size_t tabs = size_t(std::count(self.data(), self.data() + self.size(), typename Traits::char_type('\t')));
+	result.reserve(self.size() + tabs * (tabsize ? tabsize - 1 : 0));
+
+	// Iterators
+	auto iter = encoding_traits<E>::iter(self.data(), self.data(), self.data() + self.size());
+	auto done = encoding_traits<E>::iter(self.data() + self.size(), self.data(), self.data() + self.size());
+
+	// Build result
+	size_t count = 0;
+	for (; iter != done; ++ iter)
+	{
+		int32_t cp = *iter;
+		if (cp == '\t')
+		{
+			for (; count < tabsize; ++ count)
+				result.push_back(' ');
+			count = 0;
+		}
+		else
+		{
+			encoding_traits<E>::append(result, cp);
+			++ count;
+			if (count == tabsize || cp == '\r' || cp == '\n')
+				count = 0;
+		}
+	}
+
+	// Return result
+	BETTER_STRING_OUTPUT(result);
+	return result;
+}
+
+// -------------------- Split and join --------------------
+
+// Algorithm - join (container)
+template<typename Self, typename Traits, typename Iterable, typename R,
+	impl::enable_when_container<Iterable> * = nullptr>
+auto join(Self self, Iterable iterable) -> R
+{
+	BETTER_STRING_PROBE(Join, self);
+
+	// Calculate size
+	size_t size = 0;
+	bool first = true;
+	for (const auto & item : iterable)
+	{
+		if (!first)
+			size += self.size();
+		first = false;
+		size += item.size();
+	}
+
+	// Allocate result
+	R result(size, 0);
+	auto * data = &result[0];
+
+	// Copy items and separators
+	first = true;
+	for (const auto & item : iterable)
+	{
+		// Copy separator
+		if (!first)
+		{
+			Traits::copy(data, self.data(), self.size());
+			data += self.size();
+		}
+
+		// Copy item
+		first = false;
+		Traits::copy(data, item.data(), item.size());
+		data += item.size();
+	}
+
+	// Return the result
+	BETTER_STRING_OUTPUT(result);
+	return result;
+}
+
+// Algorithm - join (iterable)
+template<typename Self, typename Traits, typename Iterable, typename R,
+	impl::enable_when_not_container<Iterable> * = nullptr>
+auto join(Self self, Iterable iterable) -> R
+{
+	BETTER_STRING_PROBE(Join, self);
+
+	// Allocate result
+	R result;
+
+	// Copy items and separators
+	bool first = true;
+	for (const auto & item : iterable)
+	{
+		// Resize string
+		size_t end = result.size();
+		result.resize(end + (first ? item.size() : self.size() + item.size()));
+		auto * data = & result[end];
+
+		// Copy separator
+		if (!first)
+		{
+			Traits::copy(data, self.data(), self.size());
+			data += self.size();
+		}
+
+		// Copy item
+		first = false;
+		Traits::copy(data, item.data(), item.size());
+	}
+
+	// Return the result
+	BETTER_STRING_OUTPUT(result);
+	return result;
+}
+
+// Algorithm - split (whitespace)
+template<typename Self, typename Traits, Encoding E, typename R>
+auto split(Self self, size_t maxsplit) -> R
+{
+	BETTER_STRING_PROBE(Split, self);
+
+	// Whitespace is ASCII, so it never appears inside of a multi unit sequence
+	using Char = typename Traits::char_type;
+	static constexpr auto is_space = [] (Char ch) -> bool
+		{return ch == ' ' || (ch >= 0x9 && ch <= 0xD);};
+
+	// Skip leading whitespace
+	auto ptr = self.data();
+	auto end = self.data() + self.size();
+	while (ptr < end && is_space(*ptr))
+		++ ptr;
+
+	// Split string (like Python, there are no empty parts)
+	R result;
+	while (ptr < end)
+	{
+		// The last part keeps its trailing whitespace
+		if (maxsplit == 0)
+		{
+			result.emplace_back(ptr, end);
+			break;
+		}
+
+		auto first = ptr;
+		while (ptr < end && !is_space(*ptr))
+			++ ptr;
+		result.emplace_back(first, ptr);
+		while (ptr < end && is_space(*ptr))
+			++ ptr;
+		-- maxsplit;
+	}
+
+	// Return result
+	BETTER_STRING_OUTPUT(result);
+	return result;
+}
+
+// Algorithm - split (separator)
+template<typename Self, typename Traits, Encoding E, typename T, typename R>
+auto split(Self self, T sep, size_t maxsplit) -> R
+{
+	BETTER_STRING_PROBE(Split, self);
+
+	// Check separator
+	if (sep.size() == 0)
+		throw std::invalid_argument("split(): sep");
+
+	// Split string
+	R result;
+	auto prev = self.data();
+	impl::SubstringScanner<Traits, E> scanner(self.data(), self.size(), sep.data(), sep.size());
+	for (size_t pos; maxsplit != 0 && (pos = scanner.next(prev - self.data())) != size_t(-1); -- maxsplit)
+	{
+		result.emplace_back(prev, self.data() + pos);
+		prev = self.data() + pos + sep.size();
+	}
+	result.emplace_back(prev, self.data() + self.size());
+
+	// Return result
+	BETTER_STRING_OUTPUT(result);
+	return result;
+}
+
+// Algorithm - split_any
+template<typename Self, typename Traits, Encoding E, typename T, typename R>
+auto split_any(Self self, T seps, size_t maxsplit) -> R
+{
+	BETTER_STRING_PROBE(SplitAny, self);
+
+	// Split string at every character of the set
+	auto data = self.data();
+	R result = impl::with_set<E>(seps, [&] (const auto & set) -> R {
+		R parts;
+		size_t prev = 0;
+		for (size_t pos; maxsplit != 0 && (pos = impl::set_find<Traits, E>(data, self.size(), prev, set, true)) != size_t(-1); -- maxsplit)
+		{
+			parts.emplace_back(data + prev, data + pos);
+			prev = impl::char_end<E>(data, self.size(), pos);
+		}
+		parts.emplace_back(data + prev, data + self.size());
+		return parts;
+	});
+
+	// Return result
+	BETTER_STRING_OUTPUT(result);
+	return result;
+}
+
+// Algorithm - rsplit (whitespace)
+template<typename Self, typename Traits, Encoding E, typename R>
+auto rsplit(Self self, size_t maxsplit) -> R
+{
+	BETTER_STRING_PROBE(Rsplit, self);
+
+	// Whitespace is ASCII, so it never appears inside of a multi unit sequence
+	using Char = typename Traits::char_type;
+	static constexpr auto is_space = [] (Char ch) -> bool
+		{return ch == ' ' || (ch >= 0x9 && ch <= 0xD);};
+
+	// Skip trailing whitespace
+	auto begin = self.data();
+	auto ptr = self.data() + self.size();
+	while (ptr > begin && is_space(ptr[-1]))
+		-- ptr;
+
+	// Split string (like Python, there are no empty parts)
+	R result;
+	while (ptr > begin)
+	{
+		// The first part keeps its leading whitespace
+		if (maxsplit == 0)
+		{
+			result.emplace_back(begin, ptr);
+			break;
+		}
+
+		auto last = ptr;
+		while (ptr > begin && !is_space(ptr[-1]))
+			-- ptr;
+		result.emplace_back(ptr, last);
+		while (ptr > begin && is_space(ptr[-1]))
+			-- ptr;
+		-- maxsplit;
+	}
+
+	// Reverse vector
+	using std::swap;
+	for (size_t i = 0, n = result.size(); i < (n / 2); ++ i)
+		swap(result[i], result[n - i - 1]);
+
+	// Return result
+	BETTER_STRING_OUTPUT(result);
+	return result;
+}
+
+// Algorithm - rsplit (separator)
+template<typename Self, typename Traits, Encoding E, typename T, typename R,
+	impl::enable_when_reversible<E> * = nullptr>
+auto rsplit(Self self, T sep, size_t maxsplit) -> R
+{
+	BETTER_STRING_PROBE(Rsplit, self);
+
+	// Check separator
+	if (sep.size() == 0)
+		throw std::invalid_argument("rsplit(): sep");
+
+	// Create iterators
+	auto prev = self.data() + self.size();
+	auto done = encoding_traits<E>::iter(self.data() + std::min(sep.size() - 1, self.size()), self.data(), self.data() + self.size());
+	auto iter = encoding_traits<E>::iter(self.data() + self.size(), self.data(), self.data() + self.size());
+
+	// Split string
+	R result;
+	while (maxsplit != 0 && impl::before<typename Traits::char_type>(done, iter))
+	{
+		auto ptr = static_cast<const typename Traits::char_type *>(iter) - sep.size();
+		if (Traits::compare(ptr, sep.data(), sep.size()) == 0)
+		{
+			result.emplace_back(ptr + sep.size(), prev);
+			prev = ptr;
+			iter = encoding_traits<E>::iter(prev, self.data(), self.data() + self.size());
+			-- maxsplit;
+		}
+		else
+			-- iter;
+	}
+	result.emplace_back(self.data(), prev);
+
+	// Reverse vector
+	using std::swap;
+	for (size_t i = 0, n = result.size(); i < (n / 2); ++ i)
+		swap(result[i], result[n - i - 1]);
+
+	// Return result
+	BETTER_STRING_OUTPUT(result);
+	return result;
+}
+
+// Algorithm - splitlines
+template<typename Self, typename Traits, Encoding E, typename R>
+auto splitlines(Self self, bool keepends) -> R
+{
+	BETTER_STRING_PROBE(Splitlines, self);
+
+	// Line boundaries (the same as in Python)
+	static constexpr auto is_break = [] (int32_t cp) -> bool
+		{return (cp >= 0xA && cp <= 0xD) || (cp >= 0x1C && cp <= 0x1E) || cp == 0x85 || cp == 0x2028 || cp == 0x2029;};
+
+	// Create iterators
+	auto prev = self.data();
+	auto iter = encoding_traits<E>::iter(self.data(), self.data(), self.data() + self.size());
+	auto done = encoding_traits<E>::iter(self.data() + self.size(), self.data(), self.data() + self.size());
+
+	// Split string
+	R result;
+	while (iter != done)
+	{
+		auto ptr = static_cast<const typename Traits::char_type *>(iter);
+		int32_t cp = *iter;
+		++ iter;
+		if (is_break(cp))
+		{
+			// A "\r\n" pair is one line boundary
+			auto next = static_cast<const typename Traits::char_type *>(iter);
+			if (cp == '\r' && next < self.data() + self.size() && *next == '\n')
+				next = static_cast<const typename Traits::char_type *>(++ iter);
+
+			result.emplace_back(prev, keepends ? next : ptr);
+			prev = next;
+		}
+	}
+	if (prev < self.data() + self.size())
+		result.emplace_back(prev, self.data() + self.size());
+
+	// Return result
+	BETTER_STRING_OUTPUT(result);
+	return result;
+}
+
+// Algorithm - partition
+template<typename Self, typename Traits, Encoding E, typename T, typename R>
+auto partition(Self self, T sep) -> R
+{
+	BETTER_STRING_PROBE(Partition, self);
+
+	// Check separator
+	if (sep.size() == 0)
+		throw std::invalid_argument("partition(): sep");
+
+	// Split at the first separator (or after the string)
+	size_t pos = find<Self, Traits, E, T>(self, sep, 0, self.size());
+	auto first = self.data() + ((pos == size_t(-1)) ? self.size() : pos);
+	auto last = (pos == size_t(-1)) ? first : first + sep.size();
+
+	R result;
+	result.reserve(3);
+	result.emplace_back(self.data(), first);
+	result.emplace_back(first, last);
+	result.emplace_back(last, self.data() + self.size());
+
+	// Return result
+	BETTER_STRING_OUTPUT(result);
+	return result;
+}
+
+// Algorithm - rpartition
+template<typename Self, typename Traits, Encoding E, typename T, typename R,
+	impl::enable_when_reversible<E> * = nullptr>
+auto rpartition(Self self, T sep) -> R
+{
+	BETTER_STRING_PROBE(Rpartition, self);
+
+	// Check separator
+	if (sep.size() == 0)
+		throw std::invalid_argument("rpartition(): sep");
+
+	// Split at the last separator (or before the string)
+	size_t pos = rfind<Self, Traits, E, T>(self, sep, 0, self.size());
+	auto first = self.data() + ((pos == size_t(-1)) ? 0 : pos);
+	auto last = (pos == size_t(-1)) ? first : first + sep.size();
+
+	R result;
+	result.reserve(3);
+	result.emplace_back(self.data(), first);
+	result.emplace_back(first, last);
+	result.emplace_back(last, self.data() + self.size());
+
+	// Return result
+	BETTER_STRING_OUTPUT(result);
+	return result;
+}
+
+// -------------------- Prefix and suffix --------------------
+
+// Algorithm - startswith
+template<typename Self, typename Traits, typename T>
+auto startswith(Self self, T prefix, size_t start, size_t end) -> bool
+{
+	BETTER_STRING_PROBE(Startswith, self);
+
+	// Update end
+	end = std::min(end, self.size());
+
+	// Check length
+	if (start > end || end - start < prefix.size())
+		return false;
+
+	// Compare with substring
+	return Traits::compare(self.data() + start, prefix.data(), prefix.size()) == 0;
+}
+
+// Algorithm - endswith
+template<typename Self, typename Traits, typename T>
+auto endswith(Self self, T suffix, size_t start, size_t end) -> bool
+{
+	BETTER_STRING_PROBE(Endswith, self);
+
+	// Update end
+	end = std::min(end, self.size());
+
+	// Check length
+	if (start > end || end - start < suffix.size())
+		return false;
+
+	// Compare with substring
+	return Traits::compare(self.data() + end - suffix.size(), suffix.data(), suffix.size()) == 0;
+}
+
+// Algorithm - removeprefix
+template<typename Self, typename Traits, typename T, typename R>
+auto removeprefix(Self self, T prefix) -> R
+{
+	BETTER_STRING_PROBE(Removeprefix, self);
+
+	// Skip the prefix, if present
+	size_t skip = startswith<Self, Traits, T>(self, prefix, 0, self.size()) ? prefix.size() : 0;
+	R result(self.data() + skip, self.size() - skip);
+
+	// Return result
+	BETTER_STRING_OUTPUT(result);
+	return result;
+}
+
+// Algorithm - removesuffix
+template<typename Self, typename Traits, typename T, typename R>
+auto removesuffix(Self self, T suffix) -> R
+{
+	BETTER_STRING_PROBE(Removesuffix, self);
+
+	// Skip the suffix, if present
+	size_t skip = endswith<Self, Traits, T>(self, suffix, 0, self.size()) ? suffix.size() : 0;
+	R result(self.data(), self.size() - skip);
+
+	// Return result
+	BETTER_STRING_OUTPUT(result);
+	return result;
+}
+
+// Algorithm - strip
+template<typename Self, typename Traits, Encoding E, typename T, typename R>
+auto strip(Self self, T chars) -> R
+{
+	BETTER_STRING_PROBE(Strip, self);
+
+	// Find the first and the last character, that is not in the set
+	auto data = self.data();
+	R result = impl::with_set<E>(chars, [&] (const auto & set) -> R {
+		size_t first = impl::set_find<Traits, E>(data, self.size(), 0, set, false);
+		if (first == size_t(-1))
+			return R(data, data);
+		size_t last = impl::set_rfind<Traits, E>(data, self.size(), self.size(), set, false);
+		return R(data + first, data + impl::char_end<E>(data, self.size(), last));
+	});
+
+	// Return result
+	BETTER_STRING_OUTPUT(result);
+	return result;
+}
+
+// Algorithm - lstrip
+template<typename Self, typename Traits, Encoding E, typename T, typename R>
+auto lstrip(Self self, T chars) -> R
+{
+	BETTER_STRING_PROBE(Lstrip, self);
+
+	// Find the first character, that is not in the set
+	auto data = self.data();
+	R result = impl::with_set<E>(chars, [&] (const auto & set) -> R {
+		size_t first = impl::set_find<Traits, E>(data, self.size(), 0, set, false);
+		return R(data + std::min(first, self.size()), data + self.size());
+	});
+
+	// Return result
+	BETTER_STRING_OUTPUT(result);
+	return result;
+}
+
+// Algorithm - rstrip
+template<typename Self, typename Traits, Encoding E, typename T, typename R>
+auto rstrip(Self self, T chars) -> R
+{
+	BETTER_STRING_PROBE(Rstrip, self);
+
+	// Find the last character, that is not in the set
+	auto data = self.data();
+	R result = impl::with_set<E>(chars, [&] (const auto & set) -> R {
+		size_t last = impl::set_rfind<Traits, E>(data, self.size(), self.size(), set, false);
+		return R(data, data + (last == size_t(-1) ? 0 : impl::char_end<E>(data, self.size(), last)));
+	});
+
+	// Return result
+	BETTER_STRING_OUTPUT(result);
+	return result;
+}
+
+// -------------------- Character --------------------
+
+// Algorithm - isascii
+template<typename Self, typename Traits, Encoding E>
+auto isascii(Self self) -> bool
+{
+	BETTER_STRING_PROBE(Isascii, self);
+
+	// Check bytes with the string kernels
+	if (sizeof(typename Traits::char_type) == 1)
+		return kernels::active().ascii_prefix(reinterpret_cast<const char *>(self.data()), self.size()) == self.size();
+
+	// Check characters
+	for (size_t i = 0; i < self.size(); ++ i)
+		if (uint32_t(self.data()[i]) >= 0x80)
+			return false;
+	return true;
+}
+
+// -------------------- Character case --------------------
+
+// Algorithm - upper (only ASCII letters are mapped, because the Unicode character database is not available)
+template<typename Self, typename Traits, Encoding E, typename R>
+auto upper(Self self) -> R
+{
+	BETTER_STRING_PROBE(Upper, self);
+
+	// Create result
+	R result(self.size(), 0);
+	auto * data = &result[0];
+
+	// Map letters
+	if (sizeof(typename Traits::char_type) == 1)
+		kernels::active().upper(reinterpret_cast<const char *>(self.data()), self.size(), reinterpret_cast<char *>(data));
+	else
+		for (size_t i = 0; i < self.size(); ++ i)
+			data[i] = (self.data()[i] >= 'a' && self.data()[i] <= 'z') ? self.data()[i] - 0x20 : self.data()[i];
+
+	// Return result
+	BETTER_STRING_OUTPUT(result);
+	return result;
+}
+
+// Algorithm - lower (only ASCII letters are mapped, because the Unicode character database is not available)
+template<typename Self, typename Traits, Encoding E, typename R>
+auto lower(Self self) -> R
+{
+	BETTER_STRING_PROBE(Lower, self);
+
+	// Create result
+	R result(self.size(), 0);
+	auto * data = &result[0];
+
+	// Map letters
+	if (sizeof(typename Traits::char_type) == 1)
+		kernels::active().lower(reinterpret_cast<const char *>(self.data()), self.size(), reinterpret_cast<char *>(data));
+	else
+		for (size_t i = 0; i < self.size(); ++ i)
+			data[i] = (self.data()[i] >= 'A' && self.data()[i] <= 'Z') ? self.data()[i] + 0x20 : self.data()[i];
+
+	// Return result
+	BETTER_STRING_OUTPUT(result);
+	return result;
+}
+
+// -------------------- Transcoding --------------------
+
+// Algorithm - transcode
+template<typename Input, typename, Encoding From, typename Output, typename, Encoding To,
+	impl::enable_when<From == To> * = nullptr>
+void transcode(Input input, Output output, impl::Errors)
+{
+	BETTER_STRING_PROBE(Transcode, input);
+
+	// Encodings match, copy the characters
+	output.resize(input.size());
+	for (size_t i = 0; i < input.size(); ++ i)
+		output[i] = input[i];
+	BETTER_STRING_OUTPUT(output);
+}
+
+template<typename Input, typename, Encoding From, typename Output, typename, Encoding To,
+	impl::enable_when<From != To> * = nullptr>
+void transcode(Input input, Output output, impl::Errors mode)
+{
+	BETTER_STRING_PROBE(Transcode, input);
+
+	// Iterators
+	auto iter = encoding_traits<From>::iter(input.data(), input.data(), input.data() + input.size());
+	auto done = encoding_traits<From>::iter(input.data() + input.size(), input.data(), input.data() + input.size());
+	auto end = input.data() + input.size();
+
+	// Copy runs of ASCII characters with the string kernels (where possible)
+	auto ascii = [&] ()
+		{iter = encoding_traits<From>::iter(impl::copy_ascii<From, To>(static_cast<decltype(end)>(iter), end, output), input.data(), end);};
+
+	if (mode == impl::Errors::Strict)
+	{
+		// Throw errors as exceptions
+		for (ascii(); iter != done; (++ iter, ascii()))
+		{
+			int32_t cp = *iter;
+			if (cp < 0)
+				throw std::invalid_argument("transcode(): input: Decoding error!");
+			else if (!encoding_traits<To>::append(output, cp))
+				throw std::invalid_argument("transcode(): input: Encoding error!");
+		}
+	}
+	else if (mode == impl::Errors::Replace)
+	{
+		// Replace errors
+		for (ascii(); iter != done; (++ iter, ascii()))
+		{
+			int32_t cp = *iter;
+			if (cp < 0 || !encoding_traits<To>::append(output, cp))
+				encoding_traits<To>::append(output, encoding_traits<To>::replacement);
+		}
+	}
+	else if (mode == impl::Errors::Ignore)
+	{
+		// Ignore errors
+		for (ascii(); iter != done; (++ iter, ascii()))
+		{
+			int32_t cp = *iter;
+			if (cp >= 0)
+				encoding_traits<To>::append(output, cp);
+		}
+	}
+	else
+		throw std::invalid_argument("transcode(): mode");
+	BETTER_STRING_OUTPUT(output);
+}
+
+// -------------------- Formatting --------------------
+
+// Algorithm - format (implementation)
+template<typename Self, typename Traits, Encoding E, typename Input, typename Formatter, typename R>
+auto format1(Self self, Input * inputs, Formatter * fomatters, size_t count, size_t & position) -> R
+{
+	// Aliases
+	using Char = typename Traits::char_type;
+
+	// Functions
+	static constexpr auto is_digit = [] (char ch) -> bool
+		{return ch >= '0' && ch <= '9';};
+	static constexpr auto is_conv = [] (char ch) -> bool
+		{return ch == 'a' || ch == 'r' || ch == 's';};
+	static constexpr auto next = [] (const Char * iter, const Char * end) -> const Char *
+		{return static_cast<const Char *>(++ encoding_traits<E>::iter(iter, iter, end));};
+
+	// Result string
+	R result;
+
+	// Process format string
+	auto iter = self.data();
+	auto from = iter;
+	auto end  = iter + self.size();
+
+	// Character at the current position (zero at the end, the format string does not have to be terminated)
+	auto peek = [&] () -> Char
+		{return iter < end ? *iter : Char(0);};
+
+	while (iter < end)
+	{
+		if (*iter == '{')
+		{
+			// Copy string until this point
+			result.extend(from, iter);
+
+			// Handle formatting
+			++ iter;
+			if (peek() == '{')
+			{
+				// Skip one '{'
+				from = iter;
+				++ iter;
+			}
+			else
+			{
+				// Process index
+				size_t index;
+				if (is_digit(peek()))
+				{
+					// Manual index
+					if (position == 0)
+						position = size_t(-1);
+					else if (position != size_t(-1))
+						throw std::invalid_argument("format(): format - Switching from automatic to manual indexing");
+					index = *iter - '0';
+					for (++ iter; iter < end && is_digit(*iter); ++ iter)
+						{index = index * 10 + (*iter) - '0';}
+				}
+				else
+				{
+					// Automatic index
+					if (position == size_t(-1))
+						throw std::invalid_argument("format(): format - Switching from manual to automatic indexing");
+					index = position ++;
+				}
+
+				// Check index
+				if (index >= count)
+					throw std::out_of_range("format(): Argument index out of range");
+
+				// Process index operators
+				while (peek() == '[')
+				{
+					throw std::logic_error("Not implemented!");
+				}
+
+				// Process conversion
+				int32_t conv = 0;
+				if (peek() == '!')
+				{
+					++ iter;
+					if (is_conv(peek()))
+						conv = *iter ++;
+					else
+						throw std::invalid_argument("format(): format - Invalid conversion");
+				}
+
+				// Process format specification
+				better_string_view<Char> spec;
+				if (peek() == ':')
+				{
+					// Find the end
+					size_t level = 1;
+					auto start = ++ iter;
+					for (; iter < end; iter = next(iter, end))
+					{
+						if (*iter == '{')
+							++ level;
+						else if (*iter == '}' && (-- level == 0))
+							break;
+					}
+
+					// Check for end
+					if (level > 0)
+						throw std::invalid_argument("format(): format - Unterminated format sequence");
+
+					// TODO: Recursively apply formatting
+					spec = better_string_view<Char>(start, iter);
+				}
+
+				// End of sequence
+				if (peek() != '}')
+					throw std::invalid_argument("format(): format - Unterminated format sequence");
+
+				// Call formatter
+				fomatters[index](inputs[index], conv, spec, result);
+
+				// Skip full sequence
+				++ iter;
+				from = iter;
+			}
+		}
+		else if (*iter == '}')
+		{
+			// Copy string until this point
+			result.extend(from, iter);
+
+			// Expect another '}'
+			++ iter;
+			if (peek() != '}')
+				throw std::invalid_argument("format(): format - Single '}' in format string");
+
+			// Skip one '}'
+			from = iter;
+			++ iter;
+		}
+		else
+			iter = next(iter, end);
+	}
+
+	// Copy the rest of the string, and return (without copying the result)
+	result.extend(from, end);
+	return result;
+}
+
+// Algorithm - format
+template<typename Self, typename Traits, Encoding E, typename R, typename... Types>
+auto format(Self self, Types... values) -> R
+{
+	BETTER_STRING_PROBE(Format, self);
+
+	// Formatter type
+	using Char = typename Traits::char_type;
+	using Input = const void *;
+	using Formatter = void (*) (const void *, int32_t, better_string_view<Char>, better_string<Char> &);
+
+	// Value and formatter pointers for arguments
+	Input inputs[] = { static_cast<const void *>(& values) ... };
+	Formatter formatters[] = { & impl::formatter<E, Char, Types> ... };
+
+	// Call implementation
+	size_t index = 0;
+	R result = format1<Self, Traits, E, Input, Formatter, R>(self, inputs, formatters, sizeof...(Types), index);
+
+	// Return result
+	BETTER_STRING_OUTPUT(result);
+	return result;
+}
+
+// Algorithm - truncate
+template<typename Self, typename Traits, Encoding E, typename R>
+auto truncate(Self self, size_t width) -> R
+{
+	BETTER_STRING_PROBE(Truncate, self);
+
+	// Skip the characters that are one codepoint each, without decoding them
+	size_t size = impl::fixed_prefix<E>(self.data(), std::min(self.size(), width));
+
+	// Iterators
+	auto iter = encoding_traits<E>::iter(self.data() + size, self.data(), self.data() + self.size());
+	auto done = encoding_traits<E>::iter(self.data() + self.size(), self.data(), self.data() + self.size());
+
+	// Count codepoints
+	for (; iter != done; (++ iter, ++ size))
+	{
+		if (size == width)
+			break;
+	}
+	R result(self.data(), static_cast<const typename Traits::char_type *>(iter));
+
+	// Return result
+	BETTER_STRING_OUTPUT(result);
+	return result;
+}
+
+// Algorithm - quote (repr/ascii - also does transcoding)
+template<typename Self, typename Traits, Encoding From, Encoding To, typename R, bool Ascii = false>
+auto quote(Self self) -> R
+{
+	BETTER_STRING_PROBE(Quote, self);
+	using Char = typename Traits::char_type;
+	const Char * begin = self.data();
+	const Char * end = self.data() + self.size();
+
+	// Create result (with room for the escape sequences)
+	R result;
+	result.reserve(impl::quote_size<From, To, Ascii>(begin, self.size()));
+
+	// Quote and escape string
+	result.push_back('"');
+	for (const Char * ptr = begin; ptr < end;)
+	{
+		// Copy the characters that are not escaped at once
+		bool verbatim;
+		const Char * stop = impl::quote_run<From, To, Ascii, Char, R>(ptr, end, verbatim);
+		if (verbatim && stop != ptr)
+		{
+			size_t size = result.size();
+			result.resize(size + (stop - ptr));
+			std::copy(ptr, stop, &result[size]);
+			ptr = stop;
+			continue;
+		}
+
+		// Escape the next character (or decode the run, when it is not valid)
+		auto iter = encoding_traits<From>::iter(ptr, begin, end);
+		do
+			impl::quote_char<To, Ascii>(*iter, result);
+		while (static_cast<const Char *>(++ iter) < stop);
+		ptr = static_cast<const Char *>(iter);
+	}
+	result.push_back('"');
+
+	// Return result
+	BETTER_STRING_OUTPUT(result);
+	return result;
+}
+
+// Algorithm - unescape (the escape sequences of quote, without the quotes, appended to the result)
+template<typename Self, typename Traits, Encoding E, typename R>
+void unescape(Self self, R & result, impl::Errors mode)
+{
+	using Char = typename Traits::char_type;
+	const Char * data = self.data();
+	size_t size = self.size();
+
+	// Handle invalid escape sequences
+	auto error = [&] ()
+	{
+		if (mode == impl::Errors::Strict)
+			throw std::invalid_argument("unescape(): input: Invalid escape sequence!");
+		if (mode == impl::Errors::Replace)
+			encoding_traits<E>::append(result, encoding_traits<E>::replacement);
+	};
+
+	// The result is never longer than the input (except for replaced errors)
+	result.reserve(result.size() + size);
+	for (size_t i = 0; i < size;)
+	{
+		// Copy the text before the next backslash at once (found with the string kernels)
+		size_t pos = impl::find_ascii(data, i, size, '\\');
+		if (pos == size_t(-1))
+			pos = size;
+		size_t offset = result.size();
+		result.resize(offset + (pos - i));
+		std::copy(data + i, data + pos, &result[offset]);
+		if (pos == size)
+			break;
+
+		// Decode the escape sequence
+		i = pos + 1;
+		if (i == size)
+		{
+			error();
+			break;
+		}
+		uint32_t cp = 0;
+		size_t digits = 0;
+		switch (typename std::make_unsigned<Char>::type(data[i ++]))
+		{
+			case '\'': cp = '\''; break;
+			case '\"': cp = '\"'; break;
+			case '\\': cp = '\\'; break;
+			case '0': cp = '\0'; break;
+			case 'a': cp = '\a'; break;
+			case 'b': cp = '\b'; break;
+			case 'f': cp = '\f'; break;
+			case 'n': cp = '\n'; break;
+			case 'r': cp = '\r'; break;
+			case 't': cp = '\t'; break;
+			case 'v': cp = '\v'; break;
+			case 'x': digits = 2; break;
+			case 'u': digits = 4; break;
+			case 'U': digits = 8; break;
+			default:
+				error();
+				continue;
+		}
+
+		// Parse the hexadecimal digits
+		size_t count = 0;
+		for (; count < digits && i + count < size; ++ count)
+		{
+			uint32_t ch = typename std::make_unsigned<Char>::type(data[i + count]);
+			uint32_t digit = (ch >= '0' && ch <= '9') ? ch - '0' : ((ch | 0x20) >= 'a' && (ch | 0x20) <= 'f') ? (ch | 0x20) - 'a' + 10 : 16;
+			if (digit == 16)
+				break;
+			cp = (cp << 4) | digit;
+		}
+		i += count;
+		if (count < digits || !encoding_traits<E>::append(result, cp))
+			error();
+	}
+}
+
+// Algorithm - unquote (inverse of quote, the text between the quotes is returned without a copy when it has no escape
+// sequences, otherwise it is decoded into the buffer)
+template<typename Self, typename Traits, Encoding E, typename R>
+auto unquote(Self self, R & buffer, impl::Errors mode) -> better_string_view<typename Traits::char_type, Traits>
+{
+	BETTER_STRING_PROBE(Unquote, self);
+	using Char = typename Traits::char_type;
+
+	// Check the quotes
+	size_t size = self.size();
+	if (size < 2 || self[0] != self[size - 1] || (self[0] != Char('"') && self[0] != Char('\'')))
+		throw std::invalid_argument("unquote(): str");
+	better_string_view<Char, Traits> text(self.data() + 1, size - 2);
+
+	// Decode the escape sequences
+	if (impl::find_ascii(text.data(), 0, text.size(), '\\') == size_t(-1))
+		return text;
+	buffer.clear();
+	unescape<better_string_view<Char, Traits>, Traits, E, R>(text, buffer, mode);
+
+	// Return result
+	BETTER_STRING_OUTPUT(buffer);
+	return better_string_view<Char, Traits>(buffer.data(), buffer.size());
+}
+
+// -------------------- JSON --------------------
+
+// Algorithm - json_escape (appends the escaped text to the result; returns the number of characters used, which is less
+// than the size of the text, when it is not the final chunk of a stream, and ends with an incomplete sequence)
+template<typename Self, typename Traits, Encoding E, typename R>
+auto json_escape(Self self, R & result, impl::Errors mode, bool ascii, bool final = true) -> size_t
+{
+	BETTER_STRING_PROBE(JsonEscape, self);
+	using Char = typename Traits::char_type;
+	const Char * begin = self.data();
+	const Char * end = begin + (final ? self.size() : impl::complete_size<E>(self.data(), self.size()));
+
+	// Escape sequences (the short ones where JSON has them, and lowercase hexadecimal digits)
+	auto unicode = [&] (uint32_t unit)
+	{
+		const char * digits = "0123456789abcdef";
+		size_t n = result.size();
+		result.resize(n + 6);
+		result[n] = '\\';
+		result[n + 1] = 'u';
+		result[n + 2] = digits[(unit >> 12) & 0xF];
+		result[n + 3] = digits[(unit >> 8) & 0xF];
+		result[n + 4] = digits[(unit >> 4) & 0xF];
+		result[n + 5] = digits[unit & 0xF];
+	};
+	auto escape = [&] (uint32_t ch)
+	{
+		char code = (ch == '"') ? '"' : (ch == '\\') ? '\\' : (ch == '\b') ? 'b' : (ch == '\f') ? 'f' :
+			(ch == '\n') ? 'n' : (ch == '\r') ? 'r' : (ch == '\t') ? 't' : 0;
+		if (code)
+		{
+			result.push_back('\\');
+			result.push_back(code);
+		}
+		else if (ch < 0x20 || (ascii && ch >= 0x80 && ch < 0x10000))
+			unicode(ch);
+		else if (ascii && ch >= 0x10000)
+		{
+			unicode(0xD800 + ((ch - 0x10000) >> 10));
+			unicode(0xDC00 + ((ch - 0x10000) & 0x3FF));
+		}
+		else
+			encoding_traits<E>::append(result, ch);
+	};
+
+	// Escape string
+	result.reserve(result.size() + (end - begin));
+	for (const Char * ptr = begin; ptr < end;)
+	{
+		// Copy the characters that are not escaped at once
+		bool verbatim;
+		const Char * stop = impl::json_run<E>(ptr, end, ascii, verbatim);
+		if (verbatim && stop != ptr)
+		{
+			size_t size = result.size();
+			result.resize(size + (stop - ptr));
+			std::copy(ptr, stop, &result[size]);
+			ptr = stop;
+			continue;
+		}
+
+		// Escape the next character (or decode the run, when it is not valid)
+		auto iter = encoding_traits<E>::iter(ptr, begin, end);
+		do
+		{
+			int32_t cp = *iter;
+			if (cp >= 0)
+				escape(cp);
+			else if (mode == impl::Errors::Strict)
+				throw std::invalid_argument("json_escape(): input: Decoding error!");
+			else if (mode == impl::Errors::Replace)
+				escape(encoding_traits<E>::replacement);
+		}
+		while (static_cast<const Char *>(++ iter) < stop);
+		ptr = static_cast<const Char *>(iter);
+	}
+
+	// Return result
+	BETTER_STRING_OUTPUT(result);
+	return end - begin;
+}
+
+// Algorithm - json_unescape (appends the unescaped text to the result; returns the number of characters used, which is
+// less than the size of the text, when it is not the final chunk of a stream, and ends with an incomplete sequence)
+template<typename Self, typename Traits, Encoding E, typename R>
+auto json_unescape(Self self, R & result, impl::Errors mode, bool final = true) -> size_t
+{
+	BETTER_STRING_PROBE(JsonUnescape, self);
+	using Char = typename Traits::char_type;
+	using Unit = typename std::make_unsigned<Char>::type;
+	const Char * data = self.data();
+	size_t size = final ? self.size() : impl::complete_size<E>(self.data(), self.size());
+
+	// Handle errors
+	auto error = [&] (const char * message)
+	{
+		if (mode == impl::Errors::Strict)
+			throw std::invalid_argument(message);
+		if (mode == impl::Errors::Replace)
+			encoding_traits<E>::append(result, encoding_traits<E>::replacement);
+	};
+
+	// Parse four hexadecimal digits (or return -1)
+	auto hex = [&] (size_t pos) -> int32_t
+	{
+		int32_t value = 0;
+		for (size_t i = pos; i < pos + 4; ++ i)
+		{
+			uint32_t ch = Unit(data[i]);
+			uint32_t digit = (ch >= '0' && ch <= '9') ? ch - '0' : ((ch | 0x20) >= 'a' && (ch | 0x20) <= 'f') ? (ch | 0x20) - 'a' + 10 : 16;
+			if (digit == 16)
+				return -1;
+			value = (value << 4) | int32_t(digit);
+		}
+		return value;
+	};
+
+	// Parse an escape sequence (returns the codepoint, -1 for invalid sequences, and -2 for incomplete ones)
+	auto parse = [&] (size_t pos, size_t & length) -> int32_t
+	{
+		length = 2;
+		if (pos + 2 > size)
+			return -2;
+		switch (Unit(data[pos + 1]))
+		{
+			case '"': return '"';
+			case '\\': return '\\';
+			case '/': return '/';
+			case 'b': return '\b';
+			case 'f': return '\f';
+			case 'n': return '\n';
+			case 'r': return '\r';
+			case 't': return '\t';
+			case 'u': break;
+			default: return -1;
+		}
+
+		// Unicode escapes (the characters above U+FFFF are written as surrogate pairs)
+		if (pos + 6 > size)
+			return -2;
+		int32_t cp = hex(pos + 2);
+		length = 6;
+		if (cp < 0 || (cp & 0xFC00) == 0xDC00)
+			return -1;
+		if ((cp & 0xFC00) != 0xD800)
+			return cp;
+		if (pos + 12 > size)
+		{
+			bool prefix = (pos + 6 == size || data[pos + 6] == Char('\\')) && (pos + 7 >= size || data[pos + 7] == Char('u'));
+			return prefix ? -2 : -1;
+		}
+		int32_t low = hex(pos + 8);
+		if (data[pos + 6] != Char('\\') || data[pos + 7] != Char('u') || low < 0 || (low & 0xFC00) != 0xDC00)
+			return -1;
+		length = 12;
+		return 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+	};
+
+	// Unescape string
+	result.reserve(result.size() + size);
+	size_t i = 0;
+	while (i < size)
+	{
+		// Copy the characters that are not escaped at once
+		bool verbatim;
+		const Char * stop = impl::json_run<E>(data + i, data + size, false, verbatim);
+		if (verbatim && stop != data + i)
+		{
+			size_t n = result.size();
+			result.resize(n + (stop - (data + i)));
+			std::copy(data + i, stop, &result[n]);
+			i = stop - data;
+			continue;
+		}
+
+		// Decode the run, when it is not valid (or the next character, when it is not a single unit)
+		if (stop != data + i || Unit(data[i]) >= 0x80)
+		{
+			auto iter = encoding_traits<E>::iter(data + i, data, data + size);
+			do
+			{
+				int32_t cp = *iter;
+				if (cp < 0)
+					error("json_unescape(): input: Decoding error!");
+				else
+					encoding_traits<E>::append(result, cp);
+			}
+			while (static_cast<const Char *>(++ iter) < stop);
+			i = static_cast<const Char *>(iter) - data;
+			continue;
+		}
+
+		// Quotes and control characters must be escaped
+		if (Unit(data[i]) != '\\')
+		{
+			error("json_unescape(): input: Unescaped character!");
+			i += 1;
+			continue;
+		}
+
+		// Escape sequences
+		size_t length;
+		int32_t cp = parse(i, length);
+		if (cp == -2 && !final)
+			break;
+		if (cp < 0 || !encoding_traits<E>::append(result, cp))
+			error("json_unescape(): input: Invalid escape sequence!");
+		i += std::min(length, size - i);
+	}
+
+	// Return result
+	BETTER_STRING_OUTPUT(result);
+	return i;
+}
+
+// -------------------- Binary to text --------------------
+
+// Algorithm - b64encode (appends the encoded bytes to the result)
+template<typename Self, typename Traits, typename R>
+void b64encode(Self self, R & result, bool url)
+{
+	BETTER_STRING_PROBE(B64encode, self);
+	static_assert(sizeof(typename Traits::char_type) == 1, "b64encode(): Only byte strings are supported!");
+	const char * data = reinterpret_cast<const char *>(self.data());
+	size_t size = self.size();
+	const char * alphabet = url ? kernels::scalar::b64_url : kernels::scalar::b64_standard;
+
+	// Encode the whole groups at once (the output is allocated only once)
+	size_t offset = result.size();
+	result.resize(offset + (size + 2) / 3 * 4);
+	char * output = reinterpret_cast<char *>(&result[offset]);
+	kernels::active().b64encode(data, size, output, url);
+
+	// Encode the last group, with padding
+	if (size_t rest = size % 3)
+	{
+		output += size / 3 * 4;
+		uint32_t group = uint32_t(uint8_t(data[size - rest])) << 16 | ((rest == 2) ? uint32_t(uint8_t(data[size - 1])) << 8 : 0);
+		output[0] = alphabet[group >> 18];
+		output[1] = alphabet[(group >> 12) & 0x3F];
+		output[2] = (rest == 2) ? alphabet[(group >> 6) & 0x3F] : '=';
+		output[3] = '=';
+	}
+
+	// Return result
+	BETTER_STRING_OUTPUT(result);
+}
+
+// Algorithm - b64decode (appends the decoded bytes to the result; outside of strict mode, the characters that are not in
+// the alphabet are skipped)
+template<typename Self, typename Traits, typename R>
+void b64decode(Self self, R & result, bool url, impl::Errors mode)
+{
+	BETTER_STRING_PROBE(B64decode, self);
+	static_assert(sizeof(typename Traits::char_type) == 1, "b64decode(): Only byte strings are supported!");
+	auto & values = (url ? kernels::scalar::b64_url_values : kernels::scalar::b64_standard_values).value;
+	size_t offset = result.size();
+
+	// Decode text without padding (the whole groups at once, then the last group, which is not a single character)
+	auto decode = [&] (const char * data, size_t size) -> bool
+	{
+		size_t rest = size % 4;
+		result.resize(offset + size / 4 * 3 + (rest ? rest - 1 : 0));
+		char * output = reinterpret_cast<char *>(&result[offset]);
+		if (kernels::active().b64decode(data, size - rest, output, url) == size_t(-1))
+			return false;
+
+		uint32_t group = 0;
+		for (size_t i = 0; i < rest; ++ i)
+		{
+			uint8_t value = values[uint8_t(data[size - rest + i])];
+			if (value == 0xFF)
+				return false;
+			group |= uint32_t(value) << (18 - 6 * i);
+		}
+		output += size / 4 * 3;
+		for (size_t i = 0; i + 1 < rest; ++ i)
+			output[i] = char(group >> (16 - 8 * i));
+		return true;
+	};
+
+	// Decode text (the padding is optional, but it must be correct when present)
+	const char * data = reinterpret_cast<const char *>(self.data());
+	size_t size = self.size();
+	size_t length = size;
+	while (length && size - length < 2 && data[length - 1] == '=')
+		-- length;
+	bool padded = (length % 4 != 1) && (length == size || size % 4 == 0);
+	if (padded && decode(data, length))
+	{
+		BETTER_STRING_OUTPUT(result);
+		return;
+	}
+	if (mode == impl::Errors::Strict)
+		throw std::invalid_argument(padded ? "b64decode(): input: Invalid character!" : "b64decode(): input: Incorrect padding!");
+
+	// Skip the invalid characters (and a last character, that does not make a whole byte)
+	std::string text;
+	for (size_t i = 0; i < size; ++ i)
+		if (values[uint8_t(data[i])] != 0xFF)
+			text.push_back(data[i]);
+	decode(text.data(), text.size() - (text.size() % 4 == 1));
+
+	// Return result
+	BETTER_STRING_OUTPUT(result);
+}
+
+// Algorithm - hexlify (appends the encoded bytes to the result)
+template<typename Self, typename Traits, typename R>
+void hexlify(Self self, R & result)
+{
+	BETTER_STRING_PROBE(Hexlify, self);
+	static_assert(sizeof(typename Traits::char_type) == 1, "hexlify(): Only byte strings are supported!");
+	size_t offset = result.size();
+	result.resize(offset + 2 * self.size());
+	kernels::active().hexlify(reinterpret_cast<const char *>(self.data()), self.size(), reinterpret_cast<char *>(&result[offset]));
+	BETTER_STRING_OUTPUT(result);
+}
+
+// Algorithm - unhexlify (appends the decoded bytes to the result; outside of strict mode, the characters that are not
+// hexadecimal digits are skipped)
+template<typename Self, typename Traits, typename R>
+void unhexlify(Self self, R & result, impl::Errors mode)
+{
+	BETTER_STRING_PROBE(Unhexlify, self);
+	static_assert(sizeof(typename Traits::char_type) == 1, "unhexlify(): Only byte strings are supported!");
+	size_t offset = result.size();
+
+	// Decode pairs of digits
+	auto decode = [&] (const char * data, size_t size) -> bool
+	{
+		result.resize(offset + size / 2);
+		return kernels::active().unhexlify(data, size, reinterpret_cast<char *>(&result[offset])) != size_t(-1);
+	};
+
+	// Decode text
+	const char * data = reinterpret_cast<const char *>(self.data());
+	size_t size = self.size();
+	if (size % 2 == 0 && decode(data, size))
+	{
+		BETTER_STRING_OUTPUT(result);
+		return;
+	}
+	if (mode == impl::Errors::Strict)
+		throw std::invalid_argument((size % 2) ? "unhexlify(): input: Odd number of digits!" : "unhexlify(): input: Invalid digit!");
+
+	// Skip the invalid characters (and a last digit, that does not make a whole byte)
+	std::string text;
+	for (size_t i = 0; i < size; ++ i)
+		if (kernels::scalar::hex_values.value[uint8_t(data[i])] != 0xFF)
+			text.push_back(data[i]);
+	decode(text.data(), text.size() & ~size_t(1));
+
+	// Return result
+	BETTER_STRING_OUTPUT(result);
+}
+
+// -------------------- URL encoding --------------------
+
+// Algorithm - percent_encode (appends the encoded text to the result; with `plus`, spaces are encoded as '+')
+template<typename Self, typename Traits, typename R>
+void percent_encode(Self self, R & result, const kernels::ByteSet & safe, bool plus)
+{
+	BETTER_STRING_PROBE(PercentEncode, self);
+	static_assert(sizeof(typename Traits::char_type) == 1, "percent_encode(): Only byte strings are supported!");
+	const char * data = reinterpret_cast<const char *>(self.data());
+	size_t size = self.size();
+	auto & table = kernels::active();
+
+	// The encoded bytes are the ones not in the safe set
+	kernels::ByteSet special;
+	for (size_t i = 0; i < 16; ++ i)
+	{
+		special.low[i] = uint8_t(~safe.low[i]);
+		special.high[i] = uint8_t(~safe.high[i]);
+	}
+
+	// Size of the result (the safe runs are skipped at once)
+	size_t length = size;
+	for (size_t i = 0; (i += std::min(table.find_any(data + i, size - i, special), size - i)) < size; ++ i)
+		length += (plus && data[i] == ' ') ? 0 : 2;
+
+	// Encode text (the safe runs are copied at once)
+	result.reserve(result.size() + length);
+	for (size_t i = 0; i < size;)
+	{
+		size_t run = std::min(table.find_any(data + i, size - i, special), size - i);
+		if (run)
+		{
+			size_t n = result.size();
+			result.resize(n + run);
+			std::copy(data + i, data + i + run, &result[n]);
+			i += run;
+			continue;
+		}
+
+		uint8_t ch = uint8_t(data[i ++]);
+		if (plus && ch == ' ')
+			result.push_back('+');
+		else
+		{
+			result.push_back('%');
+			result.push_back("0123456789ABCDEF"[ch >> 4]);
+			result.push_back("0123456789ABCDEF"[ch & 0x0F]);
+		}
+	}
+
+	// Return result
+	BETTER_STRING_OUTPUT(result);
+}
+
+// Algorithm - percent_decode (appends the decoded bytes to the result; with `plus`, '+' is decoded as a space)
+template<typename Self, typename Traits, typename R>
+void percent_decode(Self self, R & result, bool plus, impl::Errors mode)
+{
+	BETTER_STRING_PROBE(PercentDecode, self);
+	static_assert(sizeof(typename Traits::char_type) == 1, "percent_decode(): Only byte strings are supported!");
+	constexpr Encoding E = default_encoding<typename Traits::char_type>::value;
+	const char * data = reinterpret_cast<const char *>(self.data());
+	size_t size = self.size();
+	auto & table = kernels::active();
+	auto & values = kernels::scalar::hex_values.value;
+
+	// Decode text (the runs without escapes are copied at once)
+	result.reserve(result.size() + size);
+	for (size_t i = 0; i < size;)
+	{
+		size_t found = plus ? table.find_any(data + i, size - i, impl::percent_special) : table.find_byte(data + i, size - i, '%');
+		size_t run = std::min(found, size - i);
+		if (run)
+		{
+			size_t n = result.size();
+			result.resize(n + run);
+			std::copy(data + i, data + i + run, &result[n]);
+			i += run;
+			continue;
+		}
+
+		// Plus sign
+		if (data[i] == '+')
+		{
+			result.push_back(' ');
+			i += 1;
+			continue;
+		}
+
+		// Escape sequence (invalid ones are kept unchanged in ignore mode)
+		uint8_t high = (i + 1 < size) ? values[uint8_t(data[i + 1])] : 0xFF;
+		uint8_t low = (i + 2 < size) ? values[uint8_t(data[i + 2])] : 0xFF;
+		if (!((high | low) & 0x80))
+		{
+			result.push_back(char(high << 4 | low));
+			i += 3;
+			continue;
+		}
+		if (mode == impl::Errors::Strict)
+			throw std::invalid_argument("percent_decode(): input: Invalid escape sequence!");
+		if (mode == impl::Errors::Replace)
+			encoding_traits<E>::append(result, encoding_traits<E>::replacement);
+		else
+			result.push_back('%');
+		i += 1;
+	}
+
+	// Return result
+	BETTER_STRING_OUTPUT(result);
+}
+
+// -------------------- HTML --------------------
+
+// Algorithm - html_escape (appends the escaped text to the result)
+template<typename Self, typename Traits, typename R>
+void html_escape(Self self, R & result, bool quote)
+{
+	BETTER_STRING_PROBE(HtmlEscape, self);
+	using Char = typename Traits::char_type;
+	const Char * ptr = self.data();
+	const Char * end = ptr + self.size();
+
+	// Escape text (the runs without special characters are copied at once)
+	result.reserve(result.size() + self.size());
+	while (ptr < end)
+	{
+		const Char * stop = impl::html_run(ptr, end, quote);
+		if (stop != ptr)
+		{
+			size_t size = result.size();
+			result.resize(size + (stop - ptr));
+			std::copy(ptr, stop, &result[size]);
+			ptr = stop;
+			continue;
+		}
+
+		const char * entity = (*ptr == Char('&')) ? "&amp;" : (*ptr == Char('<')) ? "&lt;" : (*ptr == Char('>')) ? "&gt;" :
+			(*ptr == Char('"')) ? "&quot;" : "&#x27;";
+		for (; *entity; ++ entity)
+			result.push_back(Char(*entity));
+		++ ptr;
+	}
+
+	// Return result
+	BETTER_STRING_OUTPUT(result);
+}
+
+// Algorithm - html_unescape (appends the unescaped text to the result; references that are not valid are kept)
+template<typename Self, typename Traits, Encoding E, typename R>
+void html_unescape(Self self, R & result)
+{
+	BETTER_STRING_PROBE(HtmlUnescape, self);
+	using Char = typename Traits::char_type;
+	using Unit = typename std::make_unsigned<Char>::type;
+	const Char * data = self.data();
+	size_t size = self.size();
+
+	// Character classes
+	auto digit = [] (Unit ch, bool hex) -> int32_t
+	{
+		if (ch >= '0' && ch <= '9')
+			return ch - '0';
+		if (hex && (ch | 0x20) >= 'a' && (ch | 0x20) <= 'f')
+			return (ch | 0x20) - 'a' + 10;
+		return -1;
+	};
+	auto alnum = [] (Unit ch)
+		{return (ch >= '0' && ch <= '9') || ((ch | 0x20) >= 'a' && (ch | 0x20) <= 'z');};
+
+	// Parse the reference at a position (returns the codepoint, or -1, and sets its length)
+	auto parse = [&] (size_t pos, size_t & length) -> int32_t
+	{
+		size_t i = pos + 1;
+
+		// Numeric references (the semicolon is optional, the codepoints that are not valid are replaced, and the C1
+		// controls are decoded as windows-1252)
+		if (i < size && data[i] == Char('#'))
+		{
+			bool hex = (i + 1 < size) && (Unit(data[i + 1]) | 0x20) == 'x';
+			i += hex ? 2 : 1;
+			size_t start = i;
+			uint32_t cp = 0;
+			for (int32_t value; i < size && (value = digit(Unit(data[i]), hex)) >= 0; ++ i)
+				cp = std::min<uint32_t>(cp * (hex ? 16 : 10) + value, 0x110000);
+			if (i == start)
+				return -1;
+			length = i + (i < size && data[i] == Char(';')) - pos;
+			if (cp >= 0x80 && cp < 0xA0)
+				return impl::html_c1[cp - 0x80];
+			return (cp == 0 || cp >= 0x110000 || (cp >= 0xD800 && cp < 0xE000)) ? encoding_traits<E>::replacement : int32_t(cp);
+		}
+
+		// Named references (the semicolon is required)
+		while (i < size && i - pos <= 8 && alnum(Unit(data[i])))
+			++ i;
+		if (i == size || data[i] != Char(';'))
+			return -1;
+		length = i + 1 - pos;
+		return impl::html_entity(data + pos + 1, i - pos - 1);
+	};
+
+	// Unescape text (the runs without references are copied at once)
+	result.reserve(result.size() + size);
+	for (size_t i = 0; i < size;)
+	{
+		size_t run = std::min(impl::find_ascii(data, i, size, '&'), size) - i;
+		if (run)
+		{
+			size_t n = result.size();
+			result.resize(n + run);
+			std::copy(data + i, data + i + run, &result[n]);
+			i += run;
+			continue;
+		}
+
+		size_t length = 1;
+		int32_t cp = parse(i, length);
+		if (cp < 0)
+			result.push_back(Char('&'));
+		else if (!encoding_traits<E>::append(result, cp))
+			encoding_traits<E>::append(result, encoding_traits<E>::replacement);
+		i += (cp < 0) ? 1 : length;
+	}
+
+	// Return result
+	BETTER_STRING_OUTPUT(result);
+}
+
+/// @}
+
+// Close namespace "ext::algorithm::string"
+}}
+
+// Using basic_string from std
+template<typename C, typename T, typename A>
+using basic_string = std::basic_string<C, T, A>;
+
+// Using basic_string_view from std, when available
+#if __cplusplus >= 201703
+template<typename C, typename T = std::char_traits<C>>
+using basic_string_view = std::basic_string_view<C, T>;
+#endif
+
+#if __cplusplus < 201703
+
+/************************************************************
+ * @brief String view - for C++14 and below
+ *
+ * String views are part of the standard library, starting from C++17. This
+ * class is used for C++11 and C++14, as the base class of better_string_view.
+ */
+template<typename Char, typename Traits = std::char_traits<Char>>
+class basic_string_view
+{
+public:
+	// Aliases
+	using traits_type = Traits;
+	using value_type = Char;
+	using pointer = Char *;
+	using const_pointer = const Char *;
+	using reference = Char &;
+	using const_reference = const Char &;
+	using iterator = const Char *;
+	using const_iterator = const Char *;
+	using reverse_iterator = std::reverse_iterator<iterator>;
+	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+	using size_type = size_t;
+	using difference_type = ptrdiff_t;
+
+	// Constants
+	static constexpr size_type npos = size_type(-1);
+
+	// Constructors
+	constexpr basic_string_view() noexcept = default;
+	constexpr basic_string_view(const basic_string_view &) noexcept = default;
+	constexpr basic_string_view(const Char * str) noexcept
+		: _str(str), _len(Traits::length(str)) {}
+	constexpr basic_string_view(const Char * str, size_type len) noexcept
+		: _str(str), _len(len) {}
+
+	// Size
+	constexpr auto size() const noexcept -> size_type
+		{return _len;}
+	constexpr auto length() const noexcept -> size_type
+		{return _len;}
+	constexpr auto max_size() const noexcept -> size_type
+		{return (size_type) -1;}
+	constexpr bool empty() const noexcept
+		{return !_len;}
+
+	// Data
+	constexpr auto data() const noexcept -> const Char *
+		{return _str;}
+
+	// Copy
+	auto operator = (const basic_string_view &) noexcept -> basic_string_view & = default;
+
+	// Getters
+	constexpr auto operator [] (size_type pos) const noexcept -> const Char &
+		{return _str[pos];}
+	constexpr auto at(size_type pos) const -> const Char &
+	{
+		if (pos < _len)
+			return _str[pos];
+		else
+			throw std::out_of_range("basic_string_view::at(): pos");
+	}
+	constexpr auto front() const -> const Char &
+		{return _str[0];}
+	constexpr auto back() const -> const Char &
+		{return _str[_len - 1];}
+
+	// Operations
+	void remove_prefix(size_type n)
+		{_str += n; _len -= n;}
+	void remove_suffix(size_type n)
+		{_len -= n;}
+
+	// Iteration
+	constexpr auto begin() const noexcept -> iterator
+		{return _str;}
+	constexpr auto cbegin() const noexcept -> const_iterator
+		{return _str;}
+	constexpr auto end() const noexcept -> iterator
+		{return _str + _len;}
+	constexpr auto cend() const noexcept -> const_iterator
+		{return _str + _len;}
+	constexpr auto rbegin() const noexcept -> reverse_iterator
+		{ return reverse_iterator(_str + _len); }
+	constexpr auto crbegin() const noexcept -> const_reverse_iterator
+		{ return const_reverse_iterator(_str + _len); }
+	constexpr auto rend() const noexcept -> reverse_iterator
+		{ return reverse_iterator(_str); }
+	constexpr auto crend() const noexcept -> const_reverse_iterator
+		{ return const_reverse_iterator(_str); }
+
+	// Comparison
+	constexpr int compare(basic_string_view str) const noexcept
+	{
+		auto r = Traits::compare(_str, str._str, std::min(_len, str._len));
+		return r != 0 ? r : (str._len < _len) - (_len < str._len);
+	}
+	constexpr int compare(const Char * str) const
+		{return compare(basic_string_view(str));}
+
+	// Substring
+	constexpr auto substr(size_type pos = 0, size_type len = npos) const -> basic_string_view
+		{return basic_string_view(_str + pos, _str + pos + std::min(_len - pos, len));}
+
+private:
+	const Char * _str = nullptr;
+	size_type    _len = 0;
+};
+
+// String view operators
+template<typename Char, typename Traits>
+bool operator == (basic_string_view<Char, Traits> left, basic_string_view<Char, Traits> right)
+	{return left.compare(right) == 0;}
+template<typename Char, typename Traits>
+bool operator != (basic_string_view<Char, Traits> left, basic_string_view<Char, Traits> right)
+	{return left.compare(right) != 0;}
+
+template<typename Char, typename Traits>
+bool operator < (basic_string_view<Char, Traits> left, basic_string_view<Char, Traits> right)
+	{return left.compare(right) < 0;}
+template<typename Char, typename Traits>
+bool operator > (basic_string_view<Char, Traits> left, basic_string_view<Char, Traits> right)
+	{return left.compare(right) > 0;}
+template<typename Char, typename Traits>
+bool operator <= (basic_string_view<Char, Traits> left, basic_string_view<Char, Traits> right)
+	{return left.compare(right) <= 0;}
+template<typename Char, typename Traits>
+bool operator >= (basic_string_view<Char, Traits> left, basic_string_view<Char, Traits> right)
+	{return left.compare(right) >= 0;}
+
+#endif
+
+//	------------------------------------------------------------
+//		Better string
+//	------------------------------------------------------------
+
+/************************************************************
+ * @brief Better string - a better std::string
+ *
+ * This class augments the standard string class, to make it more usable, by
+ * adding much needed utility methods, and replacing existing ones.
+ *
+ * Where applicable, the methods now take character encoding into account. By
+ * default, each string type uses a Unicode character encoding (UTF-8, UTF-16,
+ * UTF-32), but you can specify the encoding used for the methods directly.
+ */
+template<typename Char, typename Traits, typename Allocator>
+class better_string : public basic_string<Char, Traits, Allocator>
+{
+	// Private aliases
+	using base__ = basic_string<Char, Traits, Allocator>;
+	template<typename CharTo>
+	using rebind__ = better_string<CharTo, std::char_traits<CharTo>, typename std::allocator_traits<Allocator>::template rebind_alloc<CharTo>>;
+
+	// Default encoding
+	static constexpr Encoding default_encoding__ = default_encoding<Char>::value;
+
+public:
+	// Aliases
+	using errors = impl::Errors;
+
+	// Constructors
+	using base__::basic_string;
+	constexpr better_string(const Char * ptr, const Char * end)
+		: base__(ptr, end - ptr) {}
 
 	// Core functions
 
-	/**
-	 * @brief The number of <i>Unicode codepoints</i> in the string.
-	 *
-	 * In all of the better string types this function is redefined to return
-	 * the actual length of the text, rather than the number of characters used
-	 * to store that text. If you want the later, @ref size is still available
-	 * for that.
-	 */
+	/**
+	 * @brief The number of <i>Unicode codepoints</i> in the string.
+	 *
+	 * In all of the better string types this function is redefined to return
+	 * the actual length of the text, rather than the number of characters used
+	 * to store that text. If you want the later, @ref size is still available
+	 * for that.
+	 */
+	template<Encoding E = default_encoding__>
+	auto length() const -> size_t
+		{return encoding_traits<E>::iter(base__::data() + base__::size()) - encoding_traits<E>::iter(base__::data(), base__::data(), base__::data() + base__::size());}
+
+	/**
+	 * @brief A view of the <i>Unicode codepoints</i> in the string.
+	 *
+	 * Iterating over this view is the same as converting the string to UTF-32,
+	 * and iterating over that, but it converts the characters on the fly.
+	 */
+	template<Encoding E = default_encoding__>
+	auto codepoints() const -> iterable_view<typename encoding_traits<E>::template iterator<Char>>
+		{return {encoding_traits<E>::iter(base__::data(), base__::data(), base__::data() + base__::size()), encoding_traits<E>::iter(base__::data() + base__::size())};}
+
+	// Assignment
+	using base__::operator =;
+
+	/// Assignment operator for string view
+	auto operator = (better_string_view<Char> view) -> better_string
+		{return static_cast<better_string &>(base__::assign(view.data(), view.size()));}
+
+	/// Move assignment operator for string
+	auto operator = (basic_string<Char, Traits, Allocator> && str) -> better_string
+		{return static_cast<better_string &>(base__::assign(std::move(str)));}
+
+	/// Copy assignment operator for strings
+	auto operator = (const basic_string<Char, Traits, Allocator> & str) -> better_string
+		{return static_cast<better_string &>(base__::assign(str));}
+
+	/// Copy assignment operator for strings
+	template<typename T, typename A>
+	auto operator = (const basic_string<Char, T, A> & str) -> better_string
+		{return static_cast<better_string &>(base__::assign(str.data(), str.size()));}
+
+	// Appending the string
+
+	/**
+	 * @brief Encode a Unicode codepoint, and append it to the string.
+	 *
+	 * @tparam E The encoding of the string.
+	 * @param codepoint The codepoint to append.
+	 */
+	template<Encoding E = default_encoding__>
+	auto append(uint32_t codepoint) -> better_string &
+		{encoding_traits<E>::append(*this, codepoint); return * this;}
+
+	// Extending the string
+
+	/**
+	 * @brief Extend the string with an other string.
+	 *
+	 * @note Previously called "append" in the @ref std::basic_string.
+	 * @param str The string to append.
+	 */
+	auto extend(better_string_view<Char> str) -> better_string &
+		{return static_cast<better_string &>(base__::append(str.data(), str.size()));}
+
+	/**
+	 * @brief Extend the string with an other string.
+	 *
+	 * @note Previously called "append" in the @ref std::basic_string
+	 * @param str The string to append.
+	 */
+	auto extend(const basic_string<Char, Traits, Allocator> & str) -> better_string &
+		{return static_cast<better_string &>(base__::append(str));}
+
+	/**
+	 * @brief Extend the string with a raw C string.
+	 *
+	 * @note Previously called "append" in the @ref std::basic_string
+	 *
+	 * @param data The start of the string.
+	 * @param size The size of the string.
+	 */
+	auto extend(const Char * data, size_t size) -> better_string &
+		{return static_cast<better_string &>(base__::append(data, size));}
+
+	/**
+	 * @brief Extend the string with raw C string.
+	 *
+	 * @note Previously called "append" in the @ref std::basic_string
+	 *
+	 * @param start The start of the string.
+	 * @param end The end of the string (exclusive).
+	 */
+	auto extend(const Char * start, const Char * end) -> better_string &
+		{return static_cast<better_string &>(base__::append(start, end - start));}
+
+	/// Operator to extend the string with a string view.
+	auto operator += (better_string_view<Char> view) -> better_string
+		{return static_cast<better_string &>(base__::append(view.data(), view.size()));}
+
+	/// Operator to extend the string with an other string.
+	auto operator += (const basic_string<Char, Traits, Allocator> & str) -> better_string
+		{return static_cast<better_string &>(base__::append(str));}
+
+	// Alignment functions
+
+	/**
+	 * @brief Pad the the string to the specified width, while also centering it.
+	 *
+	 * @tparam E The encoding of the string.
+	 * @param width The desired length of the new string.
+	 * @param fillchar The fill character used for padding the string. Defaults to the space character(0x20).
+	 */
+	template<Encoding E = default_encoding__>
+	auto center(size_t width, better_string_view<Char> fillchar = string_literal<Char, ' '>()) const -> better_string
+		{return algorithm::string::center<decltype(*this), Traits, E, better_string_view<Char>, better_string>(*this, width, fillchar);}
+
+	/**
+	 * @brief Pad the the string to the specified width, while aligning it to the left.
+	 *
+	 * @tparam E The encoding of the string.
+	 * @param width The desired length of the new string.
+	 * @param fillchar The fill character used for padding the string. Defaults to the space character(0x20).
+	 */
+	template<Encoding E = default_encoding__>
+	auto ljust(size_t width, better_string_view<Char> fillchar = string_literal<Char, ' '>()) const -> better_string
+		{return algorithm::string::ljust<decltype(*this), Traits, E, better_string_view<Char>, better_string>(*this, width, fillchar);}
+
+	/**
+	 * @brief Pad the the string to the specified width, while aligning it to the right.
+	 *
+	 * @tparam E The encoding of the string.
+	 * @param width The desired length of the new string.
+	 * @param fillchar The fill character used for padding the string. Defaults to the space character(0x20).
+	 */
+	template<Encoding E = default_encoding__>
+	auto rjust(size_t width, better_string_view<Char> fillchar = string_literal<Char, ' '>()) const -> better_string
+		{return algorithm::string::rjust<decltype(*this), Traits, E, better_string_view<Char>, better_string>(*this, width, fillchar);}
+
+	/**
+	 * @brief Pad the the string to the specified width with zeros, while aligning it to the right. If the first
+	 * character is a sign (+/-), it is left alone.
+	 *
+	 * @param width The desired length of the new string.
+	 */
+	template<Encoding E = default_encoding__>
+	auto zfill(size_t width) const -> better_string
+		{return algorithm::string::zfill<decltype(*this), Traits, E, better_string>(*this, width);}
+
+	// Search functions
+
+	/**
+	 * @brief Find the first occurrence of a substring and return its position.
+	 * If the string is not found @ref npos is returned.
+	 *
+	 * @tparam E The encoding of the string.
+	 * @param str The substring to find.
+	 */
+	template<Encoding E = default_encoding__>
+	auto find(better_string_view<Char> str, size_t start = 0, size_t end = base__::npos) const -> size_t
+		{return algorithm::string::find<decltype(*this), Traits, E, better_string_view<Char>>(*this, str, start, end);}
+
+	/**
+	 * @brief Find the last occurrence of a substring and return its position.
+	 * If the string is not found @ref npos is returned.
+	 *
+	 * @tparam E The encoding of the string.
+	 * @param str The substring to find.
+	 */
+	template<Encoding E = default_encoding__>
+	auto rfind(better_string_view<Char> str, size_t start = 0, size_t end = base__::npos) const -> size_t
+		{return algorithm::string::rfind<decltype(*this), Traits, E, better_string_view<Char>>(*this, str, start, end);}
+
+	/**
+	 * @brief Find the first occurrence of a substring and return its position.
+	 * If the string is not found std::invalid_argument is thrown.
+	 *
+	 * @tparam E The encoding of the string.
+	 * @param str The substring to find.
+	 */
+	template<Encoding E = default_encoding__>
+	auto index(better_string_view<Char> str, size_t start = 0, size_t end = base__::npos) const -> size_t
+		{return algorithm::string::index<decltype(*this), Traits, E, better_string_view<Char>>(*this, str, start, end);}
+
+	/**
+	 * @brief Find the last occurrence of a substring and returns its position.
+	 * If the string is not found std::invalid_argument is thrown.
+	 *
+	 * @tparam E The encoding of the string.
+	 * @param str The substring to find.
+	 */
+	template<Encoding E = default_encoding__>
+	auto rindex(better_string_view<Char> str, size_t start = 0, size_t end = base__::npos) const -> size_t
+		{return algorithm::string::rindex<decltype(*this), Traits, E, better_string_view<Char>>(*this, str, start, end);}
+
+	/**
+	 * @brief Count the number of non-overlapping occurrences of a substring.
+	 *
+	 * @tparam E The encoding of the string.
+	 * @param str The substring to find.
+	 */
+	template<Encoding E = default_encoding__>
+	auto count(better_string_view<Char> str, size_t start = 0, size_t end = base__::npos) const -> size_t
+		{return algorithm::string::count<decltype(*this), Traits, E, better_string_view<Char>>(*this, str, start, end);}
+
+	/**
+	 * @brief A lazy view of the occurrences of a substring (like Python's `re.finditer()` with an escaped pattern).
+	 *
+	 * The occurrences are views of the string, and the iterators also return their offsets. Without `overlapping`,
+	 * the search continues after the end of every occurrence (like @ref count), otherwise after its first character.
+	 * The empty substring occurs at every character boundary, and at the end.
+	 *
+	 * @tparam E The encoding of the string.
+	 * @param sub The substring to find (it must outlive the view, like the string).
+	 * @param overlapping Finds the occurrences that start inside of the previous one too.
+	 */
+	template<Encoding E = default_encoding__>
+	auto finditer(better_string_view<Char> sub, bool overlapping = false) const -> ext::finditer<Char, Traits, E>
+		{return ext::finditer<Char, Traits, E>(*this, sub, overlapping);}
+
+	/**
+	 * @brief Returns the offsets of every occurrence of a substring (see @ref finditer).
+	 *
+	 * Long strings are split into chunks, which are searched by several threads.
+	 *
+	 * @tparam E The encoding of the string.
+	 * @param sub The substring to find.
+	 * @param overlapping Finds the occurrences that start inside of the previous one too.
+	 * @param threads The maximum number of threads (0 for the number of hardware threads).
+	 */
+	template<Encoding E = default_encoding__>
+	auto find_all(better_string_view<Char> sub, bool overlapping = false, size_t threads = 1) const -> std::vector<size_t>
+		{return algorithm::string::find_all<decltype(*this), Traits, E, better_string_view<Char>>(*this, sub, overlapping, threads);}
+
+	// The substring and character searches of the base class
+	using base__::find_first_of;
+	using base__::find_first_not_of;
+	using base__::find_last_of;
+	using base__::find_last_not_of;
+
+	/**
+	 * @brief Find the first character, that is in a set of characters, and return its position. If there is no such
+	 * character @ref npos is returned.
+	 *
+	 * Unlike the overloads of the base class, the characters are decoded (with the encoding of the set). Byte strings
+	 * are searched with the string kernels.
+	 *
+	 * @tparam E The encoding of the string.
+	 * @param set The characters to find.
+	 * @param pos The position to start the search at.
+	 */
+	template<Encoding E, size_t N>
+	auto find_first_of(const charset<E, N> & set, size_t pos = 0) const -> size_t
+		{return algorithm::string::find_first_of<decltype(*this), Traits, E, charset<E, N>>(*this, set, pos);}
+
+	/// Same as @ref find_first_of, but finds the first character, that is not in the set.
+	template<Encoding E, size_t N>
+	auto find_first_not_of(const charset<E, N> & set, size_t pos = 0) const -> size_t
+		{return algorithm::string::find_first_not_of<decltype(*this), Traits, E, charset<E, N>>(*this, set, pos);}
+
+	/**
+	 * @brief Find the last character, that is in a set of characters, and starts at or before @p pos. If there is no
+	 * such character @ref npos is returned.
+	 *
+	 * @note Requires a reversible encoding.
+	 *
+	 * @tparam E The encoding of the string.
+	 * @param set The characters to find.
+	 * @param pos The last position of the search.
+	 */
+	template<Encoding E, size_t N>
+	auto find_last_of(const charset<E, N> & set, size_t pos = base__::npos) const -> size_t
+		{return algorithm::string::find_last_of<decltype(*this), Traits, E, charset<E, N>>(*this, set, pos);}
+
+	/// Same as @ref find_last_of, but finds the last character, that is not in the set.
+	template<Encoding E, size_t N>
+	auto find_last_not_of(const charset<E, N> & set, size_t pos = base__::npos) const -> size_t
+		{return algorithm::string::find_last_not_of<decltype(*this), Traits, E, charset<E, N>>(*this, set, pos);}
+
+	/**
+	 * @brief Returns the length of the run of characters from @p pos, that are in a set of characters (like `strspn`).
+	 *
+	 * @tparam E The encoding of the string.
+	 * @param set The characters of the run.
+	 * @param pos The start of the run.
+	 */
+	template<Encoding E, size_t N>
+	auto span(const charset<E, N> & set, size_t pos = 0) const -> size_t
+		{return algorithm::string::span<decltype(*this), Traits, E, charset<E, N>>(*this, set, pos);}
+
+	/// Same as @ref span, but the run is of the characters, that are not in the set (like `strcspn`).
+	template<Encoding E, size_t N>
+	auto cspan(const charset<E, N> & set, size_t pos = 0) const -> size_t
+		{return algorithm::string::cspan<decltype(*this), Traits, E, charset<E, N>>(*this, set, pos);}
+
+	/**
+	 * @brief Returns the edit distance (Levenshtein distance) of two strings: the number of characters that have to be
+	 * inserted, deleted or replaced, to turn one string into the other.
+	 *
+	 * The distance is computed for 64 characters at a time (Myers' bit-vector algorithm). With a limit, only the band
+	 * around the diagonal is computed, and the computation stops as soon as the distance is known to be above it.
+	 *
+	 * @tparam E The encoding of the strings.
+	 * @param other The other string.
+	 * @param max The limit of the distance. Greater distances are returned as @p max + 1.
+	 */
+	template<Encoding E = default_encoding__>
+	auto levenshtein(better_string_view<Char> other, size_t max = base__::npos) const -> size_t
+		{return algorithm::string::levenshtein<decltype(*this), Traits, E, better_string_view<Char>>(*this, other, max);}
+
+	/**
+	 * @brief Same as @ref levenshtein, but swapping two adjacent characters is a single edit too (the optimal string
+	 * alignment distance, that does not edit a substring more than once).
+	 *
+	 * @tparam E The encoding of the strings.
+	 * @param other The other string.
+	 * @param max The limit of the distance. Greater distances are returned as @p max + 1.
+	 */
+	template<Encoding E = default_encoding__>
+	auto damerau(better_string_view<Char> other, size_t max = base__::npos) const -> size_t
+		{return algorithm::string::damerau<decltype(*this), Traits, E, better_string_view<Char>>(*this, other, max);}
+
+	/**
+	 * @brief Find the first approximate occurrence of a pattern: a substring within @p k edits (insertions, deletions
+	 * or replacements of characters) of the pattern. Returns its offset (or npos), like @ref find.
+	 *
+	 * The occurrence that ends first is returned, with the fewest edits (and the shortest one of those).
+	 *
+	 * @tparam E The encoding of the strings.
+	 * @param pattern The pattern to find.
+	 * @param k The maximum number of edits.
+	 */
+	template<Encoding E = default_encoding__>
+	auto fuzzy_find(better_string_view<Char> pattern, size_t k) const -> size_t
+		{size_t length; return algorithm::string::fuzzy_find<decltype(*this), Traits, E, better_string_view<Char>>(*this, pattern, k, length);}
+
+	/// A version of @ref fuzzy_find(), that also returns the length of the occurrence.
+	template<Encoding E = default_encoding__>
+	auto fuzzy_find(better_string_view<Char> pattern, size_t k, size_t & length) const -> size_t
+		{return algorithm::string::fuzzy_find<decltype(*this), Traits, E, better_string_view<Char>>(*this, pattern, k, length);}
+
+	// Replace functions
+
+	/**
+	 * @brief Replace the first @p count number of non-overlapping occurrences of @p old with @p str.
+	 *
+	 * @tparam E The encoding of the string.
+	 * @param old The substring to replace.
+	 * @param str The substring to replace it with.
+	 * @param count The maximum number or substrings to replace.
+	 */
+	template<Encoding E = default_encoding__>
+	auto replace(better_string_view<Char> old, better_string_view<Char> str, size_t count = base__::npos) const -> better_string
+		{return algorithm::string::replace<decltype(*this), Traits, E, better_string_view<Char>, better_string_view<Char>, better_string>(*this, old, str, count);}
+
+	/**
+	 * @brief Replace every character in a string, using a translation table. The translation table is usually
+	 * obtained from from the @ref maketrans function.
+	 *
+	 * The translation table is a function (or function like object), that takes a unicode codepoint, and returns its
+	 * replacement, or -1 to remove the character without replacing it.
+	 *
+	 * @note In Python the translate method uses a dictionary instead of a function.
+	 *
+	 * @tparam E The encoding of the string.
+	 * @param table The translation table.
+	 */
+	template<Encoding E = default_encoding__, typename Function>
+	auto translate(Function && table, errors mode = errors::Replace) const -> better_string
+		{return algorithm::string::translate<decltype(*this), Traits, E, Function &&, better_string>(*this, static_cast<Function &&>(table), mode);}
+
+	/**
+	 * @brief Create a translation table to be used with the @ref translate function. It takes two strings of equal
+	 * length. The characters in the first strings will be translated to the characters that have the same position in
+	 * the second string. The third string is optional, the characters in that will be removed from the string.
+	 *
+	 * @tparam E The encoding of the string.
+	 * @param from The characters to replace.
+	 * @param to The replacement characters.
+	 * @param skip The characters to remove.
+	 */
+	template<Encoding E = default_encoding__>
+	static auto maketrans(better_string_view<Char> from, better_string_view<Char> to, better_string_view<Char> skip = "") -> impl::Translation
+		{return impl::Translation::create<E>(from, to, skip);}
+
+	/**
+	 * @brief Convert tabs to spaces correctly. Each tab will be replaced with enough spaces to align its end with the
+	 * next tabulator position. The spacing of the tabulator positions are given by @p tabsize.
+	 *
+	 * @note In Python the default tabulator size is 8. Here, it's 4.
+	 *
+	 * @tparam E The encoding of the string.
+	 * @param from The size of the tabulator positions. Defaults to 4.
+	 */
+	template<Encoding E = default_encoding__>
+	auto expandtabs(size_t tabsize = 4) const -> better_string
+		{return algorithm::string::expandtabs<decltype(*this), Traits, E, better_string>(*this, tabsize);}
+
+	// Split and join functions
+
+	/**
+	 * @brief Concatenate the strings in the list, using this string as a
+	 * separator between the items.
+	 *
+	 * @param iterable The list of items to join together.
+	 */
+	template<typename Iterable>
+	auto join(const Iterable & iterable) const -> better_string
+		{return algorithm::string::join<decltype(*this), Traits, const Iterable &, better_string>(*this, iterable);}
+
+	/**
+	 * @brief Split the string along sequences of whitespace characters.
+	 *
+	 * @note Only the ASCII whitespace characters (space, \\t, \\v, \\n, \\r,
+	 * \\f) are recognized. Unicode whitespace characters are not.
+	 *
+	 * @tparam E The encoding of the string.
+	 * @param maxsplit The maximum number of splits to do. The default (-1) means no limit.
+	 */
+	template<Encoding E = default_encoding__>
+	auto split(size_t maxsplit = -1) const -> std::vector<better_string>
+		{return algorithm::string::split<decltype(*this), Traits, E, std::vector<better_string>>(*this, maxsplit);}
+
+	/**
+	 * @brief Split the string along a predefined separator string.
+	 *
+	 * @tparam E The encoding of the string.
+	 * @param sep The separator string to use.
+	 * @param maxsplit The maximum number of splits to do. The default (-1) means no limit.
+	 */
+	template<Encoding E = default_encoding__>
+	auto split(better_string_view<Char> sep, size_t maxsplit = -1) const -> std::vector<better_string>
+		{return algorithm::string::split<decltype(*this), Traits, E, better_string_view<Char>, std::vector<better_string>>(*this, sep, maxsplit);}
+
+	/**
+	 * @brief Split the string at every character, that is in a set of separator characters. Like with @ref split,
+	 * consecutive separators produce empty parts.
+	 *
+	 * @tparam E The encoding of the string.
+	 * @param seps The separator characters.
+	 * @param maxsplit The maximum number of splits to do. The default (-1) means no limit.
+	 */
+	template<Encoding E = default_encoding__>
+	auto split_any(better_string_view<Char> seps, size_t maxsplit = -1) const -> std::vector<better_string>
+		{return algorithm::string::split_any<decltype(*this), Traits, E, better_string_view<Char>, std::vector<better_string>>(*this, seps, maxsplit);}
+
+	/// A version of @ref split_any(), with a @ref charset.
+	template<Encoding E, size_t N>
+	auto split_any(const charset<E, N> & seps, size_t maxsplit = -1) const -> std::vector<better_string>
+		{return algorithm::string::split_any<decltype(*this), Traits, E, const charset<E, N> &, std::vector<better_string>>(*this, seps, maxsplit);}
+
+	/**
+	 * @brief Split the string along sequences of whitespace characters.
+	 *
+	 * Same as @ref split, but searches in reverse. @p maxsplit is also counted from the back of the string.
+	 *
+	 * @note Requires a reversible encoding.
+	 *
+	 * @tparam E The encoding of the string.
+	 * @param maxsplit The maximum number of splits to do. The default (-1) means no limit.
+	 */
+	template<Encoding E = default_encoding__>
+	auto rsplit(size_t maxsplit = -1) const -> std::vector<better_string>
+		{return algorithm::string::rsplit<decltype(*this), Traits, E, std::vector<better_string>>(*this, maxsplit);}
+
+	/**
+	 * @brief Split the string along the non-overlapping occurrences of a separator string.
+	 *
+	 * Same as @ref split, but searches in reverse. @p maxsplit is also counted from the back of the string.
+	 *
+	 * @note Requires a reversible encoding.
+	 *
+	 * @tparam E The encoding of the string.
+	 * @param sep The separator string to use.
+	 * @param maxsplit The maximum number of splits to do. The default (-1) means no limit.
+	 */
+	template<Encoding E = default_encoding__>
+	auto rsplit(better_string_view<Char> sep, size_t maxsplit = -1) const -> std::vector<better_string>
+		{return algorithm::string::rsplit<decltype(*this), Traits, E, better_string_view<Char>, std::vector<better_string>>(*this, sep, maxsplit);}
+
+	/**
+	 * @brief Split the string into a list of lines.
+	 *
+	 * @tparam E The encoding of the string.
+	 * @param keepends When true, the line separator characters at the end of the line are part of the result
+	 */
+	template<Encoding E = default_encoding__>
+	auto splitlines(bool keepends = false) const -> std::vector<better_string>
+		{return algorithm::string::splitlines<decltype(*this), Traits, E, std::vector<better_string>>(*this, keepends);}
+
+	/**
+	 * @brief Split the string into three parts: the part before the separator, the separator string, and the part
+	 * after. If the separator string is not found in the string, the first part is the entire string, and the other
+	 * two are empty.
+	 *
+	 * @tparam E The encoding of the string.
+	 * @param sep The separator string to use.
+	 */
+	template<Encoding E = default_encoding__>
+	auto partition(better_string_view<Char> sep) const -> std::vector<better_string>
+		{return algorithm::string::partition<decltype(*this), Traits, E, better_string_view<Char>, std::vector<better_string>>(*this, sep);}
+
+	/**
+	 * @brief Same as @ref partition, but searches for the separator in reverse order. If the separator string is not
+	 * found in the string, the last part is the entire string, and the other two are empty.
+	 *
+	 * @note Requires a reversible encoding.
+	 *
+	 * @tparam E The encoding of the string.
+	 * @param sep The separator string to use.
+	 */
+	template<Encoding E = default_encoding__>
+	auto rpartition(better_string_view<Char> sep) const -> std::vector<better_string>
+		{return algorithm::string::rpartition<decltype(*this), Traits, E, better_string_view<Char>, std::vector<better_string>>(*this, sep);}
+
+	/**
+	 * @brief A lazy view of the tokens of a shell-like command line (like Python's `shlex.split()`).
+	 *
+	 * The tokens are separated by whitespace. In POSIX mode, quotes and backslash escapes are removed: single quotes
+	 * keep everything, double quotes only remove the backslashes before `"` and `\\`. Tokens without quotes and escapes
+	 * are views of the string, the others are unescaped into a buffer of the view, which is reused by the next token.
+	 * Otherwise a token starting with a quote ends at the closing quote, and every token is a view, with its quotes.
+	 *
+	 * @param posix Removes the quotes and the escapes.
+	 * @throws std::invalid_argument When a quote is not closed, or the string ends with an escape (while iterating).
+	 */
+	auto shlex_split(bool posix = true) const -> ext::shlex_split<Char, Traits>
+		{return ext::shlex_split<Char, Traits>(*this, posix);}
+
+	// Prefix and suffix functions
+
+	/**
+	 * @brief Chesk if the string starts with @p prefix.
+	 *
+	 * @param prefix The string to compare with.
+	 */
+	auto startswith(better_string_view<Char> prefix, size_t start = 0, size_t end = base__::npos) const -> bool
+		{return algorithm::string::startswith<decltype(*this), Traits, better_string_view<Char>>(*this, prefix, start, end);}
+
+	/**
+	 * @brief Chesk if the string ends with @p suffix.
+	 *
+	 * @note Even though @ref endswith can be used without an encoding, using it
+	 * with a non-reversible one can result in partial matches.
+	 *
+	 * @param suffix The string to compare with.
+	 */
+	auto endswith(better_string_view<Char> suffix, size_t start = 0, size_t end = base__::npos) const -> bool
+		{return algorithm::string::endswith<decltype(*this), Traits, better_string_view<Char>>(*this, suffix, start, end);}
+
+	/**
+	 * @brief If the string starts with @p prefix, remove it. Otherwise return the original string.
+	 *
+	 * @param prefix The prefix to remove.
+	 */
+	auto removeprefix(better_string_view<Char> prefix) const -> better_string
+		{return algorithm::string::removeprefix<decltype(*this), Traits, better_string_view<Char>, better_string>(*this, prefix);}
+
+	/**
+	 * @brief If the string ends with @p suffix, remove it. Otherwise return the original string.
+	 *
+	 * @param suffix The suffix to remove.
+	 */
+	auto removesuffix(better_string_view<Char> suffix) const -> better_string
+		{return algorithm::string::removesuffix<decltype(*this), Traits, better_string_view<Char>, better_string>(*this, suffix);}
+
+	/**
+	 * @brief Remove the leading and trailing whitespace characters (see @ref charset::space()).
+	 *
+	 * @tparam E The encoding of the string.
+	 */
+	template<Encoding E = default_encoding__>
+	auto strip() const -> better_string
+		{return algorithm::string::strip<decltype(*this), Traits, E, const charset<E> &, better_string>(*this, impl::whitespace<E>);}
+
+	/**
+	 * @brief Remove the leading and trailing characters, that are in @p chars.
+	 *
+	 * @tparam E The encoding of the string.
+	 * @param chars The characters to remove.
+	 */
+	template<Encoding E = default_encoding__>
+	auto strip(better_string_view<Char> chars) const -> better_string
+		{return algorithm::string::strip<decltype(*this), Traits, E, better_string_view<Char>, better_string>(*this, chars);}
+
+	/// A version of @ref strip(), with a @ref charset.
+	template<Encoding E, size_t N>
+	auto strip(const charset<E, N> & chars) const -> better_string
+		{return algorithm::string::strip<decltype(*this), Traits, E, const charset<E, N> &, better_string>(*this, chars);}
+
+	/// Same as @ref strip(), but only removes the leading whitespace characters.
+	template<Encoding E = default_encoding__>
+	auto lstrip() const -> better_string
+		{return algorithm::string::lstrip<decltype(*this), Traits, E, const charset<E> &, better_string>(*this, impl::whitespace<E>);}
+
+	/// Same as @ref strip(), but only removes the leading characters.
+	template<Encoding E = default_encoding__>
+	auto lstrip(better_string_view<Char> chars) const -> better_string
+		{return algorithm::string::lstrip<decltype(*this), Traits, E, better_string_view<Char>, better_string>(*this, chars);}
+
+	/// A version of @ref lstrip(), with a @ref charset.
+	template<Encoding E, size_t N>
+	auto lstrip(const charset<E, N> & chars) const -> better_string
+		{return algorithm::string::lstrip<decltype(*this), Traits, E, const charset<E, N> &, better_string>(*this, chars);}
+
+	/// Same as @ref strip(), but only removes the trailing whitespace characters.
+	template<Encoding E = default_encoding__>
+	auto rstrip() const -> better_string
+		{return algorithm::string::rstrip<decltype(*this), Traits, E, const charset<E> &, better_string>(*this, impl::whitespace<E>);}
+
+	/// Same as @ref strip(), but only removes the trailing characters.
+	template<Encoding E = default_encoding__>
+	auto rstrip(better_string_view<Char> chars) const -> better_string
+		{return algorithm::string::rstrip<decltype(*this), Traits, E, better_string_view<Char>, better_string>(*this, chars);}
+
+	/// A version of @ref rstrip(), with a @ref charset.
+	template<Encoding E, size_t N>
+	auto rstrip(const charset<E, N> & chars) const -> better_string
+		{return algorithm::string::rstrip<decltype(*this), Traits, E, const charset<E, N> &, better_string>(*this, chars);}
+
+	// Character functions
+
+	/// Returns true, if every character in the string is an ASCII character (or the string is empty).
+	template<Encoding E = default_encoding__>
+	auto isascii() const -> bool
+		{return algorithm::string::isascii<decltype(*this), Traits, E>(*this);}
+
+	template<Encoding E = default_encoding__>
+	auto isspace() const -> bool;
+
+	template<Encoding E = default_encoding__>
+	auto isaplha() const -> bool;
+
+	template<Encoding E = default_encoding__>
+	auto isalnum() const -> bool;
+
+	template<Encoding E = default_encoding__>
+	auto isdigit() const -> bool;
+
+	template<Encoding E = default_encoding__>
+	auto isdecimal() const -> bool;
+
+	template<Encoding E = default_encoding__>
+	auto isnumeric() const -> bool;
+
+	template<Encoding E = default_encoding__>
+	auto isprintable() const -> bool;
+
+	template<Encoding E = default_encoding__>
+	auto isidentifier() const -> bool;
+
+	// Character case functions
+
+	/**
+	 * @brief Returns a copy of the string, with the letters converted to upper case.
+	 *
+	 * Only ASCII letters are converted, the other characters are copied unchanged.
+	 */
+	template<Encoding E = default_encoding__>
+	auto upper() const -> better_string
+		{return algorithm::string::upper<decltype(*this), Traits, E, better_string>(*this);}
+
+	/**
+	 * @brief Returns a copy of the string, with the letters converted to lower case.
+	 *
+	 * Only ASCII letters are converted, the other characters are copied unchanged.
+	 */
+	template<Encoding E = default_encoding__>
+	auto lower() const -> better_string
+		{return algorithm::string::lower<decltype(*this), Traits, E, better_string>(*this);}
+
+	template<Encoding E = default_encoding__>
+	auto title() const -> better_string;
+
+	template<Encoding E = default_encoding__>
+	auto isupper() const -> bool;
+
+	template<Encoding E = default_encoding__>
+	auto islower() const -> bool;
+
+	template<Encoding E = default_encoding__>
+	auto istitle() const -> bool;
+
+	template<Encoding E = default_encoding__>
+	auto capitalize() const -> better_string;
+
+	template<Encoding E = default_encoding__>
+	auto casefold() const -> better_string;
+
+	template<Encoding E = default_encoding__>
+	auto swapcase() const -> better_string;
+
+	// Transcoding functions
+
+	/**
+	 * @brief This is a version of @ref transcode(), that transcodes to one of the default encodings (usually UTF-8).
+	 * Transcoding to a default encoding is required often enough to make this shorthand usefult
+	 *
+	 * @tparam To The desired encoding of the result.
+	 * @result Returns the string, encoded with the desired encoding.
+	 */
+	template<Encoding From, typename CharTo = char>
+	auto decode(errors mode = errors::Strict) const -> rebind__<CharTo>
+	{
+		rebind__<CharTo> result;
+		algorithm::string::transcode<decltype(*this), Traits, From, decltype(result) &, std::char_traits<CharTo>, default_encoding<CharTo>::value>(*this, result, mode);
+		return result;
+	}
+
+	/**
+	 * @brief Transcodes the string into a different encoding.
+	 *
+	 * @tparam From The encoding of the source string.
+	 * @tparam To The desired encoding of the result.
+	 * @result Returns the string, encoded with the desired encoding.
+	 */
+	template<Encoding From, Encoding To, typename CharTo = typename encoding_traits<To>::char_type>
+	auto transcode(errors mode = errors::Strict) const -> rebind__<CharTo>
+	{
+		rebind__<CharTo> result;
+		algorithm::string::transcode<decltype(*this), Traits, From, decltype(result) &, std::char_traits<CharTo>, To>(*this, result, mode);
+		return result;
+	}
+
+	// Quoting functions
+
+	/**
+	 * @brief Parses a quoted string, as returned by @ref repr() or @ref ascii(), and decodes its escape sequences.
+	 *
+	 * Both quote characters (`"` and `'`) are accepted. The escape sequences are the ones written by @ref repr():
+	 * `\\`, `\'`, `\"`, `\0`, `\a`, `\b`, `\f`, `\n`, `\r`, `\t`, `\v`, `\xHH`, `\uXXXX` and `\UXXXXXXXX`.
+	 *
+	 * @param mode The handling of invalid escape sequences (and of codepoints, that cannot be encoded).
+	 * @result Returns the text between the quotes.
+	 * @throws std::invalid_argument If the string is not quoted, or in strict mode, when an escape sequence is invalid.
+	 */
+	template<Encoding E = default_encoding__>
+	auto unquote(errors mode = errors::Strict) const -> better_string
+	{
+		better_string result;
+		auto text = algorithm::string::unquote<decltype(*this), Traits, E, better_string>(*this, result, mode);
+		if (text.data() != result.data())
+			result.assign(text.data(), text.size());
+		return result;
+	}
+
+	// JSON functions
+
+	/**
+	 * @brief Escapes the string for a JSON string literal (as specified by RFC 8259, without the quotes).
+	 *
+	 * Quotes, backslashes and control characters are escaped (with the short escape sequences, where JSON has them).
+	 * With `ascii`, the non-ASCII characters are escaped too, as `\uXXXX` (or as surrogate pairs above U+FFFF).
+	 *
+	 * @param ascii Escape the non-ASCII characters too.
+	 * @param mode The handling of invalid characters.
+	 * @throws std::invalid_argument In strict mode, when the string is not valid in its encoding.
+	 */
+	template<Encoding E = default_encoding__>
+	auto json_escape(bool ascii = false, errors mode = errors::Strict) const -> better_string
+	{
+		better_string result;
+		algorithm::string::json_escape<decltype(*this), Traits, E, better_string>(*this, result, mode, ascii);
+		return result;
+	}
+
+	/// A version of @ref json_escape(), that appends to the output (reusing its capacity).
+	template<Encoding E = default_encoding__>
+	auto json_escape_into(better_string & output, bool ascii = false, errors mode = errors::Strict) const -> better_string &
+	{
+		algorithm::string::json_escape<decltype(*this), Traits, E, better_string>(*this, output, mode, ascii);
+		return output;
+	}
+
+	/**
+	 * @brief Decodes the escape sequences of a JSON string literal (as specified by RFC 8259, without the quotes).
+	 *
+	 * Surrogate pairs are combined. Lone surrogates, unknown escape sequences, and unescaped quotes and control
+	 * characters are errors.
+	 *
+	 * @param mode The handling of errors.
+	 * @throws std::invalid_argument In strict mode, when the string is not a valid JSON string.
+	 */
+	template<Encoding E = default_encoding__>
+	auto json_unescape(errors mode = errors::Strict) const -> better_string
+	{
+		better_string result;
+		algorithm::string::json_unescape<decltype(*this), Traits, E, better_string>(*this, result, mode);
+		return result;
+	}
+
+	/// A version of @ref json_unescape(), that appends to the output (reusing its capacity).
+	template<Encoding E = default_encoding__>
+	auto json_unescape_into(better_string & output, errors mode = errors::Strict) const -> better_string &
+	{
+		algorithm::string::json_unescape<decltype(*this), Traits, E, better_string>(*this, output, mode);
+		return output;
+	}
+
+	// Binary to text functions
+
+	/**
+	 * @brief Encodes the bytes of the string in base64 (as specified by RFC 4648, with padding).
+	 *
+	 * @param url Use the URL and filename safe alphabet (`-` and `_` instead of `+` and `/`).
+	 */
+	auto b64encode(bool url = false) const -> better_string
+	{
+		better_string result;
+		algorithm::string::b64encode<decltype(*this), Traits, better_string>(*this, result, url);
+		return result;
+	}
+
+	/// A version of @ref b64encode(), that appends to the output (reusing its capacity).
+	auto b64encode_into(better_string & output, bool url = false) const -> better_string &
+	{
+		algorithm::string::b64encode<decltype(*this), Traits, better_string>(*this, output, url);
+		return output;
+	}
+
+	/**
+	 * @brief Decodes base64 text (as specified by RFC 4648).
+	 *
+	 * The padding is optional, but it must be correct when present. Outside of strict mode, the characters that are not
+	 * in the alphabet (like line breaks) are skipped.
+	 *
+	 * @param url Use the URL and filename safe alphabet (`-` and `_` instead of `+` and `/`).
+	 * @param mode The handling of invalid characters (replace and ignore both skip them).
+	 * @throws std::invalid_argument In strict mode, when a character is not in the alphabet, or the padding is wrong.
+	 */
+	auto b64decode(bool url = false, errors mode = errors::Strict) const -> better_string
+	{
+		better_string result;
+		algorithm::string::b64decode<decltype(*this), Traits, better_string>(*this, result, url, mode);
+		return result;
+	}
+
+	/// A version of @ref b64decode(), that appends to the output (reusing its capacity).
+	auto b64decode_into(better_string & output, bool url = false, errors mode = errors::Strict) const -> better_string &
+	{
+		algorithm::string::b64decode<decltype(*this), Traits, better_string>(*this, output, url, mode);
+		return output;
+	}
+
+	/// Encodes the bytes of the string as lower case hexadecimal digits (two digits for each byte).
+	auto hexlify() const -> better_string
+	{
+		better_string result;
+		algorithm::string::hexlify<decltype(*this), Traits, better_string>(*this, result);
+		return result;
+	}
+
+	/// A version of @ref hexlify(), that appends to the output (reusing its capacity).
+	auto hexlify_into(better_string & output) const -> better_string &
+	{
+		algorithm::string::hexlify<decltype(*this), Traits, better_string>(*this, output);
+		return output;
+	}
+
+	/**
+	 * @brief Decodes hexadecimal digits (of either case) to bytes.
+	 *
+	 * Outside of strict mode, the characters that are not digits (like separators) are skipped.
+	 *
+	 * @param mode The handling of invalid characters (replace and ignore both skip them).
+	 * @throws std::invalid_argument In strict mode, when a character is not a digit, or the number of digits is odd.
+	 */
+	auto unhexlify(errors mode = errors::Strict) const -> better_string
+	{
+		better_string result;
+		algorithm::string::unhexlify<decltype(*this), Traits, better_string>(*this, result, mode);
+		return result;
+	}
+
+	/// A version of @ref unhexlify(), that appends to the output (reusing its capacity).
+	auto unhexlify_into(better_string & output, errors mode = errors::Strict) const -> better_string &
+	{
+		algorithm::string::unhexlify<decltype(*this), Traits, better_string>(*this, output, mode);
+		return output;
+	}
+
+	// URL functions
+
+	/**
+	 * @brief Percent encodes the bytes of the string (as specified by RFC 3986), except the safe characters.
+	 *
+	 * @param safe The characters that are not encoded (@ref url::unreserved or @ref url::path, or a custom set).
+	 * @param plus Encode spaces as `+` (as in HTML form data).
+	 */
+	auto percent_encode(const kernels::ByteSet & safe = url::unreserved, bool plus = false) const -> better_string
+	{
+		better_string result;
+		algorithm::string::percent_encode<decltype(*this), Traits, better_string>(*this, result, safe, plus);
+		return result;
+	}
+
+	/// A version of @ref percent_encode(), that appends to the output (reusing its capacity).
+	auto percent_encode_into(better_string & output, const kernels::ByteSet & safe = url::unreserved, bool plus = false) const -> better_string &
+	{
+		algorithm::string::percent_encode<decltype(*this), Traits, better_string>(*this, output, safe, plus);
+		return output;
+	}
+
+	/**
+	 * @brief Decodes the percent encoded bytes of the string.
+	 *
+	 * @param plus Decode `+` as a space (as in HTML form data).
+	 * @param mode The handling of invalid escape sequences (ignore keeps them unchanged).
+	 * @throws std::invalid_argument In strict mode, when a `%` is not followed by two hexadecimal digits.
+	 */
+	auto percent_decode(bool plus = false, errors mode = errors::Strict) const -> better_string
+	{
+		better_string result;
+		algorithm::string::percent_decode<decltype(*this), Traits, better_string>(*this, result, plus, mode);
+		return result;
+	}
+
+	/// A version of @ref percent_decode(), that appends to the output (reusing its capacity).
+	auto percent_decode_into(better_string & output, bool plus = false, errors mode = errors::Strict) const -> better_string &
+	{
+		algorithm::string::percent_decode<decltype(*this), Traits, better_string>(*this, output, plus, mode);
+		return output;
+	}
+
+	/**
+	 * @brief A lazy view of the key and value pairs of a URL query string (like `a=1&b=%20`).
+	 *
+	 * Nothing is allocated for the pairs without escapes, they are views of the string. The others are decoded (as HTML
+	 * form data, `+` is a space) into a buffer of the view, which is reused by the next pair. Empty parts are skipped,
+	 * and a pair without `=` has an empty value.
+	 *
+	 * @param mode The handling of invalid escape sequences (ignore keeps them unchanged).
+	 * @throws std::invalid_argument In strict mode, when a pair has an invalid escape sequence (while iterating).
+	 */
+	auto query_pairs(errors mode = errors::Strict) const -> ext::query_pairs<Char, Traits>
+		{return ext::query_pairs<Char, Traits>(*this, mode);}
+
+	// HTML functions
+
+	/**
+	 * @brief Escapes the special characters of HTML (`&`, `<` and `>`, and with `quote` the quotes too) in one pass.
+	 *
+	 * @param quote Escape `"` and `'` too (for attribute values).
+	 */
+	auto html_escape(bool quote = true) const -> better_string
+	{
+		better_string result;
+		algorithm::string::html_escape<decltype(*this), Traits, better_string>(*this, result, quote);
+		return result;
+	}
+
+	/// A version of @ref html_escape(), that appends to the output (reusing its capacity).
+	auto html_escape_into(better_string & output, bool quote = true) const -> better_string &
+	{
+		algorithm::string::html_escape<decltype(*this), Traits, better_string>(*this, output, quote);
+		return output;
+	}
+
+	/**
+	 * @brief Decodes the character references of HTML and XML text.
+	 *
+	 * Numeric references (`&#233;`, `&#xE9;`) are decoded with or without the semicolon, and the codepoints that are not
+	 * valid are replaced. The references to C1 controls are decoded as windows-1252 (`&#128;` is `€`), like in HTML5
+	 * and Python. Named references (the entities of HTML 4, and `&apos;`) require the semicolon. Unknown and
+	 * incomplete references are kept unchanged, like in browsers.
+	 */
+	template<Encoding E = default_encoding__>
+	auto html_unescape() const -> better_string
+	{
+		better_string result;
+		algorithm::string::html_unescape<decltype(*this), Traits, E, better_string>(*this, result);
+		return result;
+	}
+
+	/// A version of @ref html_unescape(), that appends to the output (reusing its capacity).
+	template<Encoding E = default_encoding__>
+	auto html_unescape_into(better_string & output) const -> better_string &
+	{
+		algorithm::string::html_unescape<decltype(*this), Traits, E, better_string>(*this, output);
+		return output;
+	}
+
+	// Formatting functions
+
+	/**
+	 * @brief Formats the list of values, using the string as the format template.
+	 *
+	 * @param values The list of values used during by the format sequences.
+	 */
+	template<Encoding E = default_encoding__, typename... Types>
+	auto format(Types && ... values) const -> better_string
+		{return algorithm::string::format<decltype(*this), Traits, E, better_string, const Types & ...>(*this, static_cast<const Types &>(values) ...);}
+
+	// Magic functions
+
+	/// Used by @ref str() to convert this type to a string.
+	template<typename CharTo, Encoding To>
+	static auto str__(const better_string & str) -> better_string<CharTo>
+		{return str.template transcode<default_encoding__, To, CharTo>(errors::Replace);}
+
+	/// Used by @ref repr() to create a string representation of this type.
+	template<typename CharTo, Encoding To>
+	static auto repr__(const better_string & str) -> better_string<CharTo>
+		{return algorithm::string::quote<const better_string &, Traits, default_encoding__, To, better_string<CharTo>, false>(str);}
+
+	/// Used by @ref ascii() to create a ASCII only representation of this type.
+	template<typename CharTo, Encoding To>
+	static auto ascii__(const better_string & str) -> better_string<CharTo>
+		{return algorithm::string::quote<const better_string &, Traits, default_encoding__, To, better_string<CharTo>, true>(str);}
+
+	/// Used by @ref format() to format the appearance of this type.
+	template<typename CharTo, Encoding To>
+	static auto format__(const better_string & str, impl::Specifier<CharTo, To> && spec) -> better_string<CharTo>
+		{return better_string_view<Char>::template format__<CharTo, To>(str, std::move(spec));}
+};
+
+//	------------------------------------------------------------
+//		Better string view
+//	------------------------------------------------------------
+
+template<typename Char, typename Traits>
+class better_string_view : public basic_string_view<Char, Traits>
+{
+	// Private alias
+	using base__ = basic_string_view<Char, Traits>;
+
+	// Default encoding
+	static constexpr Encoding default_encoding__ = default_encoding<Char>::value;
+
+public:
+	// Aliases
+	using errors = impl::Errors;
+
+	// Constructors
+	using base__::basic_string_view;
+	constexpr better_string_view(const Char * ptr, const Char * end)
+		: base__(ptr, end - ptr) {}
+	template<typename T, typename A>
+	constexpr better_string_view(const basic_string<Char, T, A> & str) noexcept
+		: base__(str.data(), str.size()) {}
+
+	/// @see better_string::length()
 	template<Encoding E = default_encoding__>
 	auto length() const -> size_t
-		{return encoding_traits<E>::iter(base__::data() + base__::size()) - encoding_traits<E>::iter(base__::data());}
+		{return encoding_traits<E>::iter(base__::data() + base__::size()) - encoding_traits<E>::iter(base__::data(), base__::data(), base__::data() + base__::size());}
 
-	/**
-	 * @brief A view of the <i>Unicode codepoints</i> in the string.
-	 *
-	 * Iterating over this view is the same as converting the string to UTF-32,
-	 * and iterating over that, but it converts the characters on the fly.
-	 */
+	// Alignment functions
+
+	/// @see better_string::center()
+	template<Encoding E = default_encoding__, typename Allocator = std::allocator<Char>>
+	auto center(size_t width, better_string_view fillchar = " ") const -> better_string<Char, Traits, Allocator>
+		{return algorithm::string::center<decltype(*this), Traits, E, better_string_view, better_string<Char, Traits, Allocator>>(*this, width, fillchar);}
+
+	/// @see better_string::ljust()
+	template<Encoding E = default_encoding__, typename Allocator = std::allocator<Char>>
+	auto ljust(size_t width, better_string_view fillchar = " ") const -> better_string<Char, Traits, Allocator>
+		{return algorithm::string::ljust<decltype(*this), Traits, E, better_string_view, better_string<Char, Traits, Allocator>>(*this, width, fillchar);}
+
+	/// @see better_string::rjust()
+	template<Encoding E = default_encoding__, typename Allocator = std::allocator<Char>>
+	auto rjust(size_t width, better_string_view fillchar = " ") const -> better_string<Char, Traits, Allocator>
+		{return algorithm::string::rjust<decltype(*this), Traits, E, better_string_view, better_string<Char, Traits, Allocator>>(*this, width, fillchar);}
+
+	/// @see better_string::zfill()
+	template<Encoding E = default_encoding__, typename Allocator = std::allocator<Char>>
+	auto zfill(size_t width) const -> better_string<Char, Traits, Allocator>
+		{return algorithm::string::zfill<decltype(*this), Traits, E, better_string<Char, Traits, Allocator>>(*this, width);}
+
+	// Find functions
+
+	/// @see better_string::find()
 	template<Encoding E = default_encoding__>
-	auto codepoints() const -> iterable_view<typename encoding_traits<E>::iterator>
-		{return {encoding_traits<E>::iter(base__::data()), encoding_traits<E>::iter(base__::data() + base__::size())};}
+	auto find(better_string_view str, size_t start = 0, size_t end = base__::npos) const -> size_t
+		{return algorithm::string::find<decltype(*this), Traits, E, better_string_view>(*this, str, start, end);}
 
-	// Assignment
-	using base__::operator =;
+	/// @see better_string::rfind()
+	template<Encoding E = default_encoding__>
+	auto rfind(better_string_view str, size_t start = 0, size_t end = base__::npos) const -> size_t
+		{return algorithm::string::rfind<decltype(*this), Traits, E, better_string_view>(*this, str, start, end);}
 
-	/// Assignment operator for string view
-	auto operator = (better_string_view<Char> view) -> better_string
-		{return static_cast<better_string &>(base__::assign(view.data(), view.size()));}
+	/// @see better_string::index()
+	template<Encoding E = default_encoding__>
+	auto index(better_string_view str, size_t start = 0, size_t end = base__::npos) const -> size_t
+		{return algorithm::string::index<decltype(*this), Traits, E, better_string_view>(*this, str, start, end);}
 
-	/// Move assignment operator for string
-	auto operator = (basic_string<Char, Traits, Allocator> && str) -> better_string
-		{return static_cast<better_string &>(base__::assign(std::move(str)));}
+	/// @see better_string::rindex()
+	template<Encoding E = default_encoding__>
+	auto rindex(better_string_view str, size_t start = 0, size_t end = base__::npos) const -> size_t
+		{return algorithm::string::rindex<decltype(*this), Traits, E, better_string_view>(*this, str, start, end);}
 
-	/// Copy assignment operator for strings
-	auto operator = (const basic_string<Char, Traits, Allocator> & str) -> better_string
-		{return static_cast<better_string &>(base__::assign(str));}
+	/// @see better_string::count()
+	template<Encoding E = default_encoding__>
+	auto count(better_string_view str, size_t start = 0, size_t end = base__::npos) const -> size_t
+		{return algorithm::string::count<decltype(*this), Traits, E, better_string_view>(*this, str, start, end);}
 
-	/// Copy assignment operator for strings
-	template<typename T, typename A>
-	auto operator = (const basic_string<Char, T, A> & str) -> better_string
-		{return static_cast<better_string &>(base__::assign(str.data(), str.size()));}
+	/// @see better_string::finditer()
+	template<Encoding E = default_encoding__>
+	auto finditer(better_string_view sub, bool overlapping = false) const -> ext::finditer<Char, Traits, E>
+		{return ext::finditer<Char, Traits, E>(*this, sub, overlapping);}
 
-	// Appending the string
+	/// @see better_string::find_all()
+	template<Encoding E = default_encoding__>
+	auto find_all(better_string_view sub, bool overlapping = false, size_t threads = 1) const -> std::vector<size_t>
+		{return algorithm::string::find_all<decltype(*this), Traits, E, better_string_view>(*this, sub, overlapping, threads);}
+
+	// The substring and character searches of the base class
+	using base__::find_first_of;
+	using base__::find_first_not_of;
+	using base__::find_last_of;
+	using base__::find_last_not_of;
+
+	/// @see better_string::find_first_of()
+	template<Encoding E, size_t N>
+	auto find_first_of(const charset<E, N> & set, size_t pos = 0) const -> size_t
+		{return algorithm::string::find_first_of<decltype(*this), Traits, E, charset<E, N>>(*this, set, pos);}
+
+	/// @see better_string::find_first_not_of()
+	template<Encoding E, size_t N>
+	auto find_first_not_of(const charset<E, N> & set, size_t pos = 0) const -> size_t
+		{return algorithm::string::find_first_not_of<decltype(*this), Traits, E, charset<E, N>>(*this, set, pos);}
+
+	/// @see better_string::find_last_of()
+	template<Encoding E, size_t N>
+	auto find_last_of(const charset<E, N> & set, size_t pos = base__::npos) const -> size_t
+		{return algorithm::string::find_last_of<decltype(*this), Traits, E, charset<E, N>>(*this, set, pos);}
+
+	/// @see better_string::find_last_not_of()
+	template<Encoding E, size_t N>
+	auto find_last_not_of(const charset<E, N> & set, size_t pos = base__::npos) const -> size_t
+		{return algorithm::string::find_last_not_of<decltype(*this), Traits, E, charset<E, N>>(*this, set, pos);}
+
+	/// @see better_string::span()
+	template<Encoding E, size_t N>
+	auto span(const charset<E, N> & set, size_t pos = 0) const -> size_t
+		{return algorithm::string::span<decltype(*this), Traits, E, charset<E, N>>(*this, set, pos);}
+
+	/// @see better_string::cspan()
+	template<Encoding E, size_t N>
+	auto cspan(const charset<E, N> & set, size_t pos = 0) const -> size_t
+		{return algorithm::string::cspan<decltype(*this), Traits, E, charset<E, N>>(*this, set, pos);}
+
+	/// @see better_string::levenshtein()
+	template<Encoding E = default_encoding__>
+	auto levenshtein(better_string_view other, size_t max = base__::npos) const -> size_t
+		{return algorithm::string::levenshtein<decltype(*this), Traits, E, better_string_view>(*this, other, max);}
 
-	/**
-	 * @brief Encode a Unicode codepoint, and append it to the string.
-	 *
-	 * @tparam E The encoding of the string.
-	 * @param codepoint The codepoint to append.
-	 */
+	/// @see better_string::damerau()
 	template<Encoding E = default_encoding__>
-	auto append(uint32_t codepoint) -> better_string &
-		{encoding_traits<E>::append(*this, codepoint); return * this;}
+	auto damerau(better_string_view other, size_t max = base__::npos) const -> size_t
+		{return algorithm::string::damerau<decltype(*this), Traits, E, better_string_view>(*this, other, max);}
 
-	// Extending the string
+	/// @see better_string::fuzzy_find()
+	template<Encoding E = default_encoding__>
+	auto fuzzy_find(better_string_view pattern, size_t k) const -> size_t
+		{size_t length; return algorithm::string::fuzzy_find<decltype(*this), Traits, E, better_string_view>(*this, pattern, k, length);}
 
-	/**
-	 * @brief Extend the string with an other string.
-	 *
-	 * @note Previously called "append" in the @ref std::basic_string.
-	 * @param str The string to append.
-	 */
-	auto extend(better_string_view<Char> str) -> better_string &
-		{return static_cast<better_string &>(base__::append(str.data(), str.size()));}
+	/// @see better_string::fuzzy_find()
+	template<Encoding E = default_encoding__>
+	auto fuzzy_find(better_string_view pattern, size_t k, size_t & length) const -> size_t
+		{return algorithm::string::fuzzy_find<decltype(*this), Traits, E, better_string_view>(*this, pattern, k, length);}
+
+	// Replace functions
+
+	/// @see better_string::replace()
+	template<Encoding E = default_encoding__, typename Allocator = std::allocator<Char>>
+	auto replace(better_string_view old, better_string_view str, size_t count = base__::npos) const -> better_string<Char, Traits, Allocator>
+		{return algorithm::string::replace<decltype(*this), Traits, E, better_string_view, better_string_view, better_string<Char, Traits, Allocator>>(*this, old, str, count);}
+
+	/// @see better_string::translate()
+	template<Encoding E = default_encoding__, typename Function, typename Allocator = std::allocator<Char>>
+	auto translate(Function && table, errors mode = errors::Replace) const -> better_string<Char, Traits, Allocator>
+		{return algorithm::string::translate<decltype(*this), Traits, E, Function &&, better_string<Char, Traits, Allocator>>(*this, static_cast<Function &&>(table), mode);}
+
+	/// @see better_string::maketrans()
+	template<Encoding E = default_encoding__>
+	static auto maketrans(better_string_view from, better_string_view to, better_string_view skip = "") -> impl::Translation
+		{return impl::Translation::create<E>(from, to, skip);}
+
+	/// @see better_string::expandtabs()
+	template<Encoding E = default_encoding__, typename Allocator = std::allocator<Char>>
+	auto expandtabs(size_t tabsize = 4) const -> better_string<Char, Traits, Allocator>
+		{return algorithm::string::expandtabs<decltype(*this), Traits, E, better_string<Char, Traits, Allocator>>(*this, tabsize);}
+
+	// Split and join functions
+
+	/// @see better_string::join()
+	template<typename Iterable, typename Allocator = std::allocator<Char>>
+	auto join(const Iterable & iterable) const -> better_string<Char, Traits, Allocator>
+		{return algorithm::string::join<decltype(*this), Traits, const Iterable &, better_string<Char, Traits, Allocator>>(*this, iterable);}
+
+	/// @see better_string::split() - The parts are views of this string, only the list is allocated.
+	template<Encoding E = default_encoding__>
+	auto split(size_t maxsplit = -1) const -> std::vector<better_string_view>
+		{return algorithm::string::split<decltype(*this), Traits, E, std::vector<better_string_view>>(*this, maxsplit);}
+
+	/// @see better_string::split() - The parts are views of this string, only the list is allocated.
+	template<Encoding E = default_encoding__>
+	auto split(better_string_view sep, size_t maxsplit = -1) const -> std::vector<better_string_view>
+		{return algorithm::string::split<decltype(*this), Traits, E, better_string_view, std::vector<better_string_view>>(*this, sep, maxsplit);}
+
+	/// @see better_string::split_any() - The parts are views of this string, only the list is allocated.
+	template<Encoding E = default_encoding__>
+	auto split_any(better_string_view seps, size_t maxsplit = -1) const -> std::vector<better_string_view>
+		{return algorithm::string::split_any<decltype(*this), Traits, E, better_string_view, std::vector<better_string_view>>(*this, seps, maxsplit);}
+
+	/// @see better_string::split_any() - The parts are views of this string, only the list is allocated.
+	template<Encoding E, size_t N>
+	auto split_any(const charset<E, N> & seps, size_t maxsplit = -1) const -> std::vector<better_string_view>
+		{return algorithm::string::split_any<decltype(*this), Traits, E, const charset<E, N> &, std::vector<better_string_view>>(*this, seps, maxsplit);}
+
+	/// @see better_string::rsplit() - The parts are views of this string, only the list is allocated.
+	template<Encoding E = default_encoding__>
+	auto rsplit(size_t maxsplit = -1) const -> std::vector<better_string_view>
+		{return algorithm::string::rsplit<decltype(*this), Traits, E, std::vector<better_string_view>>(*this, maxsplit);}
+
+	/// @see better_string::rsplit() - The parts are views of this string, only the list is allocated.
+	template<Encoding E = default_encoding__>
+	auto rsplit(better_string_view sep, size_t maxsplit = -1) const -> std::vector<better_string_view>
+		{return algorithm::string::rsplit<decltype(*this), Traits, E, better_string_view, std::vector<better_string_view>>(*this, sep, maxsplit);}
+
+	/// @see better_string::splitlines() - The lines are views of this string, only the list is allocated.
+	template<Encoding E = default_encoding__>
+	auto splitlines(bool keepends = false) const -> std::vector<better_string_view>
+		{return algorithm::string::splitlines<decltype(*this), Traits, E, std::vector<better_string_view>>(*this, keepends);}
+
+	/// @see better_string::partition() - The parts are views of this string, only the list is allocated.
+	template<Encoding E = default_encoding__>
+	auto partition(better_string_view sep) const -> std::vector<better_string_view>
+		{return algorithm::string::partition<decltype(*this), Traits, E, better_string_view, std::vector<better_string_view>>(*this, sep);}
+
+	/// @see better_string::rpartition() - The parts are views of this string, only the list is allocated.
+	template<Encoding E = default_encoding__>
+	auto rpartition(better_string_view sep) const -> std::vector<better_string_view>
+		{return algorithm::string::rpartition<decltype(*this), Traits, E, better_string_view, std::vector<better_string_view>>(*this, sep);}
+
+	/// @see better_string::shlex_split()
+	auto shlex_split(bool posix = true) const -> ext::shlex_split<Char, Traits>
+		{return ext::shlex_split<Char, Traits>(*this, posix);}
+
+	// Prefix and suffix functions
+
+	/// @see better_string::startswith()
+	auto startswith(better_string_view prefix, size_t start = 0, size_t end = base__::npos) const -> bool
+		{return algorithm::string::startswith<decltype(*this), Traits, better_string_view>(*this, prefix, start, end);}
+
+	/// @see better_string::endswith()
+	auto endswith(better_string_view suffix, size_t start = 0, size_t end = base__::npos) const -> bool
+		{return algorithm::string::endswith<decltype(*this), Traits, better_string_view>(*this, suffix, start, end);}
+
+	/// @see better_string::removeprefix() - Returns a view of this string, without allocating.
+	auto removeprefix(better_string_view prefix) const -> better_string_view
+		{return algorithm::string::removeprefix<decltype(*this), Traits, better_string_view, better_string_view>(*this, prefix);}
+
+	/// @see better_string::removesuffix() - Returns a view of this string, without allocating.
+	auto removesuffix(better_string_view suffix) const -> better_string_view
+		{return algorithm::string::removesuffix<decltype(*this), Traits, better_string_view, better_string_view>(*this, suffix);}
+
+	/// @see better_string::strip() - Returns a view of this string, without allocating.
+	template<Encoding E = default_encoding__>
+	auto strip() const -> better_string_view
+		{return algorithm::string::strip<decltype(*this), Traits, E, const charset<E> &, better_string_view>(*this, impl::whitespace<E>);}
+
+	/// @see better_string::strip() - Returns a view of this string, without allocating.
+	template<Encoding E = default_encoding__>
+	auto strip(better_string_view chars) const -> better_string_view
+		{return algorithm::string::strip<decltype(*this), Traits, E, better_string_view, better_string_view>(*this, chars);}
+
+	/// @see better_string::strip() - Returns a view of this string, without allocating.
+	template<Encoding E, size_t N>
+	auto strip(const charset<E, N> & chars) const -> better_string_view
+		{return algorithm::string::strip<decltype(*this), Traits, E, const charset<E, N> &, better_string_view>(*this, chars);}
+
+	/// @see better_string::lstrip() - Returns a view of this string, without allocating.
+	template<Encoding E = default_encoding__>
+	auto lstrip() const -> better_string_view
+		{return algorithm::string::lstrip<decltype(*this), Traits, E, const charset<E> &, better_string_view>(*this, impl::whitespace<E>);}
+
+	/// @see better_string::lstrip() - Returns a view of this string, without allocating.
+	template<Encoding E = default_encoding__>
+	auto lstrip(better_string_view chars) const -> better_string_view
+		{return algorithm::string::lstrip<decltype(*this), Traits, E, better_string_view, better_string_view>(*this, chars);}
+
+	/// @see better_string::lstrip() - Returns a view of this string, without allocating.
+	template<Encoding E, size_t N>
+	auto lstrip(const charset<E, N> & chars) const -> better_string_view
+		{return algorithm::string::lstrip<decltype(*this), Traits, E, const charset<E, N> &, better_string_view>(*this, chars);}
+
+	/// @see better_string::rstrip() - Returns a view of this string, without allocating.
+	template<Encoding E = default_encoding__>
+	auto rstrip() const -> better_string_view
+		{return algorithm::string::rstrip<decltype(*this), Traits, E, const charset<E> &, better_string_view>(*this, impl::whitespace<E>);}
+
+	/// @see better_string::rstrip() - Returns a view of this string, without allocating.
+	template<Encoding E = default_encoding__>
+	auto rstrip(better_string_view chars) const -> better_string_view
+		{return algorithm::string::rstrip<decltype(*this), Traits, E, better_string_view, better_string_view>(*this, chars);}
+
+	/// @see better_string::rstrip() - Returns a view of this string, without allocating.
+	template<Encoding E, size_t N>
+	auto rstrip(const charset<E, N> & chars) const -> better_string_view
+		{return algorithm::string::rstrip<decltype(*this), Traits, E, const charset<E, N> &, better_string_view>(*this, chars);}
+
+	// Character functions
+
+	/// @see better_string::isascii()
+	template<Encoding E = default_encoding__>
+	auto isascii() const -> bool
+		{return algorithm::string::isascii<decltype(*this), Traits, E>(*this);}
+
+	template<Encoding E = default_encoding__>
+	auto isspace() const -> bool;
+
+	template<Encoding E = default_encoding__>
+	auto isaplha() const -> bool;
+
+	template<Encoding E = default_encoding__>
+	auto isalnum() const -> bool;
+
+	template<Encoding E = default_encoding__>
+	auto isdigit() const -> bool;
+
+	template<Encoding E = default_encoding__>
+	auto isdecimal() const -> bool;
+
+	template<Encoding E = default_encoding__>
+	auto isnumeric() const -> bool;
+
+	template<Encoding E = default_encoding__>
+	auto isprintable() const -> bool;
+
+	template<Encoding E = default_encoding__>
+	auto isidentifier() const -> bool;
+
+	// Character case functions
+
+	/// @see better_string::upper()
+	template<Encoding E = default_encoding__, typename Allocator = std::allocator<Char>>
+	auto upper() const -> better_string<Char, Traits, Allocator>
+		{return algorithm::string::upper<decltype(*this), Traits, E, better_string<Char, Traits, Allocator>>(*this);}
+
+	/// @see better_string::lower()
+	template<Encoding E = default_encoding__, typename Allocator = std::allocator<Char>>
+	auto lower() const -> better_string<Char, Traits, Allocator>
+		{return algorithm::string::lower<decltype(*this), Traits, E, better_string<Char, Traits, Allocator>>(*this);}
+
+	/// @see better_string::title()
+	template<Encoding E = default_encoding__, typename Allocator = std::allocator<Char>>
+	auto title() const -> better_string<Char, Traits, Allocator>;
+
+	/// @see better_string::isupper()
+	template<Encoding E = default_encoding__>
+	auto isupper() const -> bool;
+
+	/// @see better_string::islower()
+	template<Encoding E = default_encoding__>
+	auto islower() const -> bool;
+
+	/// @see better_string::istitle()
+	template<Encoding E = default_encoding__>
+	auto istitle() const -> bool;
+
+	/// @see better_string::capitalize()
+	template<Encoding E = default_encoding__, typename Allocator = std::allocator<Char>>
+	auto capitalize() const -> better_string<Char, Traits, Allocator>;
+
+	/// @see better_string::casefold()
+	template<Encoding E = default_encoding__, typename Allocator = std::allocator<Char>>
+	auto casefold() const -> better_string<Char, Traits, Allocator>;
+
+	/// @see better_string::swapcase()
+	template<Encoding E = default_encoding__, typename Allocator = std::allocator<Char>>
+	auto swapcase() const -> better_string<Char, Traits, Allocator>;
+
+	// Transcoding functions
+
+	/// @see better_string::decode()
+	template<Encoding From, typename CharTo = char, typename Allocator = std::allocator<CharTo>>
+	auto decode(errors mode = errors::Strict) const -> better_string<CharTo, std::char_traits<CharTo>, Allocator>
+	{
+		better_string<CharTo, std::char_traits<CharTo>, Allocator> result;
+		algorithm::string::transcode<decltype(*this), Traits, From, decltype(result) &, std::char_traits<CharTo>, default_encoding<CharTo>::value>(*this, result, mode);
+		return result;
+	}
+
+	/// @see better_string::format()
+	template<Encoding From, Encoding To, typename CharTo = typename encoding_traits<To>::char_type, typename Allocator = std::allocator<CharTo>>
+	auto transcode(errors mode = errors::Strict) const -> better_string<CharTo, std::char_traits<CharTo>, Allocator>
+	{
+		better_string<CharTo, std::char_traits<CharTo>, Allocator> result;
+		algorithm::string::transcode<decltype(*this), Traits, From, decltype(result) &, std::char_traits<CharTo>, To>(*this, result, mode);
+		return result;
+	}
 
-	/**
-	 * @brief Extend the string with an other string.
-	 *
-	 * @note Previously called "append" in the @ref std::basic_string
-	 * @param str The string to append.
-	 */
-	auto extend(const basic_string<Char, Traits, Allocator> & str) -> better_string &
-		{return static_cast<better_string &>(base__::append(str));}
+	// Quoting functions
 
-	/**
-	 * @brief Extend the string with a raw C string.
-	 *
-	 * @note Previously called "append" in the @ref std::basic_string
-	 *
-	 * @param data The start of the string.
-	 * @param size The size of the string.
-	 */
-	auto extend(const char * data, size_t size) -> better_string &
-		{return static_cast<better_string &>(base__::append(data, size));}
+	/// @see better_string::unquote()
+	template<Encoding E = default_encoding__, typename Allocator = std::allocator<Char>>
+	auto unquote(errors mode = errors::Strict) const -> better_string<Char, Traits, Allocator>
+	{
+		better_string<Char, Traits, Allocator> result;
+		auto text = algorithm::string::unquote<better_string_view, Traits, E, decltype(result)>(*this, result, mode);
+		if (text.data() != result.data())
+			result.assign(text.data(), text.size());
+		return result;
+	}
 
 	/**
-	 * @brief Extend the string with raw C string.
-	 *
-	 * @note Previously called "append" in the @ref std::basic_string
+	 * @brief A version of @ref better_string::unquote(), that only copies the text when it has escape sequences.
 	 *
-	 * @param start The start of the string.
-	 * @param end The end of the string (exclusive).
+	 * @param buffer The storage of the decoded text (only used when the text has escape sequences).
+	 * @param mode The handling of invalid escape sequences.
+	 * @result Returns a view of the text between the quotes, or of the buffer.
 	 */
-	auto extend(const char * start, const char * end) -> better_string &
-		{return static_cast<better_string &>(base__::append(start, end - start));}
+	template<Encoding E = default_encoding__, typename Allocator>
+	auto unquote(better_string<Char, Traits, Allocator> & buffer, errors mode = errors::Strict) const -> better_string_view
+		{return algorithm::string::unquote<better_string_view, Traits, E, better_string<Char, Traits, Allocator>>(*this, buffer, mode);}
 
-	/// Operator to extend the string with a string view.
-	auto operator += (better_string_view<Char> view) -> better_string
-		{return static_cast<better_string &>(base__::append(view.data(), view.size()));}
+	// JSON functions
 
-	/// Operator to extend the string with an other string.
-	auto operator += (const basic_string<Char, Traits, Allocator> & str) -> better_string
-		{return static_cast<better_string &>(base__::append(str));}
+	/// @see better_string::json_escape()
+	template<Encoding E = default_encoding__, typename Allocator = std::allocator<Char>>
+	auto json_escape(bool ascii = false, errors mode = errors::Strict) const -> better_string<Char, Traits, Allocator>
+	{
+		better_string<Char, Traits, Allocator> result;
+		algorithm::string::json_escape<better_string_view, Traits, E, decltype(result)>(*this, result, mode, ascii);
+		return result;
+	}
 
-	// Alignment functions
+	/// @see better_string::json_escape_into()
+	template<Encoding E = default_encoding__, typename Allocator>
+	auto json_escape_into(better_string<Char, Traits, Allocator> & output, bool ascii = false, errors mode = errors::Strict) const
+		-> better_string<Char, Traits, Allocator> &
+	{
+		algorithm::string::json_escape<better_string_view, Traits, E, better_string<Char, Traits, Allocator>>(*this, output, mode, ascii);
+		return output;
+	}
 
-	/**
-	 * @brief Pad the the string to the specified width, while also centering it.
-	 *
-	 * @tparam E The encoding of the string.
-	 * @param width The desired length of the new string.
-	 * @param fillchar The fill character used for padding the string. Defaults to the space character(0x20).
-	 */
-	template<Encoding E = default_encoding__>
-	auto center(size_t width, better_string_view<Char> fillchar = string_literal<Char, ' '>()) const -> better_string
-		{return algorithm::string::center<decltype(*this), Traits, E, better_string_view<Char>, better_string>(*this, width, fillchar);}
+	/// @see better_string::json_unescape()
+	template<Encoding E = default_encoding__, typename Allocator = std::allocator<Char>>
+	auto json_unescape(errors mode = errors::Strict) const -> better_string<Char, Traits, Allocator>
+	{
+		better_string<Char, Traits, Allocator> result;
+		algorithm::string::json_unescape<better_string_view, Traits, E, decltype(result)>(*this, result, mode);
+		return result;
+	}
 
-	/**
-	 * @brief Pad the the string to the specified width, while aligning it to the left.
-	 *
-	 * @tparam E The encoding of the string.
-	 * @param width The desired length of the new string.
-	 * @param fillchar The fill character used for padding the string. Defaults to the space character(0x20).
-	 */
-	template<Encoding E = default_encoding__>
-	auto ljust(size_t width, better_string_view<Char> fillchar = string_literal<Char, ' '>()) const -> better_string
-		{return algorithm::string::ljust<decltype(*this), Traits, E, better_string_view<Char>, better_string>(*this, width, fillchar);}
+	/// @see better_string::json_unescape_into()
+	template<Encoding E = default_encoding__, typename Allocator>
+	auto json_unescape_into(better_string<Char, Traits, Allocator> & output, errors mode = errors::Strict) const
+		-> better_string<Char, Traits, Allocator> &
+	{
+		algorithm::string::json_unescape<better_string_view, Traits, E, better_string<Char, Traits, Allocator>>(*this, output, mode);
+		return output;
+	}
 
-	/**
-	 * @brief Pad the the string to the specified width, while aligning it to the right.
-	 *
-	 * @tparam E The encoding of the string.
-	 * @param width The desired length of the new string.
-	 * @param fillchar The fill character used for padding the string. Defaults to the space character(0x20).
-	 */
-	template<Encoding E = default_encoding__>
-	auto rjust(size_t width, better_string_view<Char> fillchar = string_literal<Char, ' '>()) const -> better_string
-		{return algorithm::string::rjust<decltype(*this), Traits, E, better_string_view<Char>, better_string>(*this, width, fillchar);}
+	// Binary to text functions
 
-	/**
-	 * @brief Pad the the string to the specified width with zeros, while aligning it to the right. If the first
-	 * character is a sign (+/-), it is left alone.
-	 *
-	 * @param width The desired length of the new string.
-	 */
-	template<Encoding E = default_encoding__>
-	auto zfill(size_t width) const -> better_string
-		{return algorithm::string::zfill<decltype(*this), Traits, E, better_string>(*this, width);}
+	/// @see better_string::b64encode()
+	template<typename Allocator = std::allocator<Char>>
+	auto b64encode(bool url = false) const -> better_string<Char, Traits, Allocator>
+	{
+		better_string<Char, Traits, Allocator> result;
+		algorithm::string::b64encode<better_string_view, Traits, decltype(result)>(*this, result, url);
+		return result;
+	}
 
-	// Search functions
+	/// @see better_string::b64encode_into()
+	template<typename Allocator>
+	auto b64encode_into(better_string<Char, Traits, Allocator> & output, bool url = false) const -> better_string<Char, Traits, Allocator> &
+	{
+		algorithm::string::b64encode<better_string_view, Traits, better_string<Char, Traits, Allocator>>(*this, output, url);
+		return output;
+	}
 
-	/**
-	 * @brief Find the first occurrence of a substring and return its position.
-	 * If the string is not found @ref npos is returned.
-	 *
-	 * @tparam E The encoding of the string.
-	 * @param str The substring to find.
-	 */
-	template<Encoding E = default_encoding__>
-	auto find(better_string_view<Char> str, size_t start = 0, size_t end = base__::npos) const -> size_t
-		{return algorithm::string::find<decltype(*this), Traits, E, better_string_view<Char>>(*this, str, start, end);}
+	/// @see better_string::b64decode()
+	template<typename Allocator = std::allocator<Char>>
+	auto b64decode(bool url = false, errors mode = errors::Strict) const -> better_string<Char, Traits, Allocator>
+	{
+		better_string<Char, Traits, Allocator> result;
+		algorithm::string::b64decode<better_string_view, Traits, decltype(result)>(*this, result, url, mode);
+		return result;
+	}
 
-	/**
-	 * @brief Find the last occurrence of a substring and return its position.
-	 * If the string is not found @ref npos is returned.
-	 *
-	 * @tparam E The encoding of the string.
-	 * @param str The substring to find.
-	 */
-	template<Encoding E = default_encoding__>
-	auto rfind(better_string_view<Char> str, size_t start = 0, size_t end = base__::npos) const -> size_t
-		{return algorithm::string::rfind<decltype(*this), Traits, E, better_string_view<Char>>(*this, str, start, end);}
+	/// @see better_string::b64decode_into()
+	template<typename Allocator>
+	auto b64decode_into(better_string<Char, Traits, Allocator> & output, bool url = false, errors mode = errors::Strict) const
+		-> better_string<Char, Traits, Allocator> &
+	{
+		algorithm::string::b64decode<better_string_view, Traits, better_string<Char, Traits, Allocator>>(*this, output, url, mode);
+		return output;
+	}
 
-	/**
-	 * @brief Find the first occurrence of a substring and return its position.
-	 * If the string is not found std::invalid_argument is thrown.
-	 *
-	 * @tparam E The encoding of the string.
-	 * @param str The substring to find.
-	 */
-	template<Encoding E = default_encoding__>
-	auto index(better_string_view<Char> str, size_t start = 0, size_t end = base__::npos) const -> size_t
-		{return algorithm::string::index<decltype(*this), Traits, E, better_string_view<Char>>(*this, str, start, end);}
+	/// @see better_string::hexlify()
+	template<typename Allocator = std::allocator<Char>>
+	auto hexlify() const -> better_string<Char, Traits, Allocator>
+	{
+		better_string<Char, Traits, Allocator> result;
+		algorithm::string::hexlify<better_string_view, Traits, decltype(result)>(*this, result);
+		return result;
+	}
 
-	/**
-	 * @brief Find the last occurrence of a substring and returns its position.
-	 * If the string is not found std::invalid_argument is thrown.
-	 *
-	 * @tparam E The encoding of the string.
-	 * @param str The substring to find.
-	 */
-	template<Encoding E = default_encoding__>
-	auto rindex(better_string_view<Char> str, size_t start = 0, size_t end = base__::npos) const -> size_t
-		{return algorithm::string::rindex<decltype(*this), Traits, E, better_string_view<Char>>(*this, str, start, end);}
+	/// @see better_string::hexlify_into()
+	template<typename Allocator>
+	auto hexlify_into(better_string<Char, Traits, Allocator> & output) const -> better_string<Char, Traits, Allocator> &
+	{
+		algorithm::string::hexlify<better_string_view, Traits, better_string<Char, Traits, Allocator>>(*this, output);
+		return output;
+	}
 
-	/**
-	 * @brief Count the number of non-overlapping occurrences of a substring.
-	 *
-	 * @tparam E The encoding of the string.
-	 * @param str The substring to find.
-	 */
-	template<Encoding E = default_encoding__>
-	auto count(better_string_view<Char> str, size_t start = 0, size_t end = base__::npos) const -> size_t
-		{return algorithm::string::count<decltype(*this), Traits, E, better_string_view<Char>>(*this, str, start, end);}
+	/// @see better_string::unhexlify()
+	template<typename Allocator = std::allocator<Char>>
+	auto unhexlify(errors mode = errors::Strict) const -> better_string<Char, Traits, Allocator>
+	{
+		better_string<Char, Traits, Allocator> result;
+		algorithm::string::unhexlify<better_string_view, Traits, decltype(result)>(*this, result, mode);
+		return result;
+	}
 
-	// Replace functions
+	/// @see better_string::unhexlify_into()
+	template<typename Allocator>
+	auto unhexlify_into(better_string<Char, Traits, Allocator> & output, errors mode = errors::Strict) const
+		-> better_string<Char, Traits, Allocator> &
+	{
+		algorithm::string::unhexlify<better_string_view, Traits, better_string<Char, Traits, Allocator>>(*this, output, mode);
+		return output;
+	}
 
-	/**
-	 * @brief Replace the first @p count number of non-overlapping occurrences of @p old with @p str.
-	 *
-	 * @tparam E The encoding of the string.
-	 * @param old The substring to replace.
-	 * @param str The substring to replace it with.
-	 * @param count The maximum number or substrings to replace.
-	 */
-	template<Encoding E = default_encoding__>
-	auto replace(better_string_view<Char> old, better_string_view<Char> str, size_t count = base__::npos) const -> better_string
-		{return algorithm::string::replace<decltype(*this), Traits, E, better_string_view<Char>, better_string_view<Char>, better_string>(*this, old, str, count);}
+	// URL functions
 
-	/**
-	 * @brief Replace every character in a string, using a translation table. The translation table is usually
-	 * obtained from from the @ref maketrans function.
-	 *
-	 * The translation table is a function (or function like object), that takes a unicode codepoint, and returns its
-	 * replacement, or -1 to remove the character without replacing it.
-	 *
-	 * @note In Python the translate method uses a dictionary instead of a function.
-	 *
-	 * @tparam E The encoding of the string.
-	 * @param table The translation table.
-	 */
-	template<Encoding E = default_encoding__, typename Function>
-	auto translate(Function && table, errors mode = errors::Replace) const -> better_string
-		{return algorithm::string::translate<decltype(*this), Traits, E, Function &&, better_string>(*this, static_cast<Function &&>(table), mode);}
+	/// @see better_string::percent_encode()
+	template<typename Allocator = std::allocator<Char>>
+	auto percent_encode(const kernels::ByteSet & safe = url::unreserved, bool plus = false) const -> better_string<Char, Traits, Allocator>
+	{
+		better_string<Char, Traits, Allocator> result;
+		algorithm::string::percent_encode<better_string_view, Traits, decltype(result)>(*this, result, safe, plus);
+		return result;
+	}
 
-	/**
-	 * @brief Create a translation table to be used with the @ref translate function. It takes two strings of equal
-	 * length. The characters in the first strings will be translated to the characters that have the same position in
-	 * the second string. The third string is optional, the characters in that will be removed from the string.
-	 *
-	 * @tparam E The encoding of the string.
-	 * @param from The characters to replace.
-	 * @param to The replacement characters.
-	 * @param skip The characters to remove.
-	 */
-	template<Encoding E = default_encoding__>
-	static auto maketrans(better_string_view<Char> from, better_string_view<Char> to, better_string_view<Char> skip = "") -> impl::Translation
-		{return impl::Translation(from, to, skip);}
+	/// @see better_string::percent_encode_into()
+	template<typename Allocator>
+	auto percent_encode_into(better_string<Char, Traits, Allocator> & output, const kernels::ByteSet & safe = url::unreserved, bool plus = false) const
+		-> better_string<Char, Traits, Allocator> &
+	{
+		algorithm::string::percent_encode<better_string_view, Traits, better_string<Char, Traits, Allocator>>(*this, output, safe, plus);
+		return output;
+	}
 
-	/**
-	 * @brief Convert tabs to spaces correctly. Each tab will be replaced with enough spaces to align its end with the
-	 * next tabulator position. The spacing of the tabulator positions are given by @p tabsize.
-	 *
-	 * @note In Python the default tabulator size is 8. Here, it's 4.
-	 *
-	 * @tparam E The encoding of the string.
-	 * @param from The size of the tabulator positions. Defaults to 4.
-	 */
-	template<Encoding E = default_encoding__>
-	auto expandtabs(size_t tabsize = 4) const -> better_string
-		{return algorithm::string::expandtabs<decltype(*this), Traits, E, better_string>(*this, tabsize);}
+	/// @see better_string::percent_decode()
+	template<typename Allocator = std::allocator<Char>>
+	auto percent_decode(bool plus = false, errors mode = errors::Strict) const -> better_string<Char, Traits, Allocator>
+	{
+		better_string<Char, Traits, Allocator> result;
+		algorithm::string::percent_decode<better_string_view, Traits, decltype(result)>(*this, result, plus, mode);
+		return result;
+	}
 
-	// Split and join functions
+	/// @see better_string::percent_decode_into()
+	template<typename Allocator>
+	auto percent_decode_into(better_string<Char, Traits, Allocator> & output, bool plus = false, errors mode = errors::Strict) const
+		-> better_string<Char, Traits, Allocator> &
+	{
+		algorithm::string::percent_decode<better_string_view, Traits, better_string<Char, Traits, Allocator>>(*this, output, plus, mode);
+		return output;
+	}
 
-	/**
-	 * @brief Concatenate the strings in the list, using this string as a
-	 * separator between the items.
-	 *
-	 * @param iterable The list of items to join together.
-	 */
-	template<typename Iterable>
-	auto join(const Iterable & iterable) const -> better_string
-		{return algorithm::string::join<decltype(*this), Traits, const Iterable &, better_string>(*this, iterable);}
+	/// @see better_string::query_pairs()
+	auto query_pairs(errors mode = errors::Strict) const -> ext::query_pairs<Char, Traits>
+		{return ext::query_pairs<Char, Traits>(*this, mode);}
 
-	/**
-	 * @brief Split the string along sequences of whitespace characters.
-	 *
-	 * @note Only the ASCII whitespace characters (space, \\t, \\v, \\n, \\r,
-	 * \\f) are recognized. Unicode whitespace characters are not.
-	 *
-	 * @tparam E The encoding of the string.
-	 * @param maxsplit The maximum number of splits to do. The default (-1) means no limit.
-	 */
-	template<Encoding E = default_encoding__>
-	auto split(size_t maxsplit = -1) const -> std::vector<better_string>
-		{return algorithm::string::split<decltype(*this), Traits, E, std::vector<better_string>>(*this, maxsplit);}
+	// HTML functions
 
-	/**
-	 * @brief Split the string along a predefined separator string.
-	 *
-	 * @tparam E The encoding of the string.
-	 * @param sep The separator string to use.
-	 * @param maxsplit The maximum number of splits to do. The default (-1) means no limit.
-	 */
-	template<Encoding E = default_encoding__>
-	auto split(better_string_view<Char> sep, size_t maxsplit = -1) const -> std::vector<better_string>
-		{return algorithm::string::split<decltype(*this), Traits, E, better_string_view<Char>, std::vector<better_string>>(*this, sep, maxsplit);}
+	/// @see better_string::html_escape()
+	template<typename Allocator = std::allocator<Char>>
+	auto html_escape(bool quote = true) const -> better_string<Char, Traits, Allocator>
+	{
+		better_string<Char, Traits, Allocator> result;
+		algorithm::string::html_escape<better_string_view, Traits, decltype(result)>(*this, result, quote);
+		return result;
+	}
+
+	/// @see better_string::html_escape_into()
+	template<typename Allocator>
+	auto html_escape_into(better_string<Char, Traits, Allocator> & output, bool quote = true) const -> better_string<Char, Traits, Allocator> &
+	{
+		algorithm::string::html_escape<better_string_view, Traits, better_string<Char, Traits, Allocator>>(*this, output, quote);
+		return output;
+	}
 
-	/**
-	 * @brief Split the string along sequences of whitespace characters.
-	 *
-	 * Same as @ref split, but searches in reverse. @p maxsplit is also counted from the back of the string.
-	 *
-	 * @note Requires a reversible encoding.
-	 *
-	 * @tparam E The encoding of the string.
-	 * @param maxsplit The maximum number of splits to do. The default (-1) means no limit.
-	 */
-	template<Encoding E = default_encoding__>
-	auto rsplit(size_t maxsplit = -1) const -> std::vector<better_string>
-		{return algorithm::string::rsplit<decltype(*this), Traits, E, std::vector<better_string>>(*this, maxsplit);}
+	/// @see better_string::html_unescape()
+	template<Encoding E = default_encoding__, typename Allocator = std::allocator<Char>>
+	auto html_unescape() const -> better_string<Char, Traits, Allocator>
+	{
+		better_string<Char, Traits, Allocator> result;
+		algorithm::string::html_unescape<better_string_view, Traits, E, decltype(result)>(*this, result);
+		return result;
+	}
 
-	/**
-	 * @brief Split the string along the non-overlapping occurrences of a separator string.
-	 *
-	 * Same as @ref split, but searches in reverse. @p maxsplit is also counted from the back of the string.
-	 *
-	 * @note Requires a reversible encoding.
-	 *
-	 * @tparam E The encoding of the string.
-	 * @param sep The separator string to use.
-	 * @param maxsplit The maximum number of splits to do. The default (-1) means no limit.
-	 */
-	template<Encoding E = default_encoding__>
-	auto rsplit(better_string_view<Char> sep, size_t maxsplit = -1) const -> std::vector<better_string>
-		{return algorithm::string::rsplit<decltype(*this), Traits, E, better_string_view<Char>, std::vector<better_string>>(*this, sep, maxsplit);}
+	/// @see better_string::html_unescape_into()
+	template<Encoding E = default_encoding__, typename Allocator>
+	auto html_unescape_into(better_string<Char, Traits, Allocator> & output) const -> better_string<Char, Traits, Allocator> &
+	{
+		algorithm::string::html_unescape<better_string_view, Traits, E, better_string<Char, Traits, Allocator>>(*this, output);
+		return output;
+	}
 
-	/**
-	 * @brief Split the string into a list of lines.
-	 *
-	 * @tparam E The encoding of the string.
-	 * @param keepends When true, the line separator characters at the end of the line are part of the result
-	 */
-	template<Encoding E = default_encoding__>
-	auto splitlines(bool keepends = false) const -> std::vector<better_string>;
+	// Formatting functions
 
-	/**
-	 * @brief Split the string into three parts: the part before the separator, the separator string, and the part
-	 * after. If the separator string is not found in the string, the first part is the entire string, and the other
-	 * two are empty.
-	 *
-	 * @tparam E The encoding of the string.
-	 * @param sep The separator string to use.
-	 */
-	template<Encoding E = default_encoding__>
-	auto partition(better_string_view<Char> sep) const -> std::vector<better_string>;
+	/// @see better_string::format()
+	template<Encoding E = default_encoding__, typename Allocator = std::allocator<Char>, typename... Types>
+	auto format(Types && ... values) const -> better_string<Char, Traits, Allocator>
+		{return algorithm::string::format<decltype(*this), Traits, E, better_string<Char, Traits, Allocator>, const Types & ...>(*this, static_cast<const Types &>(values) ...);}
 
-	/**
-	 * @brief Same as @ref partition, but searches for the separator in reverse order.
-	 *
-	 * @tparam E The encoding of the string.
-	 * @param sep The separator string to use.
-	 */
-	template<Encoding E = default_encoding__>
-	auto rpartition(better_string_view<Char> sep) const -> std::vector<better_string>;
+	// Magic functions
 
-	// Prefix and suffix functions
+	/// Used by @ref str() to convert this type to a string.
+	template<typename CharTo, Encoding To>
+	static auto str__(better_string_view str) -> better_string<CharTo>
+		{return str.transcode<default_encoding__, To, CharTo>(errors::Replace);}
 
-	/**
-	 * @brief Chesk if the string starts with @p prefix.
-	 *
-	 * @param prefix The string to compare with.
-	 */
-	auto startswith(better_string_view<Char> prefix, size_t start = 0, size_t end = base__::npos) const -> bool
-		{return algorithm::string::startswith<decltype(*this), Traits, better_string_view<Char>>(*this, prefix, start, end);}
+	/// Used by @ref repr() to create a string representation of this type.
+	template<typename CharTo, Encoding To>
+	static auto repr__(better_string_view str) -> better_string<CharTo>
+		{return algorithm::string::quote<better_string_view, Traits, default_encoding__, To, better_string<CharTo>, false>(str);}
 
-	/**
-	 * @brief Chesk if the string ends with @p suffix.
-	 *
-	 * @note Even though @ref endswith can be used without an encoding, using it
-	 * with a non-reversible one can result in partial matches.
-	 *
-	 * @param suffix The string to compare with.
-	 */
-	auto endswith(better_string_view<Char> suffix, size_t start = 0, size_t end = base__::npos) const -> bool
-		{return algorithm::string::endswith<decltype(*this), Traits, better_string_view<Char>>(*this, suffix, start, end);}
+	/// Used by @ref ascii() to create a ASCII only representation of this type.
+	template<typename CharTo, Encoding To>
+	static auto ascii__(better_string_view str) -> better_string<CharTo>
+		{return algorithm::string::quote<better_string_view, Traits, default_encoding__, To, better_string<CharTo>, true>(str);}
 
-	/**
-	 * @brief If the string starts with @p prefix, remove it. Otherwise return the original string.
-	 *
-	 * @param prefix The prefix to remove.
-	 */
-	auto removeprefix(better_string_view<Char> prefix) const -> better_string
-		{return algorithm::string::removeprefix<decltype(*this), Traits, better_string_view<Char>, better_string>(*this, prefix);}
+	/// Used by @ref format() to format the appearance of this type.
+	template<typename CharTo, Encoding To>
+	static auto format__(better_string_view str, impl::Specifier<CharTo, To> && spec) -> better_string<CharTo>
+	{
+		// Transcode string (truncated first, so only the characters kept are copied)
+		if (spec.precision != size_t(-1))
+			str = algorithm::string::truncate<better_string_view, Traits, default_encoding__, better_string_view>(str, spec.precision);
+		auto result = str.transcode<default_encoding__, To, CharTo>(errors::Replace);
 
-	/**
-	 * @brief If the string ends with @p suffix, remove it. Otherwise return the original string.
-	 *
-	 * @param suffix The suffix to remove.
-	 */
-	auto removesuffix(better_string_view<Char> suffix) const -> better_string
-		{return algorithm::string::removesuffix<decltype(*this), Traits, better_string_view<Char>, better_string>(*this, suffix);}
+		// Process format specification
+		if (spec.type && spec.type != 's')
+			throw std::invalid_argument("string::format__(): spec: Invalid format code!");
+		if (spec.sign)
+			throw std::invalid_argument("string::format__(): spec: Sign is not allowed!");
+		if (spec.align == '=')
+			throw std::invalid_argument("string::format__(): spec: Numeric alignment (=) is not allowed!");
+		if (spec.alter)
+			throw std::invalid_argument("string::format__(): spec: Alternate form (#) is not allowed!");
+		if (spec.comma)
+			throw std::invalid_argument("string::format__(): spec: Comma separator (,) is not allowed!");
+		if (spec.other.size())
+			throw std::invalid_argument("string::format__(): spec: Invalid format specification!");
 
-	auto strip() const -> better_string;
+		if (spec.width != size_t(-1))
+		{
+			if (spec.align == 0)
+				spec.align = '<';
+			if (spec.fill.empty())
+				spec.fill = string_literal<CharTo, ' '>();
 
-	template<Encoding E = default_encoding__>
-	auto strip(better_string_view<Char> chars) const -> better_string;
+			if (spec.align == '<')
+				result = result.template ljust<To>(spec.width, spec.fill);
+			else if (spec.align == '>')
+				result = result.template rjust<To>(spec.width, spec.fill);
+			else if (spec.align == '^')
+				result = impl::format_center<To>(result, spec.width, spec.fill);
+			else
+				throw std::invalid_argument("string::format__(): spec: Invalid alignment!");
+		}
 
-	auto lstrip() const -> better_string;
+		// Return result
+		return result;
+	}
+};
 
-	template<Encoding E = default_encoding__>
-	auto lstrip(better_string_view<Char> chars) const -> better_string;
+// Create better strings from literals
 
-	auto rstrip() const -> better_string;
+inline auto better(const char * str) -> better_string_view<char>
+	{return better_string_view<char>(str);}
 
-	template<Encoding E = default_encoding__>
-	auto rstrip(better_string_view<Char> chars) const -> better_string;
+inline auto better(const char16_t * str) -> better_string_view<char16_t>
+	{return better_string_view<char16_t>(str);}
 
-	// Character functions
+inline auto better(const char32_t * str) -> better_string_view<char32_t>
+	{return better_string_view<char32_t>(str);}
 
-	template<Encoding E = default_encoding__>
-	auto isascii() const -> bool;
+// Promote standard strings to better strings
 
-	template<Encoding E = default_encoding__>
-	auto isspace() const -> bool;
+template<typename Char, typename Traits, typename Allocator>
+auto better(basic_string<Char, Traits, Allocator> & str) -> better_string<Char, Traits, Allocator> &
+	{return static_cast<better_string<Char, Traits, Allocator> &>(str);}
 
-	template<Encoding E = default_encoding__>
-	auto isaplha() const -> bool;
+template<typename Char, typename Traits, typename Allocator>
+auto better(const basic_string<Char, Traits, Allocator> & str) -> const better_string<Char, Traits, Allocator> &
+	{return static_cast<const better_string<Char, Traits, Allocator> &>(str);}
 
-	template<Encoding E = default_encoding__>
-	auto isalnum() const -> bool;
+template<typename Char, typename Traits, typename Allocator>
+auto better(basic_string<Char, Traits, Allocator> && str) -> better_string<Char, Traits, Allocator> &&
+	{return static_cast<better_string<Char, Traits, Allocator> &&>(str);}
 
-	template<Encoding E = default_encoding__>
-	auto isdigit() const -> bool;
+template<typename Char, typename Traits, typename Allocator>
+auto better(const basic_string<Char, Traits, Allocator> && str) -> const better_string<Char, Traits, Allocator> &&
+	{return static_cast<const better_string<Char, Traits, Allocator> &&>(str);}
 
-	template<Encoding E = default_encoding__>
-	auto isdecimal() const -> bool;
+template<typename Char, typename Traits>
+auto better(basic_string_view<Char, Traits> & str) -> better_string_view<Char, Traits> &
+	{return static_cast<better_string_view<Char, Traits> &>(str);}
 
-	template<Encoding E = default_encoding__>
-	auto isnumeric() const -> bool;
+template<typename Char, typename Traits>
+auto better(const basic_string_view<Char, Traits> & str) -> const better_string_view<Char, Traits> &
+	{return static_cast<const better_string_view<Char, Traits> &>(str);}
 
-	template<Encoding E = default_encoding__>
-	auto isprintable() const -> bool;
+template<typename Char, typename Traits>
+auto better(basic_string_view<Char, Traits> && str) -> better_string_view<Char, Traits> &&
+	{return static_cast<better_string_view<Char, Traits> &&>(str);}
 
-	template<Encoding E = default_encoding__>
-	auto isidentifier() const -> bool;
+template<typename Char, typename Traits>
+auto better(const basic_string_view<Char, Traits> && str) -> const better_string_view<Char, Traits> &&
+	{return static_cast<const better_string_view<Char, Traits> &&>(str);}
 
-	// Character case functions
 
-	template<Encoding E = default_encoding__>
-	auto upper() const -> better_string;
+// Promote standard string views to better string views
 
-	template<Encoding E = default_encoding__>
-	auto lower() const -> better_string;
 
-	template<Encoding E = default_encoding__>
-	auto title() const -> better_string;
+//	------------------------------------------------------------
+//		Iterable view
+//	------------------------------------------------------------
 
-	template<Encoding E = default_encoding__>
-	auto isupper() const -> bool;
+template<typename Iter>
+class iterable_view
+{
+public:
+	// Aliases
+	using iterator = Iter;
+	using const_iterator = Iter;
 
-	template<Encoding E = default_encoding__>
-	auto islower() const -> bool;
+	// Constructors
+	constexpr iterable_view() = default;
+	constexpr iterable_view(Iter begin, Iter end)
+		: _begin(begin), _end(end) {}
 
-	template<Encoding E = default_encoding__>
-	auto istitle() const -> bool;
+	// Iterators
+	Iter begin() const
+		{return _begin;}
+	Iter end() const
+		{return _end;}
 
-	template<Encoding E = default_encoding__>
-	auto capitalize() const -> better_string;
+	// Random access (only for random access iterators)
+	auto size() const -> size_t
+		{return size_t(_end - _begin);}
+	auto empty() const -> bool
+		{return _begin == _end;}
+	auto operator [] (size_t index) const -> decltype(auto)
+		{return _begin[index];}
 
-	template<Encoding E = default_encoding__>
-	auto casefold() const -> better_string;
+private:
+	// Fields
+	Iter _begin = {};
+	Iter _end = {};
+};
 
-	template<Encoding E = default_encoding__>
-	auto swapcase() const -> better_string;
+//	------------------------------------------------------------
+//		URL query strings
+//	------------------------------------------------------------
 
-	// Transcoding functions
+/************************************************************
+ * @brief The key and value pairs of a URL query string (see @ref better_string::query_pairs()).
+ *
+ * The pairs are split while iterating. The keys and values without escapes are views of the query string, the others
+ * are decoded into the buffer of the range, and are only valid until the next pair.
+ */
+template<typename Char, typename Traits>
+class query_pairs
+{
+public:
+	using errors = impl::Errors;
+	using view = better_string_view<Char, Traits>;
 
-	/**
-	 * @brief This is a version of @ref transcode(), that transcodes to one of the default encodings (usually UTF-8).
-	 * Transcoding to a default encoding is required often enough to make this shorthand usefult
-	 *
-	 * @tparam To The desired encoding of the result.
-	 * @result Returns the string, encoded with the desired encoding.
-	 */
-	template<Encoding From, typename CharTo = char>
-	auto decode(errors mode = errors::Strict) const -> better_string<CharTo, std::char_traits<CharTo>, Allocator>
+	// A key and value pair
+	struct value_type
 	{
-		better_string<CharTo, std::char_traits<CharTo>, Allocator> result;
-		algorithm::string::transcode<decltype(*this), Traits, From, decltype(result) &, std::char_traits<CharTo>, default_encoding<CharTo>::value>(*this, result, mode);
-		return result;
-	}
+		view key;
+		view value;
+	};
 
-	/**
-	 * @brief Transcodes the string into a different encoding.
-	 *
-	 * @tparam From The encoding of the source string.
-	 * @tparam To The desired encoding of the result.
-	 * @result Returns the string, encoded with the desired encoding.
-	 */
-	template<Encoding From, Encoding To, typename CharTo = typename encoding_traits<To>::char_type>
-	auto transcode(errors mode = errors::Strict) const -> better_string<CharTo, std::char_traits<CharTo>, Allocator>
+	// Input iterator of the pairs
+	class iterator
 	{
-		better_string<CharTo, std::char_traits<CharTo>, Allocator> result;
-		algorithm::string::transcode<decltype(*this), Traits, From, decltype(result) &, std::char_traits<CharTo>, To>(*this, result, mode);
-		return result;
-	}
+	public:
+		// Aliases
+		using iterator_category = std::input_iterator_tag;
+		using value_type = typename query_pairs::value_type;
+		using difference_type = ptrdiff_t;
+		using pointer = const value_type *;
+		using reference = const value_type &;
+
+		// Constructors (the first pair is split at once)
+		iterator() = default;
+		explicit iterator(query_pairs * range)
+			: range(range) {++ *this;}
+
+		// Access
+		auto operator * () const -> const value_type &
+			{return pair;}
+		auto operator -> () const -> const value_type *
+			{return &pair;}
+
+		// Increment
+		auto operator ++ () -> iterator &
+		{
+			if (range && !range->next(pos, pair))
+				range = nullptr;
+			return *this;
+		}
+		auto operator ++ (int) -> iterator
+			{iterator copy = *this; ++ *this; return copy;}
+
+		// Compare
+		friend auto operator == (const iterator & a, const iterator & b) -> bool
+			{return a.range == b.range && (!a.range || a.pos == b.pos);}
+		friend auto operator != (const iterator & a, const iterator & b) -> bool
+			{return !(a == b);}
+
+	private:
+		// Fields
+		query_pairs * range = nullptr;
+		size_t pos = 0;
+		value_type pair;
+	};
 
-	// Formatting functions
+	/// Creates the view of the pairs of a query string.
+	explicit query_pairs(view query, errors mode = errors::Strict)
+		: query(query), mode(mode) {}
 
-	/**
-	 * @brief Formats the list of values, using the string as the format template.
-	 *
-	 * @param values The list of values used during by the format sequences.
-	 */
-	template<Encoding E = default_encoding__, typename... Types>
-	auto format(Types && ... values) const -> better_string
-		{return algorithm::string::format<decltype(*this), Traits, E, better_string, const Types & ...>(*this, static_cast<const Types &>(values) ...);}
+	// Iterators
+	auto begin() -> iterator
+		{return iterator(this);}
+	auto end() -> iterator
+		{return iterator();}
 
-	// Magic functions
+private:
+	// Splits the pair at a position (skipping empty parts), and moves the position after it
+	auto next(size_t & pos, value_type & pair) -> bool
+	{
+		static_assert(sizeof(Char) == 1, "query_pairs(): Only byte strings are supported!");
+		auto & table = kernels::active();
+		const char * data = reinterpret_cast<const char *>(query.data());
+		size_t size = query.size();
 
-	/// Used by @ref str() to convert this type to a string.
-	template<typename CharTo, Encoding To>
-	static auto str__(const better_string & str) -> better_string<CharTo>
-		{return transcode<default_encoding__, To, CharTo>(errors::Replace);}
+		while (pos < size)
+		{
+			size_t start = pos;
+			size_t end = start + std::min(table.find_byte(data + start, size - start, '&'), size - start);
+			pos = end + 1;
+			if (start == end)
+				continue;
 
-	/// Used by @ref repr() to create a string representation of this type.
-	template<typename CharTo, Encoding To>
-	static auto repr__(const better_string & str) -> better_string<CharTo>
-		{return algorithm::string::quote<const better_string &, Traits, default_encoding__, To, better_string<CharTo>, false>();}
+			// Split the pair
+			size_t sep = start + std::min(table.find_byte(data + start, end - start, '='), end - start);
+			pair.key = view(query.data() + start, sep - start);
+			pair.value = (sep < end) ? view(query.data() + sep + 1, end - sep - 1) : view(query.data() + end, size_t(0));
 
-	/// Used by @ref ascii() to create a ASCII only representation of this type.
-	template<typename CharTo, Encoding To>
-	static auto ascii__(const better_string & str) -> better_string<CharTo>
-		{return algorithm::string::quote<const better_string &, Traits, default_encoding__, To, better_string<CharTo>, true>();}
+			// Decode the pair, only when it has escapes
+			if (table.find_any(data + start, end - start, impl::percent_special) != size_t(-1))
+			{
+				buffer.clear();
+				algorithm::string::percent_decode<view, Traits, better_string<Char, Traits>>(pair.key, buffer, true, mode);
+				size_t length = buffer.size();
+				algorithm::string::percent_decode<view, Traits, better_string<Char, Traits>>(pair.value, buffer, true, mode);
+				pair.key = view(buffer.data(), length);
+				pair.value = view(buffer.data() + length, buffer.size() - length);
+			}
+			return true;
+		}
+		return false;
+	}
 
-	/// Used by @ref format() to format the appearance of this type.
-	template<typename CharTo, Encoding To>
-	static auto format__(const better_string & str, impl::Specifier<CharTo, To> && spec) -> better_string<CharTo>
-		{return better_string_view<Char>::template format__<CharTo, To>(str, std::move(spec));}
+	// Fields
+	view query;
+	errors mode;
+	better_string<Char, Traits> buffer;
 };
 
 //	------------------------------------------------------------
-//		Better string view
+//		Shell-like tokens
 //	------------------------------------------------------------
 
+/************************************************************
+ * @brief The tokens of a shell-like command line (see @ref better_string::shlex_split()).
+ *
+ * The tokens are split while iterating. The runs between whitespace, quotes and escapes are found by the kernels. A
+ * token made of a single run is a view of the text, the others are unescaped into the buffer of the range, and are only
+ * valid until the next token.
+ */
 template<typename Char, typename Traits>
-class better_string_view : public basic_string_view<Char, Traits>
+class shlex_split
 {
-	// Private alias
-	using base__ = basic_string_view<Char, Traits>;
-
-	// Default encoding
-	static constexpr Encoding default_encoding__ = default_encoding<Char>::value;
-
 public:
-	// Aliases
-	using errors = impl::Errors;
-
-	// Constructors
-	using base__::basic_string_view;
-	constexpr better_string_view(const Char * ptr, const Char * end)
-		: base__(ptr, end - ptr) {}
-	template<typename T, typename A>
-	constexpr better_string_view(const basic_string<Char, T, A> & str) noexcept
-		: base__(str.data(), str.size()) {}
-
-	/// @see better_string::length()
-	template<Encoding E = default_encoding__>
-	auto length() const -> size_t
-		{return encoding_traits<E>::iter(base__::data() + base__::size()) - encoding_traits<E>::iter(base__::data());}
-
-	// Alignment functions
+	using view = better_string_view<Char, Traits>;
+	using value_type = view;
 
-	/// @see better_string::center()
-	template<Encoding E = default_encoding__, typename Allocator = std::allocator<Char>>
-	auto center(size_t width, better_string_view fillchar = " ") const -> better_string<Char, Traits, Allocator>
-		{return algorithm::string::center<decltype(*this), Traits, E, better_string_view, better_string<Char, Traits, Allocator>>(*this, width, fillchar);}
+	// Input iterator of the tokens
+	class iterator
+	{
+	public:
+		// Aliases
+		using iterator_category = std::input_iterator_tag;
+		using value_type = view;
+		using difference_type = ptrdiff_t;
+		using pointer = const view *;
+		using reference = const view &;
+
+		// Constructors (the first token is split at once)
+		iterator() = default;
+		explicit iterator(shlex_split * range)
+			: range(range) {++ *this;}
+
+		// Access
+		auto operator * () const -> const view &
+			{return token;}
+		auto operator -> () const -> const view *
+			{return &token;}
+
+		// Increment
+		auto operator ++ () -> iterator &
+		{
+			if (range && !range->next(pos, token))
+				range = nullptr;
+			return *this;
+		}
+		auto operator ++ (int) -> iterator
+			{iterator copy = *this; ++ *this; return copy;}
+
+		// Compare
+		friend auto operator == (const iterator & a, const iterator & b) -> bool
+			{return a.range == b.range && (!a.range || a.pos == b.pos);}
+		friend auto operator != (const iterator & a, const iterator & b) -> bool
+			{return !(a == b);}
+
+	private:
+		// Fields
+		shlex_split * range = nullptr;
+		size_t pos = 0;
+		view token;
+	};
 
-	/// @see better_string::ljust()
-	template<Encoding E = default_encoding__, typename Allocator = std::allocator<Char>>
-	auto ljust(size_t width, better_string_view fillchar = " ") const -> better_string<Char, Traits, Allocator>
-		{return algorithm::string::ljust<decltype(*this), Traits, E, better_string_view, better_string<Char, Traits, Allocator>>(*this, width, fillchar);}
+	/// Creates the view of the tokens of a command line.
+	explicit shlex_split(view text, bool posix = true)
+		: text(text), posix(posix) {}
 
-	/// @see better_string::rjust()
-	template<Encoding E = default_encoding__, typename Allocator = std::allocator<Char>>
-	auto rjust(size_t width, better_string_view fillchar = " ") const -> better_string<Char, Traits, Allocator>
-		{return algorithm::string::rjust<decltype(*this), Traits, E, better_string_view, better_string<Char, Traits, Allocator>>(*this, width, fillchar);}
+	// Iterators
+	auto begin() -> iterator
+		{return iterator(this);}
+	auto end() -> iterator
+		{return iterator();}
 
-	/// @see better_string::zfill()
-	template<Encoding E = default_encoding__, typename Allocator = std::allocator<Char>>
-	auto zfill(size_t width) const -> better_string<Char, Traits, Allocator>
-		{return algorithm::string::zfill<decltype(*this), Traits, E, better_string<Char, Traits, Allocator>>(*this, width);}
+private:
+	// Splits the token at a position (skipping whitespace before it), and moves the position after it
+	auto next(size_t & pos, view & token) -> bool
+	{
+		static_assert(sizeof(Char) == 1, "shlex_split(): Only byte strings are supported!");
+		auto & table = kernels::active();
+		const char * data = reinterpret_cast<const char *>(text.data());
+		size_t size = text.size();
+
+		// Skip whitespace
+		while (pos < size && impl::shlex_space.contains(uint8_t(data[pos])))
+			++ pos;
+		if (pos == size)
+			return false;
 
-	// Find functions
+		// Without POSIX rules, the token is a view of the text (quotes included)
+		size_t start = pos;
+		if (!posix)
+		{
+			if (data[pos] == '\'' || data[pos] == '"')
+			{
+				size_t found = table.find_byte(data + pos + 1, size - pos - 1, data[pos]);
+				if (found == size_t(-1))
+					throw std::invalid_argument("shlex_split(): input: No closing quotation!");
+				pos += found + 2;
+			}
+			else
+				pos += std::min(table.find_any(data + pos, size - pos, impl::shlex_space), size - pos);
+			token = view(text.data() + start, pos - start);
+			return true;
+		}
 
-	/// @see better_string::find()
-	template<Encoding E = default_encoding__>
-	auto find(better_string_view str, size_t start = 0, size_t end = base__::npos) const -> size_t
-		{return algorithm::string::find<decltype(*this), Traits, E, better_string_view>(*this, str, start, end);}
+		// Collect the runs of the token (the first one is kept as a view, until an other one is added)
+		size_t first = start, length = 0;
+		bool copied = false;
+		auto add = [&] (size_t from, size_t to)
+		{
+			if (!copied && (length == 0 || first + length == from))
+			{
+				first = length ? first : from;
+				length += to - from;
+				return;
+			}
+			if (!copied)
+			{
+				buffer.resize(length);
+				std::copy(text.data() + first, text.data() + first + length, buffer.begin());
+				copied = true;
+			}
+			size_t end = buffer.size();
+			buffer.resize(end + (to - from));
+			std::copy(text.data() + from, text.data() + to, buffer.begin() + end);
+		};
 
-	/// @see better_string::rfind()
-	template<Encoding E = default_encoding__>
-	auto rfind(better_string_view str, size_t start = 0, size_t end = base__::npos) const -> size_t
-		{return algorithm::string::rfind<decltype(*this), Traits, E, better_string_view>(*this, str, start, end);}
+		while (pos < size && !impl::shlex_space.contains(uint8_t(data[pos])))
+		{
+			if (data[pos] == '\'')
+			{
+				// Single quotes (everything is kept)
+				size_t found = table.find_byte(data + pos + 1, size - pos - 1, '\'');
+				if (found == size_t(-1))
+					throw std::invalid_argument("shlex_split(): input: No closing quotation!");
+				add(pos + 1, pos + 1 + found);
+				pos += found + 2;
+			}
+			else if (data[pos] == '"')
+			{
+				// Double quotes (only the backslashes before quotes and backslashes are removed)
+				for (++ pos; ; )
+				{
+					size_t found = table.find_any(data + pos, size - pos, impl::shlex_double);
+					if (found == size_t(-1))
+						throw std::invalid_argument("shlex_split(): input: No closing quotation!");
+					add(pos, pos + found);
+					pos += found;
+					if (data[pos] == '"')
+						break;
+					if (pos + 1 == size)
+						throw std::invalid_argument("shlex_split(): input: No escaped character!");
+					bool escaped = (data[pos + 1] == '"' || data[pos + 1] == '\\');
+					add(pos + escaped, pos + 2);
+					pos += 2;
+				}
+				++ pos;
+			}
+			else if (data[pos] == '\\')
+			{
+				// Escape (the next character is kept)
+				if (pos + 1 == size)
+					throw std::invalid_argument("shlex_split(): input: No escaped character!");
+				add(pos + 1, pos + 2);
+				pos += 2;
+			}
+			else
+			{
+				size_t run = std::min(table.find_any(data + pos, size - pos, impl::shlex_special), size - pos);
+				add(pos, pos + run);
+				pos += run;
+			}
+		}
 
-	/// @see better_string::index()
-	template<Encoding E = default_encoding__>
-	auto index(better_string_view str, size_t start = 0, size_t end = base__::npos) const -> size_t
-		{return algorithm::string::index<decltype(*this), Traits, E, better_string_view>(*this, str, start, end);}
+		token = copied ? view(buffer.data(), buffer.size()) : view(text.data() + first, length);
+		return true;
+	}
 
-	/// @see better_string::rindex()
-	template<Encoding E = default_encoding__>
-	auto rindex(better_string_view str, size_t start = 0, size_t end = base__::npos) const -> size_t
-		{return algorithm::string::rindex<decltype(*this), Traits, E, better_string_view>(*this, str, start, end);}
+	// Fields
+	view text;
+	bool posix;
+	better_string<Char, Traits> buffer;
+};
 
-	/// @see better_string::count()
-	template<Encoding E = default_encoding__>
-	auto count(better_string_view str, size_t start = 0, size_t end = base__::npos) const -> size_t
-		{return algorithm::string::count<decltype(*this), Traits, E, better_string_view>(*this, str, start, end);}
+//	------------------------------------------------------------
+//		CSV records
+//	------------------------------------------------------------
 
-	// Replace functions
+/************************************************************
+ * @brief Reader of CSV (RFC 4180) and TSV records, from a whole buffer or from chunks.
+ *
+ * The separators and line feeds outside of quotes are indexed by the kernels one window at a time, so a large buffer
+ * (like a memory mapped file) is never indexed at once. The fields are views of the input: quoted fields without the
+ * quotes, and only the fields with doubled quotes are unescaped, into a buffer of the reader. A record is valid until
+ * the next one is read, or the next chunk is fed. Empty lines are skipped, and a carriage return before the line feed
+ * is removed. A quote only starts a quoted field at the start of the field, elsewhere it is a literal character (an
+ * error in strict mode).
+ */
+template<typename Char = char, typename Traits = std::char_traits<Char>>
+class csv_reader
+{
+public:
+	using errors = impl::Errors;
+	using view = better_string_view<Char, Traits>;
+	using record = iterable_view<const view *>;
 
-	/// @see better_string::replace()
-	template<Encoding E = default_encoding__, typename Allocator = std::allocator<Char>>
-	auto replace(better_string_view old, better_string_view str, size_t count = base__::npos) const -> better_string<Char, Traits, Allocator>
-		{return algorithm::string::replace<decltype(*this), Traits, E, better_string_view, better_string_view, better_string<Char, Traits, Allocator>>(*this, old, str, count);}
+	// Input iterator of the records
+	class iterator
+	{
+	public:
+		// Aliases
+		using iterator_category = std::input_iterator_tag;
+		using value_type = record;
+		using difference_type = ptrdiff_t;
+		using pointer = const record *;
+		using reference = const record &;
+
+		// Constructors (the first record is read at once)
+		iterator() = default;
+		explicit iterator(csv_reader * range)
+			: range(range) {++ *this;}
+
+		// Access
+		auto operator * () const -> const record &
+			{return current;}
+		auto operator -> () const -> const record *
+			{return &current;}
+
+		// Increment
+		auto operator ++ () -> iterator &
+		{
+			if (range && !range->next(current))
+				range = nullptr;
+			return *this;
+		}
+		auto operator ++ (int) -> iterator
+			{iterator copy = *this; ++ *this; return copy;}
+
+		// Compare
+		friend auto operator == (const iterator & a, const iterator & b) -> bool
+			{return a.range == b.range;}
+		friend auto operator != (const iterator & a, const iterator & b) -> bool
+			{return !(a == b);}
+
+	private:
+		// Fields
+		csv_reader * range = nullptr;
+		record current;
+	};
 
-	/// @see better_string::translate()
-	template<Encoding E = default_encoding__, typename Function, typename Allocator = std::allocator<Char>>
-	auto translate(Function && table, errors mode = errors::Replace) const -> better_string<Char, Traits, Allocator>
-		{return algorithm::string::translate<decltype(*this), Traits, E, Function &&, better_string<Char, Traits, Allocator>>(*this, static_cast<Function &&>(table), mode);}
+	/// Creates a reader of a whole buffer (the buffer is not copied, and must outlive the reader).
+	explicit csv_reader(view text, Char sep = ',', Char quote = '"', errors mode = errors::Strict)
+		: input(text), sep(sep), quote(quote), mode(mode), finished(true) {}
 
-	/// @see better_string::maketrans()
-	template<Encoding E = default_encoding__>
-	static auto maketrans(better_string_view from, better_string_view to, better_string_view skip = "") -> impl::Translation
-		{return impl::Translation(from, to, skip);}
+	/// Creates a reader of chunks (see @ref feed() and @ref finish()).
+	explicit csv_reader(Char sep = ',', Char quote = '"', errors mode = errors::Strict)
+		: sep(sep), quote(quote), mode(mode), finished(false) {}
 
-	/// @see better_string::expandtabs()
-	template<Encoding E = default_encoding__, typename Allocator = std::allocator<Char>>
-	auto expandtabs(size_t tabsize = 4) const -> better_string<Char, Traits, Allocator>
-		{return algorithm::string::expandtabs<decltype(*this), Traits, E, better_string<Char, Traits, Allocator>>(*this, tabsize);}
+	// Not copyable (the records point into the reader)
+	csv_reader(const csv_reader &) = delete;
+	auto operator = (const csv_reader &) -> csv_reader & = delete;
 
-	// Split and join functions
+	/// Appends a chunk of the input. The records that are complete can be read after it, the rest is kept until the
+	/// next chunk completes it.
+	void feed(view chunk)
+	{
+		// Drop the records already read
+		if (pos)
+		{
+			std::copy(buffer.begin() + pos, buffer.end(), buffer.begin());
+			buffer.resize(buffer.size() - pos);
+			index.erase(index.begin(), index.begin() + next_index);
+			for (auto & position : index)
+				position -= pos;
+			scanned -= pos;
+			next_index = 0;
+			pos = 0;
+		}
 
-	// Prefix and suffix functions
+		size_t size = buffer.size();
+		buffer.resize(size + chunk.size());
+		std::copy(chunk.begin(), chunk.end(), buffer.begin() + size);
+		input = view(buffer.data(), buffer.size());
+	}
 
-	// Character functions
+	/// Ends the input (the last record can be read after it, even without a line feed).
+	void finish()
+		{finished = true;}
 
-	template<Encoding E = default_encoding__>
-	auto isascii() const -> bool;
+	/// Reads the next record, or returns false when there are no more complete records.
+	auto next(record & result) -> bool
+	{
+		static_assert(sizeof(Char) == 1, "csv_reader(): Only byte strings are supported!");
+		const Char * data = input.data();
+		size_t size = input.size();
 
-	template<Encoding E = default_encoding__>
-	auto isspace() const -> bool;
+		while (pos < size)
+		{
+			// Find the end of the record (indexing the next window, when needed)
+			size_t last = next_index;
+			while (true)
+			{
+				while (last < index.size() && !Traits::eq(data[index[last]], Char('\n')))
+					++ last;
+				if (last < index.size() || scanned == size)
+					break;
+				index.erase(index.begin(), index.begin() + next_index);
+				last -= next_index;
+				next_index = 0;
+				scan();
+			}
 
-	template<Encoding E = default_encoding__>
-	auto isaplha() const -> bool;
+			// Without a line feed, only the last record is complete
+			bool line = (last < index.size());
+			if (!line && !finished)
+				return false;
+			size_t start = pos;
+			size_t end = line ? index[last] : size;
+			pos = line ? end + 1 : size;
+			if (end > start && Traits::eq(data[end - 1], Char('\r')))
+				-- end;
+
+			// Skip empty lines
+			size_t first = next_index;
+			next_index = last + line;
+			if (first == last && end == start)
+				continue;
 
-	template<Encoding E = default_encoding__>
-	auto isalnum() const -> bool;
+			// Split the fields (the unescaped fields are never longer than the record, so the buffer is not moved)
+			fields.clear();
+			arena.clear();
+			arena.reserve(end - start);
+			for (size_t i = first; i < last; ++ i)
+			{
+				field(data + start, data + index[i]);
+				start = index[i] + 1;
+			}
+			field(data + start, data + end);
+			result = record(fields.data(), fields.data() + fields.size());
+			return true;
+		}
+		return false;
+	}
 
-	template<Encoding E = default_encoding__>
-	auto isdigit() const -> bool;
+	// Iterators (the records read so far)
+	auto begin() -> iterator
+		{return iterator(this);}
+	auto end() -> iterator
+		{return iterator();}
 
-	template<Encoding E = default_encoding__>
-	auto isdecimal() const -> bool;
+private:
+	// Size of the windows indexed at once
+	static constexpr size_t window = 1 << 16;
 
-	template<Encoding E = default_encoding__>
-	auto isnumeric() const -> bool;
+	// Indexes the next window of the input
+	void scan()
+	{
+		size_t length = std::min(input.size() - scanned, window);
+		scratch.resize(window);
+		size_t count = kernels::active().csv_index(reinterpret_cast<const char *>(input.data() + scanned), length,
+			char(sep), char(quote), state, scratch.data());
+		for (size_t i = 0; i < count; ++ i)
+			index.push_back(scanned + scratch[i]);
+		scanned += length;
+	}
 
-	template<Encoding E = default_encoding__>
-	auto isprintable() const -> bool;
+	// Adds a field, without the quotes (the fields with doubled quotes are unescaped into the arena)
+	void field(const Char * first, const Char * last)
+	{
+		if (first == last || !Traits::eq(*first, quote))
+		{
+			// A quote inside of an unquoted field is a literal character (an error in strict mode)
+			if (mode == errors::Strict && Traits::find(first, last - first, quote))
+				throw std::invalid_argument("csv_reader(): input: Quote in an unquoted field!");
+			fields.push_back(view(first, last - first));
+			return;
+		}
 
-	template<Encoding E = default_encoding__>
-	auto isidentifier() const -> bool;
+		// Quoted fields must end with a quote, and every quote in them must be doubled
+		bool closed = (last - first >= 2 && Traits::eq(last[-1], quote));
+		const Char * ptr = first + 1;
+		const Char * end = closed ? last - 1 : last;
+		const Char * found = Traits::find(ptr, end - ptr, quote);
+		if (closed && !found)
+		{
+			fields.push_back(view(ptr, end - ptr));
+			return;
+		}
 
-	// Character case functions
+		size_t start = arena.size();
+		while (closed && found && found + 1 < end && Traits::eq(found[1], quote))
+		{
+			arena.resize(arena.size() + (found + 1 - ptr));
+			std::copy(ptr, found + 1, arena.end() - (found + 1 - ptr));
+			ptr = found + 2;
+			found = Traits::find(ptr, end - ptr, quote);
+		}
+		if (closed && !found)
+		{
+			arena.resize(arena.size() + (end - ptr));
+			std::copy(ptr, end, arena.end() - (end - ptr));
+			fields.push_back(view(arena.data() + start, arena.size() - start));
+			return;
+		}
 
-	/// @see better_string::upper()
-	template<Encoding E = default_encoding__, typename Allocator = std::allocator<Char>>
-	auto upper() const -> better_string<Char, Traits, Allocator>;
+		// Invalid quoted field (kept as it is)
+		if (mode == errors::Strict)
+			throw std::invalid_argument("csv_reader(): input: Invalid quoted field!");
+		arena.resize(start);
+		fields.push_back(view(first, last - first));
+	}
 
-	/// @see better_string::lower()
-	template<Encoding E = default_encoding__, typename Allocator = std::allocator<Char>>
-	auto lower() const -> better_string<Char, Traits, Allocator>;
+	// Fields
+	view input;
+	Char sep;
+	Char quote;
+	errors mode;
+	bool finished;
+	kernels::CsvState state;
+	size_t pos = 0;
+	size_t scanned = 0;
+	size_t next_index = 0;
+	std::vector<size_t> index;
+	std::vector<uint32_t> scratch;
+	std::vector<view> fields;
+	better_string<Char, Traits> arena;
+	better_string<Char, Traits> buffer;
+};
 
-	/// @see better_string::title()
-	template<Encoding E = default_encoding__, typename Allocator = std::allocator<Char>>
-	auto title() const -> better_string<Char, Traits, Allocator>;
+//	------------------------------------------------------------
+//		JSON streams
+//	------------------------------------------------------------
 
-	/// @see better_string::isupper()
-	template<Encoding E = default_encoding__>
-	auto isupper() const -> bool;
+/************************************************************
+ * @brief Escapes a JSON string, that arrives in chunks (see @ref better_string::json_escape()).
+ *
+ * The chunks can be cut anywhere: a character split between two chunks is kept, until the next chunk completes it.
+ */
+template<typename Char, Encoding E = default_encoding<Char>::value>
+class json_escaper
+{
+public:
+	using errors = impl::Errors;
 
-	/// @see better_string::islower()
-	template<Encoding E = default_encoding__>
-	auto islower() const -> bool;
+	/// Creates an escaper (with `ascii`, the non-ASCII characters are escaped too).
+	explicit json_escaper(bool ascii = false, errors mode = errors::Strict)
+		: ascii(ascii), mode(mode) {}
 
-	/// @see better_string::istitle()
-	template<Encoding E = default_encoding__>
-	auto istitle() const -> bool;
+	/// Escapes a chunk, and appends it to the output.
+	template<typename Allocator>
+	void feed(better_string_view<Char> chunk, better_string<Char, std::char_traits<Char>, Allocator> & output)
+	{
+		using Output = better_string<Char, std::char_traits<Char>, Allocator>;
+		impl::feed(pending, chunk, [&] (better_string_view<Char> text)
+			{return algorithm::string::json_escape<better_string_view<Char>, std::char_traits<Char>, E, Output>(text, output, mode, ascii, false);});
+	}
 
-	/// @see better_string::capitalize()
-	template<Encoding E = default_encoding__, typename Allocator = std::allocator<Char>>
-	auto capitalize() const -> better_string<Char, Traits, Allocator>;
+	/// Escapes the rest of the stream (an incomplete character at the end is an error).
+	template<typename Allocator>
+	void finish(better_string<Char, std::char_traits<Char>, Allocator> & output)
+	{
+		using Output = better_string<Char, std::char_traits<Char>, Allocator>;
+		algorithm::string::json_escape<better_string_view<Char>, std::char_traits<Char>, E, Output>(pending, output, mode, ascii);
+		pending.clear();
+	}
 
-	/// @see better_string::casefold()
-	template<Encoding E = default_encoding__, typename Allocator = std::allocator<Char>>
-	auto casefold() const -> better_string<Char, Traits, Allocator>;
+private:
+	// Fields
+	bool ascii;
+	errors mode;
+	better_string<Char> pending;
+};
 
-	/// @see better_string::swapcase()
-	template<Encoding E = default_encoding__, typename Allocator = std::allocator<Char>>
-	auto swapcase() const -> better_string<Char, Traits, Allocator>;
+/************************************************************
+ * @brief Decodes a JSON string, that arrives in chunks (see @ref better_string::json_unescape()).
+ *
+ * The chunks can be cut anywhere: an escape sequence or a character split between two chunks is kept, until the next
+ * chunk completes it.
+ */
+template<typename Char, Encoding E = default_encoding<Char>::value>
+class json_unescaper
+{
+public:
+	using errors = impl::Errors;
 
-	// Transcoding functions
+	/// Creates a decoder.
+	explicit json_unescaper(errors mode = errors::Strict)
+		: mode(mode) {}
 
-	/// @see better_string::decode()
-	template<Encoding From, typename CharTo = char, typename Allocator = std::allocator<Char>>
-	auto decode(errors mode = errors::Strict) const -> better_string<CharTo, std::char_traits<CharTo>, Allocator>
+	/// Decodes a chunk, and appends it to the output.
+	template<typename Allocator>
+	void feed(better_string_view<Char> chunk, better_string<Char, std::char_traits<Char>, Allocator> & output)
 	{
-		better_string<CharTo, std::char_traits<CharTo>, Allocator> result;
-		algorithm::string::transcode<decltype(*this), Traits, From, decltype(result) &, std::char_traits<CharTo>, default_encoding<CharTo>::value>(*this, result, mode);
-		return result;
+		using Output = better_string<Char, std::char_traits<Char>, Allocator>;
+		impl::feed(pending, chunk, [&] (better_string_view<Char> text)
+			{return algorithm::string::json_unescape<better_string_view<Char>, std::char_traits<Char>, E, Output>(text, output, mode, false);});
 	}
 
-	/// @see better_string::format()
-	template<Encoding From, Encoding To, typename CharTo = typename encoding_traits<To>::char_type, typename Allocator = std::allocator<Char>>
-	auto transcode(errors mode = errors::Strict) const -> better_string<CharTo, std::char_traits<CharTo>, Allocator>
+	/// Decodes the rest of the stream (an incomplete escape sequence at the end is an error).
+	template<typename Allocator>
+	void finish(better_string<Char, std::char_traits<Char>, Allocator> & output)
 	{
-		better_string<CharTo, std::char_traits<CharTo>, Allocator> result;
-		algorithm::string::transcode<decltype(*this), Traits, From, decltype(result) &, std::char_traits<CharTo>, To>(*this, result, mode);
-		return result;
+		using Output = better_string<Char, std::char_traits<Char>, Allocator>;
+		algorithm::string::json_unescape<better_string_view<Char>, std::char_traits<Char>, E, Output>(pending, output, mode);
+		pending.clear();
 	}
 
-	// Formatting functions
-
-	/// @see better_string::format()
-	template<Encoding E = default_encoding__, typename Allocator = std::allocator<Char>, typename... Types>
-	auto format(Types && ... values) const -> better_string<Char, Traits, Allocator>
-		{return algorithm::string::format<decltype(*this), Traits, E, better_string<Char, Traits, Allocator>, const Types & ...>(*this, static_cast<const Types &>(values) ...);}
+private:
+	// Fields
+	errors mode;
+	better_string<Char> pending;
+};
 
-	// Magic functions
+//	------------------------------------------------------------
+//		Character sets
+//	------------------------------------------------------------
 
-	/// Used by @ref str() to convert this type to a string.
-	template<typename CharTo, Encoding To>
-	static auto str__(better_string_view str) -> better_string<CharTo>
-		{return str.transcode<default_encoding__, To, CharTo>(errors::Replace);}
+/************************************************************
+ * @brief A set of characters (Unicode codepoints), for the searches of @ref better_string_view::find_first_of() and
+ * the others, @ref better_string::strip() and @ref better_string::split_any().
+ *
+ * The codepoints below 256 are stored in a bitmap, the others as a sorted list of at most @p N ranges. The set can be
+ * created at compile time, from a string literal: `static constexpr charset<> seps(",;");`.
+ *
+ * Byte strings (UTF-8 and uninterpreted characters) are searched with the string kernels: the set keeps the bytes,
+ * that may start a member (or a non-member), and only the UTF-8 sequences found by the kernel are decoded.
+ *
+ * @tparam E The encoding of the searched strings (and of the strings the set is created from).
+ * @tparam N The maximum number of ranges of codepoints above 255.
+ */
+template<Encoding E, size_t N>
+class charset
+{
+public:
+	/// A range of codepoints (both ends are included).
+	struct range
+	{
+		uint32_t first;
+		uint32_t last;
+	};
 
-	/// Used by @ref repr() to create a string representation of this type.
-	template<typename CharTo, Encoding To>
-	static auto repr__(better_string_view str) -> better_string<CharTo>
-		{return algorithm::string::quote<better_string_view, Traits, default_encoding__, To, better_string<CharTo>, false>(str);}
+	/// Creates an empty set.
+	constexpr charset()
+		{update();}
 
-	/// Used by @ref ascii() to create a ASCII only representation of this type.
-	template<typename CharTo, Encoding To>
-	static auto ascii__(better_string_view str) -> better_string<CharTo>
-		{return algorithm::string::quote<better_string_view, Traits, default_encoding__, To, better_string<CharTo>, true>(str);}
+	/// Creates the set of the characters of a string literal.
+	template<typename Char, size_t Size>
+	constexpr charset(const Char (& chars)[Size])
+		: charset(chars, Size - 1) {}
 
-	/// Used by @ref format() to format the appearance of this type.
-	template<typename CharTo, Encoding To>
-	static auto format__(better_string_view str, impl::Specifier<CharTo, To> && spec) -> better_string<CharTo>
+	/// Creates the set of the characters of a string. Throws `std::length_error`, if there are more than @p N ranges.
+	template<typename Char>
+	constexpr charset(const Char * chars, size_t size)
 	{
-		// Transcode string
-		auto result = str.transcode<default_encoding__, To, CharTo>(errors::Replace);
+		if (!insert(chars, size))
+			throw std::length_error("charset(): Too many ranges!");
+	}
 
-		// Process format specification
-		if (spec.type && spec.type != 's')
-			throw std::invalid_argument("string::format__(): spec: Invalid format code!");
-		if (spec.sign)
-			throw std::invalid_argument("string::format__(): spec: Sign is not allowed!");
-		if (spec.align == '=')
-			throw std::invalid_argument("string::format__(): spec: Numeric alignment (=) is not allowed!");
-		if (spec.alter)
-			throw std::invalid_argument("string::format__(): spec: Alternate form (#) is not allowed!");
-		if (spec.comma)
-			throw std::invalid_argument("string::format__(): spec: Comma separator (,) is not allowed!");
-		if (spec.other.size())
-			throw std::invalid_argument("string::format__(): spec: Invalid format specification!");
+	/// Creates the set of the characters of a string view.
+	template<typename Char, typename Traits>
+	explicit constexpr charset(better_string_view<Char, Traits> chars)
+		: charset(chars.data(), chars.size()) {}
 
-		if (spec.precision != size_t(-1))
-			result = algorithm::string::truncate<decltype((result)), std::char_traits<CharTo>, To, better_string<CharTo>>(result, spec.precision);
-		if (spec.width != size_t(-1))
+	/// Returns the whitespace characters: the Unicode ones (like in Python), or only the ASCII ones for the encodings
+	/// of uninterpreted characters.
+	static constexpr auto space() -> charset
+	{
+		charset result;
+		result.add(0x09, 0x0D);
+		result.add(0x20, 0x20);
+		if (E != Encoding::Char8 && E != Encoding::Char16 && E != Encoding::Char32)
 		{
-			if (spec.align == 0)
-				spec.align = '<';
-			if (spec.fill.empty())
-				spec.fill = string_literal<Char, ' '>();
-
-			if (spec.align == '<')
-				result = result.template ljust<To>(spec.width, spec.fill);
-			else if (spec.align == '>')
-				result = result.template rjust<To>(spec.width, spec.fill);
-			else if (spec.align == '^')
-				result = result.template center<To>(spec.width, spec.fill);
-			else
-				throw std::invalid_argument("string::format__(): spec: Invalid alignment!");
+			result.add(0x1C, 0x1F);
+			result.add(0x85, 0x85);
+			result.add(0xA0, 0xA0);
+			if (!result.add(0x1680, 0x1680) || !result.add(0x2000, 0x200A) || !result.add(0x2028, 0x2029) ||
+				!result.add(0x202F, 0x202F) || !result.add(0x205F, 0x205F) || !result.add(0x3000, 0x3000))
+				throw std::length_error("charset::space(): Too many ranges!");
 		}
-
-		// Return result
+		result.update();
 		return result;
 	}
-};
 
-// Create better strings from literals
-
-inline auto better(const char * str) -> better_string_view<char>
-	{return better_string_view<char>(str);}
+	/// Adds a codepoint. Returns false, if the set already has @p N ranges (and the codepoint is not added).
+	constexpr auto insert(uint32_t cp) -> bool
+		{return insert(cp, cp);}
 
-inline auto better(const char16_t * str) -> better_string_view<char16_t>
-	{return better_string_view<char16_t>(str);}
+	/// Adds a range of codepoints. Returns false, if the set already has @p N ranges (and the range is not added).
+	constexpr auto insert(uint32_t first, uint32_t last) -> bool
+		{bool added = add(first, last); update(); return added;}
 
-inline auto better(const char32_t * str) -> better_string_view<char32_t>
-	{return better_string_view<char32_t>(str);}
+	/// Adds the characters of a string. Returns false, if the set already has @p N ranges (and some characters are
+	/// not added). Throws `std::invalid_argument` for invalid characters.
+	template<typename Char>
+	constexpr auto insert(const Char * chars, size_t size) -> bool
+	{
+		bool added = true;
+		for (const Char * ptr = chars, * end = chars + size; ptr < end;)
+		{
+			int32_t cp = impl::charset_next<E>(ptr, end);
+			if (cp < 0)
+				throw std::invalid_argument("charset(): Decoding error!");
+			added = add(uint32_t(cp), uint32_t(cp)) && added;
+		}
+		update();
+		return added;
+	}
 
-// Promote standard strings to better strings
+	/// Returns true, if the codepoint is in the set (negative values, the decoding errors, are never in it).
+	constexpr auto contains(int32_t cp) const -> bool
+	{
+		if (cp < 0)
+			return false;
+		if (cp < 256)
+			return (bits[cp >> 6] >> (cp & 63)) & 1;
 
-template<typename Char, typename Traits, typename Allocator>
-auto better(basic_string<Char, Traits, Allocator> & str) -> better_string<Char, Traits, Allocator> &
-	{return static_cast<better_string<Char, Traits, Allocator> &>(str);}
+		// Binary search of the first range, that does not end before the codepoint
+		size_t lo = 0, hi = count;
+		while (lo < hi)
+		{
+			size_t mid = (lo + hi) / 2;
+			if (ranges[mid].last < uint32_t(cp))
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		return lo < count && ranges[lo].first <= uint32_t(cp);
+	}
 
-template<typename Char, typename Traits, typename Allocator>
-auto better(const basic_string<Char, Traits, Allocator> & str) -> const better_string<Char, Traits, Allocator> &
-	{return static_cast<const better_string<Char, Traits, Allocator> &>(str);}
+	/// Returns true, if the set is empty.
+	constexpr auto empty() const -> bool
+		{return count == 0 && !(bits[0] | bits[1] | bits[2] | bits[3]);}
 
-template<typename Char, typename Traits, typename Allocator>
-auto better(basic_string<Char, Traits, Allocator> && str) -> better_string<Char, Traits, Allocator> &&
-	{return static_cast<better_string<Char, Traits, Allocator> &&>(str);}
+	/// Returns the number of ranges of codepoints above 255.
+	constexpr auto range_count() const -> size_t
+		{return count;}
 
-template<typename Char, typename Traits, typename Allocator>
-auto better(const basic_string<Char, Traits, Allocator> && str) -> const better_string<Char, Traits, Allocator> &&
-	{return static_cast<const better_string<Char, Traits, Allocator> &&>(str);}
+	/// Returns a range of codepoints above 255.
+	constexpr auto range_at(size_t i) const -> range
+		{return ranges[i];}
 
-template<typename Char, typename Traits>
-auto better(basic_string_view<Char, Traits> & str) -> better_string_view<Char, Traits> &
-	{return static_cast<better_string_view<Char, Traits> &>(str);}
+	/// Returns the bytes, that may start a member in a byte string (the bytes searched by @ref kernels::Table::find_any()).
+	constexpr auto member_bytes() const -> const kernels::ByteSet &
+		{return members;}
 
-template<typename Char, typename Traits>
-auto better(const basic_string_view<Char, Traits> & str) -> const better_string_view<Char, Traits> &
-	{return static_cast<const better_string_view<Char, Traits> &>(str);}
+	/// Returns the bytes, that may start a character, that is not a member, in a byte string.
+	constexpr auto other_bytes() const -> const kernels::ByteSet &
+		{return others;}
 
-template<typename Char, typename Traits>
-auto better(basic_string_view<Char, Traits> && str) -> better_string_view<Char, Traits> &&
-	{return static_cast<better_string_view<Char, Traits> &&>(str);}
+private:
+	// Adds a range of codepoints (without updating the byte sets)
+	constexpr auto add(uint32_t first, uint32_t last) -> bool
+	{
+		last = std::min<uint32_t>(last, 0x10FFFF);
+		for (; first <= last && first < 256; ++ first)
+			bits[first >> 6] |= uint64_t(1) << (first & 63);
+		if (first > last)
+			return true;
 
-template<typename Char, typename Traits>
-auto better(const basic_string_view<Char, Traits> && str) -> const better_string_view<Char, Traits> &&
-	{return static_cast<const better_string_view<Char, Traits> &&>(str);}
+		// The ranges, that overlap or touch the new one, are merged with it
+		size_t i = 0;
+		while (i < count && ranges[i].last + 1 < first)
+			++ i;
+		size_t j = i;
+		while (j < count && ranges[j].first <= last + 1)
+			++ j;
+		if (i < j)
+		{
+			ranges[i] = range {std::min(ranges[i].first, first), std::max(ranges[j - 1].last, last)};
+			for (size_t k = j; k < count; ++ k)
+				ranges[k - (j - i - 1)] = ranges[k];
+			count -= j - i - 1;
+			return true;
+		}
 
+		// Otherwise it is inserted
+		if (count == N)
+			return false;
+		for (size_t k = count; k > i; -- k)
+			ranges[k] = ranges[k - 1];
+		ranges[i] = range {first, last};
+		++ count;
+		return true;
+	}
 
-// Promote standard string views to better string views
+	// Updates the byte sets. In UTF-8, every byte above 0x7F may start a character that is not a member, and may
+	// start a member, if there are members above 0x7F.
+	constexpr void update()
+	{
+		bool wide = count > 0 || bits[2] || bits[3];
+		members = kernels::ByteSet {};
+		others = kernels::ByteSet {};
+		for (uint32_t ch = 0; ch < 256; ++ ch)
+		{
+			bool member = contains(int32_t(ch));
+			bool ascii = ch < 0x80 || E == Encoding::Char8;
+			if (ascii ? member : wide)
+				(ch < 0x80 ? members.low : members.high)[ch & 0x0F] |= uint8_t(1 << ((ch >> 4) & 7));
+			if (ascii ? !member : true)
+				(ch < 0x80 ? others.low : others.high)[ch & 0x0F] |= uint8_t(1 << ((ch >> 4) & 7));
+		}
+	}
 
+	// Fields
+	uint64_t bits[4] = {};
+	range ranges[N] = {};
+	size_t count = 0;
+	kernels::ByteSet members = {};
+	kernels::ByteSet others = {};
+};
 
 //	------------------------------------------------------------
-//		Iterable view
+//		Substring matches
 //	------------------------------------------------------------
 
-template<typename Iter>
-class iterable_view
+/************************************************************
+ * @brief The occurrences of a substring (see @ref better_string::finditer()).
+ *
+ * The occurrences are found while iterating, with a single search state: the search method is chosen once, and every
+ * occurrence is searched from the previous one. The text and the substring must outlive the range.
+ */
+template<typename Char, typename Traits, Encoding E>
+class finditer
 {
 public:
-	// Aliases
-	using iterator = Iter;
-	using const_iterator = Iter;
+	using view = better_string_view<Char, Traits>;
+	using value_type = view;
 
-	// Constructors
-	constexpr iterable_view() = default;
-	constexpr iterable_view(Iter begin, Iter end)
-		: _begin(begin), _end(end) {}
+	// Input iterator of the occurrences
+	class iterator
+	{
+	public:
+		// Aliases
+		using iterator_category = std::input_iterator_tag;
+		using value_type = view;
+		using difference_type = ptrdiff_t;
+		using pointer = const view *;
+		using reference = const view &;
+
+		// Constructors (the first occurrence is found at once)
+		iterator() = default;
+		explicit iterator(const finditer * range)
+			: range(range), pos(range->scanner.next(0)) {update();}
+
+		// Access
+		auto operator * () const -> const view &
+			{return match;}
+		auto operator -> () const -> const view *
+			{return &match;}
+
+		/// Returns the offset of the occurrence in the text.
+		auto offset() const -> size_t
+			{return pos;}
+
+		// Increment
+		auto operator ++ () -> iterator &
+		{
+			if (range)
+			{
+				pos = range->scanner.next(range->scanner.after(pos, range->overlapping));
+				update();
+			}
+			return *this;
+		}
+		auto operator ++ (int) -> iterator
+			{iterator copy = *this; ++ *this; return copy;}
+
+		// Compare
+		friend auto operator == (const iterator & a, const iterator & b) -> bool
+			{return a.range == b.range && (!a.range || a.pos == b.pos);}
+		friend auto operator != (const iterator & a, const iterator & b) -> bool
+			{return !(a == b);}
+
+	private:
+		// Sets the view of the occurrence (or ends the iteration)
+		void update()
+		{
+			if (pos == size_t(-1))
+				range = nullptr;
+			else
+				match = view(range->text.data() + pos, range->sub.size());
+		}
+
+		// Fields
+		const finditer * range = nullptr;
+		size_t pos = 0;
+		view match;
+	};
+
+	/// Creates the view of the occurrences of a substring (with `overlapping`, an occurrence may start inside of the
+	/// previous one).
+	finditer(view text, view sub, bool overlapping = false)
+		: text(text), sub(sub), overlapping(overlapping), scanner(text.data(), text.size(), sub.data(), sub.size())
+	{
+		BETTER_STRING_PROBE(Finditer, text);
+	}
 
 	// Iterators
-	Iter begin() const
-		{return _begin;}
-	Iter end() const
-		{return _end;}
+	auto begin() const -> iterator
+		{return iterator(this);}
+	auto end() const -> iterator
+		{return iterator();}
+
+	/// Returns the offsets of the occurrences.
+	auto offsets() const -> std::vector<size_t>
+	{
+		std::vector<size_t> result;
+		for (auto iter = begin(); iter != end(); ++ iter)
+			result.push_back(iter.offset());
+		return result;
+	}
 
 private:
 	// Fields
-	Iter _begin = {};
-	Iter _end = {};
+	view text;
+	view sub;
+	bool overlapping;
+	impl::SubstringScanner<Traits, E> scanner;
 };
 
 //	------------------------------------------------------------
@@ -2538,7 +6613,7 @@ public:
 		}
 		else if (cp < 0x10000)
 		{
-			if (cp & 0xF800 == 0xD8)
+			if ((cp & 0xF800) == 0xD800)
 				return false;
 			write(char(0xE0 | (cp >> 12)));
 			write(char(0x80 | ((cp >> 6) & 0x3F)));
@@ -2558,8 +6633,8 @@ public:
 	}
 
 	// String encoder
-	template<typename Char>
-	static bool append(std::basic_string<Char> & str, uint32_t cp)
+	template<typename Char, typename Traits, typename Allocator>
+	static bool append(std::basic_string<Char, Traits, Allocator> & str, uint32_t cp)
 	{
 		if (cp < 0x80)
 		{
@@ -2574,7 +6649,7 @@ public:
 		}
 		else if (cp < 0x10000)
 		{
-			if (cp & 0xF800 == 0xD8)
+			if ((cp & 0xF800) == 0xD800)
 				return false;
 			str.push_back(char(0xE0 | (cp >> 12)));
 			str.push_back(char(0x80 | ((cp >> 6) & 0x3F)));
@@ -2607,14 +6682,14 @@ public:
 	{
 		if (cp < 0x10000)
 		{
-			if (cp & 0xF800 == 0xD8)
+			if ((cp & 0xF800) == 0xD800)
 				return false;
 			write(char16_t(cp));
 			return true;
 		}
 		else if (cp < 0x110000)
 		{
-			cp -= 10000;
+			cp -= 0x10000;
 			write(char16_t(0xD800 | (cp >> 10)));
 			write(char16_t(0xDC00 | (cp & 0x3FF)));
 			return true;
@@ -2623,19 +6698,19 @@ public:
 	}
 
 	// String encoder
-	template<typename Char>
-	static bool append(std::basic_string<Char> & str, uint32_t cp)
+	template<typename Char, typename Traits, typename Allocator>
+	static bool append(std::basic_string<Char, Traits, Allocator> & str, uint32_t cp)
 	{
 		if (cp < 0x10000)
 		{
-			if (cp & 0xF800 == 0xD8)
+			if ((cp & 0xF800) == 0xD800)
 				return false;
 			str.push_back(char16_t(cp));
 			return true;
 		}
 		else if (cp < 0x110000)
 		{
-			cp -= 10000;
+			cp -= 0x10000;
 			str.push_back(char16_t(0xD800 | (cp >> 10)));
 			str.push_back(char16_t(0xDC00 | (cp & 0x3FF)));
 			return true;
@@ -2655,7 +6730,7 @@ public:
 	template<typename Write, decltype(std::declval<Write>()(char32_t()), void()) * = nullptr>
 	static bool encode(Write write, uint32_t cp)
 	{
-		if ((cp & 0xF800 != 0xD8) && (cp < 0x110000))
+		if (((cp & 0xF800) != 0xD800) && (cp < 0x110000))
 		{
 			write(char32_t(cp));
 			return true;
@@ -2665,10 +6740,10 @@ public:
 	}
 
 	// String encoder
-	template<typename Char>
-	static bool append(std::basic_string<Char> & str, uint32_t cp)
+	template<typename Char, typename Traits, typename Allocator>
+	static bool append(std::basic_string<Char, Traits, Allocator> & str, uint32_t cp)
 	{
-		if ((cp & 0xF800 != 0xD8) && (cp < 0x110000))
+		if (((cp & 0xF800) != 0xD800) && (cp < 0x110000))
 		{
 			str.push_back(char32_t(cp));
 			return true;
@@ -2685,6 +6760,8 @@ public:
 /************************************************************
  * @brief Iterator for UTF-8 strings.
  *
+ * When created with the bounds of the string, the iterator never reads outside of them (a sequence cut by the end of
+ * the string is invalid). Without bounds, the string must be terminated (by a NUL character, for example).
  */
 template<typename Char>
 class UTF8Iterator
@@ -2694,6 +6771,8 @@ public:
 	constexpr UTF8Iterator() {}
 	constexpr UTF8Iterator(const Char * ptr)
 		: ptr(ptr) {}
+	constexpr UTF8Iterator(const Char * ptr, const Char * first, const Char * last)
+		: ptr(ptr), first(first), last(last) {}
 
 	// Conversions
 	explicit constexpr operator const Char * ()
@@ -2721,20 +6800,11 @@ public:
 		if (!head(ch))
 			++ ptr;
 		else if (head2(ch))
-		{
-			if (tail(ptr[1]))
-				ptr += 2;
-		}
+			ptr += tail(at(1)) ? 2 : 1;
 		else if (head3(ch))
-		{
-			if (tail(ptr[1]) && tail(ptr[2]))
-				ptr += 3;
-		}
+			ptr += (tail(at(1)) && tail(at(2))) ? 3 : 1;
 		else if (head4(ch))
-		{
-			if (tail(ptr[1]) && tail(ptr[2]) && tail(ptr[3]))
-				ptr += 4;;
-		}
+			ptr += (tail(at(1)) && tail(at(2)) && tail(at(3))) ? 4 : 1;
 		else
 			++ ptr;
 
@@ -2746,17 +6816,17 @@ public:
 
 	auto operator -- () -> UTF8Iterator &
 	{
-		if (tail(ptr[-1]))
+		if (tail(at(-1)))
 		{
-			if (head2(ptr[-2]) && head(ptr[-2]))
+			if (head2(at(-2)) && head(at(-2)))
 				ptr -= 2;
-			else if (tail(ptr[-2]))
+			else if (tail(at(-2)))
 			{
-				if (head3(ptr[-3]) && !head2(ptr[-3]))
+				if (head3(at(-3)) && !head2(at(-3)))
 					ptr -= 3;
-				else if (tail(ptr[-3]))
+				else if (tail(at(-3)))
 				{
-					if (head4(ptr[-3]) && !head3(ptr[-3]))
+					if (head4(at(-4)) && !head3(at(-4)))
 						ptr -= 4;
 					else
 						-- ptr;
@@ -2769,6 +6839,8 @@ public:
 		}
 		else
 			-- ptr;
+
+		return * this;
 	}
 
 	auto operator * () const -> int32_t
@@ -2781,7 +6853,7 @@ public:
 				return - ch;
 			if (head2(ch))
 			{
-				if (!tail(ptr[1]))
+				if (!tail(at(1)))
 					return - ch;
 				int32_t codepoint = (ch & 0x1F) << 6 | (ptr[1] & 0x3F);
 				if (codepoint < 0x80)
@@ -2790,7 +6862,7 @@ public:
 			}
 			if (head3(ch))
 			{
-				if (!tail(ptr[1]) && !tail(ptr[2]))
+				if (!tail(at(1)) || !tail(at(2)))
 					return - ch;
 				int32_t codepoint = (ch & 0x0F) << 12 | (ptr[1] & 0x3F) << 6 | (ptr[2] & 0x3F);
 				if (codepoint < 0x800 || (codepoint & 0xF800) == 0xD800)
@@ -2799,7 +6871,7 @@ public:
 			}
 			if (head4(ch))
 			{
-				if (!tail(ptr[1]) && !tail(ptr[2]) && !tail(ptr[3]))
+				if (!tail(at(1)) || !tail(at(2)) || !tail(at(3)))
 					return - ch;
 				int32_t codepoint = (ch & 0x07) << 18 | (ptr[1] & 0x3F) << 12 | (ptr[2] & 0x3F) << 6 | (ptr[3] & 0x3F);
 				if (codepoint < 0x10000 || codepoint > 0x10FFFF)
@@ -2814,6 +6886,19 @@ public:
 		{return left.ptr < right.ptr; /* This is not a bug, UTF8Iterator needs "<" not "!=" */}
 	friend auto operator - (UTF8Iterator left, UTF8Iterator right) -> size_t
 	{
+		// Count valid text with the string kernels
+		if (sizeof(Char) == 1 && right.ptr < left.ptr)
+		{
+			size_t len = kernels::active().utf8_length(reinterpret_cast<const char *>(right.ptr), left.ptr - right.ptr);
+			if (len != size_t(-1))
+				return len;
+		}
+
+		// Count invalid text one sequence at a time (the sequences can not cross the end)
+		if (!right.last)
+			right.first = right.ptr;
+		if (!right.last || left.ptr < right.last)
+			right.last = left.ptr;
 		size_t len = 0;
 		while (right.ptr < left.ptr)
 			{++ len; ++ right;}
@@ -2823,12 +6908,24 @@ public:
 private:
 	// Fields
 	const Char * ptr = nullptr;
+	const Char * first = nullptr;
+	const Char * last = nullptr;
+
+	// Returns a character near the iterator, or zero outside of the bounds
+	auto at(ptrdiff_t offset) const -> uint8_t
+	{
+		if (last && (offset < first - ptr || offset >= last - ptr))
+			return 0;
+		return uint8_t(ptr[offset]);
+	}
 };
 
 
 /************************************************************
  * @brief Iterator for UTF-16 strings.
  *
+ * When created with the bounds of the string, the iterator never reads outside of them (a surrogate pair cut by the
+ * end of the string is invalid). Without bounds, the string must be terminated.
  */
 template<typename Char>
 class UTF16Iterator
@@ -2837,7 +6934,9 @@ public:
 	// Constructors
 	constexpr UTF16Iterator() {};
 	constexpr UTF16Iterator(const Char * ptr)
-		: ptr(ptr) {}
+		: ptr(ptr), plain(ptr) {}
+	constexpr UTF16Iterator(const Char * ptr, const Char * first, const Char * last)
+		: ptr(ptr), first(first), last(last), plain(ptr) {}
 
 	// Conversions
 	explicit constexpr operator const Char * ()
@@ -2852,9 +6951,12 @@ public:
 	// Interface
 	auto operator ++ () -> UTF16Iterator &
 	{
-		++ ptr;
-		if (is_surrogate_first(ptr[-1]) && is_surrogate_last(ptr[0]))
-			++ ptr;
+		// Characters before the next surrogate are one unit each
+		if (ptr < plain)
+			{++ ptr; return * this;}
+
+		step();
+		scan();
 		return * this;
 	}
 	auto operator ++ (int) -> UTF16Iterator
@@ -2863,8 +6965,9 @@ public:
 	auto operator -- () -> UTF16Iterator &
 	{
 		-- ptr;
-		if (is_surrogate_last(ptr[0]) && is_surrogate_first(ptr[-1]))
+		if (is_surrogate_last(at(0)) && is_surrogate_first(at(-1)))
 			-- ptr;
+		plain = ptr;
 		return * this;
 	}
 	auto operator -- (int) -> UTF16Iterator
@@ -2872,7 +6975,7 @@ public:
 
 	auto operator * () const -> int32_t
 	{
-		if (is_surrogate_first(ptr[0]) && is_surrogate_last(ptr[1]))
+		if (is_surrogate_first(ptr[0]) && is_surrogate_last(at(1)))
 			return ((ptr[0] & 0x3FF) << 10) + (ptr[1] & 0x3FF) + 0x10000;
 		return ptr[0];
 	}
@@ -2882,15 +6985,62 @@ public:
 		{return left.ptr < right.ptr; /* This is not a bug, UTF16Iterator needs "<" not "!=" */}
 	friend auto operator - (UTF16Iterator left, UTF16Iterator right) -> size_t
 	{
+		// The surrogate pairs can not cross the end
+		if (!right.last)
+			right.first = right.ptr;
+		if (!right.last || left.ptr < right.last)
+			right.last = left.ptr;
+
 		size_t len = 0;
 		while (right.ptr < left.ptr)
-			{++ len; ++ right;}
+		{
+			// Count the units before the next surrogate with the string kernels
+			if (sizeof(Char) == 2)
+			{
+				size_t n = kernels::active().utf16_prefix(reinterpret_cast<const char16_t *>(right.ptr), left.ptr - right.ptr);
+				len += n;
+				right.ptr += n;
+				if (right.ptr >= left.ptr)
+					break;
+			}
+			++ len;
+			right.step();
+		}
 		return len;
 	}
 
 private:
+	// Number of units checked for surrogates at once, while iterating
+	static constexpr size_t window = 64;
+
 	// Fields
 	const Char * ptr = nullptr;
+	const Char * first = nullptr;
+	const Char * last = nullptr;
+	const Char * plain = nullptr;	// End of the units after ptr, that are not surrogates
+
+	// Moves to the next character
+	void step()
+	{
+		++ ptr;
+		if (is_surrogate_first(at(-1)) && is_surrogate_last(at(0)))
+			++ ptr;
+	}
+
+	// Finds the next surrogate in a small window (only with bounds, the window keeps short loops cheap)
+	void scan()
+	{
+		if (sizeof(Char) == 2 && last && ptr < last)
+			plain = ptr + kernels::active().utf16_prefix(reinterpret_cast<const char16_t *>(ptr), std::min<size_t>(last - ptr, window));
+	}
+
+	// Returns a character near the iterator, or zero outside of the bounds
+	auto at(ptrdiff_t offset) const -> uint16_t
+	{
+		if (last && (offset < first - ptr || offset >= last - ptr))
+			return 0;
+		return uint16_t(ptr[offset]);
+	}
 };
 
 /************************************************************
@@ -2905,6 +7055,8 @@ public:
 	constexpr UTF32Iterator() {};
 	constexpr UTF32Iterator(const Char * ptr)
 		: ptr(ptr) {}
+	constexpr UTF32Iterator(const Char * ptr, const Char *, const Char *)
+		: ptr(ptr) {}
 
 	// Conversions
 	explicit constexpr operator const Char * ()
@@ -2920,7 +7072,7 @@ public:
 	auto operator -- (int) -> UTF32Iterator
 		{return UTF32Iterator(ptr --);}
 	auto operator * () const -> int32_t
-		{return (*ptr & 0xF800 != 0xD8) && (*ptr < 0x110000) ? *ptr : -1;}
+		{return ((*ptr & 0xF800) != 0xD800) && (uint32_t(*ptr) < 0x110000) ? int32_t(*ptr) : -1;}
 
 	// Binary operators
 	friend auto operator != (UTF32Iterator left, UTF32Iterator right) -> bool
@@ -3007,23 +7159,24 @@ template<> struct format_proxy<int64_t>
 		{
 			// Create result
 			better_string<Char> result;
-			better_string<Char> number;
+			Char number[64];
+			size_t length = 0;
 
 			// Value
-			uint64_t n = value < 0 ? -value : value;
+			uint64_t n = value < 0 ? 0 - uint64_t(value) : uint64_t(value);
 			do
 			{
-				number.push_back('0' + n % 10);
+				number[length ++] = '0' + n % 10;
 				n /= 10;
 			}
 			while (n > 0);
 
 			// Sign
 			if (value < 0)
-				number.push_back('-');
+				number[length ++] = '-';
 
 			// Reverse number
-			for (size_t i = number.size(); i > 0;)
+			for (size_t i = length; i > 0;)
 				result.push_back(number[-- i]);
 
 			// return result
@@ -3079,13 +7232,14 @@ template<> struct format_proxy<int64_t>
 
 			// Create result
 			better_string<Char> result;
-			better_string<Char> number;
+			Char number[64];
+			size_t length = 0;
 
 			// Sign
 			if (value < 0)
 				result.push_back('-');
-			else if (spec.sign)
-				result.push_back('+');
+			else if (spec.sign == '+' || spec.sign == ' ')
+				result.push_back(spec.sign);
 
 			// Alter
 			if (spec.alter && base != 10)
@@ -3097,10 +7251,10 @@ template<> struct format_proxy<int64_t>
 			// Value
 			{
 				const char * digits = (spec.type == 'X') ? "0123456789ABCDEF" : "0123456789abcdef";
-				uint64_t n = value < 0 ? -value : value;
+				uint64_t n = value < 0 ? 0 - uint64_t(value) : uint64_t(value);
 				do
 				{
-					number.push_back(digits[n % base]);
+					number[length ++] = digits[n % base];
 					n /= base;
 				}
 				while (n > 0);
@@ -3112,17 +7266,17 @@ template<> struct format_proxy<int64_t>
 				if (spec.fill.empty())
 					spec.fill = string_literal<Char, ' '>();
 				if (spec.align == 0)
-					spec.align = '>';
+					spec.align = spec.zero ? '=' : '>';
 
 				// Numeric align
-				if (spec.align == '=' && spec.width > result.size() + number.size())
+				if (spec.align == '=' && spec.width > result.size() + length)
 				{
-					for (size_t i = spec.width - result.size() - number.size(); i > 0; -- i)
+					for (size_t i = spec.width - result.size() - length; i > 0; -- i)
 						result.extend(spec.fill);
 				}
 
 				// Reverse number
-				for (size_t i = number.size(); i > 0;)
+				for (size_t i = length; i > 0;)
 					result.push_back(number[-- i]);
 
 				// Normal align
@@ -3131,14 +7285,14 @@ template<> struct format_proxy<int64_t>
 				else if (spec.align == '>')
 					result = result.template rjust<E>(spec.width, spec.fill);
 				else if (spec.align == '^')
-					result = result.template center<E>(spec.width, spec.fill);
-				else
-					std::invalid_argument("int64_t::format__(): spec: Invalid format specification!");
+					result = impl::format_center<E>(result, spec.width, spec.fill);
+				else if (spec.align != '=')
+					throw std::invalid_argument("int64_t::format__(): spec: Invalid format specification!");
 			}
 			else
 			{
 				// Reverse number
-				for (size_t i = number.size(); i > 0;)
+				for (size_t i = length; i > 0;)
 					result.push_back(number[-- i]);
 			}
 
@@ -3157,18 +7311,19 @@ template<> struct format_proxy<uint64_t>
 		{
 			// Create result
 			better_string<Char> result;
-			better_string<Char> number;
+			Char number[64];
+			size_t length = 0;
 
 			// Value
 			do
 			{
-				number.push_back('0' + value % 10);
+				number[length ++] = '0' + value % 10;
 				value /= 10;
 			}
 			while (value > 0);
 
 			// Reverse number
-			for (size_t i = number.size(); i > 0;)
+			for (size_t i = length; i > 0;)
 				result.push_back(number[-- i]);
 
 			// return result
@@ -3224,11 +7379,12 @@ template<> struct format_proxy<uint64_t>
 
 			// Create result
 			better_string<Char> result;
-			better_string<Char> number;
+			Char number[64];
+			size_t length = 0;
 
 			// Sign
-			if (spec.sign)
-				result.push_back('+');
+			if (spec.sign == '+' || spec.sign == ' ')
+				result.push_back(spec.sign);
 
 			// Alter
 			if (spec.alter && base != 10)
@@ -3242,7 +7398,7 @@ template<> struct format_proxy<uint64_t>
 				const char * digits = (spec.type == 'X') ? "0123456789ABCDEF" : "0123456789abcdef";
 				do
 				{
-					number.push_back(digits[value % base]);
+					number[length ++] = digits[value % base];
 					value /= base;
 				}
 				while (value > 0);
@@ -3254,17 +7410,17 @@ template<> struct format_proxy<uint64_t>
 				if (spec.fill.empty())
 					spec.fill = string_literal<Char, ' '>();
 				if (spec.align == 0)
-					spec.align = '>';
+					spec.align = spec.zero ? '=' : '>';
 
 				// Numeric align
-				if (spec.align == '=' && spec.width > result.size() + number.size())
+				if (spec.align == '=' && spec.width > result.size() + length)
 				{
-					for (size_t i = spec.width - result.size() - number.size(); i > 0; -- i)
+					for (size_t i = spec.width - result.size() - length; i > 0; -- i)
 						result.extend(spec.fill);
 				}
 
 				// Reverse number
-				for (size_t i = number.size(); i > 0;)
+				for (size_t i = length; i > 0;)
 					result.push_back(number[-- i]);
 
 				// Normal align
@@ -3273,14 +7429,14 @@ template<> struct format_proxy<uint64_t>
 				else if (spec.align == '>')
 					result = result.template rjust<E>(spec.width, spec.fill);
 				else if (spec.align == '^')
-					result = result.template center<E>(spec.width, spec.fill);
-				else
-					std::invalid_argument("uint64_t::format__(): spec: Invalid format specification!");
+					result = impl::format_center<E>(result, spec.width, spec.fill);
+				else if (spec.align != '=')
+					throw std::invalid_argument("uint64_t::format__(): spec: Invalid format specification!");
 			}
 			else
 			{
 				// Reverse number
-				for (size_t i = number.size(); i > 0;)
+				for (size_t i = length; i > 0;)
 					result.push_back(number[-- i]);
 			}
 
@@ -3486,6 +7642,9 @@ template<> struct encoding_traits<Encoding::Char8>
 	template<typename Char>
 	static constexpr auto iter(const Char * iter) -> iterator<Char>
 		{return iter;}
+	template<typename Char>
+	static constexpr auto iter(const Char * iter, const Char *, const Char *) -> iterator<Char>
+		{return iter;}
 
 	template<typename String>
 	static constexpr auto append(String & string, uint32_t cp) -> bool
@@ -3513,6 +7672,9 @@ template<> struct encoding_traits<Encoding::Char16>
 	template<typename Char>
 	static constexpr auto iter(const Char *iter) -> iterator<Char>
 		{return iter;}
+	template<typename Char>
+	static constexpr auto iter(const Char * iter, const Char *, const Char *) -> iterator<Char>
+		{return iter;}
 
 	template<typename String>
 	static constexpr auto append(String & string, uint32_t cp) -> bool
@@ -3540,6 +7702,9 @@ template<> struct encoding_traits<Encoding::Char32>
 	template<typename Char>
 	static constexpr auto iter(const Char *iter) -> iterator<Char>
 		{return iter;}
+	template<typename Char>
+	static constexpr auto iter(const Char * iter, const Char *, const Char *) -> iterator<Char>
+		{return iter;}
 
 	template<typename String>
 	static constexpr auto append(String & string, uint32_t cp) -> bool
@@ -3567,6 +7732,9 @@ template<> struct encoding_traits<Encoding::UTF8>
 	template<typename Char>
 	static constexpr auto iter(const Char *iter) -> iterator<Char>
 		{return iterator<Char>(iter);}
+	template<typename Char>
+	static constexpr auto iter(const Char * iter, const Char * first, const Char * last) -> iterator<Char>
+		{return iterator<Char>(iter, first, last);}
 
 	template<typename String>
 	static constexpr auto append(String & string, uint32_t cp) -> bool
@@ -3592,6 +7760,9 @@ template<> struct encoding_traits<Encoding::UTF16>
 	template<typename Char>
 	static constexpr auto iter(const Char *iter) -> iterator<Char>
 		{return iterator<Char>(iter);}
+	template<typename Char>
+	static constexpr auto iter(const Char * iter, const Char * first, const Char * last) -> iterator<Char>
+		{return iterator<Char>(iter, first, last);}
 
 	template<typename String>
 	static constexpr auto append(String & string, uint32_t cp) -> bool
@@ -3618,6 +7789,9 @@ template<> struct encoding_traits<Encoding::UTF32>
 	template<typename Char>
 	static constexpr auto iter(const Char *iter) -> iterator<Char>
 		{return iterator<Char>(iter);}
+	template<typename Char>
+	static constexpr auto iter(const Char * iter, const Char * first, const Char * last) -> iterator<Char>
+		{return iterator<Char>(iter, first, last);}
 
 	template<typename String>
 	static constexpr auto append(String & string, uint32_t cp) -> bool
@@ -0,0 +1,445 @@
+#pragma once
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define BETTER_SUFFIX_MMAP 1
+#else
+#define BETTER_SUFFIX_MMAP 0
+#endif
+
+#include "better-string.hh"
+
+// Namespace for std extensions
+namespace ext {
+
+/**
+ * @name Suffix index
+ *
+ * @ref suffix_index answers repeated substring queries over a fixed text (of bytes), without scanning it: the suffix
+ * array of the text (the start of every suffix, in lexicographic order) is built once, in linear time, with the SA-IS
+ * algorithm (induced sorting). The occurrences of a substring are a range of the suffix array, found with two binary
+ * searches. Each step compares the substring with a suffix from the shorter of the common prefixes with the bounds of
+ * the range, so a query takes O(m log n) time at most, and usually much less.
+ *
+ * The suffix array uses 32-bit offsets for texts shorter than 4 GiB (5 bytes per byte of text, with the text), and
+ * 64-bit offsets for longer ones. An index can be saved to a file, that is mapped into memory when it is opened (the
+ * text and the suffix array are used from the file, without copying or rebuilding them).
+ */
+
+/// @{
+
+// Namespace for implementation details
+namespace impl {
+
+// Builds the suffix array of a string of symbols below k (an empty suffix, smaller than every symbol, ends the string)
+template<typename Index, typename Symbol>
+void sais(const Symbol * s, Index n, Index k, Index * sa)
+{
+	static constexpr Index empty = Index(-1);
+	if (n == 0)
+		return;
+	if (n == 1)
+	{
+		sa[0] = 0;
+		return;
+	}
+
+	// Types of the suffixes (S: smaller than the next one, L: larger), the last one is L
+	std::vector<bool> type(n, false);
+	for (Index i = n - 1; i -- > 0;)
+		type[i] = s[i] < s[i + 1] || (s[i] == s[i + 1] && type[i + 1]);
+	auto lms = [&] (Index i) {return i > 0 && i < n && type[i] && !type[i - 1];};
+
+	// Buckets of the symbols (their heads, or their tails)
+	std::vector<Index> sizes(k, 0), bucket(k);
+	for (Index i = 0; i < n; ++ i)
+		++ sizes[s[i]];
+	auto heads = [&] {Index sum = 0; for (Index c = 0; c < k; ++ c) {bucket[c] = sum; sum += sizes[c];}};
+	auto tails = [&] {Index sum = 0; for (Index c = 0; c < k; ++ c) {sum += sizes[c]; bucket[c] = sum;}};
+
+	// Induces the order of the L suffixes from the LMS suffixes, and of the S suffixes from the L suffixes
+	auto induce = [&] {
+		heads();
+		sa[bucket[s[n - 1]] ++] = n - 1;
+		for (Index i = 0; i < n; ++ i)
+			if (sa[i] != empty && sa[i] > 0 && !type[sa[i] - 1])
+				sa[bucket[s[sa[i] - 1]] ++] = sa[i] - 1;
+		tails();
+		for (Index i = n; i -- > 0;)
+			if (sa[i] != empty && sa[i] > 0 && type[sa[i] - 1])
+				sa[-- bucket[s[sa[i] - 1]]] = sa[i] - 1;
+	};
+
+	// Sorts the LMS substrings (the LMS suffixes are put at the tails of their buckets, in any order)
+	std::fill(sa, sa + n, empty);
+	tails();
+	for (Index i = n - 1; i > 0; -- i)
+		if (lms(i))
+			sa[-- bucket[s[i]]] = i;
+	induce();
+
+	// Names the sorted LMS substrings (equal substrings get the same name), stored at sa[n1 + i / 2]
+	Index n1 = 0;
+	for (Index i = 0; i < n; ++ i)
+		if (lms(sa[i]))
+			sa[n1 ++] = sa[i];
+	std::fill(sa + n1, sa + n, empty);
+	auto equal = [&] (Index a, Index b) {
+		for (Index d = 0;; ++ d)
+		{
+			if (a + d == n || b + d == n || s[a + d] != s[b + d] || type[a + d] != type[b + d])
+				return false;
+			if (d > 0 && (lms(a + d) || lms(b + d)))
+				return lms(a + d) && lms(b + d);
+		}
+	};
+	Index names = 0;
+	for (Index i = 0; i < n1; ++ i)
+	{
+		if (i == 0 || !equal(sa[i - 1], sa[i]))
+			++ names;
+		sa[n1 + sa[i] / 2] = names - 1;
+	}
+
+	// The reduced string (the names of the LMS substrings, in the order of the text), and its suffix array
+	std::vector<Index> s1, sa1(n1), positions;
+	s1.reserve(n1);
+	positions.reserve(n1);
+	for (Index i = n1; i < n; ++ i)
+		if (sa[i] != empty)
+			s1.push_back(sa[i]);
+	for (Index i = 1; i < n; ++ i)
+		if (lms(i))
+			positions.push_back(i);
+	if (names < n1)
+		sais<Index, Index>(s1.data(), n1, names, sa1.data());
+	else
+		for (Index i = 0; i < n1; ++ i)
+			sa1[s1[i]] = i;
+
+	// Sorts the suffixes from the sorted LMS suffixes
+	std::fill(sa, sa + n, empty);
+	tails();
+	for (Index i = n1; i -- > 0;)
+	{
+		Index j = positions[sa1[i]];
+		sa[-- bucket[s[j]]] = j;
+	}
+	induce();
+}
+
+// Header of an index file
+struct SuffixHeader
+{
+	char magic[8];
+	uint64_t size;	// The size of the text
+	uint64_t width;	// The size of the offsets in the suffix array
+	uint64_t array;	// The offset of the suffix array in the file (the text is after the header)
+};
+
+static constexpr char suffix_magic[8] = {'B', 'S', 'U', 'F', 'F', 'I', 'X', '1'};
+
+// Close namespace "impl"
+}
+
+/************************************************************
+ * @brief A suffix array of a fixed text, for repeated substring queries (see the description of the module above).
+ *
+ * An index built from a text does not copy it, the text must outlive the index. An opened index keeps its file mapped.
+ */
+class suffix_index
+{
+public:
+	using view = better_string_view<char>;
+
+	/// Creates an empty index.
+	suffix_index() = default;
+
+	/// Builds the suffix array of a text (the text is not copied).
+	explicit suffix_index(view text)
+		: source(text)
+	{
+		if (text.size() < size_t(0xFFFFFFFF))
+			build(narrow);
+		else
+			build(wide);
+	}
+
+	// Moved, but not copied (the suffix array may point to the vectors, or to the mapping)
+	suffix_index(suffix_index && other) noexcept
+		{swap(other);}
+	auto operator = (suffix_index && other) noexcept -> suffix_index &
+		{suffix_index(std::move(other)).swap(* this); return * this;}
+	suffix_index(const suffix_index &) = delete;
+	auto operator = (const suffix_index &) -> suffix_index & = delete;
+
+	~suffix_index()
+		{unmap();}
+
+	/// Returns the text.
+	auto text() const -> view
+		{return source;}
+
+	/// Returns the size of the text.
+	auto size() const -> size_t
+		{return source.size();}
+
+	/// Returns the start of the suffix of a rank (the offset at a position of the suffix array).
+	auto suffix(size_t rank) const -> size_t
+		{return (width == 4) ? static_cast<const uint32_t *>(array)[rank] : size_t(static_cast<const uint64_t *>(array)[rank]);}
+
+	/// Returns the range of ranks of the suffixes that start with a substring (an empty range at its place, if none).
+	auto range(view sub) const -> std::pair<size_t, size_t>
+	{
+		return {bound(sub, false), bound(sub, true)};
+	}
+
+	/// Returns the number of occurrences of a substring (overlapping ones too, and the empty substring at every offset,
+	/// including the end of the text).
+	auto count(view sub) const -> size_t
+	{
+		auto found = range(sub);
+		return found.second - found.first + sub.empty();
+	}
+
+	/// Returns true, if the text contains a substring.
+	auto contains(view sub) const -> bool
+		{return count(sub) > 0;}
+
+	/// Returns the first offset of a substring, or npos (the offsets of a range are not sorted, every one is visited).
+	auto find(view sub) const -> size_t
+	{
+		if (sub.empty())
+			return 0;
+		auto found = range(sub);
+		size_t result = view::npos;
+		for (size_t rank = found.first; rank < found.second; ++ rank)
+			result = std::min(result, suffix(rank));
+		return result;
+	}
+
+	/// Returns every offset of a substring, in increasing order.
+	auto find_all(view sub) const -> std::vector<size_t>
+	{
+		std::vector<size_t> result;
+		find_all_into(sub, result);
+		return result;
+	}
+
+	/// A version of @ref find_all(), that appends to an existing list (reusing its capacity).
+	auto find_all_into(view sub, std::vector<size_t> & output) const -> std::vector<size_t> &
+	{
+		auto found = range(sub);
+		size_t start = output.size();
+		for (size_t rank = found.first; rank < found.second; ++ rank)
+			output.push_back(suffix(rank));
+		std::sort(output.begin() + start, output.end());
+		if (sub.empty())
+			output.push_back(source.size());
+		return output;
+	}
+
+	/**
+	 * @brief Writes the text and the suffix array to a file, that can be opened with @ref open().
+	 *
+	 * @throws std::system_error When the file can not be written.
+	 */
+	void save(const std::string & path) const
+	{
+		impl::SuffixHeader header;
+		memcpy(header.magic, impl::suffix_magic, sizeof(header.magic));
+		header.size = source.size();
+		header.width = width;
+		header.array = (sizeof(header) + source.size() + 7) / 8 * 8;
+
+		FILE * file = fopen(path.c_str(), "wb");
+		if (!file)
+			throw std::system_error(errno, std::generic_category(), path);
+		// An empty index has no text and no suffix array (and their pointers may be null)
+		static const char padding[8] = {};
+		bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+		if (ok && source.size() > 0)
+			ok = fwrite(source.data(), 1, source.size(), file) == source.size()
+				&& fwrite(padding, 1, header.array - sizeof(header) - source.size(), file) == header.array - sizeof(header) - source.size()
+				&& fwrite(array, width, source.size(), file) == source.size();
+		int error = errno;
+		if (fclose(file) != 0 && ok)
+			error = errno, ok = false;
+		if (!ok)
+			throw std::system_error(error, std::generic_category(), path);
+	}
+
+	/**
+	 * @brief Opens a file written by @ref save(). The file is mapped into memory (or read, where it can not be mapped),
+	 * and must not be changed while the index is used.
+	 *
+	 * @throws std::system_error When the file can not be read.
+	 * @throws std::invalid_argument When the file is not an index, it is truncated, or its suffix array has an offset
+	 * out of the text.
+	 */
+	static auto open(const std::string & path) -> suffix_index
+	{
+		suffix_index result;
+#if BETTER_SUFFIX_MMAP
+		int fd = ::open(path.c_str(), O_RDONLY);
+		struct stat info;
+		if (fd < 0 || fstat(fd, &info) != 0)
+		{
+			int error = errno;
+			if (fd >= 0)
+				close(fd);
+			throw std::system_error(error, std::generic_category(), path);
+		}
+		size_t length = size_t(info.st_size);
+		void * data = length ? mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+		int error = errno;
+		close(fd);
+		if (data == MAP_FAILED)
+		{
+			if (length < sizeof(impl::SuffixHeader))
+				throw std::invalid_argument("Invalid suffix index file: " + path);
+			throw std::system_error(error, std::generic_category(), path);
+		}
+		result.mapping = data;
+		result.mapping_size = length;
+		const char * bytes = static_cast<const char *>(data);
+#else
+		FILE * file = fopen(path.c_str(), "rb");
+		if (!file)
+			throw std::system_error(errno, std::generic_category(), path);
+		char chunk[1 << 16];
+		for (size_t n; (n = fread(chunk, 1, sizeof(chunk), file)) > 0;)
+			result.contents.insert(result.contents.end(), chunk, chunk + n);
+		fclose(file);
+		size_t length = result.contents.size();
+		const char * bytes = result.contents.data();
+#endif
+
+		// Check the header (and that the text and the suffix array fit in the file)
+		impl::SuffixHeader header;
+		if (length < sizeof(header))
+			throw std::invalid_argument("Invalid suffix index file: " + path);
+		memcpy(&header, bytes, sizeof(header));
+		bool valid = memcmp(header.magic, impl::suffix_magic, sizeof(header.magic)) == 0
+			&& (header.width == 4 || header.width == 8) && header.array % 8 == 0
+			&& header.size <= length && header.array >= sizeof(header) + header.size && header.array <= length
+			&& (length - header.array) / header.width >= header.size;
+		if (!valid)
+			throw std::invalid_argument("Invalid suffix index file: " + path);
+
+		result.source = view(bytes + sizeof(header), size_t(header.size));
+		result.array = bytes + header.array;
+		result.width = uint32_t(header.width);
+
+		// Check the suffix array (a corrupted offset would point out of the text)
+		for (size_t rank = 0; rank < result.size(); ++ rank)
+			if (result.suffix(rank) >= result.size())
+				throw std::invalid_argument("Invalid suffix index file: " + path);
+		return result;
+	}
+
+private:
+	// Builds the suffix array, with offsets of a type
+	template<typename Index>
+	void build(std::vector<Index> & storage)
+	{
+		storage.resize(source.size());
+		impl::sais<Index, uint8_t>(reinterpret_cast<const uint8_t *>(source.data()), Index(source.size()), 256, storage.data());
+		array = storage.data();
+		width = sizeof(Index);
+	}
+
+	// Compares the suffix of a rank with a substring, starting after a common prefix (and extends the prefix)
+	auto compare(size_t rank, view sub, size_t & common) const -> int
+	{
+		size_t start = suffix(rank);
+		const auto * text = reinterpret_cast<const uint8_t *>(source.data()) + start;
+		const auto * pattern = reinterpret_cast<const uint8_t *>(sub.data());
+		size_t limit = std::min(sub.size(), source.size() - start);
+		while (common < limit && text[common] == pattern[common])
+			++ common;
+		if (common == sub.size())
+			return 0;
+		if (common == limit)
+			return -1;
+		return (text[common] < pattern[common]) ? -1 : 1;
+	}
+
+	// Returns the first rank, whose suffix is not less than the substring (or greater, for the upper bound)
+	auto bound(view sub, bool upper) const -> size_t
+	{
+		// The common prefixes of the substring with the suffixes before and at the bounds
+		size_t low = 0, high = source.size(), low_common = 0, high_common = 0;
+		while (low < high)
+		{
+			size_t middle = low + (high - low) / 2;
+			size_t common = std::min(low_common, high_common);
+			int order = compare(middle, sub, common);
+			if (order < 0 || (upper && order == 0))
+			{
+				low = middle + 1;
+				low_common = common;
+			}
+			else
+			{
+				high = middle;
+				high_common = common;
+			}
+		}
+		return low;
+	}
+
+	// Unmaps the file
+	void unmap()
+	{
+#if BETTER_SUFFIX_MMAP
+		if (mapping)
+			munmap(mapping, mapping_size);
+#endif
+		mapping = nullptr;
+	}
+
+	// Swaps two indices (the vectors keep their buffers, so the pointers stay valid)
+	void swap(suffix_index & other) noexcept
+	{
+		std::swap(source, other.source);
+		std::swap(array, other.array);
+		std::swap(width, other.width);
+		narrow.swap(other.narrow);
+		wide.swap(other.wide);
+		contents.swap(other.contents);
+		std::swap(mapping, other.mapping);
+		std::swap(mapping_size, other.mapping_size);
+	}
+
+	// Fields
+	view source;
+	const void * array = nullptr;
+	uint32_t width = 4;
+	std::vector<uint32_t> narrow;
+	std::vector<uint64_t> wide;
+	std::vector<char> contents;
+	void * mapping = nullptr;
+	size_t mapping_size = 0;
+};
+
+/// @}
+
+// Close namespace "ext"
+}
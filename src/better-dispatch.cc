@@ -0,0 +1,92 @@
+// Runtime instruction set dispatch for the string kernels
+
+#include "better-kernels.hh"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Namespace for std extensions
+namespace ext {
+
+// Namespace for string kernels
+namespace kernels {
+
+#if defined(BETTER_KERNELS_X86)
+
+// Kernels compiled for each instruction set (better-kernels.cc)
+namespace sse42 { auto table() -> const Table &; }
+namespace avx2 { auto table() -> const Table &; }
+namespace avx512 { auto table() -> const Table &; }
+
+#endif
+
+// Returns true, if the processor (and the operating system) supports the instruction set
+static auto supported(Isa isa) -> bool
+{
+#if defined(BETTER_KERNELS_X86)
+	__builtin_cpu_init();
+	switch (isa)
+	{
+		case Isa::Scalar:
+			return true;
+		case Isa::SSE42:
+			return __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt");
+		case Isa::AVX2:
+			return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi") && __builtin_cpu_supports("bmi2") &&
+				__builtin_cpu_supports("popcnt");
+		case Isa::AVX512:
+			return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+				__builtin_cpu_supports("avx512vl") && __builtin_cpu_supports("bmi2") && __builtin_cpu_supports("popcnt");
+	}
+	return false;
+#else
+	return isa == Isa::Scalar;
+#endif
+}
+
+auto table(Isa isa) -> const Table *
+{
+	if (!supported(isa))
+		return nullptr;
+
+	switch (isa)
+	{
+		case Isa::Scalar:
+			return &scalar::table();
+#if defined(BETTER_KERNELS_X86)
+		case Isa::SSE42:
+			return &sse42::table();
+		case Isa::AVX2:
+			return &avx2::table();
+		case Isa::AVX512:
+			return &avx512::table();
+#endif
+		default:
+			return nullptr;
+	}
+}
+
+// Select the kernels (the BETTER_STRING_ISA environment variable can select a slower instruction set)
+static auto select() -> const Table &
+{
+	const char * name = getenv("BETTER_STRING_ISA");
+	for (size_t i = isa_count; i > 0; -- i)
+	{
+		const Table * kernels = table(Isa(i - 1));
+		if (kernels && (!name || !*name || strcmp(name, kernels->name) == 0))
+			return *kernels;
+	}
+	return scalar::table();
+}
+
+auto active() -> const Table &
+{
+	static const Table & kernels = select();
+	return kernels;
+}
+
+// Close namespace "kernels"
+}
+
+// Close namespace "ext"
+}
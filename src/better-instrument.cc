@@ -0,0 +1,86 @@
+// Replacement allocation functions, counting the allocations of each thread for the instrumentation
+
+#include "better-instrument.hh"
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <new>
+
+// Allocate memory (throws std::bad_alloc on failure)
+static auto allocate(size_t size) -> void *
+{
+	++ ext::instrument::allocations;
+	for (;;)
+	{
+		if (void * ptr = malloc(size ? size : 1))
+			return ptr;
+		std::new_handler handler = std::get_new_handler();
+		if (!handler)
+			throw std::bad_alloc();
+		handler();
+	}
+}
+
+// Allocate aligned memory (throws std::bad_alloc on failure)
+static auto allocate(size_t size, std::align_val_t align) -> void *
+{
+	++ ext::instrument::allocations;
+	size_t alignment = std::max(size_t(align), sizeof(void *));
+	for (;;)
+	{
+		void * ptr = nullptr;
+		if (posix_memalign(&ptr, alignment, size ? size : 1) == 0)
+			return ptr;
+		std::new_handler handler = std::get_new_handler();
+		if (!handler)
+			throw std::bad_alloc();
+		handler();
+	}
+}
+
+// Allocation
+auto operator new (size_t size) -> void *
+	{return allocate(size);}
+auto operator new [] (size_t size) -> void *
+	{return allocate(size);}
+auto operator new (size_t size, std::align_val_t align) -> void *
+	{return allocate(size, align);}
+auto operator new [] (size_t size, std::align_val_t align) -> void *
+	{return allocate(size, align);}
+
+// Allocation (nothrow)
+auto operator new (size_t size, const std::nothrow_t &) noexcept -> void *
+	{try {return allocate(size);} catch (...) {return nullptr;}}
+auto operator new [] (size_t size, const std::nothrow_t &) noexcept -> void *
+	{try {return allocate(size);} catch (...) {return nullptr;}}
+auto operator new (size_t size, std::align_val_t align, const std::nothrow_t &) noexcept -> void *
+	{try {return allocate(size, align);} catch (...) {return nullptr;}}
+auto operator new [] (size_t size, std::align_val_t align, const std::nothrow_t &) noexcept -> void *
+	{try {return allocate(size, align);} catch (...) {return nullptr;}}
+
+// Deallocation (malloc and posix_memalign are both released with free)
+void operator delete (void * ptr) noexcept
+	{free(ptr);}
+void operator delete [] (void * ptr) noexcept
+	{free(ptr);}
+void operator delete (void * ptr, size_t) noexcept
+	{free(ptr);}
+void operator delete [] (void * ptr, size_t) noexcept
+	{free(ptr);}
+void operator delete (void * ptr, std::align_val_t) noexcept
+	{free(ptr);}
+void operator delete [] (void * ptr, std::align_val_t) noexcept
+	{free(ptr);}
+void operator delete (void * ptr, size_t, std::align_val_t) noexcept
+	{free(ptr);}
+void operator delete [] (void * ptr, size_t, std::align_val_t) noexcept
+	{free(ptr);}
+void operator delete (void * ptr, const std::nothrow_t &) noexcept
+	{free(ptr);}
+void operator delete [] (void * ptr, const std::nothrow_t &) noexcept
+	{free(ptr);}
+void operator delete (void * ptr, std::align_val_t, const std::nothrow_t &) noexcept
+	{free(ptr);}
+void operator delete [] (void * ptr, std::align_val_t, const std::nothrow_t &) noexcept
+	{free(ptr);}
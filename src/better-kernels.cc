@@ -0,0 +1,1043 @@
+// String kernels, compiled once for each instruction set
+//
+// This file is compiled several times, with different compiler flags, and BETTER_KERNELS_ISA set to the name of the
+// instruction set (sse42, avx2 or avx512). Everything except the table is in an anonymous namespace, and no inline
+// function of the headers is called, so the code compiled for newer instruction sets cannot leak into the rest of the
+// program through the linker.
+
+#include "better-kernels.hh"
+
+#include <immintrin.h>
+
+#if !defined(BETTER_KERNELS_ISA)
+#error "BETTER_KERNELS_ISA must be defined"
+#endif
+
+// Namespace for std extensions
+namespace ext {
+
+// Namespace for string kernels
+namespace kernels {
+
+namespace {
+
+//	------------------------------------------------------------
+//		Vectors
+//	------------------------------------------------------------
+
+#if defined(__AVX512BW__)
+
+// Vector of 64 bytes (AVX-512)
+struct vec
+{
+	static constexpr size_t width = 64;
+	static constexpr Isa isa = Isa::AVX512;
+	static constexpr const char * name = "avx512";
+	__m512i v;
+
+	// Create vectors
+	static auto load(const void * ptr) -> vec
+		{return {_mm512_loadu_si512(ptr)};}
+	static auto splat(uint8_t ch) -> vec
+		{return {_mm512_set1_epi8(char(ch))};}
+	static auto splat32(uint32_t x) -> vec
+		{return {_mm512_set1_epi32(int(x))};}
+	static auto table(const uint8_t (& t)[16]) -> vec
+		{return {_mm512_broadcast_i32x4(_mm_loadu_si128(reinterpret_cast<const __m128i *>(t)))};}
+
+	// Store vectors
+	void store(void * ptr) const
+		{_mm512_storeu_si512(ptr, v);}
+	void widen16(char16_t * ptr) const
+	{
+		_mm512_storeu_si512(ptr, _mm512_cvtepu8_epi16(_mm512_castsi512_si256(v)));
+		_mm512_storeu_si512(ptr + 32, _mm512_cvtepu8_epi16(_mm512_extracti64x4_epi64(v, 1)));
+	}
+	void widen32(char32_t * ptr) const
+	{
+		_mm512_storeu_si512(ptr, _mm512_cvtepu8_epi32(_mm512_extracti32x4_epi32(v, 0)));
+		_mm512_storeu_si512(ptr + 16, _mm512_cvtepu8_epi32(_mm512_extracti32x4_epi32(v, 1)));
+		_mm512_storeu_si512(ptr + 32, _mm512_cvtepu8_epi32(_mm512_extracti32x4_epi32(v, 2)));
+		_mm512_storeu_si512(ptr + 48, _mm512_cvtepu8_epi32(_mm512_extracti32x4_epi32(v, 3)));
+	}
+
+	// Lanes of 12 bytes (base64, the last 4 bytes of each lane are read and written too)
+	static auto load12(const char * ptr) -> vec
+	{
+		__m512i result = _mm512_castsi128_si512(_mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr)));
+		result = _mm512_inserti32x4(result, _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr + 12)), 1);
+		result = _mm512_inserti32x4(result, _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr + 24)), 2);
+		result = _mm512_inserti32x4(result, _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr + 36)), 3);
+		return {result};
+	}
+	void store12(char * ptr) const
+	{
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(ptr), _mm512_extracti32x4_epi32(v, 0));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(ptr + 12), _mm512_extracti32x4_epi32(v, 1));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(ptr + 24), _mm512_extracti32x4_epi32(v, 2));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(ptr + 36), _mm512_extracti32x4_epi32(v, 3));
+	}
+
+	// Pairs of bytes (hex)
+	void interleave(vec b, char * ptr) const
+	{
+		__m512i low = _mm512_unpacklo_epi8(v, b.v);
+		__m512i high = _mm512_unpackhi_epi8(v, b.v);
+		_mm512_storeu_si512(ptr, _mm512_permutex2var_epi64(low, _mm512_setr_epi64(0, 1, 8, 9, 2, 3, 10, 11), high));
+		_mm512_storeu_si512(ptr + 64, _mm512_permutex2var_epi64(low, _mm512_setr_epi64(4, 5, 12, 13, 6, 7, 14, 15), high));
+	}
+	void narrow16(char * ptr) const
+		{_mm256_storeu_si256(reinterpret_cast<__m256i *>(ptr), _mm512_cvtepi16_epi8(v));}
+
+	// Bitwise operators
+	friend auto operator | (vec a, vec b) -> vec
+		{return {_mm512_or_si512(a.v, b.v)};}
+	friend auto operator & (vec a, vec b) -> vec
+		{return {_mm512_and_si512(a.v, b.v)};}
+	friend auto operator ^ (vec a, vec b) -> vec
+		{return {_mm512_xor_si512(a.v, b.v)};}
+
+	// Arithmetic
+	friend auto operator + (vec a, vec b) -> vec
+		{return {_mm512_add_epi8(a.v, b.v)};}
+	auto saturating_sub(vec b) const -> vec
+		{return {_mm512_subs_epu8(v, b.v)};}
+	auto shr4() const -> vec
+		{return {_mm512_and_si512(_mm512_srli_epi16(v, 4), _mm512_set1_epi8(0x0F))};}
+
+	// Arithmetic on 16 bit elements
+	auto mulhi16(vec b) const -> vec
+		{return {_mm512_mulhi_epu16(v, b.v)};}
+	auto mullo16(vec b) const -> vec
+		{return {_mm512_mullo_epi16(v, b.v)};}
+	auto maddubs(vec b) const -> vec
+		{return {_mm512_maddubs_epi16(v, b.v)};}
+	auto madd16(vec b) const -> vec
+		{return {_mm512_madd_epi16(v, b.v)};}
+
+	// Comparisons (vector results)
+	auto less(vec b) const -> vec
+		{return {_mm512_movm_epi8(_mm512_cmplt_epi8_mask(v, b.v))};}
+	auto equal(vec b) const -> vec
+		{return {_mm512_movm_epi8(_mm512_cmpeq_epi8_mask(v, b.v))};}
+
+	// Comparisons (bit masks)
+	auto eq(vec b) const -> uint64_t
+		{return _mm512_cmpeq_epi8_mask(v, b.v);}
+	auto greater(vec b) const -> uint64_t
+		{return _mm512_cmpgt_epi8_mask(v, b.v);}
+	auto high() const -> uint64_t
+		{return _mm512_movepi8_mask(v);}
+	auto any() const -> bool
+		{return _mm512_test_epi8_mask(v, v) != 0;}
+
+	// Table lookup (each byte must be in the range [0, 16))
+	auto lookup(vec t) const -> vec
+		{return {_mm512_shuffle_epi8(t.v, v)};}
+
+	// The previous vector, shifted by N bytes
+	template<int N>
+	auto prev(vec p) const -> vec
+	{
+		__m512i shifted = _mm512_permutex2var_epi64(p.v, _mm512_setr_epi64(6, 7, 8, 9, 10, 11, 12, 13), v);
+		return {_mm512_alignr_epi8(v, shifted, 16 - N)};
+	}
+};
+
+#elif defined(__AVX2__)
+
+// Vector of 32 bytes (AVX2)
+struct vec
+{
+	static constexpr size_t width = 32;
+	static constexpr Isa isa = Isa::AVX2;
+	static constexpr const char * name = "avx2";
+	__m256i v;
+
+	// Create vectors
+	static auto load(const void * ptr) -> vec
+		{return {_mm256_loadu_si256(static_cast<const __m256i *>(ptr))};}
+	static auto splat(uint8_t ch) -> vec
+		{return {_mm256_set1_epi8(char(ch))};}
+	static auto splat32(uint32_t x) -> vec
+		{return {_mm256_set1_epi32(int(x))};}
+	static auto table(const uint8_t (& t)[16]) -> vec
+		{return {_mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(t)))};}
+
+	// Store vectors
+	void store(void * ptr) const
+		{_mm256_storeu_si256(static_cast<__m256i *>(ptr), v);}
+	void widen16(char16_t * ptr) const
+	{
+		auto out = reinterpret_cast<__m256i *>(ptr);
+		_mm256_storeu_si256(out, _mm256_cvtepu8_epi16(_mm256_castsi256_si128(v)));
+		_mm256_storeu_si256(out + 1, _mm256_cvtepu8_epi16(_mm256_extracti128_si256(v, 1)));
+	}
+	void widen32(char32_t * ptr) const
+	{
+		auto out = reinterpret_cast<__m256i *>(ptr);
+		__m128i low = _mm256_castsi256_si128(v);
+		__m128i high = _mm256_extracti128_si256(v, 1);
+		_mm256_storeu_si256(out, _mm256_cvtepu8_epi32(low));
+		_mm256_storeu_si256(out + 1, _mm256_cvtepu8_epi32(_mm_srli_si128(low, 8)));
+		_mm256_storeu_si256(out + 2, _mm256_cvtepu8_epi32(high));
+		_mm256_storeu_si256(out + 3, _mm256_cvtepu8_epi32(_mm_srli_si128(high, 8)));
+	}
+
+	// Lanes of 12 bytes (base64, the last 4 bytes of each lane are read and written too)
+	static auto load12(const char * ptr) -> vec
+	{
+		__m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr));
+		__m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr + 12));
+		return {_mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1)};
+	}
+	void store12(char * ptr) const
+	{
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(ptr), _mm256_castsi256_si128(v));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(ptr + 12), _mm256_extracti128_si256(v, 1));
+	}
+
+	// Pairs of bytes (hex)
+	void interleave(vec b, char * ptr) const
+	{
+		auto out = reinterpret_cast<__m256i *>(ptr);
+		__m256i low = _mm256_unpacklo_epi8(v, b.v);
+		__m256i high = _mm256_unpackhi_epi8(v, b.v);
+		_mm256_storeu_si256(out, _mm256_permute2x128_si256(low, high, 0x20));
+		_mm256_storeu_si256(out + 1, _mm256_permute2x128_si256(low, high, 0x31));
+	}
+	void narrow16(char * ptr) const
+	{
+		__m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(v, v), 0x08);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(ptr), _mm256_castsi256_si128(packed));
+	}
+
+	// Bitwise operators
+	friend auto operator | (vec a, vec b) -> vec
+		{return {_mm256_or_si256(a.v, b.v)};}
+	friend auto operator & (vec a, vec b) -> vec
+		{return {_mm256_and_si256(a.v, b.v)};}
+	friend auto operator ^ (vec a, vec b) -> vec
+		{return {_mm256_xor_si256(a.v, b.v)};}
+
+	// Arithmetic
+	friend auto operator + (vec a, vec b) -> vec
+		{return {_mm256_add_epi8(a.v, b.v)};}
+	auto saturating_sub(vec b) const -> vec
+		{return {_mm256_subs_epu8(v, b.v)};}
+	auto shr4() const -> vec
+		{return {_mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(0x0F))};}
+
+	// Arithmetic on 16 bit elements
+	auto mulhi16(vec b) const -> vec
+		{return {_mm256_mulhi_epu16(v, b.v)};}
+	auto mullo16(vec b) const -> vec
+		{return {_mm256_mullo_epi16(v, b.v)};}
+	auto maddubs(vec b) const -> vec
+		{return {_mm256_maddubs_epi16(v, b.v)};}
+	auto madd16(vec b) const -> vec
+		{return {_mm256_madd_epi16(v, b.v)};}
+
+	// Comparisons (vector results)
+	auto less(vec b) const -> vec
+		{return {_mm256_cmpgt_epi8(b.v, v)};}
+	auto equal(vec b) const -> vec
+		{return {_mm256_cmpeq_epi8(v, b.v)};}
+
+	// Comparisons (bit masks)
+	auto eq(vec b) const -> uint64_t
+		{return uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, b.v)));}
+	auto greater(vec b) const -> uint64_t
+		{return uint32_t(_mm256_movemask_epi8(_mm256_cmpgt_epi8(v, b.v)));}
+	auto high() const -> uint64_t
+		{return uint32_t(_mm256_movemask_epi8(v));}
+	auto any() const -> bool
+		{return !_mm256_testz_si256(v, v);}
+
+	// Table lookup (each byte must be in the range [0, 16))
+	auto lookup(vec t) const -> vec
+		{return {_mm256_shuffle_epi8(t.v, v)};}
+
+	// The previous vector, shifted by N bytes
+	template<int N>
+	auto prev(vec p) const -> vec
+		{return {_mm256_alignr_epi8(v, _mm256_permute2x128_si256(p.v, v, 0x21), 16 - N)};}
+};
+
+#elif defined(__SSE4_2__)
+
+// Vector of 16 bytes (SSE4.2)
+struct vec
+{
+	static constexpr size_t width = 16;
+	static constexpr Isa isa = Isa::SSE42;
+	static constexpr const char * name = "sse4.2";
+	__m128i v;
+
+	// Create vectors
+	static auto load(const void * ptr) -> vec
+		{return {_mm_loadu_si128(static_cast<const __m128i *>(ptr))};}
+	static auto splat(uint8_t ch) -> vec
+		{return {_mm_set1_epi8(char(ch))};}
+	static auto splat32(uint32_t x) -> vec
+		{return {_mm_set1_epi32(int(x))};}
+	static auto table(const uint8_t (& t)[16]) -> vec
+		{return {_mm_loadu_si128(reinterpret_cast<const __m128i *>(t))};}
+
+	// Store vectors
+	void store(void * ptr) const
+		{_mm_storeu_si128(static_cast<__m128i *>(ptr), v);}
+	void widen16(char16_t * ptr) const
+	{
+		auto out = reinterpret_cast<__m128i *>(ptr);
+		__m128i zero = _mm_setzero_si128();
+		_mm_storeu_si128(out, _mm_unpacklo_epi8(v, zero));
+		_mm_storeu_si128(out + 1, _mm_unpackhi_epi8(v, zero));
+	}
+	void widen32(char32_t * ptr) const
+	{
+		auto out = reinterpret_cast<__m128i *>(ptr);
+		__m128i zero = _mm_setzero_si128();
+		__m128i low = _mm_unpacklo_epi8(v, zero);
+		__m128i high = _mm_unpackhi_epi8(v, zero);
+		_mm_storeu_si128(out, _mm_unpacklo_epi16(low, zero));
+		_mm_storeu_si128(out + 1, _mm_unpackhi_epi16(low, zero));
+		_mm_storeu_si128(out + 2, _mm_unpacklo_epi16(high, zero));
+		_mm_storeu_si128(out + 3, _mm_unpackhi_epi16(high, zero));
+	}
+
+	// Lanes of 12 bytes (base64, the last 4 bytes of each lane are read and written too)
+	static auto load12(const char * ptr) -> vec
+		{return {_mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr))};}
+	void store12(char * ptr) const
+		{_mm_storeu_si128(reinterpret_cast<__m128i *>(ptr), v);}
+
+	// Pairs of bytes (hex)
+	void interleave(vec b, char * ptr) const
+	{
+		auto out = reinterpret_cast<__m128i *>(ptr);
+		_mm_storeu_si128(out, _mm_unpacklo_epi8(v, b.v));
+		_mm_storeu_si128(out + 1, _mm_unpackhi_epi8(v, b.v));
+	}
+	void narrow16(char * ptr) const
+		{_mm_storel_epi64(reinterpret_cast<__m128i *>(ptr), _mm_packus_epi16(v, v));}
+
+	// Bitwise operators
+	friend auto operator | (vec a, vec b) -> vec
+		{return {_mm_or_si128(a.v, b.v)};}
+	friend auto operator & (vec a, vec b) -> vec
+		{return {_mm_and_si128(a.v, b.v)};}
+	friend auto operator ^ (vec a, vec b) -> vec
+		{return {_mm_xor_si128(a.v, b.v)};}
+
+	// Arithmetic
+	friend auto operator + (vec a, vec b) -> vec
+		{return {_mm_add_epi8(a.v, b.v)};}
+	auto saturating_sub(vec b) const -> vec
+		{return {_mm_subs_epu8(v, b.v)};}
+	auto shr4() const -> vec
+		{return {_mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0F))};}
+
+	// Arithmetic on 16 bit elements
+	auto mulhi16(vec b) const -> vec
+		{return {_mm_mulhi_epu16(v, b.v)};}
+	auto mullo16(vec b) const -> vec
+		{return {_mm_mullo_epi16(v, b.v)};}
+	auto maddubs(vec b) const -> vec
+		{return {_mm_maddubs_epi16(v, b.v)};}
+	auto madd16(vec b) const -> vec
+		{return {_mm_madd_epi16(v, b.v)};}
+
+	// Comparisons (vector results)
+	auto less(vec b) const -> vec
+		{return {_mm_cmplt_epi8(v, b.v)};}
+	auto equal(vec b) const -> vec
+		{return {_mm_cmpeq_epi8(v, b.v)};}
+
+	// Comparisons (bit masks)
+	auto eq(vec b) const -> uint64_t
+		{return uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, b.v)));}
+	auto greater(vec b) const -> uint64_t
+		{return uint32_t(_mm_movemask_epi8(_mm_cmpgt_epi8(v, b.v)));}
+	auto high() const -> uint64_t
+		{return uint32_t(_mm_movemask_epi8(v));}
+	auto any() const -> bool
+		{return !_mm_testz_si128(v, v);}
+
+	// Table lookup (each byte must be in the range [0, 16))
+	auto lookup(vec t) const -> vec
+		{return {_mm_shuffle_epi8(t.v, v)};}
+
+	// The previous vector, shifted by N bytes
+	template<int N>
+	auto prev(vec p) const -> vec
+		{return {_mm_alignr_epi8(v, p.v, 16 - N)};}
+};
+
+#else
+#error "No supported instruction set is enabled"
+#endif
+
+// Vector width
+static constexpr size_t W = vec::width;
+
+// Mask of every byte of a vector
+static constexpr uint64_t all_bytes = (W == 64) ? ~uint64_t(0) : (uint64_t(1) << (W % 64)) - 1;
+
+//	------------------------------------------------------------
+//		Helpers
+//	------------------------------------------------------------
+
+// Index of the lowest set bit
+inline auto lowest(uint64_t mask) -> size_t
+	{return size_t(__builtin_ctzll(mask));}
+
+// Number of set bits
+inline auto popcount(uint64_t mask) -> size_t
+	{return size_t(__builtin_popcountll(mask));}
+
+// Membership test of a byte set (the bits of the low nibbles are looked up in the set, and the bit of the high nibble
+// is selected)
+class Members
+{
+public:
+	explicit Members(const ByteSet & set)
+		: low(vec::table(set.low)), high(vec::table(set.high)) {}
+
+	// Mask of the bytes in the set
+	auto operator () (vec input) const -> uint64_t
+	{
+		static const uint8_t bits[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+		vec index = input & vec::splat(0x0F);
+		vec selected = input.shr4().lookup(vec::table(bits));
+		vec zero = vec::splat(0);
+		uint64_t upper = input.high();
+		return (~(index.lookup(low) & selected).eq(zero) & all_bytes & ~upper) | (~(index.lookup(high) & selected).eq(zero) & upper);
+	}
+
+private:
+	// Fields
+	vec low;
+	vec high;
+};
+
+// Loads the last (partial) block, padded with zeros
+inline auto load_partial(const char * data, size_t size) -> vec
+{
+	char buffer[W] = {};
+	if (size)
+		memcpy(buffer, data, size);
+	return vec::load(buffer);
+}
+
+//	------------------------------------------------------------
+//		UTF-8 validation
+//	------------------------------------------------------------
+
+// Validation based on "Validating UTF-8 In Less Than One Instruction Per Byte" (John Keiser, Daniel Lemire). The
+// first two bytes of each sequence are classified with table lookups, and the expected continuation bytes of three and
+// four byte sequences are checked separately.
+
+// Error classes
+static constexpr uint8_t TOO_SHORT   = 1 << 0;	// 11______ 0_______ or 11______ 11______
+static constexpr uint8_t TOO_LONG    = 1 << 1;	// 0_______ 10______
+static constexpr uint8_t OVERLONG_3  = 1 << 2;	// 11100000 100_____
+static constexpr uint8_t TOO_LARGE   = 1 << 3;	// 11110100 1001____, 11110100 101_____, 11110101 ________, ...
+static constexpr uint8_t SURROGATE   = 1 << 4;	// 11101101 101_____
+static constexpr uint8_t OVERLONG_2  = 1 << 5;	// 1100000_ 10______
+static constexpr uint8_t TOO_LARGE_1000 = 1 << 6;	// 11110101 1000____, ...
+static constexpr uint8_t OVERLONG_4  = 1 << 6;	// 11110000 1000____
+static constexpr uint8_t TWO_CONTS   = 1 << 7;	// 10______ 10______
+static constexpr uint8_t CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS;
+
+// Error classes, by the high nibble of the first byte
+static constexpr uint8_t byte1_high[16] = {
+	// 0_______ (ASCII)
+	TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+	// 10______ (continuation)
+	TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+	// 1100____, 1101____ (two byte lead)
+	TOO_SHORT | OVERLONG_2, TOO_SHORT,
+	// 1110____ (three byte lead)
+	TOO_SHORT | OVERLONG_3 | SURROGATE,
+	// 1111____ (four byte lead)
+	TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4,
+};
+
+// Error classes, by the low nibble of the first byte
+static constexpr uint8_t byte1_low[16] = {
+	CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,	// ____0000
+	CARRY | OVERLONG_2,	// ____0001
+	CARRY,	// ____0010
+	CARRY,	// ____0011
+	CARRY | TOO_LARGE,	// ____0100
+	CARRY | TOO_LARGE | TOO_LARGE_1000,	// ____0101
+	CARRY | TOO_LARGE | TOO_LARGE_1000,	// ____0110
+	CARRY | TOO_LARGE | TOO_LARGE_1000,	// ____0111
+	CARRY | TOO_LARGE | TOO_LARGE_1000,	// ____1000
+	CARRY | TOO_LARGE | TOO_LARGE_1000,	// ____1001
+	CARRY | TOO_LARGE | TOO_LARGE_1000,	// ____1010
+	CARRY | TOO_LARGE | TOO_LARGE_1000,	// ____1011
+	CARRY | TOO_LARGE | TOO_LARGE_1000,	// ____1100
+	CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,	// ____1101
+	CARRY | TOO_LARGE | TOO_LARGE_1000,	// ____1110
+	CARRY | TOO_LARGE | TOO_LARGE_1000,	// ____1111
+};
+
+// Error classes, by the high nibble of the second byte
+static constexpr uint8_t byte2_high[16] = {
+	// 0_______ (ASCII)
+	TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+	// 1000____
+	TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+	// 1001____
+	TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+	// 101_____
+	TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+	TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+	// 11______ (lead)
+	TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+};
+
+// Maximum values of the last three bytes of a block, that do not start an incomplete sequence
+static const uint8_t incomplete_max[64] = {
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 0xF0 - 1, 0xE0 - 1, 0xC0 - 1,
+};
+
+// UTF-8 validator state
+class Validator
+{
+public:
+	// Check the next block
+	void next(vec input)
+	{
+		if (input.high())
+		{
+			// Check two byte sequences
+			vec prev1 = input.prev<1>(previous);
+			vec special = prev1.shr4().lookup(vec::table(byte1_high)) &
+				(prev1 & vec::splat(0x0F)).lookup(vec::table(byte1_low)) &
+				input.shr4().lookup(vec::table(byte2_high));
+
+			// Check continuation bytes of three and four byte sequences
+			vec prev2 = input.prev<2>(previous);
+			vec prev3 = input.prev<3>(previous);
+			vec must23 = prev2.saturating_sub(vec::splat(0xE0 - 0x80)) | prev3.saturating_sub(vec::splat(0xF0 - 0x80));
+			error = error | ((must23 & vec::splat(0x80)) ^ special);
+
+			// Check for incomplete sequences at the end of the block
+			incomplete = input.saturating_sub(vec::load(incomplete_max + sizeof(incomplete_max) - W));
+		}
+		else
+			error = error | incomplete;
+		previous = input;
+	}
+
+	// Check the end of the text
+	auto finish() -> bool
+		{return !(error | incomplete).any();}
+
+private:
+	// Fields
+	vec error = vec::splat(0);
+	vec previous = vec::splat(0);
+	vec incomplete = vec::splat(0);
+};
+
+//	------------------------------------------------------------
+//		Kernels
+//	------------------------------------------------------------
+
+// Kernel - find_byte
+auto find_byte(const char * data, size_t size, char ch) -> size_t
+{
+	vec needle = vec::splat(uint8_t(ch));
+	size_t i = 0;
+
+	// Check whole blocks
+	for (; i + W <= size; i += W)
+		if (uint64_t mask = vec::load(data + i).eq(needle))
+			return i + lowest(mask);
+
+	// Check the rest
+	for (; i < size; ++ i)
+		if (data[i] == ch)
+			return i;
+	return size_t(-1);
+}
+
+// Kernel - find_any
+auto find_any(const char * data, size_t size, const ByteSet & set) -> size_t
+{
+	Members members(set);
+	size_t i = 0;
+
+	// Check whole blocks
+	for (; i + W <= size; i += W)
+		if (uint64_t mask = members(vec::load(data + i)))
+			return i + lowest(mask);
+
+	// Check the rest
+	for (; i < size; ++ i)
+	{
+		uint8_t ch = uint8_t(data[i]);
+		if (((ch < 0x80 ? set.low : set.high)[ch & 0x0F] >> ((ch >> 4) & 7)) & 1)
+			return i;
+	}
+	return size_t(-1);
+}
+
+// Kernel - count_byte
+auto count_byte(const char * data, size_t size, char ch) -> size_t
+{
+	vec needle = vec::splat(uint8_t(ch));
+	size_t count = 0;
+	size_t i = 0;
+
+	// Count in whole blocks
+	for (; i + W <= size; i += W)
+		count += popcount(vec::load(data + i).eq(needle));
+
+	// Count the rest
+	for (; i < size; ++ i)
+		count += (data[i] == ch);
+	return count;
+}
+
+// Kernel - find (compares the first and the last character of the substring at every position, then the rest)
+auto find(const char * data, size_t size, const char * sub, size_t length) -> size_t
+{
+	// Check length
+	if (length == 0)
+		return 0;
+	if (size < length)
+		return size_t(-1);
+	if (length == 1)
+		return find_byte(data, size, sub[0]);
+
+	vec first = vec::splat(uint8_t(sub[0]));
+	vec last = vec::splat(uint8_t(sub[length - 1]));
+	size_t i = 0;
+
+	// Check whole blocks
+	for (; i + W + length - 1 <= size; i += W)
+	{
+		uint64_t mask = vec::load(data + i).eq(first) & vec::load(data + i + length - 1).eq(last);
+		for (; mask; mask &= mask - 1)
+		{
+			size_t pos = i + lowest(mask);
+			if (memcmp(data + pos + 1, sub + 1, length - 2) == 0)
+				return pos;
+		}
+	}
+
+	// Check the rest
+	for (; i + length <= size; ++ i)
+		if (data[i] == sub[0] && memcmp(data + i + 1, sub + 1, length - 1) == 0)
+			return i;
+	return size_t(-1);
+}
+
+// Kernel - ascii_prefix
+auto ascii_prefix(const char * data, size_t size) -> size_t
+{
+	size_t i = 0;
+
+	// Check whole blocks
+	for (; i + W <= size; i += W)
+		if (uint64_t mask = vec::load(data + i).high())
+			return i + lowest(mask);
+
+	// Check the rest
+	for (; i < size; ++ i)
+		if (uint8_t(data[i]) >= 0x80)
+			break;
+	return i;
+}
+
+// Kernel - utf8_length (validates the text, and counts the bytes that are not continuation bytes)
+auto utf8_length(const char * data, size_t size) -> size_t
+{
+	Validator validator;
+	vec tail = vec::splat(0xC0 - 1);
+	size_t length = 0;
+	size_t i = 0;
+
+	// Check whole blocks
+	for (; i + W <= size; i += W)
+	{
+		vec input = vec::load(data + i);
+		validator.next(input);
+		length += popcount(input.greater(tail));
+	}
+
+	// Check the rest (the padding is counted as ASCII)
+	vec input = load_partial(data + i, size - i);
+	validator.next(input);
+	length += popcount(input.greater(tail)) - (W - (size - i));
+
+	return validator.finish() ? length : size_t(-1);
+}
+
+// Kernel - utf16_prefix (the high bytes of the units are at odd offsets)
+auto utf16_prefix(const char16_t * data, size_t size) -> size_t
+{
+	vec top = vec::splat(0xF8);
+	vec surrogate = vec::splat(0xD8);
+	size_t i = 0;
+
+	// Check whole blocks
+	for (; i + W / 2 <= size; i += W / 2)
+		if (uint64_t mask = (vec::load(data + i) & top).eq(surrogate) & 0xAAAAAAAAAAAAAAAAull)
+			return i + lowest(mask) / 2;
+
+	// Check the rest
+	for (; i < size; ++ i)
+		if ((data[i] & 0xF800) == 0xD800)
+			break;
+	return i;
+}
+
+// Kernel - escape_prefix
+auto escape_prefix(const char * data, size_t size, bool ascii) -> size_t
+{
+	vec quote = vec::splat('"');
+	vec apostrophe = vec::splat('\'');
+	vec backslash = vec::splat('\\');
+	vec space = vec::splat(0x20 - 1);
+	size_t i = 0;
+
+	// Check whole blocks (the signed comparison finds the control characters and the bytes above 0x7F)
+	for (; i + W <= size; i += W)
+	{
+		vec input = vec::load(data + i);
+		uint64_t special = input.eq(quote) | input.eq(apostrophe) | input.eq(backslash) |
+			(~input.greater(space) & all_bytes & (ascii ? all_bytes : ~input.high()));
+		if (special)
+			return i + lowest(special);
+	}
+
+	// Check the rest
+	for (; i < size; ++ i)
+	{
+		uint8_t ch = uint8_t(data[i]);
+		if (ch < 0x20 || ch == '"' || ch == '\'' || ch == '\\' || (ascii && ch >= 0x80))
+			break;
+	}
+	return i;
+}
+
+// Kernel - widen16
+void widen16(const char * data, size_t size, char16_t * output)
+{
+	size_t i = 0;
+	for (; i + W <= size; i += W)
+		vec::load(data + i).widen16(output + i);
+	for (; i < size; ++ i)
+		output[i] = char16_t(uint8_t(data[i]));
+}
+
+// Kernel - widen32
+void widen32(const char * data, size_t size, char32_t * output)
+{
+	size_t i = 0;
+	for (; i + W <= size; i += W)
+		vec::load(data + i).widen32(output + i);
+	for (; i < size; ++ i)
+		output[i] = char32_t(uint8_t(data[i]));
+}
+
+// Maps letters in the range [first, first + 26) by toggling bit 5
+template<char First>
+void map_case(const char * data, size_t size, char * output)
+{
+	// Move the range to the bottom of the signed range, so one comparison is enough
+	vec offset = vec::splat(uint8_t(0x80 - First));
+	vec limit = vec::splat(uint8_t(0x80 + 26));
+	vec bit = vec::splat(0x20);
+	size_t i = 0;
+
+	for (; i + W <= size; i += W)
+	{
+		vec input = vec::load(data + i);
+		(input ^ ((input + offset).less(limit) & bit)).store(output + i);
+	}
+	for (; i < size; ++ i)
+		output[i] = (data[i] >= First && data[i] < First + 26) ? char(data[i] ^ 0x20) : data[i];
+}
+
+// Kernel - upper
+void upper(const char * data, size_t size, char * output)
+	{map_case<'a'>(data, size, output);}
+
+// Kernel - lower
+void lower(const char * data, size_t size, char * output)
+	{map_case<'A'>(data, size, output);}
+
+//	------------------------------------------------------------
+//		Base64 and hex
+//	------------------------------------------------------------
+
+// Base64 based on "Faster Base64 Encoding and Decoding Using AVX2 Instructions" (Wojciech Mula, Daniel Lemire). The
+// vectors are split into lanes of 16 bytes, each holding 12 bytes of binary data, or 16 characters.
+
+// Offsets from the values to the characters, by the class of the value (see b64encode)
+static const uint8_t b64_offsets[2][16] = {
+	{'a' - 26, uint8_t('0' - 52), uint8_t('0' - 52), uint8_t('0' - 52), uint8_t('0' - 52), uint8_t('0' - 52),
+		uint8_t('0' - 52), uint8_t('0' - 52), uint8_t('0' - 52), uint8_t('0' - 52), uint8_t('0' - 52),
+		uint8_t('+' - 62), uint8_t('/' - 63), 'A', 0, 0},
+	{'a' - 26, uint8_t('0' - 52), uint8_t('0' - 52), uint8_t('0' - 52), uint8_t('0' - 52), uint8_t('0' - 52),
+		uint8_t('0' - 52), uint8_t('0' - 52), uint8_t('0' - 52), uint8_t('0' - 52), uint8_t('0' - 52),
+		uint8_t('-' - 62), uint8_t('_' - 63), 'A', 0, 0},
+};
+
+// Offsets from the characters to the values, by the high nibble (and 1 for '/', see b64decode)
+static const uint8_t b64_rolls[16] = {0, 16, 19, 4, uint8_t(-65), uint8_t(-65), uint8_t(-71), uint8_t(-71)};
+
+// Characters of the alphabets
+static constexpr ByteSet b64_alphabets[2] = {
+	ByteSet::of([] (uint8_t ch) {return scalar::b64_standard_values.value[ch] != 0xFF;}),
+	ByteSet::of([] (uint8_t ch) {return scalar::b64_url_values.value[ch] != 0xFF;}),
+};
+
+// Hexadecimal digits
+static constexpr ByteSet hex_digits = ByteSet::of([] (uint8_t ch) {return scalar::hex_values.value[ch] != 0xFF;});
+
+// Kernel - b64encode
+void b64encode(const char * data, size_t size, char * output, bool url)
+{
+	// Bytes of each group of 3, arranged for the shifts of the multiplications
+	static const uint8_t arrange[16] = {1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10};
+	vec order = vec::table(arrange);
+	vec offsets = vec::table(b64_offsets[url]);
+	vec letters = vec::splat(26);
+	vec digits = vec::splat(51);
+	vec upper = vec::splat(13);
+	size_t i = 0;
+
+	// Encode whole blocks (the last 4 bytes of the input are never encoded here, because they are read too)
+	for (; i + W / 4 * 3 + 4 <= size; i += W / 4 * 3, output += W)
+	{
+		// Split the groups into 6 bit values (one in each byte)
+		vec input = order.lookup(vec::load12(data + i));
+		vec values = (input & vec::splat32(0x0FC0FC00)).mulhi16(vec::splat32(0x04000040)) |
+			(input & vec::splat32(0x003F03F0)).mullo16(vec::splat32(0x01000010));
+
+		// Classes: 0 for lower case letters, 1-12 for the digits and the last two characters, 13 for upper case letters
+		vec classes = values.saturating_sub(digits) | (values.less(letters) & upper);
+		(values + classes.lookup(offsets)).store(output);
+	}
+
+	// Encode the rest
+	const char * alphabet = url ? scalar::b64_url : scalar::b64_standard;
+	for (; i + 3 <= size; i += 3, output += 4)
+	{
+		uint32_t group = uint32_t(uint8_t(data[i])) << 16 | uint32_t(uint8_t(data[i + 1])) << 8 | uint8_t(data[i + 2]);
+		output[0] = alphabet[group >> 18];
+		output[1] = alphabet[(group >> 12) & 0x3F];
+		output[2] = alphabet[(group >> 6) & 0x3F];
+		output[3] = alphabet[group & 0x3F];
+	}
+}
+
+// Kernel - b64decode
+auto b64decode(const char * data, size_t size, char * output, bool url) -> size_t
+{
+	// Bytes of the decoded groups (the last 4 bytes of each lane are not used)
+	static const uint8_t arrange[16] = {2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, 3, 7, 11, 15};
+	Members alphabet(b64_alphabets[url]);
+	vec order = vec::table(arrange);
+	vec rolls = vec::table(b64_rolls);
+	vec slash = vec::splat('/');
+	vec dash = vec::splat('-');
+	vec underscore = vec::splat('_');
+	size_t count = 0;
+	size_t i = 0;
+
+	// Decode whole blocks (4 bytes are written after the last group, so the last few groups are decoded by the loop of
+	// the rest)
+	for (; i + W + 8 <= size; i += W, count += W / 4 * 3)
+	{
+		vec input = vec::load(data + i);
+		if (alphabet(input) != all_bytes)
+			return size_t(-1);
+
+		// Map the URL safe alphabet to the standard one, then the characters to their values
+		if (url)
+			input = input ^ (input.equal(dash) & vec::splat('-' ^ '+')) ^ (input.equal(underscore) & vec::splat('_' ^ '/'));
+		vec values = input + (input.equal(slash) + input.shr4()).lookup(rolls);
+
+		// Merge the values into groups of 24 bits, then put their bytes in order
+		vec groups = values.maddubs(vec::splat32(0x01400140)).madd16(vec::splat32(0x00011000));
+		order.lookup(groups).store12(output + count);
+	}
+
+	// Decode the rest
+	auto & values = (url ? scalar::b64_url_values : scalar::b64_standard_values).value;
+	for (; i + 4 <= size; i += 4, count += 3)
+	{
+		uint8_t a = values[uint8_t(data[i])], b = values[uint8_t(data[i + 1])];
+		uint8_t c = values[uint8_t(data[i + 2])], d = values[uint8_t(data[i + 3])];
+		if ((a | b | c | d) & 0x80)
+			return size_t(-1);
+		uint32_t group = uint32_t(a) << 18 | uint32_t(b) << 12 | uint32_t(c) << 6 | d;
+		output[count] = char(group >> 16);
+		output[count + 1] = char(group >> 8);
+		output[count + 2] = char(group);
+	}
+	return count;
+}
+
+// Kernel - hexlify
+void hexlify(const char * data, size_t size, char * output)
+{
+	static const uint8_t digits[16] = {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f'};
+	vec table = vec::table(digits);
+	vec nibble = vec::splat(0x0F);
+	size_t i = 0;
+
+	for (; i + W <= size; i += W)
+	{
+		vec input = vec::load(data + i);
+		input.shr4().lookup(table).interleave((input & nibble).lookup(table), output + 2 * i);
+	}
+	for (; i < size; ++ i)
+	{
+		output[2 * i] = char(digits[uint8_t(data[i]) >> 4]);
+		output[2 * i + 1] = char(digits[uint8_t(data[i]) & 0x0F]);
+	}
+}
+
+// Kernel - unhexlify
+auto unhexlify(const char * data, size_t size, char * output) -> size_t
+{
+	// Letters are the only digits with bit 6 set (bit 2 of the high nibble), and their value is the low nibble + 9
+	static const uint8_t letters[16] = {0, 0, 0, 0, 9};
+	Members digits(hex_digits);
+	vec table = vec::table(letters);
+	vec nibble = vec::splat(0x0F);
+	vec letter = vec::splat(4);
+	size_t i = 0;
+
+	for (; i + W <= size; i += W)
+	{
+		vec input = vec::load(data + i);
+		if (digits(input) != all_bytes)
+			return size_t(-1);
+		vec values = (input & nibble) + (input.shr4() & letter).lookup(table);
+		values.maddubs(vec::splat32(0x01100110)).narrow16(output + i / 2);
+	}
+	for (; i + 2 <= size; i += 2)
+	{
+		uint8_t high = scalar::hex_values.value[uint8_t(data[i])];
+		uint8_t low = scalar::hex_values.value[uint8_t(data[i + 1])];
+		if ((high | low) & 0x80)
+			return size_t(-1);
+		output[i / 2] = char(high << 4 | low);
+	}
+	return size / 2;
+}
+
+//	------------------------------------------------------------
+//		CSV
+//	------------------------------------------------------------
+
+// Structural indexing based on "Parsing Gigabytes of JSON per Second" (Geoff Langdale, Daniel Lemire), as in simdcsv.
+// The quotes, separators and line feeds of 64 bytes are found as bitmasks, and the bytes inside of quotes are masked
+// with the prefix XOR of the quote mask. A quote escaped by doubling toggles the state twice, so it needs no special
+// case. The prefix XOR is computed with shifts instead of a carry-less multiplication, which would need PCLMULQDQ.
+// Quotes only open a quoted field after a separator, a line feed or a quote: the rare blocks with an other opening
+// quote (a literal quote in an unquoted field) are indexed by the portable kernel.
+
+// Prefix XOR of a mask (bit i is the XOR of the bits 0 to i)
+inline auto prefix_xor(uint64_t mask) -> uint64_t
+{
+	mask ^= mask << 1;
+	mask ^= mask << 2;
+	mask ^= mask << 4;
+	mask ^= mask << 8;
+	mask ^= mask << 16;
+	mask ^= mask << 32;
+	return mask;
+}
+
+// Kernel - csv_index
+auto csv_index(const char * data, size_t size, char sep, char quote, CsvState & state, uint32_t * output) -> size_t
+{
+	vec quotes = vec::splat(uint8_t(quote));
+	vec seps = vec::splat(uint8_t(sep));
+	vec lines = vec::splat('\n');
+	size_t count = 0;
+	size_t i = 0;
+
+	// Index blocks of 64 bytes
+	for (; i + 64 <= size; i += 64)
+	{
+		uint64_t quote_mask = 0, structure = 0;
+		for (size_t k = 0; k < 64; k += W)
+		{
+			vec input = vec::load(data + i + k);
+			quote_mask |= input.eq(quotes) << k;
+			structure |= (input.eq(seps) | input.eq(lines)) << k;
+		}
+
+		// Mask the bytes inside of quotes (the state after every byte), and check the opening quotes
+		uint64_t inside = state.quoted ? ~uint64_t(0) : 0;
+		uint64_t masked = prefix_xor(quote_mask) ^ inside;
+		uint64_t boundaries = (structure & ~masked) | quote_mask;
+		if (quote_mask & masked & ~((boundaries << 1) | uint64_t(state.open)))
+		{
+			size_t found = scalar::csv_index(data + i, 64, sep, quote, state, output + count);
+			for (size_t k = count; k < count + found; ++ k)
+				output[k] += uint32_t(i);
+			count += found;
+			continue;
+		}
+
+		// Carry the state of the last byte to the next block
+		state.quoted = (masked >> 63) != 0;
+		state.open = (boundaries >> 63) != 0;
+		for (structure &= ~masked; structure; structure &= structure - 1)
+			output[count ++] = uint32_t(i + lowest(structure));
+	}
+
+	// Index the rest
+	size_t found = scalar::csv_index(data + i, size - i, sep, quote, state, output + count);
+	for (size_t k = count; k < count + found; ++ k)
+		output[k] += uint32_t(i);
+	return count + found;
+}
+
+// Close anonymous namespace
+}
+
+// Namespace for the instruction set
+namespace BETTER_KERNELS_ISA {
+
+// Table of kernels
+auto table() -> const Table &
+{
+	static constexpr Table table = {
+		vec::isa, vec::name,
+		find_byte, count_byte, find_any, find,
+		ascii_prefix, utf8_length, utf16_prefix,
+		escape_prefix,
+		widen16, widen32,
+		upper, lower,
+		b64encode, b64decode, hexlify, unhexlify,
+		csv_index,
+	};
+	return table;
+}
+
+// Close namespace for the instruction set
+}
+
+// Close namespace "kernels"
+}
+
+// Close namespace "ext"
+}
@@ -0,0 +1,305 @@
+#include "better-codec.hh"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Helper functions
+
+#define ASSERT(c) assert(c, #c, __FILE__, __LINE__)
+
+inline void assert(bool condition, const char * message, const char * file, long line)
+{
+	if (!condition)
+	{
+		printf("Assertion Failed: %s\nFile: %s, Line: %ld\n", message, file, line);
+		exit(-1);
+	}
+}
+
+// Returns true if the function throws std::invalid_argument
+template<typename Function>
+auto throws(Function function) -> bool
+{
+	try
+	{
+		function();
+	}
+	catch (const std::invalid_argument &)
+	{
+		return true;
+	}
+	return false;
+}
+
+// Creates a string from bytes
+auto bytes(std::initializer_list<int> list) -> ext::better_string<char>
+{
+	ext::better_string<char> result;
+	for (int byte : list)
+		result.push_back(char(byte));
+	return result;
+}
+
+void test_lookup()
+{
+	using namespace ext;
+
+	// Names are matched without case and punctuation
+	ASSERT(codec::lookup("UTF-8") != nullptr);
+	ASSERT(codec::lookup("utf8") == codec::lookup("UTF-8"));
+	ASSERT(codec::lookup("Utf_8") == codec::lookup("UTF-8"));
+	ASSERT(codec::lookup("latin1") == codec::lookup("ISO-8859-1"));
+	ASSERT(codec::lookup("ISO_8859-1:1987") == codec::lookup("ISO-8859-1"));
+	ASSERT(codec::lookup("cp1252") == codec::lookup("windows-1252"));
+	ASSERT(codec::lookup("ANSI_X3.4-1968") == codec::lookup("us-ascii"));
+	ASSERT(codec::lookup("no-such-charset") == nullptr);
+	ASSERT(codec::lookup("") == nullptr);
+	ASSERT(codec::lookup("---") == nullptr);
+
+	// Encodings
+	ASSERT(codec::lookup(Encoding::UTF8) == codec::lookup("UTF-8"));
+	ASSERT(codec::lookup(Encoding::Win1250) == codec::lookup("windows-1250"));
+	ASSERT(codec::lookup(Encoding::ISO_8859_15) == codec::lookup("latin-9"));
+	ASSERT(codec::lookup(Encoding::Char8) == nullptr);
+	ASSERT(better_string_view<char>(codec::lookup(Encoding::ISO_8859_5)->name) == "ISO-8859-5");
+
+	// Unknown charsets
+	ASSERT(throws([] {codec::decode("no-such-charset", "abc");}));
+	ASSERT(throws([] {codec::encode(Encoding::Char16, "abc");}));
+}
+
+void test_unicode()
+{
+	using namespace ext;
+
+	// UTF-8
+	ASSERT(codec::decode("UTF-8", "h\xC3\xA9llo") == "h\xC3\xA9llo");
+	ASSERT(throws([] {codec::decode("UTF-8", "a\xFF" "b");}));
+	ASSERT(codec::decode("UTF-8", "a\xFF" "b", codec::Errors::Replace) == "a\xEF\xBF\xBD" "b");
+	ASSERT(codec::decode("UTF-8", "a\xFF" "b", codec::Errors::Ignore) == "ab");
+
+	// UTF-16 (with and without byte order mark)
+	ASSERT(codec::decode("UTF-16LE", bytes({'h', 0, 0xE9, 0, 0x3D, 0xD8, 0x00, 0xDE})) == "h\xC3\xA9\xF0\x9F\x98\x80");
+	ASSERT(codec::decode("UTF-16BE", bytes({0, 'h', 0, 0xE9, 0xD8, 0x3D, 0xDE, 0x00})) == "h\xC3\xA9\xF0\x9F\x98\x80");
+	ASSERT(codec::decode("UTF-16", bytes({0xFE, 0xFF, 0, 'h'})) == "h");
+	ASSERT(codec::decode("UTF-16", bytes({0xFF, 0xFE, 'h', 0})) == "h");
+	ASSERT(codec::decode("UTF-16", bytes({'h', 0})) == "h");
+	ASSERT(codec::encode("UTF-16BE", "h\xF0\x9F\x98\x80") == bytes({0, 'h', 0xD8, 0x3D, 0xDE, 0x00}));
+	ASSERT(codec::encode("UTF-16", "h") == bytes({0xFF, 0xFE, 'h', 0}));
+
+	// UTF-16 errors (lone surrogates, and truncated units)
+	ASSERT(throws([] {codec::decode("UTF-16LE", bytes({0x00, 0xDC}));}));
+	ASSERT(codec::decode("UTF-16LE", bytes({0x3D, 0xD8, 'h', 0}), codec::Errors::Replace) == "\xEF\xBF\xBDh");
+	ASSERT(codec::decode("UTF-16LE", bytes({'h', 0, 'i'}), codec::Errors::Ignore) == "h");
+
+	// UTF-32
+	ASSERT(codec::decode("UTF-32LE", bytes({0x00, 0xF6, 0x01, 0x00})) == "\xF0\x9F\x98\x80");
+	ASSERT(codec::decode("UTF-32", bytes({0, 0, 0xFE, 0xFF, 0, 0, 0, 'h'})) == "h");
+	ASSERT(codec::encode("UTF-32BE", "h") == bytes({0, 0, 0, 'h'}));
+	ASSERT(throws([] {codec::decode("UTF-32LE", bytes({0x00, 0x00, 0x11, 0x00}));}));
+
+	// Escape sequences
+	ASSERT(codec::decode("unicode-escape", "a\\n\\u00e9\\U0001F600\\x41") == "a\n\xC3\xA9\xF0\x9F\x98\x80" "A");
+	ASSERT(codec::encode("unicode_escape", "a\n\xC3\xA9") == "a\\n\\u00e9");
+	ASSERT(throws([] {codec::decode("unicode-escape", "a\\q");}));
+	ASSERT(codec::decode("unicode-escape", "a\\q\xFF", codec::Errors::Ignore) == "a");
+
+	// Round trip
+	better_string<char> text = "a\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80z";
+	for (auto name : {"UTF-8", "UTF-16", "UTF-16LE", "UTF-16BE", "UTF-32", "UTF-32LE", "UTF-32BE", "unicode-escape"})
+		ASSERT(codec::decode(name, codec::encode(name, text)) == text);
+}
+
+void test_codepages()
+{
+	using namespace ext;
+
+	// Known characters
+	ASSERT(codec::decode("windows-1252", "\x80") == "\xE2\x82\xAC");
+	ASSERT(codec::decode("ISO-8859-15", "\xA4") == "\xE2\x82\xAC");
+	ASSERT(codec::decode("ISO-8859-1", "\xA4") == "\xC2\xA4");
+	ASSERT(codec::decode("windows-1251", "\xC0") == "\xD0\x90");
+	ASSERT(codec::decode("ISO-8859-7", "\xE1") == "\xCE\xB1");
+	ASSERT(codec::encode("windows-1250", "\xC5\x91") == "\xF5");
+
+	// Undefined bytes, and characters missing from the codepage
+	ASSERT(throws([] {codec::decode("windows-1252", "\x81");}));
+	ASSERT(codec::decode("windows-1252", "a\x81" "b", codec::Errors::Replace) == "a\xEF\xBF\xBD" "b");
+	ASSERT(throws([] {codec::encode("ISO-8859-1", "\xE2\x82\xAC");}));
+	ASSERT(codec::encode("ISO-8859-1", "a\xE2\x82\xAC" "b", codec::Errors::Replace) == "a?b");
+	ASSERT(codec::encode("ISO-8859-1", "a\xE2\x82\xAC" "b", codec::Errors::Ignore) == "ab");
+
+	// ASCII
+	ASSERT(codec::decode("us-ascii", "abc") == "abc");
+	ASSERT(throws([] {codec::decode("us-ascii", "a\x80");}));
+	ASSERT(codec::encode("us-ascii", "a\xC3\xA9", codec::Errors::Replace) == "a?");
+
+	// Every byte of every codepage survives a round trip
+	for (int32_t value = int32_t(Encoding::Win1250); value <= int32_t(Encoding::ISO_8859_15); ++ value)
+	{
+		auto codec = codec::lookup(Encoding(value));
+		if (!codec)
+			continue;
+
+		better_string<char> all, text, back;
+		for (int i = 0; i < 256; ++ i)
+			all.push_back(char(i));
+		codec->decode(all.data(), all.size(), text, codec::Errors::Ignore);
+		codec->encode(text.data(), text.size(), back, codec::Errors::Strict);
+
+		better_string<char> defined;
+		for (int i = 0; i < 256; ++ i)
+		{
+			better_string<char> one;
+			codec->decode(all.data() + i, 1, one, codec::Errors::Ignore);
+			if (!one.empty())
+				defined.push_back(char(i));
+		}
+		ASSERT(back == defined);
+	}
+}
+
+// Codec for testing: ROT13 (as ASCII)
+void decode_rot13(const char * data, size_t size, ext::better_string<char> & output, ext::codec::Errors)
+{
+	for (size_t i = 0; i < size; ++ i)
+	{
+		char ch = data[i];
+		if (ch >= 'a' && ch <= 'z')
+			ch = char('a' + (ch - 'a' + 13) % 26);
+		output.push_back(ch);
+	}
+}
+
+void test_registry()
+{
+	using namespace ext;
+
+	// Custom codecs
+	auto codec = codec::add({"x-rot13", Encoding::Unknown, decode_rot13, decode_rot13}, {"rot-13"});
+	ASSERT(codec == codec::lookup("X-ROT13"));
+	ASSERT(codec == codec::lookup("rot13"));
+	ASSERT(codec::decode("rot13", "hello") == "uryyb");
+	ASSERT(codec::encode("rot13", "uryyb") == "hello");
+	ASSERT(throws([] {codec::add({"", Encoding::Unknown, decode_rot13, decode_rot13});}));
+
+	// Replacing a built-in codec
+	auto utf8 = codec::lookup("UTF-8");
+	auto other = codec::add({"utf-8", Encoding::UTF8, decode_rot13, decode_rot13});
+	ASSERT(codec::lookup("utf8") == other);
+	ASSERT(codec::lookup("unicode-1-1-utf-8") == utf8);
+	ASSERT(codec::lookup(Encoding::UTF8) == other);
+	codec::add(*utf8);
+	ASSERT(codec::decode(Encoding::UTF8, "hello") == "hello");
+
+	// Lookups while codecs are added from an other thread
+	std::atomic<bool> done {false};
+	std::atomic<size_t> failures {0};
+	std::vector<std::thread> readers;
+	for (size_t i = 0; i < 4; ++ i)
+		readers.emplace_back([&]
+		{
+			while (!done.load())
+				if (!codec::lookup("latin1") || codec::decode("cp1252", "\x80") != "\xE2\x82\xAC")
+					++ failures;
+		});
+
+	for (size_t i = 0; i < 200; ++ i)
+	{
+		std::string name = "x-test-" + std::to_string(i);
+		codec::add({name.c_str(), Encoding::Unknown, decode_rot13, decode_rot13});
+		ASSERT(codec::lookup(name.c_str()) != nullptr);
+	}
+	done.store(true);
+	for (auto & thread : readers)
+		thread.join();
+	ASSERT(failures == 0);
+}
+
+void test_detection()
+{
+	using namespace ext;
+
+	// Byte order marks
+	ASSERT(better_string_view<char>(codec::detect_encoding("\xEF\xBB\xBF" "abc").charset) == "UTF-8");
+	ASSERT(codec::detect_encoding("\xEF\xBB\xBF" "abc").bom == 3);
+	ASSERT(better_string_view<char>(codec::detect_encoding(bytes({0xFF, 0xFE, 'a', 0})).charset) == "UTF-16LE");
+	ASSERT(better_string_view<char>(codec::detect_encoding(bytes({0xFF, 0xFE, 0, 0})).charset) == "UTF-32LE");
+	ASSERT(better_string_view<char>(codec::detect_encoding(bytes({0xFE, 0xFF, 0, 'a'})).charset) == "UTF-16BE");
+	ASSERT(codec::detect_encoding(bytes({0xFE, 0xFF, 0, 'a'})).confidence == 1.0);
+
+	// Null bytes
+	better_string<char> text = "Hello world, this is plain text. Caf\u00E9!";
+	auto detection = codec::detect_encoding(codec::encode("UTF-16LE", text));
+	ASSERT(detection.encoding == Encoding::UTF16 && better_string_view<char>(detection.charset) == "UTF-16LE" && detection.bom == 0);
+	ASSERT(better_string_view<char>(codec::detect_encoding(codec::encode("UTF-16BE", text)).charset) == "UTF-16BE");
+	ASSERT(better_string_view<char>(codec::detect_encoding(codec::encode("UTF-32LE", text)).charset) == "UTF-32LE");
+	ASSERT(better_string_view<char>(codec::detect_encoding(codec::encode("UTF-32BE", text)).charset) == "UTF-32BE");
+	ASSERT(codec::detect_encoding(bytes({0x7F, 'E', 'L', 'F', 2, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0})).encoding == Encoding::Unknown);
+
+	// ASCII and UTF-8
+	ASSERT(better_string_view<char>(codec::detect_encoding("plain text").charset) == "US-ASCII");
+	ASSERT(codec::detect_encoding("").encoding == Encoding::UTF8);
+	detection = codec::detect_encoding(text);
+	ASSERT(detection.encoding == Encoding::UTF8 && better_string_view<char>(detection.charset) == "UTF-8");
+	ASSERT(codec::detect_encoding("Gr\u00FC\u00DFe aus K\u00F6ln, sch\u00F6ne Stra\u00DFe").confidence > 0.98);
+
+	// A multi byte sequence cut by the limit is still UTF-8
+	ASSERT(better_string_view<char>(codec::detect_encoding("\u00E9\u00E9", 3).charset) == "UTF-8");
+
+	// Codepages
+	struct {const char * charset; const char * text;} samples[] = {
+		{"windows-1252", "Le caf\u00E9 \u00E9tait tr\u00E8s c\u00E9l\u00E8bre \u00E0 Paris. \u00C7a co\u00FBte 5\u20AC \u2014 voil\u00E0."},
+		{"windows-1252", "No\u00EBl approche, et Zo\u00EB pr\u00E9pare un g\u00E2teau."},
+		{"windows-1252", "Il \u00E9tait une fois, \u00E0 la fran\u00E7aise, o\u00F9 tout \u00E9tait tr\u00E8s diff\u00E9rent."},
+		{"windows-1252", "O\u00F9 est la gare?"},
+		{"windows-1252", "El ni\u00F1o comi\u00F3 en la monta\u00F1a, \u00BFqu\u00E9 pas\u00F3?"},
+		{"windows-1252", "\u00A1Hola! \u00BFC\u00F3mo est\u00E1s? \u00ABBien\u00BB, dijo el se\u00F1or."},
+		{"windows-1252", "A informa\u00E7\u00E3o est\u00E1 na p\u00E1gina, n\u00E3o \u00E9 s\u00F3 isso: cora\u00E7\u00F5es e m\u00E3es."},
+		{"windows-1250", "Za\u017C\u00F3\u0142\u0107 g\u0119\u015Bl\u0105 ja\u017A\u0144. \u0141\u00F3d\u017A le\u017Cy w Polsce."},
+		{"windows-1251", "\u041F\u0440\u0438\u0432\u0435\u0442, \u043A\u0430\u043A \u0434\u0435\u043B\u0430? \u042D\u0442\u043E \u0442\u0435\u043A\u0441\u0442."},
+		{"ISO-8859-5", "\u041F\u0440\u0438\u0432\u0435\u0442, \u043A\u0430\u043A \u0434\u0435\u043B\u0430? \u042D\u0442\u043E \u0442\u0435\u043A\u0441\u0442."},
+		{"windows-1253", "\u039A\u03B1\u03BB\u03B7\u03BC\u03AD\u03C1\u03B1, \u03B1\u03C5\u03C4\u03CC \u03B5\u03AF\u03BD\u03B1\u03B9 \u03AD\u03BD\u03B1 \u03BA\u03B5\u03AF\u03BC\u03B5\u03BD\u03BF."},
+		{"windows-1255", "\u05E9\u05DC\u05D5\u05DD \u05E2\u05D5\u05DC\u05DD, \u05D6\u05D4\u05D5 \u05D8\u05E7\u05E1\u05D8 \u05E4\u05E9\u05D5\u05D8."},
+	};
+	for (auto & sample : samples)
+	{
+		auto input = codec::encode(sample.charset, sample.text);
+		detection = codec::detect_encoding(input);
+		ASSERT(better_string_view<char>(detection.charset) == sample.charset);
+		ASSERT(detection.confidence > 0.3 && detection.confidence < 1.0);
+		ASSERT(codec::decode(detection.charset, input) == sample.text);
+	}
+}
+
+int main()
+{
+	printf("Testing codec lookup... ");
+	test_lookup();
+	printf("OK!\n");
+
+	printf("Testing unicode codecs... ");
+	test_unicode();
+	printf("OK!\n");
+
+	printf("Testing codepages... ");
+	test_codepages();
+	printf("OK!\n");
+
+	printf("Testing charset detection... ");
+	test_detection();
+	printf("OK!\n");
+
+	printf("Testing the registry... ");
+	test_registry();
+	printf("OK!\n");
+
+	// On success
+	printf("--------------------\nSuccess!\n");
+	return 0;
+}
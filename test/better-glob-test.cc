@@ -0,0 +1,324 @@
+#include "better-glob.hh"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+// Helper functions
+
+#define ASSERT(c) assert(c, #c, __FILE__, __LINE__)
+
+inline void assert(bool condition, const char * message, const char * file, long line)
+{
+	if (!condition)
+	{
+		printf("Assertion Failed: %s\nFile: %s, Line: %ld\n", message, file, line);
+		exit(-1);
+	}
+}
+
+using view = ext::better_string_view<char>;
+
+// Matches a pattern (with the default flags)
+auto glob(view pattern, view text, uint32_t flags = 0) -> bool
+{
+	return ext::glob_pattern(pattern, flags).match(text);
+}
+
+void test_syntax()
+{
+	using namespace ext;
+
+	// Literals and wildcards
+	ASSERT(glob("", ""));
+	ASSERT(!glob("", "a"));
+	ASSERT(glob("abc", "abc"));
+	ASSERT(!glob("abc", "abd"));
+	ASSERT(glob("*", ""));
+	ASSERT(glob("*", "abc"));
+	ASSERT(glob("a*", "abc"));
+	ASSERT(glob("*c", "abc"));
+	ASSERT(!glob("*b", "abc"));
+	ASSERT(glob("a*c", "ac"));
+	ASSERT(glob("a*b*c", "axxbyybzzc"));
+	ASSERT(!glob("a*b*c", "axxbyyczz"));
+	ASSERT(glob("*a*a*", "aa"));
+	ASSERT(!glob("a*a", "a"));
+	ASSERT(glob("???", "abc"));
+	ASSERT(!glob("???", "ab"));
+	ASSERT(glob("*?b", "ab"));
+	ASSERT(!glob("*?b", "b"));
+	ASSERT(glob("*.tar.gz", "backup.tar.gz"));
+	ASSERT(!glob("*.tar.gz", "backup.tar.gz.part"));
+
+	// Classes
+	ASSERT(glob("[abc]", "b"));
+	ASSERT(!glob("[abc]", "d"));
+	ASSERT(glob("[a-z]x", "qx"));
+	ASSERT(glob("[!a-z]", "Q"));
+	ASSERT(glob("[^a-z]", "5"));
+	ASSERT(!glob("[!a-z]", "q"));
+	ASSERT(glob("[]]", "]"));
+	ASSERT(glob("[!]]", "a"));
+	ASSERT(glob("[a-]", "-"));
+	ASSERT(glob("x[*]", "x*"));
+	ASSERT(!glob("x[*]", "xy"));
+	ASSERT(glob("[z-a]b", "") == false);
+
+	// Unclosed classes and escapes are literals
+	ASSERT(glob("[ab", "[ab"));
+	ASSERT(glob("a[", "a["));
+	ASSERT(glob("\\*", "*"));
+	ASSERT(!glob("\\*", "a"));
+	ASSERT(glob("\\[a]", "[a]"));
+	ASSERT(glob("a\\", "a\\"));
+	ASSERT(glob("[\\]]", "]"));
+
+	// Case folding
+	ASSERT(glob("*.JPG", "photo.jpg", glob_pattern::IgnoreCase));
+	ASSERT(glob("[a-c]*", "Bob", glob_pattern::IgnoreCase));
+	ASSERT(glob("[!a-c]*", "Dan", glob_pattern::IgnoreCase));
+	ASSERT(!glob("[!a-c]*", "Bob", glob_pattern::IgnoreCase));
+	ASSERT(!glob("*.JPG", "photo.jpg"));
+
+	// The required literal
+	ASSERT(glob_pattern("*.json").required() == ".json");
+	ASSERT(glob_pattern("src/*/main.cc").required() == "/main.cc");
+	ASSERT(glob_pattern("src/*/main.cc", glob_pattern::Pathname).required() == "main.cc");
+	ASSERT(glob_pattern("*.JSON", glob_pattern::IgnoreCase).required() == ".json");
+	ASSERT(glob_pattern("*?[ab]").required().empty());
+}
+
+void test_unicode()
+{
+	using namespace ext;
+
+	ASSERT(glob("?", "é"));
+	ASSERT(glob("??", "é", glob_pattern::Bytes));
+	ASSERT(!glob("??", "é"));
+	ASSERT(glob("*?", "日本"));
+	ASSERT(glob("?本", "日本"));
+	ASSERT(glob("[あ-ん]*", "ひらがな"));
+	ASSERT(!glob("[!あ-ん]*", "ひらがな"));
+	ASSERT(glob("*[😀]", "smile 😀"));
+	ASSERT(glob("*é?", "café!"));
+
+	// Invalid bytes are single characters
+	ASSERT(glob("a?b", "a\xFF" "b"));
+	ASSERT(glob("*?b", "\xE6\x97" "b"));
+	ASSERT(glob("???", "\xE6\x97" "b"));
+}
+
+void test_pathname()
+{
+	using namespace ext;
+	const uint32_t path = glob_pattern::Pathname;
+
+	ASSERT(glob("*.cc", "main.cc", path));
+	ASSERT(!glob("*.cc", "src/main.cc", path));
+	ASSERT(glob("*.cc", "src/main.cc"));
+	ASSERT(!glob("src?main.cc", "src/main.cc", path));
+	ASSERT(!glob("src[/]main.cc", "src/main.cc", path));
+	ASSERT(glob("src/*/*.cc", "src/util/io.cc", path));
+	ASSERT(!glob("src/*/*.cc", "src/io.cc", path));
+	ASSERT(glob("src/", "src/", path));
+	ASSERT(!glob("src/", "src", path));
+
+	// `**` components
+	ASSERT(glob("**/*.cc", "main.cc", path));
+	ASSERT(glob("**/*.cc", "a/b/c/main.cc", path));
+	ASSERT(!glob("**/*.cc", "a/b/c/main.h", path));
+	ASSERT(glob("src/**/test/*.cc", "src/test/a.cc", path));
+	ASSERT(glob("src/**/test/*.cc", "src/x/y/test/a.cc", path));
+	ASSERT(!glob("src/**/test/*.cc", "src/x/y/tests/a.cc", path));
+	ASSERT(glob("src/**", "src", path));
+	ASSERT(glob("src/**", "src/a/b", path));
+	ASSERT(!glob("src/**", "lib/a", path));
+	ASSERT(glob("**", "a/b/c", path));
+	ASSERT(glob("a/**/b/**/c", "a/b/c", path));
+	ASSERT(glob("a/**/b/**/c", "a/x/b/y/b/z/c", path));
+	ASSERT(!glob("a/**/b/**/c", "a/x/c/b", path));
+	ASSERT(glob("a**b", "axx/yyb", path) == false);
+	ASSERT(glob("a**b", "axxyyb", path));
+
+	// Other separators
+	glob_pattern metric("http.*.latency", path, '.');
+	ASSERT(metric.match("http.get.latency"));
+	ASSERT(!metric.match("http.get.p99.latency"));
+	ASSERT(glob_pattern("http.**.p99", path, '.').match("http.get.latency.p99"));
+
+	// Many components
+	std::string deep;
+	for (int i = 0; i < 100; ++ i)
+		deep += "d/";
+	ASSERT(glob("**/d/*.cc", view(deep + "main.cc"), path));
+	ASSERT(!glob("**/e/*.cc", view(deep + "main.cc"), path));
+}
+
+void test_set()
+{
+	using namespace ext;
+
+	glob_set set({"*.cc", "*.h", "src/**", "*", "**/test_*.cc", "[!s]*"}, glob_pattern::Pathname);
+	ASSERT(set.size() == 6);
+	ASSERT((set.matches("main.cc") == std::vector<size_t> {0, 3, 5}));
+	ASSERT((set.matches("src/a/b.h") == std::vector<size_t> {2}));
+	ASSERT((set.matches("lib/test_io.cc") == std::vector<size_t> {4}));
+	ASSERT((set.matches("lib/io.py") == std::vector<size_t> {}));
+	ASSERT(set.is_match("x.h"));
+	ASSERT(!set.is_match("lib/io.py"));
+
+	// Patterns are indexed in the order they are added
+	ASSERT(set.add("lib/*.py") == 6);
+	ASSERT((set.matches("lib/io.py") == std::vector<size_t> {6}));
+	ASSERT(set[6].match("lib/x.py"));
+
+	// Case folding, and literals that are suffixes of each other
+	glob_set names({"*ERROR*", "*ROR*", "*or", "*warn*"}, glob_pattern::IgnoreCase);
+	ASSERT((names.matches("fatal error") == std::vector<size_t> {0, 1, 2}));
+	ASSERT((names.matches("Minor") == std::vector<size_t> {2}));
+	ASSERT((names.matches("Warning") == std::vector<size_t> {3}));
+
+	// An empty set, and appending to a list
+	glob_set empty;
+	ASSERT(empty.matches("x").empty());
+	ASSERT(!empty.is_match("x"));
+	std::vector<size_t> output {42};
+	names.matches_into("error", output);
+	ASSERT((output == std::vector<size_t> {42, 0, 1, 2}));
+}
+
+// A backtracking matcher of a component (with the classes of the random patterns)
+auto reference_part(const std::string & pattern, size_t p, const std::string & text, size_t t, bool fold) -> bool
+{
+	auto lower = [&] (char ch) {return (fold && ch >= 'A' && ch <= 'Z') ? char(ch + 32) : ch;};
+	if (p == pattern.size())
+		return t == text.size();
+	if (pattern[p] == '*')
+	{
+		for (size_t k = t; k <= text.size(); ++ k)
+			if (reference_part(pattern, p + 1, text, k, fold))
+				return true;
+		return false;
+	}
+	if (t == text.size())
+		return false;
+	char ch = lower(text[t]);
+	if (pattern[p] == '[')
+	{
+		size_t end = pattern.find(']', p);
+		bool negate = pattern[p + 1] == '!';
+		bool found = false;
+		for (size_t i = p + 1 + negate; i < end; ++ i)
+			if (i + 2 < end && pattern[i + 1] == '-')
+				found |= (ch >= pattern[i] && ch <= pattern[i + 2]), i += 2;
+			else
+				found |= (ch == pattern[i]);
+		return found != negate && reference_part(pattern, end + 1, text, t + 1, fold);
+	}
+	return (pattern[p] == '?' || lower(pattern[p]) == ch) && reference_part(pattern, p + 1, text, t + 1, fold);
+}
+
+// Splits a path into components
+auto components(const std::string & text) -> std::vector<std::string>
+{
+	std::vector<std::string> result(1);
+	for (char ch : text)
+		if (ch == '/')
+			result.emplace_back();
+		else
+			result.back() += ch;
+	return result;
+}
+
+// A backtracking matcher of components (with `**`)
+auto reference_path(const std::vector<std::string> & pattern, size_t p, const std::vector<std::string> & text, size_t t, bool fold) -> bool
+{
+	if (p == pattern.size())
+		return t == text.size();
+	if (pattern[p] == "**")
+	{
+		for (size_t k = t; k <= text.size(); ++ k)
+			if (reference_path(pattern, p + 1, text, k, fold))
+				return true;
+		return false;
+	}
+	return t < text.size() && reference_part(pattern[p], 0, text[t], 0, fold) && reference_path(pattern, p + 1, text, t + 1, fold);
+}
+
+void test_random()
+{
+	using namespace ext;
+	std::mt19937 random(1234);
+	static const char * const items[] = {"a", "b", "A", "*", "*", "?", "/", "**", "[ab]", "[!a]", "[a-b]", "ab", "ba"};
+	static const char letters[] = "aabbAB/";
+
+	for (int round = 0; round < 20000; ++ round)
+	{
+		std::string pattern, text;
+		for (size_t i = random() % 7; i > 0; -- i)
+			pattern += items[random() % (sizeof(items) / sizeof(items[0]))];
+		for (size_t i = random() % 10; i > 0; -- i)
+			text += letters[random() % (sizeof(letters) - 1)];
+
+		for (uint32_t flags : {0u, 2u, 4u, 6u})
+		{
+			bool fold = (flags & glob_pattern::IgnoreCase);
+			bool expected;
+			if (flags & glob_pattern::Pathname)
+			{
+				// `**` inside of a component is a star
+				auto parts = components(pattern);
+				for (auto & part : parts)
+					if (part != "**")
+						while (part.find("**") != std::string::npos)
+							part.erase(part.find("**"), 1);
+				expected = reference_path(parts, 0, components(text), 0, fold);
+			}
+			else
+				expected = reference_part(pattern, 0, text, 0, fold);
+
+			glob_pattern glob(pattern, flags);
+			if (glob.match(text) != expected)
+			{
+				printf("\nPattern: \"%s\", text: \"%s\", flags: %u, expected: %d\n", pattern.c_str(), text.c_str(), flags, expected);
+				ASSERT(false);
+			}
+
+			// The set finds the same patterns
+			glob_set set({view(pattern), view(pattern + "b")}, flags);
+			auto found = set.matches(text);
+			ASSERT((!found.empty() && found[0] == 0) == expected);
+		}
+	}
+}
+
+int main()
+{
+	printf("Testing the syntax... ");
+	test_syntax();
+	printf("OK!\n");
+
+	printf("Testing unicode... ");
+	test_unicode();
+	printf("OK!\n");
+
+	printf("Testing paths... ");
+	test_pathname();
+	printf("OK!\n");
+
+	printf("Testing sets... ");
+	test_set();
+	printf("OK!\n");
+
+	printf("Testing against a backtracking matcher... ");
+	test_random();
+	printf("OK!\n");
+
+	// On success
+	printf("--------------------\nSuccess!\n");
+	return 0;
+}
@@ -0,0 +1,301 @@
+#include "better-string.hh"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Helper functions
+
+#define ASSERT(c) assert(c, #c, __FILE__, __LINE__)
+
+inline void assert(bool condition, const char * message, const char * file, long line)
+{
+	if (!condition)
+	{
+		printf("Assertion Failed: %s\nFile: %s, Line: %ld\n", message, file, line);
+		exit(-1);
+	}
+}
+
+// One line of the golden file (see test/golden/generate.py)
+struct Case
+{
+	size_t line;
+	std::string name;
+	std::vector<std::string> args;
+	std::vector<std::string> results;
+};
+
+// Removes the escape sequences of a field
+auto unescape(const std::string & field) -> std::string
+{
+	std::string result;
+	for (size_t i = 0; i < field.size(); ++ i)
+	{
+		if (field[i] == '\\' && i + 1 < field.size() && field[i + 1] == 'x')
+		{
+			result.push_back(char(strtol(field.substr(i + 2, 2).c_str(), nullptr, 16)));
+			i += 3;
+		}
+		else if (field[i] == '\\')
+			result.push_back(field[++ i]);
+		else
+			result.push_back(field[i]);
+	}
+	return result;
+}
+
+// Reads the golden file
+auto load(const char * path) -> std::vector<Case>
+{
+	std::ifstream file(path);
+	ASSERT(file.good());
+
+	std::vector<Case> cases;
+	std::string line;
+	for (size_t number = 1; std::getline(file, line); ++ number)
+	{
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		Case item {number, {}, {}, {}};
+		bool results = false;
+		for (size_t start = 0, end; start <= line.size(); start = end + 1)
+		{
+			end = std::min(line.find('\t', start), line.size());
+			std::string field = line.substr(start, end - start);
+			if (item.name.empty())
+				item.name = field;
+			else if (!results && field == "=")
+				results = true;
+			else
+				(results ? item.results : item.args).push_back(unescape(field));
+		}
+		cases.push_back(std::move(item));
+	}
+	return cases;
+}
+
+/**
+ * @brief Replays the golden cases with one character type.
+ *
+ * The arguments are transcoded from UTF-8, and the results back to UTF-8. Positions in the golden file are codepoint
+ * indices, and are converted to offsets in the string (and back).
+ */
+template<typename Char>
+class Replay
+{
+public:
+	using string = ext::better_string<Char>;
+	using view = ext::better_string_view<Char>;
+	static constexpr auto E = ext::default_encoding<Char>::value;
+
+	// Converts a golden field to a string
+	static auto str(const std::string & text) -> string
+		{return ext::better_string_view<char>(text).template transcode<ext::Encoding::UTF8, E, Char>();}
+
+	// Converts a string to a golden field
+	static auto utf8(view text) -> std::string
+		{return text.template decode<E>();}
+
+	// Offsets of every codepoint in a string
+	static auto offsets(const string & text) -> std::vector<size_t>
+	{
+		std::vector<size_t> result;
+		auto done = ext::encoding_traits<E>::iter(text.data() + text.size());
+		for (auto iter = ext::encoding_traits<E>::iter(text.data()); iter != done; ++ iter)
+			result.push_back(static_cast<const Char *>(iter) - text.data());
+		result.push_back(text.size());
+		return result;
+	}
+
+	// Converts a codepoint index to an offset (after the end, every index is one unit)
+	static auto offset(const string & text, const std::string & field) -> size_t
+	{
+		if (field == "-")
+			return size_t(-1);
+		auto list = offsets(text);
+		size_t index = strtoull(field.c_str(), nullptr, 10);
+		return (index < list.size()) ? list[index] : text.size() + index - (list.size() - 1);
+	}
+
+	// Converts an offset to a codepoint index
+	static auto index(const string & text, size_t offset) -> std::string
+	{
+		if (offset == size_t(-1))
+			return "-1";
+		auto list = offsets(text);
+		auto iter = std::lower_bound(list.begin(), list.end(), offset);
+		return (iter != list.end() && *iter == offset) ? std::to_string(iter - list.begin()) : "?" + std::to_string(offset);
+	}
+
+	// Converts a count argument (-1 means no limit)
+	static auto count(const std::string & field) -> size_t
+		{return size_t(strtoll(field.c_str(), nullptr, 10));}
+
+	// Converts a list of strings
+	template<typename List>
+	static auto list(const List & items) -> std::vector<std::string>
+	{
+		std::vector<std::string> result;
+		for (auto & item : items)
+			result.push_back(utf8(item));
+		return result;
+	}
+
+	// Runs one case, and returns the results (or "!" when an exception was thrown)
+	static auto run(const Case & item) -> std::vector<std::string>
+	{
+		auto & name = item.name;
+		auto & args = item.args;
+		try
+		{
+			string text = str(args[0]);
+
+			// Alignment
+			if (name == "center")
+				return {utf8(text.center(count(args[1]), str(args[2])))};
+			if (name == "ljust")
+				return {utf8(text.ljust(count(args[1]), str(args[2])))};
+			if (name == "rjust")
+				return {utf8(text.rjust(count(args[1]), str(args[2])))};
+			if (name == "zfill")
+				return {utf8(text.zfill(count(args[1])))};
+
+			// Search
+			if (name == "find")
+				return {index(text, text.find(str(args[1]), offset(text, args[2]), offset(text, args[3])))};
+			if (name == "rfind")
+				return {index(text, text.rfind(str(args[1]), offset(text, args[2]), offset(text, args[3])))};
+			if (name == "index")
+				return {index(text, text.index(str(args[1]), offset(text, args[2]), offset(text, args[3])))};
+			if (name == "rindex")
+				return {index(text, text.rindex(str(args[1]), offset(text, args[2]), offset(text, args[3])))};
+			if (name == "count")
+				return {std::to_string(text.count(str(args[1]), offset(text, args[2]), offset(text, args[3])))};
+
+			// Prefix and suffix
+			if (name == "startswith")
+				return {text.startswith(str(args[1]), offset(text, args[2]), offset(text, args[3])) ? "1" : "0"};
+			if (name == "endswith")
+				return {text.endswith(str(args[1]), offset(text, args[2]), offset(text, args[3])) ? "1" : "0"};
+			if (name == "removeprefix")
+				return {utf8(text.removeprefix(str(args[1])))};
+			if (name == "removesuffix")
+				return {utf8(text.removesuffix(str(args[1])))};
+
+			// Replace
+			if (name == "replace")
+				return {utf8(text.replace(str(args[1]), str(args[2]), count(args[3])))};
+			if (name == "expandtabs")
+				return {utf8(text.expandtabs(count(args[1])))};
+
+			// Split and join (the views are checked too)
+			if (name == "split")
+				return same(list(text.split(count(args[1]))), list(view(text).split(count(args[1]))));
+			if (name == "rsplit")
+				return same(list(text.rsplit(count(args[1]))), list(view(text).rsplit(count(args[1]))));
+			if (name == "split_sep")
+				return same(list(text.split(str(args[1]), count(args[2]))), list(view(text).split(str(args[1]), count(args[2]))));
+			if (name == "rsplit_sep")
+				return same(list(text.rsplit(str(args[1]), count(args[2]))), list(view(text).rsplit(str(args[1]), count(args[2]))));
+			if (name == "partition")
+				return same(list(text.partition(str(args[1]))), list(view(text).partition(str(args[1]))));
+			if (name == "rpartition")
+				return same(list(text.rpartition(str(args[1]))), list(view(text).rpartition(str(args[1]))));
+			if (name == "splitlines")
+				return same(list(text.splitlines(args[1] == "1")), list(view(text).splitlines(args[1] == "1")));
+			if (name == "join")
+			{
+				std::vector<string> items;
+				for (size_t i = 1; i < args.size(); ++ i)
+					items.push_back(str(args[i]));
+				return {utf8(text.join(items))};
+			}
+
+			// Character and case
+			if (name == "isascii")
+				return {text.isascii() ? "1" : "0"};
+			if (name == "upper")
+				return {utf8(text.upper())};
+			if (name == "lower")
+				return {utf8(text.lower())};
+
+			// Formatting
+			if (name == "format")
+				return {utf8(text.format(int64_t(strtoll(args[1].c_str(), nullptr, 10)), str(args[2])))};
+		}
+		catch (const std::exception &)
+		{
+			return {"!"};
+		}
+
+		printf("Unknown algorithm: %s\n", name.c_str());
+		exit(-1);
+	}
+
+	// Checks that the string and the view versions return the same result
+	static auto same(const std::vector<std::string> & left, const std::vector<std::string> & right) -> std::vector<std::string>
+		{return (left == right) ? left : std::vector<std::string> {"<string and view results differ>"};}
+};
+
+// Prints a list of fields
+void print(const char * label, const std::vector<std::string> & fields)
+{
+	printf("  %s:", label);
+	for (auto & field : fields)
+		printf(" [%s]", field.c_str());
+	printf("\n");
+}
+
+// Replays every case, and returns the number of failures
+template<typename Char>
+auto replay(const std::vector<Case> & cases, const char * type) -> size_t
+{
+	printf("Replaying %zu cases with %s... ", cases.size(), type);
+
+	size_t failures = 0;
+	for (auto & item : cases)
+	{
+		auto results = Replay<Char>::run(item);
+		if (results == item.results)
+			continue;
+
+		// Print the first few failures
+		if (failures ++ < 10)
+		{
+			printf("\nMismatch on line %zu (%s):\n", item.line, item.name.c_str());
+			print("Arguments", item.args);
+			print("Expected", item.results);
+			print("Result", results);
+		}
+	}
+
+	if (failures)
+		printf("%zu failures\n", failures);
+	else
+		printf("OK!\n");
+	return failures;
+}
+
+int main(int argc, char ** argv)
+{
+	// The golden file is given by the build system
+	ASSERT(argc == 2);
+	auto cases = load(argv[1]);
+	ASSERT(cases.size() > 0);
+
+	size_t failures = 0;
+	failures += replay<char>(cases, "char (UTF-8)");
+	failures += replay<char16_t>(cases, "char16_t (UTF-16)");
+	failures += replay<char32_t>(cases, "char32_t (UTF-32)");
+	ASSERT(failures == 0);
+
+	// On success
+	printf("--------------------\nSuccess!\n");
+	return 0;
+}
@@ -0,0 +1,148 @@
+#include "better-string.hh"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <thread>
+#include <vector>
+
+// Helper functions
+
+#define ASSERT(c) assert(c, #c, __FILE__, __LINE__)
+
+inline void assert(bool condition, const char * message, const char * file, long line)
+{
+	if (!condition)
+	{
+		printf("Assertion Failed: %s\nFile: %s, Line: %ld\n", message, file, line);
+		exit(-1);
+	}
+}
+
+// Testing functions
+
+void test_counters()
+{
+	using namespace ext;
+	using instrument::Algorithm;
+
+	printf("Testing counters... ");
+
+	auto before = instrument::local();
+	better_string<char> text("abc-def-ghi");
+
+	// Search (no output)
+	ASSERT(text.find("def") == 4);
+	ASSERT(text.find("ghi") == 8);
+	auto search = instrument::local().since(before);
+	ASSERT(search[Algorithm::Find].calls == 2);
+	ASSERT(search[Algorithm::Find].input == 22);
+	ASSERT(search[Algorithm::Find].output == 0);
+	ASSERT(search[Algorithm::Rfind].calls == 0);
+
+	// Split (the output is the total size of the parts)
+	auto parts = text.split("-");
+	ASSERT(parts.size() == 3);
+	auto split = instrument::local().since(before);
+	ASSERT(split[Algorithm::Split].calls == 1);
+	ASSERT(split[Algorithm::Split].input == 11);
+	ASSERT(split[Algorithm::Split].output == 9);
+	ASSERT(split[Algorithm::Split].allocations > 0);
+
+	// Replace
+	ASSERT(text.replace("-", "--") == "abc--def--ghi");
+	auto replace = instrument::local().since(before);
+	ASSERT(replace[Algorithm::Replace].calls == 1);
+	ASSERT(replace[Algorithm::Replace].output == 13);
+
+	// Format
+	ASSERT(better_string<char>("{}+{}").format("abc", "de") == "abc+de");
+	auto format = instrument::local().since(before);
+	ASSERT(format[Algorithm::Format].calls == 1);
+	ASSERT(format[Algorithm::Format].input == 5);
+	ASSERT(format[Algorithm::Format].output == 6);
+
+	// Transcode (bytes, not characters - format also transcodes its arguments, so count from here)
+	before = instrument::local();
+	auto utf32 = text.transcode<Encoding::UTF8, Encoding::UTF32>();
+	ASSERT(utf32.size() == 11);
+	auto transcode = instrument::local().since(before);
+	ASSERT(transcode[Algorithm::Transcode].calls == 1);
+	ASSERT(transcode[Algorithm::Transcode].input == 11);
+	ASSERT(transcode[Algorithm::Transcode].output == 44);
+
+	printf("OK!\n");
+}
+
+void test_threads()
+{
+	using namespace ext;
+	using instrument::Algorithm;
+
+	printf("Testing threads... ");
+
+	// Count in other threads (both running and finished threads are collected)
+	auto before = instrument::snapshot();
+	std::vector<std::thread> threads;
+	for (int i = 0; i < 4; ++ i)
+	{
+		threads.emplace_back([] {
+			better_string<char> text("aXbXc");
+			for (int k = 0; k < 100; ++ k)
+				ASSERT(text.upper() == "AXBXC");
+		});
+	}
+	for (auto & thread : threads)
+		thread.join();
+
+	auto after = instrument::snapshot().since(before);
+	ASSERT(after[Algorithm::Upper].calls == 400);
+	ASSERT(after[Algorithm::Upper].input == 2000);
+	ASSERT(after[Algorithm::Upper].output == 2000);
+	ASSERT(after[Algorithm::Lower].calls == 0);
+
+	// Merge
+	instrument::Snapshot total;
+	total.merge(after).merge(after);
+	ASSERT(total[Algorithm::Upper].calls == 800);
+
+	printf("OK!\n");
+}
+
+void test_output()
+{
+	using namespace ext;
+
+	printf("Testing output... ");
+
+	auto before = instrument::local();
+	better_string<char>("abc").center(5);
+	auto counters = instrument::local().since(before);
+
+	// Prometheus
+	std::string text = counters.prometheus();
+	ASSERT(text.find("# TYPE better_string_calls_total counter\n") != std::string::npos);
+	ASSERT(text.find("better_string_calls_total{algorithm=\"center\"} 1\n") != std::string::npos);
+	ASSERT(text.find("better_string_input_bytes_total{algorithm=\"center\"} 3\n") != std::string::npos);
+	ASSERT(text.find("better_string_output_bytes_total{algorithm=\"center\"} 5\n") != std::string::npos);
+	ASSERT(text.find("better_string_calls_total{algorithm=\"quote\"} 0\n") != std::string::npos);
+
+	// JSON (only the algorithms that were called)
+	std::string json = counters.json();
+	ASSERT(json.find("{\"center\":{\"calls\":1,\"input_bytes\":3,\"output_bytes\":5,\"allocations\":") == 0);
+	ASSERT(json.find("quote") == std::string::npos);
+	ASSERT(instrument::Snapshot().json() == "{}");
+
+	printf("OK!\n");
+}
+
+int main()
+{
+	test_counters();
+	test_threads();
+	test_output();
+
+	// On success
+	printf("--------------------\nSuccess!\n");
+	return 0;
+}
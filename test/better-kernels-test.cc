@@ -0,0 +1,430 @@
+#include "better-kernels.hh"
+#include "better-string.hh"
+
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+// Helper functions
+
+#define ASSERT(c) assert(c, #c, __FILE__, __LINE__)
+
+inline void assert(bool condition, const char * message, const char * file, long line)
+{
+	if (!condition)
+	{
+		printf("Assertion Failed: %s\nFile: %s, Line: %ld\n", message, file, line);
+		exit(-1);
+	}
+}
+
+// Random number generator (deterministic, so failures can be reproduced)
+class Random
+{
+public:
+	auto next() -> uint64_t
+	{
+		state += 0x9E3779B97F4A7C15ull;
+		uint64_t z = state;
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+
+	auto below(uint64_t n) -> size_t
+		{return size_t(next() % n);}
+
+private:
+	uint64_t state = 42;
+};
+
+// Appends a codepoint as UTF-8
+void append_utf8(std::string & text, uint32_t cp)
+{
+	ext::UTF8Encoder::append(text, cp);
+}
+
+// Creates a test input: ASCII, valid UTF-8, UTF-8 with errors, or random bytes
+auto generate(Random & random, size_t kind, size_t size) -> std::string
+{
+	std::string text;
+	while (text.size() < size)
+	{
+		switch (kind)
+		{
+			case 0:
+				text.push_back(char(0x20 + random.below(0x5F)));
+				break;
+			case 1:
+			case 2:
+			{
+				static const uint32_t ranges[][2] = {{0x20, 0x80}, {0x80, 0x800}, {0x800, 0xD800}, {0xE000, 0x10000}, {0x10000, 0x110000}};
+				auto & range = ranges[random.below(8) < 4 ? 0 : 1 + random.below(4)];
+				append_utf8(text, uint32_t(range[0] + random.below(range[1] - range[0])));
+				if (kind == 2 && random.below(64) == 0)
+					text[random.below(text.size())] = char(random.below(256));
+				break;
+			}
+			default:
+				text.push_back(char(random.below(256)));
+				break;
+		}
+	}
+	text.resize(size);
+	return text;
+}
+
+// Testing functions
+
+void test_search(const ext::kernels::Table & kernels, Random & random)
+{
+	auto & scalar = ext::kernels::scalar::table();
+
+	for (size_t kind = 0; kind < 4; ++ kind)
+	{
+		for (size_t size = 0; size < 300; ++ size)
+		{
+			std::string text = generate(random, kind, size + 3);
+			for (size_t offset = 0; offset < 3; ++ offset)
+			{
+				const char * data = text.data() + offset;
+
+				// Find bytes (present and missing)
+				char ch = size ? data[random.below(size)] : 'a';
+				ASSERT(kernels.find_byte(data, size, ch) == scalar.find_byte(data, size, ch));
+				ASSERT(kernels.find_byte(data, size, '\x01') == scalar.find_byte(data, size, '\x01'));
+				ASSERT(kernels.count_byte(data, size, ch) == scalar.count_byte(data, size, ch));
+
+				// Find bytes of a set (a random range and two bytes from the text)
+				uint8_t first = uint8_t(random.below(256));
+				char other = size ? data[random.below(size)] : 'b';
+				auto set = ext::kernels::ByteSet::of([&] (uint8_t x) {return (x >= first && x < first + 5) || x == uint8_t(ch) || x == uint8_t(other);});
+				ASSERT(kernels.find_any(data, size, set) == scalar.find_any(data, size, set));
+
+				// Find substrings (taken from the text, and random)
+				for (size_t length : {1, 2, 3, 5, 17, 40})
+				{
+					std::string sub = (length <= size) ? text.substr(offset + random.below(size - length + 1), length) :
+						generate(random, kind, length);
+					ASSERT(kernels.find(data, size, sub.data(), sub.size()) == scalar.find(data, size, sub.data(), sub.size()));
+					sub[length - 1] ^= 1;
+					ASSERT(kernels.find(data, size, sub.data(), sub.size()) == scalar.find(data, size, sub.data(), sub.size()));
+				}
+				ASSERT(kernels.find(data, size, "", 0) == 0);
+			}
+		}
+	}
+
+	// Every byte value, at every position of a block
+	std::string all;
+	for (int ch = 0; ch < 256; ++ ch)
+		all.push_back(char(ch));
+	for (int ch = 0; ch < 256; ++ ch)
+	{
+		auto set = ext::kernels::ByteSet::of([&] (uint8_t x) {return x == ch;});
+		ASSERT(set.contains(uint8_t(ch)) && !set.contains(uint8_t(ch + 1)));
+		for (size_t position = 0; position < 70; position += 3)
+		{
+			std::string text = std::string(position, char(ch + 1)) + all;
+			ASSERT(kernels.find_any(text.data(), text.size(), set) == position + ch);
+		}
+	}
+}
+
+void test_validation(const ext::kernels::Table & kernels, Random & random)
+{
+	auto & scalar = ext::kernels::scalar::table();
+
+	// Random inputs, at every alignment
+	for (size_t kind = 0; kind < 4; ++ kind)
+	{
+		for (size_t size = 0; size < 300; ++ size)
+		{
+			std::string text = generate(random, kind, size + 3);
+			for (size_t offset = 0; offset < 3; ++ offset)
+			{
+				const char * data = text.data() + offset;
+				ASSERT(kernels.ascii_prefix(data, size) == scalar.ascii_prefix(data, size));
+				ASSERT(kernels.utf8_length(data, size) == scalar.utf8_length(data, size));
+				ASSERT(kernels.escape_prefix(data, size, false) == scalar.escape_prefix(data, size, false));
+				ASSERT(kernels.escape_prefix(data, size, true) == scalar.escape_prefix(data, size, true));
+			}
+		}
+	}
+
+	// Large inputs
+	for (size_t kind = 0; kind < 3; ++ kind)
+	{
+		std::string text = generate(random, kind, 100000);
+		ASSERT(kernels.utf8_length(text.data(), text.size()) == scalar.utf8_length(text.data(), text.size()));
+		ASSERT(kernels.ascii_prefix(text.data(), text.size()) == scalar.ascii_prefix(text.data(), text.size()));
+	}
+
+	// Valid and invalid sequences, at every position of a block
+	static const char * valid[] = {"\x7F", "\xC2\x80", "\xDF\xBF", "\xE0\xA0\x80", "\xED\x9F\xBF", "\xEE\x80\x80",
+		"\xEF\xBF\xBF", "\xF0\x90\x80\x80", "\xF4\x8F\xBF\xBF"};
+	static const char * invalid[] = {"\x80", "\xBF", "\xC0\x80", "\xC1\xBF", "\xC2", "\xC2\x41", "\xE0\x80\x80",
+		"\xE0\x9F\xBF", "\xED\xA0\x80", "\xED\xBF\xBF", "\xE1\x80", "\xE1\x80\x41", "\xF0\x80\x80\x80", "\xF0\x8F\xBF\xBF",
+		"\xF4\x90\x80\x80", "\xF5\x80\x80\x80", "\xF8\x88\x80\x80\x80", "\xFF", "\xF1\x80\x80", "\xC2\x80\x80"};
+	for (size_t position = 0; position < 70; ++ position)
+	{
+		for (char ch : {'"', '\'', '\\', '\0', '\n', '\x1F'})
+		{
+			std::string text = std::string(position, 'a') + ch + "\x7F \xC3\xA9";
+			ASSERT(kernels.escape_prefix(text.data(), text.size(), false) == position);
+			ASSERT(kernels.escape_prefix(text.data() + position + 1, text.size() - position - 1, false) == 4);
+			ASSERT(kernels.escape_prefix(text.data() + position + 1, text.size() - position - 1, true) == 2);
+		}
+		for (auto sequence : valid)
+		{
+			std::string text = std::string(position, 'a') + sequence + "bcd";
+			ASSERT(kernels.utf8_length(text.data(), text.size()) == position + 4);
+			ASSERT(kernels.utf8_length(text.data(), text.size() - 3) == position + 1);
+		}
+		for (auto sequence : invalid)
+		{
+			std::string text = std::string(position, 'a') + sequence;
+			ASSERT(scalar.utf8_length(text.data(), text.size()) == size_t(-1));
+			ASSERT(kernels.utf8_length(text.data(), text.size()) == size_t(-1));
+			text += "bcd";
+			ASSERT(kernels.utf8_length(text.data(), text.size()) == size_t(-1));
+		}
+	}
+}
+
+void test_utf16(const ext::kernels::Table & kernels, Random & random)
+{
+	auto & scalar = ext::kernels::scalar::table();
+
+	// Random units (mostly without surrogates), at every alignment
+	for (size_t size = 0; size < 300; ++ size)
+	{
+		std::u16string text(size + 3, 0);
+		for (auto & unit : text)
+			unit = char16_t(random.below(64) ? random.below(0x10000) & 0xD7FF : 0xD800 + random.below(0x800));
+		for (size_t offset = 0; offset < 3; ++ offset)
+			ASSERT(kernels.utf16_prefix(text.data() + offset, size) == scalar.utf16_prefix(text.data() + offset, size));
+	}
+
+	// A surrogate at every position of a block (and the units around the surrogate range)
+	for (size_t position = 0; position < 70; ++ position)
+	{
+		for (char16_t unit : {0xD800, 0xDBFF, 0xDC00, 0xDFFF})
+		{
+			std::u16string text(position, 0xD7FF);
+			text += unit;
+			text += std::u16string(40, 0xE000);
+			ASSERT(kernels.utf16_prefix(text.data(), text.size()) == position);
+			ASSERT(kernels.utf16_prefix(text.data(), position) == position);
+		}
+	}
+}
+
+void test_transcode(const ext::kernels::Table & kernels, Random & random)
+{
+	for (size_t size = 0; size < 300; ++ size)
+	{
+		std::string text = generate(random, 3, size);
+		std::u16string out16(size, 0), expected16(size, 0);
+		std::u32string out32(size, 0), expected32(size, 0);
+
+		kernels.widen16(text.data(), size, &out16[0]);
+		kernels.widen32(text.data(), size, &out32[0]);
+		for (size_t i = 0; i < size; ++ i)
+			{expected16[i] = uint8_t(text[i]); expected32[i] = uint8_t(text[i]);}
+		ASSERT(out16 == expected16);
+		ASSERT(out32 == expected32);
+	}
+}
+
+void test_case(const ext::kernels::Table & kernels, Random & random)
+{
+	auto & scalar = ext::kernels::scalar::table();
+
+	for (size_t size = 0; size < 300; ++ size)
+	{
+		std::string text = generate(random, 3, size);
+		std::string out(size, 0), expected(size, 0);
+
+		kernels.upper(text.data(), size, &out[0]);
+		scalar.upper(text.data(), size, &expected[0]);
+		ASSERT(out == expected);
+
+		kernels.lower(text.data(), size, &out[0]);
+		scalar.lower(text.data(), size, &expected[0]);
+		ASSERT(out == expected);
+	}
+}
+
+void test_binary(const ext::kernels::Table & kernels, Random & random)
+{
+	auto & scalar = ext::kernels::scalar::table();
+
+	for (size_t size = 0; size < 300; ++ size)
+	{
+		std::string data = generate(random, 3, size);
+		for (bool url : {false, true})
+		{
+			// Encode, then decode the result (after changing a character in some cases)
+			std::string text(size / 3 * 4, 0), expected(size / 3 * 4, 0);
+			kernels.b64encode(data.data(), size, &text[0], url);
+			scalar.b64encode(data.data(), size, &expected[0], url);
+			ASSERT(text == expected);
+			if (!text.empty() && random.below(3) == 0)
+				text[random.below(text.size())] = char(random.below(256));
+
+			std::string out(text.size() / 4 * 3, 0), expected_out(text.size() / 4 * 3, 0);
+			size_t length = kernels.b64decode(text.data(), text.size(), &out[0], url);
+			ASSERT(length == scalar.b64decode(text.data(), text.size(), &expected_out[0], url));
+			ASSERT(length == size_t(-1) || out == expected_out);
+		}
+
+		// Hex, with digits of both cases
+		std::string hex(2 * size, 0), expected(2 * size, 0);
+		kernels.hexlify(data.data(), size, &hex[0]);
+		scalar.hexlify(data.data(), size, &expected[0]);
+		ASSERT(hex == expected);
+		for (auto & ch : hex)
+			if (ch >= 'a' && random.below(2))
+				ch = char(ch - 0x20);
+		std::string out(size, 0);
+		ASSERT(kernels.unhexlify(hex.data(), hex.size(), &out[0]) == size && out == data);
+		if (size)
+		{
+			hex[random.below(hex.size())] = "g/:@`G \xFF"[random.below(8)];
+			ASSERT(kernels.unhexlify(hex.data(), hex.size(), &out[0]) == size_t(-1));
+		}
+	}
+}
+
+void test_csv(const ext::kernels::Table & kernels, Random & random)
+{
+	auto & scalar = ext::kernels::scalar::table();
+
+	for (size_t size = 0; size < 300; ++ size)
+	{
+		// Mostly structural characters, so every block has quotes
+		std::string data = generate(random, 0, size);
+		for (auto & ch : data)
+			if (random.below(3) == 0)
+				ch = ",\"\n"[random.below(3)];
+
+		for (int start = 0; start < 4; ++ start)
+		{
+			std::vector<uint32_t> positions(size), expected(size);
+			ext::kernels::CsvState state {bool(start & 1), bool(start & 2)}, expected_state = state;
+			size_t count = kernels.csv_index(data.data(), size, ',', '"', state, positions.data());
+			ASSERT(count == scalar.csv_index(data.data(), size, ',', '"', expected_state, expected.data()));
+			ASSERT(state.quoted == expected_state.quoted && state.open == expected_state.open);
+			ASSERT(std::equal(positions.begin(), positions.begin() + count, expected.begin()));
+		}
+	}
+}
+
+// Tests the string functions using the kernels, against known results
+void test_string()
+{
+	using namespace ext;
+
+	// Long enough to use whole blocks
+	std::string repeated;
+	for (int i = 0; i < 20; ++ i)
+		repeated += "abc😀✏def ";
+	better_string<char> text(repeated.data(), repeated.size());
+
+	ASSERT(text.length() == 180);
+	ASSERT(text.find("😀") == 3);
+	ASSERT(text.find("def", 100) == 10 + 14 * 7);
+	ASSERT(text.find("😀✏d", 17) == 14 + 3);
+	ASSERT(text.find("\x80") == size_t(-1));
+	ASSERT(text.count("😀") == 20);
+	ASSERT(text.count("c😀✏d") == 20);
+	ASSERT(text.upper().count("ABC😀✏DEF") == 20);
+	ASSERT(!text.isascii());
+
+	// Transcoding (ASCII runs are widened by the kernels)
+	auto utf16 = text.transcode<Encoding::UTF8, Encoding::UTF16>();
+	auto utf32 = text.transcode<Encoding::UTF8, Encoding::UTF32>();
+	ASSERT(utf32.size() == 180);
+	ASSERT(utf16.size() == 200);
+	ASSERT(utf16.decode<Encoding::UTF16>() == text);
+	ASSERT(utf32.decode<Encoding::UTF32>() == text);
+
+	// UTF-16 (runs without surrogates are skipped by the kernels)
+	ASSERT(utf16.length() == 180);
+	ASSERT(utf16.find(u"😀") == 3);
+	ASSERT(utf16.find(u"def", 100) == 6 + 10 * 10);
+	ASSERT(utf16.find(u"\xDE00") == size_t(-1));
+	ASSERT(utf16.count(u"c😀✏d") == 20);
+	ASSERT(utf16.count(u"d") == 20);
+	auto truncated = better_string<char16_t>(u"{0:.4}|{0:.3}").format(utf16);
+	ASSERT(truncated == u"abc😀|abc");
+	ASSERT(utf16.center(182, u"*").size() == 202);
+	size_t count = 0;
+	for (auto cp : utf16.codepoints())
+		count += (cp == 0x1F600);
+	ASSERT(count == 20);
+
+	// Quoting (the runs without escapes are copied at once)
+	auto quoted = repr(better(text + "\"\n" + text));
+	ASSERT(quoted == "\"" + repeated + "\\\"\\n" + repeated + "\"");
+	ASSERT(repr(utf16) == "\"" + repeated + "\"");
+	ASSERT(repr<char16_t>(better(utf16 + u"\t\xD800")) == u"\"" + utf16 + u"\\t\xFFFD\"");
+	ASSERT(ascii(utf16).count("\\U0001f600\\u270f") == 20);
+
+	// Base64 and hex (the whole blocks are converted by the kernels)
+	ASSERT(text.b64encode().b64decode() == text);
+	ASSERT(text.b64encode(true).b64decode(true) == text);
+	ASSERT(text.hexlify().unhexlify() == text);
+	ASSERT(text.hexlify().substr(0, 8) == "616263f0");
+
+	// CSV (the separators are indexed by the kernels)
+	size_t fields = 0;
+	better_string<char> lines = better(text + "\n" + text);
+	ext::csv_reader<char> reader(lines, ' ');
+	for (auto & record : reader)
+		fields += record.size();
+	ASSERT(fields == 42);
+
+	// Invalid text is still counted one sequence at a time
+	better_string<char> invalid("abc\xC3(\x82");
+	ASSERT(invalid.length() == 6);
+	auto ignored = invalid.decode<Encoding::UTF8, char32_t>(better_string<char>::errors::Ignore);
+	ASSERT(ignored == U"abc(");
+}
+
+int main()
+{
+	using namespace ext;
+
+	// Test every instruction set supported by the processor, against the portable kernels
+	Random random;
+	for (size_t i = 0; i < kernels::isa_count; ++ i)
+	{
+		const kernels::Table * table = kernels::table(kernels::Isa(i));
+		if (!table)
+		{
+			printf("Skipping %s kernels (not supported)\n", i == 1 ? "sse4.2" : i == 2 ? "avx2" : "avx512");
+			continue;
+		}
+
+		printf("Testing %s kernels... ", table->name);
+		test_search(*table, random);
+		test_validation(*table, random);
+		test_utf16(*table, random);
+		test_transcode(*table, random);
+		test_case(*table, random);
+		test_binary(*table, random);
+		test_csv(*table, random);
+		printf("OK!\n");
+	}
+
+	printf("Testing string functions with %s kernels... ", kernels::active().name);
+	test_string();
+	printf("OK!\n");
+
+	// On success
+	printf("--------------------\nSuccess!\n");
+	return 0;
+}
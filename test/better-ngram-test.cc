@@ -0,0 +1,155 @@
+#include "better-ngram.hh"
+#include "better-regex.hh"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+// Helper functions
+
+#define ASSERT(c) assert(c, #c, __FILE__, __LINE__)
+
+inline void assert(bool condition, const char * message, const char * file, long line)
+{
+	if (!condition)
+	{
+		printf("Assertion Failed: %s\nFile: %s, Line: %ld\n", message, file, line);
+		exit(-1);
+	}
+}
+
+using ids = std::vector<size_t>;
+
+void test_search()
+{
+	using namespace ext;
+	ngram_index<char> index({"the quick brown fox", "jumps over", "the lazy dog", "ab", "", "naïve café"});
+	ASSERT(index.size() == 6);
+	ASSERT(index[1] == "jumps over");
+	ASSERT((index.search("the ") == ids {0, 2}));
+	ASSERT((index.search("quick") == ids {0}));
+	ASSERT((index.search("o") == ids {0, 1, 2}));
+	ASSERT((index.search("ab") == ids {3}));
+	ASSERT((index.search("") == ids {0, 1, 2, 3, 4, 5}));
+	ASSERT((index.search("café") == ids {5}));
+	ASSERT((index.search("xyz") == ids {}));
+	ASSERT((index.search("the fox") == ids {}));
+
+	// Appending to a list
+	ids output {42};
+	index.search_into("dog", output);
+	ASSERT((output == ids {42, 2}));
+
+	// Queries with a required literal
+	regex re("qu[a-z]+k|l[a-z]zy");
+	ASSERT(re.required().empty());
+	output.clear();
+	index.search_if(regex("b.own").required(), [] (better_string_view<char> str) {return bool(regex("b.own").search(str));}, output);
+	ASSERT((output == ids {0}));
+	output.clear();
+	index.search_if(re.required(), [&] (better_string_view<char> str) {return bool(re.search(str));}, output);
+	ASSERT((output == ids {0, 2}));
+
+	// Wide characters
+	ngram_index<char16_t> wide({u"😀 smile", u"frown", u"smiles 😀"});
+	ASSERT((wide.search(u"smile") == std::vector<size_t> {0, 2}));
+	ASSERT((wide.search(u"😀 s") == std::vector<size_t> {0}));
+	ngram_index<char32_t> full({U"\U0010FFFFab", U"\U0000FFFFab"});
+	ASSERT((full.search(U"\U0010FFFFa") == std::vector<size_t> {0}));
+}
+
+void test_erase()
+{
+	using namespace ext;
+	ngram_index<char> index;
+	ASSERT(index.empty());
+	ASSERT(index.insert("alpha") == 0);
+	ASSERT(index.insert("beta") == 1);
+	ASSERT(index.insert("alphabet") == 2);
+	ASSERT((index.search("alph") == ids {0, 2}));
+	ASSERT(index.erase(0));
+	ASSERT(!index.erase(0));
+	ASSERT(!index.erase(7));
+	ASSERT(!index.contains(0) && index.contains(2));
+	ASSERT((index.search("alph") == ids {2}));
+	ASSERT((index.search("") == ids {1, 2}));
+
+	// Identifiers are not reused, and do not change after compaction
+	ASSERT(index.insert("alpine") == 3);
+	index.compact();
+	ASSERT((index.search("alp") == ids {2, 3}));
+	ASSERT(index[2] == "alphabet" && index[3] == "alpine");
+	ASSERT(index.size() == 3);
+}
+
+void test_random()
+{
+	using namespace ext;
+
+	// The strings are random words of a small alphabet, so most trigrams are shared
+	std::mt19937 random(42);
+	static const char * const letters[] = {"a", "b", "c", "d", "é"};
+	auto word = [&] (size_t max) {
+		std::string result;
+		for (size_t i = random() % max; i > 0; -- i)
+			result += letters[random() % 5];
+		return result;
+	};
+
+	ngram_index<char> index;
+	std::vector<std::string> strings;
+	std::vector<bool> alive;
+	for (int round = 0; round < 3000; ++ round)
+	{
+		// Inserts, and erases (in the second half, enough to compact the index)
+		if ((round < 1500 ? round % 3 == 2 : round % 5 != 0) && !strings.empty())
+		{
+			size_t id = random() % strings.size();
+			ASSERT(index.erase(id) == alive[id]);
+			alive[id] = false;
+		}
+		else
+		{
+			strings.push_back(word(24));
+			alive.push_back(true);
+			ASSERT(index.insert(strings.back()) == strings.size() - 1);
+		}
+
+		// The result of a query is the result of a linear scan
+		if (round % 10 == 0)
+		{
+			std::string sub = word(6);
+			ids expected;
+			for (size_t id = 0; id < strings.size(); ++ id)
+				if (alive[id] && strings[id].find(sub) != std::string::npos)
+					expected.push_back(id);
+			ASSERT(index.search(sub) == expected);
+		}
+	}
+	size_t count = 0;
+	for (bool flag : alive)
+		count += flag;
+	ASSERT(index.size() == count);
+}
+
+int main()
+{
+	printf("Testing search... ");
+	test_search();
+	printf("OK!\n");
+
+	printf("Testing insert and erase... ");
+	test_erase();
+	printf("OK!\n");
+
+	printf("Testing against a linear scan... ");
+	test_random();
+	printf("OK!\n");
+
+	// On success
+	printf("--------------------\nSuccess!\n");
+	return 0;
+}
@@ -0,0 +1,382 @@
+#include "better-regex.hh"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <random>
+#include <regex>
+#include <string>
+#include <vector>
+
+// Helper functions
+
+#define ASSERT(c) assert(c, #c, __FILE__, __LINE__)
+
+inline void assert(bool condition, const char * message, const char * file, long line)
+{
+	if (!condition)
+	{
+		printf("Assertion Failed: %s\nFile: %s, Line: %ld\n", message, file, line);
+		exit(-1);
+	}
+}
+
+// Returns true if the function throws std::invalid_argument
+template<typename Function>
+auto throws(Function function) -> bool
+{
+	try
+	{
+		function();
+	}
+	catch (const std::invalid_argument &)
+	{
+		return true;
+	}
+	return false;
+}
+
+using view = ext::better_string_view<char>;
+
+// Returns the span of the first match as "start-end" (or "none")
+auto span(const ext::regex & re, view text, size_t pos = 0) -> std::string
+{
+	auto found = re.search(text, pos);
+	return found ? std::to_string(found.start()) + "-" + std::to_string(found.end()) : "none";
+}
+
+// Joins the matches of a pattern
+auto all(const ext::regex & re, view text) -> std::string
+{
+	std::string result;
+	for (auto & found : re.finditer(text))
+		result += "[" + std::string(found.group()) + "]";
+	return result;
+}
+
+void test_syntax()
+{
+	using namespace ext;
+
+	// Literals, classes and repetitions
+	ASSERT(span(regex("abc"), "xxabcxx") == "2-5");
+	ASSERT(span(regex("a.c"), "xxabcxx") == "2-5");
+	ASSERT(span(regex("a.c"), "a\nc") == "none");
+	ASSERT(span(regex("(?s)a.c"), "a\nc") == "0-3");
+	ASSERT(span(regex("[0-9]+"), "abc 1234 x") == "4-8");
+	ASSERT(span(regex("[^a-z ]+"), "abc 1234 x") == "4-8");
+	ASSERT(span(regex("\\d{2,3}"), "1 12345") == "2-5");
+	ASSERT(span(regex("\\d{2,}"), "1 12345") == "2-7");
+	ASSERT(span(regex("x{2}"), "xxxx") == "0-2");
+	ASSERT(span(regex("a{,2}b"), "aaab") == "1-4");
+	ASSERT(span(regex("a{1"), "a{1") == "0-3");
+	ASSERT(span(regex("\\w+@\\w+\\.com"), "mail: john@example.com!") == "6-22");
+	ASSERT(span(regex("\\s+"), "a \t\nb") == "1-4");
+	ASSERT(span(regex("[\\d\\s]+"), "ab1 2c") == "2-5");
+	ASSERT(span(regex("[a\\-z]+"), "b-az") == "1-4");
+	ASSERT(span(regex("[]a]+"), "x]a]") == "1-4");
+	ASSERT(span(regex("\\x41\\x{42}\\u0043"), "ABC") == "0-3");
+	ASSERT(span(regex("a\\.b"), "axb a.b") == "4-7");
+
+	// Leftmost-first alternatives, greedy and lazy repetitions
+	ASSERT(regex("a|ab").search("ab").group() == "a");
+	ASSERT(regex("ab|a").search("ab").group() == "ab");
+	ASSERT(regex("a+").search("baaa").group() == "aaa");
+	ASSERT(regex("a+?").search("baaa").group() == "a");
+	ASSERT(regex("<.*>").search("<a><b>").group() == "<a><b>");
+	ASSERT(regex("<.*?>").search("<a><b>").group() == "<a>");
+	ASSERT(regex("a??b").search("ab").group() == "ab");
+	ASSERT(regex("(a|ab)(c|bcd)").search("abcd").group() == "abcd");
+
+	// Assertions
+	ASSERT(span(regex("^abc"), "abcabc", 1) == "none");
+	ASSERT(span(regex("abc$"), "abcabc") == "3-6");
+	ASSERT(span(regex("abc$"), "abc\n") == "none");
+	ASSERT(span(regex("(?m)^b$"), "a\nb\nc") == "2-3");
+	ASSERT(span(regex("^b$", regex::Multiline), "a\nb\nc") == "2-3");
+	ASSERT(span(regex("\\bcat\\b"), "concat cat") == "7-10");
+	ASSERT(span(regex("\\Bcat"), "cat concat") == "7-10");
+	ASSERT(span(regex("\\Acat\\z"), "cat") == "0-3");
+	ASSERT(span(regex("\\bx"), "ax x", 2) == "3-4");
+	ASSERT(span(regex("^"), "abc") == "0-0");
+	ASSERT(span(regex("$"), "abc") == "3-3");
+
+	// Case folding
+	ASSERT(span(regex("hello"), "HeLLo") == "none");
+	ASSERT(span(regex("hello", regex::IgnoreCase), "HeLLo") == "0-5");
+	ASSERT(span(regex("(?i)[a-c]+"), "xABCx") == "1-4");
+	ASSERT(span(regex("(?i:a)b"), "AbAB") == "0-2");
+	ASSERT(span(regex("(?i)[^a]"), "Ab") == "1-2");
+
+	// Invalid patterns
+	ASSERT(throws([] {regex("(a");}));
+	ASSERT(throws([] {regex("a)");}));
+	ASSERT(throws([] {regex("[a");}));
+	ASSERT(throws([] {regex("*a");}));
+	ASSERT(throws([] {regex("a**");}));
+	ASSERT(throws([] {regex("[z-a]");}));
+	ASSERT(throws([] {regex("a{5,2}");}));
+	ASSERT(throws([] {regex("a{2000}");}));
+	ASSERT(throws([] {regex("(a)\\1");}));
+	ASSERT(throws([] {regex("(?=a)");}));
+	ASSERT(throws([] {regex("\\q");}));
+	ASSERT(throws([] {regex("a\\");}));
+	ASSERT(throws([] {regex("(?P<1a>x)");}));
+	ASSERT(throws([] {regex("(?P<a>x)(?P<a>y)");}));
+	ASSERT(throws([] {regex("(?:(?:(?:a{1000}){1000}){1000})");}));
+}
+
+void test_unicode()
+{
+	using namespace ext;
+
+	// Codepoints, not bytes
+	ASSERT(regex("h.llo").search("h\xC3\xA9llo").group() == "h\xC3\xA9llo");
+	ASSERT(regex("[\xC3\xA0-\xC3\xBF]+").search("caf\xC3\xA9s").group() == "\xC3\xA9");
+	ASSERT(regex("[^a]").search("\xE2\x82\xAC").group() == "\xE2\x82\xAC");
+	ASSERT(regex("\\x{1F600}").search("x\xF0\x9F\x98\x80").start() == 1);
+	ASSERT(regex("[\\x{100}-\\x{10FFFF}]+").search("ab\xC4\x80\xF4\x8F\xBF\xBFz").group() == "\xC4\x80\xF4\x8F\xBF\xBF");
+	ASSERT(!regex("\\w").search("\xC3\xA9"));
+	ASSERT(throws([] {regex("\xC3");}));
+
+	// Bytes
+	ASSERT(!regex("h.llo", regex::Bytes).search("h\xC3\xA9llo"));
+	ASSERT(regex("h..llo", regex::Bytes).search("h\xC3\xA9llo").group() == "h\xC3\xA9llo");
+	ASSERT(regex("[\\x80-\\xFF]+", regex::Bytes).search("a\xFF\x80z").group() == "\xFF\x80");
+	ASSERT(throws([] {regex("\\x{100}", regex::Bytes);}));
+
+	// Empty matches advance by codepoints
+	ASSERT(all(regex(""), "\xC3\xA9x") == "[][][]");
+}
+
+void test_groups()
+{
+	using namespace ext;
+
+	// Captures
+	regex date("(\\d{4})-(\\d{2})-(\\d{2})");
+	auto found = date.search("on 2024-01-31.");
+	ASSERT(found && found.size() == 4 && date.groups() == 3);
+	ASSERT(found.group(1) == "2024" && found.group(2) == "01" && found.group(3) == "31");
+	ASSERT(found.start(2) == 8 && found.end(3) == 13);
+	ASSERT(found.group(4).empty() && found.start(4) == size_t(-1));
+
+	// Named groups, and groups that do not participate
+	regex pair("(?P<key>\\w+)=(?:(?P<number>\\d+)|(?<word>[a-z]+))");
+	found = pair.search("x: size=large");
+	ASSERT(found.group("key") == "size" && found.group("word") == "large");
+	ASSERT(found.group("number").empty() && found.start(2) == size_t(-1));
+	ASSERT(pair.group_index("word") == 3 && pair.group_index("none") == size_t(-1));
+
+	// Repeated groups keep the last iteration
+	regex repeated("(?:(a)|(b))+"), empty("(a*)+"), nested("(a|ab)(c|bcd)(d*)");
+	found = repeated.search("ab");
+	ASSERT(found.group(1) == "a" && found.group(2) == "b");
+	found = empty.search("b");
+	ASSERT(found.group() == "" && found.group(1) == "");
+	found = nested.search("abcd");
+	ASSERT(found.group(1) == "a" && found.group(2) == "bcd" && found.group(3) == "");
+
+	// An empty iteration ends the repetition, and keeps its groups (as in Python)
+	regex star("(a*)*"), plus("(a|)+"), nothing("()*"), first("(|a)*b"), lazy("(a*)*?");
+	found = star.search("b");
+	ASSERT(found.end() == 0 && found.start(1) == 0 && found.end(1) == 0);
+	found = star.search("aa");
+	ASSERT(found.end() == 2 && found.start(1) == 2 && found.end(1) == 2);
+	found = nothing.search("");
+	ASSERT(found && found.start(1) == 0 && found.end(1) == 0);
+	found = plus.search("aa");
+	ASSERT(found.end() == 2 && found.start(1) == 2 && found.end(1) == 2);
+	found = first.search("ab");
+	ASSERT(found.end() == 2 && found.start(1) == 1 && found.end(1) == 1);
+	found = lazy.search("a");
+	ASSERT(found.end() == 0 && found.start(1) == size_t(-1));
+	ASSERT(span(regex("(?:|a)*"), "aaa") == "0-0" && span(regex("(?:a*?)*"), "aa") == "0-0");
+
+	// Anchored match
+	ASSERT(regex("\\d+").match("12ab") && regex("\\d+").match("12ab").end() == 2);
+	ASSERT(!regex("\\d+").match("ab12"));
+	ASSERT(regex("\\d+").match("ab12", 2).group() == "12");
+
+	// Required literals
+	ASSERT(regex("\\d+ms").required() == "ms");
+	ASSERT(regex("GET (/\\w+)+ HTTP").required() == " HTTP");
+	ASSERT(regex("(?i)abc").required().empty());
+}
+
+void test_iteration()
+{
+	using namespace ext;
+
+	// Matches, and empty matches (as in Python 3.7)
+	ASSERT(all(regex("\\d+"), "a1b22c333") == "[1][22][333]");
+	ASSERT(all(regex("|a"), "ab") == "[][a][][]");
+	ASSERT(all(regex("x*"), "axxb") == "[][xx][][]");
+	ASSERT(all(regex("\\b"), "ab cd") == "[][][][]");
+	ASSERT(all(regex("a|"), "ab") == "[a][][]");
+	ASSERT(all(regex("z"), "abc").empty());
+	ASSERT(all(regex("x*|a*b"), "aaba") == "[][aab][][]");
+	ASSERT(all(regex("(|a)*"), "aa") == "[][a][][a][]");
+
+	// Split
+	auto parts = regex(",\\s*").split("a, b,c,  d");
+	ASSERT(parts.size() == 4 && parts[0] == "a" && parts[1] == "b" && parts[3] == "d");
+	parts = regex("(,)").split("a,b");
+	ASSERT(parts.size() == 3 && parts[1] == ",");
+	parts = regex("x*").split("axb");
+	ASSERT(parts.size() == 5 && parts[0] == "" && parts[1] == "a" && parts[2] == "" && parts[3] == "b" && parts[4] == "");
+	parts = regex(",").split("a,b,c", 1);
+	ASSERT(parts.size() == 2 && parts[1] == "b,c");
+
+	// Substitution
+	ASSERT(regex("(\\w+)@(\\w+)").sub("\\2 at \\1", "mail bob@home now") == "mail home at bob now");
+	ASSERT(regex("(?P<n>\\d+)").sub("<\\g<n>|\\g<0>>", "a1b22") == "a<1|1>b<22|22>");
+	ASSERT(regex("x*").sub("-", "abxd") == "-a-b--d-");
+	ASSERT(regex("a").sub("\\\\\\n", "a") == "\\\n");
+	ASSERT(regex("a").sub("b", "aaaa", 2) == "bbaa");
+	ASSERT(throws([] {regex("(a)").sub("\\2", "a");}));
+	ASSERT(throws([] {regex("(a)").sub("\\g<name>", "a");}));
+	ASSERT(throws([] {regex("a").sub("\\q", "a");}));
+
+	better_string<char> output("> ");
+	regex("o").sub_into("0", "foo", output);
+	ASSERT(output == "> f00");
+}
+
+void test_linear()
+{
+	using namespace ext;
+
+	// Patterns that make backtracking engines exponential
+	better_string<char> text(30, 'a');
+	ASSERT(!regex("(a+)+b").search(text));
+	ASSERT(!regex("(a|aa)*c").search(text));
+	ASSERT(regex("(a*)*$").search(text).end() == 30);
+
+	// Groups of long matches (found by the simulation of the NFA, instead of backtracking)
+	better_string<char> runs(100000, 'a');
+	runs += better_string<char>(10, 'b');
+	regex pair("(a+?)(a*)(b+)$");
+	auto groups = pair.search(runs);
+	ASSERT(groups.group(1).size() == 1 && groups.group(2).size() == 99999 && groups.group(3).size() == 10);
+
+	// A large input, with a cache that is flushed many times (the DFA of (.)*a.{12} has many states)
+	std::mt19937 random(42);
+	better_string<char> large;
+	for (size_t i = 0; i < 200000; ++ i)
+		large.push_back("ab"[random() & 1]);
+	regex many("a[ab]{12}$");
+	auto found = many.search(large);
+	ASSERT(bool(found) == (large[large.size() - 13] == 'a'));
+	size_t count = 0;
+	regex suffix("a[ab]{12}b");
+	for (auto & item : suffix.finditer(large))
+		count += item.size();
+	ASSERT(count > 0);
+
+	// Iteration after empty matches, when a longer match fails at the end of the text
+	better_string<char> repeats(20000, 'a');
+	regex failing("x*|a*b");
+	count = 0;
+	for (auto & item : failing.finditer(repeats))
+		count += item.group().empty();
+	ASSERT(count == 20001);
+}
+
+// Compares the matches with std::regex, on random patterns and texts (the syntax of the patterns is the same)
+void test_random()
+{
+	using namespace ext;
+
+	static const char * atoms[] = {
+		"a", "b", "c", ".", "[ab]", "[^a]", "\\d", "\\w", "\\s", "\\b", "\\B", "^", "$", "(a)", "(ab|b)", "(?:a|c)",
+	};
+	static const char * quantifiers[] = {"", "", "", "*", "+", "?", "*?", "+?", "??", "{2}", "{1,2}", "{0,3}?"};
+
+	std::mt19937 random(7);
+	for (size_t i = 0; i < 3000; ++ i)
+	{
+		// A random pattern
+		std::string pattern;
+		size_t length = 1 + random() % 5;
+		for (size_t k = 0; k < length; ++ k)
+		{
+			std::string atom = atoms[random() % (sizeof(atoms) / sizeof(*atoms))];
+			bool assertion = (atom == "\\b" || atom == "\\B" || atom == "^" || atom == "$");
+			pattern += atom;
+			if (!assertion)
+				pattern += quantifiers[random() % (sizeof(quantifiers) / sizeof(*quantifiers))];
+			if (random() % 7 == 0)
+				pattern += "|";
+		}
+
+		// A random text
+		std::string text;
+		size_t size = random() % 12;
+		for (size_t k = 0; k < size; ++ k)
+			text.push_back("abc1 \n"[random() % 6]);
+
+		regex re(view(pattern.data(), pattern.size()));
+		std::regex expected(pattern);
+
+		// The first match from every position, with its groups (the iteration after empty matches is different in
+		// libstdc++, it is tested above)
+		for (size_t pos = 0; pos <= text.size(); ++ pos)
+		{
+			std::string a = "none", b = "none";
+			auto found = re.search(view(text.data(), text.size()), pos);
+			if (found)
+				a.clear();
+			for (size_t k = 0; found && k < found.size(); ++ k)
+				a += " " + std::to_string(found.start(k)) + "-" + std::to_string(found.end(k));
+
+			std::smatch match;
+			auto flags = pos ? std::regex_constants::match_prev_avail : std::regex_constants::match_default;
+			if (std::regex_search(text.cbegin() + pos, text.cend(), match, expected, flags))
+				b.clear();
+			for (size_t k = 0; k < match.size(); ++ k)
+				{
+					size_t start = match[k].matched ? pos + match.position(k) : size_t(-1);
+					size_t end = match[k].matched ? start + match.length(k) : size_t(-1);
+					b += " " + std::to_string(start) + "-" + std::to_string(end);
+				}
+
+			if (a != b)
+			{
+				printf("\nPattern: %s, text: \"%s\", position: %zu\nregex: %s\nstd::regex: %s\n", pattern.c_str(), text.c_str(), pos, a.c_str(), b.c_str());
+				ASSERT(false);
+			}
+		}
+	}
+}
+
+int main()
+{
+	printf("Testing the syntax... ");
+	test_syntax();
+	printf("OK!\n");
+
+	printf("Testing unicode... ");
+	test_unicode();
+	printf("OK!\n");
+
+	printf("Testing groups... ");
+	test_groups();
+	printf("OK!\n");
+
+	printf("Testing iteration... ");
+	test_iteration();
+	printf("OK!\n");
+
+	printf("Testing linear time... ");
+	test_linear();
+	printf("OK!\n");
+
+	printf("Testing against std::regex... ");
+	test_random();
+	printf("OK!\n");
+
+	// On success
+	printf("--------------------\nSuccess!\n");
+	return 0;
+}
@@ -1,6 +1,12 @@
 #include "better-string.hh"
 
 #include <stdio.h>
+#include <stdlib.h>
+
+#include <cstddef>
+#include <new>
+#include <random>
+#include <vector>
 
 // Helper functions
 
@@ -15,6 +21,118 @@ inline void assert(bool condition, const char * message, const char * file, long
 	}
 }
 
+// Returns true if the function throws std::invalid_argument
+template<typename Function>
+auto throws(Function function) -> bool
+{
+	try
+	{
+		function();
+	}
+	catch (const std::invalid_argument &)
+	{
+		return true;
+	}
+	return false;
+}
+
+// Number of allocations made with operator new (counted by the replacements below, every form of operator new and
+// operator delete is replaced so the pairs match)
+static size_t allocations = 0;
+
+static auto counted_malloc(size_t size, size_t alignment = alignof(std::max_align_t)) noexcept -> void *
+{
+	++ allocations;
+	size = size ? (size + alignment - 1) / alignment * alignment : alignment;
+	return (alignment > alignof(std::max_align_t)) ? aligned_alloc(alignment, size) : malloc(size);
+}
+
+static auto counted_new(size_t size, size_t alignment = alignof(std::max_align_t)) -> void *
+{
+	if (void * ptr = counted_malloc(size, alignment))
+		return ptr;
+	throw std::bad_alloc();
+}
+
+void * operator new (size_t size)
+	{return counted_new(size);}
+void * operator new[] (size_t size)
+	{return counted_new(size);}
+void * operator new (size_t size, std::align_val_t alignment)
+	{return counted_new(size, size_t(alignment));}
+void * operator new[] (size_t size, std::align_val_t alignment)
+	{return counted_new(size, size_t(alignment));}
+void * operator new (size_t size, const std::nothrow_t &) noexcept
+	{return counted_malloc(size);}
+void * operator new[] (size_t size, const std::nothrow_t &) noexcept
+	{return counted_malloc(size);}
+void * operator new (size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+	{return counted_malloc(size, size_t(alignment));}
+void * operator new[] (size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+	{return counted_malloc(size, size_t(alignment));}
+
+void operator delete (void * ptr) noexcept
+	{free(ptr);}
+void operator delete[] (void * ptr) noexcept
+	{free(ptr);}
+void operator delete (void * ptr, size_t) noexcept
+	{free(ptr);}
+void operator delete[] (void * ptr, size_t) noexcept
+	{free(ptr);}
+void operator delete (void * ptr, std::align_val_t) noexcept
+	{free(ptr);}
+void operator delete[] (void * ptr, std::align_val_t) noexcept
+	{free(ptr);}
+void operator delete (void * ptr, size_t, std::align_val_t) noexcept
+	{free(ptr);}
+void operator delete[] (void * ptr, size_t, std::align_val_t) noexcept
+	{free(ptr);}
+void operator delete (void * ptr, const std::nothrow_t &) noexcept
+	{free(ptr);}
+void operator delete[] (void * ptr, const std::nothrow_t &) noexcept
+	{free(ptr);}
+void operator delete (void * ptr, std::align_val_t, const std::nothrow_t &) noexcept
+	{free(ptr);}
+void operator delete[] (void * ptr, std::align_val_t, const std::nothrow_t &) noexcept
+	{free(ptr);}
+
+// Returns the number of allocations made by a function
+template<typename Function>
+auto count_allocations(Function && function) -> size_t
+{
+	size_t start = allocations;
+	function();
+	return allocations - start;
+}
+
+// Allocator counting its own allocations (for the functions with an allocator parameter)
+template<typename T>
+class CountingAllocator : public std::allocator<T>
+{
+public:
+	using value_type = T;
+	template<typename U> struct rebind {using other = CountingAllocator<U>;};
+
+	static size_t count;
+
+	CountingAllocator() = default;
+	template<typename U>
+	CountingAllocator(const CountingAllocator<U> &) noexcept {}
+
+	auto allocate(size_t n) -> T *
+		{++ count; return std::allocator<T>::allocate(n);}
+	void deallocate(T * ptr, size_t n) noexcept
+		{std::allocator<T>::deallocate(ptr, n);}
+
+	template<typename U>
+	auto operator == (const CountingAllocator<U> &) const -> bool {return true;}
+	template<typename U>
+	auto operator != (const CountingAllocator<U> &) const -> bool {return false;}
+};
+
+template<typename T>
+size_t CountingAllocator<T>::count = 0;
+
 // Testing functions
 
 template<typename string>
@@ -70,6 +188,9 @@ void test_search()
 	ASSERT(string("😀😀😀✏✏✏").find("😀😀😀") == 0);
 	ASSERT(string("✏✏✏😀😀😀").find("😀😀😀") == 9);
 	ASSERT(string("✏✏✏✏✏✏").find("😀😀😀") == -1);
+	ASSERT(string("ab").find("abc") == -1);
+	ASSERT(string("abcabc").find("abc", 4) == -1);
+	ASSERT(string("abcabc").find("abc", 5, 2) == -1);
 
 	// string::rfind
 	ASSERT(string("abcabc").rfind("abc") == 3);
@@ -80,6 +201,8 @@ void test_search()
 	ASSERT(string("😀😀😀✏✏✏").rfind("😀😀😀") == 0);
 	ASSERT(string("✏✏✏😀😀😀").rfind("😀😀😀") == 9);
 	ASSERT(string("✏✏✏✏✏✏").rfind("😀😀😀") == -1);
+	ASSERT(string("ab").rfind("abc") == -1);
+	ASSERT(string("abcabc").rfind("abc", 0, 5) == 0);
 
 	// string::index
 	ASSERT(string("abcabc").index("abc") == 0);
@@ -106,6 +229,155 @@ void test_search()
 	ASSERT(string("😀😀😀✏✏✏").count("😀😀😀") == 1);
 	ASSERT(string("✏✏✏😀😀😀").count("😀😀😀") == 1);
 	ASSERT(string("😀😀😀😀😀😀").count("😀😀😀") == 2);
+	ASSERT(string("ab").count("abc") == 0);
+	ASSERT(string("abc").count("") == 4);
+	ASSERT(string("😀✏").count("") == 3);
+
+	// string::finditer
+	using offsets = std::vector<size_t>;
+	string text("aaaa😀😀😀a");
+	ASSERT(text.finditer("aa").offsets() == (offsets {0, 2}));
+	ASSERT(text.finditer("aa", true).offsets() == (offsets {0, 1, 2}));
+	ASSERT(text.finditer("😀😀", true).offsets() == (offsets {4, 8}));
+	ASSERT(text.finditer("😀😀").offsets() == (offsets {4}));
+	ASSERT(text.finditer("\x98\x80").offsets().empty());
+	ASSERT(text.finditer("b").offsets().empty());
+	ASSERT(string("a😀").finditer("").offsets() == (offsets {0, 1, 5}));
+	ASSERT(string("").finditer("").offsets() == (offsets {0}));
+	size_t matches = 0;
+	for (auto match : text.finditer("a"))
+		matches += (match == "a" && match.data() >= text.data());
+	ASSERT(matches == 5);
+	auto emoji = text.finditer("😀");
+	auto iter = emoji.begin();
+	ASSERT((++ iter).offset() == 8 && iter->size() == 4);
+
+	// string::find_all (the chunks of long strings are searched by threads)
+	ASSERT(text.find_all("aa") == (offsets {0, 2}));
+	ASSERT(text.find_all("aa", true) == (offsets {0, 1, 2}));
+	string large;
+	for (int i = 0; i < 200000; ++ i)
+		large.extend(better_string_view<char>((i % 7) ? "aa😀" : "a✏"));
+	for (const char * sub : {"aa", "a", "😀a", "\x98\x80", "", "a✏a"})
+		for (bool overlapping : {false, true})
+			ASSERT(large.find_all(sub, overlapping, 5) == large.finditer(sub, overlapping).offsets());
+	ASSERT(large.find_all("😀a").size() == large.count("😀a"));
+
+	printf("OK!\n");
+}
+
+// Returns the edit distance of two lists of characters, with the whole matrix (and transpositions, for damerau)
+auto reference_distance(const std::vector<uint32_t> & a, const std::vector<uint32_t> & b, bool transpositions) -> size_t
+{
+	std::vector<std::vector<size_t>> d(a.size() + 1, std::vector<size_t>(b.size() + 1));
+	for (size_t i = 0; i <= a.size(); ++ i)
+		for (size_t j = 0; j <= b.size(); ++ j)
+		{
+			if (i == 0 || j == 0)
+			{
+				d[i][j] = i + j;
+				continue;
+			}
+			d[i][j] = std::min({d[i - 1][j] + 1, d[i][j - 1] + 1, d[i - 1][j - 1] + (a[i - 1] != b[j - 1])});
+			if (transpositions && i > 1 && j > 1 && a[i - 1] == b[j - 2] && a[i - 2] == b[j - 1])
+				d[i][j] = std::min(d[i][j], d[i - 2][j - 2] + 1);
+		}
+	return d[a.size()][b.size()];
+}
+
+template<typename string>
+void test_edit_distance()
+{
+	using namespace ext;
+	printf("Testing edit distance functions... ");
+
+	// string::levenshtein
+	ASSERT(string("").levenshtein("") == 0);
+	ASSERT(string("abc").levenshtein("") == 3);
+	ASSERT(string("").levenshtein("abc") == 3);
+	ASSERT(string("kitten").levenshtein("sitting") == 3);
+	ASSERT(string("sitting").levenshtein("kitten") == 3);
+	ASSERT(string("flaw").levenshtein("lawn") == 2);
+	ASSERT(string("ca").levenshtein("ac") == 2);
+	ASSERT(string("kitten").levenshtein("sitting", 1) == 2);
+	ASSERT(string("kitten").levenshtein("sitting", 3) == 3);
+	ASSERT(string("a").levenshtein("abcdefgh", 2) == 3);
+	ASSERT(string("café").levenshtein("cafe") == 1);
+	ASSERT(string("😀✏").levenshtein("✏😀") == 2);
+	ASSERT(string("😀✏").template levenshtein<Encoding::Char8>("✏😀") == 6);
+
+	// string::damerau
+	ASSERT(string("ca").damerau("ac") == 1);
+	ASSERT(string("ca").damerau("abc") == 3);
+	ASSERT(string("teh").damerau("the") == 1);
+	ASSERT(string("😀✏").damerau("✏😀") == 1);
+	ASSERT(string("abcdef").damerau("badcfe", 2) == 3);
+
+	// string::fuzzy_find
+	size_t length = 0;
+	ASSERT(string("the quick brown fox").fuzzy_find("qvxyz", 2) == -1);
+	ASSERT(string("the quick brown fox").fuzzy_find("quikc", 1, length) == 4 && length == 4);
+	ASSERT(string("the quick brown fox").fuzzy_find("quikc", 2, length) == 4 && length == 3);
+	ASSERT(string("the quick brown fox").fuzzy_find("brwn", 1, length) == 10 && length == 5);
+	ASSERT(string("the quick brown fox").fuzzy_find("fox", 0, length) == 16 && length == 3);
+	ASSERT(string("abc").fuzzy_find("xyz", 3, length) == 0 && length == 0);
+	ASSERT(string("abc").fuzzy_find("", 0) == 0);
+	ASSERT(string("naïve café").fuzzy_find("cafe", 1, length) == 7 && length == 3);
+	ASSERT(string("😀😀😀✏✏").fuzzy_find("✏😀", 0, length) == -1);
+	ASSERT(string("😀😀😀✏✏").fuzzy_find("😀✏", 0, length) == 8 && length == 7);
+
+	// Random strings (longer than one block), with and without limits
+	std::mt19937 random(42);
+	static const char * const letters[] = {"a", "b", "c", "é"};
+	for (int round = 0; round < 1500; ++ round)
+	{
+		// The second string is a copy of the first, with random edits
+		std::string a, b;
+		std::vector<const char *> chosen;
+		size_t m = random() % (round % 10 ? 24 : 200), n = m + random() % 8 - std::min<size_t>(m, 4);
+		for (size_t i = 0; i < m; ++ i)
+			chosen.push_back(letters[random() % (round % 3 ? 3 : 4)]);
+		for (size_t i = 0; i < m; ++ i)
+			a += chosen[i];
+		for (size_t i = 0; i < n; ++ i)
+			b += (i < m && random() % 4) ? chosen[i] : letters[random() % 4];
+		std::vector<uint32_t> x, y;
+		for (int32_t ch : better(a).codepoints())
+			x.push_back(ch);
+		for (int32_t ch : better(b).codepoints())
+			y.push_back(ch);
+
+		size_t max = (round % 2) ? size_t(-1) : random() % 20;
+		auto limited = [max] (size_t distance) {return (max == size_t(-1)) ? distance : std::min(distance, max + 1);};
+		ASSERT(better(a).levenshtein(b, max) == limited(reference_distance(x, y, false)));
+		ASSERT(better(a).damerau(b, max) == limited(reference_distance(x, y, true)));
+
+		// The first end of a match within the limit (the matrix of the pattern, with zeros in the first row)
+		size_t k = random() % 6;
+		size_t start = better(b).fuzzy_find(a, k, length);
+		std::vector<size_t> column(x.size() + 1);
+		for (size_t i = 0; i <= x.size(); ++ i)
+			column[i] = i;
+		size_t end = (x.size() <= k) ? 0 : size_t(-1);
+		for (size_t j = 0; j < y.size() && end == size_t(-1); ++ j)
+		{
+			size_t diagonal = column[0];
+			for (size_t i = 1; i <= x.size(); ++ i)
+			{
+				size_t value = std::min({column[i] + 1, column[i - 1] + 1, diagonal + (x[i - 1] != y[j])});
+				diagonal = column[i];
+				column[i] = value;
+			}
+			if (column[x.size()] <= k)
+				end = j + 1;
+		}
+		ASSERT((start == size_t(-1)) == (end == size_t(-1)));
+		if (start != size_t(-1))
+		{
+			ASSERT(better(b.substr(start, length)).levenshtein(a) <= k);
+			ASSERT(better(b.substr(0, start + length)).length() == end);
+		}
+	}
 
 	printf("OK!\n");
 }
@@ -132,6 +404,13 @@ void test_replace()
 	ASSERT(string("abcdef").translate([] (int32_t ch) -> int32_t {return ch - 'a' + 'A';}) == "ABCDEF");
 
 	// string::maketrans
+	ASSERT(string("hello").translate(string::maketrans("el", "ip", "o")) == "hipp");
+	ASSERT(string("abc").translate(string::maketrans("aa", "xy")) == "ybc");
+	ASSERT(string("abc").translate(string::maketrans("a", "x", "a")) == "bc");
+	ASSERT(string("naïve ✏ 😀").translate(string::maketrans("ï✏😀", "i😀✏", " ")) == "naive😀✏");
+	bool thrown = false;
+	try {string::maketrans("ab", "x");} catch (const std::invalid_argument &) {thrown = true;}
+	ASSERT(thrown);
 
 	// string::expandtabs
 	ASSERT(string("\t").expandtabs() == "    ");
@@ -191,6 +470,177 @@ void test_split_join()
 	ASSERT(better_string<char>("a-b-c-d").rsplit("-", 0) == std::vector<better_string<char>>({"a-b-c-d"}));
 	ASSERT(better_string<char>("a😀b😀c😀d").rsplit("😀") == std::vector<better_string<char>>({"a", "b", "c", "d"}));
 
+	// string::split_any
+	static constexpr charset<> seps(",;");
+	ASSERT(string("a,b;c").split_any(seps) == std::vector<string>({"a", "b", "c"}));
+	ASSERT(string("a,;b,").split_any(",;") == std::vector<string>({"a", "", "b", ""}));
+	ASSERT(string("a,b;c").split_any(seps, 1) == std::vector<string>({"a", "b;c"}));
+	ASSERT(string("abc").split_any(seps) == std::vector<string>({"abc"}));
+	ASSERT(string("").split_any(seps) == std::vector<string>({""}));
+	ASSERT(string("a😀b✏c").split_any("✏😀") == std::vector<string>({"a", "b", "c"}));
+
+	printf("OK!\n");
+}
+
+template<typename string>
+void test_character()
+{
+	using namespace ext;
+	printf("Testing character functions... ");
+
+	// string::isascii
+	ASSERT(string("").isascii());
+	ASSERT(string("abc def\t\n~").isascii());
+	ASSERT(string("0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef").isascii());
+	ASSERT(!string("abc✏").isascii());
+	ASSERT(!string("0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef😀").isascii());
+
+	printf("OK!\n");
+}
+
+// Returns the offset of the first character, that is (or is not) in a set of codepoints (a decoding reference)
+auto reference_find(const std::string & text, const std::vector<int32_t> & set, bool member) -> size_t
+{
+	auto & view = ext::better(text);
+	for (auto iter = view.codepoints().begin(); iter != view.codepoints().end(); ++ iter)
+		if ((std::find(set.begin(), set.end(), *iter) != set.end()) == member)
+			return static_cast<const char *>(iter) - text.data();
+	return size_t(-1);
+}
+
+// Returns the end of the last character, that is not in a set of codepoints
+auto reference_end(const std::string & text, const std::vector<int32_t> & set) -> size_t
+{
+	size_t end = 0;
+	auto & view = ext::better(text);
+	for (auto iter = view.codepoints().begin(); iter != view.codepoints().end();)
+	{
+		bool member = std::find(set.begin(), set.end(), *iter) != set.end();
+		++ iter;
+		if (!member)
+			end = static_cast<const char *>(iter) - text.data();
+	}
+	return end;
+}
+
+template<typename string>
+void test_charset()
+{
+	using namespace ext;
+	printf("Testing character sets... ");
+
+	// charset
+	static constexpr charset<> vowels("aeiouáé😀");
+	static_assert(vowels.contains('a') && vowels.contains(0xE9) && vowels.contains(0x1F600), "");
+	static_assert(!vowels.contains('b') && !vowels.contains(0x1F601) && !vowels.contains(-1), "");
+	static_assert(vowels.range_count() == 1, "");
+	charset<Encoding::UTF8, 2> small;
+	ASSERT(small.empty());
+	ASSERT(small.insert(0x100, 0x1FF) && small.insert(0x300) && small.insert(0x200, 0x2FF));
+	ASSERT(small.range_count() == 1 && small.range_at(0).first == 0x100 && small.range_at(0).last == 0x300);
+	ASSERT(small.insert(0x400) && !small.insert(0x500) && !small.contains(0x500));
+	bool thrown = false;
+	try {charset<>("\xFF");} catch (const std::invalid_argument &) {thrown = true;}
+	ASSERT(thrown);
+
+	// string::find_first_of and the others
+	ASSERT(string("hello world").find_first_of(vowels) == 1);
+	ASSERT(string("hello world").find_first_of(vowels, 5) == 7);
+	ASSERT(string("hello world").find_first_not_of(charset<>("hel")) == 4);
+	ASSERT(string("hello world").find_last_of(vowels) == 7);
+	ASSERT(string("hello world").find_last_of(vowels, 6) == 4);
+	ASSERT(string("hello world").find_last_not_of(charset<>("dl")) == 8);
+	ASSERT(string("xyz").find_first_of(vowels) == -1);
+	ASSERT(string("xyz").find_last_of(vowels) == -1);
+	ASSERT(string("hello world").find_first_of("ow") == 4);
+	ASSERT(string("smörgåsbrd 😀").find_first_of(vowels) == 13);
+	ASSERT(string("naïve café").find_first_of(vowels, 4) == 5);
+	ASSERT(string("naïve café").find_last_of(vowels) == 10);
+	ASSERT(string("ææææa").find_first_of(vowels) == 8);
+	ASSERT(string("aaa bbb").span(charset<>("a")) == 3);
+	ASSERT(string("aaa bbb").span(charset<>("a"), 4) == 0);
+	ASSERT(string("aaa bbb").cspan(charset<>("b")) == 4);
+	ASSERT(string("aaa bbb").cspan(charset<>("x")) == 7);
+	ASSERT(string("aaa").span(charset<>("a"), 9) == 0);
+	ASSERT(better_string<char16_t>(u"xy😀z").find_first_of(charset<Encoding::UTF16>(u"😀z")) == 2);
+	ASSERT(better_string<char16_t>(u"xy😀z").find_last_not_of(charset<Encoding::UTF16>(u"😀z")) == 1);
+	ASSERT(better_string<char>("\xE9\xE9x").find_first_not_of(charset<Encoding::Char8>("\xE9")) == 2);
+
+	// string::strip, string::lstrip and string::rstrip
+	ASSERT(string(" \t abc \n").strip() == "abc");
+	ASSERT(string("\u00A0\u3000abc\u2003").strip() == "abc");
+	ASSERT(string(" \t abc \n").lstrip() == "abc \n");
+	ASSERT(string(" \t abc \n").rstrip() == " \t abc");
+	ASSERT(string("   ").strip() == "" && string("").strip() == "");
+	ASSERT(string("xxabcxyx").strip("xy") == "abc");
+	ASSERT(string("xxabcxyx").lstrip("xy") == "abcxyx");
+	ASSERT(string("xxabcxyx").rstrip("xy") == "xxabc");
+	ASSERT(string("😀✏abc✏").strip("✏😀") == "abc");
+	ASSERT(string("abc").strip("") == "abc");
+	ASSERT(string("ab").rstrip("ab") == "");
+	ASSERT(better_string_view<char>("..abc..").strip(charset<>(".")) == "abc");
+	ASSERT(better_string<char>("\xA0" "abc").template strip<Encoding::Char8>() == "\xA0" "abc");
+
+	// A set with more ranges than a charset has
+	better_string<char> many;
+	for (uint32_t cp = 0x400; cp < 0x440; cp += 2)
+		UTF8Encoder::append(many, cp);
+	ASSERT(!charset<>().insert(many.data(), many.size()));
+	better_string<char> text = many;
+	text.extend(better_string_view<char>("ab"));
+	text.extend(many);
+	ASSERT(text.strip(many) == "ab");
+	ASSERT(text.lstrip(many) == text.substr(many.size()));
+	ASSERT(text.split_any(many).size() == 65);
+
+	// Random strings, against decoding every character
+	std::mt19937 random(42);
+	static const char * const letters[] = {"a", "b", "c", " ", "é", "ö", "✏", "😀", "\xFF"};
+	for (int round = 0; round < 2000; ++ round)
+	{
+		std::string text, chars;
+		for (size_t i = random() % (round % 10 ? 24 : 200); i > 0; -- i)
+			text += letters[random() % 9];
+		for (size_t i = random() % 4; i > 0; -- i)
+			chars += letters[random() % 8];
+		charset<> set(chars.data(), chars.size());
+		std::vector<int32_t> list;
+		for (int32_t ch : better(chars).codepoints())
+			list.push_back(ch);
+		ASSERT(better(text).find_first_of(set) == reference_find(text, list, true));
+		ASSERT(better(text).find_first_not_of(set) == reference_find(text, list, false));
+		size_t first = reference_find(text, list, false);
+		size_t end = reference_end(text, list);
+		ASSERT(better(text).lstrip(set) == text.substr(std::min(first, text.size())));
+		ASSERT(better(text).rstrip(set) == text.substr(0, end));
+		ASSERT(better(text).strip(chars) == (first == size_t(-1) ? "" : text.substr(first, end - first)));
+	}
+
+	printf("OK!\n");
+}
+
+template<typename string>
+void test_case()
+{
+	using namespace ext;
+	printf("Testing character case functions... ");
+
+	// string::upper
+	ASSERT(string("").upper() == "");
+	ASSERT(string("abcxyz").upper() == "ABCXYZ");
+	ASSERT(string("ABC@[`{123").upper() == "ABC@[`{123");
+	ASSERT(string("abc✏😀def").upper() == "ABC✏😀DEF");
+	ASSERT(string("the quick brown fox jumps over the lazy dog, the quick brown fox jumps over the lazy dog").upper() ==
+		"THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG, THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG");
+
+	// string::lower
+	ASSERT(string("").lower() == "");
+	ASSERT(string("ABCXYZ").lower() == "abcxyz");
+	ASSERT(string("abc@[`{123").lower() == "abc@[`{123");
+	ASSERT(string("ABC✏😀DEF").lower() == "abc✏😀def");
+	ASSERT(string("THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG, THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG").lower() ==
+		"the quick brown fox jumps over the lazy dog, the quick brown fox jumps over the lazy dog");
+
 	printf("OK!\n");
 }
 
@@ -229,6 +679,42 @@ void test_format()
 	ASSERT(ascii("✏✏✏") == "\"\\u270f\\u270f\\u270f\"");
 	ASSERT(ascii("😀😀😀") == "\"\\U0001f600\\U0001f600\\U0001f600\"");
 
+	// repr and ascii - long strings (the runs without escapes are copied at once)
+	better_string<char> run(100, 'x');
+	ASSERT(repr(better_string<char>("a\0b", 3)) == "\"a\\0b\"");
+	ASSERT(repr("'\x01\x7F") == "\"\\'\\u0001\x7F\"");
+	ASSERT(repr(better(run + "\"" + run + "\x1B" + run)) == "\"" + run + "\\\"" + run + "\\u001b" + run + "\"");
+	ASSERT(repr(better(run + "✏\xC3" + run + "\\")) == "\"" + run + "✏\uFFFD" + run + "\\\\\"");
+	ASSERT(ascii(better(run + "✏\xC3" + run + "😀")) == "\"" + run + "\\u270f?" + run + "\\U0001f600\"");
+
+	// unquote - inverse of repr and ascii
+	ASSERT(better_string<char>("\"\"").unquote() == "");
+	ASSERT(better_string<char>("'abc'").unquote() == "abc");
+	ASSERT(better_string<char>("\"\\a\\b\\f\\n\\r\\t\\v\\0\\'\\\"\\\\\"").unquote() == better_string<char>("\a\b\f\n\r\t\v\0'\"\\", 11));
+	ASSERT(better_string<char>("\"\\x41\\u270f\\U0001F600\"").unquote() == "A✏😀");
+	ASSERT(repr(better(run + "\x01✏\"" + run)).unquote() == run + "\x01✏\"" + run);
+	ASSERT(ascii(better(run + "\x01✏\"" + run)).unquote() == run + "\x01✏\"" + run);
+	ASSERT(better_string<char16_t>(u"\"\\n\\U0001F600\"").unquote() == u"\n😀");
+
+	// unquote - errors
+	ASSERT(throws([] {better_string<char>("abc").unquote();}));
+	ASSERT(throws([] {better_string<char>("\"abc'").unquote();}));
+	ASSERT(throws([] {better_string<char>("\"").unquote();}));
+	ASSERT(throws([] {better_string<char>("\"\\q\"").unquote();}));
+	ASSERT(throws([] {better_string<char>("\"\\x4\"").unquote();}));
+	ASSERT(throws([] {better_string<char>("\"\\ud800\"").unquote();}));
+	ASSERT(throws([] {better_string<char>("\"\\U00110000\"").unquote();}));
+	ASSERT(better_string<char>("\"a\\qb\\x4\"").unquote(better_string<char>::errors::Replace) == "a\uFFFDb\uFFFD");
+	ASSERT(better_string<char>("\"a\\qb\\x4\"").unquote(better_string<char>::errors::Ignore) == "ab");
+
+	// unquote - views are not copied without escape sequences
+	better_string<char> buffer;
+	better_string_view<char> quoted = "\"abc\"";
+	ASSERT(quoted.unquote(buffer).data() == quoted.data() + 1);
+	ASSERT(quoted.unquote() == "abc");
+	quoted = "\"a\\tc\"";
+	ASSERT(quoted.unquote(buffer) == "a\tc" && quoted.unquote(buffer).data() == buffer.data());
+
 	// string::format - general
 	ASSERT(string("{{}}").format() == "{}");
 	ASSERT(string("abcdef").format() == "abcdef");
@@ -362,6 +848,541 @@ void test_format()
 	printf("OK!\n");
 }
 
+template<typename string>
+void test_json()
+{
+	using namespace ext;
+	printf("Testing JSON functions... ");
+
+	// json_escape
+	ASSERT(string("").json_escape() == "");
+	ASSERT(string("abc 'def' /").json_escape() == "abc 'def' /");
+	ASSERT(string("\"\\\b\f\n\r\t").json_escape() == "\\\"\\\\\\b\\f\\n\\r\\t");
+	ASSERT(string("\x01\x1F\x7F").json_escape() == "\\u0001\\u001f\x7F");
+	ASSERT(string("a\0b", 3).json_escape() == "a\\u0000b");
+	ASSERT(string("é✏😀").json_escape() == "é✏😀");
+	ASSERT(string("é✏😀").json_escape(true) == "\\u00e9\\u270f\\ud83d\\ude00");
+	ASSERT(better_string<char16_t>(u"a\"😀").json_escape(true) == u"a\\\"\\ud83d\\ude00");
+
+	// json_escape - errors
+	ASSERT(throws([] {string("a\xFF").json_escape();}));
+	ASSERT(string("a\xFF" "b").json_escape(false, string::errors::Replace) == "a�b");
+	ASSERT(string("a\xFF" "b").json_escape(true, string::errors::Replace) == "a\\ufffdb");
+	ASSERT(string("a\xFF" "b").json_escape(false, string::errors::Ignore) == "ab");
+
+	// json_unescape
+	ASSERT(string("").json_unescape() == "");
+	ASSERT(string("abc 'def'").json_unescape() == "abc 'def'");
+	ASSERT(string("\\\"\\\\\\/\\b\\f\\n\\r\\t").json_unescape() == "\"\\/\b\f\n\r\t");
+	ASSERT(string("\\u0041\\u00E9\\u270f\\ud83d\\ude00").json_unescape() == "Aé✏😀");
+	ASSERT(better_string<char16_t>(u"\\ud83d\\ude00\\u0041😀").json_unescape() == u"😀A😀");
+	ASSERT(string("\\u0000").json_unescape() == better_string<char>("\0", 1));
+
+	// json_unescape - errors (unknown escapes, lone surrogates, unescaped characters, and truncated escapes)
+	for (auto text : {"\\q", "\\ud83d", "\\ude00", "\\ud83d\\u0041", "\\u12", "\\u12x4", "\\", "a\"b", "a\nb", "\xC3"})
+	{
+		ASSERT(throws([&] {string(text).json_unescape();}));
+		ASSERT(string(text).json_unescape(string::errors::Ignore).find("�") == size_t(-1));
+		ASSERT(string(text).json_unescape(string::errors::Replace).find("�") != size_t(-1));
+	}
+	ASSERT(string("a\\qb").json_unescape(string::errors::Replace) == "a�b");
+	ASSERT(string("\\ud83d\\u0041").json_unescape(string::errors::Replace) == "�" "A");
+
+	// Round trip, and the _into versions (appending to the output)
+	string text("{\"key\": \"value\\n\", \"emoji\": \"😀\", \"control\": \"\x01\"}");
+	for (int i = 0; i < 4; ++ i)
+		text = text + text;
+	ASSERT(text.json_escape().json_unescape() == text);
+	ASSERT(text.json_escape(true).json_unescape() == text);
+	string output("[");
+	ASSERT(&better_string_view<char>(text).json_escape_into(output) == &output);
+	ASSERT(output.substr(1) == text.json_escape());
+	ASSERT(text.json_escape().json_unescape_into(output) == "[" + text.json_escape() + text);
+
+	// Streams, cut at every position (inside of characters and escape sequences)
+	string escaped = text.json_escape(true);
+	for (size_t cut = 0; cut < 80; ++ cut)
+	{
+		json_escaper<char> escaper(true);
+		json_unescaper<char> unescaper;
+		string out1, out2;
+		escaper.feed(text.substr(0, cut), out1);
+		escaper.feed(text.substr(cut, 3), out1);
+		escaper.feed(text.substr(cut + 3), out1);
+		escaper.finish(out1);
+		ASSERT(out1 == escaped);
+		unescaper.feed(escaped.substr(0, cut), out2);
+		unescaper.feed(escaped.substr(cut, 5), out2);
+		unescaper.feed(escaped.substr(cut + 5), out2);
+		unescaper.finish(out2);
+		ASSERT(out2 == text);
+	}
+
+	// Streams - incomplete input at the end
+	json_unescaper<char> unescaper;
+	string out;
+	unescaper.feed("ab\\u00", out);
+	ASSERT(out == "ab");
+	ASSERT(throws([&] {unescaper.finish(out);}));
+
+	printf("OK!\n");
+}
+
+template<typename string>
+void test_binary()
+{
+	using namespace ext;
+	printf("Testing binary to text functions... ");
+
+	// b64encode (the test vectors of RFC 4648)
+	const char * plain[] = {"", "f", "fo", "foo", "foob", "fooba", "foobar"};
+	const char * encoded[] = {"", "Zg==", "Zm8=", "Zm9v", "Zm9vYg==", "Zm9vYmE=", "Zm9vYmFy"};
+	for (size_t i = 0; i < 7; ++ i)
+	{
+		ASSERT(string(plain[i]).b64encode() == encoded[i]);
+		ASSERT(string(encoded[i]).b64decode() == plain[i]);
+	}
+	ASSERT(string("\xFB\xFF\xBF").b64encode() == "+/+/");
+	ASSERT(string("\xFB\xFF\xBF").b64encode(true) == "-_-_");
+
+	// b64decode - padding is optional, but must be correct when present
+	ASSERT(string("Zm8").b64decode() == "fo");
+	ASSERT(string("-_-_").b64decode(true) == "\xFB\xFF\xBF");
+	for (auto text : {"Zm8==", "Zm9v=", "Z", "Zm9vY", "Zm=8", "Zm 8", "-_-_", "Zm9v\xFF"})
+		ASSERT(throws([&] {string(text).b64decode();}));
+	ASSERT(throws([] {string("+/+/").b64decode(true);}));
+
+	// b64decode - skipping invalid characters
+	ASSERT(string("Zm9v\r\nYmFy\r\n").b64decode(false, string::errors::Ignore) == "foobar");
+	ASSERT(string("Zm 9v YmE=").b64decode(false, string::errors::Replace) == "fooba");
+	ASSERT(string("Zm9vY").b64decode(false, string::errors::Ignore) == "foo");
+
+	// hexlify, unhexlify
+	ASSERT(string("").hexlify() == "");
+	ASSERT(string("\x01\xAB\xFF" "a").hexlify() == "01abff61");
+	ASSERT(string("01abFF61").unhexlify() == "\x01\xAB\xFF" "a");
+	ASSERT(throws([] {string("abc").unhexlify();}));
+	ASSERT(throws([] {string("ag").unhexlify();}));
+	ASSERT(string("de:ad:be:ef").unhexlify(string::errors::Ignore) == "\xDE\xAD\xBE\xEF");
+	ASSERT(string("abc").unhexlify(string::errors::Ignore) == "\xAB");
+
+	// Round trip on long inputs (every byte value, and every length around the vector widths)
+	string bytes;
+	for (int i = 0; i < 1000; ++ i)
+		bytes.push_back(char(i * 7));
+	for (size_t size = 0; size < 200; ++ size)
+	{
+		string part(bytes.data(), size);
+		ASSERT(part.b64encode().b64decode() == part);
+		ASSERT(part.b64encode(true).b64decode(true) == part);
+		ASSERT(part.hexlify().unhexlify() == part);
+		ASSERT(part.hexlify().upper().unhexlify() == part);
+	}
+	ASSERT(bytes.b64encode().b64decode() == bytes);
+	ASSERT(bytes.hexlify().size() == 2000);
+
+	// An invalid character after the first blocks
+	string text = bytes.b64encode();
+	text[700] = '*';
+	ASSERT(throws([&] {text.b64decode();}));
+	ASSERT(text.b64decode(false, string::errors::Ignore).size() == 999);
+
+	// The _into versions (appending to the output), and views
+	string output("[");
+	ASSERT(&better_string_view<char>(bytes).b64encode_into(output) == &output);
+	ASSERT(output.substr(1) == bytes.b64encode());
+	ASSERT(better_string_view<char>(output).substr(1) == bytes.b64encode());
+	ASSERT(better_string_view<char>("Zm9v").b64decode_into(output) == "[" + bytes.b64encode() + "foo");
+	ASSERT(better_string_view<char>("ff").unhexlify() == "\xFF");
+	ASSERT(better_string_view<char>("\xFF").hexlify() == "ff");
+
+	printf("OK!\n");
+}
+
+template<typename string>
+void test_url()
+{
+	using namespace ext;
+	printf("Testing URL functions... ");
+
+	// percent_encode
+	ASSERT(string("").percent_encode() == "");
+	ASSERT(string("abc-._~XYZ019").percent_encode() == "abc-._~XYZ019");
+	ASSERT(string("a b/c?d=é").percent_encode() == "a%20b%2Fc%3Fd%3D%C3%A9");
+	ASSERT(string("a b/c").percent_encode(url::path) == "a%20b/c");
+	ASSERT(string("a b+c").percent_encode(url::unreserved, true) == "a+b%2Bc");
+	ASSERT(string("a\0\xFF", 3).percent_encode() == "a%00%FF");
+
+	// percent_decode
+	ASSERT(string("a%20b%2fc%3F%C3%A9").percent_decode() == "a b/c?é");
+	ASSERT(string("a+b%2B").percent_decode() == "a+b+");
+	ASSERT(string("a+b%2B").percent_decode(true) == "a b+");
+	for (auto text : {"%", "a%2", "%zz", "%2x", "100%"})
+		ASSERT(throws([&] {string(text).percent_decode();}));
+	ASSERT(string("100% %2x").percent_decode(false, string::errors::Ignore) == "100% %2x");
+	ASSERT(string("100% %41").percent_decode(false, string::errors::Replace) == "100� A");
+
+	// Round trip on long inputs (every byte value)
+	string bytes;
+	for (int i = 0; i < 600; ++ i)
+		bytes.push_back(char(i * 7));
+	ASSERT(bytes.percent_encode().percent_decode() == bytes);
+	ASSERT(bytes.percent_encode(url::path, true).percent_decode(true) == bytes);
+	string output("[");
+	ASSERT(&better_string_view<char>(bytes).percent_encode_into(output) == &output);
+	ASSERT(better_string_view<char>(output).substr(1) == bytes.percent_encode());
+	ASSERT(better_string_view<char>("%41").percent_decode_into(output).endswith("A"));
+
+	// query_pairs
+	std::vector<std::string> pairs;
+	better_string_view<char> query("a=1&&b=x+y%21&c&=d&e=&f=%3D=&");
+	for (auto & pair : query.query_pairs())
+		pairs.push_back(std::string(pair.key) + "|" + std::string(pair.value));
+	ASSERT((pairs == std::vector<std::string> {"a|1", "b|x y!", "c|", "|d", "e|", "f|=="}));
+	ASSERT(string("").query_pairs().begin() == string("").query_pairs().end());
+
+	// query_pairs - the pairs without escapes are views of the query
+	auto range = query.query_pairs();
+	auto iter = range.begin();
+	ASSERT(iter->key.data() == query.data() && iter->value == "1");
+	++ iter;
+	ASSERT(iter->key == "b" && iter->key.data() != query.data() + 4);
+	ASSERT(std::distance(query.query_pairs().begin(), query.query_pairs().end()) == 6);
+
+	// query_pairs - errors
+	ASSERT(throws([] {for (auto & pair : better_string_view<char>("a=%zz").query_pairs()) (void) pair;}));
+	for (auto & pair : better_string_view<char>("a=%zz").query_pairs(string::errors::Ignore))
+		ASSERT(pair.value == "%zz");
+
+	printf("OK!\n");
+}
+
+template<typename string>
+void test_html()
+{
+	using namespace ext;
+	printf("Testing HTML functions... ");
+
+	// html_escape
+	ASSERT(string("").html_escape() == "");
+	ASSERT(string("plain text é").html_escape() == "plain text é");
+	ASSERT(string("<a href=\"x\">Tom & 'Jerry'</a>").html_escape() == "&lt;a href=&quot;x&quot;&gt;Tom &amp; &#x27;Jerry&#x27;&lt;/a&gt;");
+	ASSERT(string("<\"'>").html_escape(false) == "&lt;\"'&gt;");
+	ASSERT(better_string<char16_t>(u"a<b😀").html_escape() == u"a&lt;b😀");
+
+	// html_unescape - named and numeric references
+	ASSERT(string("&lt;a&gt; &amp;amp; &quot;&apos;&#x27;").html_unescape() == "<a> &amp; \"''");
+	ASSERT(string("caf&eacute; &euro;5 &thetasym; &Omega;&omega;").html_unescape() == "café €5 ϑ Ωω");
+	ASSERT(string("&#233;&#xE9;&#XE9;&#x1F600;&#65").html_unescape() == "ééé😀A");
+	ASSERT(better_string<char16_t>(u"&#x1F600;&hearts;").html_unescape() == u"😀♥");
+	ASSERT(better_string<char32_t>(U"&nbsp;").html_unescape() == U"\u00A0");
+
+	// html_unescape - invalid references are kept, invalid codepoints are replaced
+	ASSERT(string("AT&T &unknown; &amp &; & &#; &#x; &thetasymx;").html_unescape() == "AT&T &unknown; &amp &; & &#; &#x; &thetasymx;");
+	ASSERT(string("&#0;&#xD800;&#x110000;&#99999999999;").html_unescape() == "����");
+	ASSERT(string("&#128;&#x9F;&#150;&#129;&#160;").html_unescape() == "€Ÿ–\u0081\u00A0");
+	ASSERT(string("&").html_unescape() == "&");
+	ASSERT(string("&#").html_unescape() == "&#");
+
+	// Every named reference of the table is found
+	size_t count = 0;
+	for (auto & entity : impl::html_entities)
+		if (entity.name[0])
+		{
+			string name = better(string("&") + entity.name + ";");
+			string number = better(string("&#") + std::to_string(entity.codepoint).c_str() + ";");
+			ASSERT(name.html_unescape() == number.html_unescape());
+			++ count;
+		}
+	ASSERT(count == 253);
+
+	// Round trip
+	string text("<p class=\"x\">R&D costs > 5 & < 10 'units'</p> ");
+	for (int i = 0; i < 4; ++ i)
+		text = text + text;
+	ASSERT(text.html_escape().html_unescape() == text);
+	ASSERT(text.html_escape(false).html_unescape() == text);
+
+	// The _into versions (appending to the output), and views
+	string output("[");
+	ASSERT(&better_string_view<char>(text).html_escape_into(output) == &output);
+	ASSERT(better_string_view<char>(output).substr(1) == text.html_escape());
+	ASSERT(better_string_view<char>("&lt;").html_unescape_into(output).endswith("<"));
+
+	printf("OK!\n");
+}
+
+template<typename string>
+void test_shlex()
+{
+	using namespace ext;
+	printf("Testing shlex_split... ");
+
+	// Splits a command line into strings (the results are recorded from Python's shlex.split())
+	auto split = [] (better_string_view<char> text, bool posix) {
+		std::vector<std::string> result;
+		for (auto & token : text.shlex_split(posix))
+			result.push_back(std::string(token));
+		return result;
+	};
+	using tokens = std::vector<std::string>;
+
+	// POSIX mode
+	ASSERT(split("", true).empty() && split(" \t\r\n ", true).empty());
+	ASSERT((split("  lead  trail  ", true) == tokens {"lead", "trail"}));
+	ASSERT((split("a\"b c\"d", true) == tokens {"ab cd"}));
+	ASSERT((split("a \"\" b", true) == tokens {"a", "", "b"}));
+	ASSERT((split("'x'y z", true) == tokens {"xy", "z"}));
+	ASSERT((split("a\\ b x\"a\\\"b\" a#b", true) == tokens {"a b", "xa\"b", "a#b"}));
+	ASSERT((split("\"a\\zb\" 'a\\b' \"a\\\\b\" a\\\nb", true) == tokens {"a\\zb", "a\\b", "a\\b", "a\nb"}));
+	for (auto text : {"a\\", "\"a\\", "ab\"c", "it's", "\"abc"})
+		ASSERT(throws([&] {split(text, true);}));
+
+	// Non-POSIX mode (the quotes are kept, and only quotes at the start of a token group whitespace)
+	ASSERT((split("a\"b c\"d", false) == tokens {"a\"b", "c\"d"}));
+	ASSERT((split("\"a b\"c 'x'y", false) == tokens {"\"a b\"", "c", "'x'", "y"}));
+	ASSERT((split("a\\ b it's \"a\"\"b\"", false) == tokens {"a\\", "b", "it's", "\"a\"", "\"b\""}));
+	ASSERT(throws([&] {split("\"abc", false);}));
+
+	// Tokens without quotes and escapes are views of the text
+	better_string_view<char> line("cp -r 'my dir' \"a b\" x\\ y /tmp");
+	auto range = line.shlex_split();
+	auto iter = range.begin();
+	ASSERT(iter->data() == line.data() && *iter == "cp");
+	++ iter;
+	++ iter;
+	ASSERT(*iter == "my dir" && iter->data() == line.data() + 7);
+	++ iter;
+	ASSERT(*iter == "a b" && iter->data() == line.data() + 16);
+	++ iter;
+	ASSERT(*iter == "x y" && (iter->data() < line.data() || iter->data() >= line.data() + line.size()));
+	ASSERT(std::distance(line.shlex_split().begin(), line.shlex_split().end()) == 6);
+
+	// Long tokens (whole blocks)
+	string text;
+	for (int i = 0; i < 100; ++ i)
+		text = better(text + "word\\ 'quoted text' \"double \\\"q\\\"\" plain_token_longer_than_a_block_of_sixty_four_bytes_for_sure_ ");
+	size_t count = 0;
+	for (auto & token : text.shlex_split())
+		count += (token == "word quoted text" || token == "double \"q\"" || token.size() == 61);
+	ASSERT(count == 300);
+
+	printf("OK!\n");
+}
+
+template<typename string>
+void test_csv()
+{
+	using namespace ext;
+	printf("Testing CSV reader... ");
+
+	// Reads every record as a list of strings
+	using table = std::vector<std::vector<std::string>>;
+	auto read = [] (csv_reader<char> & reader) {
+		table result;
+		for (auto & record : reader)
+		{
+			result.emplace_back();
+			for (auto & field : record)
+				result.back().push_back(std::string(field));
+		}
+		return result;
+	};
+
+	// Quoted fields, empty fields, empty lines and line endings
+	string text("a,b,c\r\n\"x,1\",\"say \"\"hi\"\"\",\n\n,\"\"\n\"multi\nline\",\"\"\"\"\nlast");
+	table expected {{"a", "b", "c"}, {"x,1", "say \"hi\"", ""}, {"", ""}, {"multi\nline", "\""}, {"last"}};
+	csv_reader<char> reader(text);
+	ASSERT(read(reader) == expected);
+	ASSERT(read(reader).empty());
+
+	// Fields without doubled quotes are views of the input
+	csv_reader<char> views(text);
+	auto iter = views.begin();
+	ASSERT(iter->size() == 3 && (*iter)[1].data() == text.data() + 2);
+	++ iter;
+	ASSERT((*iter)[0].data() == text.data() + 8 && (*iter)[1].data() != text.data() + 14);
+
+	// Chunks cut at every position give the same records
+	for (size_t cut = 0; cut <= text.size(); ++ cut)
+	{
+		csv_reader<char> chunks;
+		chunks.feed(better(better_string_view<char>(text).substr(0, cut)));
+		table result = read(chunks);
+		chunks.feed(better(better_string_view<char>(text).substr(cut)));
+		for (auto & record : read(chunks))
+			result.push_back(record);
+		chunks.finish();
+		for (auto & record : read(chunks))
+			result.push_back(record);
+		ASSERT(result == expected);
+	}
+
+	// TSV, and other quote characters
+	csv_reader<char> tsv(better_string_view<char>("a\tb,c\t'd\te'\n"), '\t', '\'');
+	ASSERT((read(tsv) == table {{"a", "b,c", "d\te"}}));
+
+	// Invalid quoted fields (kept as they are, when not strict)
+	for (auto invalid : {"\"abc", "a,\"b\"c", "\"a\"\"", "\"a\"b\"\n", "a\"b,c\n", "a\"b,c\nd,e\nf,g\n"})
+	{
+		csv_reader<char> strict(better_string_view<char>{invalid});
+		ASSERT(throws([&] {read(strict);}));
+	}
+	csv_reader<char> lenient(better_string_view<char>("x,\"b\"c\n\"open"), ',', '"', string::errors::Ignore);
+	ASSERT((read(lenient) == table {{"x", "\"b\"c"}, {"\"open"}}));
+
+	// Quotes inside of unquoted fields are literal characters (they never join the rest of the input)
+	csv_reader<char> stray(better_string_view<char>("a\"b,c\nd,e\nf,g\n"), ',', '"', string::errors::Ignore);
+	ASSERT((read(stray) == table {{"a\"b", "c"}, {"d", "e"}, {"f", "g"}}));
+	string inches;
+	for (int i = 0; i < 500; ++ i)
+		inches = better(inches + string("5\" screen,\"a \"\"b\"\"\",x\"\"y\n"));
+	csv_reader<char> sizes(inches, ',', '"', string::errors::Ignore);
+	size_t matched = 0;
+	for (auto & record : sizes)
+		matched += (record.size() == 3 && record[0] == "5\" screen" && record[1] == "a \"b\"" && record[2] == "x\"\"y");
+	ASSERT(matched == 500);
+
+	// Long input (several blocks and windows, with quotes across them)
+	string row("1,\"two, \"\"three\"\"\",four\n");
+	string big;
+	for (int i = 0; i < 5000; ++ i)
+		big = better(big + row);
+	csv_reader<char> rows(big);
+	size_t count = 0;
+	for (auto & record : rows)
+		count += (record.size() == 3 && record[1] == "two, \"three\"" && record[2] == "four");
+	ASSERT(count == 5000);
+
+	printf("OK!\n");
+}
+
+void test_allocations()
+{
+	using namespace ext;
+	printf("Testing allocations... ");
+
+	// Inputs (longer than the small string buffer)
+	better_string<char> text("the quick brown fox jumps over the lazy dog, the quick brown fox jumps over the lazy dog");
+	better_string_view<char> view(text);
+	better_string<char> fill("-");
+
+	// Search, prefix and character functions never allocate
+	ASSERT(count_allocations([&] {text.find("lazy"); text.rfind("lazy"); text.index("fox"); text.rindex("fox");}) == 0);
+	ASSERT(count_allocations([&] {view.find("lazy"); view.rfind("lazy"); view.index("fox"); view.rindex("fox");}) == 0);
+	ASSERT(count_allocations([&] {text.count("o"); view.count("the"); text.length(); view.length();}) == 0);
+	ASSERT(count_allocations([&] {text.startswith("the"); text.endswith("dog"); view.startswith("the"); view.endswith("dog");}) == 0);
+	ASSERT(count_allocations([&] {text.isascii(); view.isascii();}) == 0);
+
+	// Views of views
+	better_string_view<char> rest;
+	ASSERT(count_allocations([&] {rest = view.removeprefix("the ").removesuffix(" dog");}) == 0);
+	ASSERT(rest.size() == text.size() - 8);
+
+	// Functions creating a string allocate it once
+	better_string<char> result;
+	ASSERT(count_allocations([&] {result = text.upper();}) == 1);
+	ASSERT(count_allocations([&] {result = view.lower();}) == 1);
+	ASSERT(count_allocations([&] {result = text.center(100);}) == 1);
+	ASSERT(count_allocations([&] {result = text.ljust(100, fill);}) == 1);
+	ASSERT(count_allocations([&] {result = text.rjust(100, fill);}) == 1);
+	ASSERT(count_allocations([&] {result = text.zfill(100);}) == 1);
+	ASSERT(count_allocations([&] {result = text.replace("fox", "cat");}) == 1);
+	ASSERT(count_allocations([&] {result = text.removeprefix("the ");}) == 1);
+	ASSERT(count_allocations([&] {result = text.b64encode();}) == 1);
+	ASSERT(count_allocations([&] {result = view.hexlify();}) == 1);
+	ASSERT(count_allocations([&] {result = result.unhexlify();}) == 1);
+	ASSERT(count_allocations([&] {for (auto & pair : view.query_pairs()) (void) pair;}) == 0);
+	ASSERT(count_allocations([&] {result = text.html_escape();}) == 1);
+
+	// Split to views only allocates the list, split to strings also allocates the long parts
+	std::vector<better_string_view<char>> views;
+	size_t list = count_allocations([&] {std::vector<better_string_view<char>> temp; for (int i = 0; i < 18; ++ i) temp.emplace_back();});
+	ASSERT(count_allocations([&] {views = view.split();}) == list);
+	ASSERT(views.size() == 18);
+	ASSERT(count_allocations([&] {views = view.split(" ");}) == list);
+	ASSERT(count_allocations([&] {views = view.rsplit(" ");}) == list);
+	ASSERT(count_allocations([&] {views = view.split(", ");}) == 2);
+	ASSERT(views.size() == 2 && views[1].startswith("the"));
+
+	// Formatting a short string allocates nothing (numbers are converted without temporaries)
+	better_string<char> short_format("{} {:x} {:>4}");
+	ASSERT(count_allocations([&] {result = short_format.format(int64_t(-12345), uint64_t(255), int64_t(7));}) == 0);
+	ASSERT(result == "-12345 ff    7");
+
+	// Edit and escape functions allocate the result once
+	better_string<char> tabs("the\tquick\tbrown\tfox\tjumps\tover\tthe\tlazy\tdog, the quick brown fox");
+	better_string<char> quoted("\"the quick brown fox \\t jumps over the lazy dog, the quick brown fox\"");
+	better_string<char> percent("the%20quick%20brown%20fox%20jumps%20over%20the%20lazy%20dog%2C%20the%20quick%20fox");
+	auto table = better_string<char>::maketrans("abc", "xyz");
+	better_string<char16_t> wide;
+	ASSERT(count_allocations([&] {result = tabs.expandtabs();}) == 1);
+	ASSERT(count_allocations([&] {result = text.translate(table);}) == 1);
+	ASSERT(count_allocations([&] {result = fill.join(views);}) == 1);
+	ASSERT(count_allocations([&] {wide = text.transcode<Encoding::UTF8, Encoding::UTF16>();}) == 1);
+	ASSERT(count_allocations([&] {result = repr(text);}) == 1);
+	ASSERT(count_allocations([&] {result = ascii(text);}) == 1);
+	ASSERT(count_allocations([&] {result = text.json_escape();}) == 1);
+	ASSERT(count_allocations([&] {result = quoted.unquote();}) == 1);
+	ASSERT(count_allocations([&] {result = text.percent_encode();}) == 1);
+	ASSERT(count_allocations([&] {result = percent.percent_decode();}) == 1);
+
+	// Truncating an argument does not copy all of it
+	ASSERT(count_allocations([&] {result = better_string<char>("{:.12}").format(text);}) == 0);
+	ASSERT(result == "the quick br");
+
+	// The versions with a buffer reuse its capacity
+	better_string<char> buffer;
+	better_string_view<char> slice;
+	better_string<char> plain("\"the quick brown fox jumps over the lazy dog, the quick brown fox jumps\"");
+	ASSERT(count_allocations([&] {slice = better_string_view<char>(plain).unquote(buffer);}) == 0);
+	ASSERT(count_allocations([&] {slice = better_string_view<char>(quoted).unquote(buffer);}) == 1);
+	ASSERT(count_allocations([&] {slice = better_string_view<char>(quoted).unquote(buffer);}) == 0);
+	ASSERT(count_allocations([&] {buffer.clear(); text.percent_encode_into(buffer);}) == 1);
+	ASSERT(count_allocations([&] {buffer.clear(); text.percent_encode_into(buffer);}) == 0);
+	ASSERT(count_allocations([&] {buffer.clear(); percent.percent_decode_into(buffer);}) == 0);
+	ASSERT(buffer == "the quick brown fox jumps over the lazy dog, the quick fox");
+
+	// Searches, and the distance of short strings, allocate nothing (only the list of find_all)
+	better_string<char> other("the quick brown cat jumps over the lazy dog");
+	std::vector<size_t> offsets;
+	ASSERT(count_allocations([&] {other.levenshtein("the quick brown fox jumped over a lazy dog");}) == 0);
+	ASSERT(count_allocations([&] {for (auto match : view.finditer("fox")) (void) match;}) == 0);
+	size_t pair = count_allocations([&] {std::vector<size_t> temp; temp.push_back(0); temp.push_back(0);});
+	ASSERT(count_allocations([&] {offsets = view.find_all("fox");}) == pair + 2);
+	ASSERT(offsets.size() == 2);
+
+	// Character sets
+	charset<> seps(" ,");
+	better_string<char> padded("   the quick brown fox jumps over the lazy dog, the quick brown fox   ");
+	ASSERT(count_allocations([&] {slice = better_string_view<char>(padded).strip(seps);}) == 0);
+	ASSERT(count_allocations([&] {result = padded.strip(seps);}) == 1);
+	ASSERT(count_allocations([&] {views = view.split_any(seps);}) == list);
+	ASSERT(count_allocations([&] {views = view.split_any(", ");}) == list);
+	ASSERT(views.size() == 19);
+
+	// Lines and parts are views, or strings allocated for the long ones
+	better_string<char> lines("the quick brown fox\njumps over the lazy dog\nthe quick brown fox\njumps over the lazy dog");
+	std::vector<better_string<char>> strings;
+	size_t four = count_allocations([&] {std::vector<better_string_view<char>> temp; for (int i = 0; i < 4; ++ i) temp.emplace_back();});
+	ASSERT(count_allocations([&] {views = better_string_view<char>(lines).splitlines();}) == four);
+	ASSERT(count_allocations([&] {strings = lines.splitlines();}) == four + 4);
+	ASSERT(count_allocations([&] {views = view.partition("fox");}) == 1);
+	ASSERT(count_allocations([&] {views = view.rpartition("fox");}) == 1);
+	ASSERT(count_allocations([&] {strings = text.partition("fox");}) == 3);
+	ASSERT(count_allocations([&] {strings = text.rpartition("fox");}) == 3);
+
+	// Allocator parameters
+	CountingAllocator<char>::count = 0;
+	auto counted = view.upper<Encoding::UTF8, CountingAllocator<char>>();
+	ASSERT(CountingAllocator<char>::count == 1);
+	auto replaced = view.replace<Encoding::UTF8, CountingAllocator<char>>("the", "a");
+	ASSERT(CountingAllocator<char>::count == 2);
+	ASSERT(counted.size() == text.size() && replaced.size() == text.size() - 8);
+
+	printf("OK!\n");
+}
+
 int main()
 {
 	using namespace ext;
@@ -369,9 +1390,20 @@ int main()
 	// Run tests
 	test_alignment<better_string<char>>();
 	test_search<better_string<char>>();
+	test_edit_distance<better_string<char>>();
 	test_replace<better_string<char>>();
 	test_split_join<better_string<char>>();
+	test_character<better_string<char>>();
+	test_charset<better_string<char>>();
+	test_case<better_string<char>>();
 	test_format<better_string<char>>();
+	test_json<better_string<char>>();
+	test_binary<better_string<char>>();
+	test_url<better_string<char>>();
+	test_html<better_string<char>>();
+	test_shlex<better_string<char>>();
+	test_csv<better_string<char>>();
+	test_allocations();
 
 	// On success
 	printf("--------------------\nSuccess!\n");
@@ -0,0 +1,179 @@
+#include "better-suffix.hh"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+// Helper functions
+
+#define ASSERT(c) assert(c, #c, __FILE__, __LINE__)
+
+inline void assert(bool condition, const char * message, const char * file, long line)
+{
+	if (!condition)
+	{
+		printf("Assertion Failed: %s\nFile: %s, Line: %ld\n", message, file, line);
+		exit(-1);
+	}
+}
+
+using offsets = std::vector<size_t>;
+
+// Returns the offsets of a substring, with a search at every offset
+auto reference_find_all(const std::string & text, const std::string & sub) -> offsets
+{
+	offsets result;
+	for (size_t pos = text.find(sub); pos != std::string::npos; pos = text.find(sub, pos + 1))
+		result.push_back(pos);
+	return result;
+}
+
+void test_queries()
+{
+	using namespace ext;
+
+	std::string text = "abracadabra";
+	suffix_index index(text);
+	ASSERT(index.size() == 11);
+	ASSERT(index.suffix(0) == 10 && index.suffix(1) == 7 && index.suffix(10) == 2);
+	ASSERT(index.count("abra") == 2);
+	ASSERT(index.count("a") == 5);
+	ASSERT(index.count("") == 12);
+	ASSERT(index.count("abracadabrax") == 0);
+	ASSERT(index.count("z") == 0);
+	ASSERT(index.contains("cad") && !index.contains("dac"));
+	ASSERT(index.find("bra") == 1);
+	ASSERT(index.find("") == 0);
+	ASSERT(index.find("x") == size_t(-1));
+	ASSERT((index.find_all("a") == offsets {0, 3, 5, 7, 10}));
+	ASSERT((index.find_all("ra") == offsets {2, 9}));
+	ASSERT((index.find_all("") == offsets {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11}));
+	ASSERT((index.range("ab") == std::pair<size_t, size_t> {1, 3}));
+	ASSERT(index.range("zz").first == index.range("zz").second);
+
+	// Overlapping occurrences, bytes above 0x7F and zero bytes
+	std::string runs("aaaa\0\xFF\xFF\xFF", 8);
+	suffix_index binary(runs);
+	ASSERT(binary.count("aa") == 3);
+	ASSERT(binary.count(std::string("\xFF\xFF", 2)) == 2);
+	ASSERT((binary.find_all(std::string("a\0", 2)) == offsets {3}));
+
+	// An empty text
+	suffix_index empty{better_string_view<char>()};
+	ASSERT(empty.count("a") == 0);
+	ASSERT(empty.count("") == 1);
+}
+
+void test_random()
+{
+	using namespace ext;
+	std::mt19937 random(42);
+
+	for (int round = 0; round < 300; ++ round)
+	{
+		// Small alphabets and periodic texts make deep recursions
+		std::string text;
+		size_t size = random() % (round % 10 ? 200 : 5000);
+		size_t letters = 1 + random() % (round % 3 ? 4 : 256);
+		size_t period = 1 + random() % 8;
+		for (size_t i = 0; i < size; ++ i)
+			text += (round % 4 == 0 && i >= period) ? text[i - period] : char(random() % letters);
+
+		// The suffix array is sorted
+		suffix_index index(text);
+		std::vector<bool> seen(size, false);
+		for (size_t rank = 0; rank < size; ++ rank)
+		{
+			ASSERT(index.suffix(rank) < size && !seen[index.suffix(rank)]);
+			seen[index.suffix(rank)] = true;
+			if (rank > 0)
+				ASSERT(text.compare(index.suffix(rank - 1), size, text, index.suffix(rank), size) < 0);
+		}
+
+		// Substrings of the text, and random ones
+		for (int query = 0; query < 20; ++ query)
+		{
+			std::string sub;
+			if (size > 0 && query % 2)
+				sub = text.substr(random() % size, 1 + random() % 6);
+			else
+				for (size_t i = random() % 4; i > 0; -- i)
+					sub += char(random() % letters);
+			offsets expected = reference_find_all(text, sub);
+			ASSERT(index.count(sub) == expected.size());
+			ASSERT(index.find_all(sub) == expected);
+			ASSERT(index.find(sub) == (expected.empty() ? size_t(-1) : expected[0]));
+		}
+	}
+}
+
+void test_file()
+{
+	using namespace ext;
+
+	std::string text = "the quick brown fox jumps over the lazy dog";
+	std::string path = "better-suffix-test.idx";
+	suffix_index(text).save(path);
+	{
+		suffix_index index = suffix_index::open(path);
+		ASSERT(index.text() == text.c_str());
+		ASSERT(index.count("the") == 2);
+		ASSERT((index.find_all("o") == offsets {12, 17, 26, 41}));
+
+		// Moved indices keep their mapping
+		suffix_index moved = std::move(index);
+		ASSERT(moved.count("he ") == 2);
+	}
+
+	// Empty texts (and the default constructed index)
+	suffix_index(std::string()).save(path);
+	ASSERT(suffix_index::open(path).size() == 0 && suffix_index::open(path).count("a") == 0);
+	suffix_index().save(path);
+	ASSERT(suffix_index::open(path).find_all("a").empty());
+
+	// Invalid and missing files (an offset out of the text, a wrong header, no file)
+	suffix_index(text).save(path);
+	impl::SuffixHeader header;
+	uint32_t offset = 0x7FFFFFF0;
+	FILE * file = fopen(path.c_str(), "r+b");
+	ASSERT(fread(&header, sizeof(header), 1, file) == 1);
+	fseek(file, long(header.array + 4 * 5), SEEK_SET);
+	fwrite(&offset, sizeof(offset), 1, file);
+	fclose(file);
+	bool thrown = false;
+	try {suffix_index::open(path);} catch (const std::invalid_argument &) {thrown = true;}
+	ASSERT(thrown);
+
+	file = fopen(path.c_str(), "wb");
+	fputs("not an index, but a long enough text", file);
+	fclose(file);
+	thrown = false;
+	try {suffix_index::open(path);} catch (const std::invalid_argument &) {thrown = true;}
+	ASSERT(thrown);
+	remove(path.c_str());
+	thrown = false;
+	try {suffix_index::open(path);} catch (const std::system_error &) {thrown = true;}
+	ASSERT(thrown);
+}
+
+int main()
+{
+	printf("Testing queries... ");
+	test_queries();
+	printf("OK!\n");
+
+	printf("Testing against a search at every offset... ");
+	test_random();
+	printf("OK!\n");
+
+	printf("Testing files... ");
+	test_file();
+	printf("OK!\n");
+
+	// On success
+	printf("--------------------\nSuccess!\n");
+	return 0;
+}
@@ -0,0 +1,217 @@
+#!/usr/bin/env python3
+"""
+Generates the golden file of the differential tests (test/better-golden-test.cc).
+
+Every algorithm modeled on a Python `str` method is called with random inputs, and the results of CPython are recorded.
+The test replays the file against `better_string<char>`, `better_string<char16_t>` and `better_string<char32_t>`.
+
+The output is deterministic for a given seed, and only has to be regenerated when the cases change:
+
+	python3 test/golden/generate.py > test/golden/string.txt
+
+File format: one case per line, with tab separated fields. The first field is the name of the algorithm, followed by the
+arguments, a `=` field, and the results. Positions are codepoint indices (like in Python), `-` is `None`, and `!` means
+that Python raised an exception. Backslashes and control characters are escaped as `\\` and `\\xNN`.
+
+The inputs avoid the documented differences from Python:
+ - Only the ASCII whitespace characters are used (`split()` does not recognize Unicode whitespace).
+ - `upper()` and `lower()` only map ASCII letters, so the non-ASCII characters are uncased.
+ - `expandtabs()` is always called with an explicit tab size (the default is 4, not 8).
+ - Positions are never negative (the positions are `size_t`).
+ - `format()` is only called with an integer and a string argument, and without grouping (`,` or `_`), nested fields,
+   attribute access, or the `n` and `c` types. Strings are not converted with `!r` (the quotes are C style).
+"""
+
+import argparse
+import random
+import sys
+
+# Characters of the random strings: ASCII letters and whitespace, and uncased characters from every UTF-8/UTF-16 length
+ALPHABET = 'aaabbbcAB-+0 \t\n\r\x0b\x0c' + '§×€✏中\U0001f600'
+LETTERS = 'abcAB€\U0001f600'
+
+
+def escape(value):
+	result = []
+	for ch in value:
+		if ch == '\\':
+			result.append('\\\\')
+		elif ord(ch) < 0x20 or ord(ch) == 0x7f:
+			result.append('\\x%02x' % ord(ch))
+		else:
+			result.append(ch)
+	return ''.join(result)
+
+
+def field(value):
+	if value is None:
+		return '-'
+	if isinstance(value, bool):
+		return '1' if value else '0'
+	if isinstance(value, int):
+		return str(value)
+	return escape(value)
+
+
+class Generator:
+	def __init__(self, seed):
+		self.random = random.Random(seed)
+		self.lines = []
+
+	def text(self, alphabet=ALPHABET, length=None):
+		if length is None:
+			length = self.random.choice([0, 1, 2, 3, 5, 8, 13, 21, 40])
+		return ''.join(self.random.choice(alphabet) for _ in range(length))
+
+	def sub(self, text):
+		# Substrings are usually taken from the text, so they are found
+		if text and self.random.random() < 0.7:
+			start = self.random.randrange(len(text))
+			return text[start:start + self.random.choice([0, 1, 1, 2, 3])]
+		return self.text(LETTERS, self.random.choice([0, 1, 2]))
+
+	def position(self, text):
+		return self.random.randrange(len(text) + 3)
+
+	def record(self, name, args, function):
+		try:
+			results = function()
+			if not isinstance(results, list):
+				results = [results]
+		except Exception:
+			results = ['!']
+			self.lines.append('\t'.join([name] + [field(a) for a in args] + ['=', '!']))
+			return
+		self.lines.append('\t'.join([name] + [field(a) for a in args] + ['='] + [field(r) for r in results]))
+
+	# Alignment
+
+	def alignment(self):
+		text, width = self.text(), self.random.randrange(45)
+		fill = self.random.choice(' *✏\U0001f600')
+		self.record('center', [text, width, fill], lambda: text.center(width, fill))
+		self.record('ljust', [text, width, fill], lambda: text.ljust(width, fill))
+		self.record('rjust', [text, width, fill], lambda: text.rjust(width, fill))
+		text = self.random.choice(['', '+', '-']) + self.text()
+		self.record('zfill', [text, width], lambda: text.zfill(width))
+
+	# Search
+
+	def search(self):
+		text = self.text()
+		sub = self.sub(text)
+		start, end = 0, None
+		if self.random.random() < 0.5:
+			start = self.position(text)
+			end = self.random.choice([None, self.position(text)])
+		self.record('find', [text, sub, start, end], lambda: text.find(sub, start, end))
+		self.record('rfind', [text, sub, start, end], lambda: text.rfind(sub, start, end))
+		self.record('index', [text, sub, start, end], lambda: text.index(sub, start, end))
+		self.record('rindex', [text, sub, start, end], lambda: text.rindex(sub, start, end))
+		self.record('count', [text, sub, start, end], lambda: text.count(sub, start, end))
+		self.record('startswith', [text, sub, start, end], lambda: text.startswith(sub, start, end))
+		self.record('endswith', [text, sub, start, end], lambda: text.endswith(sub, start, end))
+		self.record('removeprefix', [text, sub], lambda: text.removeprefix(sub))
+		self.record('removesuffix', [text, sub], lambda: text.removesuffix(sub))
+
+	# Replace
+
+	def replace(self):
+		text = self.text()
+		old, new = self.sub(text), self.text(LETTERS, self.random.choice([0, 1, 2, 4]))
+		count = self.random.choice([-1, -1, 0, 1, 2])
+		self.record('replace', [text, old, new, count], lambda: text.replace(old, new, count))
+		tabsize = self.random.choice([0, 1, 2, 4, 8])
+		self.record('expandtabs', [text, tabsize], lambda: text.expandtabs(tabsize))
+
+	# Split and join
+
+	def split(self):
+		text = self.text()
+		sep = self.sub(text)
+		maxsplit = self.random.choice([-1, -1, 0, 1, 2])
+		self.record('split', [text, maxsplit], lambda: text.split(None, maxsplit))
+		self.record('rsplit', [text, maxsplit], lambda: text.rsplit(None, maxsplit))
+		self.record('split_sep', [text, sep, maxsplit], lambda: text.split(sep, maxsplit))
+		self.record('rsplit_sep', [text, sep, maxsplit], lambda: text.rsplit(sep, maxsplit))
+		self.record('partition', [text, sep], lambda: list(text.partition(sep)))
+		self.record('rpartition', [text, sep], lambda: list(text.rpartition(sep)))
+		keepends = self.random.random() < 0.5
+		self.record('splitlines', [text, keepends], lambda: text.splitlines(keepends))
+		items = [self.text() for _ in range(self.random.randrange(4))]
+		self.record('join', [sep] + items, lambda: sep.join(items))
+
+	# Character and case
+
+	def character(self):
+		text = self.text()
+		self.record('isascii', [text], lambda: text.isascii())
+		self.record('upper', [text], lambda: text.upper())
+		self.record('lower', [text], lambda: text.lower())
+
+	# Formatting
+
+	def spec(self, integer):
+		parts = []
+		align = self.random.choice(['', '', '<', '>', '^'] + (['='] if integer else []))
+		if align and self.random.random() < 0.5:
+			parts.append(self.random.choice('*✏\U0001f600'))
+		parts.append(align)
+		# Signs and alternate forms are errors for strings (sometimes tested)
+		if self.random.random() < (0.3 if integer else 0.05):
+			parts.append(self.random.choice('+- '))
+		if self.random.random() < (0.2 if integer else 0.05):
+			parts.append('#')
+		if integer and self.random.random() < 0.2:
+			parts.append('0')
+		if self.random.random() < 0.6:
+			parts.append(str(self.random.randrange(12)))
+		if not integer and self.random.random() < 0.3:
+			parts.append('.' + str(self.random.randrange(6)))
+		parts.append(self.random.choice(['', 'b', 'o', 'd', 'x', 'X'] if integer else ['', 's']))
+		return ''.join(parts)
+
+	def format(self):
+		number = self.random.choice([0, 1, -1, 7, -42, 255, 65535, -(2 ** 63), 2 ** 63 - 1])
+		string = self.text(LETTERS)
+		fields = []
+		automatic = self.random.random() < 0.5
+		for i in range(self.random.randrange(1, 3) if automatic else self.random.randrange(1, 4)):
+			index = i if automatic else self.random.randrange(2)
+			conversion = self.random.choice(['', '', '', '!s', '!r' if index == 0 else '!s'])
+			spec = self.spec(index == 0 and not conversion) if self.random.random() < 0.7 else ''
+			fields.append('{%s%s%s}' % ('' if automatic else index, conversion, ':' + spec if spec else ''))
+		literal = lambda: self.random.choice(['', '', 'a', '✏', '{{', '}}', ' = '])
+		fmt = literal() + ''.join(f + literal() for f in fields)
+		# Malformed format strings
+		if self.random.random() < 0.05:
+			fmt = fmt[:self.random.randrange(len(fmt) + 1)] + self.random.choice(['{', '}', '{0', '{!', '{:', '{!x}', '{2}'])
+		self.record('format', [fmt, number, string], lambda: fmt.format(number, string))
+
+	def generate(self, count):
+		for _ in range(count):
+			self.alignment()
+			self.search()
+			self.replace()
+			self.split()
+			self.character()
+			self.format()
+		return self.lines
+
+
+def main():
+	parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[0])
+	parser.add_argument('--seed', type=int, default=57, help='random seed')
+	parser.add_argument('--count', type=int, default=400, help='number of cases of each algorithm')
+	args = parser.parse_args()
+
+	out = sys.stdout
+	out.reconfigure(encoding='utf-8', newline='\n')
+	out.write('# Generated by test/golden/generate.py --seed %d --count %d (Python %d.%d)\n' %
+		(args.seed, args.count, sys.version_info.major, sys.version_info.minor))
+	for line in Generator(args.seed).generate(args.count):
+		out.write(line + '\n')
+
+
+if __name__ == '__main__':
+	main()
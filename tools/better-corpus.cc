@@ -0,0 +1,129 @@
+#include "better-corpus.hh"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+
+// Print usage
+static void usage(const char * name)
+{
+	fprintf(stderr,
+		"Usage: %s [options]\n"
+		"\n"
+		"Generates a reproducible synthetic corpus.\n"
+		"\n"
+		"Options:\n"
+		"  --kind KIND       ascii, mixed, cjk, log, csv, json or malformed (default: mixed)\n"
+		"  --encoding ENC    utf8, utf16 or utf32, in native byte order (default: utf8)\n"
+		"  --seed N          random seed (default: %llu)\n"
+		"  --size N[k|M|G]   size of each file in bytes (default: 1M)\n"
+		"  --count N         number of files, using seeds N, N+1, ... (default: 1)\n"
+		"  --output PATH     output file, or directory when --count is used (default: stdout)\n",
+		name, (unsigned long long) corpus::default_seed);
+}
+
+// Parse size with optional suffix
+static auto parse_size(const char * str, size_t & size) -> bool
+{
+	char * end = nullptr;
+	unsigned long long value = strtoull(str, &end, 0);
+	if (end == str)
+		return false;
+	switch (*end)
+	{
+		case 'k': case 'K': value <<= 10; ++ end; break;
+		case 'm': case 'M': value <<= 20; ++ end; break;
+		case 'g': case 'G': value <<= 30; ++ end; break;
+	}
+	size = size_t(value);
+	return *end == 0;
+}
+
+// Generate and write a corpus
+template<typename Char>
+static auto write(FILE * file, corpus::Kind kind, uint64_t seed, size_t size) -> bool
+{
+	auto text = corpus::generate<Char>(kind, seed, size);
+	return fwrite(text.data(), sizeof(Char), text.size(), file) == text.size();
+}
+
+int main(int argc, char ** argv)
+{
+	// Options
+	corpus::Kind kind = corpus::Kind::Mixed;
+	uint64_t seed = corpus::default_seed;
+	size_t size = 1 << 20;
+	size_t count = 0;
+	size_t width = 1;
+	const char * output = nullptr;
+
+	// Parse arguments
+	for (int i = 1; i < argc; ++ i)
+	{
+		const char * arg = argv[i];
+		const char * value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+		bool ok = value != nullptr;
+
+		if (strcmp(arg, "--kind") == 0)
+			ok = ok && corpus::parse_kind(value, kind);
+		else if (strcmp(arg, "--encoding") == 0)
+			ok = ok && ((strcmp(value, "utf8") == 0 && (width = 1)) ||
+				(strcmp(value, "utf16") == 0 && (width = 2)) ||
+				(strcmp(value, "utf32") == 0 && (width = 4)));
+		else if (strcmp(arg, "--seed") == 0)
+			ok = ok && (seed = strtoull(value, nullptr, 0), true);
+		else if (strcmp(arg, "--size") == 0)
+			ok = ok && parse_size(value, size);
+		else if (strcmp(arg, "--count") == 0)
+			ok = ok && parse_size(value, count) && count > 0;
+		else if (strcmp(arg, "--output") == 0)
+			output = value;
+		else
+			ok = false;
+
+		if (!ok)
+		{
+			usage(argv[0]);
+			return 2;
+		}
+		++ i;
+	}
+
+	// Generate files
+	for (size_t i = 0; i < (count ? count : 1); ++ i)
+	{
+		// Open output
+		FILE * file = stdout;
+		std::string path;
+		if (output && count)
+		{
+			char name[64];
+			snprintf(name, sizeof(name), "/%s-%llu", corpus::kind_name(kind), (unsigned long long) (seed + i));
+			path = output + std::string(name);
+		}
+		else if (output)
+			path = output;
+		if (!path.empty() && !(file = fopen(path.c_str(), "wb")))
+		{
+			fprintf(stderr, "Cannot open output: %s\n", path.c_str());
+			return 1;
+		}
+
+		// Write corpus
+		bool ok =
+			(width == 1) ? write<char>(file, kind, seed + i, size) :
+			(width == 2) ? write<char16_t>(file, kind, seed + i, size) :
+			write<char32_t>(file, kind, seed + i, size);
+		if (file != stdout)
+			fclose(file);
+		if (!ok)
+		{
+			fprintf(stderr, "Write error\n");
+			return 1;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,538 @@
+#pragma once
+
+#include "better-string.hh"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+/************************************************************
+ * @brief Synthetic corpus generator
+ *
+ * Generates realistic, reproducible text for the benchmarks and the fuzzers. The output only depends on the kind, the
+ * seed and the size, so results are comparable between machines, compilers and releases. (The random generator and
+ * every distribution are implemented here, because the ones in <random> are implementation defined.)
+ */
+namespace corpus {
+
+// Corpus kinds
+enum class Kind
+{
+	Ascii,		// ASCII prose
+	Mixed,		// Mostly ASCII prose, with words from other scripts
+	Wide,		// CJK and emoji heavy prose
+	Log,		// Apache combined log lines
+	Csv,		// CSV with quoted fields, embedded separators, quotes and newlines
+	Json,		// JSON-ish lines, with escapes and nesting
+	Malformed,	// Mixed prose with deliberately malformed sequences
+};
+
+// Names of the corpus kinds
+static constexpr const char * kind_names[] = {"ascii", "mixed", "cjk", "log", "csv", "json", "malformed"};
+static constexpr size_t kind_count = sizeof(kind_names) / sizeof(kind_names[0]);
+
+inline auto kind_name(Kind kind) -> const char *
+	{return kind_names[size_t(kind)];}
+
+inline auto parse_kind(const char * name, Kind & kind) -> bool
+{
+	for (size_t i = 0; i < kind_count; ++ i)
+		if (std::char_traits<char>::compare(name, kind_names[i], std::char_traits<char>::length(kind_names[i]) + 1) == 0)
+			return kind = Kind(i), true;
+	return false;
+}
+
+// Default seed
+static constexpr uint64_t default_seed = 0xB3773A;
+
+/************************************************************
+ * @brief Random generator (SplitMix64)
+ */
+class Random
+{
+public:
+	// Constructor
+	explicit Random(uint64_t seed)
+		: state(seed) {}
+
+	// Next random number
+	auto next() -> uint64_t
+	{
+		uint64_t z = (state += 0x9E3779B97F4A7C15);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+		return z ^ (z >> 31);
+	}
+
+	// Random number in [0, n)
+	auto below(uint64_t n) -> uint64_t
+		{return n ? next() % n : 0;}
+
+	// Random number in [min, max]
+	auto between(uint64_t min, uint64_t max) -> uint64_t
+		{return min + below(max - min + 1);}
+
+	// True with the given percentage
+	auto chance(uint64_t percent) -> bool
+		{return below(100) < percent;}
+
+	// Random element of an array
+	template<typename T, size_t N>
+	auto pick(T (& array)[N]) -> T &
+		{return array[below(N)];}
+
+private:
+	uint64_t state;
+};
+
+/************************************************************
+ * @brief Encodes the generated codepoints with the default encoding of the character type.
+ *
+ * The library encoders are not used, so that the corpus does not depend on the code it is used to test.
+ */
+template<typename Char>
+class Writer
+{
+public:
+	// Constructor
+	explicit Writer(size_t units)
+		: limit(units) {result.reserve(units + 4);}
+
+	// Check if the size limit is reached
+	auto full() const -> bool
+		{return result.size() >= limit;}
+
+	// Append a codepoint (dropped if it does not fit)
+	void put(uint32_t cp)
+	{
+		Char units[4];
+		size_t n = encode(units, cp);
+		if (result.size() + n <= limit)
+			result.extend(units, n);
+		else
+			limit = result.size();
+	}
+
+	// Append an ASCII string
+	void put(const char * str)
+	{
+		for (; *str; ++ str)
+			put(uint8_t(*str));
+	}
+
+	// Append a decimal number
+	void number(uint64_t value, size_t digits = 1)
+	{
+		char buffer[24];
+		size_t n = 0;
+		do
+			buffer[n ++] = char('0' + value % 10), value /= 10;
+		while (value > 0 || n < digits);
+		while (n > 0)
+			put(uint8_t(buffer[-- n]));
+	}
+
+	// Append code units as they are, even if they are invalid
+	void raw(const uint32_t * units, size_t n)
+	{
+		if (result.size() + n > limit)
+			{limit = result.size(); return;}
+		for (size_t i = 0; i < n; ++ i)
+			result.push_back(Char(units[i]));
+	}
+
+	// Finish, and pad the result to the exact size
+	auto finish(size_t units) -> ext::better_string<Char> &&
+	{
+		result.resize(std::min(result.size(), units));
+		while (result.size() < units)
+			result.push_back(Char(' '));
+		return std::move(result);
+	}
+
+private:
+	// Encode a codepoint
+	static auto encode(Char * out, uint32_t cp) -> size_t
+	{
+		if (sizeof(Char) == 1)
+		{
+			if (cp < 0x80)
+				return out[0] = Char(cp), 1;
+			if (cp < 0x800)
+				return out[0] = Char(0xC0 | (cp >> 6)), out[1] = Char(0x80 | (cp & 0x3F)), 2;
+			if (cp < 0x10000)
+				return out[0] = Char(0xE0 | (cp >> 12)), out[1] = Char(0x80 | ((cp >> 6) & 0x3F)),
+					out[2] = Char(0x80 | (cp & 0x3F)), 3;
+			return out[0] = Char(0xF0 | (cp >> 18)), out[1] = Char(0x80 | ((cp >> 12) & 0x3F)),
+				out[2] = Char(0x80 | ((cp >> 6) & 0x3F)), out[3] = Char(0x80 | (cp & 0x3F)), 4;
+		}
+		if (sizeof(Char) == 2 && cp >= 0x10000)
+			return out[0] = Char(0xD800 | ((cp - 0x10000) >> 10)), out[1] = Char(0xDC00 | (cp & 0x3FF)), 2;
+		return out[0] = Char(cp), 1;
+	}
+
+	// Fields
+	ext::better_string<Char> result;
+	size_t limit;
+};
+
+// -------------------- Vocabulary --------------------
+
+// Script ranges (inclusive)
+struct Script
+{
+	uint32_t first;
+	uint32_t last;
+};
+
+static constexpr Script latin = {0xE0, 0xFF};
+static constexpr Script greek = {0x3B1, 0x3C9};
+static constexpr Script cyrillic = {0x430, 0x44F};
+static constexpr Script hebrew = {0x5D0, 0x5EA};
+static constexpr Script arabic = {0x627, 0x64A};
+static constexpr Script devanagari = {0x915, 0x939};
+static constexpr Script kana = {0x3041, 0x3096};
+static constexpr Script cjk = {0x4E00, 0x9FFF};
+static constexpr Script hangul = {0xAC00, 0xD7A3};
+static constexpr Script emoji = {0x1F600, 0x1F64F};
+
+// Write a random ASCII word
+template<typename Char>
+void ascii_word(Writer<Char> & out, Random & rng, size_t min = 2, size_t max = 10)
+{
+	for (size_t i = 0, n = rng.between(min, max); i < n; ++ i)
+		out.put("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789"[rng.below(62)]);
+}
+
+// Write a random word in a script
+template<typename Char>
+void script_word(Writer<Char> & out, Random & rng, Script script, size_t min = 2, size_t max = 10)
+{
+	for (size_t i = 0, n = rng.between(min, max); i < n; ++ i)
+		out.put(uint32_t(rng.between(script.first, script.last)));
+}
+
+// Write a random word of the given prose kind
+template<typename Char>
+void word(Writer<Char> & out, Random & rng, Kind kind)
+{
+	static const Script mixed[] = {latin, latin, greek, cyrillic, hebrew, arabic, devanagari, cjk, hangul, emoji};
+	static const Script wide[] = {cjk, cjk, cjk, cjk, cjk, kana, kana, hangul, emoji, emoji};
+
+	size_t roll = rng.below(100);
+	if (kind == Kind::Ascii || (kind == Kind::Wide && roll < 10) || (kind != Kind::Wide && roll < 85))
+		ascii_word(out, rng);
+	else if (kind == Kind::Wide)
+		script_word(out, rng, rng.pick(wide));
+	else
+		script_word(out, rng, rng.pick(mixed));
+}
+
+// -------------------- Generators --------------------
+
+// Prose: words separated by spaces, with tabs, commas and lines of about 72 characters
+template<typename Char>
+void prose(Writer<Char> & out, Random & rng, Kind kind)
+{
+	size_t column = 0;
+	while (!out.full())
+	{
+		word(out, rng, kind);
+		column += 8;
+		if (column > 72)
+			out.put('\n'), column = 0;
+		else if (rng.chance(6))
+			out.put(rng.chance(50) ? '\t' : ',');
+		else
+			out.put(' ');
+	}
+}
+
+// Apache combined log format
+template<typename Char>
+void log(Writer<Char> & out, Random & rng)
+{
+	static const char * months[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+	static const char * methods[] = {"GET", "GET", "GET", "GET", "POST", "POST", "PUT", "DELETE", "HEAD"};
+	static const char * statuses[] = {"200", "200", "200", "200", "200", "304", "301", "404", "403", "500"};
+	static const char * extensions[] = {".html", ".css", ".js", ".png", ".jpg", "", "", ".json"};
+	static const char * agents[] = {
+		"Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/118.0 Safari/537.36",
+		"Mozilla/5.0 (Windows NT 10.0; Win64; x64; rv:109.0) Gecko/20100101 Firefox/119.0",
+		"Mozilla/5.0 (iPhone; CPU iPhone OS 17_0 like Mac OS X) AppleWebKit/605.1.15 Mobile/15E148",
+		"curl/8.4.0",
+		"Googlebot/2.1 (+http://www.google.com/bot.html)",
+	};
+
+	uint64_t time = 1700000000 + rng.below(1000000);
+	while (!out.full())
+	{
+		// Host, identity and user
+		for (size_t i = 0; i < 4; ++ i)
+		{
+			out.number(i == 0 ? rng.between(1, 223) : rng.below(256));
+			out.put(i < 3 ? "." : " - ");
+		}
+		if (rng.chance(80))
+			out.put('-');
+		else
+			ascii_word(out, rng, 3, 8);
+
+		// Time
+		time += rng.below(5);
+		out.put(" [");
+		out.number(1 + (time / 86400) % 28, 2);
+		out.put('/');
+		out.put(months[(time / 2419200) % 12]);
+		out.put("/2023:");
+		out.number((time / 3600) % 24, 2);
+		out.put(':');
+		out.number((time / 60) % 60, 2);
+		out.put(':');
+		out.number(time % 60, 2);
+		out.put(" +0000] \"");
+
+		// Request
+		out.put(rng.pick(methods));
+		out.put(' ');
+		for (size_t i = 0, n = rng.between(1, 4); i < n; ++ i)
+			{out.put('/'); ascii_word(out, rng, 2, 12);}
+		out.put(rng.pick(extensions));
+		if (rng.chance(30))
+		{
+			for (size_t i = 0, n = rng.between(1, 4); i < n; ++ i)
+			{
+				out.put(i ? '&' : '?');
+				ascii_word(out, rng, 1, 6);
+				out.put('=');
+				if (rng.chance(30))
+					out.put("%20"), ascii_word(out, rng, 1, 4), out.put("%C3%A9");
+				else
+					ascii_word(out, rng, 1, 10);
+			}
+		}
+		out.put(" HTTP/1.1\" ");
+
+		// Status and size
+		out.put(rng.pick(statuses));
+		out.put(' ');
+		out.number(rng.below(100000));
+
+		// Referer and user agent
+		out.put(" \"");
+		if (rng.chance(40))
+			out.put('-');
+		else
+			out.put("https://www."), ascii_word(out, rng, 4, 10), out.put(".com/"), ascii_word(out, rng, 0, 10);
+		out.put("\" \"");
+		out.put(rng.pick(agents));
+		out.put("\"\n");
+	}
+}
+
+// CSV with a header, and quoted fields
+template<typename Char>
+void csv(Writer<Char> & out, Random & rng)
+{
+	out.put("id,name,city,amount,comment\n");
+	for (uint64_t id = 1; !out.full(); ++ id)
+	{
+		// Number
+		out.number(id);
+		out.put(',');
+
+		// Simple field
+		word(out, rng, Kind::Mixed);
+		out.put(',');
+
+		// Quoted field with a separator
+		if (rng.chance(30))
+			out.put('"'), word(out, rng, Kind::Ascii), out.put(", "), word(out, rng, Kind::Mixed), out.put('"');
+		else
+			word(out, rng, Kind::Ascii);
+		out.put(',');
+
+		// Decimal
+		out.number(rng.below(100000));
+		out.put('.');
+		out.number(rng.below(100), 2);
+		out.put(',');
+
+		// Quoted field with escaped quotes and newlines
+		if (rng.chance(40))
+		{
+			out.put('"');
+			for (size_t i = 0, n = rng.between(1, 8); i < n; ++ i)
+			{
+				word(out, rng, Kind::Mixed);
+				size_t roll = rng.below(10);
+				out.put(roll == 0 ? "\"\"" : roll == 1 ? "\n" : roll == 2 ? "," : " ");
+			}
+			out.put('"');
+		}
+		else if (rng.chance(50))
+			word(out, rng, Kind::Mixed);
+		out.put(rng.chance(10) ? "\r\n" : "\n");
+	}
+}
+
+// JSON value
+template<typename Char>
+void json_value(Writer<Char> & out, Random & rng, size_t depth)
+{
+	size_t roll = rng.below(depth < 3 ? 10 : 7);
+	if (roll < 3)
+	{
+		// String, with escapes
+		out.put('"');
+		for (size_t i = 0, n = rng.between(1, 6); i < n; ++ i)
+		{
+			if (i)
+				out.put(' ');
+			word(out, rng, Kind::Mixed);
+			if (rng.chance(10))
+			{
+				static const char * escapes[] = {"\\\"", "\\\\", "\\n", "\\t", "\\/", "\\u00e9", "\\ud83d\\ude00"};
+				out.put(rng.pick(escapes));
+			}
+		}
+		out.put('"');
+	}
+	else if (roll < 5)
+	{
+		// Number
+		if (rng.chance(30))
+			out.put('-');
+		out.number(rng.below(1000000));
+		if (rng.chance(40))
+			out.put('.'), out.number(rng.below(1000), 3);
+	}
+	else if (roll < 6)
+		out.put(rng.chance(50) ? "true" : "false");
+	else if (roll < 7)
+		out.put("null");
+	else if (roll < 8)
+	{
+		// Array
+		out.put('[');
+		for (size_t i = 0, n = rng.below(5); i < n; ++ i)
+		{
+			if (i)
+				out.put(", ");
+			json_value(out, rng, depth + 1);
+		}
+		out.put(']');
+	}
+	else
+	{
+		// Object
+		out.put('{');
+		for (size_t i = 0, n = rng.between(1, 5); i < n; ++ i)
+		{
+			if (i)
+				out.put(", ");
+			out.put('"');
+			ascii_word(out, rng, 2, 8);
+			out.put("\": ");
+			json_value(out, rng, depth + 1);
+		}
+		out.put('}');
+	}
+}
+
+// JSON-ish lines (one object per line)
+template<typename Char>
+void json(Writer<Char> & out, Random & rng)
+{
+	while (!out.full())
+	{
+		out.put("{\"id\": ");
+		out.number(rng.below(1000000000));
+		for (size_t i = 0, n = rng.between(1, 6); i < n; ++ i)
+		{
+			out.put(", \"");
+			ascii_word(out, rng, 2, 8);
+			out.put("\": ");
+			json_value(out, rng, 1);
+		}
+		out.put("}\n");
+	}
+}
+
+// Mixed prose with malformed sequences
+template<typename Char>
+void malformed(Writer<Char> & out, Random & rng)
+{
+	// UTF-8: stray tails, truncated sequences, overlong forms, surrogates, values above U+10FFFF, invalid bytes
+	static const uint32_t utf8[][5] = {
+		{1, 0x80}, {1, 0xBF}, {1, 0xC3}, {2, 0xE2, 0x82}, {3, 0xF0, 0x9F, 0x98},
+		{2, 0xC0, 0x80}, {2, 0xC1, 0xBF}, {3, 0xE0, 0x80, 0xAF}, {4, 0xF0, 0x80, 0x80, 0xAF},
+		{3, 0xED, 0xA0, 0x80}, {3, 0xED, 0xBF, 0xBF}, {4, 0xF4, 0x90, 0x80, 0x80},
+		{1, 0xF5}, {1, 0xFE}, {1, 0xFF},
+	};
+	// UTF-16: unpaired and reversed surrogates
+	static const uint32_t utf16[][5] = {
+		{1, 0xD800}, {1, 0xDBFF}, {1, 0xDC00}, {1, 0xDFFF}, {2, 0xDC00, 0xD800},
+	};
+	// UTF-32: surrogates, and values above U+10FFFF
+	static const uint32_t utf32[][5] = {
+		{1, 0xD800}, {1, 0xDFFF}, {1, 0x110000}, {1, 0xFFFFFFFF},
+	};
+
+	while (!out.full())
+	{
+		word(out, rng, Kind::Mixed);
+		if (rng.chance(20))
+		{
+			const uint32_t * bad =
+				(sizeof(Char) == 1) ? rng.pick(utf8) :
+				(sizeof(Char) == 2) ? rng.pick(utf16) :
+				rng.pick(utf32);
+			out.raw(bad + 1, bad[0]);
+		}
+		out.put(rng.chance(10) ? '\n' : ' ');
+	}
+}
+
+/**
+ * @brief Generate a corpus.
+ *
+ * @tparam Char The character type of the result. The text is encoded with the default encoding of the type.
+ * @param kind The kind of the text.
+ * @param seed The random seed.
+ * @param bytes The size of the result in bytes (rounded down to whole characters).
+ */
+template<typename Char>
+auto generate(Kind kind, uint64_t seed, size_t bytes) -> ext::better_string<Char>
+{
+	size_t units = bytes / sizeof(Char);
+	Writer<Char> out(units);
+	Random rng(seed * 0x100000001B3 + uint64_t(kind));
+
+	switch (kind)
+	{
+		case Kind::Ascii:
+		case Kind::Mixed:
+		case Kind::Wide:
+			prose(out, rng, kind);
+			break;
+		case Kind::Log:
+			log(out, rng);
+			break;
+		case Kind::Csv:
+			csv(out, rng);
+			break;
+		case Kind::Json:
+			json(out, rng);
+			break;
+		case Kind::Malformed:
+			malformed(out, rng);
+			break;
+	}
+
+	return out.finish(units);
+}
+
+// Close namespace "corpus"
+}
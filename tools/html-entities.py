@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+"""
+Generates the table of named character references used by `html_unescape()` (include/better-string.hh).
+
+The names are the entities of HTML 4 (`html.entities.name2codepoint`) and `&apos;`. They are stored in the slots of a
+perfect hash table: the FNV-1a hash of a name (with seed 0) selects one of the buckets, and the displacement of the
+bucket is the seed of a second hash, which selects the slot. The output replaces the table in the header:
+
+	python3 tools/html-entities.py
+"""
+
+import html.entities
+
+SLOTS = 256
+BUCKETS = 128
+
+
+def fnv(name, seed):
+	value = (2166136261 ^ seed) & 0xFFFFFFFF
+	for ch in name.encode():
+		value = ((value ^ ch) * 16777619) & 0xFFFFFFFF
+	return value
+
+
+def main():
+	names = dict(html.entities.name2codepoint)
+	names['apos'] = 0x27
+
+	# Place the largest buckets first, with the first displacement where every name finds a free slot
+	buckets = [[] for _ in range(BUCKETS)]
+	for name in names:
+		buckets[fnv(name, 0) % BUCKETS].append(name)
+	slots = [None] * SLOTS
+	displacements = [0] * BUCKETS
+	for bucket in sorted(range(BUCKETS), key=lambda b: -len(buckets[b])):
+		if not buckets[bucket]:
+			continue
+		for seed in range(1, 256):
+			positions = [fnv(name, seed) % SLOTS for name in buckets[bucket]]
+			if len(set(positions)) == len(positions) and all(slots[p] is None for p in positions):
+				for name, position in zip(buckets[bucket], positions):
+					slots[position] = name
+				displacements[bucket] = seed
+				break
+		else:
+			raise SystemExit('No displacement found for bucket %d' % bucket)
+
+	print('// Displacements of the buckets of named character references (generated by tools/html-entities.py)')
+	print('static constexpr uint8_t html_displacements[%d] = {' % BUCKETS)
+	for i in range(0, BUCKETS, 16):
+		print('\t' + ' '.join('%d,' % d for d in displacements[i:i + 16]))
+	print('};')
+	print()
+	print('// Named character references, in the slots of the perfect hash table (generated by tools/html-entities.py)')
+	print('static constexpr HtmlEntity html_entities[%d] = {' % SLOTS)
+	for i in range(0, SLOTS, 6):
+		entries = ['{"%s", 0x%X},' % (name, names[name]) if name else '{"", 0},' for name in slots[i:i + 6]]
+		print('\t' + ' '.join(entries))
+	print('};')
+
+
+if __name__ == '__main__':
+	main()